@@ -0,0 +1,136 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "util.h"
+
+static void arenaAddReserved(mem_arena_t *arena, u64 size)
+{
+    arena->reserved += size;
+    if (arena->reserved > arena->peak) arena->peak = arena->reserved;
+}
+
+void arenaInit(mem_arena_t *arena, u64 blockSize)
+{
+    if (!arena) return;
+    
+    memset(arena, 0, sizeof(mem_arena_t));
+    arena->block_size = (blockSize ? round_up(blockSize, ARENA_ALIGNMENT) : ARENA_BLOCK_SIZE);
+}
+
+void *arenaAlloc(mem_arena_t *arena, u64 size)
+{
+    if (!arena || !size) return NULL;
+    
+    if (!arena->block_size) arena->block_size = ARENA_BLOCK_SIZE;
+    
+    size = round_up(size, ARENA_ALIGNMENT);
+    
+    mem_arena_block *block = arena->blocks;
+    void *ptr = NULL;
+    
+    if (size > (arena->block_size / 4))
+    {
+        // Big allocations get their own block. It's linked right after the current block, so the free space left in it can still be used
+        block = malloc(sizeof(mem_arena_block) + size);
+        if (!block) return NULL;
+        
+        arenaAddReserved(arena, sizeof(mem_arena_block) + size);
+        
+        block->size = block->used = size;
+        
+        if (arena->blocks)
+        {
+            block->next = arena->blocks->next;
+            arena->blocks->next = block;
+        } else {
+            block->next = NULL;
+            arena->blocks = block;
+        }
+    } else {
+        if (!block || (block->size - block->used) < size)
+        {
+            block = malloc(sizeof(mem_arena_block) + arena->block_size);
+            if (!block) return NULL;
+            
+            arenaAddReserved(arena, sizeof(mem_arena_block) + arena->block_size);
+            
+            block->size = arena->block_size;
+            block->used = 0;
+            block->next = arena->blocks;
+            arena->blocks = block;
+        }
+        
+        block->used += size;
+    }
+    
+    ptr = (block->data + (block->used - size));
+    memset(ptr, 0, size);
+    
+    arena->used += size;
+    arena->alloc_cnt++;
+    
+    return ptr;
+}
+
+void *arenaMemdup(mem_arena_t *arena, const void *src, u64 size)
+{
+    if (!src) return NULL;
+    
+    void *ptr = arenaAlloc(arena, size);
+    if (ptr) memcpy(ptr, src, size);
+    
+    return ptr;
+}
+
+void *arenaScratch(mem_arena_t *arena, u64 size)
+{
+    if (!arena || !size) return NULL;
+    
+    if (arena->scratch_size < size)
+    {
+        // Don't use realloc() here: the old contents don't have to be preserved, and we don't want both buffers to be allocated at the same time
+        arenaReleaseScratch(arena);
+        
+        arena->scratch = malloc(size);
+        if (!arena->scratch) return NULL;
+        
+        arena->scratch_size = size;
+        arenaAddReserved(arena, size);
+    }
+    
+    memset(arena->scratch, 0, arena->scratch_size);
+    
+    return arena->scratch;
+}
+
+void arenaReleaseScratch(mem_arena_t *arena)
+{
+    if (!arena || !arena->scratch) return;
+    
+    free(arena->scratch);
+    arena->scratch = NULL;
+    
+    arena->reserved -= arena->scratch_size;
+    arena->scratch_size = 0;
+}
+
+void arenaFree(mem_arena_t *arena)
+{
+    if (!arena) return;
+    
+    mem_arena_block *block = arena->blocks, *next = NULL;
+    
+    while(block)
+    {
+        next = block->next;
+        free(block);
+        block = next;
+    }
+    
+    arena->blocks = NULL;
+    
+    arenaReleaseScratch(arena);
+    
+    arena->reserved = 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <switch.h>
+
+#define ARENA_BLOCK_SIZE    (u64)0x40000        // 256 KiB. Default block size for small allocations
+#define ARENA_ALIGNMENT     (u64)0x10           // Every allocation is aligned to a 0x10-byte boundary
+
+/*
+ * Bump allocator for buffers that live as long as a single dump operation.
+ *
+ * Small allocations are carved out of ARENA_BLOCK_SIZE blocks. Allocations bigger than a quarter of the block size get their own exactly sized block, so nothing is sized after worst-case constants.
+ * Memory is never released on its own: everything is freed at once with arenaFree().
+ *
+ * The scratch buffer is a single temporary working buffer (e.g. for XML generation) which is reused between calls and can be released as soon as it isn't needed anymore.
+ * Results built in it should be copied to the arena with arenaMemdup() using their actual size.
+ */
+
+typedef struct mem_arena_block {
+    struct mem_arena_block *next;
+    u64 size;
+    u64 used;
+    u64 reserved;                                                               // Keeps data aligned to ARENA_ALIGNMENT
+    u8 data[];
+} mem_arena_block;
+
+typedef struct {
+    mem_arena_block *blocks;                                                    // Most recently allocated block first
+    u64 block_size;
+    void *scratch;
+    u64 scratch_size;
+    u64 used;                                                                   // Bytes handed out by arenaAlloc()
+    u64 reserved;                                                               // Bytes currently allocated from the heap (blocks + scratch buffer)
+    u64 peak;                                                                   // High-water mark for reserved
+    u32 alloc_cnt;
+} mem_arena_t;
+
+/* Initializes an empty arena. A blockSize of zero selects ARENA_BLOCK_SIZE. No memory is allocated until it's needed. */
+void arenaInit(mem_arena_t *arena, u64 blockSize);
+
+/* Returns a zeroed, aligned buffer, or NULL if we ran out of memory. */
+void *arenaAlloc(mem_arena_t *arena, u64 size);
+
+/* Copies size bytes from src to a new arena buffer. */
+void *arenaMemdup(mem_arena_t *arena, const void *src, u64 size);
+
+/* Returns the zeroed scratch buffer, growing it if it's smaller than size. Its contents are discarded by every call. */
+void *arenaScratch(mem_arena_t *arena, u64 size);
+
+/* Releases the scratch buffer before the arena itself is freed. */
+void arenaReleaseScratch(mem_arena_t *arena);
+
+/* Releases every block and the scratch buffer. The usage statistics are kept, so they can still be reported afterwards. */
+void arenaFree(mem_arena_t *arena);
+
+#endif
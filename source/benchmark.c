@@ -0,0 +1,805 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fatfs/ff.h"
+#include "benchmark.h"
+#include "crc32_fast.h"
+#include "nca.h"
+#include "nso.h"
+#include "out_file.h"
+#include "save.h"
+#include "ui.h"
+
+/* Extern variables */
+
+extern dumpOptions dumpCfg;
+extern gamecard_ctx_t gameCardInfo;
+
+extern exefs_ctx_t exeFsContext;
+extern romfs_ctx_t romFsContext;
+extern bktr_ctx_t bktrContext;
+
+extern bool keysFileAvailable;
+
+extern u32 titleAppCount, titlePatchCount;
+extern base_app_ctx_t *baseAppEntries;
+extern patch_addon_ctx_t *patchEntries;
+
+extern u64 freeSpace;
+
+extern int breaks;
+extern int font_height;
+
+static const char *benchmarkSourceNames[] = { "Gamecard read", "SD card NCA read", "eMMC NCA read" };
+
+static const char *benchmarkCorePathNames[BENCHMARK_CORE_CNT] = { "crc32", "sha256", "aes_ctr", "aes_xts_nca_header", "nca_read", "nca_header_decrypt", "nca_ctr_section", "bktr_read", "nso_mw_scan", "save_process", "save_fat_read" };
+static const char *benchmarkCorePathLabels[BENCHMARK_CORE_CNT] = { "CRC32", "SHA-256", "AES-128-CTR (raw)", "AES-128-XTS (raw)", "NCA reads", "NCA header decryption", "NCA CTR section reads", "BKTR section reads", "NSO middleware scan", "ES savefile processing", "ES savefile FAT reads" };
+
+static u32 benchmarkGetSpeed(u64 size, u64 startTick)
+{
+    u64 ns = armTicksToNs(armGetSystemTick() - startTick);
+    if (!ns) ns = 1;
+    
+    u64 speed = (((size * 1000000000ULL) / ns) / 1024);
+    
+    return (speed > (u64)UINT32_MAX ? UINT32_MAX : (speed ? (u32)speed : 1));
+}
+
+static void benchmarkPrintResults(const char *name, const u32 *speeds)
+{
+    u32 i;
+    char line[NAME_BUF_LEN] = {'\0'}, tmp[64] = {'\0'};
+    
+    snprintf(line, MAX_ELEMENTS(line), "%s:", name);
+    
+    for(i = 0; i < DUMP_BLOCK_SIZE_CNT; i++)
+    {
+        if (speeds[i])
+        {
+            snprintf(tmp, MAX_ELEMENTS(tmp), " %lu MiB: %.2f MiB/s%s", (u64)(DUMP_BLOCK_SIZE(i) / MiB), (double)speeds[i] / KiB, (i < (DUMP_BLOCK_SIZE_CNT - 1) ? " |" : ""));
+        } else {
+            snprintf(tmp, MAX_ELEMENTS(tmp), " %lu MiB: -%s", (u64)(DUMP_BLOCK_SIZE(i) / MiB), (i < (DUMP_BLOCK_SIZE_CNT - 1) ? " |" : ""));
+        }
+        
+        strcat(line, tmp);
+    }
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%s", line);
+    uiRefreshDisplay();
+    breaks++;
+}
+
+static bool benchmarkGameCardRead(u8 *buf, u32 *speeds)
+{
+    if (!gameCardInfo.isInserted)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%s: no gamecard inserted. Skipped.", benchmarkSourceNames[DUMP_BLOCK_SOURCE_GAMECARD]);
+        breaks++;
+        return false;
+    }
+    
+    Result result;
+    u32 i;
+    u64 off, n, startOffset, startTick;
+    u64 partitionSize = gameCardInfo.IStoragePartitionSizes[ISTORAGE_PARTITION_SECURE - 1];
+    u64 totalSize = (partitionSize < BENCHMARK_DATA_SIZE ? (partitionSize - (partitionSize % MEDIA_UNIT_SIZE)) : BENCHMARK_DATA_SIZE);
+    bool success = true;
+    
+    if (!totalSize) return false;
+    
+    result = openGameCardStoragePartition(ISTORAGE_PARTITION_SECURE);
+    if (R_FAILED(result))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #%u! (0x%08X)", __func__, ISTORAGE_PARTITION_SECURE - 1, result);
+        breaks++;
+        return false;
+    }
+    
+    for(i = 0; i < DUMP_BLOCK_SIZE_CNT && success; i++)
+    {
+        // Read a different area for each block size, if possible
+        startOffset = (partitionSize >= (totalSize * DUMP_BLOCK_SIZE_CNT) ? (totalSize * i) : 0);
+        startTick = armGetSystemTick();
+        
+        for(off = 0; off < totalSize; off += n)
+        {
+            n = ((totalSize - off) < DUMP_BLOCK_SIZE(i) ? (totalSize - off) : DUMP_BLOCK_SIZE(i));
+            
+            result = readGameCardStoragePartition(startOffset + off, buf, n);
+            if (R_FAILED(result))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes block at offset 0x%016lX from IStorage partition! (0x%08X)", __func__, n, startOffset + off, result);
+                breaks++;
+                success = false;
+                break;
+            }
+        }
+        
+        if (success) speeds[i] = benchmarkGetSpeed(totalSize, startTick);
+    }
+    
+    closeGameCardStoragePartition();
+    
+    return success;
+}
+
+// Looks for the biggest NCA in an already opened content storage. Returns zero if there's no installed content
+static s64 benchmarkGetBiggestNca(NcmContentStorage *ncmStorage, NcmContentId *outContentId)
+{
+    Result result;
+    NcmContentId *contentIds = NULL;
+    s32 contentIdCnt = 0, j;
+    s64 contentSize = 0, maxContentSize = 0;
+    
+    contentIds = calloc(BENCHMARK_MAX_CONTENT_IDS, sizeof(NcmContentId));
+    if (!contentIds)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for the content ID list!", __func__);
+        breaks++;
+        return 0;
+    }
+    
+    result = ncmContentStorageListContentId(ncmStorage, &contentIdCnt, contentIds, BENCHMARK_MAX_CONTENT_IDS, 0);
+    if (R_FAILED(result))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: ncmContentStorageListContentId failed! (0x%08X)", __func__, result);
+        breaks++;
+        free(contentIds);
+        return 0;
+    }
+    
+    // Use the biggest NCA we can find, so we don't measure the same data twice
+    for(j = 0; j < contentIdCnt; j++)
+    {
+        result = ncmContentStorageGetSizeFromContentId(ncmStorage, &contentSize, &(contentIds[j]));
+        if (R_SUCCEEDED(result) && contentSize > maxContentSize)
+        {
+            maxContentSize = contentSize;
+            memcpy(outContentId, &(contentIds[j]), sizeof(NcmContentId));
+        }
+    }
+    
+    free(contentIds);
+    
+    return maxContentSize;
+}
+
+static bool benchmarkNcaRead(NcmStorageId storageId, dumpBlockSource source, u8 *buf, u32 *speeds)
+{
+    Result result;
+    NcmContentStorage ncmStorage;
+    NcmContentId contentId;
+    s64 maxContentSize = 0;
+    u32 i;
+    u64 off, n, startOffset, startTick, totalSize;
+    bool success = false;
+    
+    memset(&ncmStorage, 0, sizeof(NcmContentStorage));
+    memset(&contentId, 0, sizeof(NcmContentId));
+    
+    result = ncmOpenContentStorage(&ncmStorage, storageId);
+    if (R_FAILED(result))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%s: storage not available. Skipped.", benchmarkSourceNames[source]);
+        breaks++;
+        return false;
+    }
+    
+    maxContentSize = benchmarkGetBiggestNca(&ncmStorage, &contentId);
+    if (!maxContentSize)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%s: no installed content found. Skipped.", benchmarkSourceNames[source]);
+        breaks++;
+        goto out;
+    }
+    
+    totalSize = ((u64)maxContentSize < BENCHMARK_DATA_SIZE ? (u64)maxContentSize : BENCHMARK_DATA_SIZE);
+    success = true;
+    
+    for(i = 0; i < DUMP_BLOCK_SIZE_CNT && success; i++)
+    {
+        startOffset = ((u64)maxContentSize >= (totalSize * DUMP_BLOCK_SIZE_CNT) ? (totalSize * i) : 0);
+        startTick = armGetSystemTick();
+        
+        for(off = 0; off < totalSize; off += n)
+        {
+            n = ((totalSize - off) < DUMP_BLOCK_SIZE(i) ? (totalSize - off) : DUMP_BLOCK_SIZE(i));
+            
+            // Skip the NCA cache, we want to know how fast the storage is
+            result = ncmContentStorageReadContentIdFile(&ncmStorage, buf, n, &contentId, startOffset + off);
+            if (R_FAILED(result))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes block at offset 0x%016lX from NCA! (0x%08X)", __func__, n, startOffset + off, result);
+                breaks++;
+                success = false;
+                break;
+            }
+        }
+        
+        if (success) speeds[i] = benchmarkGetSpeed(totalSize, startTick);
+    }
+    
+out:
+    ncmContentStorageClose(&ncmStorage);
+    
+    return success;
+}
+
+static void benchmarkHash(u8 *buf, bool sha256, u32 *speeds)
+{
+    u32 i, crc;
+    u64 off, n, startTick;
+    u8 hash[SHA256_HASH_SIZE];
+    Sha256Context sha256Ctx;
+    
+    for(i = 0; i < DUMP_BLOCK_SIZE_CNT; i++)
+    {
+        crc = 0;
+        sha256ContextCreate(&sha256Ctx);
+        
+        startTick = armGetSystemTick();
+        
+        for(off = 0; off < BENCHMARK_DATA_SIZE; off += n)
+        {
+            n = DUMP_BLOCK_SIZE(i);
+            
+            if (sha256)
+            {
+                sha256ContextUpdate(&sha256Ctx, buf, n);
+            } else {
+                crc32(buf, n, &crc);
+            }
+        }
+        
+        if (sha256) sha256ContextGetHash(&sha256Ctx, hash);
+        
+        speeds[i] = benchmarkGetSpeed(BENCHMARK_DATA_SIZE, startTick);
+    }
+}
+
+static bool benchmarkSdCardWrite(u8 *buf, u32 *speeds)
+{
+    out_file_t outFile;
+    u32 i;
+    u64 off, n, startTick;
+    bool success = true;
+    
+    if (freeSpace < BENCHMARK_DATA_SIZE)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "SD card write: not enough free space. Skipped.");
+        breaks++;
+        return false;
+    }
+    
+    for(i = 0; i < DUMP_BLOCK_SIZE_CNT && success; i++)
+    {
+        startTick = armGetSystemTick();
+        
+        // Dumps are written the same way
+        if (!outFileCreate(&outFile, BENCHMARK_FILE_PATH, BENCHMARK_DATA_SIZE))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to create benchmark file! (0x%08X)", __func__, outFile.lastResult);
+            breaks++;
+            success = false;
+            break;
+        }
+        
+        for(off = 0; off < BENCHMARK_DATA_SIZE; off += n)
+        {
+            n = DUMP_BLOCK_SIZE(i);
+            
+            if (outFileWrite(&outFile, buf, n) != n)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes block at offset 0x%016lX to benchmark file! (0x%08X)", __func__, n, off, outFile.lastResult);
+                breaks++;
+                success = false;
+                break;
+            }
+        }
+        
+        if (!outFileClose(&outFile)) success = false;
+        
+        if (success) speeds[i] = benchmarkGetSpeed(BENCHMARK_DATA_SIZE, startTick);
+        
+        remove(BENCHMARK_FILE_PATH);
+    }
+    
+    return success;
+}
+
+void benchmarkDumpBlockSizes()
+{
+    u8 *buf = NULL;
+    u32 i;
+    u32 speeds[DUMP_BLOCK_SIZE_CNT];
+    blockSizeOptions *cfg = &(dumpCfg.blockSizeCfg);
+    
+    buf = malloc(DUMP_BLOCK_SIZE(DUMP_BLOCK_SIZE_CNT - 1));
+    if (!buf)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for the benchmark buffer!", __func__);
+        return;
+    }
+    
+    // Some SD cards handle blocks filled with zeroes a lot faster than actual dump data
+    for(i = 0; i < (u32)DUMP_BLOCK_SIZE(DUMP_BLOCK_SIZE_CNT - 1); i++) buf[i] = (u8)(rand() & 0xFF);
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Measuring dump throughput with %lu MiB of data per block size. Please wait.", (u64)(BENCHMARK_DATA_SIZE / MiB));
+    uiRefreshDisplay();
+    breaks += 2;
+    
+    memset(speeds, 0, sizeof(speeds));
+    if (benchmarkGameCardRead(buf, speeds)) memcpy(cfg->readSpeed[DUMP_BLOCK_SOURCE_GAMECARD], speeds, sizeof(speeds));
+    benchmarkPrintResults(benchmarkSourceNames[DUMP_BLOCK_SOURCE_GAMECARD], cfg->readSpeed[DUMP_BLOCK_SOURCE_GAMECARD]);
+    
+    memset(speeds, 0, sizeof(speeds));
+    if (benchmarkNcaRead(NcmStorageId_SdCard, DUMP_BLOCK_SOURCE_SDCARD, buf, speeds)) memcpy(cfg->readSpeed[DUMP_BLOCK_SOURCE_SDCARD], speeds, sizeof(speeds));
+    benchmarkPrintResults(benchmarkSourceNames[DUMP_BLOCK_SOURCE_SDCARD], cfg->readSpeed[DUMP_BLOCK_SOURCE_SDCARD]);
+    
+    memset(speeds, 0, sizeof(speeds));
+    if (benchmarkNcaRead(NcmStorageId_BuiltInUser, DUMP_BLOCK_SOURCE_EMMC, buf, speeds)) memcpy(cfg->readSpeed[DUMP_BLOCK_SOURCE_EMMC], speeds, sizeof(speeds));
+    benchmarkPrintResults(benchmarkSourceNames[DUMP_BLOCK_SOURCE_EMMC], cfg->readSpeed[DUMP_BLOCK_SOURCE_EMMC]);
+    
+    benchmarkHash(buf, false, cfg->crc32Speed);
+    benchmarkPrintResults("CRC32 calculation", cfg->crc32Speed);
+    
+    benchmarkHash(buf, true, cfg->sha256Speed);
+    benchmarkPrintResults("SHA-256 calculation", cfg->sha256Speed);
+    
+    memset(speeds, 0, sizeof(speeds));
+    if (benchmarkSdCardWrite(buf, speeds)) memcpy(cfg->sdCardWriteSpeed, speeds, sizeof(speeds));
+    benchmarkPrintResults("SD card write", cfg->sdCardWriteSpeed);
+    
+    free(buf);
+    
+    saveConfig();
+    
+    u64 xciBlockSize = benchmarkGetDumpBlockSize(DUMP_BLOCK_SOURCE_GAMECARD, BENCHMARK_STAGE_CRC32 | BENCHMARK_STAGE_SDCARD);
+    u64 sdCardNspBlockSize = benchmarkGetDumpBlockSize(DUMP_BLOCK_SOURCE_SDCARD, BENCHMARK_STAGE_SHA256 | BENCHMARK_STAGE_SDCARD);
+    u64 emmcNspBlockSize = benchmarkGetDumpBlockSize(DUMP_BLOCK_SOURCE_EMMC, BENCHMARK_STAGE_SHA256 | BENCHMARK_STAGE_SDCARD);
+    
+    breaks++;
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Benchmark results saved. Block sizes: %lu MiB (XCI), %lu MiB (SD card NSP), %lu MiB (eMMC NSP).", (u64)(xciBlockSize / MiB), (u64)(sdCardNspBlockSize / MiB), (u64)(emmcNspBlockSize / MiB));
+    breaks += 2;
+}
+
+u64 benchmarkGetDumpBlockSize(dumpBlockSource source, u8 stages)
+{
+    if (source >= DUMP_BLOCK_SOURCE_CNT) return DUMP_BUFFER_SIZE;
+    
+    blockSizeOptions *cfg = &(dumpCfg.blockSizeCfg);
+    u32 i, speed, bestSpeed = 0, bestIdx = DUMP_BLOCK_SIZE_CNT;
+    
+    // The applet heap is way too small for the bigger pipeline buffers
+    u32 blockSizeCnt = (appletModeCheck() ? DUMP_BLOCK_SIZE_APPLET_CNT : DUMP_BLOCK_SIZE_CNT);
+    
+    for(i = 0; i < blockSizeCnt; i++)
+    {
+        // The pipeline can't be faster than its slowest stage
+        // Stages that weren't measured leave this at zero
+        speed = cfg->readSpeed[source][i];
+        if ((stages & BENCHMARK_STAGE_CRC32) && cfg->crc32Speed[i] < speed) speed = cfg->crc32Speed[i];
+        if ((stages & BENCHMARK_STAGE_SHA256) && cfg->sha256Speed[i] < speed) speed = cfg->sha256Speed[i];
+        if ((stages & BENCHMARK_STAGE_SDCARD) && cfg->sdCardWriteSpeed[i] < speed) speed = cfg->sdCardWriteSpeed[i];
+        
+        if (speed > (bestSpeed + (bestSpeed / BENCHMARK_MIN_GAIN)))
+        {
+            bestSpeed = speed;
+            bestIdx = i;
+        }
+    }
+    
+    return (bestIdx < DUMP_BLOCK_SIZE_CNT ? DUMP_BLOCK_SIZE(bestIdx) : DUMP_BUFFER_SIZE);
+}
+
+static void benchmarkCoreAdd(benchmark_core_result_t *res, u64 startTick, u64 bytes)
+{
+    res->ticks += (armGetSystemTick() - startTick);
+    res->bytes += bytes;
+    res->calls++;
+}
+
+static void benchmarkCorePrintResult(benchmarkCorePath path, const benchmark_core_result_t *res)
+{
+    if (!res->ticks || !res->calls)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%s: skipped.", benchmarkCorePathLabels[path]);
+    } else {
+        double sec = ((double)armTicksToNs(res->ticks) / 1000000000.0);
+        double usPerCall = (((double)armTicksToNs(res->ticks) / 1000.0) / (double)res->calls);
+        
+        if (res->bytes)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%s: %.2lf MiB/s | %.2lf us per call (%lu calls).", benchmarkCorePathLabels[path], ((double)res->bytes / MiB) / sec, usPerCall, res->calls);
+        } else {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%s: %.2lf us per call (%lu calls).", benchmarkCorePathLabels[path], usPerCall, res->calls);
+        }
+    }
+    
+    uiRefreshDisplay();
+    breaks++;
+}
+
+static void benchmarkCoreSaveResults(const benchmark_core_result_t *results)
+{
+    u32 i;
+    u64 now = 0;
+    struct tm ts;
+    char timestamp[32] = {'\0'};
+    
+    FILE *logFile = fopen(BENCHMARK_CORE_LOG_PATH, "a");
+    if (!logFile) return;
+    
+    // Write the CSV header if we just created the file
+    fseek(logFile, 0, SEEK_END);
+    if (!ftell(logFile)) fprintf(logFile, BENCHMARK_CORE_LOG_HEADER "\n");
+    
+    timeGetCurrentTime(TimeType_LocalSystemClock, &now);
+    
+    time_t nowTime = (time_t)now;
+    gmtime_r(&nowTime, &ts);
+    strftime(timestamp, MAX_ELEMENTS(timestamp), "%Y-%m-%d %H:%M:%S", &ts);
+    
+    for(i = 0; i < BENCHMARK_CORE_CNT; i++)
+    {
+        const benchmark_core_result_t *res = &(results[i]);
+        if (!res->ticks || !res->calls) continue;
+        
+        double ms = ((double)armTicksToNs(res->ticks) / 1000000.0);
+        
+        fprintf(logFile, "%s,%s,%lu,%lu,%.3lf,%.2lf,%.3lf\n", timestamp, benchmarkCorePathNames[i], res->calls, res->bytes, ms, (res->bytes ? (((double)res->bytes / MiB) / (ms / 1000.0)) : 0.0), ((ms * 1000.0) / (double)res->calls));
+    }
+    
+    fclose(logFile);
+}
+
+static void benchmarkCoreCompute(u8 *buf, benchmark_core_result_t *results)
+{
+    u32 j, crc = 0;
+    u64 off, ofs, startTick;
+    u8 hash[SHA256_HASH_SIZE], key[0x20], ctr[0x10];
+    Sha256Context sha256Ctx;
+    Aes128CtrContext ctrCtx;
+    Aes128XtsContext xtsCtx;
+    
+    // Keys don't change the throughput, and these paths must work without a keys file
+    memset(key, 0x5A, sizeof(key));
+    memset(ctr, 0, sizeof(ctr));
+    
+    for(off = 0; off < BENCHMARK_DATA_SIZE; off += BENCHMARK_CORE_BLOCK_SIZE)
+    {
+        startTick = armGetSystemTick();
+        crc32(buf, BENCHMARK_CORE_BLOCK_SIZE, &crc);
+        benchmarkCoreAdd(&(results[BENCHMARK_CORE_CRC32]), startTick, BENCHMARK_CORE_BLOCK_SIZE);
+    }
+    
+    sha256ContextCreate(&sha256Ctx);
+    
+    for(off = 0; off < BENCHMARK_DATA_SIZE; off += BENCHMARK_CORE_BLOCK_SIZE)
+    {
+        startTick = armGetSystemTick();
+        sha256ContextUpdate(&sha256Ctx, buf, BENCHMARK_CORE_BLOCK_SIZE);
+        benchmarkCoreAdd(&(results[BENCHMARK_CORE_SHA256]), startTick, BENCHMARK_CORE_BLOCK_SIZE);
+    }
+    
+    sha256ContextGetHash(&sha256Ctx, hash);
+    
+    // Same calls used to process aligned NCA section data, with the counter set up for every block
+    aes128CtrContextCreate(&ctrCtx, key, ctr);
+    
+    for(off = 0; off < BENCHMARK_DATA_SIZE; off += BENCHMARK_CORE_BLOCK_SIZE)
+    {
+        startTick = armGetSystemTick();
+        
+        ofs = (off >> 4);
+        for(j = 0; j < 0x8; j++)
+        {
+            ctr[0x10 - j - 1] = (u8)(ofs & 0xFF);
+            ofs >>= 8;
+        }
+        
+        aes128CtrContextResetCtr(&ctrCtx, ctr);
+        aes128CtrCrypt(&ctrCtx, buf, buf, BENCHMARK_CORE_BLOCK_SIZE);
+        
+        benchmarkCoreAdd(&(results[BENCHMARK_CORE_AES_CTR]), startTick, BENCHMARK_CORE_BLOCK_SIZE);
+    }
+    
+    aes128XtsContextCreate(&xtsCtx, key, key + 0x10, false);
+    
+    for(off = 0; (off + NCA_FULL_HEADER_LENGTH) <= BENCHMARK_CORE_BLOCK_SIZE; off += NCA_FULL_HEADER_LENGTH)
+    {
+        startTick = armGetSystemTick();
+        aes128XtsNintendoCrypt(&xtsCtx, buf + off, buf + off, NCA_FULL_HEADER_LENGTH, 0, false);
+        benchmarkCoreAdd(&(results[BENCHMARK_CORE_AES_XTS]), startTick, NCA_FULL_HEADER_LENGTH);
+    }
+}
+
+static void benchmarkCoreNca(NcmStorageId storageId, u8 *buf, benchmark_core_result_t *results)
+{
+    Result result;
+    NcmContentStorage ncmStorage;
+    NcmContentId contentId;
+    s64 contentSize = 0;
+    u64 off, n, totalSize, startTick;
+    
+    memset(&ncmStorage, 0, sizeof(NcmContentStorage));
+    memset(&contentId, 0, sizeof(NcmContentId));
+    
+    result = ncmOpenContentStorage(&ncmStorage, storageId);
+    if (R_FAILED(result)) return;
+    
+    contentSize = benchmarkGetBiggestNca(&ncmStorage, &contentId);
+    if (!contentSize) goto out;
+    
+    totalSize = ((u64)contentSize < BENCHMARK_DATA_SIZE ? (u64)contentSize : BENCHMARK_DATA_SIZE);
+    
+    for(off = 0; off < totalSize; off += n)
+    {
+        n = ((totalSize - off) < BENCHMARK_CORE_BLOCK_SIZE ? (totalSize - off) : BENCHMARK_CORE_BLOCK_SIZE);
+        
+        startTick = armGetSystemTick();
+        if (!readNcaDataByContentId(&ncmStorage, &contentId, off, buf, n)) break;
+        benchmarkCoreAdd(&(results[BENCHMARK_CORE_NCA_READ]), startTick, n);
+    }
+    
+out:
+    ncmContentStorageClose(&ncmStorage);
+}
+
+// Updates are preferred, since they also let us measure BKTR reads. Gamecard titles are skipped, the gamecard benchmark already covers IStorage reads
+static bool benchmarkCoreFindTitle(u32 *outIndex, bool *outUsePatch)
+{
+    u32 i;
+    
+    for(i = 0; patchEntries && i < titlePatchCount; i++)
+    {
+        if (patchEntries[i].storageId == NcmStorageId_GameCard) continue;
+        
+        *outIndex = i;
+        *outUsePatch = true;
+        return true;
+    }
+    
+    for(i = 0; baseAppEntries && i < titleAppCount; i++)
+    {
+        if (baseAppEntries[i].storageId == NcmStorageId_GameCard) continue;
+        
+        *outIndex = i;
+        *outUsePatch = false;
+        return true;
+    }
+    
+    return false;
+}
+
+static void benchmarkCoreNcaHeader(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, benchmark_core_result_t *results)
+{
+    u32 i;
+    u64 startTick;
+    u8 ncaHeader[NCA_FULL_HEADER_LENGTH] = {0}, decryptedNcaKeys[NCA_KEY_AREA_SIZE];
+    nca_header_t decNcaHeader;
+    
+    if (!readNcaDataByContentId(ncmStorage, ncaId, 0, ncaHeader, NCA_FULL_HEADER_LENGTH)) return;
+    
+    // No content ID, so the NCA metadata cache doesn't hide the AES-XTS pass and the key area decryption
+    for(i = 0; i < BENCHMARK_CORE_HEADER_CALLS; i++)
+    {
+        startTick = armGetSystemTick();
+        if (!decryptNcaHeader(ncaHeader, NCA_FULL_HEADER_LENGTH, NULL, &decNcaHeader, NULL, decryptedNcaKeys, false)) break;
+        benchmarkCoreAdd(&(results[BENCHMARK_CORE_NCA_HEADER]), startTick, NCA_FULL_HEADER_LENGTH);
+    }
+}
+
+static void benchmarkCoreRomFs(u32 titleIndex, bool usePatch, u8 *buf, benchmark_core_result_t *results)
+{
+    u64 off, n, totalSize, startTick;
+    
+    // The base application RomFS may have been loaded even if the update BKTR section couldn't be parsed
+    if (readNcaRomFsSection(titleIndex, (usePatch ? ROMFS_TYPE_PATCH : ROMFS_TYPE_APP), 0) != 0) goto out;
+    
+    benchmarkCoreNcaHeader((usePatch ? &(bktrContext.ncmStorage) : &(romFsContext.ncmStorage)), (usePatch ? &(bktrContext.ncaId) : &(romFsContext.ncaId)), results);
+    
+    // Base application RomFS, or the one from the selected base application
+    if (!usePatch || bktrContext.use_base_romfs)
+    {
+        totalSize = (romFsContext.romfs_size < BENCHMARK_DATA_SIZE ? romFsContext.romfs_size : BENCHMARK_DATA_SIZE);
+        
+        for(off = 0; off < totalSize; off += n)
+        {
+            n = ((totalSize - off) < BENCHMARK_CORE_BLOCK_SIZE ? (totalSize - off) : BENCHMARK_CORE_BLOCK_SIZE);
+            
+            startTick = armGetSystemTick();
+            if (!processNcaCtrSectionBlock(&(romFsContext.ncmStorage), &(romFsContext.ncaId), &(romFsContext.aes_ctx), romFsContext.romfs_offset + off, buf, n, false)) break;
+            benchmarkCoreAdd(&(results[BENCHMARK_CORE_NCA_SECTION]), startTick, n);
+        }
+    }
+    
+    if (usePatch)
+    {
+        totalSize = (bktrContext.romfs_size < BENCHMARK_DATA_SIZE ? bktrContext.romfs_size : BENCHMARK_DATA_SIZE);
+        
+        for(off = 0; off < totalSize; off += n)
+        {
+            n = ((totalSize - off) < BENCHMARK_CORE_BLOCK_SIZE ? (totalSize - off) : BENCHMARK_CORE_BLOCK_SIZE);
+            
+            startTick = armGetSystemTick();
+            if (!readBktrSectionBlock(bktrContext.romfs_offset + off, buf, n)) break;
+            benchmarkCoreAdd(&(results[BENCHMARK_CORE_BKTR_READ]), startTick, n);
+        }
+    }
+    
+out:
+    if (usePatch) freeBktrContext();
+    
+    freeRomFsContext();
+}
+
+static void benchmarkCoreExeFs(u32 titleIndex, bool usePatch, benchmark_core_result_t *results)
+{
+    u32 i;
+    u64 startTick, nsoOffset;
+    nso_header_t nsoHeader;
+    char *programInfoXml = NULL;
+    
+    // Same buffer size used to generate the real "programinfo.xml"
+    programInfoXml = malloc(NSP_XML_BUFFER_SIZE);
+    if (!programInfoXml)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for the middleware list buffer!", __func__);
+        breaks++;
+        return;
+    }
+    
+    if (!readNcaExeFsSection(titleIndex, usePatch)) goto out;
+    
+    for(i = 0; i < exeFsContext.exefs_header.file_cnt; i++)
+    {
+        nsoOffset = (exeFsContext.exefs_data_offset + exeFsContext.exefs_entries[i].file_offset);
+        
+        if (!processNcaCtrSectionBlock(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), nsoOffset, &nsoHeader, sizeof(nso_header_t), false)) break;
+        if (__builtin_bswap32(nsoHeader.magic) != NSO_MAGIC) continue;
+        
+        programInfoXml[0] = '\0';
+        
+        // Reads, decrypts and decompresses the .rodata section before scanning it, just like "programinfo.xml" generation
+        startTick = armGetSystemTick();
+        if (!retrieveMiddlewareListFromNso(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), exeFsContext.exefs_str_table + exeFsContext.exefs_entries[i].filename_offset, nsoOffset, &nsoHeader, programInfoXml)) break;
+        benchmarkCoreAdd(&(results[BENCHMARK_CORE_NSO_SCAN]), startTick, exeFsContext.exefs_entries[i].file_size);
+    }
+    
+    freeExeFsContext();
+    
+out:
+    free(programInfoXml);
+}
+
+// Runs the real NCA entry points on an installed title, just like the title dumpers and browsers do
+static void benchmarkCoreTitle(u8 *buf, benchmark_core_result_t *results)
+{
+    u32 titleIndex = 0;
+    bool usePatch = false;
+    
+    if (!keysFileAvailable)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Keys file not available. NCA header, section, BKTR and NSO paths will be skipped.");
+        uiRefreshDisplay();
+        breaks += 2;
+        return;
+    }
+    
+    if (!benchmarkCoreFindTitle(&titleIndex, &usePatch))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "No SD card / eMMC titles available. NCA header, section, BKTR and NSO paths will be skipped.");
+        uiRefreshDisplay();
+        breaks += 2;
+        return;
+    }
+    
+    benchmarkCoreRomFs(titleIndex, usePatch, buf, results);
+    
+    benchmarkCoreExeFs(titleIndex, usePatch, results);
+    
+    breaks++;
+}
+
+static void benchmarkCoreSave(u8 *buf, benchmark_core_result_t *results)
+{
+    FRESULT fr = FR_OK;
+    FIL *saveFile = NULL;
+    save_ctx_t *saveCtx = NULL;
+    allocation_table_storage_ctx_t fatStorage;
+    save_fs_list_entry_t entry;
+    const char ticketBinPath[SAVE_FS_LIST_MAX_NAME_LENGTH] = "/ticket.bin";
+    u32 br = 0, bufSize = (ETICKET_ENTRY_SIZE * 0x10);
+    u64 off, totalSize, startTick;
+    bool openSave = false, initSaveCtx = false;
+    
+    saveFile = calloc(1, sizeof(save_file_t));
+    saveCtx = calloc(1, sizeof(save_ctx_t));
+    if (!saveFile || !saveCtx) goto out;
+    
+    fr = f_open(saveFile, BIS_COMMON_TIK_SAVE_NAME, FA_READ | FA_OPEN_EXISTING);
+    if (fr) goto out;
+    
+    openSave = true;
+    
+    save_enable_fast_seek(saveFile);
+    
+    saveCtx->file = saveFile;
+    saveCtx->tool_ctx.action = 0;
+    
+    startTick = armGetSystemTick();
+    initSaveCtx = save_process(saveCtx);
+    if (!initSaveCtx) goto out;
+    benchmarkCoreAdd(&(results[BENCHMARK_CORE_SAVE_PROCESS]), startTick, 0);
+    
+    if (!save_hierarchical_file_table_get_file_entry_by_path(&saveCtx->save_filesystem_core.file_table, ticketBinPath, &entry) || !save_open_fat_storage(&saveCtx->save_filesystem_core, &fatStorage, entry.value.save_file_info.start_block)) goto out;
+    
+    // Read the ticket list the same way the ES savefile ticket index does, but without parsing it
+    totalSize = (entry.value.save_file_info.length < BENCHMARK_DATA_SIZE ? entry.value.save_file_info.length : BENCHMARK_DATA_SIZE);
+    totalSize -= (totalSize % bufSize);
+    
+    for(off = 0; off < totalSize; off += bufSize)
+    {
+        startTick = armGetSystemTick();
+        br = save_allocation_table_storage_read(&fatStorage, buf, off, bufSize);
+        if (br != bufSize) break;
+        benchmarkCoreAdd(&(results[BENCHMARK_CORE_SAVE_FAT_READ]), startTick, br);
+    }
+    
+out:
+    if (saveCtx)
+    {
+        if (initSaveCtx) save_free_contexts(saveCtx);
+        free(saveCtx);
+    }
+    
+    if (saveFile)
+    {
+        if (openSave) f_close(saveFile);
+        free(saveFile);
+    }
+}
+
+void benchmarkCorePaths()
+{
+    u8 *buf = NULL;
+    u32 i;
+    benchmark_core_result_t results[BENCHMARK_CORE_CNT];
+    
+    memset(results, 0, sizeof(results));
+    
+    buf = malloc(BENCHMARK_CORE_BLOCK_SIZE);
+    if (!buf)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for the benchmark buffer!", __func__);
+        return;
+    }
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Measuring parser and crypto throughput with up to %lu MiB of data per path. Please wait.", (u64)(BENCHMARK_DATA_SIZE / MiB));
+    uiRefreshDisplay();
+    breaks += 2;
+    
+    // Compute paths run over real NCA data, if there's any
+    memset(buf, 0, BENCHMARK_CORE_BLOCK_SIZE);
+    benchmarkCoreNca(NcmStorageId_SdCard, buf, results);
+    if (!results[BENCHMARK_CORE_NCA_READ].calls) benchmarkCoreNca(NcmStorageId_BuiltInUser, buf, results);
+    
+    benchmarkCoreTitle(buf, results);
+    
+    benchmarkCoreCompute(buf, results);
+    
+    benchmarkCoreSave(buf, results);
+    
+    free(buf);
+    
+    for(i = 0; i < BENCHMARK_CORE_CNT; i++) benchmarkCorePrintResult((benchmarkCorePath)i, &(results[i]));
+    
+    benchmarkCoreSaveResults(results);
+    
+    breaks++;
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Results appended to \"%s\".", BENCHMARK_CORE_LOG_PATH);
+    breaks += 2;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#include <switch.h>
+#include "util.h"
+
+#define BENCHMARK_DATA_SIZE         (u64)0x2000000                              // 32 MiB (33554432 bytes) processed per block size and stage
+#define BENCHMARK_MAX_CONTENT_IDS   0x200
+#define BENCHMARK_FILE_PATH         APP_BASE_PATH "benchmark.bin"
+
+#define BENCHMARK_MIN_GAIN          50                                          // Bigger blocks must be at least 1/50 (2%) faster to be worth the extra memory
+
+#define BENCHMARK_CORE_LOG_PATH     APP_BASE_PATH "corebench.csv"
+#define BENCHMARK_CORE_LOG_HEADER   "timestamp,path,calls,bytes,elapsed_ms,mib_per_s,us_per_call"
+#define BENCHMARK_CORE_BLOCK_SIZE   DUMP_BUFFER_SIZE                            // Bytes processed per call by the bulk data paths, same as regular dumps
+#define BENCHMARK_CORE_HEADER_CALLS 0x40                                        // decryptNcaHeader() calls
+
+#define BENCHMARK_STAGE_CRC32       BIT(0)
+#define BENCHMARK_STAGE_SHA256      BIT(1)
+#define BENCHMARK_STAGE_SDCARD      BIT(2)                                      // SD card output
+
+typedef enum {
+    BENCHMARK_CORE_CRC32 = 0,                                                   // crc32_fast.c
+    BENCHMARK_CORE_SHA256,
+    BENCHMARK_CORE_AES_CTR,                                                     // Raw AES-128-CTR, dummy key
+    BENCHMARK_CORE_AES_XTS,                                                     // Raw AES-128-XTS with the NCA header tweak, dummy key, one call per header
+    BENCHMARK_CORE_NCA_READ,                                                    // readNcaDataByContentId(), through the NCA cache
+    BENCHMARK_CORE_NCA_HEADER,                                                  // decryptNcaHeader() without the NCA metadata cache, one call per header
+    BENCHMARK_CORE_NCA_SECTION,                                                 // processNcaCtrSectionBlock() over a RomFS section
+    BENCHMARK_CORE_BKTR_READ,                                                   // readBktrSectionBlock() over an update RomFS
+    BENCHMARK_CORE_NSO_SCAN,                                                    // retrieveMiddlewareListFromNso(), one call per NSO from the ExeFS section
+    BENCHMARK_CORE_SAVE_PROCESS,                                                // ES savefile header, remap and IVFC processing
+    BENCHMARK_CORE_SAVE_FAT_READ,                                               // ES savefile allocation table storage reads
+    BENCHMARK_CORE_CNT
+} benchmarkCorePath;
+
+typedef struct {
+    u64 calls;
+    u64 bytes;
+    u64 ticks;                                                                  // Zero if the path was skipped
+} benchmark_core_result_t;
+
+/* Measures the read (gamecard IStorage, SD card and eMMC NCAs), CRC32 / SHA-256 and SD card write throughput for every dump block size. */
+/* The results are saved to the configuration file. Sources that aren't available (e.g. no gamecard inserted) keep their previous results. */
+void benchmarkDumpBlockSizes();
+
+/* Returns the benchmarked block size with the best throughput for the whole dump pipeline (the slowest of the read stage and the provided BENCHMARK_STAGE_* flags). */
+/* Falls back to DUMP_BUFFER_SIZE if the needed stages haven't been benchmarked yet. */
+u64 benchmarkGetDumpBlockSize(dumpBlockSource source, u8 stages);
+
+/* Measures the throughput and per-call latency of the parser and crypto code used by every dump, using data from the biggest installed NCA and the ES common ticket savefile. */
+/* If the keys file is available, the NCA header, section, BKTR and NSO parsers are also measured on an installed SD card / eMMC title (an update, if there's one). */
+/* Results are appended to BENCHMARK_CORE_LOG_PATH, so runs from different builds can be compared. */
+void benchmarkCorePaths();
+
+#endif
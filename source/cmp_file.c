@@ -0,0 +1,663 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "cmp_file.h"
+#include "dumper.h"
+#include "lz4.h"
+
+// The main thread and the dump pipeline workers are spread over these cores as well, so compression threads run one priority level below them
+static const int cmpFileWorkerCores[] = { 0, 1, 2 };
+
+static int cmpFileRegionCmp(const void *a, const void *b)
+{
+    u64 offsetA = ((const cmp_file_crypto_region*)a)->offset;
+    u64 offsetB = ((const cmp_file_crypto_region*)b)->offset;
+    
+    return (offsetA < offsetB ? -1 : (offsetA > offsetB ? 1 : 0));
+}
+
+// Applies the AES-CTR keystream to the parts of a stream chunk covered by the crypto regions. The same call decrypts and encrypts
+static void cmpFileCryptRegions(const cmp_file_crypto_region *regions, u32 regionCnt, u64 offset, u8 *buf, u64 size)
+{
+    u32 i, j;
+    u64 start, end, ctrOffset, ofs;
+    u8 ctr[0x10], skip[0x10] = {0};
+    Aes128CtrContext aes_ctx;
+    
+    for(i = 0; i < regionCnt; i++)
+    {
+        const cmp_file_crypto_region *region = &(regions[i]);
+        
+        if (region->offset >= (offset + size)) break;
+        if ((region->offset + region->size) <= offset) continue;
+        
+        start = (region->offset > offset ? region->offset : offset);
+        end = ((region->offset + region->size) < (offset + size) ? (region->offset + region->size) : (offset + size));
+        ctrOffset = (region->ctr_offset + (start - region->offset));
+        
+        memcpy(ctr, region->ctr, 0x8);
+        ofs = (ctrOffset >> 4);
+        
+        for(j = 0; j < 0x8; j++)
+        {
+            ctr[0x10 - j - 1] = (u8)(ofs & 0xFF);
+            ofs >>= 8;
+        }
+        
+        aes128CtrContextCreate(&aes_ctx, region->key, ctr);
+        
+        // Throw away the keystream bytes that precede an unaligned start offset
+        if (ctrOffset & 0xF) aes128CtrCrypt(&aes_ctx, skip, skip, ctrOffset & 0xF);
+        
+        aes128CtrCrypt(&aes_ctx, buf + (start - offset), buf + (start - offset), end - start);
+    }
+}
+
+static void cmpFileGetPartPath(cmp_file_t *ctx, u32 partIndex, char *outPath)
+{
+    if (ctx->split)
+    {
+        snprintf(outPath, NAME_BUF_LEN, "%s/%02u", ctx->path, partIndex);
+    } else {
+        snprintf(outPath, NAME_BUF_LEN, "%s", ctx->path);
+    }
+}
+
+static bool cmpFileOpenPart(cmp_file_t *ctx, u32 partIndex)
+{
+    char partPath[NAME_BUF_LEN] = {'\0'};
+    u64 allocSize = ctx->maxSize;
+    
+    if (ctx->split)
+    {
+        // The actual part size is unknown until the blocks are compressed, so just preallocate the worst case - outFileClose() gets rid of the rest
+        u64 partOffset = ((u64)partIndex * SPLIT_FILE_NSP_PART_SIZE);
+        allocSize = (partOffset < ctx->maxSize ? ((ctx->maxSize - partOffset) < SPLIT_FILE_NSP_PART_SIZE ? (ctx->maxSize - partOffset) : SPLIT_FILE_NSP_PART_SIZE) : 0);
+    }
+    
+    cmpFileGetPartPath(ctx, partIndex, partPath);
+    ctx->partIndex = partIndex;
+    
+    return outFileCreate(&(ctx->out), partPath, allocSize);
+}
+
+// Appends data to the output file, moving on to the next part file if needed
+static bool cmpFileOutputWrite(cmp_file_t *ctx, const void *buf, u64 size)
+{
+    const u8 *data = (const u8*)buf;
+    u64 chunk;
+    
+    while(size)
+    {
+        chunk = size;
+        
+        if (ctx->split)
+        {
+            u64 partEnd = ((u64)(ctx->partIndex + 1) * SPLIT_FILE_NSP_PART_SIZE);
+            
+            // Part files are only created once there's data to write to them
+            if (ctx->outOffset == partEnd)
+            {
+                outFileClose(&(ctx->out));
+                if (!cmpFileOpenPart(ctx, ctx->partIndex + 1)) return false;
+                partEnd += SPLIT_FILE_NSP_PART_SIZE;
+            }
+            
+            if (chunk > (partEnd - ctx->outOffset)) chunk = (partEnd - ctx->outOffset);
+        }
+        
+        if (outFileWrite(&(ctx->out), data, chunk) != chunk) return false;
+        
+        ctx->outOffset += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+    
+    return true;
+}
+
+static void cmpFileWorkerThreadFunc(void *arg)
+{
+    cmp_file_t *ctx = (cmp_file_t*)arg;
+    cmp_file_job_t *job = NULL;
+    u32 i;
+    int res;
+    
+    while(true)
+    {
+        mutexLock(&(ctx->mutex));
+        
+        // Pick the oldest block waiting to be compressed
+        while(true)
+        {
+            job = NULL;
+            if (ctx->stop) break;
+            
+            for(i = 0; i < CMP_FILE_JOB_CNT; i++)
+            {
+                cmp_file_job_t *cur = &(ctx->jobs[(ctx->tail + i) % CMP_FILE_JOB_CNT]);
+                if (cur->state == CMP_FILE_JOB_PENDING)
+                {
+                    job = cur;
+                    break;
+                }
+            }
+            
+            if (job) break;
+            
+            condvarWait(&(ctx->cond), &(ctx->mutex));
+        }
+        
+        if (job) job->state = CMP_FILE_JOB_BUSY;
+        
+        mutexUnlock(&(ctx->mutex));
+        
+        if (!job) break;
+        
+        if (ctx->header.region_cnt) cmpFileCryptRegions(ctx->regions, ctx->header.region_cnt, ctx->header.raw_prefix_size + ((u64)job->blockIndex * ctx->header.block_size), job->in, job->inSize);
+        
+        // Blocks that don't get any smaller (e.g. already compressed data) are stored as they are, so the output buffer never needs to be bigger than the input block
+        res = LZ4_compress_default((const char*)job->in, (char*)job->out, (int)job->inSize, (int)job->inSize - 1);
+        if (res > 0)
+        {
+            job->outSize = (u32)res;
+            job->flags = 0;
+        } else {
+            job->outSize = job->inSize;
+            job->flags = CMP_FILE_BLOCK_FLAG_RAW;
+        }
+        
+        mutexLock(&(ctx->mutex));
+        job->state = CMP_FILE_JOB_DONE;
+        condvarWakeAll(&(ctx->cond));
+        mutexUnlock(&(ctx->mutex));
+    }
+}
+
+static bool cmpFileStartWorker(cmp_file_t *ctx)
+{
+    Result result;
+    s32 prio = 0x2C;
+    int cpuid = cmpFileWorkerCores[ctx->worker_cnt % MAX_ELEMENTS(cmpFileWorkerCores)];
+    Thread *thread = &(ctx->workers[ctx->worker_cnt]);
+    
+    svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+    if (prio < 0x3F) prio++;
+    
+    result = threadCreate(thread, cmpFileWorkerThreadFunc, ctx, NULL, CMP_FILE_WORKER_STACK_SIZE, prio, cpuid);
+    
+    // Fallback to the default core if the desired one isn't available to us (e.g. applet mode)
+    if (R_FAILED(result)) result = threadCreate(thread, cmpFileWorkerThreadFunc, ctx, NULL, CMP_FILE_WORKER_STACK_SIZE, prio, -2);
+    if (R_FAILED(result)) return false;
+    
+    result = threadStart(thread);
+    if (R_FAILED(result))
+    {
+        threadClose(thread);
+        return false;
+    }
+    
+    ctx->worker_cnt++;
+    
+    return true;
+}
+
+static u8 cmpFileGetJobState(cmp_file_t *ctx, u32 index)
+{
+    u8 state;
+    
+    mutexLock(&(ctx->mutex));
+    state = ctx->jobs[index].state;
+    mutexUnlock(&(ctx->mutex));
+    
+    return state;
+}
+
+static void cmpFileSubmitJob(cmp_file_t *ctx)
+{
+    cmp_file_job_t *job = &(ctx->jobs[ctx->head]);
+    
+    job->blockIndex = ctx->header.block_cnt++;
+    
+    mutexLock(&(ctx->mutex));
+    
+    job->state = CMP_FILE_JOB_PENDING;
+    ctx->head = ((ctx->head + 1) % CMP_FILE_JOB_CNT);
+    
+    condvarWakeAll(&(ctx->cond));
+    
+    mutexUnlock(&(ctx->mutex));
+}
+
+// Waits until the oldest block has been compressed and writes it to the output file
+static bool cmpFileFlushJob(cmp_file_t *ctx)
+{
+    cmp_file_job_t *job = &(ctx->jobs[ctx->tail]);
+    
+    mutexLock(&(ctx->mutex));
+    while(job->state != CMP_FILE_JOB_DONE) condvarWait(&(ctx->cond), &(ctx->mutex));
+    mutexUnlock(&(ctx->mutex));
+    
+    cmp_file_block_entry *entry = &(ctx->table[job->blockIndex]);
+    
+    entry->offset = ctx->outOffset;
+    entry->size = job->outSize;
+    entry->flags = job->flags;
+    
+    if (!cmpFileOutputWrite(ctx, ((job->flags & CMP_FILE_BLOCK_FLAG_RAW) ? job->in : job->out), job->outSize)) return false;
+    
+    mutexLock(&(ctx->mutex));
+    
+    job->inSize = 0;
+    job->state = CMP_FILE_JOB_FREE;
+    ctx->tail = ((ctx->tail + 1) % CMP_FILE_JOB_CNT);
+    
+    mutexUnlock(&(ctx->mutex));
+    
+    return true;
+}
+
+static void cmpFileFree(cmp_file_t *ctx)
+{
+    u32 i;
+    
+    mutexLock(&(ctx->mutex));
+    ctx->stop = true;
+    condvarWakeAll(&(ctx->cond));
+    mutexUnlock(&(ctx->mutex));
+    
+    for(i = 0; i < ctx->worker_cnt; i++)
+    {
+        threadWaitForExit(&(ctx->workers[i]));
+        threadClose(&(ctx->workers[i]));
+    }
+    
+    ctx->worker_cnt = 0;
+    
+    if (ctx->out.open) outFileClose(&(ctx->out));
+    
+    for(i = 0; i < CMP_FILE_JOB_CNT; i++)
+    {
+        if (ctx->jobs[i].in)
+        {
+            free(ctx->jobs[i].in);
+            ctx->jobs[i].in = NULL;
+        }
+        
+        if (ctx->jobs[i].out)
+        {
+            free(ctx->jobs[i].out);
+            ctx->jobs[i].out = NULL;
+        }
+    }
+    
+    if (ctx->prefix)
+    {
+        free(ctx->prefix);
+        ctx->prefix = NULL;
+    }
+    
+    if (ctx->table)
+    {
+        free(ctx->table);
+        ctx->table = NULL;
+    }
+    
+    if (ctx->regions)
+    {
+        free(ctx->regions);
+        ctx->regions = NULL;
+    }
+    
+    ctx->open = false;
+}
+
+bool cmpFileCreate(cmp_file_t *ctx, const char *path, u64 dataSize, u64 rawPrefixSize, const cmp_file_crypto_region *regions, u32 regionCnt, bool isFat32)
+{
+    if (!ctx || !path || !strlen(path) || rawPrefixSize > dataSize || (regionCnt && !regions)) return false;
+    
+    u32 i;
+    cmp_file_header emptyHeader;
+    u64 blockCnt = (((dataSize - rawPrefixSize) + (CMP_FILE_BLOCK_SIZE - 1)) / CMP_FILE_BLOCK_SIZE);
+    
+    memset(ctx, 0, sizeof(cmp_file_t));
+    memset(&emptyHeader, 0, sizeof(cmp_file_header));
+    
+    mutexInit(&(ctx->mutex));
+    condvarInit(&(ctx->cond));
+    
+    snprintf(ctx->path, MAX_CHARACTERS(ctx->path), "%s", path);
+    
+    ctx->dataSize = dataSize;
+    ctx->maxSize = (sizeof(cmp_file_header) + dataSize + (blockCnt * sizeof(cmp_file_block_entry)) + ((u64)regionCnt * sizeof(cmp_file_crypto_region)));
+    ctx->split = (isFat32 && ctx->maxSize > FAT32_FILESIZE_LIMIT);
+    
+    ctx->header.magic = CMP_FILE_MAGIC;
+    ctx->header.version = CMP_FILE_VERSION;
+    ctx->header.block_size = CMP_FILE_BLOCK_SIZE;
+    ctx->header.raw_prefix_size = rawPrefixSize;
+    
+    if (rawPrefixSize)
+    {
+        ctx->prefix = calloc(1, rawPrefixSize);
+        if (!ctx->prefix) goto out;
+    }
+    
+    if (blockCnt)
+    {
+        ctx->table = calloc(blockCnt, sizeof(cmp_file_block_entry));
+        if (!ctx->table) goto out;
+    }
+    
+    if (regionCnt)
+    {
+        for(i = 0; i < regionCnt; i++)
+        {
+            if (!regions[i].size || regions[i].offset < rawPrefixSize || (regions[i].offset + regions[i].size) > dataSize) goto out;
+        }
+        
+        ctx->regions = malloc((u64)regionCnt * sizeof(cmp_file_crypto_region));
+        if (!ctx->regions) goto out;
+        
+        memcpy(ctx->regions, regions, (u64)regionCnt * sizeof(cmp_file_crypto_region));
+        qsort(ctx->regions, regionCnt, sizeof(cmp_file_crypto_region), cmpFileRegionCmp);
+        
+        ctx->header.region_cnt = regionCnt;
+    }
+    
+    for(i = 0; i < CMP_FILE_JOB_CNT; i++)
+    {
+        ctx->jobs[i].in = malloc(CMP_FILE_BLOCK_SIZE);
+        ctx->jobs[i].out = malloc(CMP_FILE_BLOCK_SIZE);
+        if (!ctx->jobs[i].in || !ctx->jobs[i].out) goto out;
+    }
+    
+    if (ctx->split) mkdir(ctx->path, 0744);
+    
+    if (!cmpFileOpenPart(ctx, 0)) goto out;
+    
+    // Placeholder header and raw prefix, rewritten by cmpFileClose()
+    if (!cmpFileOutputWrite(ctx, &emptyHeader, sizeof(cmp_file_header)) || (rawPrefixSize && !cmpFileOutputWrite(ctx, ctx->prefix, rawPrefixSize))) goto out;
+    
+    for(i = 0; i < CMP_FILE_WORKER_CNT; i++)
+    {
+        if (!cmpFileStartWorker(ctx)) break;
+    }
+    
+    if (!ctx->worker_cnt) goto out;
+    
+    ctx->open = true;
+    
+out:
+    if (!ctx->open)
+    {
+        cmpFileFree(ctx);
+        
+        if (ctx->split)
+        {
+            fsdevDeleteDirectoryRecursively(ctx->path);
+        } else {
+            remove(ctx->path);
+        }
+    }
+    
+    return ctx->open;
+}
+
+bool cmpFileWrite(cmp_file_t *ctx, const void *buf, u64 size)
+{
+    if (!ctx || !ctx->open || !buf || !size || (ctx->dataOffset + size) > ctx->dataSize) return false;
+    
+    const u8 *data = (const u8*)buf;
+    u64 chunk;
+    
+    // The raw prefix is kept in memory until cmpFileClose()
+    if (ctx->dataOffset < ctx->header.raw_prefix_size)
+    {
+        chunk = (ctx->header.raw_prefix_size - ctx->dataOffset);
+        if (chunk > size) chunk = size;
+        
+        memcpy(ctx->prefix + ctx->dataOffset, data, chunk);
+        
+        ctx->dataOffset += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+    
+    while(size)
+    {
+        cmp_file_job_t *job = &(ctx->jobs[ctx->head]);
+        
+        // Every job is in use - wait for the oldest one to be written
+        // Only this thread sets jobs back to CMP_FILE_JOB_FREE, so there's no need to hold the lock for this check
+        if (job->state != CMP_FILE_JOB_FREE)
+        {
+            if (!cmpFileFlushJob(ctx)) return false;
+            continue;
+        }
+        
+        chunk = (CMP_FILE_BLOCK_SIZE - job->inSize);
+        if (chunk > size) chunk = size;
+        
+        memcpy(job->in + job->inSize, data, chunk);
+        
+        job->inSize += (u32)chunk;
+        ctx->dataOffset += chunk;
+        data += chunk;
+        size -= chunk;
+        
+        if (job->inSize == CMP_FILE_BLOCK_SIZE)
+        {
+            cmpFileSubmitJob(ctx);
+            
+            // Write whatever the worker threads have already finished without waiting for the rest
+            while(cmpFileGetJobState(ctx, ctx->tail) == CMP_FILE_JOB_DONE)
+            {
+                if (!cmpFileFlushJob(ctx)) return false;
+            }
+        }
+    }
+    
+    return true;
+}
+
+bool cmpFileWriteAt(cmp_file_t *ctx, u64 offset, const void *buf, u64 size)
+{
+    if (!ctx || !ctx->open || !buf || !size || (offset + size) > ctx->header.raw_prefix_size) return false;
+    
+    memcpy(ctx->prefix + offset, buf, size);
+    
+    return true;
+}
+
+bool cmpFileClose(cmp_file_t *ctx)
+{
+    if (!ctx || !ctx->open) return false;
+    
+    bool success = false;
+    char partPath[NAME_BUF_LEN] = {'\0'};
+    
+    // Hand the last block over to the worker threads, then wait for everything to be written
+    if (ctx->jobs[ctx->head].state == CMP_FILE_JOB_FREE && ctx->jobs[ctx->head].inSize) cmpFileSubmitJob(ctx);
+    
+    while(cmpFileGetJobState(ctx, ctx->tail) != CMP_FILE_JOB_FREE)
+    {
+        if (!cmpFileFlushJob(ctx)) goto out;
+    }
+    
+    ctx->header.data_size = ctx->dataOffset;
+    ctx->header.table_offset = ctx->outOffset;
+    
+    if (ctx->header.block_cnt && !cmpFileOutputWrite(ctx, ctx->table, (u64)ctx->header.block_cnt * sizeof(cmp_file_block_entry))) goto out;
+    
+    ctx->header.region_table_offset = ctx->outOffset;
+    
+    if (ctx->header.region_cnt && !cmpFileOutputWrite(ctx, ctx->regions, (u64)ctx->header.region_cnt * sizeof(cmp_file_crypto_region))) goto out;
+    
+    if (!outFileClose(&(ctx->out))) goto out;
+    
+    // Replace the placeholder header and raw prefix at the start of the first part file
+    cmpFileGetPartPath(ctx, 0, partPath);
+    if (!outFileOpen(&(ctx->out), partPath)) goto out;
+    
+    if (outFileWrite(&(ctx->out), &(ctx->header), sizeof(cmp_file_header)) != sizeof(cmp_file_header)) goto out;
+    if (ctx->header.raw_prefix_size && outFileWrite(&(ctx->out), ctx->prefix, ctx->header.raw_prefix_size) != ctx->header.raw_prefix_size) goto out;
+    
+    success = outFileClose(&(ctx->out));
+    
+out:
+    cmpFileFree(ctx);
+    
+    return success;
+}
+
+void cmpFileAbort(cmp_file_t *ctx)
+{
+    if (!ctx || !ctx->open) return;
+    
+    cmpFileFree(ctx);
+}
+
+// Reads data from an absolute offset within the compressed file
+static bool cmpFileReaderLoad(cmp_file_reader_t *ctx, u64 offset, void *buf, u64 size)
+{
+    if (fseek(ctx->file, (long)offset, SEEK_SET) != 0) return false;
+    
+    return (fread(buf, 1, size, ctx->file) == size);
+}
+
+bool cmpFileOpenReader(cmp_file_reader_t *ctx, const char *path)
+{
+    if (!ctx || !path || !strlen(path)) return false;
+    
+    bool success = false;
+    u32 i;
+    u64 blockCnt;
+    
+    memset(ctx, 0, sizeof(cmp_file_reader_t));
+    
+    ctx->file = fopen(path, "rb");
+    if (!ctx->file) return false;
+    
+    if (!cmpFileReaderLoad(ctx, 0, &(ctx->header), sizeof(cmp_file_header))) goto out;
+    
+    // Version 1 files are still valid, their region fields were reserved (and zeroed) back then
+    if (ctx->header.magic != CMP_FILE_MAGIC || !ctx->header.version || ctx->header.version > CMP_FILE_VERSION || !ctx->header.block_size || ctx->header.block_size > CMP_FILE_BLOCK_SIZE || ctx->header.raw_prefix_size > ctx->header.data_size) goto out;
+    
+    blockCnt = (((ctx->header.data_size - ctx->header.raw_prefix_size) + (ctx->header.block_size - 1)) / ctx->header.block_size);
+    if (blockCnt != ctx->header.block_cnt) goto out;
+    
+    if (ctx->header.raw_prefix_size)
+    {
+        ctx->prefix = malloc(ctx->header.raw_prefix_size);
+        if (!ctx->prefix || !cmpFileReaderLoad(ctx, sizeof(cmp_file_header), ctx->prefix, ctx->header.raw_prefix_size)) goto out;
+    }
+    
+    if (ctx->header.block_cnt)
+    {
+        ctx->table = malloc((u64)ctx->header.block_cnt * sizeof(cmp_file_block_entry));
+        if (!ctx->table || !cmpFileReaderLoad(ctx, ctx->header.table_offset, ctx->table, (u64)ctx->header.block_cnt * sizeof(cmp_file_block_entry))) goto out;
+        
+        for(i = 0; i < ctx->header.block_cnt; i++)
+        {
+            if (!ctx->table[i].size || ctx->table[i].size > ctx->header.block_size) goto out;
+        }
+    }
+    
+    if (ctx->header.version >= 2 && ctx->header.region_cnt)
+    {
+        ctx->regions = malloc((u64)ctx->header.region_cnt * sizeof(cmp_file_crypto_region));
+        if (!ctx->regions || !cmpFileReaderLoad(ctx, ctx->header.region_table_offset, ctx->regions, (u64)ctx->header.region_cnt * sizeof(cmp_file_crypto_region))) goto out;
+    } else {
+        ctx->header.region_cnt = 0;
+    }
+    
+    ctx->in = malloc(ctx->header.block_size);
+    ctx->out = malloc(ctx->header.block_size);
+    if (!ctx->in || !ctx->out) goto out;
+    
+    success = true;
+    
+out:
+    if (!success) cmpFileCloseReader(ctx);
+    
+    return success;
+}
+
+bool cmpFileRead(cmp_file_reader_t *ctx, u64 offset, void *buf, u64 size)
+{
+    if (!ctx || !ctx->file || !buf || (offset + size) > ctx->header.data_size) return false;
+    
+    u8 *data = (u8*)buf;
+    u64 chunk, blockOffset, blockSize;
+    u32 blockIndex;
+    int res;
+    
+    if (offset < ctx->header.raw_prefix_size)
+    {
+        chunk = (ctx->header.raw_prefix_size - offset);
+        if (chunk > size) chunk = size;
+        
+        memcpy(data, ctx->prefix + offset, chunk);
+        
+        offset += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+    
+    while(size)
+    {
+        blockIndex = (u32)((offset - ctx->header.raw_prefix_size) / ctx->header.block_size);
+        blockOffset = (ctx->header.raw_prefix_size + ((u64)blockIndex * ctx->header.block_size));
+        blockSize = ((ctx->header.data_size - blockOffset) < ctx->header.block_size ? (ctx->header.data_size - blockOffset) : ctx->header.block_size);
+        
+        if (!ctx->cached || ctx->cachedBlock != blockIndex)
+        {
+            cmp_file_block_entry *entry = &(ctx->table[blockIndex]);
+            
+            ctx->cached = false;
+            
+            if (entry->flags & CMP_FILE_BLOCK_FLAG_RAW)
+            {
+                if (entry->size != blockSize || !cmpFileReaderLoad(ctx, entry->offset, ctx->out, blockSize)) return false;
+            } else {
+                if (!cmpFileReaderLoad(ctx, entry->offset, ctx->in, entry->size)) return false;
+                
+                res = LZ4_decompress_safe((const char*)ctx->in, (char*)ctx->out, (int)entry->size, (int)ctx->header.block_size);
+                if (res < 0 || (u64)res != blockSize) return false;
+            }
+            
+            if (ctx->header.region_cnt) cmpFileCryptRegions(ctx->regions, ctx->header.region_cnt, blockOffset, ctx->out, blockSize);
+            
+            ctx->cachedBlock = blockIndex;
+            ctx->cached = true;
+        }
+        
+        chunk = (blockSize - (offset - blockOffset));
+        if (chunk > size) chunk = size;
+        
+        memcpy(data, ctx->out + (offset - blockOffset), chunk);
+        
+        offset += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+    
+    return true;
+}
+
+void cmpFileCloseReader(cmp_file_reader_t *ctx)
+{
+    if (!ctx) return;
+    
+    if (ctx->file) fclose(ctx->file);
+    if (ctx->prefix) free(ctx->prefix);
+    if (ctx->table) free(ctx->table);
+    if (ctx->regions) free(ctx->regions);
+    if (ctx->in) free(ctx->in);
+    if (ctx->out) free(ctx->out);
+    
+    memset(ctx, 0, sizeof(cmp_file_reader_t));
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#ifndef __CMP_FILE_H__
+#define __CMP_FILE_H__
+
+#include <stdio.h>
+#include <switch.h>
+
+#include "out_file.h"
+#include "util.h"
+
+#define CMP_FILE_MAGIC              (u32)0x4342584E     // "NXBC"
+#define CMP_FILE_VERSION            2                   // Version 1 files have no crypto region table
+#define CMP_FILE_EXTENSION          ".nxbc"
+
+#define CMP_FILE_BLOCK_SIZE         0x100000            // 1 MiB
+#define CMP_FILE_JOB_CNT            6                   // Blocks in flight
+#define CMP_FILE_WORKER_CNT         3
+#define CMP_FILE_WORKER_STACK_SIZE  0x10000
+
+#define CMP_FILE_BLOCK_FLAG_RAW     BIT(0)              // Stored as-is (the LZ4 output wasn't smaller than the input block)
+
+/*
+ * Block-compressed output file layout ("<dump>.xci.nxbc" / "<dump>.nsp.nxbc"):
+ *
+ * 0x00: cmp_file_header
+ * 0x40: raw prefix (raw_prefix_size bytes from the start of the uncompressed stream, e.g. the NSP PFS0 header)
+ * ....: compressed blocks - block #i holds block_size bytes from uncompressed offset (raw_prefix_size + (i * block_size)), the last one may be shorter
+ * ....: block table (block_cnt cmp_file_block_entry elements) at table_offset
+ * ....: crypto region table (region_cnt cmp_file_crypto_region elements) at region_table_offset
+ *
+ * Every block is compressed on its own with LZ4, so any uncompressed offset can be read back by looking up a single block in the table.
+ * Stream data covered by a crypto region (an AES-128-CTR NCA section) is decrypted before being compressed, since ciphertext doesn't compress at all.
+ * cmpFileRead() encrypts it again with the stored key and counter, so the restored stream is identical to the original dump.
+ * Offsets are relative to the start of the whole output file. If the output is split (FAT32), the parts are stored in a directory with the archive bit set.
+ */
+
+typedef struct {
+    u32 magic;                                                                  // CMP_FILE_MAGIC
+    u32 version;                                                                // CMP_FILE_VERSION
+    u32 block_size;
+    u32 block_cnt;
+    u64 data_size;                                                              // Uncompressed stream size (raw prefix included)
+    u64 raw_prefix_size;
+    u64 table_offset;
+    u64 region_table_offset;
+    u32 region_cnt;
+    u8 reserved[0xC];
+} PACKED cmp_file_header;
+
+typedef struct {
+    u64 offset;
+    u32 size;                                                                   // Stored block size
+    u32 flags;                                                                  // CMP_FILE_BLOCK_FLAG_*
+} PACKED cmp_file_block_entry;
+
+typedef struct {
+    u64 offset;                                                                 // Uncompressed stream offset. Never within the raw prefix
+    u64 size;
+    u64 ctr_offset;                                                             // NCA offset for the first byte of the region, used to calculate the AES-CTR counter
+    u8 key[0x10];                                                               // Decrypted NCA section key
+    u8 ctr[0x8];                                                                // Upper half of the AES-CTR counter, already in big endian order
+} PACKED cmp_file_crypto_region;
+
+typedef enum {
+    CMP_FILE_JOB_FREE = 0,
+    CMP_FILE_JOB_PENDING,                                                       // Waiting for a worker thread
+    CMP_FILE_JOB_BUSY,
+    CMP_FILE_JOB_DONE                                                           // Waiting to be written
+} cmpFileJobState;
+
+typedef struct {
+    u8 *in;
+    u8 *out;
+    u32 inSize;
+    u32 outSize;
+    u32 flags;
+    u32 blockIndex;
+    u8 state;                                                                   // cmpFileJobState
+} cmp_file_job_t;
+
+typedef struct {
+    bool open;
+    bool split;                                                                 // Set by cmpFileCreate() if the output file doesn't fit in a FAT32 partition. Still valid after cmpFileClose()
+    char path[NAME_BUF_LEN];                                                    // Output file / split output directory
+    out_file_t out;
+    u32 partIndex;
+    u64 outOffset;                                                              // Current output file size (all parts)
+    u64 maxSize;                                                                // Output file size if no block could be compressed
+    u64 dataSize;
+    u64 dataOffset;                                                             // Uncompressed bytes received so far
+    cmp_file_header header;
+    u8 *prefix;
+    cmp_file_block_entry *table;
+    cmp_file_crypto_region *regions;                                            // Sorted by offset. Read-only after cmpFileCreate(), so the worker threads don't need the lock to use it
+    Mutex mutex;
+    CondVar cond;
+    cmp_file_job_t jobs[CMP_FILE_JOB_CNT];
+    u32 head;                                                                   // Job currently being filled
+    u32 tail;                                                                   // Oldest job that hasn't been written yet
+    bool stop;
+    Thread workers[CMP_FILE_WORKER_CNT];
+    u8 worker_cnt;
+} cmp_file_t;
+
+typedef struct {
+    FILE *file;
+    cmp_file_header header;
+    u8 *prefix;
+    cmp_file_block_entry *table;
+    cmp_file_crypto_region *regions;
+    u8 *in;                                                                     // Stored block buffer
+    u8 *out;                                                                    // Uncompressed (and encrypted) block buffer
+    u32 cachedBlock;
+    bool cached;                                                                // Set if out holds block #cachedBlock
+} cmp_file_reader_t;
+
+/* Creates a block-compressed "sdmc:/" output file for a dataSize bytes long stream and starts the compression worker threads. */
+/* The first rawPrefixSize bytes of the stream are stored uncompressed and can be rewritten with cmpFileWriteAt() until the file is closed. */
+/* If isFat32 is true and the output file could exceed FAT32_FILESIZE_LIMIT, path is created as a directory with split part files inside it. */
+/* Stream data within the provided crypto regions (if any) is decrypted before being compressed. The regions are copied, so the array can be freed right away. */
+bool cmpFileCreate(cmp_file_t *ctx, const char *path, u64 dataSize, u64 rawPrefixSize, const cmp_file_crypto_region *regions, u32 regionCnt, bool isFat32);
+
+/* Appends uncompressed data to the stream. Full blocks are handed to the worker threads, and finished blocks are written in order from the calling thread. */
+/* Nothing is drawn on screen, so this is safe to call from a worker thread. */
+bool cmpFileWrite(cmp_file_t *ctx, const void *buf, u64 size);
+
+/* Rewrites data within the raw prefix (e.g. a placeholder header). */
+bool cmpFileWriteAt(cmp_file_t *ctx, u64 offset, const void *buf, u64 size);
+
+/* Flushes the remaining blocks and writes the block table and the file header. The archive bit on a split output directory is left to the caller. */
+bool cmpFileClose(cmp_file_t *ctx);
+
+/* Stops the worker threads and closes the output file without finishing it. The caller is expected to remove it. */
+void cmpFileAbort(cmp_file_t *ctx);
+
+/* Opens a block-compressed file for reading and loads its tables. Split output directories must have the archive bit set. */
+bool cmpFileOpenReader(cmp_file_reader_t *ctx, const char *path);
+
+/* Reads data from any offset of the uncompressed stream, encrypting the crypto regions again on the fly. */
+bool cmpFileRead(cmp_file_reader_t *ctx, u64 offset, void *buf, u64 size);
+
+void cmpFileCloseReader(cmp_file_reader_t *ctx);
+
+#endif
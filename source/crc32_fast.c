@@ -9,8 +9,14 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#ifdef __ARM_FEATURE_CRC32
+#include <arm_acle.h>
+#endif
+
 #include "crc32_fast.h"
 
+#define CRC32_POLY_REFLECTED    (u32)0xEDB88320
+
 u32 crc32_for_byte(u32 r)
 {
     for(int j = 0; j < 8; ++j) r = (r & 1? 0: (u32)0xEDB88320L) ^ r >> 1;
@@ -36,7 +42,7 @@ void init_tables(u32* table, u32* wtable)
     }
 }
 
-void crc32(const void* data, u64 n_bytes, u32* crc)
+static void crc32_sw(const void* data, u64 n_bytes, u32* crc)
 {
     static u32 table[0x100], wtable[0x100*sizeof(accum_t)];
     u64 n_accum = n_bytes / sizeof(accum_t);
@@ -50,3 +56,108 @@ void crc32(const void* data, u64 n_bytes, u32* crc)
     
     for(u64 i = n_accum*sizeof(accum_t); i < n_bytes; ++i) *crc = table[(u8)*crc ^ ((u8*)data)[i]] ^ *crc >> 8;
 }
+
+#ifdef __ARM_FEATURE_CRC32
+/* Uses the ARMv8 CRC32 instructions (same polynomial as the table-driven implementation).
+ * The accumulator holds the finalized checksum, so it's inverted on entry and on exit. */
+static void crc32_hw(const void* data, u64 n_bytes, u32* crc)
+{
+    const u8 *p = (const u8*)data;
+    u32 c = ~*crc;
+    
+    // Align the input pointer to 8 bytes
+    while(n_bytes && ((uintptr_t)p & 7))
+    {
+        c = __crc32b(c, *p++);
+        n_bytes--;
+    }
+    
+    // Process 32 bytes per iteration to help the CPU pipeline the instructions
+    while(n_bytes >= 32)
+    {
+        c = __crc32d(c, *(const u64*)p);
+        c = __crc32d(c, *(const u64*)(p + 8));
+        c = __crc32d(c, *(const u64*)(p + 16));
+        c = __crc32d(c, *(const u64*)(p + 24));
+        p += 32;
+        n_bytes -= 32;
+    }
+    
+    while(n_bytes >= 8)
+    {
+        c = __crc32d(c, *(const u64*)p);
+        p += 8;
+        n_bytes -= 8;
+    }
+    
+    while(n_bytes--) c = __crc32b(c, *p++);
+    
+    *crc = ~c;
+}
+#endif
+
+void crc32(const void* data, u64 n_bytes, u32* crc)
+{
+    if (!data || !n_bytes || !crc) return;
+    
+#ifdef __ARM_FEATURE_CRC32
+    crc32_hw(data, n_bytes, crc);
+#else
+    crc32_sw(data, n_bytes, crc);
+#endif
+}
+
+/* GF(2) matrix helpers used by crc32CombineFast (based on zlib's implementation). */
+static u32 gf2_matrix_times(const u32 *mat, u32 vec)
+{
+    u32 sum = 0;
+    
+    while(vec)
+    {
+        if (vec & 1) sum ^= *mat;
+        vec >>= 1;
+        mat++;
+    }
+    
+    return sum;
+}
+
+static void gf2_matrix_square(u32 *square, const u32 *mat)
+{
+    for(int n = 0; n < 32; n++) square[n] = gf2_matrix_times(mat, mat[n]);
+}
+
+u32 crc32CombineFast(u32 crc1, u32 crc2, u64 len2)
+{
+    u32 row = 1;
+    u32 even[32], odd[32];
+    
+    // Degenerate case (also disallow negative lengths)
+    if (!len2) return crc1;
+    
+    // Put operator for one zero bit in odd
+    odd[0] = CRC32_POLY_REFLECTED;
+    for(int n = 1; n < 32; n++)
+    {
+        odd[n] = row;
+        row <<= 1;
+    }
+    
+    // Put operator for two zero bits in even, then four zero bits in odd
+    gf2_matrix_square(even, odd);
+    gf2_matrix_square(odd, even);
+    
+    // Apply len2 zeros to crc1 (first square will put the operator for one zero byte, eight zero bits, in even)
+    do {
+        gf2_matrix_square(even, odd);
+        if (len2 & 1) crc1 = gf2_matrix_times(even, crc1);
+        len2 >>= 1;
+        if (!len2) break;
+        
+        gf2_matrix_square(odd, even);
+        if (len2 & 1) crc1 = gf2_matrix_times(odd, crc1);
+        len2 >>= 1;
+    } while(len2);
+    
+    return (crc1 ^ crc2);
+}
@@ -7,4 +7,8 @@
 
 void crc32(const void* data, u64 n_bytes, u32* crc);
 
+/* Returns the CRC32 checksum of two concatenated blocks, given the checksum of each block and the length of the second one.
+ * This allows checksums calculated over independent chunks (e.g. in parallel) to be merged afterwards. */
+u32 crc32CombineFast(u32 crc1, u32 crc2, u64 len2);
+
 #endif
\ No newline at end of file
@@ -13,8 +13,17 @@
 #include "fs_ext.h"
 #include "ui.h"
 #include "nca.h"
+#include "arena.h"
 #include "keys.h"
 #include "save.h"
+#include "nca_cache.h"
+#include "nca_meta.h"
+#include "sink.h"
+#include "benchmark.h"
+#include "perf.h"
+#include "verify.h"
+#include "nca_store.h"
+#include "journal.h"
 
 /* Extern variables */
 
@@ -56,12 +65,345 @@ extern char freeSpaceStr[32];
 
 extern char cfwDirStr[32];
 
+/* Variables */
+
+static nspBatchPrefetchCtx *nspBatchPrefetch = NULL;   // Next batch entry to prefetch. Only set by dumpNintendoSubmissionPackageBatch()
+static nca_store_t *nspNcaStore = NULL;                 // NCA store used to deduplicate NCAs between batch entries. Only set by dumpNintendoSubmissionPackageBatch()
+
 static void dumpStartMsg()
 {
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Dump procedure started. Hold " NINTENDO_FONT_B " to cancel.");
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Dump procedure started. Hold " NINTENDO_FONT_B " to cancel. Press " NINTENDO_FONT_Y " to toggle the stage timings view.");
     breaks++;
 }
 
+// Final size of the output part file (or the whole dump, if it isn't split). Used to preallocate it
+static u64 getOutputFileAllocSize(u64 totalSize, u64 partSize, u32 partIndex, bool split)
+{
+    if (!split) return totalSize;
+    
+    u64 partOffset = ((u64)partIndex * partSize);
+    if (partOffset >= totalSize) return 0;
+    
+    return ((totalSize - partOffset) < partSize ? (totalSize - partOffset) : partSize);
+}
+
+// fwrite() wrapper for the stdio based dump procedures, so their output file writes show up in the performance log
+static size_t dumpFileWrite(const void *buf, size_t size, FILE *outFile)
+{
+    u64 startTick = perfTick();
+    size_t write_res = fwrite(buf, 1, size, outFile);
+    perfAdd(PERF_STAGE_WRITE, startTick, write_res);
+    return write_res;
+}
+
+// Allocates the dump pipeline buffers using the benchmarked block size for this source and set of stages
+// Smaller blocks are tried if there's not enough heap memory left. Returns the block size in use, or zero if the allocation failed
+static u64 initDumpPipeline(pipeline_ctx_t *pipeCtx, u8 stage_cnt, dumpBlockSource source, u8 stages)
+{
+    u64 blockSize;
+    
+    for(blockSize = benchmarkGetDumpBlockSize(source, stages); blockSize >= DUMP_BLOCK_SIZE_MIN; blockSize /= 2)
+    {
+        if (pipelineInit(pipeCtx, stage_cnt, blockSize)) return blockSize;
+    }
+    
+    return 0;
+}
+
+// Fills a crypto region slot for each AES-CTR section of a NCA, with offsets relative to the start of the NCA. Unused slots are zeroed
+// BKTR sections are left alone, since their counters change from one subsection to another
+static void getNcaCryptoRegions(const nca_header_t *dec_nca_header, const u8 *decrypted_nca_keys, u64 ncaSize, cmp_file_crypto_region *regions)
+{
+    u32 i, j;
+    u64 sectionOffset, sectionSize;
+    
+    memset(regions, 0, 4 * sizeof(cmp_file_crypto_region));
+    
+    for(i = 0; i < 4; i++)
+    {
+        if (dec_nca_header->fs_headers[i].crypt_type != NCA_FS_HEADER_CRYPT_CTR || dec_nca_header->section_entries[i].media_end_offset <= dec_nca_header->section_entries[i].media_start_offset) continue;
+        
+        sectionOffset = ((u64)dec_nca_header->section_entries[i].media_start_offset * (u64)MEDIA_UNIT_SIZE);
+        sectionSize = ((u64)(dec_nca_header->section_entries[i].media_end_offset - dec_nca_header->section_entries[i].media_start_offset) * (u64)MEDIA_UNIT_SIZE);
+        if (sectionOffset < NCA_FULL_HEADER_LENGTH || (sectionOffset + sectionSize) > ncaSize) continue;
+        
+        regions[i].offset = sectionOffset;
+        regions[i].size = sectionSize;
+        regions[i].ctr_offset = sectionOffset;
+        memcpy(regions[i].key, decrypted_nca_keys + (NCA_KEY_AREA_KEY_SIZE * 2), NCA_KEY_AREA_KEY_SIZE);
+        
+        for(j = 0; j < 0x8; j++) regions[i].ctr[j] = dec_nca_header->fs_headers[i].section_ctr[0x08 - j - 1];
+    }
+}
+
+// Parses the NCA headers from every HFS0 partition, so their AES-CTR sections can be decrypted before being compressed
+// NCAs with a populated Rights ID field are skipped, and so is any NCA that can't be parsed - these are just stored as they are
+static u32 getXciCryptoRegions(u64 dataSize, cmp_file_crypto_region **outRegions)
+{
+    *outRegions = NULL;
+    
+    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !loadNcaKeyset()) return 0;
+    
+    u32 i, j, k, regionCnt = 0, maxRegionCnt = 0;
+    u64 storageOffset, fileOffset;
+    hfs0_file_entry entry;
+    u8 ncaHeader[NCA_FULL_HEADER_LENGTH];
+    nca_header_t dec_nca_header;
+    u8 decrypted_nca_keys[NCA_KEY_AREA_SIZE];
+    cmp_file_crypto_region *regions = NULL;
+    
+    for(i = 0; i < gameCardInfo.hfs0PartitionCnt; i++)
+    {
+        if (!gameCardInfo.hfs0Partitions[i].header) return 0;
+        maxRegionCnt += (gameCardInfo.hfs0Partitions[i].file_cnt * 4);
+    }
+    
+    if (!maxRegionCnt) return 0;
+    
+    regions = calloc(maxRegionCnt, sizeof(cmp_file_crypto_region));
+    if (!regions) return 0;
+    
+    for(i = 0; i < gameCardInfo.hfs0PartitionCnt; i++)
+    {
+        hfs0_partition_info *partitionInfo = &(gameCardInfo.hfs0Partitions[i]);
+        openIStoragePartition storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, i) + 1);
+        
+        // The secure IStorage partition comes right after the normal one in the XCI
+        storageOffset = (storageIndex == ISTORAGE_PARTITION_SECURE ? gameCardInfo.IStoragePartitionSizes[0] : 0);
+        
+        if (R_FAILED(openGameCardStoragePartition(storageIndex))) continue;
+        
+        for(j = 0; j < partitionInfo->file_cnt; j++)
+        {
+            memcpy(&entry, partitionInfo->header + sizeof(hfs0_header) + (j * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
+            
+            const char *name = (const char*)(partitionInfo->header + sizeof(hfs0_header) + (partitionInfo->file_cnt * sizeof(hfs0_file_entry)) + entry.filename_offset);
+            size_t nameLen = strlen(name);
+            
+            if (entry.file_size < NCA_FULL_HEADER_LENGTH || nameLen <= 4 || strcasecmp(name + nameLen - 4, ".nca") != 0) continue;
+            
+            fileOffset = (partitionInfo->offset + partitionInfo->header_size + entry.file_offset);
+            
+            if (R_FAILED(readGameCardStoragePartition(fileOffset, ncaHeader, NCA_FULL_HEADER_LENGTH))) continue;
+            
+            if (!decryptNcaHeader(ncaHeader, NCA_FULL_HEADER_LENGTH, NULL, &dec_nca_header, NULL, decrypted_nca_keys, false)) continue;
+            
+            for(k = 0; k < 0x10; k++)
+            {
+                if (dec_nca_header.rights_id[k] != 0) break;
+            }
+            
+            if (k < 0x10) continue;
+            
+            getNcaCryptoRegions(&dec_nca_header, decrypted_nca_keys, entry.file_size, regions + regionCnt);
+            
+            // Move the regions to their XCI offsets, dropping the empty slots (and anything past the end of a trimmed dump)
+            for(k = 0; k < 4; k++)
+            {
+                cmp_file_crypto_region *region = &(regions[regionCnt + k]);
+                if (!region->size) continue;
+                
+                region->offset += (storageOffset + fileOffset);
+                if ((region->offset + region->size) > dataSize) continue;
+                
+                memmove(&(regions[regionCnt]), region, sizeof(cmp_file_crypto_region));
+                regionCnt++;
+            }
+        }
+    }
+    
+    closeGameCardStoragePartition();
+    
+    if (!regionCnt)
+    {
+        free(regions);
+        return 0;
+    }
+    
+    *outRegions = regions;
+    
+    return regionCnt;
+}
+
+static void xciPipelineReaderThreadFunc(void *arg)
+{
+    xciPipelineCtx *ctx = (xciPipelineCtx*)arg;
+    pipeline_slot_t *slot = NULL;
+    Result result;
+    u32 partition;
+    u64 partitionOffset, n;
+    u64 curOffset = ctx->startOffset, seqDumpSessionOffset = 0;
+    bool lastSlot = false;
+    
+    for(partition = ctx->startPartitionIndex; partition < ISTORAGE_PARTITION_CNT && !lastSlot; partition++)
+    {
+        partitionOffset = (partition == ctx->startPartitionIndex ? ctx->startPartitionOffset : 0);
+        
+        openIStoragePartition idx = (openIStoragePartition)(partition + 1);
+        
+        result = openGameCardStoragePartition(idx);
+        if (R_FAILED(result))
+        {
+            slot = pipelineAcquire(&(ctx->pipeCtx), 0);
+            if (!slot) return;
+            
+            ctx->openError = true;
+            ctx->readResult = result;
+            
+            slot->entry_idx = partition;
+            slot->entry_offset = partitionOffset;
+            slot->offset = curOffset;
+            slot->error = slot->last = true;
+            
+            pipelineRelease(&(ctx->pipeCtx), slot);
+            return;
+        }
+        
+        // Empty partitions still produce a zero-sized slot, so the writer can update the UI
+        do {
+            n = ctx->blockSize;
+            if (n > (ctx->partitionSizes[partition] - partitionOffset)) n = (ctx->partitionSizes[partition] - partitionOffset);
+            
+            // Check if the next read chunk will exceed the size of the current part file
+            u64 sessionPartSize = (((seqDumpSessionOffset / ctx->partSize) + 1) * ctx->partSize);
+            
+            if (ctx->seqDumpMode && (seqDumpSessionOffset + n) >= sessionPartSize)
+            {
+                u64 new_file_chunk_size = ((seqDumpSessionOffset + n) - sessionPartSize);
+                u64 old_file_chunk_size = (n - new_file_chunk_size);
+                
+                u64 remainderDumpSize = (ctx->totalSize - (curOffset + old_file_chunk_size));
+                u64 remainderFreeSize = (freeSpace - (seqDumpSessionOffset + old_file_chunk_size));
+                
+                // Check if we have enough space for the next part
+                // If so, set the chunk size to old_file_chunk_size
+                if ((remainderDumpSize <= ctx->partSize && remainderDumpSize > remainderFreeSize) || (remainderDumpSize > ctx->partSize && ctx->partSize > remainderFreeSize))
+                {
+                    n = old_file_chunk_size;
+                    ctx->seqDumpFinish = true;
+                }
+            }
+            
+            slot = pipelineAcquire(&(ctx->pipeCtx), 0);
+            if (!slot) break;
+            
+            slot->entry_idx = partition;
+            slot->entry_offset = partitionOffset;
+            slot->offset = curOffset;
+            
+            if (n)
+            {
+                result = readGameCardStoragePartition(partitionOffset, slot->data, n);
+                if (R_FAILED(result))
+                {
+                    ctx->readResult = result;
+                    slot->size = n;
+                    slot->error = slot->last = true;
+                    pipelineRelease(&(ctx->pipeCtx), slot);
+                    lastSlot = true;
+                    break;
+                }
+                
+                // Remove gamecard certificate
+                if (curOffset == 0 && !ctx->keepCert) memset(slot->data + CERT_OFFSET, 0xFF, CERT_SIZE);
+            }
+            
+            slot->size = n;
+            
+            partitionOffset += n;
+            curOffset += n;
+            seqDumpSessionOffset += n;
+            
+            lastSlot = slot->last = (ctx->seqDumpFinish || curOffset >= ctx->totalSize);
+            
+            pipelineRelease(&(ctx->pipeCtx), slot);
+        } while(!lastSlot && partitionOffset < ctx->partitionSizes[partition]);
+        
+        closeGameCardStoragePartition();
+        
+        if (!slot) break;
+    }
+}
+
+static void xciPipelineHasherThreadFunc(void *arg)
+{
+    xciPipelineCtx *ctx = (xciPipelineCtx*)arg;
+    pipeline_slot_t *slot = NULL;
+    bool lastSlot = false;
+    
+    while(!lastSlot)
+    {
+        slot = pipelineAcquire(&(ctx->pipeCtx), 1);
+        if (!slot) break;
+        
+        lastSlot = slot->last;
+        
+        if (!slot->error && slot->size)
+        {
+            u64 startTick = perfTick();
+            
+            if (ctx->calcCrc)
+            {
+                if (!ctx->trimDump)
+                {
+                    if (ctx->keepCert)
+                    {
+                        // Both checksums only differ within the gamecard certificate area, so a single pass over the buffer is enough
+                        if (slot->offset == 0 && slot->size >= (CERT_OFFSET + CERT_SIZE))
+                        {
+                            u8 certlessArea[CERT_SIZE];
+                            u32 headCrc = 0, certAreaCrc = 0, certlessAreaCrc = 0, tailCrc = 0;
+                            u64 tailSize = (slot->size - (CERT_OFFSET + CERT_SIZE));
+                            
+                            memset(certlessArea, 0xFF, CERT_SIZE);
+                            
+                            crc32(slot->data, CERT_OFFSET, &headCrc);
+                            crc32(slot->data + CERT_OFFSET, CERT_SIZE, &certAreaCrc);
+                            crc32(certlessArea, CERT_SIZE, &certlessAreaCrc);
+                            crc32(slot->data + CERT_OFFSET + CERT_SIZE, tailSize, &tailCrc);
+                            
+                            // Update CRC32 (with gamecard certificate)
+                            ctx->certCrc = crc32CombineFast(crc32CombineFast(headCrc, certAreaCrc, CERT_SIZE), tailCrc, tailSize);
+                            
+                            // Update CRC32 (without gamecard certificate)
+                            ctx->certlessCrc = crc32CombineFast(crc32CombineFast(headCrc, certlessAreaCrc, CERT_SIZE), tailCrc, tailSize);
+                        } else {
+                            u32 chunkCrc = 0;
+                            crc32(slot->data, slot->size, &chunkCrc);
+                            
+                            // Update CRC32 (with gamecard certificate)
+                            ctx->certCrc = crc32CombineFast(ctx->certCrc, chunkCrc, slot->size);
+                            
+                            // Update CRC32 (without gamecard certificate)
+                            ctx->certlessCrc = crc32CombineFast(ctx->certlessCrc, chunkCrc, slot->size);
+                        }
+                    } else {
+                        // Update CRC32
+                        crc32(slot->data, slot->size, &(ctx->certlessCrc));
+                    }
+                } else {
+                    // Update CRC32
+                    crc32(slot->data, slot->size, &(ctx->certCrc));
+                }
+            }
+            
+            // Keep the checksums calculated up to a dump journal checkpoint, since we may already be ahead of the writer by the time it saves it
+            if (ctx->journal && dumpJournalCheckpointCrossed(slot->offset, slot->size))
+            {
+                ctx->journalCertCrc = ctx->certCrc;
+                ctx->journalCertlessCrc = ctx->certlessCrc;
+            }
+            
+            // Check the HFS0 / NCA header hashed regions covered by this chunk
+            if (ctx->verifyCtx) verifyUpdate(ctx->verifyCtx, slot->offset, slot->data, slot->size);
+            
+            perfAdd(PERF_STAGE_HASH, startTick, slot->size);
+        }
+        
+        pipelineRelease(&(ctx->pipeCtx), slot);
+    }
+}
+
 bool dumpNXCardImage(xciOptions *xciDumpCfg)
 {
     if (!xciDumpCfg)
@@ -78,6 +420,19 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
     bool calcCrc = xciDumpCfg->calcCrc;
     bool useNoIntroLookup = xciDumpCfg->useNoIntroLookup;
     bool useBrackets = xciDumpCfg->useBrackets;
+    dumpOutputTarget outputTarget = xciDumpCfg->outputTarget;
+    bool verifyHashes = xciDumpCfg->verifyHashes;
+    bool compressOutput = xciDumpCfg->compressOutput;
+    
+    // USB / TCP dumps are streamed to a host receiver, so there's no need to deal with SD card free space or FAT32 limitations
+    bool remoteOutput = (outputTarget == DUMP_OUTPUT_USB || outputTarget == DUMP_OUTPUT_TCP);
+    
+    sink_ctx_t sinkCtx;
+    memset(&sinkCtx, 0, sizeof(sink_ctx_t));
+    
+    u64 resumeOffset = 0;
+    u32 resumePartitionIndex = 0;
+    u64 resumePartitionOffset = 0;
     
     u64 partitionOffset = 0, xciDataSize = 0, n;
     u64 partitionSizes[ISTORAGE_PARTITION_CNT];
@@ -85,15 +440,15 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
     u32 partition;
     Result result;
     bool proceed = true, success = false, fat32_error = false;
-    FILE *outFile = NULL;
+    out_file_t outFile;
     u8 splitIndex = 0;
     u32 certCrc = 0, certlessCrc = 0;
     
-    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
-    
     progress_ctx_t progressCtx;
     memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
+    memset(&outFile, 0, sizeof(out_file_t));
+    
     bool seqDumpMode = false, seqDumpFileRemove = false, seqDumpFinish = false;
     char seqDumpFilename[NAME_BUF_LEN] = {'\0'};
     FILE *seqDumpFile = NULL;
@@ -102,6 +457,24 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
     sequentialXciCtx seqXciCtx;
     memset(&seqXciCtx, 0, sizeof(sequentialXciCtx));
     
+    bool journalEnabled = false, journalResume = false, journalKeep = false;
+    char journalFilename[NAME_BUF_LEN] = {'\0'};
+    
+    dump_journal_header journalHeader;
+    memset(&journalHeader, 0, sizeof(dump_journal_header));
+    
+    xciPipelineCtx xciPipeCtx;
+    memset(&xciPipeCtx, 0, sizeof(xciPipelineCtx));
+    
+    verify_ctx_t verifyCtx;
+    memset(&verifyCtx, 0, sizeof(verify_ctx_t));
+    
+    cmp_file_t cmpFile;
+    memset(&cmpFile, 0, sizeof(cmp_file_t));
+    
+    cmp_file_crypto_region *cmpRegions = NULL;
+    u32 cmpRegionCnt = 0;
+    
     char tmp_idx[5];
     
     size_t read_res, write_res;
@@ -123,7 +496,7 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
     
     // Check if we're dealing with a sequential dump
     snprintf(seqDumpFilename, MAX_CHARACTERS(seqDumpFilename), "%s%s.xci.seq", XCI_DUMP_PATH, dumpName);
-    seqDumpMode = checkIfFileExists(seqDumpFilename);
+    seqDumpMode = (!remoteOutput && checkIfFileExists(seqDumpFilename));
     if (seqDumpMode)
     {
         // Open sequence file
@@ -177,6 +550,60 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
         progressCtx.curOffset = ((u64)seqXciCtx.partNumber * SPLIT_FILE_SEQUENTIAL_SIZE);
     }
     
+    if (remoteOutput) isFat32 = setXciArchiveBit = false;
+    
+    // Check if a previous dump was interrupted (e.g. crash, power loss or gamecard removal)
+    // Checkpoints are only saved for regular SD card dumps
+    journalEnabled = (!remoteOutput && !seqDumpMode && !compressOutput);
+    if (journalEnabled)
+    {
+        snprintf(journalFilename, MAX_CHARACTERS(journalFilename), "%s%s.xci" DUMP_JOURNAL_EXTENSION, XCI_DUMP_PATH, dumpName);
+        
+        sequentialXciCtx *journalXciCtx = (sequentialXciCtx*)dumpJournalLoad(journalFilename, DUMP_JOURNAL_TYPE_XCI, &journalHeader);
+        if (journalXciCtx)
+        {
+            if (journalHeader.payloadSize == sizeof(sequentialXciCtx) && journalXciCtx->partitionIndex < ISTORAGE_PARTITION_CNT)
+            {
+                char journalOffsetStr[32] = {'\0'};
+                char journalPrompt[NAME_BUF_LEN] = {'\0'};
+                
+                convertSize(journalHeader.offset, journalOffsetStr, MAX_CHARACTERS(journalOffsetStr));
+                snprintf(journalPrompt, MAX_CHARACTERS(journalPrompt), "An interrupted dump of this gamecard was found (%s already dumped). Do you want to continue from the last checkpoint?\nIf you choose not to, the previous dump will be discarded.", journalOffsetStr);
+                
+                int cur_breaks = breaks;
+                
+                journalResume = yesNoPrompt(journalPrompt);
+                
+                // Remove the prompt from the screen
+                breaks = cur_breaks;
+                uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+                uiRefreshDisplay();
+            }
+            
+            if (journalResume)
+            {
+                // Restore parameters from the dump journal
+                isFat32 = ((journalHeader.flags & DUMP_JOURNAL_FLAG_FAT32) != 0);
+                setXciArchiveBit = ((journalHeader.flags & DUMP_JOURNAL_FLAG_ARCHIVE_BIT) != 0);
+                keepCert = journalXciCtx->keepCert;
+                trimDump = journalXciCtx->trimDump;
+                calcCrc = journalXciCtx->calcCrc;
+                splitIndex = journalXciCtx->partNumber;
+                certCrc = journalXciCtx->certCrc;
+                certlessCrc = journalXciCtx->certlessCrc;
+                resumePartitionIndex = journalXciCtx->partitionIndex;
+                resumePartitionOffset = journalXciCtx->partitionOffset;
+                progressCtx.curOffset = journalHeader.offset;
+                
+                journalKeep = true;
+            }
+            
+            free(journalXciCtx);
+        }
+        
+        if (!journalResume) dumpJournalRemove(journalFilename);
+    }
+    
     u64 partSize = (seqDumpMode ? SPLIT_FILE_SEQUENTIAL_SIZE : (!setXciArchiveBit ? SPLIT_FILE_XCI_PART_SIZE : SPLIT_FILE_NSP_PART_SIZE));
     
     // Retrieve dump sizes for each IStorage partition
@@ -252,7 +679,8 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
         
         uiRefreshDisplay();
     } else {
-        if (progressCtx.totalSize > freeSpace)
+        // The interrupted dump already takes up the space it needs
+        if (!remoteOutput && !journalResume && progressCtx.totalSize > freeSpace)
         {
             // Check if we have at least (SPLIT_FILE_SEQUENTIAL_SIZE + sizeof(sequentialXciCtx)) of free space
             if (freeSpace < (SPLIT_FILE_SEQUENTIAL_SIZE + sizeof(sequentialXciCtx)))
@@ -312,10 +740,26 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
         }
     }
     
+    if (compressOutput && (remoteOutput || seqDumpMode))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Output compression disabled (not compatible with %s).", (remoteOutput ? "USB / network dumps" : "sequential dumps"));
+        breaks += 2;
+        compressOutput = false;
+    }
+    
+    if (remoteOutput)
+    {
+        // Only used to send the output filename to the host receiver
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "/%s.xci", dumpName);
+    } else
     if (seqDumpMode)
     {
         snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci.%02u", XCI_DUMP_PATH, dumpName, splitIndex);
     } else {
+        if (compressOutput)
+        {
+            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci" CMP_FILE_EXTENSION, XCI_DUMP_PATH, dumpName);
+        } else
         if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
         {
             if (setXciArchiveBit)
@@ -330,7 +774,7 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
         }
         
         // Check if the dump already exists
-        if (checkIfFileExists(dumpPath))
+        if (!journalResume && checkIfFileExists(dumpPath))
         {
             // Ask the user if they want to proceed anyway
             int cur_breaks = breaks;
@@ -348,6 +792,34 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
             }
         }
         
+        if (journalResume)
+        {
+            bool splitDump = (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32);
+            u64 journalXciOffset = 0;
+            
+            if (splitDump && setXciArchiveBit)
+            {
+                sprintf(tmp_idx, "/%02u", splitIndex);
+                strcat(dumpPath, tmp_idx);
+            }
+            
+            for(u32 i = 0; i < resumePartitionIndex; i++) journalXciOffset += partitionSizes[i];
+            journalXciOffset += resumePartitionOffset;
+            
+            // Make sure the checkpoint matches the current gamecard and the data that made it to the SD card
+            if (journalHeader.totalSize != progressCtx.totalSize || journalXciOffset != journalHeader.offset || resumePartitionOffset >= partitionSizes[resumePartitionIndex] || journalHeader.partOffset != (splitDump ? (journalHeader.offset - ((u64)splitIndex * partSize)) : journalHeader.offset) || !dumpJournalCheckTail(&journalHeader, dumpPath))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the interrupted dump couldn't be verified! The dump journal has been discarded, please try again.", __func__);
+                journalKeep = false;
+                goto out;
+            }
+        } else
+        if (compressOutput)
+        {
+            // The compressed output may be a split directory or a single file regardless of what we had before
+            remove(dumpPath);
+            fsdevDeleteDirectoryRecursively(dumpPath);
+        } else
         if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32 && setXciArchiveBit)
         {
             // Since we may actually be dealing with an existing directory with the archive bit set or unset, let's try both
@@ -362,124 +834,172 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
         }
     }
     
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
+    // Reader -> (CRC32 / hash verification) -> writer
+    u8 writerStage = ((calcCrc || verifyHashes) ? 2 : 1);
+    
+    xciPipeCtx.blockSize = initDumpPipeline(&(xciPipeCtx.pipeCtx), writerStage + 1, DUMP_BLOCK_SOURCE_GAMECARD, (calcCrc ? BENCHMARK_STAGE_CRC32 : 0) | (!remoteOutput ? BENCHMARK_STAGE_SDCARD : 0));
+    if (!xciPipeCtx.blockSize)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for the dump pipeline buffers!", __func__);
         goto out;
     }
     
-    // Start dump process
-    dumpStartMsg();
-    appletModeOperationWarning();
-    uiRefreshDisplay();
-    breaks++;
-    
-    changeHomeButtonBlockStatus(true);
-    
-    progressCtx.line_offset = (breaks + 4);
-    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
-    
-    u32 startPartitionIndex = (seqDumpMode ? seqXciCtx.partitionIndex : 0);
-    u64 startPartitionOffset;
+    if (verifyHashes && !verifyInitXci(&verifyCtx))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to set up the HFS0 / NCA header hash verification!", __func__);
+        goto out;
+    }
     
-    for(partition = startPartitionIndex; partition < ISTORAGE_PARTITION_CNT; partition++)
+    if (remoteOutput)
     {
-        n = DUMP_BUFFER_SIZE;
+        if (!sinkOpen(&sinkCtx, outputTarget)) goto out;
         
-        startPartitionOffset = ((seqDumpMode && partition == startPartitionIndex) ? seqXciCtx.partitionOffset : 0);
+        // Resuming isn't possible if we need to calculate the CRC32 checksum for the whole dump
+        if (!sinkBeginFile(&sinkCtx, strrchr(dumpPath, '/') + 1, progressCtx.totalSize, !calcCrc, &resumeOffset)) goto out;
         
-        openIStoragePartition idx = (openIStoragePartition)(partition + 1);
+        if (resumeOffset)
+        {
+            u64 partitionStartOffset = 0;
+            
+            for(resumePartitionIndex = 0; resumePartitionIndex < (ISTORAGE_PARTITION_CNT - 1); resumePartitionIndex++)
+            {
+                if (resumeOffset < (partitionStartOffset + partitionSizes[resumePartitionIndex])) break;
+                partitionStartOffset += partitionSizes[resumePartitionIndex];
+            }
+            
+            resumePartitionOffset = (resumeOffset - partitionStartOffset);
+            progressCtx.curOffset = resumeOffset;
+            
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous transfer from offset 0x%016lX.", resumeOffset);
+            breaks++;
+        }
+    } else
+    if (compressOutput)
+    {
+        // Encrypted NCA sections don't compress at all, so they're decrypted first
+        cmpRegionCnt = getXciCryptoRegions(progressCtx.totalSize, &cmpRegions);
         
-        result = openGameCardStoragePartition(idx);
-        if (R_FAILED(result))
+        bool cmpFileCreated = cmpFileCreate(&cmpFile, dumpPath, progressCtx.totalSize, 0, cmpRegions, cmpRegionCnt, isFat32);
+        
+        if (cmpRegions)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #%u! (0x%08X)", __func__, partition, result);
-            proceed = false;
-            break;
+            free(cmpRegions);
+            cmpRegions = NULL;
         }
         
-        for(partitionOffset = startPartitionOffset; partitionOffset < partitionSizes[partition]; partitionOffset += n, progressCtx.curOffset += n, seqDumpSessionOffset += n)
+        if (!cmpFileCreated)
         {
-            if (seqDumpMode && seqDumpFinish) break;
-            
-            uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
-            
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
-            
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Dumping IStorage partition #%u...", partition);
-            
-            if (n > (partitionSizes[partition] - partitionOffset)) n = (partitionSizes[partition] - partitionOffset);
-            
-            // Check if the next read chunk will exceed the size of the current part file
-            if (seqDumpMode && (seqDumpSessionOffset + n) >= (((splitIndex - seqXciCtx.partNumber) + 1) * partSize))
-            {
-                u64 new_file_chunk_size = ((seqDumpSessionOffset + n) - (((splitIndex - seqXciCtx.partNumber) + 1) * partSize));
-                u64 old_file_chunk_size = (n - new_file_chunk_size);
-                
-                u64 remainderDumpSize = (progressCtx.totalSize - (progressCtx.curOffset + old_file_chunk_size));
-                u64 remainderFreeSize = (freeSpace - (seqDumpSessionOffset + old_file_chunk_size));
-                
-                // Check if we have enough space for the next part
-                // If so, set the chunk size to old_file_chunk_size
-                if ((remainderDumpSize <= partSize && remainderDumpSize > remainderFreeSize) || (remainderDumpSize > partSize && partSize > remainderFreeSize))
-                {
-                    n = old_file_chunk_size;
-                    seqDumpFinish = true;
-                }
-            }
-            
-            result = readGameCardStoragePartition(partitionOffset, dumpBuf, n);
-            if (R_FAILED(result))
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to create compressed output file \"%s\"!", __func__, dumpPath);
+            goto out;
+        }
+    } else
+    if (journalResume)
+    {
+        if (!outFileOpen(&outFile, dumpPath))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\" to resume the interrupted dump! (0x%08X)", __func__, dumpPath, outFile.lastResult);
+            goto out;
+        }
+        
+        outFileSeek(&outFile, journalHeader.partOffset);
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming interrupted dump from offset 0x%016lX. Configuration parameters overrided.", journalHeader.offset);
+        breaks++;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Keep certificate: %s | Trim output dump: %s | CRC32 checksum calculation + dump verification: %s.", (keepCert ? "Yes" : "No"), (trimDump ? "Yes" : "No"), (calcCrc ? "Yes" : "No"));
+        breaks++;
+    } else {
+        if (!outFileCreate(&outFile, dumpPath, getOutputFileAllocSize(progressCtx.totalSize, partSize, splitIndex, (seqDumpMode || (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)))))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
+            goto out;
+        }
+    }
+    
+    // Start dump process
+    dumpStartMsg();
+    perfStart();
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    breaks++;
+    
+    changeHomeButtonBlockStatus(true);
+    
+    progressCtx.line_offset = (breaks + 4);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    
+    progressUiThreadStart(&progressCtx);
+    
+    // Setup the dump pipeline
+    // The gamecard reader and the CRC32 calculation / hash verification run on worker threads, while output file writes take place on the main thread
+    // Progress bar redraws and input polling are handled by the progress UI thread
+    xciPipeCtx.partitionSizes = partitionSizes;
+    xciPipeCtx.startPartitionIndex = (seqDumpMode ? seqXciCtx.partitionIndex : resumePartitionIndex);
+    xciPipeCtx.startPartitionOffset = (seqDumpMode ? seqXciCtx.partitionOffset : resumePartitionOffset);
+    xciPipeCtx.startOffset = progressCtx.curOffset;
+    xciPipeCtx.totalSize = progressCtx.totalSize;
+    xciPipeCtx.partSize = partSize;
+    xciPipeCtx.seqDumpMode = seqDumpMode;
+    xciPipeCtx.keepCert = keepCert;
+    xciPipeCtx.trimDump = trimDump;
+    xciPipeCtx.calcCrc = calcCrc;
+    xciPipeCtx.verifyCtx = (verifyHashes ? &verifyCtx : NULL);
+    xciPipeCtx.certCrc = certCrc;
+    xciPipeCtx.certlessCrc = certlessCrc;
+    xciPipeCtx.journal = journalEnabled;
+    
+    partition = xciPipeCtx.startPartitionIndex;
+    partitionOffset = xciPipeCtx.startPartitionOffset;
+    
+    if (!pipelineStartWorker(&(xciPipeCtx.pipeCtx), xciPipelineReaderThreadFunc, &xciPipeCtx) || ((calcCrc || verifyHashes) && !pipelineStartWorker(&(xciPipeCtx.pipeCtx), xciPipelineHasherThreadFunc, &xciPipeCtx)))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to start dump pipeline threads!", __func__);
+        proceed = false;
+    }
+    
+    while(proceed)
+    {
+        pipeline_slot_t *slot = pipelineAcquire(&(xciPipeCtx.pipeCtx), writerStage);
+        if (!slot)
+        {
+            proceed = false;
+            break;
+        }
+        
+        partition = slot->entry_idx;
+        partitionOffset = slot->entry_offset;
+        n = slot->size;
+        
+        bool lastSlot = slot->last;
+        if (seqDumpMode && lastSlot && xciPipeCtx.seqDumpFinish) seqDumpFinish = true;
+        
+        printProgressStatus(&progressCtx, PROGRESS_STATUS_UPPER, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+        
+        printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "Dumping IStorage partition #%u...", partition);
+        
+        if (slot->error)
+        {
+            if (xciPipeCtx.openError)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from IStorage partition #%u! (0x%08X)", __func__, n, partitionOffset, partition, result);
-                proceed = false;
-                break;
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #%u! (0x%08X)", __func__, partition, xciPipeCtx.readResult);
+            } else {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from IStorage partition #%u! (0x%08X)", __func__, n, partitionOffset, partition, xciPipeCtx.readResult);
             }
             
-            // Remove gamecard certificate
-            if (progressCtx.curOffset == 0 && !keepCert) memset(dumpBuf + CERT_OFFSET, 0xFF, CERT_SIZE);
-            
-            if (calcCrc)
+            proceed = false;
+            break;
+        }
+        
+        if (n > 0)
+        {
+            if (compressOutput)
             {
-                if (!trimDump)
+                if (!cmpFileWrite(&cmpFile, slot->data, n))
                 {
-                    if (keepCert)
-                    {
-                        if (progressCtx.curOffset == 0)
-                        {
-                            // Update CRC32 (with gamecard certificate)
-                            crc32(dumpBuf, n, &certCrc);
-                            
-                            // Backup gamecard certificate to an array
-                            char tmpCert[CERT_SIZE] = {'\0'};
-                            memcpy(tmpCert, dumpBuf + CERT_OFFSET, CERT_SIZE);
-                            
-                            // Remove gamecard certificate from buffer
-                            memset(dumpBuf + CERT_OFFSET, 0xFF, CERT_SIZE);
-                            
-                            // Update CRC32 (without gamecard certificate)
-                            crc32(dumpBuf, n, &certlessCrc);
-                            
-                            // Restore gamecard certificate to buffer
-                            memcpy(dumpBuf + CERT_OFFSET, tmpCert, CERT_SIZE);
-                        } else {
-                            // Update CRC32 (with gamecard certificate)
-                            crc32(dumpBuf, n, &certCrc);
-                            
-                            // Update CRC32 (without gamecard certificate)
-                            crc32(dumpBuf, n, &certlessCrc);
-                        }
-                    } else {
-                        // Update CRC32
-                        crc32(dumpBuf, n, &certlessCrc);
-                    }
-                } else {
-                    // Update CRC32
-                    crc32(dumpBuf, n, &certCrc);
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to the compressed output file! (0x%08X)", __func__, n, progressCtx.curOffset, cmpFile.out.lastResult);
+                    proceed = false;
+                    break;
                 }
-            }
-            
+            } else
             if ((seqDumpMode || (!seqDumpMode && progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)) && (progressCtx.curOffset + n) >= ((splitIndex + 1) * partSize))
             {
                 u64 new_file_chunk_size = ((progressCtx.curOffset + n) - ((splitIndex + 1) * partSize));
@@ -487,7 +1007,7 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
                 
                 if (old_file_chunk_size > 0)
                 {
-                    write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
+                    write_res = outFileWrite(&outFile, slot->data, old_file_chunk_size);
                     if (write_res != old_file_chunk_size)
                     {
                         uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, progressCtx.curOffset, splitIndex, write_res);
@@ -496,8 +1016,7 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
                     }
                 }
                 
-                fclose(outFile);
-                outFile = NULL;
+                outFileClose(&outFile);
                 
                 if (((seqDumpMode && !seqDumpFinish) || !seqDumpMode) && (new_file_chunk_size > 0 || (progressCtx.curOffset + n) < progressCtx.totalSize))
                 {
@@ -515,8 +1034,7 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
                         }
                     }
                     
-                    outFile = fopen(dumpPath, "wb");
-                    if (!outFile)
+                    if (!outFileCreate(&outFile, dumpPath, getOutputFileAllocSize(progressCtx.totalSize, partSize, splitIndex, true)))
                     {
                         uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
                         proceed = false;
@@ -525,7 +1043,7 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
                     
                     if (new_file_chunk_size > 0)
                     {
-                        write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
+                        write_res = outFileWrite(&outFile, slot->data + old_file_chunk_size, new_file_chunk_size);
                         if (write_res != new_file_chunk_size)
                         {
                             uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, progressCtx.curOffset + old_file_chunk_size, splitIndex, write_res);
@@ -535,12 +1053,12 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
                     }
                 }
             } else {
-                write_res = fwrite(dumpBuf, 1, n, outFile);
+                write_res = (remoteOutput ? sinkWrite(&sinkCtx, slot->data, n) : outFileWrite(&outFile, slot->data, n));
                 if (write_res != n)
                 {
                     uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
                     
-                    if (!seqDumpMode && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
+                    if (!seqDumpMode && !remoteOutput && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
                     {
                         uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable the \"Split output dump\" option.");
                         fat32_error = true;
@@ -550,41 +1068,81 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
                     break;
                 }
             }
+        }
+        
+        if (seqDumpMode) progressCtx.seqDumpCurOffset = seqDumpSessionOffset;
+        printProgressBar(&progressCtx, (n > 0), n);
+        
+        progressCtx.curOffset += n;
+        seqDumpSessionOffset += n;
+        partitionOffset += n;
+        
+        // Save a checkpoint to the dump journal every DUMP_JOURNAL_INTERVAL bytes
+        // Partition boundaries are skipped, since the reader thread can't resume from the end of a partition
+        if (journalEnabled && !lastSlot && partitionOffset < partitionSizes[partition] && dumpJournalCheckpointCrossed(progressCtx.curOffset - n, n))
+        {
+            sequentialXciCtx journalXciCtx;
+            memset(&journalXciCtx, 0, sizeof(sequentialXciCtx));
             
-            if (seqDumpMode) progressCtx.seqDumpCurOffset = seqDumpSessionOffset;
-            printProgressBar(&progressCtx, true, n);
+            journalXciCtx.keepCert = keepCert;
+            journalXciCtx.trimDump = trimDump;
+            journalXciCtx.calcCrc = calcCrc;
+            journalXciCtx.partNumber = splitIndex;
+            journalXciCtx.partitionIndex = partition;
+            journalXciCtx.partitionOffset = partitionOffset;
+            journalXciCtx.certCrc = xciPipeCtx.journalCertCrc;
+            journalXciCtx.certlessCrc = xciPipeCtx.journalCertlessCrc;
             
-            if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
-                proceed = false;
-                break;
-            }
+            journalHeader.type = DUMP_JOURNAL_TYPE_XCI;
+            journalHeader.flags = ((isFat32 ? DUMP_JOURNAL_FLAG_FAT32 : 0) | (setXciArchiveBit ? DUMP_JOURNAL_FLAG_ARCHIVE_BIT : 0));
+            journalHeader.partIndex = splitIndex;
+            journalHeader.totalSize = progressCtx.totalSize;
+            journalHeader.offset = progressCtx.curOffset;
+            journalHeader.partOffset = outFile.offset;
+            
+            dumpJournalSetTail(&journalHeader, slot->data, n);
+            
+            // A failed checkpoint doesn't affect the dump itself
+            if (outFileFlush(&outFile) && dumpJournalSave(journalFilename, &journalHeader, &journalXciCtx, sizeof(sequentialXciCtx))) journalKeep = true;
         }
         
-        closeGameCardStoragePartition();
+        // Hand the buffer back to the reader thread
+        pipelineRelease(&(xciPipeCtx.pipeCtx), slot);
         
-        if (!proceed)
+        if (lastSlot)
         {
-            if (seqDumpMode) seqDumpFileRemove = true;
+            if (progressCtx.curOffset >= progressCtx.totalSize || (seqDumpMode && seqDumpFinish)) success = true;
             break;
         }
         
-        // Support empty files
-        if (!partitionSizes[partition])
+        if (progressCtx.curOffset < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
         {
-            uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
-            
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            proceed = false;
             
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Dumping IStorage partition #%u...", partition);
+            // Canceled dumps are discarded
+            journalKeep = false;
             
-            printProgressBar(&progressCtx, false, 0);
+            break;
         }
-        
-        if (progressCtx.curOffset >= progressCtx.totalSize || (seqDumpMode && seqDumpFinish)) success = true;
-        
-        if (seqDumpMode && seqDumpFinish) break;
+    }
+    
+    // Stop the worker threads (only needed if we bailed out early) and wait for them to exit
+    pipelineAbort(&(xciPipeCtx.pipeCtx));
+    pipelineJoinWorkers(&(xciPipeCtx.pipeCtx));
+    
+    progressUiThreadStop(&progressCtx);
+    
+    if (calcCrc)
+    {
+        certCrc = xciPipeCtx.certCrc;
+        certlessCrc = xciPipeCtx.certlessCrc;
+    }
+    
+    if (!proceed)
+    {
+        success = false;
+        if (seqDumpMode) seqDumpFileRemove = true;
     }
     
     if (!proceed) setProgressBarError(&progressCtx);
@@ -592,7 +1150,30 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
     breaks = (progressCtx.line_offset + 2);
     if (fat32_error) breaks += 2;
     
-    if (outFile) fclose(outFile);
+    if (outFile.open) outFileClose(&outFile);
+    
+    if (cmpFile.open)
+    {
+        if (success)
+        {
+            // Write the remaining blocks, the block table and the file header
+            if (!cmpFileClose(&cmpFile))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to finish the compressed output file! (0x%08X)", __func__, cmpFile.out.lastResult);
+                breaks += 2;
+                success = false;
+            }
+        } else {
+            cmpFileAbort(&cmpFile);
+        }
+    }
+    
+    if (remoteOutput && success && !sinkEndFile(&sinkCtx))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the host receiver didn't acknowledge the output dump!", __func__);
+        breaks += 2;
+        success = false;
+    }
     
     if (success)
     {
@@ -634,6 +1215,17 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
         formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
         
+        journalKeep = false;
+        
+        if (compressOutput)
+        {
+            char cmpSizeStr[32] = {'\0'};
+            convertSize(cmpFile.outOffset, cmpSizeStr, MAX_CHARACTERS(cmpSizeStr));
+            
+            breaks++;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Compressed output size: %s (%.2lf%% of the dump size).", cmpSizeStr, ((double)cmpFile.outOffset * 100.0) / (double)progressCtx.totalSize);
+        }
+        
         if (seqDumpMode && seqDumpFinish)
         {
             breaks += 2;
@@ -673,10 +1265,17 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
             }
         }
         
+        if (verifyHashes)
+        {
+            breaks++;
+            verifyPrintResult(&verifyCtx);
+        }
+        
         // Set archive bit (only for FAT32 and if the required option is enabled)
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32 && setXciArchiveBit)
+        // Split compressed output files always use a directory
+        if ((compressOutput && cmpFile.split) || (!compressOutput && progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32 && setXciArchiveBit))
         {
-            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci", XCI_DUMP_PATH, dumpName);
+            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci%s", XCI_DUMP_PATH, dumpName, (compressOutput ? CMP_FILE_EXTENSION : ""));
             result = fsdevSetConcatenationFileAttribute(dumpPath);
             if (R_FAILED(result))
             {
@@ -684,7 +1283,25 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
                 uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Warning: failed to set archive bit on output directory! (0x%08X)", result);
             }
         }
-    } else {
+    } else
+    if (compressOutput)
+    {
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci" CMP_FILE_EXTENSION, XCI_DUMP_PATH, dumpName);
+        
+        if (cmpFile.split)
+        {
+            fsdevDeleteDirectoryRecursively(dumpPath);
+        } else {
+            remove(dumpPath);
+        }
+    } else
+    if (journalKeep)
+    {
+        // Keep the output file(s), so the dump can be resumed from the last checkpoint
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "The dump can be resumed from offset 0x%016lX by dumping this gamecard again.", journalHeader.offset);
+    } else
+    if (!remoteOutput)
+    {
         if (seqDumpMode)
         {
             for(u8 i = 0; i <= splitIndex; i++)
@@ -713,12 +1330,24 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
     }
     
 out:
+    perfStop("XCI", dumpName, progressCtx.totalSize, success);
+    
+    pipelineFree(&(xciPipeCtx.pipeCtx));
+    
+    cmpFileAbort(&cmpFile);
+    
+    verifyFree(&verifyCtx);
+    
+    sinkClose(&sinkCtx);
+    
     if (dumpName) free(dumpName);
     
     if (seqDumpFile) fclose(seqDumpFile);
     
     if (seqDumpFileRemove) remove(seqDumpFilename);
     
+    if (journalEnabled && !journalKeep) dumpJournalRemove(journalFilename);
+    
     breaks += 2;
     
     changeHomeButtonBlockStatus(false);
@@ -726,329 +1355,509 @@ out:
     return success;
 }
 
-int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleIndex, nspOptions *nspDumpCfg, bool batch)
+static void nspPipelineHasherThreadFunc(void *arg)
 {
-    int ret = -1;
+    nspPipelineCtx *ctx = (nspPipelineCtx*)arg;
+    pipeline_slot_t *slot = NULL;
     
-    if (!nspDumpCfg)
+    while(true)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NSP configuration struct!", __func__);
-        breaks += 2;
-        return ret;
+        slot = pipelineAcquire(&(ctx->pipeCtx), 1);
+        if (!slot) break;
+        
+        // Update SHA-256 calculation
+        if (slot->entry_idx < ctx->hashEntryCnt && slot->size)
+        {
+            u64 startTick = perfTick();
+            sha256ContextUpdate(ctx->hashCtx, slot->data, slot->size);
+            perfAdd(PERF_STAGE_HASH, startTick, slot->size);
+        }
+        
+        pipelineRelease(&(ctx->pipeCtx), slot);
     }
+}
+
+static void nspPipelineWriterThreadFunc(void *arg)
+{
+    nspPipelineCtx *ctx = (nspPipelineCtx*)arg;
+    pipeline_slot_t *slot = NULL;
     
-    bool isFat32 = nspDumpCfg->isFat32;
-    bool useNoIntroLookup = nspDumpCfg->useNoIntroLookup;
-    bool removeConsoleData = nspDumpCfg->removeConsoleData;
-    bool tiklessDump = nspDumpCfg->tiklessDump;
-    bool npdmAcidRsaPatch = nspDumpCfg->npdmAcidRsaPatch;
-    bool dumpDeltaFragments = nspDumpCfg->dumpDeltaFragments;
-    bool useBrackets = nspDumpCfg->useBrackets;
-    bool preInstall = false;
-    
-    Result result;
-    u32 i = 0, j = 0;
-    
-    NcmStorageId curStorageId;
-    NcmContentMetaType metaType;
-    u32 titleCount = 0, ncmTitleIndex = 0;
-    
-    char dumpPath[NAME_BUF_LEN] = {'\0'};
-    
-    NcmContentInfo *titleContentInfos = NULL;
-    u32 titleContentInfoCnt = 0;
-    
-    NcmContentStorage ncmStorage;
-    memset(&ncmStorage, 0, sizeof(NcmContentStorage));
-    
-    cnmt_xml_program_info xml_program_info;
-    cnmt_xml_content_info *xml_content_info = NULL;
-    
-    NcmContentId ncaId;
-    u8 ncaHeader[NCA_FULL_HEADER_LENGTH] = {0};
-    nca_header_t dec_nca_header;
-    
-    nca_cnmt_mod_data ncaCnmtMod;
-    memset(&ncaCnmtMod, 0, sizeof(nca_cnmt_mod_data));
-    
-    u32 ncaProgramModCnt = 0;
-    nca_program_mod_data *ncaProgramMod = NULL;
-    
-    title_rights_ctx rights_info;
-    memset(&rights_info, 0, sizeof(title_rights_ctx));
-    
-    u32 cnmtNcaIndex = 0;
-    u8 *cnmtNcaBuf = NULL;
-    bool cnmtFound = false;
-    char *cnmtXml = NULL;
-    
-    u32 xml_rec_cnt = 0;
-    xml_record_info *xml_records = NULL, *tmp_xml_rec = NULL;
-    
-    pfs0_header nspPfs0Header;
-    memset(&nspPfs0Header, 0, sizeof(pfs0_header));
-    nspPfs0Header.magic = __builtin_bswap32(PFS0_MAGIC);
-    
-    pfs0_file_entry *nspPfs0EntryTable = NULL;
-    
-    char *nspPfs0StrTable = NULL;
-    u64 nspPfs0StrTableSize = 0;
-    
-    u64 fullPfs0HeaderSize = 0;
-    
-    u8 **nspPfs0FilePtrs = NULL;
+    out_file_t *outFile = ctx->outFile;
+    u8 splitIndex = ctx->splitIndex;
     
-    Sha256Context nca_hash_ctx;
-    sha256ContextCreate(&nca_hash_ctx);
+    u64 n, curOffset;
+    size_t write_res;
+    bool seqDumpFinish, proceed = true;
     
-    u64 n, fileOffset;
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
-    u32 crc = 0;
-    bool proceed = true, dumping = false, fat32_error = false, removeFile = true;
-    
-    progress_ctx_t progressCtx;
-    memset(&progressCtx, 0, sizeof(progress_ctx_t));
-    
-    bool seqDumpMode = false, seqDumpFileRemove = false, seqDumpFinish = false;
-    char seqDumpFilename[NAME_BUF_LEN] = {'\0'};
-    FILE *seqDumpFile = NULL;
-    u64 seqDumpFileSize = 0, seqDumpSessionOffset = 0;
-    u8 *seqDumpNcaHashes = NULL;
-    
-    sequentialNspCtx seqNspCtx;
-    memset(&seqNspCtx, 0, sizeof(sequentialNspCtx));
-    
-    char pfs0HeaderFilename[NAME_BUF_LEN] = {'\0'};
-    FILE *pfs0HeaderFile = NULL;
-    
-    char tmp_idx[5];
-    
-    size_t read_res, write_res;
-    
-    if ((selectedNspDumpType == DUMP_APP_NSP && !baseAppEntries) || (selectedNspDumpType == DUMP_PATCH_NSP && !patchEntries) || (selectedNspDumpType == DUMP_ADDON_NSP && !addOnEntries))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: title storage ID unavailable!", __func__);
-        breaks += 2;
-        return ret;
-    }
-    
-    if ((selectedNspDumpType == DUMP_APP_NSP && titleIndex >= titleAppCount) || (selectedNspDumpType == DUMP_PATCH_NSP && titleIndex >= titlePatchCount) || (selectedNspDumpType == DUMP_ADDON_NSP && titleIndex >= titleAddOnCount))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title index!", __func__);
-        breaks += 2;
-        return ret;
-    }
-    
-    curStorageId = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].storageId : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].storageId : addOnEntries[titleIndex].storageId));
-    
-    ncmTitleIndex = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].ncmIndex : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].ncmIndex : addOnEntries[titleIndex].ncmIndex));
-    
-    metaType = (selectedNspDumpType == DUMP_APP_NSP ? NcmContentMetaType_Application : (selectedNspDumpType == DUMP_PATCH_NSP ? NcmContentMetaType_Patch : NcmContentMetaType_AddOnContent));
-    
-    switch(curStorageId)
-    {
-        case NcmStorageId_GameCard:
-            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? titleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? titlePatchCount : titleAddOnCount));
-            break;
-        case NcmStorageId_SdCard:
-            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? sdCardTitleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? sdCardTitlePatchCount : sdCardTitleAddOnCount));
-            break;
-        case NcmStorageId_BuiltInUser:
-            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? emmcTitleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? emmcTitlePatchCount : emmcTitleAddOnCount));
-            break;
-        default:
-            break;
-    }
-    
-    char *dumpName = generateNSPDumpName(selectedNspDumpType, titleIndex, useBrackets);
-    if (!dumpName)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
-        breaks += 2;
-        return ret;
-    }
-    
-    if (!batch)
+    while(proceed)
     {
-        snprintf(seqDumpFilename, MAX_CHARACTERS(seqDumpFilename), "%s%s.nsp.seq", NSP_DUMP_PATH, dumpName);
-        snprintf(pfs0HeaderFilename, MAX_CHARACTERS(pfs0HeaderFilename), "%s%s.nsp.hdr", NSP_DUMP_PATH, dumpName);
+        slot = pipelineAcquire(&(ctx->pipeCtx), 2);
+        if (!slot) break;
         
-        // Check if we're dealing with a sequential dump
-        seqDumpMode = checkIfFileExists(seqDumpFilename);
-        if (seqDumpMode)
+        n = slot->size;
+        curOffset = slot->offset;
+        seqDumpFinish = (ctx->seqDumpMode && slot->last);
+        
+        if (ctx->sink)
         {
-            // Open sequence file
-            seqDumpFile = fopen(seqDumpFilename, "rb+");
-            if (!seqDumpFile)
+            write_res = sinkWrite(ctx->sink, slot->data, n);
+            if (n > 0 && write_res != n)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to open existing sequential dump reference file for reading! (\"%s\")", __func__, seqDumpFilename);
-                goto out;
+                snprintf(ctx->errorMsg, MAX_CHARACTERS(ctx->errorMsg), "%s: failed to send %lu bytes chunk from offset 0x%016lX to the host receiver! (sent %lu bytes)", __func__, n, curOffset, write_res);
+                proceed = false;
+                break;
             }
+        } else
+        if (ctx->storeFile)
+        {
+            // NCAs go to the NCA store, and everything else is appended to the NSP manifest
+            out_file_t *dstFile = (slot->entry_idx < ctx->hashEntryCnt ? ctx->storeFile : outFile);
             
-            // Retrieve sequence file size
-            fseek(seqDumpFile, 0, SEEK_END);
-            seqDumpFileSize = ftell(seqDumpFile);
-            rewind(seqDumpFile);
-            
-            // Read sequentialNspCtx struct info
-            read_res = fread(&seqNspCtx, 1, sizeof(sequentialNspCtx), seqDumpFile);
-            if (read_res != sizeof(sequentialNspCtx))
+            write_res = outFileWrite(dstFile, slot->data, n);
+            if (n > 0 && write_res != n)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk from the sequential dump reference file! (read %lu bytes)", __func__, sizeof(sequentialNspCtx), read_res);
-                goto out;
+                snprintf(ctx->errorMsg, MAX_CHARACTERS(ctx->errorMsg), "%s: failed to write %lu bytes chunk from offset 0x%016lX to the %s! (0x%08X)", __func__, n, curOffset, (dstFile == outFile ? "NSP manifest" : "NCA store"), dstFile->lastResult);
+                proceed = false;
+                break;
             }
-            
-            // Check if the storage ID is right
-            if (seqNspCtx.storageId != curStorageId)
+        } else
+        if (ctx->cmpFile)
+        {
+            if (n > 0 && !cmpFileWrite(ctx->cmpFile, slot->data, n))
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid source storage ID in sequential dump reference file!", __func__);
-                goto out;
+                snprintf(ctx->errorMsg, MAX_CHARACTERS(ctx->errorMsg), "%s: failed to write %lu bytes chunk from offset 0x%016lX to the compressed output file! (0x%08X)", __func__, n, curOffset, ctx->cmpFile->out.lastResult);
+                proceed = false;
+                break;
             }
+        } else
+        if ((ctx->seqDumpMode || (!ctx->seqDumpMode && ctx->totalSize > FAT32_FILESIZE_LIMIT && ctx->isFat32)) && (curOffset + n) >= ((splitIndex + 1) * ctx->partSize))
+        {
+            u64 new_file_chunk_size = ((curOffset + n) - ((splitIndex + 1) * ctx->partSize));
+            u64 old_file_chunk_size = (n - new_file_chunk_size);
             
-            // Check if the Program NCA mod count field is valid
-            if (seqNspCtx.programNcaModCount > 0 && !seqNspCtx.npdmAcidRsaPatch)
+            if (old_file_chunk_size > 0)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid Program NCA mod count sequential dump reference file!", __func__);
-                seqDumpFileRemove = true;
-                goto out;
+                write_res = outFileWrite(outFile, slot->data, old_file_chunk_size);
+                if (write_res != old_file_chunk_size)
+                {
+                    snprintf(ctx->errorMsg, MAX_CHARACTERS(ctx->errorMsg), "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, curOffset, splitIndex, write_res);
+                    proceed = false;
+                    break;
+                }
             }
             
-            // Check file size
-            if (seqDumpFileSize != (sizeof(sequentialNspCtx) + (seqNspCtx.ncaCount * SHA256_HASH_SIZE) + (seqNspCtx.programNcaModCount * NCA_FULL_HEADER_LENGTH)))
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid sequential dump reference file size!", __func__);
-                seqDumpFileRemove = true;
-                goto out;
-            }
+            outFileClose(outFile);
             
-            // Allocate memory for the NCA hashes
-            seqDumpNcaHashes = calloc(1, seqNspCtx.ncaCount * SHA256_HASH_SIZE);
-            if (!seqDumpNcaHashes)
+            if (((ctx->seqDumpMode && !seqDumpFinish) || !ctx->seqDumpMode) && (new_file_chunk_size > 0 || (curOffset + n) < ctx->totalSize))
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for NCA hashes from the sequential dump reference file!", __func__);
-                goto out;
+                splitIndex++;
+                snprintf(ctx->partPath, MAX_CHARACTERS(ctx->partPath), "%s%s.nsp%c%02u", NSP_DUMP_PATH, ctx->dumpName, (ctx->seqDumpMode ? '.' : '/'), splitIndex);
+                
+                if (!outFileCreate(outFile, ctx->partPath, getOutputFileAllocSize(ctx->totalSize, ctx->partSize, splitIndex, true)))
+                {
+                    snprintf(ctx->errorMsg, MAX_CHARACTERS(ctx->errorMsg), "%s: failed to open output file for part #%u!", __func__, splitIndex);
+                    proceed = false;
+                    break;
+                }
+                
+                // The main thread picks up the new part index through nspPipelineSyncSplitIndex()
+                mutexLock(&(ctx->pipeCtx.mutex));
+                ctx->splitIndex = splitIndex;
+                mutexUnlock(&(ctx->pipeCtx.mutex));
+                
+                if (new_file_chunk_size > 0)
+                {
+                    write_res = outFileWrite(outFile, slot->data + old_file_chunk_size, new_file_chunk_size);
+                    if (write_res != new_file_chunk_size)
+                    {
+                        snprintf(ctx->errorMsg, MAX_CHARACTERS(ctx->errorMsg), "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, curOffset + old_file_chunk_size, splitIndex, write_res);
+                        proceed = false;
+                        break;
+                    }
+                }
             }
-            
-            // Read NCA hashes
-            read_res = fread(seqDumpNcaHashes, 1, seqNspCtx.ncaCount * SHA256_HASH_SIZE, seqDumpFile);
-            if (read_res != (seqNspCtx.ncaCount * SHA256_HASH_SIZE))
+        } else {
+            write_res = outFileWrite(outFile, slot->data, n);
+            if (write_res != n)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk from the sequential dump reference file! (read %lu bytes)", __func__, seqNspCtx.ncaCount * SHA256_HASH_SIZE, read_res);
-                goto out;
+                snprintf(ctx->errorMsg, MAX_CHARACTERS(ctx->errorMsg), "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, curOffset, write_res);
+                if (!ctx->seqDumpMode && (curOffset + n) > FAT32_FILESIZE_LIMIT) ctx->fat32Error = true;
+                proceed = false;
+                break;
             }
-            
-            // Restore parameters from the sequence file
-            isFat32 = true;
-            removeConsoleData = seqNspCtx.removeConsoleData;
-            tiklessDump = seqNspCtx.tiklessDump;
-            npdmAcidRsaPatch = seqNspCtx.npdmAcidRsaPatch;
-            preInstall = seqNspCtx.preInstall;
-            splitIndex = seqNspCtx.partNumber;
-            progressCtx.curOffset = ((u64)seqNspCtx.partNumber * SPLIT_FILE_SEQUENTIAL_SIZE);
         }
+        
+        pipelineRelease(&(ctx->pipeCtx), slot);
     }
     
-    u64 partSize = (seqDumpMode ? SPLIT_FILE_SEQUENTIAL_SIZE : SPLIT_FILE_NSP_PART_SIZE);
+    // Let the main thread know something went wrong
+    if (!proceed) pipelineAbort(&(ctx->pipeCtx));
+}
+
+// Called by the main thread to catch up with part files created by the writer thread
+// The output path is regenerated here instead of being shared with the writer thread
+static void nspPipelineSyncSplitIndex(nspPipelineCtx *ctx, u8 *splitIndex, char *dumpPath)
+{
+    u8 curSplitIndex;
     
-    if (!batch)
+    mutexLock(&(ctx->pipeCtx.mutex));
+    curSplitIndex = ctx->splitIndex;
+    mutexUnlock(&(ctx->pipeCtx.mutex));
+    
+    if (curSplitIndex == *splitIndex) return;
+    
+    *splitIndex = curSplitIndex;
+    snprintf(dumpPath, NAME_BUF_LEN, "%s%s.nsp%c%02u", NSP_DUMP_PATH, ctx->dumpName, (ctx->seqDumpMode ? '.' : '/'), *splitIndex);
+}
+
+static u8 getDumpedTitleOptions(bool removeConsoleData, bool tiklessDump, bool npdmAcidRsaPatch, bool dumpDeltaFragments)
+{
+    u8 options = 0;
+    
+    if (removeConsoleData) options |= DUMPED_TITLE_OPT_REMOVE_CONSOLE_DATA;
+    if (tiklessDump) options |= DUMPED_TITLE_OPT_TIKLESS_DUMP;
+    if (npdmAcidRsaPatch) options |= DUMPED_TITLE_OPT_NPDM_ACID_RSA_PATCH;
+    if (dumpDeltaFragments) options |= DUMPED_TITLE_OPT_DELTA_FRAGMENTS;
+    
+    return options;
+}
+
+static int dumpedTitleRecordCmp(const void *a, const void *b)
+{
+    const dumped_title_record_t *record1 = (const dumped_title_record_t*)a;
+    const dumped_title_record_t *record2 = (const dumped_title_record_t*)b;
+    
+    if (record1->titleId != record2->titleId) return (record1->titleId < record2->titleId ? -1 : 1);
+    if (record1->version != record2->version) return (record1->version < record2->version ? -1 : 1);
+    if (record1->flags != record2->flags) return (record1->flags < record2->flags ? -1 : 1);
+    if (record1->options != record2->options) return (record1->options < record2->options ? -1 : 1);
+    
+    return 0;
+}
+
+static void freeDumpedTitleIndex(dumped_title_index_t *index)
+{
+    if (!index) return;
+    
+    if (index->records) free(index->records);
+    
+    memset(index, 0, sizeof(dumped_title_index_t));
+}
+
+// The whole index is loaded at once, since batch mode looks up every title from it
+static void loadDumpedTitleIndex(dumped_title_index_t *index)
+{
+    if (!index) return;
+    
+    memset(index, 0, sizeof(dumped_title_index_t));
+    
+    FILE *indexFile = fopen(DUMPED_TITLES_PATH, "rb");
+    if (!indexFile) return;
+    
+    dumped_title_index_header_t header;
+    size_t read_res;
+    u64 indexFileSize;
+    u32 recordCnt;
+    
+    fseek(indexFile, 0, SEEK_END);
+    indexFileSize = (u64)ftell(indexFile);
+    rewind(indexFile);
+    
+    read_res = fread(&header, 1, sizeof(dumped_title_index_header_t), indexFile);
+    if (read_res != sizeof(dumped_title_index_header_t) || header.magic != DUMPED_TITLES_MAGIC || header.recordSize != sizeof(dumped_title_record_t))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Retrieving information from encrypted NCA content files...");
-        uiRefreshDisplay();
-        breaks += 2;
+        fclose(indexFile);
+        remove(DUMPED_TITLES_PATH);
+        return;
     }
     
-    if (!retrieveContentInfosFromTitle(curStorageId, metaType, titleCount, ncmTitleIndex, &titleContentInfos, &titleContentInfoCnt))
+    // A partially written record at the end of the file is just ignored
+    recordCnt = (u32)((indexFileSize - sizeof(dumped_title_index_header_t)) / sizeof(dumped_title_record_t));
+    if (!recordCnt)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
-        goto out;
+        fclose(indexFile);
+        return;
     }
     
-    // If we're dealing with a gamecard, open the Secure HFS0 partition (IStorage partition #1) to read NCA data
-    // We may also need to retrieve a ticket if we're dealing with a Patch with titlekey crypto
-    if (curStorageId == NcmStorageId_GameCard)
+    index->records = calloc(recordCnt, sizeof(dumped_title_record_t));
+    if (!index->records)
     {
-        result = openGameCardStoragePartition(ISTORAGE_PARTITION_SECURE);
-        if (R_FAILED(result))
-        {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to open IStorage partition #1! (0x%08X)", __func__, result);
-            goto out;
-        }
+        fclose(indexFile);
+        return;
     }
     
-    result = ncmOpenContentStorage(&ncmStorage, curStorageId);
-    if (R_FAILED(result))
+    read_res = fread(index->records, 1, recordCnt * sizeof(dumped_title_record_t), indexFile);
+    
+    fclose(indexFile);
+    
+    if (read_res != (recordCnt * sizeof(dumped_title_record_t)))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: ncmOpenContentStorage failed! (0x%08X)", __func__, result);
-        goto out;
+        freeDumpedTitleIndex(index);
+        return;
     }
     
-    // Fill information for our CNMT XML
-    memset(&xml_program_info, 0, sizeof(cnmt_xml_program_info));
-    xml_program_info.type = (u8)metaType;
-    xml_program_info.title_id = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].titleId : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].titleId : addOnEntries[titleIndex].titleId));
-    xml_program_info.version = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].version : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].version : addOnEntries[titleIndex].version));
-    xml_program_info.nca_cnt = titleContentInfoCnt;
+    index->recordCnt = recordCnt;
     
-    xml_content_info = calloc(titleContentInfoCnt, sizeof(cnmt_xml_content_info));
-    if (!xml_content_info)
+    qsort(index->records, index->recordCnt, sizeof(dumped_title_record_t), dumpedTitleRecordCmp);
+}
+
+// Split dumps are stored as directories (FAT32 archive bit) or as numbered part files (sequential dumps), so their parts are added up
+static u64 getDumpedTitleOutputSize(const char *outputName)
+{
+    if (!outputName || !*outputName) return 0;
+    
+    char outputPath[NAME_BUF_LEN] = {'\0'}, partPath[NAME_BUF_LEN] = {'\0'};
+    struct stat st;
+    u64 outputSize = 0;
+    u32 i;
+    bool splitDir;
+    
+    snprintf(outputPath, MAX_CHARACTERS(outputPath), "%s%s", NSP_DUMP_PATH, outputName);
+    
+    if (stat(outputPath, &st) == 0 && !S_ISDIR(st.st_mode)) return (u64)st.st_size;
+    
+    splitDir = (stat(outputPath, &st) == 0);
+    
+    for(i = 0; i < 100; i++)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the CNMT XML content info struct!", __func__);
-        goto out;
+        snprintf(partPath, MAX_CHARACTERS(partPath), "%s%c%02u", outputPath, (splitDir ? '/' : '.'), i);
+        if (stat(partPath, &st) != 0 || S_ISDIR(st.st_mode)) break;
+        outputSize += (u64)st.st_size;
     }
     
-    // Fill our CNMT XML content records, leaving the CNMT NCA at the end
-    u32 titleContentInfoIndex;
-    for(i = 0, titleContentInfoIndex = 0; titleContentInfoIndex < titleContentInfoCnt; i++, titleContentInfoIndex++)
+    return outputSize;
+}
+
+// Checks if the output from a dumped title record is still there, with the same size it had when the record was added
+static bool checkDumpedTitleOutput(const dumped_title_record_t *record)
+{
+    char outputName[DUMPED_TITLE_OUTPUT_NAME_LEN + 1] = {'\0'};
+    
+    if (record->outputType == DUMPED_TITLE_OUTPUT_EXTERNAL) return true;
+    if (record->outputType != DUMPED_TITLE_OUTPUT_FILE || !record->outputSize) return false;
+    
+    memcpy(outputName, record->outputName, DUMPED_TITLE_OUTPUT_NAME_LEN);
+    
+    return (getDumpedTitleOutputSize(outputName) == record->outputSize);
+}
+
+// Override records are always trusted. Any other record is only valid if its output hasn't been deleted or replaced
+static bool findDumpedTitleRecord(dumped_title_index_t *index, u64 titleId, u32 version, u8 flags, u8 options)
+{
+    if (!index || !index->records || !index->recordCnt) return false;
+    
+    dumped_title_record_t key;
+    memset(&key, 0, sizeof(dumped_title_record_t));
+    
+    key.titleId = titleId;
+    key.version = version;
+    key.flags = flags;
+    key.options = options;
+    
+    dumped_title_record_t *record = (dumped_title_record_t*)bsearch(&key, index->records, index->recordCnt, sizeof(dumped_title_record_t), dumpedTitleRecordCmp);
+    if (!record) return false;
+    
+    if (flags & DUMPED_TITLE_FLAG_OVERRIDE) return true;
+    
+    // The same title may have been dumped more than once - records with the same key are next to each other
+    while(record > index->records && dumpedTitleRecordCmp(record - 1, &key) == 0) record--;
+    
+    for(; record < (index->records + index->recordCnt) && dumpedTitleRecordCmp(record, &key) == 0; record++)
     {
-        if (!cnmtFound && titleContentInfos[titleContentInfoIndex].content_type == NcmContentType_Meta)
-        {
-            cnmtFound = true;
-            cnmtNcaIndex = titleContentInfoIndex;
-            i--;
-            continue;
+        if (checkDumpedTitleOutput(record)) return true;
+    }
+    
+    return false;
+}
+
+static void appendDumpedTitleRecord(const dumped_title_record_t *record)
+{
+    if (!record) return;
+    
+    dumped_title_index_header_t header;
+    size_t read_res, write_res;
+    u64 indexFileSize, validSize;
+    
+    FILE *indexFile = fopen(DUMPED_TITLES_PATH, "ab+");
+    if (!indexFile) return;
+    
+    fseek(indexFile, 0, SEEK_END);
+    indexFileSize = (u64)ftell(indexFile);
+    
+    if (indexFileSize)
+    {
+        rewind(indexFile);
+        read_res = fread(&header, 1, sizeof(dumped_title_index_header_t), indexFile);
+        
+        if (read_res != sizeof(dumped_title_index_header_t) || header.magic != DUMPED_TITLES_MAGIC || header.recordSize != sizeof(dumped_title_record_t))
+        {
+            // Start over if the index is corrupted
+            fclose(indexFile);
+            
+            indexFile = fopen(DUMPED_TITLES_PATH, "wb");
+            if (!indexFile) return;
+            
+            indexFileSize = 0;
+        } else {
+            // Get rid of a partially written record, so the new one stays aligned with the rest
+            validSize = (sizeof(dumped_title_index_header_t) + (((indexFileSize - sizeof(dumped_title_index_header_t)) / sizeof(dumped_title_record_t)) * sizeof(dumped_title_record_t)));
+            if (validSize != indexFileSize)
+            {
+                fflush(indexFile);
+                if (ftruncate(fileno(indexFile), (off_t)validSize) != 0)
+                {
+                    fclose(indexFile);
+                    remove(DUMPED_TITLES_PATH);
+                    return;
+                }
+            }
         }
+    }
+    
+    if (!indexFileSize)
+    {
+        header.magic = DUMPED_TITLES_MAGIC;
+        header.recordSize = sizeof(dumped_title_record_t);
         
-        // Skip Delta Fragments and/or any other unknown content types (only if the related option is disabled)
-        // Delta Fragments are used to update from a certain version to another version without needing to install the whole update
-        // For any dumping purposes, they're useless, because they just increase the size of the output dump. The more updates come out for a title, the more Delta Fragments there will be available for that title
-        // Also, since they're basically an eShop thing, they're not available in gamecards (so in this particular case, we need to skip them anyway)
-        // However, their content records must be kept intact in the CNMT NCA
-        if (titleContentInfos[titleContentInfoIndex].content_type >= NcmContentType_DeltaFragment && !dumpDeltaFragments)
+        write_res = fwrite(&header, 1, sizeof(dumped_title_index_header_t), indexFile);
+        if (write_res != sizeof(dumped_title_index_header_t))
         {
-            xml_program_info.nca_cnt--;
-            i--;
-            continue;
+            fclose(indexFile);
+            remove(DUMPED_TITLES_PATH);
+            return;
+        }
+    }
+    
+    fwrite(record, 1, sizeof(dumped_title_record_t), indexFile);
+    
+    fclose(indexFile);
+}
+
+static int dirNameCmp(const void *a, const void *b)
+{
+    return strcasecmp(*(char* const*)a, *(char* const*)b);
+}
+
+static void freeDirNameList(dir_name_list_t *list)
+{
+    if (!list) return;
+    
+    u32 i;
+    
+    if (list->names)
+    {
+        for(i = 0; i < list->nameCnt; i++) free(list->names[i]);
+        free(list->names);
+    }
+    
+    memset(list, 0, sizeof(dir_name_list_t));
+}
+
+// A single directory listing is a lot cheaper than checking each path on its own
+static void loadDirNameList(const char *path, dir_name_list_t *list)
+{
+    if (!path || !list) return;
+    
+    memset(list, 0, sizeof(dir_name_list_t));
+    
+    DIR *dir = opendir(path);
+    if (!dir) return;
+    
+    struct dirent *entry = NULL;
+    char **tmpNames = NULL;
+    u32 nameCapacity = 0;
+    
+    while((entry = readdir(dir)) != NULL)
+    {
+        if (list->nameCnt == nameCapacity)
+        {
+            nameCapacity = (nameCapacity ? (nameCapacity * 2) : 64);
+            
+            tmpNames = realloc(list->names, nameCapacity * sizeof(char*));
+            if (!tmpNames) break;
+            
+            list->names = tmpNames;
+            tmpNames = NULL;
         }
         
-        // Fill information for our CNMT XML
-        xml_content_info[i].type = titleContentInfos[titleContentInfoIndex].content_type;
-        memcpy(xml_content_info[i].nca_id, titleContentInfos[titleContentInfoIndex].content_id.c, SHA256_HASH_SIZE / 2); // Temporary
-        convertDataToHexString(titleContentInfos[titleContentInfoIndex].content_id.c, SHA256_HASH_SIZE / 2, xml_content_info[i].nca_id_str, SHA256_HASH_SIZE + 1); // Temporary
-        convertNcaSizeToU64(titleContentInfos[titleContentInfoIndex].size, &(xml_content_info[i].size));
-        xml_content_info[i].id_offset = titleContentInfos[titleContentInfoIndex].id_offset;
-        convertDataToHexString(xml_content_info[i].hash, SHA256_HASH_SIZE, xml_content_info[i].hash_str, (SHA256_HASH_SIZE * 2) + 1); // Temporary
+        list->names[list->nameCnt] = strdup(entry->d_name);
+        if (!list->names[list->nameCnt]) break;
         
-        memcpy(&ncaId, &(titleContentInfos[titleContentInfoIndex].content_id), sizeof(NcmContentId));
+        list->nameCnt++;
+    }
+    
+    closedir(dir);
+    
+    if (list->nameCnt) qsort(list->names, list->nameCnt, sizeof(char*), dirNameCmp);
+}
+
+static bool findDirName(dir_name_list_t *list, const char *name)
+{
+    if (!list || !list->names || !list->nameCnt || !name) return false;
+    
+    return (bsearch(&name, list->names, list->nameCnt, sizeof(char*), dirNameCmp) != NULL);
+}
+
+static void nspBatchPrefetchThreadFunc(void *arg)
+{
+    nspBatchPrefetchCtx *ctx = (nspBatchPrefetchCtx*)arg;
+    
+    Result result;
+    u32 i, j;
+    
+    char errorMsg[NAME_BUF_LEN] = {'\0'};
+    
+    NcmContentInfo *titleContentInfos = NULL;
+    u32 titleContentInfoCnt = 0;
+    
+    NcmContentStorage ncmStorage;
+    memset(&ncmStorage, 0, sizeof(NcmContentStorage));
+    
+    u8 ncaHeader[NCA_FULL_HEADER_LENGTH] = {0};
+    nca_header_t dec_nca_header;
+    u8 decrypted_nca_keys[NCA_KEY_AREA_SIZE];
+    bool has_rights_id, cachedHeader, cachedKeyArea;
+    
+    Aes128XtsContext hdr_aes_ctx;
+    bool parseSections = (nca_keyset.total_key_cnt > 0);
+    
+    // Nothing is reported from this thread - any errors will show up once the main thread gets to this title
+    if (!retrieveContentInfosFromTitleEx(ctx->storageId, ctx->metaType, ctx->titleCount, ctx->ncmTitleIndex, &titleContentInfos, &titleContentInfoCnt, errorMsg, MAX_CHARACTERS(errorMsg))) return;
+    
+    result = ncmOpenContentStorage(&ncmStorage, ctx->storageId);
+    if (R_FAILED(result))
+    {
+        free(titleContentInfos);
+        return;
+    }
+    
+    if (parseSections) aes128XtsContextCreate(&hdr_aes_ctx, nca_keyset.header_key, nca_keyset.header_key + 0x10, false);
+    
+    for(i = 0; i < titleContentInfoCnt; i++)
+    {
+        NcmContentInfo *contentInfo = &(titleContentInfos[i]);
+        u64 contentSize = 0;
         
-        if (!readNcaDataByContentId(&ncmStorage, &ncaId, 0, ncaHeader, NCA_FULL_HEADER_LENGTH))
-        {
-            breaks++;
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read header from NCA \"%s\"!", __func__, xml_content_info[i].nca_id_str);
-            proceed = false;
-            break;
-        }
+        if (contentInfo->content_type >= NcmContentType_DeltaFragment && !ctx->dumpDeltaFragments) continue;
         
-        // Decrypt the NCA header
-        // Don't retrieve the ticket and/or titlekey if we're dealing with a Patch with titlekey crypto bundled with the inserted gamecard
-        if (!decryptNcaHeader(ncaHeader, NCA_FULL_HEADER_LENGTH, &dec_nca_header, &rights_info, xml_content_info[i].decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard)))
+        convertNcaSizeToU64(contentInfo->size, &contentSize);
+        if (contentSize < NCA_FULL_HEADER_LENGTH) continue;
+        
+        // The CNMT NCA is read in its entirety by dumpNintendoSubmissionPackage()
+        if (contentInfo->content_type == NcmContentType_Meta)
         {
-            proceed = false;
-            break;
+            ncaCachePrefetch(&ncmStorage, &(contentInfo->content_id), contentSize, 0, NULL, (contentSize <= NCA_CACHE_MAX_CACHED_READ ? contentSize : NCA_FULL_HEADER_LENGTH));
+            continue;
         }
         
-        // Check if this particular content has a populated Rights ID field
-        bool has_rights_id = false;
+        if (!ncaCachePrefetch(&ncmStorage, &(contentInfo->content_id), contentSize, 0, ncaHeader, NCA_FULL_HEADER_LENGTH) || !parseSections) continue;
+        
+        if (aes128XtsNintendoCrypt(&hdr_aes_ctx, &dec_nca_header, ncaHeader, NCA_FULL_HEADER_LENGTH, 0, false) != NCA_FULL_HEADER_LENGTH || __builtin_bswap32(dec_nca_header.magic) != NCA3_MAGIC) continue;
+        
+        // Hand the decrypted header and key area over to decryptNcaHeader() through the NCA metadata cache, so the main thread skips both the AES-XTS pass and the spl:crypto round trips
+        // Titlekeys still get retrieved by the main thread, since the ticket lookup draws on screen and may prompt the user
+        has_rights_id = cachedKeyArea = false;
+        cachedHeader = ncaMetaCacheGetHeader(&(contentInfo->content_id), &dec_nca_header, NULL, &cachedKeyArea);
         
         for(j = 0; j < 0x10; j++)
         {
@@ -1059,1988 +1868,4260 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
             }
         }
         
-        // Check if the missing ticket flag is enabled
-        // If so, we may be dealing with a preinstalled title
-        if (curStorageId != NcmStorageId_GameCard && has_rights_id && rights_info.missing_tik && !preInstall)
+        if (has_rights_id)
         {
-            // Only display the pre-install prompt if we're not running a batch / sequential dump operation (excluding the first run of the latter)
-            if (!batch && !seqDumpMode)
-            {
-                int cur_breaks = breaks;
-                breaks += 2;
-                
-                proceed = yesNoPrompt("This is probably a pre-installed title, which explains why a ticket for it couldn't be found (even though its Rights ID field isn't empty).\nDo you want to proceed with the dump procedure anyway?\nBear in mind that no content decryption will be possible for this title in its current status.");
-                if (!proceed)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
-                    break;
-                } else {
-                    breaks = cur_breaks;
-                    preInstall = true;
-                }
-            }
-            
-            // Remove the prompt / error from the screen
-            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+            if (!cachedHeader) ncaMetaCacheStoreHeader(&(contentInfo->content_id), &dec_nca_header, NULL);
+        } else
+        if (!cachedKeyArea && decryptNcaKeyAreaEx(&dec_nca_header, decrypted_nca_keys, errorMsg, MAX_CHARACTERS(errorMsg)))
+        {
+            ncaMetaCacheStoreHeader(&(contentInfo->content_id), &dec_nca_header, decrypted_nca_keys);
         }
         
-        // Fill information for our CNMT XML
-        xml_content_info[i].keyblob = (dec_nca_header.crypto_type2 > dec_nca_header.crypto_type ? dec_nca_header.crypto_type2 : dec_nca_header.crypto_type);
+        // Only these NCAs get their sections parsed before the NSP data is written
+        if (contentInfo->content_type != NcmContentType_Program && contentInfo->content_type != NcmContentType_Control && contentInfo->content_type != NcmContentType_LegalInformation) continue;
         
-        if (curStorageId == NcmStorageId_GameCard)
+        for(j = 0; j < NCA_SECTION_HEADER_CNT; j++)
         {
-            // Modify content distribution type
-            // It's always set to 1 (gamecard) in Applications and Add-Ons bundled in gamecards
-            // It's always set to 0 (download) in Patches bundled in gamecards. But if we're dealing with a custom XCI mounted through SX OS, we may need to change that
-            dec_nca_header.distribution = 0;
+            nca_fs_header_t *fs_header = &(dec_nca_header.fs_headers[j]);
             
-            if (selectedNspDumpType == DUMP_APP_NSP || selectedNspDumpType == DUMP_ADDON_NSP) 
+            u64 section_offset = ((u64)dec_nca_header.section_entries[j].media_start_offset * (u64)MEDIA_UNIT_SIZE);
+            u64 section_end = ((u64)dec_nca_header.section_entries[j].media_end_offset * (u64)MEDIA_UNIT_SIZE);
+            u64 data_offset = 0, data_size = 0;
+            
+            if (!section_offset || section_end <= section_offset || section_end > contentSize) continue;
+            
+            if (fs_header->partition_type == NCA_FS_HEADER_PARTITION_PFS0 && fs_header->fs_type == NCA_FS_HEADER_FSTYPE_PFS0)
             {
-                // Application and AddOn titles don't have a populated Rights ID field when bundled in gamecards
-                if (has_rights_id)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: Rights ID field in NCA header not empty!", __func__);
-                    proceed = false;
-                    break;
-                }
-                
-                // Patch ACID public RSA key and recreate the NCA NPDM signature if we're dealing with the Program NCA
-                if (xml_content_info[i].type == NcmContentType_Program && npdmAcidRsaPatch)
-                {
-                    if (!processProgramNca(&ncmStorage, &ncaId, &dec_nca_header, &(xml_content_info[i]), &ncaProgramMod, &ncaProgramModCnt, i))
-                    {
-                        proceed = false;
-                        break;
-                    }
-                }
+                data_offset = (section_offset + fs_header->pfs0_superblock.pfs0_offset);
             } else
-            if (selectedNspDumpType == DUMP_PATCH_NSP)
-            {
-                // Patch titles *do* have a populated Rights ID field and a ticket + certificate chain combination when bundled in gamecards
-                // Depending on the dump settings, we may need to change or remove that
-                // If no Rights ID is available, we may be dealing with a custom XCI mounted through SX OS. In this particular case, no further modifications should be needed
-                if (has_rights_id)
-                {
-                    // Retrieve the ticket from the HFS0 partition in the gamecard
-                    if (!retrieveTitleKeyFromGameCardTicket(&rights_info, xml_content_info[i].decrypted_nca_keys))
-                    {
-                        proceed = false;
-                        break;
-                    }
-                    
-                    // Mess with the NCA header if we're dealing with a NCA with a populated Rights ID field and if tiklessDump is true (removeConsoleData is ignored)
-                    if (tiklessDump)
-                    {
-                        // Generate new encrypted NCA key area using titlekey
-                        if (!generateEncryptedNcaKeyAreaWithTitlekey(&dec_nca_header, xml_content_info[i].decrypted_nca_keys))
-                        {
-                            proceed = false;
-                            break;
-                        }
-                        
-                        // Remove Rights ID from NCA
-                        memset(dec_nca_header.rights_id, 0, 0x10);
-                        
-                        // Patch ACID pubkey and recreate NCA NPDM signature if we're dealing with the Program NCA
-                        if (xml_content_info[i].type == NcmContentType_Program && npdmAcidRsaPatch)
-                        {
-                            if (!processProgramNca(&ncmStorage, &ncaId, &dec_nca_header, &(xml_content_info[i]), &ncaProgramMod, &ncaProgramModCnt, i))
-                            {
-                                proceed = false;
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
-        } else
-        if (curStorageId == NcmStorageId_SdCard || curStorageId == NcmStorageId_BuiltInUser)
-        {
-            // Only mess with the NCA header if we're dealing with a content with a populated Rights ID field, and if both removeConsoleData and tiklessDump are true
-            // This will only be done if we were able to retrieve the ticket for this title
-            if (has_rights_id && rights_info.retrieved_tik && removeConsoleData && tiklessDump)
-            {
-                // Generate new encrypted NCA key area using titlekey
-                if (!generateEncryptedNcaKeyAreaWithTitlekey(&dec_nca_header, xml_content_info[i].decrypted_nca_keys))
-                {
-                    proceed = false;
-                    break;
-                }
-                
-                // Remove rights ID from NCA
-                memset(dec_nca_header.rights_id, 0, 0x10);
-                
-                // Patch ACID pubkey and recreate NCA NPDM signature if we're dealing with the Program NCA
-                if (xml_content_info[i].type == NcmContentType_Program && npdmAcidRsaPatch)
-                {
-                    if (!processProgramNca(&ncmStorage, &ncaId, &dec_nca_header, &(xml_content_info[i]), &ncaProgramMod, &ncaProgramModCnt, i))
-                    {
-                        proceed = false;
-                        break;
-                    }
-                }
-            }
-        }
-        
-        if ((!has_rights_id || (has_rights_id && rights_info.retrieved_tik)) && (xml_content_info[i].type == NcmContentType_Program || xml_content_info[i].type == NcmContentType_Control || xml_content_info[i].type == NcmContentType_LegalInformation))
-        {
-            // Reallocate XML records
-            tmp_xml_rec = realloc(xml_records, (xml_rec_cnt + 1) * sizeof(xml_record_info));
-            if (!tmp_xml_rec)
+            if (fs_header->partition_type == NCA_FS_HEADER_PARTITION_ROMFS && fs_header->fs_type == NCA_FS_HEADER_FSTYPE_ROMFS)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: error reallocating XML records buffer!", __func__);
-                proceed = false;
-                break;
+                data_offset = (section_offset + fs_header->romfs_superblock.ivfc_header.level_headers[IVFC_MAX_LEVEL - 1].logical_offset);
+            } else {
+                continue;
             }
             
-            xml_records = tmp_xml_rec;
-            tmp_xml_rec = NULL;
-            
-            memset(&(xml_records[xml_rec_cnt]), 0, sizeof(xml_record_info));
-            xml_records[xml_rec_cnt].nca_index = i;
+            if (data_offset < section_offset || data_offset >= section_end) continue;
             
-            xml_rec_cnt++;
+            data_size = (section_end - data_offset);
+            if (data_size > NSP_BATCH_PREFETCH_SECTION_SIZE) data_size = NSP_BATCH_PREFETCH_SECTION_SIZE;
             
-            // Generate programinfo.xml
-            if (xml_content_info[i].type == NcmContentType_Program)
-            {
-                bool use_acid_pubkey = false;
-                
-                for(j = 0; j < ncaProgramModCnt; j++)
-                {
-                    if (ncaProgramMod[j].nca_index == i)
-                    {
-                        use_acid_pubkey = true;
-                        break;
-                    }
-                }
-                
-                if (!generateProgramInfoXml(&ncmStorage, &ncaId, &dec_nca_header, xml_content_info[i].decrypted_nca_keys, use_acid_pubkey, &(xml_records[xml_rec_cnt - 1].xml_data), &(xml_records[xml_rec_cnt - 1].xml_size)))
-                {
-                    proceed = false;
-                    break;
-                }
-            }
-            
-            // Retrieve NACP data (XML and icons)
-            if (xml_content_info[i].type == NcmContentType_Control)
-            {
-                if (!retrieveNacpDataFromNca(&ncmStorage, &ncaId, &dec_nca_header, xml_content_info[i].decrypted_nca_keys, &(xml_records[xml_rec_cnt - 1].xml_data), &(xml_records[xml_rec_cnt - 1].xml_size), &(xml_records[xml_rec_cnt - 1].nacp_icons), &(xml_records[xml_rec_cnt - 1].nacp_icon_cnt)))
-                {
-                    proceed = false;
-                    break;
-                }
-            }
-            
-            // Retrieve legalinfo.xml
-            if (xml_content_info[i].type == NcmContentType_LegalInformation)
-            {
-                if (!retrieveLegalInfoXmlFromNca(&ncmStorage, &ncaId, &dec_nca_header, xml_content_info[i].decrypted_nca_keys, &(xml_records[xml_rec_cnt - 1].xml_data), &(xml_records[xml_rec_cnt - 1].xml_size)))
-                {
-                    proceed = false;
-                    break;
-                }
-            }
+            ncaCachePrefetch(&ncmStorage, &(contentInfo->content_id), contentSize, data_offset, NULL, data_size);
         }
-        
-        // Reencrypt header
-        if (!encryptNcaHeader(&dec_nca_header, xml_content_info[i].encrypted_header_mod, NCA_FULL_HEADER_LENGTH))
-        {
-            proceed = false;
+    }
+    
+    ncmContentStorageClose(&ncmStorage);
+    
+    free(titleContentInfos);
+}
+
+// Gamecard titles are skipped, since their NCAs are read through the global IStorage handle
+static bool setupNspBatchPrefetch(nspBatchPrefetchCtx *ctx, nspDumpType selectedNspDumpType, u32 titleIndex, bool dumpDeltaFragments)
+{
+    if (!ctx) return false;
+    
+    memset(ctx, 0, sizeof(nspBatchPrefetchCtx));
+    
+    ctx->storageId = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].storageId : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].storageId : addOnEntries[titleIndex].storageId));
+    ctx->ncmTitleIndex = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].ncmIndex : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].ncmIndex : addOnEntries[titleIndex].ncmIndex));
+    ctx->metaType = (selectedNspDumpType == DUMP_APP_NSP ? NcmContentMetaType_Application : (selectedNspDumpType == DUMP_PATCH_NSP ? NcmContentMetaType_Patch : NcmContentMetaType_AddOnContent));
+    ctx->dumpDeltaFragments = dumpDeltaFragments;
+    
+    switch(ctx->storageId)
+    {
+        case NcmStorageId_SdCard:
+            ctx->titleCount = (selectedNspDumpType == DUMP_APP_NSP ? sdCardTitleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? sdCardTitlePatchCount : sdCardTitleAddOnCount));
+            break;
+        case NcmStorageId_BuiltInUser:
+            ctx->titleCount = (selectedNspDumpType == DUMP_APP_NSP ? emmcTitleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? emmcTitlePatchCount : emmcTitleAddOnCount));
+            break;
+        default:
             break;
-        }
     }
     
-    if (!proceed) goto out;
+    return (ctx->titleCount > 0);
+}
+
+int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleIndex, nspOptions *nspDumpCfg, bool batch)
+{
+    int ret = -1;
     
-    if (proceed && !cnmtFound)
+    if (!nspDumpCfg)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to find CNMT NCA!", __func__);
-        goto out;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NSP configuration struct!", __func__);
+        breaks += 2;
+        return ret;
     }
     
-    // Update NCA counter just in case we found any delta fragments and excluded them
-    titleContentInfoCnt = xml_program_info.nca_cnt;
+    bool isFat32 = nspDumpCfg->isFat32;
+    bool useNoIntroLookup = nspDumpCfg->useNoIntroLookup;
+    bool removeConsoleData = nspDumpCfg->removeConsoleData;
+    bool tiklessDump = nspDumpCfg->tiklessDump;
+    bool npdmAcidRsaPatch = nspDumpCfg->npdmAcidRsaPatch;
+    bool dumpDeltaFragments = nspDumpCfg->dumpDeltaFragments;
+    bool useBrackets = nspDumpCfg->useBrackets;
+    bool compressOutput = nspDumpCfg->compressOutput;
+    dumpOutputTarget outputTarget = nspDumpCfg->outputTarget;
+    bool preInstall = false;
     
-    // Fill information for our CNMT XML
-    xml_content_info[titleContentInfoCnt - 1].type = titleContentInfos[cnmtNcaIndex].content_type;
-    memcpy(xml_content_info[titleContentInfoCnt - 1].nca_id, titleContentInfos[cnmtNcaIndex].content_id.c, SHA256_HASH_SIZE / 2); // Temporary
-    convertDataToHexString(titleContentInfos[cnmtNcaIndex].content_id.c, SHA256_HASH_SIZE / 2, xml_content_info[titleContentInfoCnt - 1].nca_id_str, SHA256_HASH_SIZE + 1); // Temporary
-    convertNcaSizeToU64(titleContentInfos[cnmtNcaIndex].size, &(xml_content_info[titleContentInfoCnt - 1].size));
-    xml_content_info[titleContentInfoCnt - 1].id_offset = titleContentInfos[cnmtNcaIndex].id_offset;
-    convertDataToHexString(xml_content_info[titleContentInfoCnt - 1].hash, SHA256_HASH_SIZE, xml_content_info[titleContentInfoCnt - 1].hash_str, (SHA256_HASH_SIZE * 2) + 1); // Temporary
+    // USB / TCP dumps are streamed to a host receiver as a single file. Batch dumps are always written to the SD card
+    bool remoteOutput = (!batch && (outputTarget == DUMP_OUTPUT_USB || outputTarget == DUMP_OUTPUT_TCP));
     
-    memcpy(&ncaId, &(titleContentInfos[cnmtNcaIndex].content_id), sizeof(NcmContentId));
+    sink_ctx_t sinkCtx;
+    memset(&sinkCtx, 0, sizeof(sink_ctx_t));
     
-    // Update CNMT index
-    cnmtNcaIndex = (titleContentInfoCnt - 1);
+    u64 resumeOffset = 0;
     
-    cnmtNcaBuf = malloc(xml_content_info[cnmtNcaIndex].size);
-    if (!cnmtNcaBuf)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for CNMT NCA data!", __func__);
-        goto out;
-    }
+    nca_store_t *ncaStore = (batch ? nspNcaStore : NULL);
     
-    if (!readNcaDataByContentId(&ncmStorage, &ncaId, 0, cnmtNcaBuf, xml_content_info[cnmtNcaIndex].size))
-    {
-        breaks++;
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read CNMT NCA \"%s\"!", __func__, xml_content_info[cnmtNcaIndex].nca_id_str);
-        goto out;
-    }
+    // Every buffer built for this NSP (content info, XML files, icons, CNMT NCA and PFS0 header data) is allocated from here and released at once
+    mem_arena_t dumpArena;
+    arenaInit(&dumpArena, 0);
     
-    // Retrieve CNMT NCA data
-    if (!retrieveCnmtNcaData(curStorageId, cnmtNcaBuf, &xml_program_info, xml_content_info, cnmtNcaIndex, &ncaCnmtMod, &rights_info)) goto out;
+    // Output file extension, if we're not dealing with a sequential dump
+    const char *dumpExt = (ncaStore ? NSP_MANIFEST_EXTENSION : (compressOutput ? ".nsp" CMP_FILE_EXTENSION : ".nsp"));
     
-    // Generate a placeholder CNMT XML. It's length will be used to calculate the final output dump size
+    Result result;
+    u32 i = 0, j = 0;
     
-    // Make sure that the output buffer for our CNMT XML is big enough
-    cnmtXml = calloc(NSP_XML_BUFFER_SIZE, sizeof(char));
-    if (!cnmtXml)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the CNMT XML!", __func__);
-        goto out;
-    }
+    NcmStorageId curStorageId;
+    NcmContentMetaType metaType;
+    u32 titleCount = 0, ncmTitleIndex = 0;
     
-    generateCnmtXml(&xml_program_info, xml_content_info, cnmtXml);
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
     
-    bool includeTikAndCert = (rights_info.retrieved_tik && !tiklessDump);
+    NcmContentInfo *titleContentInfos = NULL;
+    u32 titleContentInfoCnt = 0;
     
-    if (includeTikAndCert)
-    {
-        // Only mess with the ticket data if removeConsoleData is true, if tiklessDump is false and if we're dealing with a personalized ticket (checked in removeConsoleDataFromTicket())
-        // Ticket files from Patch titles bundled with gamecards always use common titlekey crypto
-        if ((curStorageId == NcmStorageId_SdCard || curStorageId == NcmStorageId_BuiltInUser) && removeConsoleData) removeConsoleDataFromTicket(&rights_info);
-        
-        // Retrieve cert file
-        if (!retrieveCertData(rights_info.cert_data, (rights_info.tik_data.titlekey_type == ETICKET_TITLEKEY_PERSONALIZED)))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
-            goto out;
-        }
-        
-        // File count = NCA count + CNMT XML + tik + cert
-        nspPfs0Header.file_cnt = (titleContentInfoCnt + 3);
-        
-        // Calculate PFS0 String Table size
-        nspPfs0StrTableSize = (((nspPfs0Header.file_cnt - 4) * NSP_NCA_FILENAME_LENGTH) + (NSP_CNMT_FILENAME_LENGTH * 2) + NSP_TIK_FILENAME_LENGTH + NSP_CERT_FILENAME_LENGTH);
-    } else {
-        // File count = NCA count + CNMT XML
-        nspPfs0Header.file_cnt = (titleContentInfoCnt + 1);
-        
-        // Calculate PFS0 String Table size
-        nspPfs0StrTableSize = (((nspPfs0Header.file_cnt - 2) * NSP_NCA_FILENAME_LENGTH) + (NSP_CNMT_FILENAME_LENGTH * 2));
-    }
+    NcmContentStorage ncmStorage;
+    memset(&ncmStorage, 0, sizeof(NcmContentStorage));
     
-    // Add our XML records
-    if (xml_rec_cnt)
-    {
-        for(i = 0; i < xml_rec_cnt; i++)
-        {
-            if (!xml_records[i].xml_data || !xml_records[i].xml_size) continue;
-            
-            nspPfs0Header.file_cnt++;
-            u8 type = xml_content_info[xml_records[i].nca_index].type;
-            nspPfs0StrTableSize += (type == NcmContentType_Program ? NSP_PROGRAM_XML_FILENAME_LENGTH : (type == NcmContentType_Control ? NSP_NACP_XML_FILENAME_LENGTH : NSP_LEGAL_XML_FILENAME_LENGTH));
-            progressCtx.totalSize += xml_records[i].xml_size;
-            
-            // Add icons if we retrieved them
-            if (type == NcmContentType_Control && xml_records[i].nacp_icons && xml_records[i].nacp_icon_cnt)
-            {
-                for(j = 0; j < xml_records[i].nacp_icon_cnt; j++)
-                {
-                    nspPfs0Header.file_cnt++;
-                    nspPfs0StrTableSize += (u32)(strlen(xml_records[i].nacp_icons[j].filename) + 1);
-                    progressCtx.totalSize += xml_records[i].nacp_icons[j].icon_size;
-                }
-            }
-        }
-    }
+    cnmt_xml_program_info xml_program_info;
+    cnmt_xml_content_info *xml_content_info = NULL;
     
-    // Start NSP creation
-    nspPfs0EntryTable = calloc(nspPfs0Header.file_cnt, sizeof(pfs0_file_entry));
-    if (!nspPfs0EntryTable)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the PFS0 file entries!", __func__);
-        goto out;
-    }
+    NcmContentId ncaId;
+    u8 ncaHeader[NCA_FULL_HEADER_LENGTH] = {0};
+    nca_header_t dec_nca_header;
     
-    // Make sure we have enough space
-    nspPfs0StrTable = calloc(nspPfs0StrTableSize * 2, sizeof(char));
-    if (!nspPfs0StrTable)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the PFS0 string table!", __func__);
-        goto out;
-    }
+    nca_cnmt_mod_data ncaCnmtMod;
+    memset(&ncaCnmtMod, 0, sizeof(nca_cnmt_mod_data));
     
-    // Determine our full NSP header size
-    fullPfs0HeaderSize = (sizeof(pfs0_header) + ((u64)nspPfs0Header.file_cnt * sizeof(pfs0_file_entry)) + nspPfs0StrTableSize);
+    u32 ncaProgramModCnt = 0;
+    nca_program_mod_data *ncaProgramMod = NULL;
     
-    // Round up our full NSP header size to a 0x10-byte boundary
-    if (!(fullPfs0HeaderSize % 0x10)) fullPfs0HeaderSize++; // If it's already rounded, add more padding
-    fullPfs0HeaderSize = round_up(fullPfs0HeaderSize, 0x10);
+    title_rights_ctx rights_info;
+    memset(&rights_info, 0, sizeof(title_rights_ctx));
     
-    // Determine our String Table size
-    nspPfs0Header.str_table_size = (fullPfs0HeaderSize - (sizeof(pfs0_header) + ((u64)nspPfs0Header.file_cnt * sizeof(pfs0_file_entry))));
+    u32 cnmtNcaIndex = 0;
+    u8 *cnmtNcaBuf = NULL;
+    bool cnmtFound = false;
+    char *cnmtXml = NULL;
     
-    // Allocate memory for PFS0 file data pointer array. Exclude all NCAs but the CNMT NCA
-    nspPfs0FilePtrs = calloc(nspPfs0Header.file_cnt - (titleContentInfoCnt - 1), sizeof(u8*));
-    if (!nspPfs0FilePtrs)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the PFS0 file data pointer array!", __func__);
-        goto out;
-    }
+    u32 xml_rec_cnt = 0;
+    xml_record_info *xml_records = NULL;
     
-    // Fill PFS0 entry table
-    // PFS0 string table will be filled at a later time
-    u64 curFileOffset = 0;
-    u32 curFilenameOffset = 0;
+    cmp_file_crypto_region *cmpRegions = NULL;
+    u32 cmpRegionCnt = 0;
     
-    u64 entrySize = 0;
-    u32 entryFilenameSize = 0;
+    pfs0_header nspPfs0Header;
+    memset(&nspPfs0Header, 0, sizeof(pfs0_header));
+    nspPfs0Header.magic = __builtin_bswap32(PFS0_MAGIC);
     
-    u32 entryIdx = 0, ptrIdx = 0;
+    pfs0_file_entry *nspPfs0EntryTable = NULL;
     
-    for(i = 0; i <= titleContentInfoCnt; i++, entryIdx++)
-    {
-        if (i < titleContentInfoCnt)
-        {
-            // Always reserve the first titleContentInfoCnt entries for our NCAs
-            // Only save the CNMT NCA buffer pointer to the PFS0 file data pointer array. We don't have any other pointers to raw NCA data, so we leave the rest untouched
-            entrySize = xml_content_info[i].size;
-            entryFilenameSize = (i == cnmtNcaIndex ? NSP_CNMT_FILENAME_LENGTH : NSP_NCA_FILENAME_LENGTH);
-            if (i == cnmtNcaIndex) nspPfs0FilePtrs[ptrIdx++] = cnmtNcaBuf;
-        } else {
-            // Reserve the entry right after our NCAs for the CNMT XML
-            entrySize = strlen(cnmtXml);
-            entryFilenameSize = NSP_CNMT_FILENAME_LENGTH;
-            nspPfs0FilePtrs[ptrIdx++] = (u8*)cnmtXml;
-        }
-        
-        nspPfs0EntryTable[i].file_size = entrySize;
-        nspPfs0EntryTable[i].file_offset = curFileOffset;
-        nspPfs0EntryTable[i].filename_offset = curFilenameOffset;
-        
-        curFileOffset += entrySize;
-        curFilenameOffset += entryFilenameSize;
-    }
+    char *nspPfs0StrTable = NULL;
+    u64 nspPfs0StrTableSize = 0;
     
-    for(i = 0; i < xml_rec_cnt; i++, entryIdx++)
-    {
-        u8 type = xml_content_info[xml_records[i].nca_index].type;
-        
-        if (type == NcmContentType_Control && xml_records[i].nacp_icons && xml_records[i].nacp_icon_cnt)
-        {
-            // Process all icons at once
-            for(j = 0; j < xml_records[i].nacp_icon_cnt; j++, entryIdx++)
-            {
-                entrySize = xml_records[i].nacp_icons[j].icon_size;
-                entryFilenameSize = (u32)(strlen(xml_records[i].nacp_icons[j].filename) + 1); // This is the only entry type with variable filename length
-                nspPfs0FilePtrs[ptrIdx++] = xml_records[i].nacp_icons[j].icon_data;
-                
-                nspPfs0EntryTable[entryIdx].file_size = entrySize;
-                nspPfs0EntryTable[entryIdx].file_offset = curFileOffset;
-                nspPfs0EntryTable[entryIdx].filename_offset = curFilenameOffset;
-                
-                curFileOffset += entrySize;
-                curFilenameOffset += entryFilenameSize;
-            }
-        }
-        
-        // XML entry
-        entrySize = xml_records[i].xml_size;
-        entryFilenameSize = (type == NcmContentType_Program ? NSP_PROGRAM_XML_FILENAME_LENGTH : (type == NcmContentType_Control ? NSP_NACP_XML_FILENAME_LENGTH : NSP_LEGAL_XML_FILENAME_LENGTH));
-        nspPfs0FilePtrs[ptrIdx++] = (u8*)xml_records[i].xml_data;
-        
-        nspPfs0EntryTable[entryIdx].file_size = entrySize;
-        nspPfs0EntryTable[entryIdx].file_offset = curFileOffset;
-        nspPfs0EntryTable[entryIdx].filename_offset = curFilenameOffset;
-        
-        curFileOffset += entrySize;
-        curFilenameOffset += entryFilenameSize;
+    u64 fullPfs0HeaderSize = 0;
+    
+    u8 **nspPfs0FilePtrs = NULL;
+    
+    Sha256Context nca_hash_ctx;
+    sha256ContextCreate(&nca_hash_ctx);
+    
+    u64 n, fileOffset;
+    out_file_t outFile;
+    memset(&outFile, 0, sizeof(out_file_t));
+    cmp_file_t cmpFile;
+    memset(&cmpFile, 0, sizeof(cmp_file_t));
+    out_file_t storeFile;
+    memset(&storeFile, 0, sizeof(out_file_t));
+    char storeTmpPath[NAME_BUF_LEN] = {'\0'};
+    u8 storeOptions = 0;
+    u64 manifestPrefixSize = 0;
+    u8 splitIndex = 0;
+    u32 crc = 0;
+    bool proceed = true, dumping = false, fat32_error = false, removeFile = true;
+    
+    progress_ctx_t progressCtx;
+    memset(&progressCtx, 0, sizeof(progress_ctx_t));
+    
+    bool seqDumpMode = false, seqDumpFileRemove = false, seqDumpFinish = false;
+    char seqDumpFilename[NAME_BUF_LEN] = {'\0'};
+    FILE *seqDumpFile = NULL;
+    u64 seqDumpFileSize = 0, seqDumpSessionOffset = 0;
+    u8 *seqDumpNcaHashes = NULL;
+    
+    sequentialNspCtx seqNspCtx;
+    memset(&seqNspCtx, 0, sizeof(sequentialNspCtx));
+    
+    bool journalEnabled = false, journalResume = false, journalKeep = false;
+    char journalFilename[NAME_BUF_LEN] = {'\0'};
+    u8 *journalPayload = NULL;
+    u32 journalPayloadSize = 0;
+    
+    dump_journal_header journalHeader;
+    memset(&journalHeader, 0, sizeof(dump_journal_header));
+    
+    nspPipelineCtx nspPipeCtx;
+    memset(&nspPipeCtx, 0, sizeof(nspPipelineCtx));
+    
+    char pfs0HeaderFilename[NAME_BUF_LEN] = {'\0'};
+    FILE *pfs0HeaderFile = NULL;
+    
+    char tmp_idx[5];
+    
+    size_t read_res, write_res;
+    
+    if ((selectedNspDumpType == DUMP_APP_NSP && !baseAppEntries) || (selectedNspDumpType == DUMP_PATCH_NSP && !patchEntries) || (selectedNspDumpType == DUMP_ADDON_NSP && !addOnEntries))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: title storage ID unavailable!", __func__);
+        breaks += 2;
+        return ret;
     }
     
-    if (includeTikAndCert)
+    if ((selectedNspDumpType == DUMP_APP_NSP && titleIndex >= titleAppCount) || (selectedNspDumpType == DUMP_PATCH_NSP && titleIndex >= titlePatchCount) || (selectedNspDumpType == DUMP_ADDON_NSP && titleIndex >= titleAddOnCount))
     {
-        for(i = 0; i < 2; i++, entryIdx++)
-        {
-            entrySize = (i == 0 ? ETICKET_TIK_FILE_SIZE : ETICKET_CERT_FILE_SIZE);
-            entryFilenameSize = (i == 0 ? NSP_TIK_FILENAME_LENGTH : NSP_CERT_FILENAME_LENGTH);
-            nspPfs0FilePtrs[ptrIdx++] = (i == 0 ? (u8*)(&(rights_info.tik_data)) : rights_info.cert_data);
-            
-            nspPfs0EntryTable[entryIdx].file_size = entrySize;
-            nspPfs0EntryTable[entryIdx].file_offset = curFileOffset;
-            nspPfs0EntryTable[entryIdx].filename_offset = curFilenameOffset;
-            
-            curFileOffset += entrySize;
-            curFilenameOffset += entryFilenameSize;
-        }
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title index!", __func__);
+        breaks += 2;
+        return ret;
     }
     
-    // Calculate total dump size
-    progressCtx.totalSize += fullPfs0HeaderSize;
-    for(i = 0; i < titleContentInfoCnt; i++) progressCtx.totalSize += xml_content_info[i].size;
-    progressCtx.totalSize += strlen(cnmtXml);
-    if (includeTikAndCert) progressCtx.totalSize += (ETICKET_TIK_FILE_SIZE + ETICKET_CERT_FILE_SIZE);
+    curStorageId = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].storageId : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].storageId : addOnEntries[titleIndex].storageId));
     
-    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    ncmTitleIndex = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].ncmIndex : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].ncmIndex : addOnEntries[titleIndex].ncmIndex));
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Total NSP dump size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
-    uiRefreshDisplay();
-    breaks += 2;
+    metaType = (selectedNspDumpType == DUMP_APP_NSP ? NcmContentMetaType_Application : (selectedNspDumpType == DUMP_PATCH_NSP ? NcmContentMetaType_Patch : NcmContentMetaType_AddOnContent));
+    
+    switch(curStorageId)
+    {
+        case NcmStorageId_GameCard:
+            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? titleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? titlePatchCount : titleAddOnCount));
+            break;
+        case NcmStorageId_SdCard:
+            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? sdCardTitleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? sdCardTitlePatchCount : sdCardTitleAddOnCount));
+            break;
+        case NcmStorageId_BuiltInUser:
+            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? emmcTitleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? emmcTitlePatchCount : emmcTitleAddOnCount));
+            break;
+        default:
+            break;
+    }
+    
+    char *dumpName = generateNSPDumpName(selectedNspDumpType, titleIndex, useBrackets);
+    if (!dumpName)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+        breaks += 2;
+        return ret;
+    }
     
     if (!batch)
     {
+        snprintf(seqDumpFilename, MAX_CHARACTERS(seqDumpFilename), "%s%s.nsp.seq", NSP_DUMP_PATH, dumpName);
+        snprintf(pfs0HeaderFilename, MAX_CHARACTERS(pfs0HeaderFilename), "%s%s.nsp.hdr", NSP_DUMP_PATH, dumpName);
+        
+        // Check if we're dealing with a sequential dump
+        seqDumpMode = (!remoteOutput && checkIfFileExists(seqDumpFilename));
         if (seqDumpMode)
         {
-            // Check if the current offset doesn't exceed the total NSP size
-            if (progressCtx.curOffset >= progressCtx.totalSize)
+            // Open sequence file
+            seqDumpFile = fopen(seqDumpFilename, "rb+");
+            if (!seqDumpFile)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NSP offset in the sequential dump reference file!", __func__);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to open existing sequential dump reference file for reading! (\"%s\")", __func__, seqDumpFilename);
                 goto out;
             }
             
-            // Check if the NCA count is valid
-            // The CNMT NCA is excluded from the hash list
-            if (seqNspCtx.ncaCount != (titleContentInfoCnt - 1))
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: NCA count mismatch in the sequential dump reference file! (%u != %u)", __func__, seqNspCtx.ncaCount, titleContentInfoCnt - 1);
-                goto out;
-            }
+            // Retrieve sequence file size
+            fseek(seqDumpFile, 0, SEEK_END);
+            seqDumpFileSize = ftell(seqDumpFile);
+            rewind(seqDumpFile);
             
-            // Check if the Program NCA mod count is valid
-            if (seqNspCtx.programNcaModCount != ncaProgramModCnt)
+            // Read sequentialNspCtx struct info
+            read_res = fread(&seqNspCtx, 1, sizeof(sequentialNspCtx), seqDumpFile);
+            if (read_res != sizeof(sequentialNspCtx))
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: Program NCA mod count mismatch in the sequential dump reference file! (%u != %u)", __func__, seqNspCtx.programNcaModCount, ncaProgramModCnt);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk from the sequential dump reference file! (read %lu bytes)", __func__, sizeof(sequentialNspCtx), read_res);
                 goto out;
             }
             
-            // Check if the PFS0 file count is valid
-            if (seqNspCtx.pfs0FileCount != nspPfs0Header.file_cnt)
+            // Check if the storage ID is right
+            if (seqNspCtx.storageId != curStorageId)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: PFS0 file count mismatch in the sequential dump reference file! (%u != %u)", __func__, seqNspCtx.pfs0FileCount, nspPfs0Header.file_cnt);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid source storage ID in sequential dump reference file!", __func__);
                 goto out;
             }
             
-            // Check if the current PFS0 file index is valid
-            if (seqNspCtx.fileIndex >= nspPfs0Header.file_cnt)
+            // Check if the Program NCA mod count field is valid
+            if (seqNspCtx.programNcaModCount > 0 && !seqNspCtx.npdmAcidRsaPatch)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid PFS0 file index in the sequential dump reference file!", __func__);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid Program NCA mod count sequential dump reference file!", __func__);
+                seqDumpFileRemove = true;
                 goto out;
             }
             
-            // Check if we're really dealing with a title with a missing ticket if preInstall == true
-            if (seqNspCtx.preInstall && !rights_info.missing_tik)
+            // Check file size
+            if (seqDumpFileSize != (sizeof(sequentialNspCtx) + (seqNspCtx.ncaCount * SHA256_HASH_SIZE) + (seqNspCtx.programNcaModCount * NCA_FULL_HEADER_LENGTH)))
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title preinstall status in the sequential dump reference file!", __func__);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid sequential dump reference file size!", __func__);
+                seqDumpFileRemove = true;
                 goto out;
             }
             
-            // Check if the current overall offset is aligned to SPLIT_FILE_SEQUENTIAL_SIZE
-            u64 curNspOffset = fullPfs0HeaderSize;
-            for(i = 0; i < seqNspCtx.fileIndex; i++) curNspOffset += nspPfs0EntryTable[i].file_size;
-            curNspOffset += seqNspCtx.fileOffset;
-            
-            if (curNspOffset != progressCtx.curOffset)
+            // Allocate memory for the NCA hashes
+            seqDumpNcaHashes = calloc(1, seqNspCtx.ncaCount * SHA256_HASH_SIZE);
+            if (!seqDumpNcaHashes)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: overall NSP dump offset isn't aligned to 0x%08X in the sequential dump reference file!", __func__, (u32)SPLIT_FILE_SEQUENTIAL_SIZE);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for NCA hashes from the sequential dump reference file!", __func__);
                 goto out;
             }
             
-            // Check if there's enough free space to continue the sequential dump process
-            u64 restSize = (progressCtx.totalSize - curNspOffset);
-            if (progressCtx.totalSize > freeSpace && ((restSize > SPLIT_FILE_SEQUENTIAL_SIZE && freeSpace < SPLIT_FILE_SEQUENTIAL_SIZE) || (restSize <= SPLIT_FILE_SEQUENTIAL_SIZE && freeSpace < restSize)))
+            // Read NCA hashes
+            read_res = fread(seqDumpNcaHashes, 1, seqNspCtx.ncaCount * SHA256_HASH_SIZE, seqDumpFile);
+            if (read_res != (seqNspCtx.ncaCount * SHA256_HASH_SIZE))
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk from the sequential dump reference file! (read %lu bytes)", __func__, seqNspCtx.ncaCount * SHA256_HASH_SIZE, read_res);
                 goto out;
             }
             
-            // Now check if the current PFS0 file entry offset is correct
-            if (seqNspCtx.fileOffset >= nspPfs0EntryTable[seqNspCtx.fileIndex].file_size)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid offset for current PFS0 file entry in the sequential dump reference file!", __func__);
-                goto out;
-            }
+            // Restore parameters from the sequence file
+            isFat32 = true;
+            removeConsoleData = seqNspCtx.removeConsoleData;
+            tiklessDump = seqNspCtx.tiklessDump;
+            npdmAcidRsaPatch = seqNspCtx.npdmAcidRsaPatch;
+            preInstall = seqNspCtx.preInstall;
+            splitIndex = seqNspCtx.partNumber;
+            progressCtx.curOffset = ((u64)seqNspCtx.partNumber * SPLIT_FILE_SEQUENTIAL_SIZE);
+        } else
+        if (!remoteOutput)
+        {
+            // Check if a previous dump was interrupted (e.g. crash, power loss or gamecard removal)
+            // The journal payload uses the same layout as the sequential dump reference file
+            snprintf(journalFilename, MAX_CHARACTERS(journalFilename), "%s%s.nsp" DUMP_JOURNAL_EXTENSION, NSP_DUMP_PATH, dumpName);
             
-            // Copy previously calculated NCA IDs and hashes
-            for(i = 0; i < seqNspCtx.fileIndex; i++)
+            journalPayload = (u8*)dumpJournalLoad(journalFilename, DUMP_JOURNAL_TYPE_NSP, &journalHeader);
+            if (journalPayload)
             {
-                // Exit loop if we reach the CNMT NCA
-                // Its ID/hash calculation is always handled by patchCnmtNca()
-                if (i >= (titleContentInfoCnt - 1)) break;
+                if (journalHeader.payloadSize >= sizeof(sequentialNspCtx)) memcpy(&seqNspCtx, journalPayload, sizeof(sequentialNspCtx));
                 
-                // Fill information for our CNMT XML
-                memcpy(xml_content_info[i].nca_id, seqDumpNcaHashes + (i * SHA256_HASH_SIZE), SHA256_HASH_SIZE / 2);
-                convertDataToHexString(xml_content_info[i].nca_id, SHA256_HASH_SIZE / 2, xml_content_info[i].nca_id_str, SHA256_HASH_SIZE + 1);
-                memcpy(xml_content_info[i].hash, seqDumpNcaHashes + (i * SHA256_HASH_SIZE), SHA256_HASH_SIZE);
-                convertDataToHexString(xml_content_info[i].hash, SHA256_HASH_SIZE, xml_content_info[i].hash_str, (SHA256_HASH_SIZE * 2) + 1);
-            }
-            
-            // Copy the NCA SHA-256 context data, but only if we're not dealing with the CNMT NCA
-            if (seqNspCtx.fileIndex < (titleContentInfoCnt - 1)) memcpy(&nca_hash_ctx, &(seqNspCtx.hashCtx), sizeof(Sha256Context));
-            
-            // Restore the modified Program NCA headers
-            // The NPDM signature from the NCA headers is generated using cryptographically secure random numbers, so the modified header is stored during the first sequential dump session
-            // If needed, it must be restored in later sessions
-            for(i = 0; i < ncaProgramModCnt; i++)
-            {
-                read_res = fread(xml_content_info[ncaProgramMod[i].nca_index].encrypted_header_mod, 1, NCA_FULL_HEADER_LENGTH, seqDumpFile);
-                if (read_res != NCA_FULL_HEADER_LENGTH)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk from the sequential dump reference file! (read %lu bytes)", __func__, NCA_FULL_HEADER_LENGTH, read_res);
-                    goto out;
-                }
-            }
-            
-            rewind(seqDumpFile);
-            
-            // Inform that we are resuming an already started sequential dump operation
-            if (curStorageId == NcmStorageId_GameCard)
-            {
-                if (selectedNspDumpType == DUMP_APP_NSP)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous sequential dump operation. Configuration parameters overrided.");
-                    breaks++;
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Change NPDM RSA key/sig in Program NCA: %s.", (npdmAcidRsaPatch ? "Yes" : "No"));
-                } else
-                if (selectedNspDumpType == DUMP_PATCH_NSP)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous sequential dump operation. Configuration parameters overrided.");
-                    breaks++;
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Generate ticket-less dump: %s | Change NPDM RSA key/sig in Program NCA: %s.", (tiklessDump ? "Yes" : "No"), (npdmAcidRsaPatch ? "Yes" : "No"));
-                } else
-                if (selectedNspDumpType == DUMP_ADDON_NSP)
+                if (journalHeader.payloadSize >= sizeof(sequentialNspCtx) && seqNspCtx.storageId == curStorageId && (!seqNspCtx.programNcaModCount || seqNspCtx.npdmAcidRsaPatch) && journalHeader.payloadSize == (sizeof(sequentialNspCtx) + (seqNspCtx.ncaCount * SHA256_HASH_SIZE) + (seqNspCtx.programNcaModCount * NCA_FULL_HEADER_LENGTH)))
                 {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous sequential dump operation.");
+                    char journalOffsetStr[32] = {'\0'};
+                    char journalPrompt[NAME_BUF_LEN] = {'\0'};
+                    
+                    convertSize(journalHeader.offset, journalOffsetStr, MAX_CHARACTERS(journalOffsetStr));
+                    snprintf(journalPrompt, MAX_CHARACTERS(journalPrompt), "An interrupted dump of this title was found (%s already dumped). Do you want to continue from the last checkpoint?\nIf you choose not to, the previous dump will be discarded.", journalOffsetStr);
+                    
+                    int cur_breaks = breaks;
+                    
+                    journalResume = yesNoPrompt(journalPrompt);
+                    
+                    // Remove the prompt from the screen
+                    breaks = cur_breaks;
+                    uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+                    uiRefreshDisplay();
                 }
-            } else {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous sequential dump operation. Configuration parameters overrided.");
-                breaks++;
                 
-                if (selectedNspDumpType == DUMP_APP_NSP || selectedNspDumpType == DUMP_PATCH_NSP)
+                if (journalResume)
                 {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Remove console specific data: %s | Generate ticket-less dump: %s | Change NPDM RSA key/sig in Program NCA: %s.", (removeConsoleData ? "Yes" : "No"), (tiklessDump ? "Yes" : "No"), (npdmAcidRsaPatch ? "Yes" : "No"));
-                } else
-                if (selectedNspDumpType == DUMP_ADDON_NSP)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Remove console specific data: %s | Generate ticket-less dump: %s.", (removeConsoleData ? "Yes" : "No"), (tiklessDump ? "Yes" : "No"));
+                    // Restore parameters from the dump journal
+                    isFat32 = ((journalHeader.flags & DUMP_JOURNAL_FLAG_FAT32) != 0);
+                    removeConsoleData = seqNspCtx.removeConsoleData;
+                    tiklessDump = seqNspCtx.tiklessDump;
+                    npdmAcidRsaPatch = seqNspCtx.npdmAcidRsaPatch;
+                    preInstall = seqNspCtx.preInstall;
+                    splitIndex = journalHeader.partIndex;
+                    progressCtx.curOffset = journalHeader.offset;
+                    
+                    // Checkpoints are never saved for compressed output dumps
+                    compressOutput = false;
+                    
+                    journalPayloadSize = journalHeader.payloadSize;
+                    journalKeep = true;
+                } else {
+                    free(journalPayload);
+                    journalPayload = NULL;
+                    memset(&seqNspCtx, 0, sizeof(sequentialNspCtx));
                 }
             }
             
-            breaks++;
-        } else {
-            if (progressCtx.totalSize > freeSpace)
-            {
-                // Check if we have enough free space
-                // The CNMT NCA is excluded from the hash list
-                seqDumpFileSize = (sizeof(sequentialNspCtx) + ((titleContentInfoCnt - 1) * SHA256_HASH_SIZE) + (ncaProgramModCnt * NCA_FULL_HEADER_LENGTH));
-                if (freeSpace < (SPLIT_FILE_SEQUENTIAL_SIZE + seqDumpFileSize))
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-                    goto out;
-                }
-                
-                // Ask the user if they want to use the sequential dump mode
-                int cur_breaks = breaks;
-                
-                if (!yesNoPrompt("There's not enough space available to generate a whole dump in this session. Do you want to use sequential dumping?\nIn this mode, the selected content will be dumped in more than one session.\nYou'll have to transfer the generated part files to a PC before continuing the process in the next session."))
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
-                    goto out;
-                }
-                
-                // Remove the prompt from the screen
-                breaks = cur_breaks;
-                uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
-                uiRefreshDisplay();
-                
-                // Modify config parameters
-                isFat32 = true;
-                partSize = SPLIT_FILE_SEQUENTIAL_SIZE;
-                seqDumpMode = true;
-                
-                // Fill information in our sequential context
-                seqNspCtx.storageId = curStorageId;
-                seqNspCtx.removeConsoleData = removeConsoleData;
-                seqNspCtx.tiklessDump = tiklessDump;
-                seqNspCtx.npdmAcidRsaPatch = npdmAcidRsaPatch;
-                seqNspCtx.preInstall = preInstall;
-                seqNspCtx.pfs0FileCount = nspPfs0Header.file_cnt;
-                seqNspCtx.ncaCount = (titleContentInfoCnt - 1); // Exclude the CNMT NCA from the hash list
-                seqNspCtx.programNcaModCount = ncaProgramModCnt;
-                
-                // Allocate memory for the NCA hashes
-                seqDumpNcaHashes = calloc(1, (titleContentInfoCnt - 1) * SHA256_HASH_SIZE);
-                if (!seqDumpNcaHashes)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for NCA hashes from the sequential dump reference file!", __func__);
-                    goto out;
-                }
-                
-                // Create sequential reference file and keep the handle to it opened
-                seqDumpFile = fopen(seqDumpFilename, "wb+");
-                if (!seqDumpFile)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to create sequential dump reference file! (\"%s\")", __func__, seqDumpFilename);
-                    goto out;
-                }
-                
-                // Write the sequential dump struct
-                write_res = fwrite(&seqNspCtx, 1, sizeof(sequentialNspCtx), seqDumpFile);
-                if (write_res != sizeof(sequentialNspCtx))
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, sizeof(sequentialNspCtx), write_res);
-                    seqDumpFileRemove = true;
-                    goto out;
-                }
-                
-                // Write the NCA hashes block
-                write_res = fwrite(seqDumpNcaHashes, 1, (titleContentInfoCnt - 1) * SHA256_HASH_SIZE, seqDumpFile);
-                if (write_res != ((titleContentInfoCnt - 1) * SHA256_HASH_SIZE))
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, (titleContentInfoCnt - 1) * SHA256_HASH_SIZE, write_res);
-                    seqDumpFileRemove = true;
-                    goto out;
-                }
-                
-                // Write the modified Program NCA headers
-                // The NPDM signature from the NCA headers is generated using cryptographically secure random numbers, so we must store the modified header during the first sequential dump session
-                for(i = 0; i < ncaProgramModCnt; i++)
-                {
-                    write_res = fwrite(xml_content_info[ncaProgramMod[i].nca_index].encrypted_header_mod, 1, NCA_FULL_HEADER_LENGTH, seqDumpFile);
-                    if (write_res != NCA_FULL_HEADER_LENGTH)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, NCA_FULL_HEADER_LENGTH, write_res);
-                        seqDumpFileRemove = true;
-                        goto out;
-                    }
-                }
-                
-                rewind(seqDumpFile);
-                
-                // Update free space
-                freeSpace -= seqDumpFileSize;
-            }
-        }
-    } else {
-        if (progressCtx.totalSize > freeSpace)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-            goto out;
+            if (!journalResume) dumpJournalRemove(journalFilename);
         }
     }
     
-    if (seqDumpMode)
+    if (remoteOutput) isFat32 = false;
+    
+    u64 partSize = (seqDumpMode ? SPLIT_FILE_SEQUENTIAL_SIZE : SPLIT_FILE_NSP_PART_SIZE);
+    
+    if (!batch)
     {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp.%02u", NSP_DUMP_PATH, dumpName, splitIndex);
-    } else {
-        // Temporary, we'll use this to check if the dump already exists (it should have the archive bit set if so)
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
-        
-        // Check if the dump already exists
-        if (!batch && checkIfFileExists(dumpPath))
-        {
-            // Ask the user if they want to proceed anyway
-            int cur_breaks = breaks;
-            
-            proceed = yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?");
-            if (!proceed)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
-                removeFile = false;
-                goto out;
-            } else {
-                // Remove the prompt from the screen
-                breaks = cur_breaks;
-                uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
-            }
-        }
-        
-        // Since we may actually be dealing with an existing directory with the archive bit set or unset, let's try both
-        // Better safe than sorry
-        remove(dumpPath);
-        fsdevDeleteDirectoryRecursively(dumpPath);
-        
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Retrieving information from encrypted NCA content files...");
+        uiRefreshDisplay();
+        breaks += 2;
+    }
+    
+    if (!retrieveContentInfosFromTitle(curStorageId, metaType, titleCount, ncmTitleIndex, &titleContentInfos, &titleContentInfoCnt))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+        goto out;
+    }
+    
+    // If we're dealing with a gamecard, open the Secure HFS0 partition (IStorage partition #1) to read NCA data
+    // We may also need to retrieve a ticket if we're dealing with a Patch with titlekey crypto
+    if (curStorageId == NcmStorageId_GameCard)
+    {
+        result = openGameCardStoragePartition(ISTORAGE_PARTITION_SECURE);
+        if (R_FAILED(result))
         {
-            mkdir(dumpPath, 0744);
-            
-            sprintf(tmp_idx, "/%02u", splitIndex);
-            strcat(dumpPath, tmp_idx);
+            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to open IStorage partition #1! (0x%08X)", __func__, result);
+            goto out;
         }
     }
     
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
+    result = ncmOpenContentStorage(&ncmStorage, curStorageId);
+    if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: ncmOpenContentStorage failed! (0x%08X)", __func__, result);
         goto out;
     }
     
-    // Start dump process
-    if (!batch) dumpStartMsg();
-    appletModeOperationWarning();
-    uiRefreshDisplay();
+    // Fill information for our CNMT XML
+    memset(&xml_program_info, 0, sizeof(cnmt_xml_program_info));
+    xml_program_info.type = (u8)metaType;
+    xml_program_info.title_id = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].titleId : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].titleId : addOnEntries[titleIndex].titleId));
+    xml_program_info.version = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].version : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].version : addOnEntries[titleIndex].version));
+    xml_program_info.nca_cnt = titleContentInfoCnt;
     
-    if (!batch)
+    xml_content_info = arenaAlloc(&dumpArena, titleContentInfoCnt * sizeof(cnmt_xml_content_info));
+    if (!xml_content_info)
     {
-        breaks++;
-        changeHomeButtonBlockStatus(true);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the CNMT XML content info struct!", __func__);
+        goto out;
     }
     
-    if (seqDumpMode)
+    // There's at most one XML record per NCA
+    xml_records = arenaAlloc(&dumpArena, titleContentInfoCnt * sizeof(xml_record_info));
+    if (!xml_records)
     {
-        // Skip the PFS0 header in the first part file
-        // It will be saved to an additional ".nsp.hdr" file
-        if (!seqNspCtx.partNumber) progressCtx.curOffset = seqDumpSessionOffset = fullPfs0HeaderSize;
-    } else {
-        // Write placeholder zeroes
-        write_res = fwrite(dumpBuf, 1, fullPfs0HeaderSize, outFile);
-        if (write_res != fullPfs0HeaderSize)
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the XML records buffer!", __func__);
+        goto out;
+    }
+    
+    // Up to four AES-CTR sections per NCA, one slot each
+    if (compressOutput)
+    {
+        cmpRegions = arenaAlloc(&dumpArena, titleContentInfoCnt * 4 * sizeof(cmp_file_crypto_region));
+        if (!cmpRegions)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes placeholder data to file offset 0x%016lX! (wrote %lu bytes)", __func__, fullPfs0HeaderSize, (u64)0, write_res);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the compressed output crypto regions!", __func__);
             goto out;
         }
-        
-        // Advance our current offset
-        progressCtx.curOffset = fullPfs0HeaderSize;
     }
     
-    progressCtx.line_offset = (breaks + 4);
-    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
-    
-    dumping = true;
-    
-    u32 startFileIndex = (seqDumpMode ? seqNspCtx.fileIndex : 0);
-    u64 startFileOffset;
-    
-    // Write all PFS0 entries
-    for(i = startFileIndex; i < nspPfs0Header.file_cnt; i++, startFileIndex++)
+    // Fill our CNMT XML content records, leaving the CNMT NCA at the end
+    u32 titleContentInfoIndex;
+    for(i = 0, titleContentInfoIndex = 0; titleContentInfoIndex < titleContentInfoCnt; i++, titleContentInfoIndex++)
     {
-        char *entryFilename = NULL;
+        if (!cnmtFound && titleContentInfos[titleContentInfoIndex].content_type == NcmContentType_Meta)
+        {
+            cnmtFound = true;
+            cnmtNcaIndex = titleContentInfoIndex;
+            i--;
+            continue;
+        }
         
-        n = DUMP_BUFFER_SIZE;
+        // Skip Delta Fragments and/or any other unknown content types (only if the related option is disabled)
+        // Delta Fragments are used to update from a certain version to another version without needing to install the whole update
+        // For any dumping purposes, they're useless, because they just increase the size of the output dump. The more updates come out for a title, the more Delta Fragments there will be available for that title
+        // Also, since they're basically an eShop thing, they're not available in gamecards (so in this particular case, we need to skip them anyway)
+        // However, their content records must be kept intact in the CNMT NCA
+        if (titleContentInfos[titleContentInfoIndex].content_type >= NcmContentType_DeltaFragment && !dumpDeltaFragments)
+        {
+            xml_program_info.nca_cnt--;
+            i--;
+            continue;
+        }
         
-        startFileOffset = ((seqDumpMode && i == seqNspCtx.fileIndex) ? seqNspCtx.fileOffset : 0);
+        // Fill information for our CNMT XML
+        xml_content_info[i].type = titleContentInfos[titleContentInfoIndex].content_type;
+        memcpy(xml_content_info[i].nca_id, titleContentInfos[titleContentInfoIndex].content_id.c, SHA256_HASH_SIZE / 2); // Temporary
+        convertDataToHexString(titleContentInfos[titleContentInfoIndex].content_id.c, SHA256_HASH_SIZE / 2, xml_content_info[i].nca_id_str, SHA256_HASH_SIZE + 1); // Temporary
+        convertNcaSizeToU64(titleContentInfos[titleContentInfoIndex].size, &(xml_content_info[i].size));
+        xml_content_info[i].id_offset = titleContentInfos[titleContentInfoIndex].id_offset;
+        convertDataToHexString(xml_content_info[i].hash, SHA256_HASH_SIZE, xml_content_info[i].hash_str, (SHA256_HASH_SIZE * 2) + 1); // Temporary
         
-        int programModIdx = -1;
+        memcpy(&ncaId, &(titleContentInfos[titleContentInfoIndex].content_id), sizeof(NcmContentId));
         
-        // Check if we're dealing with a NCA
-        if (i < titleContentInfoCnt)
+        if (!readNcaDataByContentId(&ncmStorage, &ncaId, 0, ncaHeader, NCA_FULL_HEADER_LENGTH))
         {
-            // Check if we're not dealing with the CNMT NCA
-            if (i < (titleContentInfoCnt - 1))
-            {
-                // Copy NCA ID
-                memcpy(ncaId.c, xml_content_info[i].nca_id, SHA256_HASH_SIZE / 2);
-                
-                // Reset SHA-256 context if necessary
-                if (!seqDumpMode || (seqDumpMode && i != seqNspCtx.fileIndex)) sha256ContextCreate(&nca_hash_ctx);
-                
-                // Retrieve Program NCA mod data index
-                if (xml_content_info[i].type == NcmContentType_Program && ncaProgramModCnt > 0)
-                {
-                    for(j = 0; j < ncaProgramModCnt; j++)
-                    {
-                        if (ncaProgramMod[j].nca_index == i)
-                        {
-                            programModIdx = (int)j;
-                            break;
-                        }
-                    }
-                }
-            } else {
-                // Patch CNMT NCA
-                breaks = (progressCtx.line_offset + 2);
+            breaks++;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read header from NCA \"%s\"!", __func__, xml_content_info[i].nca_id_str);
+            proceed = false;
+            break;
+        }
+        
+        // Decrypt the NCA header
+        // Don't retrieve the ticket and/or titlekey if we're dealing with a Patch with titlekey crypto bundled with the inserted gamecard
+        if (!decryptNcaHeader(ncaHeader, NCA_FULL_HEADER_LENGTH, &ncaId, &dec_nca_header, &rights_info, xml_content_info[i].decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard)))
+        {
+            proceed = false;
+            break;
+        }
+        
+        // Check if this particular content has a populated Rights ID field
+        bool has_rights_id = false;
+        
+        for(j = 0; j < 0x10; j++)
+        {
+            if (dec_nca_header.rights_id[j] != 0)
+            {
+                has_rights_id = true;
+                break;
+            }
+        }
+        
+        // Check if the missing ticket flag is enabled
+        // If so, we may be dealing with a preinstalled title
+        if (curStorageId != NcmStorageId_GameCard && has_rights_id && rights_info.missing_tik && !preInstall)
+        {
+            // Only display the pre-install prompt if we're not running a batch / sequential dump operation (excluding the first run of the latter)
+            if (!batch && !seqDumpMode)
+            {
+                int cur_breaks = breaks;
+                breaks += 2;
                 
-                proceed = patchCnmtNca(cnmtNcaBuf, xml_content_info[cnmtNcaIndex].size, &xml_program_info, xml_content_info, &ncaCnmtMod);
+                proceed = yesNoPrompt("This is probably a pre-installed title, which explains why a ticket for it couldn't be found (even though its Rights ID field isn't empty).\nDo you want to proceed with the dump procedure anyway?\nBear in mind that no content decryption will be possible for this title in its current status.");
                 if (!proceed)
                 {
-                    dumping = false;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+                    break;
+                } else {
+                    breaks = cur_breaks;
+                    preInstall = true;
+                }
+            }
+            
+            // Remove the prompt / error from the screen
+            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+        }
+        
+        // Fill information for our CNMT XML
+        xml_content_info[i].keyblob = (dec_nca_header.crypto_type2 > dec_nca_header.crypto_type ? dec_nca_header.crypto_type2 : dec_nca_header.crypto_type);
+        
+        if (curStorageId == NcmStorageId_GameCard)
+        {
+            // Modify content distribution type
+            // It's always set to 1 (gamecard) in Applications and Add-Ons bundled in gamecards
+            // It's always set to 0 (download) in Patches bundled in gamecards. But if we're dealing with a custom XCI mounted through SX OS, we may need to change that
+            dec_nca_header.distribution = 0;
+            
+            if (selectedNspDumpType == DUMP_APP_NSP || selectedNspDumpType == DUMP_ADDON_NSP) 
+            {
+                // Application and AddOn titles don't have a populated Rights ID field when bundled in gamecards
+                if (has_rights_id)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: Rights ID field in NCA header not empty!", __func__);
+                    proceed = false;
                     break;
                 }
                 
-                breaks = (progressCtx.line_offset - 4);
-                
-                // Generate proper CNMT XML
-                generateCnmtXml(&xml_program_info, xml_content_info, cnmtXml);
-                
-                // Fill PFS0 string table
-                // This is done here because we'll need to display filenames for the rest of the PFS0 entries starting with the next loop iteration
-                entryIdx = 0;
-                
-                for(j = 0; j <= titleContentInfoCnt; j++, entryIdx++)
+                // Patch ACID public RSA key and recreate the NCA NPDM signature if we're dealing with the Program NCA
+                if (xml_content_info[i].type == NcmContentType_Program && npdmAcidRsaPatch)
                 {
-                    char *curFilename = (nspPfs0StrTable + nspPfs0EntryTable[entryIdx].filename_offset);
-                    
-                    if (j < titleContentInfoCnt)
-                    {
-                        sprintf(curFilename, "%s.%s", xml_content_info[j].nca_id_str, (j == cnmtNcaIndex ? "cnmt.nca" : "nca"));
-                    } else
-                    if (j == titleContentInfoCnt)
+                    if (!processProgramNca(&ncmStorage, &ncaId, &dec_nca_header, &(xml_content_info[i]), &ncaProgramMod, &ncaProgramModCnt, i))
                     {
-                        sprintf(curFilename, "%s.cnmt.xml", xml_content_info[cnmtNcaIndex].nca_id_str);
+                        proceed = false;
+                        break;
                     }
                 }
-                
-                for(j = 0; j < xml_rec_cnt; j++, entryIdx++)
+            } else
+            if (selectedNspDumpType == DUMP_PATCH_NSP)
+            {
+                // Patch titles *do* have a populated Rights ID field and a ticket + certificate chain combination when bundled in gamecards
+                // Depending on the dump settings, we may need to change or remove that
+                // If no Rights ID is available, we may be dealing with a custom XCI mounted through SX OS. In this particular case, no further modifications should be needed
+                if (has_rights_id)
                 {
-                    u8 type = xml_content_info[xml_records[j].nca_index].type;
+                    // Retrieve the ticket from the HFS0 partition in the gamecard
+                    if (!retrieveTitleKeyFromGameCardTicket(&rights_info, xml_content_info[i].decrypted_nca_keys))
+                    {
+                        proceed = false;
+                        break;
+                    }
                     
-                    if (type == NcmContentType_Control && xml_records[j].nacp_icons && xml_records[j].nacp_icon_cnt)
+                    // Mess with the NCA header if we're dealing with a NCA with a populated Rights ID field and if tiklessDump is true (removeConsoleData is ignored)
+                    if (tiklessDump)
                     {
-                        // Process all icons at once
-                        for(u32 k = 0; k < xml_records[j].nacp_icon_cnt; k++, entryIdx++)
+                        // Generate new encrypted NCA key area using titlekey
+                        if (!generateEncryptedNcaKeyAreaWithTitlekey(&dec_nca_header, xml_content_info[i].decrypted_nca_keys))
                         {
-                            char *curFilename = (nspPfs0StrTable + nspPfs0EntryTable[entryIdx].filename_offset);
-                            sprintf(curFilename, "%s%s", xml_content_info[xml_records[j].nca_index].nca_id_str, strchr(xml_records[j].nacp_icons[k].filename, '.'));
+                            proceed = false;
+                            break;
+                        }
+                        
+                        // Remove Rights ID from NCA
+                        memset(dec_nca_header.rights_id, 0, 0x10);
+                        
+                        // Patch ACID pubkey and recreate NCA NPDM signature if we're dealing with the Program NCA
+                        if (xml_content_info[i].type == NcmContentType_Program && npdmAcidRsaPatch)
+                        {
+                            if (!processProgramNca(&ncmStorage, &ncaId, &dec_nca_header, &(xml_content_info[i]), &ncaProgramMod, &ncaProgramModCnt, i))
+                            {
+                                proceed = false;
+                                break;
+                            }
                         }
                     }
-                    
-                    char *curFilename = (nspPfs0StrTable + nspPfs0EntryTable[entryIdx].filename_offset);
-                    sprintf(curFilename, "%s.%s.xml", xml_content_info[xml_records[j].nca_index].nca_id_str, (type == NcmContentType_Program ? "programinfo" : (type == NcmContentType_Control ? "nacp" : "legalinfo")));
+                }
+            }
+        } else
+        if (curStorageId == NcmStorageId_SdCard || curStorageId == NcmStorageId_BuiltInUser)
+        {
+            // Only mess with the NCA header if we're dealing with a content with a populated Rights ID field, and if both removeConsoleData and tiklessDump are true
+            // This will only be done if we were able to retrieve the ticket for this title
+            if (has_rights_id && rights_info.retrieved_tik && removeConsoleData && tiklessDump)
+            {
+                // Generate new encrypted NCA key area using titlekey
+                if (!generateEncryptedNcaKeyAreaWithTitlekey(&dec_nca_header, xml_content_info[i].decrypted_nca_keys))
+                {
+                    proceed = false;
+                    break;
                 }
                 
-                if (includeTikAndCert)
+                // Remove rights ID from NCA
+                memset(dec_nca_header.rights_id, 0, 0x10);
+                
+                // Patch ACID pubkey and recreate NCA NPDM signature if we're dealing with the Program NCA
+                if (xml_content_info[i].type == NcmContentType_Program && npdmAcidRsaPatch)
                 {
-                    for(j = 0; j < 2; j++, entryIdx++)
+                    if (!processProgramNca(&ncmStorage, &ncaId, &dec_nca_header, &(xml_content_info[i]), &ncaProgramMod, &ncaProgramModCnt, i))
                     {
-                        char *curFilename = (nspPfs0StrTable + nspPfs0EntryTable[entryIdx].filename_offset);
-                        sprintf(curFilename, (j == 0 ? rights_info.tik_filename : rights_info.cert_filename));
+                        proceed = false;
+                        break;
                     }
                 }
             }
-        } else {
-            // Copy current filename
-            entryFilename = (nspPfs0StrTable + nspPfs0EntryTable[i].filename_offset);
         }
         
-        for(fileOffset = startFileOffset; fileOffset < nspPfs0EntryTable[i].file_size; fileOffset += n, progressCtx.curOffset += n, seqDumpSessionOffset += n)
+        // Encrypted NCA sections don't compress at all, so keep what's needed to decrypt them
+        if (cmpRegions && (!has_rights_id || rights_info.retrieved_tik)) getNcaCryptoRegions(&dec_nca_header, xml_content_info[i].decrypted_nca_keys, xml_content_info[i].size, cmpRegions + (i * 4));
+        
+        if ((!has_rights_id || (has_rights_id && rights_info.retrieved_tik)) && (xml_content_info[i].type == NcmContentType_Program || xml_content_info[i].type == NcmContentType_Control || xml_content_info[i].type == NcmContentType_LegalInformation))
         {
-            if (seqDumpMode && seqDumpFinish)
-            {
-                ret = 0;
-                break;
-            }
-            
-            uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
-            
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
-            
-            if (i < titleContentInfoCnt)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Dumping NCA \"%s\" (%s)...", xml_content_info[i].nca_id_str, getContentType(xml_content_info[i].type));
-            } else {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Writing \"%s\"...", entryFilename);
-            }
+            // Add a new XML record
+            xml_records[xml_rec_cnt].nca_index = i;
             
-            if (n > (nspPfs0EntryTable[i].file_size - fileOffset)) n = (nspPfs0EntryTable[i].file_size - fileOffset);
+            xml_rec_cnt++;
             
-            // Check if the next read chunk will exceed the size of the current part file
-            if (seqDumpMode && (seqDumpSessionOffset + n) >= (((splitIndex - seqNspCtx.partNumber) + 1) * partSize))
+            // Generate programinfo.xml
+            if (xml_content_info[i].type == NcmContentType_Program)
             {
-                u64 new_file_chunk_size = ((seqDumpSessionOffset + n) - (((splitIndex - seqNspCtx.partNumber) + 1) * partSize));
-                u64 old_file_chunk_size = (n - new_file_chunk_size);
+                bool use_acid_pubkey = false;
                 
-                u64 remainderDumpSize = (progressCtx.totalSize - (progressCtx.curOffset + old_file_chunk_size));
-                u64 remainderFreeSize = (freeSpace - (seqDumpSessionOffset + old_file_chunk_size));
+                for(j = 0; j < ncaProgramModCnt; j++)
+                {
+                    if (ncaProgramMod[j].nca_index == i)
+                    {
+                        use_acid_pubkey = true;
+                        break;
+                    }
+                }
                 
-                // Check if we have enough space for the next part
-                // If so, set the chunk size to old_file_chunk_size
-                if ((remainderDumpSize <= partSize && remainderDumpSize > remainderFreeSize) || (remainderDumpSize > partSize && partSize > remainderFreeSize))
+                if (!generateProgramInfoXml(&ncmStorage, &ncaId, &dec_nca_header, xml_content_info[i].decrypted_nca_keys, use_acid_pubkey, &dumpArena, &(xml_records[xml_rec_cnt - 1].xml_data), &(xml_records[xml_rec_cnt - 1].xml_size)))
                 {
-                    n = old_file_chunk_size;
-                    seqDumpFinish = true;
+                    proceed = false;
+                    break;
                 }
             }
             
-            if (i < (titleContentInfoCnt - 1))
+            // Retrieve NACP data (XML and icons)
+            if (xml_content_info[i].type == NcmContentType_Control)
             {
-                breaks = (progressCtx.line_offset + 2);
-                
-                proceed = readNcaDataByContentId(&ncmStorage, &ncaId, fileOffset, dumpBuf, n);
-                if (!proceed)
+                if (!retrieveNacpDataFromNca(&ncmStorage, &ncaId, &dec_nca_header, xml_content_info[i].decrypted_nca_keys, &dumpArena, &(xml_records[xml_rec_cnt - 1].xml_data), &(xml_records[xml_rec_cnt - 1].xml_size), &(xml_records[xml_rec_cnt - 1].nacp_icons), &(xml_records[xml_rec_cnt - 1].nacp_icon_cnt)))
                 {
-                    breaks++;
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from NCA \"%s\"!", __func__, n, fileOffset, xml_content_info[i].nca_id_str);
-                    dumping = false;
+                    proceed = false;
                     break;
                 }
-                
-                breaks = (progressCtx.line_offset - 4);
-                
-                // Replace NCA header with our modified one
-                if (fileOffset < NCA_FULL_HEADER_LENGTH)
+            }
+            
+            // Retrieve legalinfo.xml
+            if (xml_content_info[i].type == NcmContentType_LegalInformation)
+            {
+                if (!retrieveLegalInfoXmlFromNca(&ncmStorage, &ncaId, &dec_nca_header, xml_content_info[i].decrypted_nca_keys, &dumpArena, &(xml_records[xml_rec_cnt - 1].xml_data), &(xml_records[xml_rec_cnt - 1].xml_size)))
                 {
-                    u64 write_size = (NCA_FULL_HEADER_LENGTH - fileOffset);
-                    if (write_size > n) write_size = n;
-                    
-                    memcpy(dumpBuf, xml_content_info[i].encrypted_header_mod + fileOffset, write_size);
+                    proceed = false;
+                    break;
                 }
-                
-                // Replace modified Program NCA data blocks
-                if (programModIdx != -1)
-                {
-                    u64 internal_block_offset;
-                    u64 internal_block_chunk_size;
-                    
-                    u64 buffer_offset;
-                    u64 buffer_chunk_size;
-                    
-                    if ((fileOffset + n) > ncaProgramMod[programModIdx].hash_table_offset && (ncaProgramMod[programModIdx].hash_table_offset + ncaProgramMod[programModIdx].hash_table_size) > fileOffset)
-                    {
-                        internal_block_offset = (fileOffset > ncaProgramMod[programModIdx].hash_table_offset ? (fileOffset - ncaProgramMod[programModIdx].hash_table_offset) : 0);
-                        internal_block_chunk_size = (ncaProgramMod[programModIdx].hash_table_size - internal_block_offset);
-                        
-                        buffer_offset = (fileOffset > ncaProgramMod[programModIdx].hash_table_offset ? 0 : (ncaProgramMod[programModIdx].hash_table_offset - fileOffset));
-                        buffer_chunk_size = ((n - buffer_offset) > internal_block_chunk_size ? internal_block_chunk_size : (n - buffer_offset));
-                        
-                        memcpy(dumpBuf + buffer_offset, ncaProgramMod[programModIdx].hash_table + internal_block_offset, buffer_chunk_size);
-                    }
+            }
+        }
+        
+        // Reencrypt header
+        if (!encryptNcaHeader(&dec_nca_header, xml_content_info[i].encrypted_header_mod, NCA_FULL_HEADER_LENGTH))
+        {
+            proceed = false;
+            break;
+        }
+    }
+    
+    if (!proceed) goto out;
+    
+    if (proceed && !cnmtFound)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to find CNMT NCA!", __func__);
+        goto out;
+    }
+    
+    // Update NCA counter just in case we found any delta fragments and excluded them
+    titleContentInfoCnt = xml_program_info.nca_cnt;
+    
+    // Fill information for our CNMT XML
+    xml_content_info[titleContentInfoCnt - 1].type = titleContentInfos[cnmtNcaIndex].content_type;
+    memcpy(xml_content_info[titleContentInfoCnt - 1].nca_id, titleContentInfos[cnmtNcaIndex].content_id.c, SHA256_HASH_SIZE / 2); // Temporary
+    convertDataToHexString(titleContentInfos[cnmtNcaIndex].content_id.c, SHA256_HASH_SIZE / 2, xml_content_info[titleContentInfoCnt - 1].nca_id_str, SHA256_HASH_SIZE + 1); // Temporary
+    convertNcaSizeToU64(titleContentInfos[cnmtNcaIndex].size, &(xml_content_info[titleContentInfoCnt - 1].size));
+    xml_content_info[titleContentInfoCnt - 1].id_offset = titleContentInfos[cnmtNcaIndex].id_offset;
+    convertDataToHexString(xml_content_info[titleContentInfoCnt - 1].hash, SHA256_HASH_SIZE, xml_content_info[titleContentInfoCnt - 1].hash_str, (SHA256_HASH_SIZE * 2) + 1); // Temporary
+    
+    memcpy(&ncaId, &(titleContentInfos[cnmtNcaIndex].content_id), sizeof(NcmContentId));
+    
+    // Update CNMT index
+    cnmtNcaIndex = (titleContentInfoCnt - 1);
+    
+    cnmtNcaBuf = arenaAlloc(&dumpArena, xml_content_info[cnmtNcaIndex].size);
+    if (!cnmtNcaBuf)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for CNMT NCA data!", __func__);
+        goto out;
+    }
+    
+    if (!readNcaDataByContentId(&ncmStorage, &ncaId, 0, cnmtNcaBuf, xml_content_info[cnmtNcaIndex].size))
+    {
+        breaks++;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read CNMT NCA \"%s\"!", __func__, xml_content_info[cnmtNcaIndex].nca_id_str);
+        goto out;
+    }
+    
+    // Retrieve CNMT NCA data
+    if (!retrieveCnmtNcaData(curStorageId, cnmtNcaBuf, &xml_program_info, xml_content_info, cnmtNcaIndex, &ncaCnmtMod, &rights_info)) goto out;
+    
+    // Generate a placeholder CNMT XML. It's length will be used to calculate the final output dump size
+    
+    // Make sure that the output buffer for our CNMT XML is big enough
+    cnmtXml = arenaScratch(&dumpArena, NSP_XML_BUFFER_SIZE);
+    if (!cnmtXml)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the CNMT XML!", __func__);
+        goto out;
+    }
+    
+    generateCnmtXml(&xml_program_info, xml_content_info, cnmtXml);
+    
+    // Keep a buffer with the placeholder length. The final CNMT XML is regenerated in place later, and its length is always the same (hashes and NCA IDs are fixed-length hex strings)
+    cnmtXml = arenaMemdup(&dumpArena, cnmtXml, strlen(cnmtXml) + 1);
+    if (!cnmtXml)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the CNMT XML!", __func__);
+        goto out;
+    }
+    
+    // All XML files have been generated, so we don't need the scratch buffer during the dump process
+    arenaReleaseScratch(&dumpArena);
+    
+    bool includeTikAndCert = (rights_info.retrieved_tik && !tiklessDump);
+    
+    if (includeTikAndCert)
+    {
+        // Only mess with the ticket data if removeConsoleData is true, if tiklessDump is false and if we're dealing with a personalized ticket (checked in removeConsoleDataFromTicket())
+        // Ticket files from Patch titles bundled with gamecards always use common titlekey crypto
+        if ((curStorageId == NcmStorageId_SdCard || curStorageId == NcmStorageId_BuiltInUser) && removeConsoleData) removeConsoleDataFromTicket(&rights_info);
+        
+        // Retrieve cert file
+        if (!retrieveCertData(rights_info.cert_data, (rights_info.tik_data.titlekey_type == ETICKET_TITLEKEY_PERSONALIZED)))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+            goto out;
+        }
+        
+        // File count = NCA count + CNMT XML + tik + cert
+        nspPfs0Header.file_cnt = (titleContentInfoCnt + 3);
+        
+        // Calculate PFS0 String Table size
+        nspPfs0StrTableSize = (((nspPfs0Header.file_cnt - 4) * NSP_NCA_FILENAME_LENGTH) + (NSP_CNMT_FILENAME_LENGTH * 2) + NSP_TIK_FILENAME_LENGTH + NSP_CERT_FILENAME_LENGTH);
+    } else {
+        // File count = NCA count + CNMT XML
+        nspPfs0Header.file_cnt = (titleContentInfoCnt + 1);
+        
+        // Calculate PFS0 String Table size
+        nspPfs0StrTableSize = (((nspPfs0Header.file_cnt - 2) * NSP_NCA_FILENAME_LENGTH) + (NSP_CNMT_FILENAME_LENGTH * 2));
+    }
+    
+    // Add our XML records
+    if (xml_rec_cnt)
+    {
+        for(i = 0; i < xml_rec_cnt; i++)
+        {
+            if (!xml_records[i].xml_data || !xml_records[i].xml_size) continue;
+            
+            nspPfs0Header.file_cnt++;
+            u8 type = xml_content_info[xml_records[i].nca_index].type;
+            nspPfs0StrTableSize += (type == NcmContentType_Program ? NSP_PROGRAM_XML_FILENAME_LENGTH : (type == NcmContentType_Control ? NSP_NACP_XML_FILENAME_LENGTH : NSP_LEGAL_XML_FILENAME_LENGTH));
+            progressCtx.totalSize += xml_records[i].xml_size;
+            
+            // Add icons if we retrieved them
+            if (type == NcmContentType_Control && xml_records[i].nacp_icons && xml_records[i].nacp_icon_cnt)
+            {
+                for(j = 0; j < xml_records[i].nacp_icon_cnt; j++)
+                {
+                    nspPfs0Header.file_cnt++;
+                    nspPfs0StrTableSize += (u32)(strlen(xml_records[i].nacp_icons[j].filename) + 1);
+                    progressCtx.totalSize += xml_records[i].nacp_icons[j].icon_size;
+                }
+            }
+        }
+    }
+    
+    // Start NSP creation
+    nspPfs0EntryTable = arenaAlloc(&dumpArena, nspPfs0Header.file_cnt * sizeof(pfs0_file_entry));
+    if (!nspPfs0EntryTable)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the PFS0 file entries!", __func__);
+        goto out;
+    }
+    
+    // Make sure we have enough space
+    nspPfs0StrTable = arenaAlloc(&dumpArena, nspPfs0StrTableSize * 2);
+    if (!nspPfs0StrTable)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the PFS0 string table!", __func__);
+        goto out;
+    }
+    
+    // Determine our full NSP header size
+    fullPfs0HeaderSize = (sizeof(pfs0_header) + ((u64)nspPfs0Header.file_cnt * sizeof(pfs0_file_entry)) + nspPfs0StrTableSize);
+    
+    // Round up our full NSP header size to a 0x10-byte boundary
+    if (!(fullPfs0HeaderSize % 0x10)) fullPfs0HeaderSize++; // If it's already rounded, add more padding
+    fullPfs0HeaderSize = round_up(fullPfs0HeaderSize, 0x10);
+    
+    // Determine our String Table size
+    nspPfs0Header.str_table_size = (fullPfs0HeaderSize - (sizeof(pfs0_header) + ((u64)nspPfs0Header.file_cnt * sizeof(pfs0_file_entry))));
+    
+    // Allocate memory for PFS0 file data pointer array. Exclude all NCAs but the CNMT NCA
+    nspPfs0FilePtrs = arenaAlloc(&dumpArena, (nspPfs0Header.file_cnt - (titleContentInfoCnt - 1)) * sizeof(u8*));
+    if (!nspPfs0FilePtrs)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the PFS0 file data pointer array!", __func__);
+        goto out;
+    }
+    
+    // Fill PFS0 entry table
+    // PFS0 string table will be filled at a later time
+    u64 curFileOffset = 0;
+    u32 curFilenameOffset = 0;
+    
+    u64 entrySize = 0;
+    u32 entryFilenameSize = 0;
+    
+    u32 entryIdx = 0, ptrIdx = 0;
+    
+    for(i = 0; i <= titleContentInfoCnt; i++, entryIdx++)
+    {
+        if (i < titleContentInfoCnt)
+        {
+            // Always reserve the first titleContentInfoCnt entries for our NCAs
+            // Only save the CNMT NCA buffer pointer to the PFS0 file data pointer array. We don't have any other pointers to raw NCA data, so we leave the rest untouched
+            entrySize = xml_content_info[i].size;
+            entryFilenameSize = (i == cnmtNcaIndex ? NSP_CNMT_FILENAME_LENGTH : NSP_NCA_FILENAME_LENGTH);
+            if (i == cnmtNcaIndex) nspPfs0FilePtrs[ptrIdx++] = cnmtNcaBuf;
+        } else {
+            // Reserve the entry right after our NCAs for the CNMT XML
+            entrySize = strlen(cnmtXml);
+            entryFilenameSize = NSP_CNMT_FILENAME_LENGTH;
+            nspPfs0FilePtrs[ptrIdx++] = (u8*)cnmtXml;
+        }
+        
+        nspPfs0EntryTable[i].file_size = entrySize;
+        nspPfs0EntryTable[i].file_offset = curFileOffset;
+        nspPfs0EntryTable[i].filename_offset = curFilenameOffset;
+        
+        curFileOffset += entrySize;
+        curFilenameOffset += entryFilenameSize;
+    }
+    
+    for(i = 0; i < xml_rec_cnt; i++, entryIdx++)
+    {
+        u8 type = xml_content_info[xml_records[i].nca_index].type;
+        
+        if (type == NcmContentType_Control && xml_records[i].nacp_icons && xml_records[i].nacp_icon_cnt)
+        {
+            // Process all icons at once
+            for(j = 0; j < xml_records[i].nacp_icon_cnt; j++, entryIdx++)
+            {
+                entrySize = xml_records[i].nacp_icons[j].icon_size;
+                entryFilenameSize = (u32)(strlen(xml_records[i].nacp_icons[j].filename) + 1); // This is the only entry type with variable filename length
+                nspPfs0FilePtrs[ptrIdx++] = xml_records[i].nacp_icons[j].icon_data;
+                
+                nspPfs0EntryTable[entryIdx].file_size = entrySize;
+                nspPfs0EntryTable[entryIdx].file_offset = curFileOffset;
+                nspPfs0EntryTable[entryIdx].filename_offset = curFilenameOffset;
+                
+                curFileOffset += entrySize;
+                curFilenameOffset += entryFilenameSize;
+            }
+        }
+        
+        // XML entry
+        entrySize = xml_records[i].xml_size;
+        entryFilenameSize = (type == NcmContentType_Program ? NSP_PROGRAM_XML_FILENAME_LENGTH : (type == NcmContentType_Control ? NSP_NACP_XML_FILENAME_LENGTH : NSP_LEGAL_XML_FILENAME_LENGTH));
+        nspPfs0FilePtrs[ptrIdx++] = (u8*)xml_records[i].xml_data;
+        
+        nspPfs0EntryTable[entryIdx].file_size = entrySize;
+        nspPfs0EntryTable[entryIdx].file_offset = curFileOffset;
+        nspPfs0EntryTable[entryIdx].filename_offset = curFilenameOffset;
+        
+        curFileOffset += entrySize;
+        curFilenameOffset += entryFilenameSize;
+    }
+    
+    if (includeTikAndCert)
+    {
+        for(i = 0; i < 2; i++, entryIdx++)
+        {
+            entrySize = (i == 0 ? ETICKET_TIK_FILE_SIZE : ETICKET_CERT_FILE_SIZE);
+            entryFilenameSize = (i == 0 ? NSP_TIK_FILENAME_LENGTH : NSP_CERT_FILENAME_LENGTH);
+            nspPfs0FilePtrs[ptrIdx++] = (i == 0 ? (u8*)(&(rights_info.tik_data)) : rights_info.cert_data);
+            
+            nspPfs0EntryTable[entryIdx].file_size = entrySize;
+            nspPfs0EntryTable[entryIdx].file_offset = curFileOffset;
+            nspPfs0EntryTable[entryIdx].filename_offset = curFilenameOffset;
+            
+            curFileOffset += entrySize;
+            curFilenameOffset += entryFilenameSize;
+        }
+    }
+    
+    // Calculate total dump size
+    progressCtx.totalSize += fullPfs0HeaderSize;
+    for(i = 0; i < titleContentInfoCnt; i++) progressCtx.totalSize += xml_content_info[i].size;
+    progressCtx.totalSize += strlen(cnmtXml);
+    if (includeTikAndCert) progressCtx.totalSize += (ETICKET_TIK_FILE_SIZE + ETICKET_CERT_FILE_SIZE);
+    
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Total NSP dump size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    uiRefreshDisplay();
+    breaks += 2;
+    
+    if (!batch)
+    {
+        if (seqDumpMode)
+        {
+            // Check if the current offset doesn't exceed the total NSP size
+            if (progressCtx.curOffset >= progressCtx.totalSize)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NSP offset in the sequential dump reference file!", __func__);
+                goto out;
+            }
+            
+            // Check if the NCA count is valid
+            // The CNMT NCA is excluded from the hash list
+            if (seqNspCtx.ncaCount != (titleContentInfoCnt - 1))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: NCA count mismatch in the sequential dump reference file! (%u != %u)", __func__, seqNspCtx.ncaCount, titleContentInfoCnt - 1);
+                goto out;
+            }
+            
+            // Check if the Program NCA mod count is valid
+            if (seqNspCtx.programNcaModCount != ncaProgramModCnt)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: Program NCA mod count mismatch in the sequential dump reference file! (%u != %u)", __func__, seqNspCtx.programNcaModCount, ncaProgramModCnt);
+                goto out;
+            }
+            
+            // Check if the PFS0 file count is valid
+            if (seqNspCtx.pfs0FileCount != nspPfs0Header.file_cnt)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: PFS0 file count mismatch in the sequential dump reference file! (%u != %u)", __func__, seqNspCtx.pfs0FileCount, nspPfs0Header.file_cnt);
+                goto out;
+            }
+            
+            // Check if the current PFS0 file index is valid
+            if (seqNspCtx.fileIndex >= nspPfs0Header.file_cnt)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid PFS0 file index in the sequential dump reference file!", __func__);
+                goto out;
+            }
+            
+            // Check if we're really dealing with a title with a missing ticket if preInstall == true
+            if (seqNspCtx.preInstall && !rights_info.missing_tik)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title preinstall status in the sequential dump reference file!", __func__);
+                goto out;
+            }
+            
+            // Check if the current overall offset is aligned to SPLIT_FILE_SEQUENTIAL_SIZE
+            u64 curNspOffset = fullPfs0HeaderSize;
+            for(i = 0; i < seqNspCtx.fileIndex; i++) curNspOffset += nspPfs0EntryTable[i].file_size;
+            curNspOffset += seqNspCtx.fileOffset;
+            
+            if (curNspOffset != progressCtx.curOffset)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: overall NSP dump offset isn't aligned to 0x%08X in the sequential dump reference file!", __func__, (u32)SPLIT_FILE_SEQUENTIAL_SIZE);
+                goto out;
+            }
+            
+            // Check if there's enough free space to continue the sequential dump process
+            u64 restSize = (progressCtx.totalSize - curNspOffset);
+            if (progressCtx.totalSize > freeSpace && ((restSize > SPLIT_FILE_SEQUENTIAL_SIZE && freeSpace < SPLIT_FILE_SEQUENTIAL_SIZE) || (restSize <= SPLIT_FILE_SEQUENTIAL_SIZE && freeSpace < restSize)))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+                goto out;
+            }
+            
+            // Now check if the current PFS0 file entry offset is correct
+            if (seqNspCtx.fileOffset >= nspPfs0EntryTable[seqNspCtx.fileIndex].file_size)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid offset for current PFS0 file entry in the sequential dump reference file!", __func__);
+                goto out;
+            }
+            
+            // Copy previously calculated NCA IDs and hashes
+            for(i = 0; i < seqNspCtx.fileIndex; i++)
+            {
+                // Exit loop if we reach the CNMT NCA
+                // Its ID/hash calculation is always handled by patchCnmtNca()
+                if (i >= (titleContentInfoCnt - 1)) break;
+                
+                // Fill information for our CNMT XML
+                memcpy(xml_content_info[i].nca_id, seqDumpNcaHashes + (i * SHA256_HASH_SIZE), SHA256_HASH_SIZE / 2);
+                convertDataToHexString(xml_content_info[i].nca_id, SHA256_HASH_SIZE / 2, xml_content_info[i].nca_id_str, SHA256_HASH_SIZE + 1);
+                memcpy(xml_content_info[i].hash, seqDumpNcaHashes + (i * SHA256_HASH_SIZE), SHA256_HASH_SIZE);
+                convertDataToHexString(xml_content_info[i].hash, SHA256_HASH_SIZE, xml_content_info[i].hash_str, (SHA256_HASH_SIZE * 2) + 1);
+            }
+            
+            // Copy the NCA SHA-256 context data, but only if we're not dealing with the CNMT NCA
+            if (seqNspCtx.fileIndex < (titleContentInfoCnt - 1)) memcpy(&nca_hash_ctx, &(seqNspCtx.hashCtx), sizeof(Sha256Context));
+            
+            // Restore the modified Program NCA headers
+            // The NPDM signature from the NCA headers is generated using cryptographically secure random numbers, so the modified header is stored during the first sequential dump session
+            // If needed, it must be restored in later sessions
+            for(i = 0; i < ncaProgramModCnt; i++)
+            {
+                read_res = fread(xml_content_info[ncaProgramMod[i].nca_index].encrypted_header_mod, 1, NCA_FULL_HEADER_LENGTH, seqDumpFile);
+                if (read_res != NCA_FULL_HEADER_LENGTH)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk from the sequential dump reference file! (read %lu bytes)", __func__, NCA_FULL_HEADER_LENGTH, read_res);
+                    goto out;
+                }
+            }
+            
+            rewind(seqDumpFile);
+            
+            // Inform that we are resuming an already started sequential dump operation
+            if (curStorageId == NcmStorageId_GameCard)
+            {
+                if (selectedNspDumpType == DUMP_APP_NSP)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous sequential dump operation. Configuration parameters overrided.");
+                    breaks++;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Change NPDM RSA key/sig in Program NCA: %s.", (npdmAcidRsaPatch ? "Yes" : "No"));
+                } else
+                if (selectedNspDumpType == DUMP_PATCH_NSP)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous sequential dump operation. Configuration parameters overrided.");
+                    breaks++;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Generate ticket-less dump: %s | Change NPDM RSA key/sig in Program NCA: %s.", (tiklessDump ? "Yes" : "No"), (npdmAcidRsaPatch ? "Yes" : "No"));
+                } else
+                if (selectedNspDumpType == DUMP_ADDON_NSP)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous sequential dump operation.");
+                }
+            } else {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming previous sequential dump operation. Configuration parameters overrided.");
+                breaks++;
+                
+                if (selectedNspDumpType == DUMP_APP_NSP || selectedNspDumpType == DUMP_PATCH_NSP)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Remove console specific data: %s | Generate ticket-less dump: %s | Change NPDM RSA key/sig in Program NCA: %s.", (removeConsoleData ? "Yes" : "No"), (tiklessDump ? "Yes" : "No"), (npdmAcidRsaPatch ? "Yes" : "No"));
+                } else
+                if (selectedNspDumpType == DUMP_ADDON_NSP)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Remove console specific data: %s | Generate ticket-less dump: %s.", (removeConsoleData ? "Yes" : "No"), (tiklessDump ? "Yes" : "No"));
+                }
+            }
+            
+            breaks++;
+        } else {
+            // The interrupted dump already takes up the space it needs
+            if (!remoteOutput && !journalResume && progressCtx.totalSize > freeSpace)
+            {
+                // Check if we have enough free space
+                // The CNMT NCA is excluded from the hash list
+                seqDumpFileSize = (sizeof(sequentialNspCtx) + ((titleContentInfoCnt - 1) * SHA256_HASH_SIZE) + (ncaProgramModCnt * NCA_FULL_HEADER_LENGTH));
+                if (freeSpace < (SPLIT_FILE_SEQUENTIAL_SIZE + seqDumpFileSize))
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+                    goto out;
+                }
+                
+                // Ask the user if they want to use the sequential dump mode
+                int cur_breaks = breaks;
+                
+                if (!yesNoPrompt("There's not enough space available to generate a whole dump in this session. Do you want to use sequential dumping?\nIn this mode, the selected content will be dumped in more than one session.\nYou'll have to transfer the generated part files to a PC before continuing the process in the next session."))
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+                    goto out;
+                }
+                
+                // Remove the prompt from the screen
+                breaks = cur_breaks;
+                uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+                uiRefreshDisplay();
+                
+                // Modify config parameters
+                isFat32 = true;
+                partSize = SPLIT_FILE_SEQUENTIAL_SIZE;
+                seqDumpMode = true;
+                
+                // Fill information in our sequential context
+                seqNspCtx.storageId = curStorageId;
+                seqNspCtx.removeConsoleData = removeConsoleData;
+                seqNspCtx.tiklessDump = tiklessDump;
+                seqNspCtx.npdmAcidRsaPatch = npdmAcidRsaPatch;
+                seqNspCtx.preInstall = preInstall;
+                seqNspCtx.pfs0FileCount = nspPfs0Header.file_cnt;
+                seqNspCtx.ncaCount = (titleContentInfoCnt - 1); // Exclude the CNMT NCA from the hash list
+                seqNspCtx.programNcaModCount = ncaProgramModCnt;
+                
+                // Allocate memory for the NCA hashes
+                seqDumpNcaHashes = calloc(1, (titleContentInfoCnt - 1) * SHA256_HASH_SIZE);
+                if (!seqDumpNcaHashes)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for NCA hashes from the sequential dump reference file!", __func__);
+                    goto out;
+                }
+                
+                // Create sequential reference file and keep the handle to it opened
+                seqDumpFile = fopen(seqDumpFilename, "wb+");
+                if (!seqDumpFile)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to create sequential dump reference file! (\"%s\")", __func__, seqDumpFilename);
+                    goto out;
+                }
+                
+                // Write the sequential dump struct
+                write_res = fwrite(&seqNspCtx, 1, sizeof(sequentialNspCtx), seqDumpFile);
+                if (write_res != sizeof(sequentialNspCtx))
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, sizeof(sequentialNspCtx), write_res);
+                    seqDumpFileRemove = true;
+                    goto out;
+                }
+                
+                // Write the NCA hashes block
+                write_res = fwrite(seqDumpNcaHashes, 1, (titleContentInfoCnt - 1) * SHA256_HASH_SIZE, seqDumpFile);
+                if (write_res != ((titleContentInfoCnt - 1) * SHA256_HASH_SIZE))
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, (titleContentInfoCnt - 1) * SHA256_HASH_SIZE, write_res);
+                    seqDumpFileRemove = true;
+                    goto out;
+                }
+                
+                // Write the modified Program NCA headers
+                // The NPDM signature from the NCA headers is generated using cryptographically secure random numbers, so we must store the modified header during the first sequential dump session
+                for(i = 0; i < ncaProgramModCnt; i++)
+                {
+                    write_res = fwrite(xml_content_info[ncaProgramMod[i].nca_index].encrypted_header_mod, 1, NCA_FULL_HEADER_LENGTH, seqDumpFile);
+                    if (write_res != NCA_FULL_HEADER_LENGTH)
+                    {
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, NCA_FULL_HEADER_LENGTH, write_res);
+                        seqDumpFileRemove = true;
+                        goto out;
+                    }
+                }
+                
+                rewind(seqDumpFile);
+                
+                // Update free space
+                freeSpace -= seqDumpFileSize;
+            }
+        }
+    } else {
+        if (progressCtx.totalSize > freeSpace)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+            goto out;
+        }
+    }
+    
+    if (compressOutput && (remoteOutput || seqDumpMode))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Output compression disabled (not compatible with %s).", (remoteOutput ? "USB / network dumps" : "sequential dumps"));
+        breaks += 2;
+        compressOutput = false;
+    }
+    
+    if (ncaStore && (seqDumpMode || compressOutput))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "NCA deduplication disabled (not compatible with %s).", (seqDumpMode ? "sequential dumps" : "compressed output dumps"));
+        breaks += 2;
+        ncaStore = NULL;
+    }
+    
+    if (ncaStore && isFat32)
+    {
+        // Store objects can't be split
+        for(i = 0; i < (titleContentInfoCnt - 1); i++)
+        {
+            if (xml_content_info[i].size > FAT32_FILESIZE_LIMIT) break;
+        }
+        
+        if (i < (titleContentInfoCnt - 1))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "NCA deduplication disabled (NCA \"%s\" doesn't fit in a FAT32 partition).", xml_content_info[i].nca_id_str);
+            breaks += 2;
+            ncaStore = NULL;
+        }
+    }
+    
+    dumpExt = (ncaStore ? NSP_MANIFEST_EXTENSION : (compressOutput ? ".nsp" CMP_FILE_EXTENSION : ".nsp"));
+    
+    // Save dump journal checkpoints for regular SD card dumps
+    journalEnabled = (!batch && !remoteOutput && !seqDumpMode && !compressOutput && !ncaStore);
+    if (journalEnabled && !journalPayload)
+    {
+        // The CNMT NCA is excluded from the hash list
+        journalPayloadSize = (u32)(sizeof(sequentialNspCtx) + ((titleContentInfoCnt - 1) * SHA256_HASH_SIZE) + (ncaProgramModCnt * NCA_FULL_HEADER_LENGTH));
+        
+        // Not fatal: the dump just won't be resumable
+        journalPayload = malloc(journalPayloadSize);
+        if (!journalPayload) journalEnabled = false;
+    }
+    
+    if (remoteOutput)
+    {
+        // Only used to send the output filename to the host receiver
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "/%s%s", dumpName, dumpExt);
+    } else
+    if (seqDumpMode)
+    {
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp.%02u", NSP_DUMP_PATH, dumpName, splitIndex);
+    } else
+    if (journalResume)
+    {
+        bool splitDump = (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32);
+        u8 *journalNcaHashes = (journalPayload + sizeof(sequentialNspCtx));
+        u8 *journalProgramHeaders = (journalNcaHashes + (seqNspCtx.ncaCount * SHA256_HASH_SIZE));
+        u64 curNspOffset = fullPfs0HeaderSize;
+        
+        if (splitDump)
+        {
+            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp/%02u", NSP_DUMP_PATH, dumpName, splitIndex);
+        } else {
+            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s%s", NSP_DUMP_PATH, dumpName, dumpExt);
+        }
+        
+        // Checkpoints are only saved within NCAs, excluding the CNMT NCA
+        if (seqNspCtx.fileIndex < (titleContentInfoCnt - 1))
+        {
+            for(i = 0; i < seqNspCtx.fileIndex; i++) curNspOffset += nspPfs0EntryTable[i].file_size;
+            curNspOffset += seqNspCtx.fileOffset;
+        }
+        
+        // Make sure the checkpoint matches the current title and the data that made it to the SD card
+        if (journalHeader.totalSize != progressCtx.totalSize || seqNspCtx.ncaCount != (titleContentInfoCnt - 1) || seqNspCtx.programNcaModCount != ncaProgramModCnt || seqNspCtx.pfs0FileCount != nspPfs0Header.file_cnt || seqNspCtx.fileIndex >= (titleContentInfoCnt - 1) || seqNspCtx.fileOffset >= nspPfs0EntryTable[seqNspCtx.fileIndex].file_size || (seqNspCtx.preInstall && !rights_info.missing_tik) || curNspOffset != journalHeader.offset || journalHeader.partOffset != (splitDump ? (journalHeader.offset - ((u64)splitIndex * partSize)) : journalHeader.offset) || !dumpJournalCheckTail(&journalHeader, dumpPath))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the interrupted dump couldn't be verified! The dump journal has been discarded, please try again.", __func__);
+            journalKeep = false;
+            goto out;
+        }
+        
+        // Copy previously calculated NCA IDs and hashes
+        for(i = 0; i < seqNspCtx.fileIndex; i++)
+        {
+            memcpy(xml_content_info[i].nca_id, journalNcaHashes + (i * SHA256_HASH_SIZE), SHA256_HASH_SIZE / 2);
+            convertDataToHexString(xml_content_info[i].nca_id, SHA256_HASH_SIZE / 2, xml_content_info[i].nca_id_str, SHA256_HASH_SIZE + 1);
+            memcpy(xml_content_info[i].hash, journalNcaHashes + (i * SHA256_HASH_SIZE), SHA256_HASH_SIZE);
+            convertDataToHexString(xml_content_info[i].hash, SHA256_HASH_SIZE, xml_content_info[i].hash_str, (SHA256_HASH_SIZE * 2) + 1);
+        }
+        
+        // Copy the NCA SHA-256 context data
+        memcpy(&nca_hash_ctx, &(seqNspCtx.hashCtx), sizeof(Sha256Context));
+        
+        // Restore the modified Program NCA headers (their NPDM signature is generated using cryptographically secure random numbers)
+        for(i = 0; i < ncaProgramModCnt; i++) memcpy(xml_content_info[ncaProgramMod[i].nca_index].encrypted_header_mod, journalProgramHeaders + (i * NCA_FULL_HEADER_LENGTH), NCA_FULL_HEADER_LENGTH);
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Resuming interrupted dump from offset 0x%016lX. Configuration parameters overrided.", journalHeader.offset);
+        breaks++;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Remove console specific data: %s | Generate ticket-less dump: %s | Change NPDM RSA key/sig in Program NCA: %s.", (removeConsoleData ? "Yes" : "No"), (tiklessDump ? "Yes" : "No"), (npdmAcidRsaPatch ? "Yes" : "No"));
+        breaks += 2;
+    } else {
+        // Temporary, we'll use this to check if the dump already exists (it should have the archive bit set if so)
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s%s", NSP_DUMP_PATH, dumpName, dumpExt);
+        
+        // Check if the dump already exists
+        if (!batch && checkIfFileExists(dumpPath))
+        {
+            // Ask the user if they want to proceed anyway
+            int cur_breaks = breaks;
+            
+            proceed = yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?");
+            if (!proceed)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+                removeFile = false;
+                goto out;
+            } else {
+                // Remove the prompt from the screen
+                breaks = cur_breaks;
+                uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+            }
+        }
+        
+        // Since we may actually be dealing with an existing directory with the archive bit set or unset, let's try both
+        // Better safe than sorry
+        remove(dumpPath);
+        fsdevDeleteDirectoryRecursively(dumpPath);
+        
+        // cmpFileCreate() takes care of the split output directory by itself, and NSP manifests are never split
+        if (!compressOutput && !ncaStore && progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+        {
+            mkdir(dumpPath, 0744);
+            
+            sprintf(tmp_idx, "/%02u", splitIndex);
+            strcat(dumpPath, tmp_idx);
+        }
+    }
+    
+    if (remoteOutput)
+    {
+        if (!sinkOpen(&sinkCtx, outputTarget)) goto out;
+        
+        // The PFS0 header is only known once all NCA hashes have been calculated, so the whole NSP is always sent again
+        if (!sinkBeginFile(&sinkCtx, strrchr(dumpPath, '/') + 1, progressCtx.totalSize, false, &resumeOffset)) goto out;
+    } else
+    if (ncaStore)
+    {
+        // The manifest only holds the PFS0 header and the PFS0 entries that aren't written to the NCA store (everything from the CNMT NCA onwards)
+        manifestPrefixSize = (sizeof(nsp_manifest_header) + fullPfs0HeaderSize + ((u64)nspPfs0Header.file_cnt * sizeof(nsp_manifest_entry)));
+        storeOptions = getDumpedTitleOptions(removeConsoleData, tiklessDump, npdmAcidRsaPatch, false);
+        
+        if (!outFileCreate(&outFile, dumpPath, manifestPrefixSize + (progressCtx.totalSize - fullPfs0HeaderSize - nspPfs0EntryTable[titleContentInfoCnt - 1].file_offset)))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output manifest file \"%s\"!", __func__, dumpPath);
+            goto out;
+        }
+    } else
+    if (compressOutput)
+    {
+        // Move the NCA crypto regions to their NSP offsets, dropping the empty slots. The CNMT NCA is left alone, since it gets rebuilt anyway
+        for(i = 0; i < (titleContentInfoCnt - 1); i++)
+        {
+            for(j = 0; j < 4; j++)
+            {
+                cmp_file_crypto_region *region = &(cmpRegions[(i * 4) + j]);
+                if (!region->size) continue;
+                
+                region->offset += (fullPfs0HeaderSize + nspPfs0EntryTable[i].file_offset);
+                
+                memmove(&(cmpRegions[cmpRegionCnt]), region, sizeof(cmp_file_crypto_region));
+                cmpRegionCnt++;
+            }
+        }
+        
+        // The PFS0 header is stored uncompressed, since it's only written once the NCA hashes are known
+        if (!cmpFileCreate(&cmpFile, dumpPath, progressCtx.totalSize, fullPfs0HeaderSize, cmpRegions, cmpRegionCnt, isFat32))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to create compressed output file \"%s\"!", __func__, dumpPath);
+            goto out;
+        }
+    } else
+    if (journalResume)
+    {
+        if (!outFileOpen(&outFile, dumpPath))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\" to resume the interrupted dump! (0x%08X)", __func__, dumpPath, outFile.lastResult);
+            goto out;
+        }
+        
+        outFileSeek(&outFile, journalHeader.partOffset);
+    } else
+    if (!outFileCreate(&outFile, dumpPath, getOutputFileAllocSize(progressCtx.totalSize, partSize, splitIndex, (seqDumpMode || (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)))))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
+        goto out;
+    }
+    
+    // Start dump process
+    if (!batch) dumpStartMsg();
+    perfStart();
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    
+    if (!batch)
+    {
+        breaks++;
+        changeHomeButtonBlockStatus(true);
+    }
+    
+    if (seqDumpMode)
+    {
+        // Skip the PFS0 header in the first part file
+        // It will be saved to an additional ".nsp.hdr" file
+        if (!seqNspCtx.partNumber) progressCtx.curOffset = seqDumpSessionOffset = fullPfs0HeaderSize;
+    } else
+    if (ncaStore)
+    {
+        // Write placeholder zeroes for the manifest header, the PFS0 header and the manifest entry table
+        memset(dumpBuf, 0, manifestPrefixSize);
+        
+        write_res = outFileWrite(&outFile, dumpBuf, manifestPrefixSize);
+        if (write_res != manifestPrefixSize)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes placeholder data to file offset 0x%016lX! (wrote %lu bytes)", __func__, manifestPrefixSize, (u64)0, write_res);
+            goto out;
+        }
+        
+        progressCtx.curOffset = fullPfs0HeaderSize;
+    } else
+    if (!journalResume)
+    {
+        // Write placeholder zeroes
+        // The PFS0 header of a resumed dump is also written once everything else is done
+        if (remoteOutput)
+        {
+            write_res = sinkWrite(&sinkCtx, dumpBuf, fullPfs0HeaderSize);
+        } else {
+            write_res = (compressOutput ? (cmpFileWrite(&cmpFile, dumpBuf, fullPfs0HeaderSize) ? fullPfs0HeaderSize : 0) : outFileWrite(&outFile, dumpBuf, fullPfs0HeaderSize));
+        }
+        if (write_res != fullPfs0HeaderSize)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes placeholder data to file offset 0x%016lX! (wrote %lu bytes)", __func__, fullPfs0HeaderSize, (u64)0, write_res);
+            goto out;
+        }
+        
+        // Advance our current offset
+        progressCtx.curOffset = fullPfs0HeaderSize;
+    }
+    
+    progressCtx.line_offset = (breaks + 4);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    
+    // Setup the dump pipeline
+    // NCA reads and Program NCA patching take place on the main thread, while SHA-256 calculation and output file writes are offloaded to worker threads
+    dumpBlockSource blockSource = (curStorageId == NcmStorageId_GameCard ? DUMP_BLOCK_SOURCE_GAMECARD : (curStorageId == NcmStorageId_SdCard ? DUMP_BLOCK_SOURCE_SDCARD : DUMP_BLOCK_SOURCE_EMMC));
+    
+    u64 blockSize = initDumpPipeline(&(nspPipeCtx.pipeCtx), 3, blockSource, BENCHMARK_STAGE_SHA256 | (!remoteOutput ? BENCHMARK_STAGE_SDCARD : 0));
+    if (!blockSize)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for the dump pipeline buffers!", __func__);
+        goto out;
+    }
+    
+    nspPipeCtx.hashCtx = &nca_hash_ctx;
+    nspPipeCtx.hashEntryCnt = (titleContentInfoCnt - 1);
+    nspPipeCtx.outFile = &outFile;
+    nspPipeCtx.cmpFile = (compressOutput ? &cmpFile : NULL);
+    nspPipeCtx.storeFile = (ncaStore ? &storeFile : NULL);
+    nspPipeCtx.sink = (remoteOutput ? &sinkCtx : NULL);
+    nspPipeCtx.dumpName = dumpName;
+    nspPipeCtx.splitIndex = splitIndex;
+    nspPipeCtx.partSize = partSize;
+    nspPipeCtx.totalSize = progressCtx.totalSize;
+    nspPipeCtx.seqDumpMode = seqDumpMode;
+    nspPipeCtx.isFat32 = isFat32;
+    
+    if (!pipelineStartWorker(&(nspPipeCtx.pipeCtx), nspPipelineHasherThreadFunc, &nspPipeCtx) || !pipelineStartWorker(&(nspPipeCtx.pipeCtx), nspPipelineWriterThreadFunc, &nspPipeCtx))
+    {
+        pipelineAbort(&(nspPipeCtx.pipeCtx));
+        pipelineJoinWorkers(&(nspPipeCtx.pipeCtx));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to start dump pipeline threads!", __func__);
+        goto out;
+    }
+    
+    dumping = true;
+    
+    progressUiThreadStart(&progressCtx);
+    
+    // Read the metadata from the next batch entry while this title is being written
+    // If the prefetch thread can't be started, the next title will just be set up from scratch
+    if (batch && nspBatchPrefetch && !nspBatchPrefetch->started) nspBatchPrefetch->started = pipelineStartWorker(&(nspBatchPrefetch->pipeCtx), nspBatchPrefetchThreadFunc, nspBatchPrefetch);
+    
+    u32 startFileIndex = ((seqDumpMode || journalResume) ? seqNspCtx.fileIndex : 0);
+    u64 startFileOffset;
+    
+    // Write all PFS0 entries
+    for(i = startFileIndex; i < nspPfs0Header.file_cnt; i++, startFileIndex++)
+    {
+        char *entryFilename = NULL;
+        
+        n = blockSize;
+        
+        startFileOffset = (((seqDumpMode || journalResume) && i == seqNspCtx.fileIndex) ? seqNspCtx.fileOffset : 0);
+        
+        int programModIdx = -1;
+        const nca_store_record *storeRecord = NULL;
+        
+        // Check if we're dealing with a NCA
+        if (i < titleContentInfoCnt)
+        {
+            // Check if we're not dealing with the CNMT NCA
+            if (i < (titleContentInfoCnt - 1))
+            {
+                // Copy NCA ID
+                memcpy(ncaId.c, xml_content_info[i].nca_id, SHA256_HASH_SIZE / 2);
+                
+                // Reset SHA-256 context if necessary
+                if ((!seqDumpMode && !journalResume) || i != seqNspCtx.fileIndex) sha256ContextCreate(&nca_hash_ctx);
+                
+                // Retrieve Program NCA mod data index
+                if (xml_content_info[i].type == NcmContentType_Program && ncaProgramModCnt > 0)
+                {
+                    for(j = 0; j < ncaProgramModCnt; j++)
+                    {
+                        if (ncaProgramMod[j].nca_index == i)
+                        {
+                            programModIdx = (int)j;
+                            break;
+                        }
+                    }
+                }
+                
+                if (ncaStore)
+                {
+                    // Modified Program NCAs are never looked up, since their NPDM signature is generated using random numbers
+                    if (programModIdx == -1) storeRecord = ncaStoreFind(ncaStore, xml_content_info[i].nca_id, storeOptions);
+                    
+                    if (storeRecord)
+                    {
+                        // Nothing has to be read from this NCA
+                        startFileOffset = nspPfs0EntryTable[i].file_size;
+                        progressCtx.curOffset += startFileOffset;
+                        ncaStore->reusedSize += startFileOffset;
+                        
+                        printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "NCA \"%s\" (%s) is already in the NCA store.", xml_content_info[i].nca_id_str, getContentType(xml_content_info[i].type));
+                        printProgressBar(&progressCtx, false, 0);
+                    } else {
+                        // The pipeline is idle at this point, so the writer thread isn't using the store file
+                        ncaStoreGetTmpPath(xml_content_info[i].nca_id, storeTmpPath, MAX_CHARACTERS(storeTmpPath));
+                        
+                        if (!outFileCreate(&storeFile, storeTmpPath, xml_content_info[i].size))
+                        {
+                            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to create NCA store file \"%s\"! (0x%08X)", __func__, storeTmpPath, storeFile.lastResult);
+                            proceed = false;
+                            break;
+                        }
+                    }
+                }
+            } else {
+                // Patch CNMT NCA
+                breaks = (progressCtx.line_offset + 2);
+                
+                proceed = patchCnmtNca(cnmtNcaBuf, xml_content_info[cnmtNcaIndex].size, &xml_program_info, xml_content_info, &ncaCnmtMod);
+                if (!proceed)
+                {
+                    dumping = false;
+                    break;
+                }
+                
+                breaks = (progressCtx.line_offset - 4);
+                
+                // Generate proper CNMT XML
+                generateCnmtXml(&xml_program_info, xml_content_info, cnmtXml);
+                
+                // Fill PFS0 string table
+                // This is done here because we'll need to display filenames for the rest of the PFS0 entries starting with the next loop iteration
+                entryIdx = 0;
+                
+                for(j = 0; j <= titleContentInfoCnt; j++, entryIdx++)
+                {
+                    char *curFilename = (nspPfs0StrTable + nspPfs0EntryTable[entryIdx].filename_offset);
+                    
+                    if (j < titleContentInfoCnt)
+                    {
+                        sprintf(curFilename, "%s.%s", xml_content_info[j].nca_id_str, (j == cnmtNcaIndex ? "cnmt.nca" : "nca"));
+                    } else
+                    if (j == titleContentInfoCnt)
+                    {
+                        sprintf(curFilename, "%s.cnmt.xml", xml_content_info[cnmtNcaIndex].nca_id_str);
+                    }
+                }
+                
+                for(j = 0; j < xml_rec_cnt; j++, entryIdx++)
+                {
+                    u8 type = xml_content_info[xml_records[j].nca_index].type;
+                    
+                    if (type == NcmContentType_Control && xml_records[j].nacp_icons && xml_records[j].nacp_icon_cnt)
+                    {
+                        // Process all icons at once
+                        for(u32 k = 0; k < xml_records[j].nacp_icon_cnt; k++, entryIdx++)
+                        {
+                            char *curFilename = (nspPfs0StrTable + nspPfs0EntryTable[entryIdx].filename_offset);
+                            sprintf(curFilename, "%s%s", xml_content_info[xml_records[j].nca_index].nca_id_str, strchr(xml_records[j].nacp_icons[k].filename, '.'));
+                        }
+                    }
+                    
+                    char *curFilename = (nspPfs0StrTable + nspPfs0EntryTable[entryIdx].filename_offset);
+                    sprintf(curFilename, "%s.%s.xml", xml_content_info[xml_records[j].nca_index].nca_id_str, (type == NcmContentType_Program ? "programinfo" : (type == NcmContentType_Control ? "nacp" : "legalinfo")));
+                }
+                
+                if (includeTikAndCert)
+                {
+                    for(j = 0; j < 2; j++, entryIdx++)
+                    {
+                        char *curFilename = (nspPfs0StrTable + nspPfs0EntryTable[entryIdx].filename_offset);
+                        sprintf(curFilename, (j == 0 ? rights_info.tik_filename : rights_info.cert_filename));
+                    }
+                }
+            }
+        } else {
+            // Copy current filename
+            entryFilename = (nspPfs0StrTable + nspPfs0EntryTable[i].filename_offset);
+        }
+        
+        for(fileOffset = startFileOffset; fileOffset < nspPfs0EntryTable[i].file_size; fileOffset += n, progressCtx.curOffset += n, seqDumpSessionOffset += n)
+        {
+            if (seqDumpMode && seqDumpFinish)
+            {
+                ret = 0;
+                break;
+            }
+            
+            nspPipelineSyncSplitIndex(&nspPipeCtx, &splitIndex, dumpPath);
+            printProgressStatus(&progressCtx, PROGRESS_STATUS_UPPER, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+            
+            if (i < titleContentInfoCnt)
+            {
+                printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "Dumping NCA \"%s\" (%s)...", xml_content_info[i].nca_id_str, getContentType(xml_content_info[i].type));
+            } else {
+                printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "Writing \"%s\"...", entryFilename);
+            }
+            
+            if (n > (nspPfs0EntryTable[i].file_size - fileOffset)) n = (nspPfs0EntryTable[i].file_size - fileOffset);
+            
+            // Check if the next read chunk will exceed the size of the current part file
+            if (seqDumpMode && (seqDumpSessionOffset + n) >= (((splitIndex - seqNspCtx.partNumber) + 1) * partSize))
+            {
+                u64 new_file_chunk_size = ((seqDumpSessionOffset + n) - (((splitIndex - seqNspCtx.partNumber) + 1) * partSize));
+                u64 old_file_chunk_size = (n - new_file_chunk_size);
+                
+                u64 remainderDumpSize = (progressCtx.totalSize - (progressCtx.curOffset + old_file_chunk_size));
+                u64 remainderFreeSize = (freeSpace - (seqDumpSessionOffset + old_file_chunk_size));
+                
+                // Check if we have enough space for the next part
+                // If so, set the chunk size to old_file_chunk_size
+                if ((remainderDumpSize <= partSize && remainderDumpSize > remainderFreeSize) || (remainderDumpSize > partSize && partSize > remainderFreeSize))
+                {
+                    n = old_file_chunk_size;
+                    seqDumpFinish = true;
+                }
+            }
+            
+            pipeline_slot_t *slot = pipelineAcquire(&(nspPipeCtx.pipeCtx), 0);
+            if (!slot)
+            {
+                // The writer thread bailed out
+                proceed = false;
+                break;
+            }
+            
+            u8 *chunkBuf = slot->data;
+            
+            if (i < (titleContentInfoCnt - 1))
+            {
+                breaks = (progressCtx.line_offset + 2);
+                
+                proceed = readNcaDataByContentId(&ncmStorage, &ncaId, fileOffset, chunkBuf, n);
+                if (!proceed)
+                {
+                    breaks++;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from NCA \"%s\"!", __func__, n, fileOffset, xml_content_info[i].nca_id_str);
+                    dumping = false;
+                    break;
+                }
+                
+                breaks = (progressCtx.line_offset - 4);
+                
+                // Replace NCA header with our modified one
+                if (fileOffset < NCA_FULL_HEADER_LENGTH)
+                {
+                    u64 write_size = (NCA_FULL_HEADER_LENGTH - fileOffset);
+                    if (write_size > n) write_size = n;
+                    
+                    memcpy(chunkBuf, xml_content_info[i].encrypted_header_mod + fileOffset, write_size);
+                }
+                
+                // Replace modified Program NCA data blocks
+                if (programModIdx != -1)
+                {
+                    u64 internal_block_offset;
+                    u64 internal_block_chunk_size;
+                    
+                    u64 buffer_offset;
+                    u64 buffer_chunk_size;
+                    
+                    if ((fileOffset + n) > ncaProgramMod[programModIdx].hash_table_offset && (ncaProgramMod[programModIdx].hash_table_offset + ncaProgramMod[programModIdx].hash_table_size) > fileOffset)
+                    {
+                        internal_block_offset = (fileOffset > ncaProgramMod[programModIdx].hash_table_offset ? (fileOffset - ncaProgramMod[programModIdx].hash_table_offset) : 0);
+                        internal_block_chunk_size = (ncaProgramMod[programModIdx].hash_table_size - internal_block_offset);
+                        
+                        buffer_offset = (fileOffset > ncaProgramMod[programModIdx].hash_table_offset ? 0 : (ncaProgramMod[programModIdx].hash_table_offset - fileOffset));
+                        buffer_chunk_size = ((n - buffer_offset) > internal_block_chunk_size ? internal_block_chunk_size : (n - buffer_offset));
+                        
+                        memcpy(chunkBuf + buffer_offset, ncaProgramMod[programModIdx].hash_table + internal_block_offset, buffer_chunk_size);
+                    }
                     
                     if ((fileOffset + n) > ncaProgramMod[programModIdx].block_offset[0] && (ncaProgramMod[programModIdx].block_offset[0] + ncaProgramMod[programModIdx].block_size[0]) > fileOffset)
                     {
-                        internal_block_offset = (fileOffset > ncaProgramMod[programModIdx].block_offset[0] ? (fileOffset - ncaProgramMod[programModIdx].block_offset[0]) : 0);
-                        internal_block_chunk_size = (ncaProgramMod[programModIdx].block_size[0] - internal_block_offset);
-                        
-                        buffer_offset = (fileOffset > ncaProgramMod[programModIdx].block_offset[0] ? 0 : (ncaProgramMod[programModIdx].block_offset[0] - fileOffset));
-                        buffer_chunk_size = ((n - buffer_offset) > internal_block_chunk_size ? internal_block_chunk_size : (n - buffer_offset));
-                        
-                        memcpy(dumpBuf + buffer_offset, ncaProgramMod[programModIdx].block_data[0] + internal_block_offset, buffer_chunk_size);
+                        internal_block_offset = (fileOffset > ncaProgramMod[programModIdx].block_offset[0] ? (fileOffset - ncaProgramMod[programModIdx].block_offset[0]) : 0);
+                        internal_block_chunk_size = (ncaProgramMod[programModIdx].block_size[0] - internal_block_offset);
+                        
+                        buffer_offset = (fileOffset > ncaProgramMod[programModIdx].block_offset[0] ? 0 : (ncaProgramMod[programModIdx].block_offset[0] - fileOffset));
+                        buffer_chunk_size = ((n - buffer_offset) > internal_block_chunk_size ? internal_block_chunk_size : (n - buffer_offset));
+                        
+                        memcpy(chunkBuf + buffer_offset, ncaProgramMod[programModIdx].block_data[0] + internal_block_offset, buffer_chunk_size);
+                    }
+                    
+                    if (ncaProgramMod[programModIdx].block_mod_cnt == 2 && (fileOffset + n) > ncaProgramMod[programModIdx].block_offset[1] && (ncaProgramMod[programModIdx].block_offset[1] + ncaProgramMod[programModIdx].block_size[1]) > fileOffset)
+                    {
+                        internal_block_offset = (fileOffset > ncaProgramMod[programModIdx].block_offset[1] ? (fileOffset - ncaProgramMod[programModIdx].block_offset[1]) : 0);
+                        internal_block_chunk_size = (ncaProgramMod[programModIdx].block_size[1] - internal_block_offset);
+                        
+                        buffer_offset = (fileOffset > ncaProgramMod[programModIdx].block_offset[1] ? 0 : (ncaProgramMod[programModIdx].block_offset[1] - fileOffset));
+                        buffer_chunk_size = ((n - buffer_offset) > internal_block_chunk_size ? internal_block_chunk_size : (n - buffer_offset));
+                        
+                        memcpy(chunkBuf + buffer_offset, ncaProgramMod[programModIdx].block_data[1] + internal_block_offset, buffer_chunk_size);
+                    }
+                }
+            } else {
+                // Copy data using pointer array
+                u32 ptrIdx = (i - (titleContentInfoCnt - 1));
+                memcpy(chunkBuf, nspPfs0FilePtrs[ptrIdx] + fileOffset, n);
+            }
+            
+            slot->size = n;
+            slot->offset = progressCtx.curOffset;
+            slot->entry_idx = i;
+            slot->entry_offset = fileOffset;
+            slot->last = seqDumpFinish;
+            
+            // Hand the chunk over to the SHA-256 and writer threads
+            pipelineRelease(&(nspPipeCtx.pipeCtx), slot);
+            
+            if (seqDumpMode) progressCtx.seqDumpCurOffset = seqDumpSessionOffset;
+            printProgressBar(&progressCtx, true, n);
+            
+            if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+                ret = -2;
+                proceed = false;
+                
+                // Canceled dumps are discarded
+                journalKeep = false;
+                
+                break;
+            }
+            
+            // Save a checkpoint to the dump journal every DUMP_JOURNAL_INTERVAL bytes
+            // Checkpoints are only saved within NCAs (excluding the CNMT NCA), since everything else is generated from scratch in every run
+            if (journalEnabled && i < (titleContentInfoCnt - 1) && (fileOffset + n) < nspPfs0EntryTable[i].file_size && dumpJournalCheckpointCrossed(progressCtx.curOffset, n))
+            {
+                // The SHA-256 context and the output file must catch up with the checkpoint
+                if (!pipelineWaitIdle(&(nspPipeCtx.pipeCtx)))
+                {
+                    proceed = false;
+                    break;
+                }
+                
+                nspPipelineSyncSplitIndex(&nspPipeCtx, &splitIndex, dumpPath);
+                
+                sequentialNspCtx *journalNspCtx = (sequentialNspCtx*)journalPayload;
+                u8 *journalNcaHashes = (journalPayload + sizeof(sequentialNspCtx));
+                u8 *journalProgramHeaders = (journalNcaHashes + ((titleContentInfoCnt - 1) * SHA256_HASH_SIZE));
+                
+                memset(journalPayload, 0, journalPayloadSize);
+                
+                journalNspCtx->storageId = curStorageId;
+                journalNspCtx->removeConsoleData = removeConsoleData;
+                journalNspCtx->tiklessDump = tiklessDump;
+                journalNspCtx->npdmAcidRsaPatch = npdmAcidRsaPatch;
+                journalNspCtx->preInstall = preInstall;
+                journalNspCtx->partNumber = splitIndex;
+                journalNspCtx->pfs0FileCount = nspPfs0Header.file_cnt;
+                journalNspCtx->ncaCount = (titleContentInfoCnt - 1);
+                journalNspCtx->programNcaModCount = ncaProgramModCnt;
+                journalNspCtx->fileIndex = i;
+                journalNspCtx->fileOffset = (fileOffset + n);
+                memcpy(&(journalNspCtx->hashCtx), &nca_hash_ctx, sizeof(Sha256Context));
+                
+                for(j = 0; j < i; j++) memcpy(journalNcaHashes + (j * SHA256_HASH_SIZE), xml_content_info[j].hash, SHA256_HASH_SIZE);
+                for(j = 0; j < ncaProgramModCnt; j++) memcpy(journalProgramHeaders + (j * NCA_FULL_HEADER_LENGTH), xml_content_info[ncaProgramMod[j].nca_index].encrypted_header_mod, NCA_FULL_HEADER_LENGTH);
+                
+                journalHeader.type = DUMP_JOURNAL_TYPE_NSP;
+                journalHeader.flags = (isFat32 ? DUMP_JOURNAL_FLAG_FAT32 : 0);
+                journalHeader.partIndex = splitIndex;
+                journalHeader.totalSize = progressCtx.totalSize;
+                journalHeader.offset = (progressCtx.curOffset + n);
+                journalHeader.partOffset = outFile.offset;
+                
+                dumpJournalSetTail(&journalHeader, chunkBuf, n);
+                
+                // A failed checkpoint doesn't affect the dump itself
+                if (outFileFlush(&outFile) && dumpJournalSave(journalFilename, &journalHeader, journalPayload, journalPayloadSize)) journalKeep = true;
+            }
+        }
+        
+        // Wait until the SHA-256 and writer threads are done with the current NCA before retrieving its hash
+        if (proceed && i < (titleContentInfoCnt - 1) && !pipelineWaitIdle(&(nspPipeCtx.pipeCtx))) proceed = false;
+        
+        if (!proceed || ret >= 0) break;
+        
+        // Support empty files
+        if (!nspPfs0EntryTable[i].file_size)
+        {
+            nspPipelineSyncSplitIndex(&nspPipeCtx, &splitIndex, dumpPath);
+            printProgressStatus(&progressCtx, PROGRESS_STATUS_UPPER, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+            
+            if (i < titleContentInfoCnt)
+            {
+                printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "Dumping NCA \"%s\" (%s)...", xml_content_info[i].nca_id_str, getContentType(xml_content_info[i].type));
+            } else {
+                printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "Writing \"%s\"...", entryFilename);
+            }
+            
+            printProgressBar(&progressCtx, false, 0);
+        }
+        
+        // Check if we're not dealing with the CNMT NCA
+        if (i < (titleContentInfoCnt - 1))
+        {
+            // Update content info
+            if (storeRecord)
+            {
+                memcpy(xml_content_info[i].hash, storeRecord->hash, SHA256_HASH_SIZE);
+            } else {
+                sha256ContextGetHash(&nca_hash_ctx, xml_content_info[i].hash);
+            }
+            
+            convertDataToHexString(xml_content_info[i].hash, SHA256_HASH_SIZE, xml_content_info[i].hash_str, (SHA256_HASH_SIZE * 2) + 1);
+            memcpy(xml_content_info[i].nca_id, xml_content_info[i].hash, SHA256_HASH_SIZE / 2);
+            convertDataToHexString(xml_content_info[i].nca_id, SHA256_HASH_SIZE / 2, xml_content_info[i].nca_id_str, SHA256_HASH_SIZE + 1);
+            
+            // If we're doing a sequential dump and we just finished dumping a NCA, copy its calculated hash
+            if (seqDumpMode) memcpy(seqDumpNcaHashes + (i * SHA256_HASH_SIZE), xml_content_info[i].hash, SHA256_HASH_SIZE);
+            
+            // Move the NCA we just wrote into the NCA store
+            if (storeFile.open)
+            {
+                if (!outFileClose(&storeFile) || !ncaStoreCommitObject(storeTmpPath, xml_content_info[i].hash))
+                {
+                    remove(storeTmpPath);
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to move NCA \"%s\" into the NCA store!", __func__, xml_content_info[i].nca_id_str);
+                    proceed = false;
+                    break;
+                }
+                
+                if (programModIdx == -1)
+                {
+                    nca_store_record newStoreRecord;
+                    memset(&newStoreRecord, 0, sizeof(nca_store_record));
+                    
+                    memcpy(newStoreRecord.contentId, ncaId.c, sizeof(newStoreRecord.contentId));
+                    newStoreRecord.options = storeOptions;
+                    newStoreRecord.size = xml_content_info[i].size;
+                    memcpy(newStoreRecord.hash, xml_content_info[i].hash, SHA256_HASH_SIZE);
+                    
+                    // Not fatal: the NCA will just be read again by the next dump that needs it
+                    ncaStoreAddRecord(ncaStore, &newStoreRecord);
+                }
+            }
+        }
+    }
+    
+    // Flush pending chunks and stop the worker threads
+    if (proceed && !pipelineWaitIdle(&(nspPipeCtx.pipeCtx))) proceed = false;
+    
+    pipelineAbort(&(nspPipeCtx.pipeCtx));
+    pipelineJoinWorkers(&(nspPipeCtx.pipeCtx));
+    
+    nspPipelineSyncSplitIndex(&nspPipeCtx, &splitIndex, dumpPath);
+    
+    progressUiThreadStop(&progressCtx);
+    
+    if (strlen(nspPipeCtx.errorMsg))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s", nspPipeCtx.errorMsg);
+        
+        if (nspPipeCtx.fat32Error)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable the \"Split output dump\" option.");
+            fat32_error = true;
+        }
+        
+        proceed = false;
+    }
+    
+    if (!proceed || ret >= 0)
+    {
+        if (!proceed)
+        {
+            setProgressBarError(&progressCtx);
+            if (seqDumpMode) seqDumpFileRemove = true;
+        }
+        
+        goto out;
+    }
+    
+    printProgressStatus(&progressCtx, PROGRESS_STATUS_UPPER, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+    
+    printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "Writing PFS0 header...");
+    
+    uiRefreshDisplay();
+    
+    // Write our full PFS0 header
+    memcpy(dumpBuf, &nspPfs0Header, sizeof(pfs0_header));
+    memcpy(dumpBuf + sizeof(pfs0_header), nspPfs0EntryTable, (u64)nspPfs0Header.file_cnt * sizeof(pfs0_file_entry));
+    memcpy(dumpBuf + sizeof(pfs0_header) + ((u64)nspPfs0Header.file_cnt * sizeof(pfs0_file_entry)), nspPfs0StrTable, nspPfs0Header.str_table_size);
+    
+    if (remoteOutput)
+    {
+        // Replace the placeholder PFS0 header on the host side
+        write_res = sinkWriteAt(&sinkCtx, 0, dumpBuf, fullPfs0HeaderSize);
+        if (write_res != fullPfs0HeaderSize)
+        {
+            setProgressBarError(&progressCtx);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to send %lu bytes PFS0 header to the host receiver! (sent %lu bytes)", __func__, fullPfs0HeaderSize, write_res);
+            goto out;
+        }
+        
+        if (!sinkEndFile(&sinkCtx))
+        {
+            setProgressBarError(&progressCtx);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: the host receiver didn't acknowledge the output dump!", __func__);
+            goto out;
+        }
+    } else
+    if (seqDumpMode)
+    {
+        // Just in case
+        remove(pfs0HeaderFilename);
+        
+        // Check if we have enough space for the header file
+        u64 curFreeSpace = (freeSpace - seqDumpSessionOffset);
+        if (!seqNspCtx.partNumber) curFreeSpace += fullPfs0HeaderSize; // The PFS0 header size is skipped during the first sequential dump session
+        
+        if (curFreeSpace < fullPfs0HeaderSize)
+        {
+            // Finish current sequential dump session
+            seqDumpFinish = true;
+            ret = 0;
+            goto out;
+        }
+        
+        pfs0HeaderFile = fopen(pfs0HeaderFilename, "wb");
+        if (!pfs0HeaderFile)
+        {
+            setProgressBarError(&progressCtx);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to create PFS0 header file!", __func__);
+            seqDumpFileRemove = true;
+            goto out;
+        }
+        
+        write_res = fwrite(dumpBuf, 1, fullPfs0HeaderSize, pfs0HeaderFile);
+        fclose(pfs0HeaderFile);
+        
+        if (write_res != fullPfs0HeaderSize)
+        {
+            setProgressBarError(&progressCtx);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes PFS0 header file! (wrote %lu bytes)", __func__, fullPfs0HeaderSize, write_res);
+            remove(pfs0HeaderFilename);
+            seqDumpFileRemove = true;
+            goto out;
+        }
+        
+        // Update free space
+        freeSpace -= fullPfs0HeaderSize;
+    } else
+    if (ncaStore)
+    {
+        // Fill the manifest entry table right after the PFS0 header
+        nsp_manifest_header manifestHeader;
+        memset(&manifestHeader, 0, sizeof(nsp_manifest_header));
+        
+        nsp_manifest_entry *manifestEntries = (nsp_manifest_entry*)(dumpBuf + fullPfs0HeaderSize);
+        u64 manifestTableSize = ((u64)nspPfs0Header.file_cnt * sizeof(nsp_manifest_entry));
+        u64 inlineDataOffset = manifestPrefixSize;
+        
+        memset(manifestEntries, 0, manifestTableSize);
+        
+        for(j = 0; j < nspPfs0Header.file_cnt; j++)
+        {
+            manifestEntries[j].size = nspPfs0EntryTable[j].file_size;
+            
+            if (j < (titleContentInfoCnt - 1))
+            {
+                memcpy(manifestEntries[j].hash, xml_content_info[j].hash, SHA256_HASH_SIZE);
+            } else {
+                manifestEntries[j].offset = inlineDataOffset;
+                inlineDataOffset += nspPfs0EntryTable[j].file_size;
+            }
+        }
+        
+        manifestHeader.magic = NSP_MANIFEST_MAGIC;
+        manifestHeader.version = NSP_MANIFEST_VERSION;
+        manifestHeader.entry_cnt = nspPfs0Header.file_cnt;
+        manifestHeader.nsp_size = progressCtx.totalSize;
+        manifestHeader.pfs0_header_size = fullPfs0HeaderSize;
+        manifestHeader.table_offset = (sizeof(nsp_manifest_header) + fullPfs0HeaderSize);
+        manifestHeader.data_offset = manifestPrefixSize;
+        
+        // Replace the placeholder data
+        outFileSeek(&outFile, 0);
+        
+        if (outFileWrite(&outFile, &manifestHeader, sizeof(nsp_manifest_header)) != sizeof(nsp_manifest_header) || outFileWrite(&outFile, dumpBuf, fullPfs0HeaderSize + manifestTableSize) != (fullPfs0HeaderSize + manifestTableSize))
+        {
+            setProgressBarError(&progressCtx);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes manifest header to file offset 0x%016lX!", __func__, manifestPrefixSize, (u64)0);
+            goto out;
+        }
+    } else
+    if (compressOutput)
+    {
+        // Replace the placeholder PFS0 header and finish the compressed output file
+        if (!cmpFileWriteAt(&cmpFile, 0, dumpBuf, fullPfs0HeaderSize) || !cmpFileClose(&cmpFile))
+        {
+            setProgressBarError(&progressCtx);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to finish the compressed output file! (0x%08X)", __func__, cmpFile.out.lastResult);
+            goto out;
+        }
+    } else {
+        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+        {
+            if (outFile.open) outFileClose(&outFile);
+            
+            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp/%02u", NSP_DUMP_PATH, dumpName, 0);
+            
+            if (!outFileOpen(&outFile, dumpPath))
+            {
+                setProgressBarError(&progressCtx);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to re-open output file for part #0!", __func__);
+                goto out;
+            }
+        } else {
+            outFileSeek(&outFile, 0);
+        }
+        
+        write_res = outFileWrite(&outFile, dumpBuf, fullPfs0HeaderSize);
+        if (write_res != fullPfs0HeaderSize)
+        {
+            setProgressBarError(&progressCtx);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes PFS0 header to file offset 0x%016lX! (wrote %lu bytes)", __func__, fullPfs0HeaderSize, (u64)0, write_res);
+            goto out;
+        }
+    }
+    
+    dumping = false;
+    
+    breaks = (progressCtx.line_offset + 2);
+    
+    if (progressCtx.curOffset >= progressCtx.totalSize || (seqDumpMode && seqDumpFinish)) ret = 0;
+    
+    if (ret < 0)
+    {
+        setProgressBarError(&progressCtx);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: underdump error! Wrote %lu bytes, expected %lu bytes.", __func__, progressCtx.curOffset, progressCtx.totalSize);
+        if (seqDumpMode) seqDumpFileRemove = true;
+        goto out;
+    }
+    
+    // Set archive bit (only for FAT32)
+    if (!remoteOutput && !seqDumpMode && !ncaStore && (compressOutput ? cmpFile.split : (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)))
+    {
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s%s", NSP_DUMP_PATH, dumpName, dumpExt);
+        result = fsdevSetConcatenationFileAttribute(dumpPath);
+        if (R_FAILED(result)) 
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Warning: failed to set archive bit on output directory! (0x%08X)", result);
+            breaks += 2;
+        }
+    }
+    
+    // Keep track of this dump in the dumped title index, unless a sequential dump session was just finished
+    if (!seqDumpMode || !seqDumpFinish)
+    {
+        dumped_title_record_t dumpRecord;
+        memset(&dumpRecord, 0, sizeof(dumped_title_record_t));
+        
+        dumpRecord.titleId = xml_program_info.title_id;
+        dumpRecord.version = xml_program_info.version;
+        dumpRecord.type = (u8)selectedNspDumpType;
+        dumpRecord.options = getDumpedTitleOptions(removeConsoleData, tiklessDump, npdmAcidRsaPatch, dumpDeltaFragments);
+        dumpRecord.size = progressCtx.totalSize;
+        sha256CalculateHash(dumpRecord.cnmtHash, cnmtNcaBuf, xml_content_info[cnmtNcaIndex].size);
+        
+        // Parts from sequential dump sessions are moved off the SD card between sessions, and USB / network dumps never reach it
+        if (seqDumpMode || remoteOutput)
+        {
+            dumpRecord.outputType = DUMPED_TITLE_OUTPUT_EXTERNAL;
+        } else {
+            dumpRecord.outputType = DUMPED_TITLE_OUTPUT_FILE;
+            
+            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s%s", dumpName, dumpExt);
+            strncpy(dumpRecord.outputName, strbuf, DUMPED_TITLE_OUTPUT_NAME_LEN);
+            
+            // Names that don't fit can't be checked, so these titles will just be dumped again
+            dumpRecord.outputSize = (strlen(strbuf) <= DUMPED_TITLE_OUTPUT_NAME_LEN ? getDumpedTitleOutputSize(strbuf) : 0);
+        }
+        
+        appendDumpedTitleRecord(&dumpRecord);
+    }
+    
+out:
+    pipelineFree(&(nspPipeCtx.pipeCtx));
+    
+    if (outFile.open) outFileClose(&outFile);
+    
+    cmpFileAbort(&cmpFile);
+    
+    sinkClose(&sinkCtx);
+    
+    // Get rid of a NCA that couldn't be moved into the store
+    if (storeFile.open)
+    {
+        outFileClose(&storeFile);
+        remove(storeTmpPath);
+    }
+    
+    if (ret >= 0)
+    {
+        if (seqDumpMode)
+        {
+            if (seqDumpFinish)
+            {
+                // Update line count
+                breaks = (progressCtx.line_offset + 2);
+                
+                // Update the sequence reference file
+                seqNspCtx.partNumber = (splitIndex + 1);
+                seqNspCtx.fileIndex = startFileIndex;
+                seqNspCtx.fileOffset = fileOffset;
+                
+                // Copy the SHA-256 context data, but only if we're not dealing with the CNMT NCA
+                // NCA ID/hash for the CNMT NCA is handled in patchCnmtNca()
+                if (seqNspCtx.fileIndex < titleContentInfoCnt && seqNspCtx.fileIndex != cnmtNcaIndex)
+                {
+                    memcpy(&(seqNspCtx.hashCtx), &nca_hash_ctx, sizeof(Sha256Context));
+                } else {
+                    memset(&(seqNspCtx.hashCtx), 0, sizeof(Sha256Context));
+                }
+                
+                // Write the struct data
+                write_res = fwrite(&seqNspCtx, 1, sizeof(sequentialNspCtx), seqDumpFile);
+                if (write_res == sizeof(sequentialNspCtx))
+                {
+                    // Write the NCA hashes
+                    write_res = fwrite(seqDumpNcaHashes, 1, seqNspCtx.ncaCount * SHA256_HASH_SIZE, seqDumpFile);
+                    if (write_res != (seqNspCtx.ncaCount * SHA256_HASH_SIZE))
+                    {
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, seqNspCtx.ncaCount * SHA256_HASH_SIZE, write_res);
+                        ret = -1;
+                        seqDumpFileRemove = true;
                     }
+                } else {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, sizeof(sequentialNspCtx), write_res);
+                    ret = -1;
+                    seqDumpFileRemove = true;
+                }
+            } else {
+                // Mark the file for deletion
+                seqDumpFileRemove = true;
+            }
+        }
+        
+        if (ret >= 0 && !batch)
+        {
+            timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+            progressCtx.now -= progressCtx.start;
+            
+            if (!seqDumpMode || (seqDumpMode && !seqDumpFinish))
+            {
+                progressCtx.progress = 100;
+                progressCtx.remainingTime = 0;
+            }
+            
+            printProgressBar(&progressCtx, false, 0);
+            
+            formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
+            
+            if (compressOutput)
+            {
+                char cmpSizeStr[32] = {'\0'};
+                convertSize(cmpFile.outOffset, cmpSizeStr, MAX_CHARACTERS(cmpSizeStr));
+                
+                breaks++;
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Compressed output size: %s (%.2lf%% of the dump size).", cmpSizeStr, ((double)cmpFile.outOffset * 100.0) / (double)progressCtx.totalSize);
+            }
+            
+            uiRefreshDisplay();
+            
+            // Only perform the checksum lookup if we have finished the dump process
+            if (useNoIntroLookup && (!seqDumpMode || (seqDumpMode && !seqDumpFinish)))
+            {
+                if (curStorageId != NcmStorageId_GameCard && !tiklessDump)
+                {
+                    // Calculate CRC32 checksum for the CNMT NCA
+                    crc32(cnmtNcaBuf, xml_content_info[cnmtNcaIndex].size, &crc);
                     
-                    if (ncaProgramMod[programModIdx].block_mod_cnt == 2 && (fileOffset + n) > ncaProgramMod[programModIdx].block_offset[1] && (ncaProgramMod[programModIdx].block_offset[1] + ncaProgramMod[programModIdx].block_size[1]) > fileOffset)
+                    breaks++;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "CNMT NCA CRC32 checksum: %08X.", crc);
+                    uiRefreshDisplay();
+                    breaks++;
+                    
+                    // Perform checksum lookup
+                    noIntroDumpCheck(true, crc);
+                } else {
+                    if (curStorageId != NcmStorageId_GameCard && tiklessDump)
+                    {
+                        breaks++;
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Dump verification disabled (not compatible with NSP dumps with modified NCAs).");
+                    }
+                }
+            }
+            
+            if (seqDumpMode)
+            {
+                breaks += 2;
+                
+                if (seqDumpFinish)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Please remember to exit the application and transfer the generated part file(s) to a PC before continuing in the next session!");
+                    breaks++;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Do NOT move the \"%s\" file!", strrchr(seqDumpFilename, '/' ) + 1);
+                }
+                
+                if (checkIfFileExists(pfs0HeaderFilename))
+                {
+                    if (seqDumpFinish) breaks++;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "The \"%s\" file contains the PFS0 header.\nUse it as the first file when concatenating all parts!", strrchr(pfs0HeaderFilename, '/' ) + 1);
+                }
+            }
+            
+            breaks += 2;
+            
+            uiRefreshDisplay();
+        }
+    } else {
+        if (dumping)
+        {
+            breaks += 6;
+            if (fat32_error) breaks += 2;
+        }
+        
+        breaks += 2;
+        
+        if (journalKeep)
+        {
+            // Keep the output file(s), so the dump can be resumed from the last checkpoint
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "The dump can be resumed from offset 0x%016lX by dumping this title again.", journalHeader.offset);
+            breaks += 2;
+        } else
+        if (removeFile && !remoteOutput)
+        {
+            if (seqDumpMode)
+            {
+                for(u8 i = 0; i <= splitIndex; i++)
+                {
+                    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp.%02u", NSP_DUMP_PATH, dumpName, i);
+                    remove(dumpPath);
+                }
+            } else {
+                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s%s", NSP_DUMP_PATH, dumpName, dumpExt);
+                
+                if (!ncaStore && (compressOutput ? cmpFile.split : (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)))
+                {
+                    fsdevDeleteDirectoryRecursively(dumpPath);
+                } else {
+                    remove(dumpPath);
+                }
+            }
+        }
+    }
+    
+    if (ncaProgramMod)
+    {
+        for(i = 0; i < ncaProgramModCnt; i++)
+        {
+            if (ncaProgramMod[i].hash_table) free(ncaProgramMod[i].hash_table);
+            if (ncaProgramMod[i].block_data[0]) free(ncaProgramMod[i].block_data[0]);
+            if (ncaProgramMod[i].block_data[1]) free(ncaProgramMod[i].block_data[1]);
+        }
+        
+        free(ncaProgramMod);
+    }
+    
+    arenaFree(&dumpArena);
+    perfSetMemoryPeak(dumpArena.peak);
+    
+    ncmContentStorageClose(&ncmStorage);
+    
+    if (curStorageId == NcmStorageId_GameCard) closeGameCardStoragePartition();
+    
+    if (titleContentInfos) free(titleContentInfos);
+    
+    if (seqDumpNcaHashes) free(seqDumpNcaHashes);
+    
+    if (seqDumpFile) fclose(seqDumpFile);
+    
+    if (seqDumpFileRemove) remove(seqDumpFilename);
+    
+    if (journalPayload) free(journalPayload);
+    
+    if (strlen(journalFilename) && (ret == 0 || !journalKeep)) dumpJournalRemove(journalFilename);
+    
+    perfStop("NSP", dumpName, progressCtx.totalSize, (ret == 0));
+    
+    if (dumpName) free(dumpName);
+    
+    if (!batch) changeHomeButtonBlockStatus(false);
+    
+    return ret;
+}
+
+int batchEntryCmp(const void *a, const void *b)
+{
+	batchEntry *batchEntry1 = (batchEntry*)a;
+	batchEntry *batchEntry2 = (batchEntry*)b;
+	
+	return strcasecmp(batchEntry1->nspFilename, batchEntry2->nspFilename);
+}
+
+int dumpNintendoSubmissionPackageBatch(batchOptions *batchDumpCfg)
+{
+    int ret = -1;
+    
+    if (!batchDumpCfg)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid batch dump configuration struct!", __func__);
+        breaks += 2;
+        return ret;
+    }
+    
+    bool dumpAppTitles = batchDumpCfg->dumpAppTitles;
+    bool dumpPatchTitles = batchDumpCfg->dumpPatchTitles;
+    bool dumpAddOnTitles = batchDumpCfg->dumpAddOnTitles;
+    bool isFat32 = batchDumpCfg->isFat32;
+    bool removeConsoleData = batchDumpCfg->removeConsoleData;
+    bool tiklessDump = batchDumpCfg->tiklessDump;
+    bool npdmAcidRsaPatch = batchDumpCfg->npdmAcidRsaPatch;
+    bool dumpDeltaFragments = batchDumpCfg->dumpDeltaFragments;
+    bool skipDumpedTitles = batchDumpCfg->skipDumpedTitles;
+    bool rememberDumpedTitles = batchDumpCfg->rememberDumpedTitles;
+    bool haltOnErrors = batchDumpCfg->haltOnErrors;
+    bool useBrackets = batchDumpCfg->useBrackets;
+    batchModeSourceStorage batchModeSrc = batchDumpCfg->batchModeSrc;
+    bool ncaDedup = batchDumpCfg->ncaDedup;
+    
+    if ((!dumpAppTitles && !dumpPatchTitles && !dumpAddOnTitles) || (batchModeSrc == BATCH_SOURCE_ALL && ((dumpAppTitles && !titleAppCount) || (dumpPatchTitles && !titlePatchCount) || (dumpAddOnTitles && !titleAddOnCount))) || (batchModeSrc == BATCH_SOURCE_SDCARD && ((dumpAppTitles && !sdCardTitleAppCount) || (dumpPatchTitles && !sdCardTitlePatchCount) || (dumpAddOnTitles && !sdCardTitleAddOnCount))) || (batchModeSrc == BATCH_SOURCE_EMMC && ((dumpAppTitles && !emmcTitleAppCount) || (dumpPatchTitles && !emmcTitlePatchCount) || (dumpAddOnTitles && !emmcTitleAddOnCount))) || batchModeSrc >= BATCH_SOURCE_CNT)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to perform batch NSP dump!", __func__);
+        breaks += 2;
+        return ret;
+    }
+    
+    u32 i, j;
+    
+    u32 totalTitleCount = 0, totalAppCount = 0, totalPatchCount = 0, totalAddOnCount = 0;
+    
+    u32 titleCount = 0, titleIndex = 0;
+    
+    char *dumpName = NULL;
+    char summary_str[128] = {'\0'};
+    
+    int initial_breaks = breaks, cur_breaks;
+    
+    const u32 maxSummaryFileCount = 8;
+    u32 summaryPage = 0, selectedSummaryEntry = 0;
+    u32 xpos = 0, ypos = 0;
+    u64 keysDown = 0, keysHeld = 0;
+    
+    u32 maxEntryCount = 0, batchEntryIndex = 0, disabledEntryCount = 0;
+    batchEntry *batchEntries = NULL, *tmpBatchEntries = NULL;
+    
+    u32 nextEntryIndex;
+    nspBatchPrefetchCtx prefetchCtx;
+    
+    dumped_title_index_t dumpedTitles;
+    dir_name_list_t overrideNames, dumpNames;
+    u8 batchDumpOptions = getDumpedTitleOptions(removeConsoleData, tiklessDump, npdmAcidRsaPatch, dumpDeltaFragments);
+    
+    nca_store_t ncaStore;
+    memset(&ncaStore, 0, sizeof(nca_store_t));
+    
+    bool proceed = true;
+    
+    // Generate NSP configuration struct
+    nspOptions nspDumpCfg;
+    
+    nspDumpCfg.isFat32 = isFat32;
+    nspDumpCfg.useNoIntroLookup = false;
+    nspDumpCfg.removeConsoleData = removeConsoleData;
+    nspDumpCfg.tiklessDump = tiklessDump;
+    nspDumpCfg.npdmAcidRsaPatch = npdmAcidRsaPatch;
+    nspDumpCfg.dumpDeltaFragments = dumpDeltaFragments;
+    nspDumpCfg.useBrackets = useBrackets;
+    nspDumpCfg.compressOutput = false;
+    nspDumpCfg.outputTarget = DUMP_OUTPUT_SDCARD;
+    
+    // Allocate memory for the batch entries
+    if (dumpAppTitles) maxEntryCount += (batchModeSrc == BATCH_SOURCE_ALL ? titleAppCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAppCount : emmcTitleAppCount));
+    if (dumpPatchTitles) maxEntryCount += (batchModeSrc == BATCH_SOURCE_ALL ? titlePatchCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitlePatchCount : emmcTitlePatchCount));
+    if (dumpAddOnTitles) maxEntryCount += (batchModeSrc == BATCH_SOURCE_ALL ? titleAddOnCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAddOnCount : emmcTitleAddOnCount));
+    
+    batchEntries = calloc(maxEntryCount, sizeof(batchEntry));
+    if (!batchEntries)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for batch entries!", __func__);
+        breaks += 2;
+        return ret;
+    }
+    
+    // Load the dumped title index and list the directories used by dumps and override files made before it existed
+    // This is a lot faster than probing the SD card for each title
+    loadDumpedTitleIndex(&dumpedTitles);
+    loadDirNameList(BATCH_OVERRIDES_PATH, &overrideNames);
+    
+    // NCAs shared between titles (and previous batch dumps) are only written once to the NCA store
+    if (ncaDedup)
+    {
+        ncaStoreLoad(&ncaStore);
+        nspNcaStore = &ncaStore;
+    }
+    
+    if (skipDumpedTitles)
+    {
+        loadDirNameList(NSP_DUMP_PATH, &dumpNames);
+    } else {
+        memset(&dumpNames, 0, sizeof(dir_name_list_t));
+    }
+    
+    for(i = 0; i < 3; i++)
+    {
+        if ((i == 0 && !dumpAppTitles) || (i == 1 && !dumpPatchTitles) || (i == 2 && !dumpAddOnTitles)) continue;
+        
+        u32 emmcRefTitleCount = 0;
+        nspDumpType curNspDumpType = DUMP_APP_NSP;
+        
+        switch(i)
+        {
+            case 0:
+                titleCount = (batchModeSrc == BATCH_SOURCE_ALL ? titleAppCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAppCount : emmcTitleAppCount));
+                emmcRefTitleCount = sdCardTitleAppCount;
+                curNspDumpType = DUMP_APP_NSP;
+                break;
+            case 1:
+                titleCount = (batchModeSrc == BATCH_SOURCE_ALL ? titlePatchCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitlePatchCount : emmcTitlePatchCount));
+                emmcRefTitleCount = sdCardTitlePatchCount;
+                curNspDumpType = DUMP_PATCH_NSP;
+                break;
+            case 2:
+                titleCount = (batchModeSrc == BATCH_SOURCE_ALL ? titleAddOnCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAddOnCount : emmcTitleAddOnCount));
+                emmcRefTitleCount = sdCardTitleAddOnCount;
+                curNspDumpType = DUMP_ADDON_NSP;
+                break;
+            default:
+                break;
+        }
+        
+        for(j = 0; j < titleCount; j++)
+        {
+            titleIndex = ((batchModeSrc == BATCH_SOURCE_ALL || batchModeSrc == BATCH_SOURCE_SDCARD) ? j : (j + emmcRefTitleCount));
+            
+            u64 curTitleId = (i == 0 ? baseAppEntries[titleIndex].titleId : (i == 1 ? patchEntries[titleIndex].titleId : addOnEntries[titleIndex].titleId));
+            u32 curVersion = (i == 0 ? baseAppEntries[titleIndex].version : (i == 1 ? patchEntries[titleIndex].version : addOnEntries[titleIndex].version));
+            
+            dumpName = generateNSPDumpName(curNspDumpType, titleIndex, false);
+            if (!dumpName)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+                breaks += 2;
+                goto out;
+            }
+            
+            // Check if this title has been remembered by a previous batch dump
+            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s.nsp", dumpName);
+            
+            if (findDumpedTitleRecord(&dumpedTitles, curTitleId, curVersion, DUMPED_TITLE_FLAG_OVERRIDE, 0) || findDirName(&overrideNames, strbuf))
+            {
+                free(dumpName);
+                dumpName = NULL;
+                continue;
+            }
+            
+            snprintf(batchEntries[batchEntryIndex].nspFilename, MAX_CHARACTERS(batchEntries[batchEntryIndex].nspFilename), strbuf);
+            snprintf(batchEntries[batchEntryIndex].truncatedNspFilename, MAX_CHARACTERS(batchEntries[batchEntryIndex].truncatedNspFilename), batchEntries[batchEntryIndex].nspFilename);
+            
+            if (useBrackets)
+            {
+                // Generate output name with brackets
+                free(dumpName);
+                dumpName = NULL;
+                
+                dumpName = generateNSPDumpName(curNspDumpType, titleIndex, true);
+                if (!dumpName)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name with brackets!", __func__);
+                    breaks += 2;
+                    goto out;
+                }
+            }
+            
+            // Check if this title has already been dumped using the same options, even if the dump was renamed or moved somewhere else
+            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s.nsp", dumpName);
+            
+            free(dumpName);
+            dumpName = NULL;
+            
+            if (skipDumpedTitles && (findDumpedTitleRecord(&dumpedTitles, curTitleId, curVersion, 0, batchDumpOptions) || findDirName(&dumpNames, strbuf))) continue;
+            
+            // Save title properties
+            batchEntries[batchEntryIndex].enabled = true;
+            batchEntries[batchEntryIndex].titleType = curNspDumpType;
+            batchEntries[batchEntryIndex].titleIndex = titleIndex;
+            
+            // Only titles that end up in the batch plan need their content size
+            loadTitleContentSize((i == 0 ? NcmContentMetaType_Application : (i == 1 ? NcmContentMetaType_Patch : NcmContentMetaType_AddOnContent)), titleIndex);
+            
+            batchEntries[batchEntryIndex].contentSize = (i == 0 ? baseAppEntries[titleIndex].contentSize : (i == 1 ? patchEntries[titleIndex].contentSize : addOnEntries[titleIndex].contentSize));
+            batchEntries[batchEntryIndex].contentSizeStr = (i == 0 ? baseAppEntries[titleIndex].contentSizeStr : (i == 1 ? patchEntries[titleIndex].contentSizeStr : addOnEntries[titleIndex].contentSizeStr));
+            
+            // Fix entry name length
+            truncateBrowserEntryName(batchEntries[batchEntryIndex].truncatedNspFilename);
+            
+            // Increase batch entry index
+            batchEntryIndex++;
+            
+            // Increase total base application count
+            if (i == 0) totalAppCount++;
+            
+            // Increase total patch count
+            if (i == 1) totalPatchCount++;
+            
+            // Increase total addon count
+            if (i == 2) totalAddOnCount++;
+        }
+    }
+    
+    // Calculate total title count
+    totalTitleCount = (totalAppCount + totalPatchCount + totalAddOnCount);
+    if (!totalTitleCount)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "You have already dumped all titles matching the selected settings!");
+        breaks += 2;
+        goto out;
+    }
+    
+    // Sort batch entries by name
+    qsort(batchEntries, totalTitleCount, sizeof(batchEntry), batchEntryCmp);
+    
+    if (totalTitleCount < maxEntryCount)
+    {
+        tmpBatchEntries = realloc(batchEntries, totalTitleCount * sizeof(batchEntry));
+        if (!tmpBatchEntries)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%s: failed to reallocate batch entries!", __func__);
+            breaks += 2;
+            goto out;
+        }
+        
+        batchEntries = tmpBatchEntries;
+        tmpBatchEntries = NULL;
+    }
+    
+    // Display summary controls
+    if (totalTitleCount > maxSummaryFileCount)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "[ " NINTENDO_FONT_DPAD " / " NINTENDO_FONT_LSTICK " / " NINTENDO_FONT_RSTICK " ] Move | [ " NINTENDO_FONT_ZL " / " NINTENDO_FONT_ZR " ] Change page | [ " NINTENDO_FONT_A " ] Proceed | [ " NINTENDO_FONT_B " ] Cancel | [ " NINTENDO_FONT_Y " ] Toggle selected entry | [ "  NINTENDO_FONT_L " ] Disable all entries | [ " NINTENDO_FONT_R " ] Enable all entries\n[ " NINTENDO_FONT_PLUS " ] Exit");
+    } else {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "[ " NINTENDO_FONT_DPAD " / " NINTENDO_FONT_LSTICK " / " NINTENDO_FONT_RSTICK " ] Move | [ " NINTENDO_FONT_A " ] Proceed | [ " NINTENDO_FONT_B " ] Cancel | [ " NINTENDO_FONT_Y " ] Toggle selected entry | [ "  NINTENDO_FONT_L " ] Disable all entries | [ " NINTENDO_FONT_R " ] Enable all entries | [ " NINTENDO_FONT_PLUS " ] Exit");
+    }
+    
+    breaks += 2;
+    
+    // Display free space
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Free SD card space: %s (%lu bytes).", freeSpaceStr, freeSpace);
+    breaks += 2;
+    
+    // Display summary
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Summary:");
+    breaks += 2;
+    
+    if (totalAppCount)
+    {
+        snprintf(strbuf, MAX_CHARACTERS(strbuf), "BASE: %u", totalAppCount);
+        strcat(summary_str, strbuf);
+    }
+    
+    if (totalPatchCount)
+    {
+        if (totalAppCount) strcat(summary_str, " | ");
+        snprintf(strbuf, MAX_CHARACTERS(strbuf), "UPD: %u", totalPatchCount);
+        strcat(summary_str, strbuf);
+    }
+    
+    if (totalAddOnCount)
+    {
+        if (totalAppCount || totalPatchCount) strcat(summary_str, " | ");
+        snprintf(strbuf, MAX_CHARACTERS(strbuf), "DLC: %u", totalAddOnCount);
+        strcat(summary_str, strbuf);
+    }
+    
+    strcat(summary_str, " | ");
+    snprintf(strbuf, MAX_CHARACTERS(strbuf), "Total: %u", totalTitleCount);
+    strcat(summary_str, strbuf);
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, summary_str);
+    breaks++;
+    
+    while(true)
+    {
+        cur_breaks = breaks;
+        
+        uiFill(0, 8 + (cur_breaks * LINE_HEIGHT), FB_WIDTH, FB_HEIGHT - (8 + (cur_breaks * LINE_HEIGHT)), BG_COLOR_RGB);
+        
+        // Calculate the number of selected titles
+        j = 0;
+        u64 totalOutSize = 0;
+        char totalOutSizeStr[32] = {'\0'};
+        
+        for(i = 0; i < totalTitleCount; i++)
+        {
+            if (batchEntries[i].enabled)
+            {
+                j++;
+                totalOutSize += batchEntries[i].contentSize;
+            }
+        }
+        
+        convertSize(totalOutSize, totalOutSizeStr, MAX_CHARACTERS(totalOutSizeStr));
+        
+        if (totalTitleCount > maxSummaryFileCount)
+        {
+            if (j && totalOutSize)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_RGB, "Current page: %u | Selected titles: %u | Approximate total dump size: %s (%lu bytes)", summaryPage + 1, j, totalOutSizeStr, totalOutSize);
+            } else {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_RGB, "Current page: %u | Selected titles: %u", summaryPage + 1, j);
+            }
+        } else {
+            if (j && totalOutSize)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_RGB, "Selected titles: %u | Approximate total dump size: %s (%lu bytes)", j, totalOutSizeStr, totalOutSize);
+            } else {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_RGB, "Selected titles: %u", j);
+            }
+        }
+        
+        cur_breaks += 2;
+        
+        j = 0;
+        highlight = false;
+        
+        for(i = (summaryPage * maxSummaryFileCount); i < ((summaryPage + 1) * maxSummaryFileCount); i++, j++)
+        {
+            if (i >= totalTitleCount) break;
+            
+            xpos = STRING_X_POS;
+            ypos = (8 + (cur_breaks * LINE_HEIGHT) + (j * (font_height + 12)) + 6);
+            
+            if (i == selectedSummaryEntry)
+            {
+                highlight = true;
+                uiFill(0, ypos - 6, FB_WIDTH, font_height + 12, HIGHLIGHT_BG_COLOR_RGB);
+            }
+            
+            uiDrawIcon((highlight ? (batchEntries[i].enabled ? enabledHighlightIconBuf : disabledHighlightIconBuf) : (batchEntries[i].enabled ? enabledNormalIconBuf : disabledNormalIconBuf)), BROWSER_ICON_DIMENSION, BROWSER_ICON_DIMENSION, xpos, ypos);
+            xpos += (BROWSER_ICON_DIMENSION + 8);
+            
+            if (highlight)
+            {
+                uiDrawString(xpos, ypos, HIGHLIGHT_FONT_COLOR_RGB, batchEntries[i].truncatedNspFilename);
+                
+                if (batchEntries[i].contentSize)
+                {
+                    snprintf(strbuf, MAX_CHARACTERS(strbuf), "(%s)", batchEntries[i].contentSizeStr);
+                    uiDrawString(FB_WIDTH - (8 + uiGetStrWidth(strbuf)), ypos, HIGHLIGHT_FONT_COLOR_RGB, strbuf);
+                }
+            } else {
+                uiDrawString(xpos, ypos, FONT_COLOR_RGB, batchEntries[i].truncatedNspFilename);
+                
+                if (batchEntries[i].contentSize)
+                {
+                    snprintf(strbuf, MAX_CHARACTERS(strbuf), "(%s)", batchEntries[i].contentSizeStr);
+                    uiDrawString(FB_WIDTH - (8 + uiGetStrWidth(strbuf)), ypos, FONT_COLOR_RGB, strbuf);
+                }
+            }
+            
+            if (i == selectedSummaryEntry) highlight = false;
+        }
+        
+        while(true)
+        {
+            uiUpdateStatusMsg();
+            uiRefreshDisplay();
+            
+            scanPads();
+            
+            keysDown = getButtonsDown();
+            keysHeld = getButtonsHeld();
+            
+            if (keysDown || keysHeld) break;
+        }
+        
+        // Exit
+        if (keysDown & HidNpadButton_Plus)
+        {
+            ret = -2;
+            proceed = false;
+            break;
+        }
+        
+        // Start batch dump process
+        if (keysDown & HidNpadButton_A)
+        {
+            // Check if we have at least a single enabled entry
+            for(i = 0; i < totalTitleCount; i++)
+            {
+                if (batchEntries[i].enabled) break;
+            }
+            
+            if (i < totalTitleCount)
+            {
+                proceed = true;
+                break;
+            } else {
+                uiStatusMsg("Please enable at least one entry from the list.");
+            }
+        }
+        
+        // Cancel batch dump process
+        if (keysDown & HidNpadButton_B)
+        {
+            proceed = false;
+            break;
+        }
+        
+        // Toggle selected entry
+        if (keysDown & HidNpadButton_Y) batchEntries[selectedSummaryEntry].enabled ^= 0x01;
+        
+        // Disable all entries
+        if (keysDown & HidNpadButton_L)
+        {
+            for(i = 0; i < totalTitleCount; i++) batchEntries[i].enabled = false;
+        }
+        
+        // Enable all entries
+        if (keysDown & HidNpadButton_R)
+        {
+            for(i = 0; i < totalTitleCount; i++) batchEntries[i].enabled = true;
+        }
+        
+        // Change page (left)
+        if ((keysDown & HidNpadButton_ZL) && totalTitleCount > maxSummaryFileCount)
+        {
+            if (summaryPage > 0)
+            {
+                summaryPage--;
+                selectedSummaryEntry = (summaryPage * maxSummaryFileCount);
+            }
+        }
+        
+        // Change page (right)
+        if ((keysDown & HidNpadButton_ZR) && totalTitleCount > maxSummaryFileCount)
+        {
+            if (((summaryPage + 1) * maxSummaryFileCount) < totalTitleCount)
+            {
+                summaryPage++;
+                selectedSummaryEntry = (summaryPage * maxSummaryFileCount);
+            }
+        }
+        
+        // Go up
+        if ((keysDown & HidNpadButton_Up) || (keysDown & HidNpadButton_StickLUp) || (keysHeld & HidNpadButton_StickRUp))
+        {
+            if (selectedSummaryEntry > (summaryPage * maxSummaryFileCount))
+            {
+                selectedSummaryEntry--;
+            } else {
+                if ((keysDown & HidNpadButton_Up) || (keysDown & HidNpadButton_StickLUp))
+                {
+                    if (((summaryPage + 1) * maxSummaryFileCount) < totalTitleCount)
                     {
-                        internal_block_offset = (fileOffset > ncaProgramMod[programModIdx].block_offset[1] ? (fileOffset - ncaProgramMod[programModIdx].block_offset[1]) : 0);
-                        internal_block_chunk_size = (ncaProgramMod[programModIdx].block_size[1] - internal_block_offset);
-                        
-                        buffer_offset = (fileOffset > ncaProgramMod[programModIdx].block_offset[1] ? 0 : (ncaProgramMod[programModIdx].block_offset[1] - fileOffset));
-                        buffer_chunk_size = ((n - buffer_offset) > internal_block_chunk_size ? internal_block_chunk_size : (n - buffer_offset));
-                        
-                        memcpy(dumpBuf + buffer_offset, ncaProgramMod[programModIdx].block_data[1] + internal_block_offset, buffer_chunk_size);
+                        selectedSummaryEntry = (((summaryPage + 1) * maxSummaryFileCount) - 1);
+                    } else {
+                        selectedSummaryEntry = (totalTitleCount - 1);
                     }
                 }
-                
-                // Update SHA-256 calculation
-                sha256ContextUpdate(&nca_hash_ctx, dumpBuf, n);
-            } else {
-                // Copy data using pointer array
-                u32 ptrIdx = (i - (titleContentInfoCnt - 1));
-                memcpy(dumpBuf, nspPfs0FilePtrs[ptrIdx] + fileOffset, n);
+            }
+        }
+        
+        // Go down
+        if ((keysDown & HidNpadButton_Down) || (keysDown & HidNpadButton_StickLDown) || (keysHeld & HidNpadButton_StickRDown))
+        {
+            if (((((summaryPage + 1) * maxSummaryFileCount) < totalTitleCount) && selectedSummaryEntry < (((summaryPage + 1) * maxSummaryFileCount) - 1)) || ((((summaryPage + 1) * maxSummaryFileCount) >= totalTitleCount) && selectedSummaryEntry < (totalTitleCount - 1)))
+            {
+                selectedSummaryEntry++;
+            } else {
+                if ((keysDown & HidNpadButton_Down) || (keysDown & HidNpadButton_StickLDown))
+                {
+                    selectedSummaryEntry = (summaryPage * maxSummaryFileCount);
+                }
+            }
+        }
+    }
+    
+    uiClearStatusMsg();
+    
+    breaks = initial_breaks;
+    uiFill(0, 8 + (breaks * LINE_HEIGHT), FB_WIDTH, FB_HEIGHT - (8 + (breaks * LINE_HEIGHT)), BG_COLOR_RGB);
+    
+    if (!proceed)
+    {
+        if (ret != -2)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled");
+            breaks += 2;
+        }
+        
+        goto out;
+    }
+    
+    // Calculate the disabled entry count
+    for(i = 0; i < totalTitleCount; i++)
+    {
+        if (!batchEntries[i].enabled) disabledEntryCount++;
+    }
+    
+    // Start dump process
+    dumpStartMsg();
+    uiRefreshDisplay();
+    breaks++;
+    
+    changeHomeButtonBlockStatus(true);
+    
+    initial_breaks = breaks;
+    
+    j = 0;
+    
+    for(i = 0; i < totalTitleCount; i++)
+    {
+        if (!batchEntries[i].enabled) continue;
+        
+        breaks = initial_breaks;
+        
+        uiFill(0, 8 + (breaks * LINE_HEIGHT), FB_WIDTH, FB_HEIGHT - (8 + (breaks * LINE_HEIGHT)), BG_COLOR_RGB);
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Title: %.*s [%u / %u].", strlen(batchEntries[i].nspFilename) - 4, batchEntries[i].nspFilename, j + 1, totalTitleCount - disabledEntryCount);
+        breaks++;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Free SD card space: %s (%lu bytes).", freeSpaceStr, freeSpace);
+        breaks++;
+        
+        uiRefreshDisplay();
+        
+        // Look for the next enabled entry, so its metadata can be prefetched while the current title is being dumped
+        for(nextEntryIndex = (i + 1); nextEntryIndex < totalTitleCount; nextEntryIndex++)
+        {
+            if (batchEntries[nextEntryIndex].enabled) break;
+        }
+        
+        if (nextEntryIndex < totalTitleCount && setupNspBatchPrefetch(&prefetchCtx, batchEntries[nextEntryIndex].titleType, batchEntries[nextEntryIndex].titleIndex, dumpDeltaFragments)) nspBatchPrefetch = &prefetchCtx;
+        
+        // Dump title
+        int nspRet = dumpNintendoSubmissionPackage(batchEntries[i].titleType, batchEntries[i].titleIndex, &nspDumpCfg, true);
+        
+        if (nspBatchPrefetch)
+        {
+            pipelineJoinWorkers(&(nspBatchPrefetch->pipeCtx));
+            nspBatchPrefetch = NULL;
+        }
+        
+        if (nspRet >= 0)
+        {
+            // Remember this title if necessary
+            if (rememberDumpedTitles)
+            {
+                dumped_title_record_t overrideRecord;
+                memset(&overrideRecord, 0, sizeof(dumped_title_record_t));
+                
+                u32 curTitleIndex = batchEntries[i].titleIndex;
+                nspDumpType curTitleType = batchEntries[i].titleType;
+                
+                overrideRecord.titleId = (curTitleType == DUMP_APP_NSP ? baseAppEntries[curTitleIndex].titleId : (curTitleType == DUMP_PATCH_NSP ? patchEntries[curTitleIndex].titleId : addOnEntries[curTitleIndex].titleId));
+                overrideRecord.version = (curTitleType == DUMP_APP_NSP ? baseAppEntries[curTitleIndex].version : (curTitleType == DUMP_PATCH_NSP ? patchEntries[curTitleIndex].version : addOnEntries[curTitleIndex].version));
+                overrideRecord.type = (u8)curTitleType;
+                overrideRecord.flags = DUMPED_TITLE_FLAG_OVERRIDE;
+                
+                appendDumpedTitleRecord(&overrideRecord);
+            }
+        } else {
+            // If "Halt dump process on errors" is disabled, just wait a little bit and keep going (unless the process was truly canceled by the user)
+            if (!haltOnErrors && nspRet != -2)
+            {
+                delay(5);
+            } else {
+                goto out;
+            }
+        }
+        
+        // Update free space
+        updateFreeSpace();
+        
+        j++;
+    }
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed!");
+    breaks++;
+    
+    if (ncaDedup)
+    {
+        char reusedSizeStr[32] = {'\0'};
+        convertSize(ncaStore.reusedSize, reusedSizeStr, MAX_CHARACTERS(reusedSizeStr));
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "NCA data reused from the NCA store: %s.", reusedSizeStr);
+        breaks++;
+    }
+    
+    breaks++;
+    
+    ret = 0;
+    
+out:
+    if (batchEntries) free(batchEntries);
+    
+    nspNcaStore = NULL;
+    ncaStoreFree(&ncaStore);
+    
+    freeDumpedTitleIndex(&dumpedTitles);
+    freeDirNameList(&overrideNames);
+    freeDirNameList(&dumpNames);
+    
+    changeHomeButtonBlockStatus(false);
+    
+    return ret;
+}
+
+bool dumpRawHfs0Partition(u32 partition, bool doSplitting, bool verifyHashes, dumpOutputTarget outputTarget)
+{
+    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].size)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to dump raw HFS0 partition!", __func__);
+        breaks += 2;
+        return false;
+    }
+    
+    Result result;
+    u64 partitionOffset;
+    bool success = false, fat32_error = false;
+    u64 n = DUMP_BUFFER_SIZE;
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
+    FILE *outFile = NULL;
+    u8 splitIndex = 0;
+    openIStoragePartition storageIndex;
+    
+    bool remoteOutput = (outputTarget == DUMP_OUTPUT_USB || outputTarget == DUMP_OUTPUT_TCP);
+    if (remoteOutput) doSplitting = false;
+    
+    sink_ctx_t sinkCtx;
+    memset(&sinkCtx, 0, sizeof(sink_ctx_t));
+    
+    u64 resumeOffset = 0;
+    
+    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    
+    progress_ctx_t progressCtx;
+    memset(&progressCtx, 0, sizeof(progress_ctx_t));
+    
+    verify_ctx_t verifyCtx;
+    memset(&verifyCtx, 0, sizeof(verify_ctx_t));
+    
+    size_t write_res;
+    
+    char *dumpName = generateGameCardDumpName(false);
+    if (!dumpName)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+        breaks += 2;
+        return false;
+    }
+    
+    // The IStorage instance returned for partition == 0 contains the gamecard header, the gamecard certificate, the root HFS0 header and:
+    // * The "update" (0) partition and the "normal" (1) partition (for gamecard type 0x01)
+    // * The "update" (0) partition, the "logo" (1) partition and the "normal" (2) partition (for gamecard type 0x02)
+    // The IStorage instance returned for partition == 1 contains the "secure" partition (which can either be 2 or 3 depending on the gamecard type)
+    // This makes sure we just dump the *actual* raw HFS0 partition, without preceding data, padding, etc.
+    // Oddly enough, IFileSystem instances actually point to the specified partition ID filesystem. I don't understand why it doesn't work like that for IStorage, but whatever
+    // NOTE: Using partition == 2 returns error 0x149002, and using higher values probably do so, too
+    partitionOffset = gameCardInfo.hfs0Partitions[partition].offset; // Relative to IStorage instance
+    progressCtx.totalSize = gameCardInfo.hfs0Partitions[partition].size;
+    storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
+    
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "HFS0 partition size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    breaks += 2;
+    
+    if (!remoteOutput && progressCtx.totalSize > freeSpace)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+        goto out;
+    }
+    
+    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting)
+    {
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0.%02u", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition), splitIndex);
+    } else {
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition));
+    }
+    
+    // Check if the dump already exists
+    if (!remoteOutput && checkIfFileExists(dumpPath))
+    {
+        // Ask the user if they want to proceed anyway
+        int cur_breaks = breaks;
+        
+        if (!yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?"))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            goto out;
+        } else {
+            // Remove the prompt from the screen
+            breaks = cur_breaks;
+            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+        }
+    }
+    
+    result = openGameCardStoragePartition(storageIndex);
+    if (R_FAILED(result))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #%u! (0x%08X)", __func__, storageIndex - 1, result);
+        goto out;
+    }
+    
+    if (verifyHashes && !verifyInitHfs0Partition(&verifyCtx, partition))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to set up the HFS0 / NCA header hash verification!", __func__);
+        goto out;
+    }
+    
+    if (remoteOutput)
+    {
+        if (!sinkOpen(&sinkCtx, outputTarget) || !sinkBeginFile(&sinkCtx, strrchr(dumpPath, '/') + 1, progressCtx.totalSize, false, &resumeOffset)) goto out;
+    } else {
+        outFile = fopen(dumpPath, "wb");
+        if (!outFile)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
+            goto out;
+        }
+    }
+    
+    // Start dump process
+    dumpStartMsg();
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    breaks++;
+    
+    changeHomeButtonBlockStatus(true);
+    
+    progressCtx.line_offset = (breaks + 2);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    
+    progressUiThreadStart(&progressCtx);
+    
+    for (progressCtx.curOffset = 0; progressCtx.curOffset < progressCtx.totalSize; progressCtx.curOffset += n)
+    {
+        printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+        
+        if (n > (progressCtx.totalSize - progressCtx.curOffset)) n = (progressCtx.totalSize - progressCtx.curOffset);
+        
+        result = readGameCardStoragePartition(partitionOffset + progressCtx.curOffset, dumpBuf, n);
+        if (R_FAILED(result))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from IStorage partition #%u! (0x%08X)", __func__, n, partitionOffset + progressCtx.curOffset, storageIndex - 1, result);
+            break;
+        }
+        
+        // The hashed regions are small, so there's no need to move this to a worker thread
+        if (verifyHashes) verifyUpdate(&verifyCtx, progressCtx.curOffset, dumpBuf, n);
+        
+        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting && (progressCtx.curOffset + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
+        {
+            u64 new_file_chunk_size = ((progressCtx.curOffset + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
+            u64 old_file_chunk_size = (n - new_file_chunk_size);
+            
+            if (old_file_chunk_size > 0)
+            {
+                write_res = dumpFileWrite(dumpBuf, old_file_chunk_size, outFile);
+                if (write_res != old_file_chunk_size)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, progressCtx.curOffset, splitIndex, write_res);
+                    break;
+                }
             }
             
-            if ((seqDumpMode || (!seqDumpMode && progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)) && (progressCtx.curOffset + n) >= ((splitIndex + 1) * partSize))
+            fclose(outFile);
+            outFile = NULL;
+            
+            if (new_file_chunk_size > 0 || (progressCtx.curOffset + n) < progressCtx.totalSize)
             {
-                u64 new_file_chunk_size = ((progressCtx.curOffset + n) - ((splitIndex + 1) * partSize));
-                u64 old_file_chunk_size = (n - new_file_chunk_size);
+                splitIndex++;
+                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0.%02u", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition), splitIndex);
                 
-                if (old_file_chunk_size > 0)
+                outFile = fopen(dumpPath, "wb");
+                if (!outFile)
                 {
-                    write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                    if (write_res != old_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, progressCtx.curOffset, splitIndex, write_res);
-                        proceed = false;
-                        break;
-                    }
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
+                    break;
                 }
                 
-                fclose(outFile);
-                outFile = NULL;
-                
-                if (((seqDumpMode && !seqDumpFinish) || !seqDumpMode) && (new_file_chunk_size > 0 || (progressCtx.curOffset + n) < progressCtx.totalSize))
+                if (new_file_chunk_size > 0)
                 {
-                    splitIndex++;
-                    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp%c%02u", NSP_DUMP_PATH, dumpName, (seqDumpMode ? '.' : '/'), splitIndex);
-                    
-                    outFile = fopen(dumpPath, "wb");
-                    if (!outFile)
+                    write_res = dumpFileWrite(dumpBuf + old_file_chunk_size, new_file_chunk_size, outFile);
+                    if (write_res != new_file_chunk_size)
                     {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                        proceed = false;
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, progressCtx.curOffset + old_file_chunk_size, splitIndex, write_res);
                         break;
                     }
-                    
-                    if (new_file_chunk_size > 0)
-                    {
-                        write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                        if (write_res != new_file_chunk_size)
-                        {
-                            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, progressCtx.curOffset + old_file_chunk_size, splitIndex, write_res);
-                            proceed = false;
-                            break;
-                        }
-                    }
                 }
-            } else {
-                write_res = fwrite(dumpBuf, 1, n, outFile);
-                if (write_res != n)
+            }
+        } else {
+            write_res = (remoteOutput ? sinkWrite(&sinkCtx, dumpBuf, n) : dumpFileWrite(dumpBuf, n, outFile));
+            if (write_res != n)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
+                
+                if (!remoteOutput && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
                 {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
-                    
-                    if (!seqDumpMode && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable the \"Split output dump\" option.");
-                        fat32_error = true;
-                    }
-                    
-                    proceed = false;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
+                    fat32_error = true;
+                }
+                
+                break;
+            }
+        }
+        
+        printProgressBar(&progressCtx, true, n);
+        
+        if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            break;
+        }
+    }
+    
+    if (progressCtx.curOffset >= progressCtx.totalSize) success = true;
+    
+    if (remoteOutput && success && !sinkEndFile(&sinkCtx))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: the host receiver didn't acknowledge the output dump!", __func__);
+        success = false;
+    }
+    
+    // Support empty files
+    if (!progressCtx.totalSize)
+    {
+        printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+        
+        progressCtx.progress = 100;
+        
+        printProgressBar(&progressCtx, false, 0);
+    }
+    
+    progressUiThreadStop(&progressCtx);
+    
+    breaks = (progressCtx.line_offset + 2);
+    
+    if (success)
+    {
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
+        
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
+        
+        if (verifyHashes)
+        {
+            breaks++;
+            verifyPrintResult(&verifyCtx);
+        }
+    } else {
+        setProgressBarError(&progressCtx);
+        if (fat32_error) breaks += 2;
+    }
+    
+out:
+    if (outFile) fclose(outFile);
+    
+    sinkClose(&sinkCtx);
+    
+    verifyFree(&verifyCtx);
+    
+    if (!success && !remoteOutput)
+    {
+        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting)
+        {
+            for(u8 i = 0; i <= splitIndex; i++)
+            {
+                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0.%02u", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition), i);
+                remove(dumpPath);
+            }
+        } else {
+            remove(dumpPath);
+        }
+    }
+    
+    closeGameCardStoragePartition();
+    
+    if (dumpName) free(dumpName);
+    
+    breaks += 2;
+    
+    changeHomeButtonBlockStatus(false);
+    
+    return success;
+}
+
+bool copyFileFromHfs0Partition(u32 partition, const char *dest, const char *source, const u64 fileOffset, const u64 fileSize, progress_ctx_t *progressCtx, bool doSplitting, verify_ctx_t *verifyCtx, sink_ctx_t *sink)
+{
+    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].header || !gameCardInfo.hfs0Partitions[partition].header_size || !dest || !strlen(dest) || !source || !strlen(source) || !progressCtx)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to copy file from HFS0 partition!", __func__);
+        return false;
+    }
+    
+    if (!gameCardInfo.hfs0Partitions[partition].file_cnt)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected HFS0 partition is empty!", __func__);
+        return false;
+    }
+    
+    // IStorage handle must have been retrieved beforehand by the caller function
+    
+    Result result;
+    bool success = false, fat32_error = false;
+    char splitFilename[NAME_BUF_LEN * 3] = {'\0'};
+    size_t destLen = strlen(dest);
+    FILE *outFile = NULL;
+    u64 off, n = DUMP_BUFFER_SIZE;
+    u8 splitIndex = 0;
+    u64 resumeOffset = 0;
+    openIStoragePartition storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
+    
+    size_t write_res;
+    
+    if (sink) doSplitting = false;
+    
+    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    
+    printProgressStatus(progressCtx, PROGRESS_STATUS_UPPER, "Copying \"%s\"...", source);
+    printProgressStatus(progressCtx, PROGRESS_STATUS_LOWER, NULL);
+    
+    if ((destLen + 1) >= MAX_CHARACTERS(splitFilename))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: destination path is too long! (%lu bytes)", __func__, destLen);
+        return false;
+    }
+    
+    if (sink)
+    {
+        // The host receiver gets the output path relative to HFS0_DUMP_PATH, so partition data dumps keep their directory layout
+        if (!sinkBeginFile(sink, dest + strlen(HFS0_DUMP_PATH), fileSize, false, &resumeOffset)) goto out;
+    } else {
+        if (fileSize > FAT32_FILESIZE_LIMIT && doSplitting) snprintf(splitFilename, MAX_CHARACTERS(splitFilename), "%s.%02u", dest, splitIndex);
+        
+        outFile = fopen(((fileSize > FAT32_FILESIZE_LIMIT && doSplitting) ? splitFilename : dest), "wb");
+        if (!outFile)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file!", __func__);
+            goto out;
+        }
+    }
+    
+    for (off = 0; off < fileSize; off += n, progressCtx->curOffset += n)
+    {
+        printProgressStatus(progressCtx, PROGRESS_STATUS_LOWER, "Output file: \"%s\".", ((fileSize > FAT32_FILESIZE_LIMIT && doSplitting) ? (strrchr(splitFilename, '/') + 1) : (strrchr(dest, '/') + 1)));
+        
+        if (n > (fileSize - off)) n = (fileSize - off);
+        
+        result = readGameCardStoragePartition(fileOffset + off, dumpBuf, n);
+        if (R_FAILED(result))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from IStorage partition #%u! (0x%08X)", __func__, n, fileOffset + off, storageIndex - 1, result);
+            break;
+        }
+        
+        // Hashed region offsets are relative to the start of the HFS0 partition
+        if (verifyCtx) verifyUpdate(verifyCtx, (fileOffset - gameCardInfo.hfs0Partitions[partition].offset) + off, dumpBuf, n);
+        
+        if (fileSize > FAT32_FILESIZE_LIMIT && doSplitting && (off + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
+        {
+            u64 new_file_chunk_size = ((off + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
+            u64 old_file_chunk_size = (n - new_file_chunk_size);
+            
+            if (old_file_chunk_size > 0)
+            {
+                write_res = dumpFileWrite(dumpBuf, old_file_chunk_size, outFile);
+                if (write_res != old_file_chunk_size)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, off, splitIndex, write_res);
                     break;
                 }
             }
             
-            if (seqDumpMode) progressCtx.seqDumpCurOffset = seqDumpSessionOffset;
-            printProgressBar(&progressCtx, true, n);
+            fclose(outFile);
+            outFile = NULL;
             
-            if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
+            if (new_file_chunk_size > 0 || (off + n) < fileSize)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
-                ret = -2;
-                proceed = false;
+                splitIndex++;
+                snprintf(splitFilename, MAX_CHARACTERS(splitFilename), "%s.%02u", dest, splitIndex);
+                
+                outFile = fopen(splitFilename, "wb");
+                if (!outFile)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
+                    break;
+                }
+                
+                if (new_file_chunk_size > 0)
+                {
+                    write_res = dumpFileWrite(dumpBuf + old_file_chunk_size, new_file_chunk_size, outFile);
+                    if (write_res != new_file_chunk_size)
+                    {
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, off + old_file_chunk_size, splitIndex, write_res);
+                        break;
+                    }
+                }
+            }
+        } else {
+            write_res = (sink ? sinkWrite(sink, dumpBuf, n) : dumpFileWrite(dumpBuf, n, outFile));
+            if (write_res != n)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, off, write_res);
+                
+                if (!sink && (off + n) > FAT32_FILESIZE_LIMIT)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
+                    fat32_error = true;
+                }
+                
                 break;
             }
         }
         
-        if (!proceed || ret >= 0) break;
+        printProgressBar(progressCtx, true, n);
         
-        // Support empty files
-        if (!nspPfs0EntryTable[i].file_size)
+        if (((off + n) < fileSize || (progressCtx->curOffset + n) < progressCtx->totalSize) && cancelProcessCheck(progressCtx))
         {
-            uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
-            
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
-            
-            if (i < titleContentInfoCnt)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Dumping NCA \"%s\" (%s)...", xml_content_info[i].nca_id_str, getContentType(xml_content_info[i].type));
-            } else {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Writing \"%s\"...", entryFilename);
-            }
-            
-            printProgressBar(&progressCtx, false, 0);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            break;
         }
+    }
+    
+    if (off >= fileSize) success = true;
+    
+    if (sink && success && !sinkEndFile(sink))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: the host receiver didn't acknowledge the output file!", __func__);
+        success = false;
+    }
+    
+    // Support empty files
+    if (!fileSize)
+    {
+        printProgressStatus(progressCtx, PROGRESS_STATUS_LOWER, "Output file: \"%s\".", strrchr(dest, '/') + 1);
         
-        // Check if we're not dealing with the CNMT NCA
-        if (i < (titleContentInfoCnt - 1))
-        {
-            // Update content info
-            sha256ContextGetHash(&nca_hash_ctx, xml_content_info[i].hash);
-            convertDataToHexString(xml_content_info[i].hash, SHA256_HASH_SIZE, xml_content_info[i].hash_str, (SHA256_HASH_SIZE * 2) + 1);
-            memcpy(xml_content_info[i].nca_id, xml_content_info[i].hash, SHA256_HASH_SIZE / 2);
-            convertDataToHexString(xml_content_info[i].nca_id, SHA256_HASH_SIZE / 2, xml_content_info[i].nca_id_str, SHA256_HASH_SIZE + 1);
-            
-            // If we're doing a sequential dump and we just finished dumping a NCA, copy its calculated hash
-            if (seqDumpMode) memcpy(seqDumpNcaHashes + (i * SHA256_HASH_SIZE), xml_content_info[i].hash, SHA256_HASH_SIZE);
-        }
+        if (progressCtx->totalSize == fileSize) progressCtx->progress = 100;
+        
+        printProgressBar(progressCtx, false, 0);
     }
     
-    if (!proceed || ret >= 0)
+    if (!success)
     {
-        if (!proceed)
+        setProgressBarError(progressCtx);
+        breaks = (progressCtx->line_offset + 2);
+        if (fat32_error) breaks += 2;
+    }
+    
+out:
+    if (outFile) fclose(outFile);
+    
+    if (!success && !sink)
+    {
+        if (fileSize > FAT32_FILESIZE_LIMIT && doSplitting)
         {
-            setProgressBarError(&progressCtx);
-            if (seqDumpMode) seqDumpFileRemove = true;
+            for(u8 i = 0; i <= splitIndex; i++)
+            {
+                snprintf(splitFilename, MAX_CHARACTERS(splitFilename), "%s.%02u", dest, i);
+                remove(splitFilename);
+            }
+        } else {
+            remove(dest);
         }
-        
-        goto out;
     }
     
-    uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
+    breaks += 2;
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+    return success;
+}
+
+bool copyHfs0PartitionContents(u32 partition, progress_ctx_t *progressCtx, const char *dest, bool splitting, verify_ctx_t *verifyCtx, sink_ctx_t *sink)
+{
+    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].header || !gameCardInfo.hfs0Partitions[partition].header_size || !progressCtx || !dest || !strlen(dest))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to copy HFS0 partition contents!", __func__);
+        breaks += 2;
+        return false;
+    }
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Writing PFS0 header...");
+    if (!gameCardInfo.hfs0Partitions[partition].file_cnt)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected HFS0 partition is empty!", __func__);
+        breaks += 2;
+        return false;
+    }
     
-    uiRefreshDisplay();
+    Result result;
+    char dbuf[NAME_BUF_LEN * 2] = {'\0'};
+    hfs0_file_entry entry;
+    size_t dest_len = strlen(dest);
+    openIStoragePartition storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
     
-    // Write our full PFS0 header
-    memcpy(dumpBuf, &nspPfs0Header, sizeof(pfs0_header));
-    memcpy(dumpBuf + sizeof(pfs0_header), nspPfs0EntryTable, (u64)nspPfs0Header.file_cnt * sizeof(pfs0_file_entry));
-    memcpy(dumpBuf + sizeof(pfs0_header) + ((u64)nspPfs0Header.file_cnt * sizeof(pfs0_file_entry)), nspPfs0StrTable, nspPfs0Header.str_table_size);
+    u32 i;
+    bool success = false;
     
-    if (seqDumpMode)
+    if ((dest_len + 1) >= MAX_CHARACTERS(dbuf))
     {
-        // Just in case
-        remove(pfs0HeaderFilename);
-        
-        // Check if we have enough space for the header file
-        u64 curFreeSpace = (freeSpace - seqDumpSessionOffset);
-        if (!seqNspCtx.partNumber) curFreeSpace += fullPfs0HeaderSize; // The PFS0 header size is skipped during the first sequential dump session
-        
-        if (curFreeSpace < fullPfs0HeaderSize)
-        {
-            // Finish current sequential dump session
-            seqDumpFinish = true;
-            ret = 0;
-            goto out;
-        }
-        
-        pfs0HeaderFile = fopen(pfs0HeaderFilename, "wb");
-        if (!pfs0HeaderFile)
-        {
-            setProgressBarError(&progressCtx);
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to create PFS0 header file!", __func__);
-            seqDumpFileRemove = true;
-            goto out;
-        }
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: destination directory name is too long! (%lu bytes)", __func__, dest_len);
+        breaks += 2;
+        return false;
+    }
+    
+    snprintf(dbuf, MAX_CHARACTERS(dbuf), dest);
+    if (!sink) mkdir(dbuf, 0744);
+    
+    dbuf[dest_len] = '/';
+    dest_len++;
+    
+    result = openGameCardStoragePartition(storageIndex);
+    if (R_FAILED(result))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #%u! (0x%08X)", __func__, storageIndex - 1, result);
+        breaks += 2;
+        return false;
+    }
+    
+    // The partition header isn't part of the extracted data, but we already have it in memory
+    if (verifyCtx) verifyUpdate(verifyCtx, 0, gameCardInfo.hfs0Partitions[partition].header, gameCardInfo.hfs0Partitions[partition].header_size);
+    
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx->start));
+    
+    progressUiThreadStart(progressCtx);
+    
+    for(i = 0; i < gameCardInfo.hfs0Partitions[partition].file_cnt; i++)
+    {
+        memcpy(&entry, gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (i * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
         
-        write_res = fwrite(dumpBuf, 1, fullPfs0HeaderSize, pfs0HeaderFile);
-        fclose(pfs0HeaderFile);
+        char *filename = (char*)(gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (gameCardInfo.hfs0Partitions[partition].file_cnt * sizeof(hfs0_file_entry)) + entry.filename_offset);
         
-        if (write_res != fullPfs0HeaderSize)
-        {
-            setProgressBarError(&progressCtx);
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes PFS0 header file! (wrote %lu bytes)", __func__, fullPfs0HeaderSize, write_res);
-            remove(pfs0HeaderFilename);
-            seqDumpFileRemove = true;
-            goto out;
-        }
+        dbuf[dest_len] = '\0';
+        strcat(dbuf, filename);
+        removeIllegalCharacters(dbuf + dest_len);
         
-        // Update free space
-        freeSpace -= fullPfs0HeaderSize;
-    } else {
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
-        {
-            if (outFile)
-            {
-                fclose(outFile);
-                outFile = NULL;
-            }
-            
-            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp/%02u", NSP_DUMP_PATH, dumpName, 0);
-            
-            outFile = fopen(dumpPath, "rb+");
-            if (!outFile)
-            {
-                setProgressBarError(&progressCtx);
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to re-open output file for part #0!", __func__);
-                goto out;
-            }
-        } else {
-            rewind(outFile);
-        }
+        u64 fileOffset = (gameCardInfo.hfs0Partitions[partition].offset + gameCardInfo.hfs0Partitions[partition].header_size + entry.file_offset);
         
-        write_res = fwrite(dumpBuf, 1, fullPfs0HeaderSize, outFile);
-        if (write_res != fullPfs0HeaderSize)
-        {
-            setProgressBarError(&progressCtx);
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes PFS0 header to file offset 0x%016lX! (wrote %lu bytes)", __func__, fullPfs0HeaderSize, (u64)0, write_res);
-            goto out;
-        }
+        success = copyFileFromHfs0Partition(partition, dbuf, filename, fileOffset, entry.file_size, progressCtx, splitting, verifyCtx, sink);
+        if (!success) break;
     }
     
-    dumping = false;
+    progressUiThreadStop(progressCtx);
     
-    breaks = (progressCtx.line_offset + 2);
+    closeGameCardStoragePartition();
     
-    if (progressCtx.curOffset >= progressCtx.totalSize || (seqDumpMode && seqDumpFinish)) ret = 0;
+    return success;
+}
+
+bool dumpHfs0PartitionData(u32 partition, bool doSplitting, bool verifyHashes, dumpOutputTarget outputTarget)
+{
+    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].header)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to dump HFS0 partition data!", __func__);
+        breaks += 2;
+        return false;
+    }
     
-    if (ret < 0)
+    if (!gameCardInfo.hfs0Partitions[partition].file_cnt)
     {
-        setProgressBarError(&progressCtx);
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: underdump error! Wrote %lu bytes, expected %lu bytes.", __func__, progressCtx.curOffset, progressCtx.totalSize);
-        if (seqDumpMode) seqDumpFileRemove = true;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected HFS0 partition is empty!", __func__);
+        breaks += 2;
+        return false;
+    }
+    
+    u32 i;
+    hfs0_file_entry entry;
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
+    
+    progress_ctx_t progressCtx;
+    memset(&progressCtx, 0, sizeof(progress_ctx_t));
+    
+    verify_ctx_t verifyCtx;
+    memset(&verifyCtx, 0, sizeof(verify_ctx_t));
+    
+    // Every file from the partition is sent to the host receiver as a separate output file
+    bool remoteOutput = (outputTarget == DUMP_OUTPUT_USB || outputTarget == DUMP_OUTPUT_TCP);
+    
+    sink_ctx_t sinkCtx;
+    memset(&sinkCtx, 0, sizeof(sink_ctx_t));
+    
+    bool success = false;
+    
+    char *dumpName = generateGameCardDumpName(false);
+    if (!dumpName)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+        breaks += 2;
+        return false;
+    }
+    
+    // Calculate total size
+    for(i = 0; i < gameCardInfo.hfs0Partitions[partition].file_cnt; i++)
+    {
+        memcpy(&entry, gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (i * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
+        progressCtx.totalSize += entry.file_size;
+    }
+    
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Total partition data size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    breaks += 2;
+    
+    if (!remoteOutput && progressCtx.totalSize > freeSpace)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
         goto out;
     }
     
-    // Set archive bit (only for FAT32)
-    if (!seqDumpMode && progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s)", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition));
+    
+    if (verifyHashes && !verifyInitHfs0Partition(&verifyCtx, partition))
     {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
-        result = fsdevSetConcatenationFileAttribute(dumpPath);
-        if (R_FAILED(result)) 
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Warning: failed to set archive bit on output directory! (0x%08X)", result);
-            breaks += 2;
-        }
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to set up the HFS0 / NCA header hash verification!", __func__);
+        goto out;
     }
     
-out:
-    if (outFile) fclose(outFile);
+    if (remoteOutput && !sinkOpen(&sinkCtx, outputTarget)) goto out;
+    
+    // Start dump process
+    dumpStartMsg();
+    perfStart();
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    breaks++;
+    
+    changeHomeButtonBlockStatus(true);
     
-    if (ret >= 0)
+    progressCtx.line_offset = (breaks + 4);
+    
+    success = copyHfs0PartitionContents(partition, &progressCtx, dumpPath, doSplitting, (verifyHashes ? &verifyCtx : NULL), (remoteOutput ? &sinkCtx : NULL));
+    
+    if (success)
     {
-        if (seqDumpMode)
-        {
-            if (seqDumpFinish)
-            {
-                // Update line count
-                breaks = (progressCtx.line_offset + 2);
-                
-                // Update the sequence reference file
-                seqNspCtx.partNumber = (splitIndex + 1);
-                seqNspCtx.fileIndex = startFileIndex;
-                seqNspCtx.fileOffset = fileOffset;
-                
-                // Copy the SHA-256 context data, but only if we're not dealing with the CNMT NCA
-                // NCA ID/hash for the CNMT NCA is handled in patchCnmtNca()
-                if (seqNspCtx.fileIndex < titleContentInfoCnt && seqNspCtx.fileIndex != cnmtNcaIndex)
-                {
-                    memcpy(&(seqNspCtx.hashCtx), &nca_hash_ctx, sizeof(Sha256Context));
-                } else {
-                    memset(&(seqNspCtx.hashCtx), 0, sizeof(Sha256Context));
-                }
-                
-                // Write the struct data
-                write_res = fwrite(&seqNspCtx, 1, sizeof(sequentialNspCtx), seqDumpFile);
-                if (write_res == sizeof(sequentialNspCtx))
-                {
-                    // Write the NCA hashes
-                    write_res = fwrite(seqDumpNcaHashes, 1, seqNspCtx.ncaCount * SHA256_HASH_SIZE, seqDumpFile);
-                    if (write_res != (seqNspCtx.ncaCount * SHA256_HASH_SIZE))
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, seqNspCtx.ncaCount * SHA256_HASH_SIZE, write_res);
-                        ret = -1;
-                        seqDumpFileRemove = true;
-                    }
-                } else {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the sequential dump reference file! (wrote %lu bytes)", __func__, sizeof(sequentialNspCtx), write_res);
-                    ret = -1;
-                    seqDumpFileRemove = true;
-                }
-            } else {
-                // Mark the file for deletion
-                seqDumpFileRemove = true;
-            }
-        }
+        breaks = (progressCtx.line_offset + 2);
         
-        if (ret >= 0 && !batch)
-        {
-            timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
-            progressCtx.now -= progressCtx.start;
-            
-            if (!seqDumpMode || (seqDumpMode && !seqDumpFinish))
-            {
-                progressCtx.progress = 100;
-                progressCtx.remainingTime = 0;
-            }
-            
-            printProgressBar(&progressCtx, false, 0);
-            
-            formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
-            uiRefreshDisplay();
-            
-            // Only perform the checksum lookup if we have finished the dump process
-            if (useNoIntroLookup && (!seqDumpMode || (seqDumpMode && !seqDumpFinish)))
-            {
-                if (curStorageId != NcmStorageId_GameCard && !tiklessDump)
-                {
-                    // Calculate CRC32 checksum for the CNMT NCA
-                    crc32(cnmtNcaBuf, xml_content_info[cnmtNcaIndex].size, &crc);
-                    
-                    breaks++;
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "CNMT NCA CRC32 checksum: %08X.", crc);
-                    uiRefreshDisplay();
-                    breaks++;
-                    
-                    // Perform checksum lookup
-                    noIntroDumpCheck(true, crc);
-                } else {
-                    if (curStorageId != NcmStorageId_GameCard && tiklessDump)
-                    {
-                        breaks++;
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Dump verification disabled (not compatible with NSP dumps with modified NCAs).");
-                    }
-                }
-            }
-            
-            if (seqDumpMode)
-            {
-                breaks += 2;
-                
-                if (seqDumpFinish)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Please remember to exit the application and transfer the generated part file(s) to a PC before continuing in the next session!");
-                    breaks++;
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Do NOT move the \"%s\" file!", strrchr(seqDumpFilename, '/' ) + 1);
-                }
-                
-                if (checkIfFileExists(pfs0HeaderFilename))
-                {
-                    if (seqDumpFinish) breaks++;
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "The \"%s\" file contains the PFS0 header.\nUse it as the first file when concatenating all parts!", strrchr(pfs0HeaderFilename, '/' ) + 1);
-                }
-            }
-            
-            breaks += 2;
-            
-            uiRefreshDisplay();
-        }
-    } else {
-        if (dumping)
-        {
-            breaks += 6;
-            if (fat32_error) breaks += 2;
-        }
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
         
-        breaks += 2;
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
         
-        if (removeFile)
+        if (verifyHashes)
         {
-            if (seqDumpMode)
-            {
-                for(u8 i = 0; i <= splitIndex; i++)
-                {
-                    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp.%02u", NSP_DUMP_PATH, dumpName, i);
-                    remove(dumpPath);
-                }
-            } else {
-                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
-                
-                if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
-                {
-                    fsdevDeleteDirectoryRecursively(dumpPath);
-                } else {
-                    remove(dumpPath);
-                }
-            }
+            breaks++;
+            verifyPrintResult(&verifyCtx);
         }
+    } else
+    if (!remoteOutput)
+    {
+        removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
     }
     
-    if (nspPfs0FilePtrs) free(nspPfs0FilePtrs);
+out:
+    perfStop("HFS0 partition data", dumpName, progressCtx.totalSize, success);
     
-    if (nspPfs0StrTable) free(nspPfs0StrTable);
+    sinkClose(&sinkCtx);
     
-    if (nspPfs0EntryTable) free(nspPfs0EntryTable);
+    verifyFree(&verifyCtx);
     
-    if (cnmtXml) free(cnmtXml);
+    free(dumpName);
     
-    if (cnmtNcaBuf) free(cnmtNcaBuf);
+    breaks += 2;
     
-    if (ncaProgramMod)
+    changeHomeButtonBlockStatus(false);
+    
+    return success;
+}
+
+bool dumpFileFromHfs0Partition(u32 partition, u32 fileIndex, char *filename, bool doSplitting, bool verifyHashes, dumpOutputTarget outputTarget)
+{
+    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].header || !gameCardInfo.hfs0Partitions[partition].header_size || !filename || !strlen(filename))
     {
-        for(i = 0; i < ncaProgramModCnt; i++)
-        {
-            if (ncaProgramMod[i].hash_table) free(ncaProgramMod[i].hash_table);
-            if (ncaProgramMod[i].block_data[0]) free(ncaProgramMod[i].block_data[0]);
-            if (ncaProgramMod[i].block_data[1]) free(ncaProgramMod[i].block_data[1]);
-        }
-        
-        free(ncaProgramMod);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to dump file from HFS0 partition!", __func__);
+        breaks += 2;
+        return false;
     }
     
-    if (xml_records)
+    if (!gameCardInfo.hfs0Partitions[partition].file_cnt)
     {
-        for(i = 0; i < xml_rec_cnt; i++)
-        {
-            if (xml_records[i].xml_data) free(xml_records[i].xml_data);
-            if (xml_records[i].nacp_icons) free(xml_records[i].nacp_icons);
-        }
-        
-        free(xml_records);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected HFS0 partition is empty!", __func__);
+        breaks += 2;
+        return false;
     }
     
-    if (xml_content_info) free(xml_content_info);
-    
-    ncmContentStorageClose(&ncmStorage);
+    if (fileIndex >= gameCardInfo.hfs0Partitions[partition].file_cnt)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid file index!", __func__);
+        breaks += 2;
+        return false;
+    }
     
-    if (curStorageId == NcmStorageId_GameCard) closeGameCardStoragePartition();
+    Result result;
+    hfs0_file_entry entry;
     
-    if (titleContentInfos) free(titleContentInfos);
+    progress_ctx_t progressCtx;
+    memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
-    if (seqDumpNcaHashes) free(seqDumpNcaHashes);
+    verify_ctx_t verifyCtx;
+    memset(&verifyCtx, 0, sizeof(verify_ctx_t));
     
-    if (seqDumpFile) fclose(seqDumpFile);
+    u64 fileOffset = 0;
+    openIStoragePartition storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
     
-    if (seqDumpFileRemove) remove(seqDumpFilename);
+    char destCopyPath[NAME_BUF_LEN * 2] = {'\0'};
     
-    if (dumpName) free(dumpName);
+    bool remoteOutput = (outputTarget == DUMP_OUTPUT_USB || outputTarget == DUMP_OUTPUT_TCP);
     
-    if (!batch) changeHomeButtonBlockStatus(false);
+    sink_ctx_t sinkCtx;
+    memset(&sinkCtx, 0, sizeof(sink_ctx_t));
     
-    return ret;
-}
-
-int batchEntryCmp(const void *a, const void *b)
-{
-	batchEntry *batchEntry1 = (batchEntry*)a;
-	batchEntry *batchEntry2 = (batchEntry*)b;
-	
-	return strcasecmp(batchEntry1->nspFilename, batchEntry2->nspFilename);
-}
-
-int dumpNintendoSubmissionPackageBatch(batchOptions *batchDumpCfg)
-{
-    int ret = -1;
+    bool success = false;
     
-    if (!batchDumpCfg)
+    char *dumpName = generateGameCardDumpName(false);
+    if (!dumpName)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid batch dump configuration struct!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
         breaks += 2;
-        return ret;
+        return false;
     }
     
-    bool dumpAppTitles = batchDumpCfg->dumpAppTitles;
-    bool dumpPatchTitles = batchDumpCfg->dumpPatchTitles;
-    bool dumpAddOnTitles = batchDumpCfg->dumpAddOnTitles;
-    bool isFat32 = batchDumpCfg->isFat32;
-    bool removeConsoleData = batchDumpCfg->removeConsoleData;
-    bool tiklessDump = batchDumpCfg->tiklessDump;
-    bool npdmAcidRsaPatch = batchDumpCfg->npdmAcidRsaPatch;
-    bool dumpDeltaFragments = batchDumpCfg->dumpDeltaFragments;
-    bool skipDumpedTitles = batchDumpCfg->skipDumpedTitles;
-    bool rememberDumpedTitles = batchDumpCfg->rememberDumpedTitles;
-    bool haltOnErrors = batchDumpCfg->haltOnErrors;
-    bool useBrackets = batchDumpCfg->useBrackets;
-    batchModeSourceStorage batchModeSrc = batchDumpCfg->batchModeSrc;
+    memcpy(&entry, gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (fileIndex * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
+    
+    fileOffset = (gameCardInfo.hfs0Partitions[partition].offset + gameCardInfo.hfs0Partitions[partition].header_size + entry.file_offset);
+    
+    progressCtx.totalSize = entry.file_size;
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "File size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    breaks += 2;
+    
+    if (!remoteOutput && progressCtx.totalSize > freeSpace)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+        goto out;
+    }
+    
+    snprintf(destCopyPath, MAX_CHARACTERS(destCopyPath), "%s%s - Partition %u (%s)", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition));
+    if (!remoteOutput) mkdir(destCopyPath, 0744);
+    
+    strcat(destCopyPath, "/");
+    size_t cur_len = strlen(destCopyPath);
+    strcat(destCopyPath, filename);
+    removeIllegalCharacters(destCopyPath + cur_len);
     
-    if ((!dumpAppTitles && !dumpPatchTitles && !dumpAddOnTitles) || (batchModeSrc == BATCH_SOURCE_ALL && ((dumpAppTitles && !titleAppCount) || (dumpPatchTitles && !titlePatchCount) || (dumpAddOnTitles && !titleAddOnCount))) || (batchModeSrc == BATCH_SOURCE_SDCARD && ((dumpAppTitles && !sdCardTitleAppCount) || (dumpPatchTitles && !sdCardTitlePatchCount) || (dumpAddOnTitles && !sdCardTitleAddOnCount))) || (batchModeSrc == BATCH_SOURCE_EMMC && ((dumpAppTitles && !emmcTitleAppCount) || (dumpPatchTitles && !emmcTitlePatchCount) || (dumpAddOnTitles && !emmcTitleAddOnCount))) || batchModeSrc >= BATCH_SOURCE_CNT)
+    // Check if the dump already exists
+    if (!remoteOutput && checkIfFileExists(destCopyPath))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to perform batch NSP dump!", __func__);
-        breaks += 2;
-        return ret;
+        // Ask the user if they want to proceed anyway
+        int cur_breaks = breaks;
+        
+        if (!yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?"))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            goto out;
+        } else {
+            // Remove the prompt from the screen
+            breaks = cur_breaks;
+            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+        }
     }
     
-    u32 i, j;
-    
-    u32 totalTitleCount = 0, totalAppCount = 0, totalPatchCount = 0, totalAddOnCount = 0;
-    
-    u32 titleCount = 0, titleIndex = 0;
+    if (verifyHashes && !verifyInitHfs0File(&verifyCtx, partition, fileIndex))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to set up the HFS0 / NCA header hash verification!", __func__);
+        goto out;
+    }
     
-    char *dumpName = NULL;
-    char summary_str[128] = {'\0'};
+    result = openGameCardStoragePartition(storageIndex);
+    if (R_FAILED(result))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #%u! (0x%08X)", __func__, storageIndex - 1, result);
+        goto out;
+    }
     
-    int initial_breaks = breaks, cur_breaks;
+    if (remoteOutput && !sinkOpen(&sinkCtx, outputTarget))
+    {
+        closeGameCardStoragePartition();
+        goto out;
+    }
     
-    const u32 maxSummaryFileCount = 8;
-    u32 summaryPage = 0, selectedSummaryEntry = 0;
-    u32 xpos = 0, ypos = 0;
-    u64 keysDown = 0, keysHeld = 0;
+    // Start dump process
+    dumpStartMsg();
+    perfStart();
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    breaks++;
     
-    u32 maxEntryCount = 0, batchEntryIndex = 0, disabledEntryCount = 0;
-    batchEntry *batchEntries = NULL, *tmpBatchEntries = NULL;
+    changeHomeButtonBlockStatus(true);
     
-    bool proceed = true;
+    progressCtx.line_offset = (breaks + 4);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
     
-    // Generate NSP configuration struct
-    nspOptions nspDumpCfg;
+    progressUiThreadStart(&progressCtx);
     
-    nspDumpCfg.isFat32 = isFat32;
-    nspDumpCfg.useNoIntroLookup = false;
-    nspDumpCfg.removeConsoleData = removeConsoleData;
-    nspDumpCfg.tiklessDump = tiklessDump;
-    nspDumpCfg.npdmAcidRsaPatch = npdmAcidRsaPatch;
-    nspDumpCfg.dumpDeltaFragments = dumpDeltaFragments;
-    nspDumpCfg.useBrackets = useBrackets;
+    success = copyFileFromHfs0Partition(partition, destCopyPath, filename, fileOffset, progressCtx.totalSize, &progressCtx, doSplitting, (verifyHashes ? &verifyCtx : NULL), (remoteOutput ? &sinkCtx : NULL));
     
-    // Allocate memory for the batch entries
-    if (dumpAppTitles) maxEntryCount += (batchModeSrc == BATCH_SOURCE_ALL ? titleAppCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAppCount : emmcTitleAppCount));
-    if (dumpPatchTitles) maxEntryCount += (batchModeSrc == BATCH_SOURCE_ALL ? titlePatchCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitlePatchCount : emmcTitlePatchCount));
-    if (dumpAddOnTitles) maxEntryCount += (batchModeSrc == BATCH_SOURCE_ALL ? titleAddOnCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAddOnCount : emmcTitleAddOnCount));
+    progressUiThreadStop(&progressCtx);
     
-    batchEntries = calloc(maxEntryCount, sizeof(batchEntry));
-    if (!batchEntries)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for batch entries!", __func__);
-        breaks += 2;
-        return ret;
-    }
+    closeGameCardStoragePartition();
     
-    for(i = 0; i < 3; i++)
+    if (success)
     {
-        if ((i == 0 && !dumpAppTitles) || (i == 1 && !dumpPatchTitles) || (i == 2 && !dumpAddOnTitles)) continue;
+        breaks = (progressCtx.line_offset + 2);
         
-        u32 emmcRefTitleCount = 0;
-        nspDumpType curNspDumpType = DUMP_APP_NSP;
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
         
-        switch(i)
-        {
-            case 0:
-                titleCount = (batchModeSrc == BATCH_SOURCE_ALL ? titleAppCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAppCount : emmcTitleAppCount));
-                emmcRefTitleCount = sdCardTitleAppCount;
-                curNspDumpType = DUMP_APP_NSP;
-                break;
-            case 1:
-                titleCount = (batchModeSrc == BATCH_SOURCE_ALL ? titlePatchCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitlePatchCount : emmcTitlePatchCount));
-                emmcRefTitleCount = sdCardTitlePatchCount;
-                curNspDumpType = DUMP_PATCH_NSP;
-                break;
-            case 2:
-                titleCount = (batchModeSrc == BATCH_SOURCE_ALL ? titleAddOnCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAddOnCount : emmcTitleAddOnCount));
-                emmcRefTitleCount = sdCardTitleAddOnCount;
-                curNspDumpType = DUMP_ADDON_NSP;
-                break;
-            default:
-                break;
-        }
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
         
-        for(j = 0; j < titleCount; j++)
+        if (verifyHashes)
         {
-            titleIndex = ((batchModeSrc == BATCH_SOURCE_ALL || batchModeSrc == BATCH_SOURCE_SDCARD) ? j : (j + emmcRefTitleCount));
-            
-            dumpName = generateNSPDumpName(curNspDumpType, titleIndex, false);
-            if (!dumpName)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
-                breaks += 2;
-                goto out;
-            }
-            
-            // Check if an override file already exists for this dump
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s%s.nsp", BATCH_OVERRIDES_PATH, dumpName);
-            
-            if (checkIfFileExists(strbuf))
-            {
-                free(dumpName);
-                dumpName = NULL;
-                continue;
-            }
-            
-            snprintf(batchEntries[batchEntryIndex].nspFilename, MAX_CHARACTERS(batchEntries[batchEntryIndex].nspFilename), strrchr(strbuf, '/') + 1);
-            snprintf(batchEntries[batchEntryIndex].truncatedNspFilename, MAX_CHARACTERS(batchEntries[batchEntryIndex].truncatedNspFilename), batchEntries[batchEntryIndex].nspFilename);
-            
-            if (useBrackets)
-            {
-                // Generate output name with brackets
-                free(dumpName);
-                dumpName = NULL;
-                
-                dumpName = generateNSPDumpName(curNspDumpType, titleIndex, true);
-                if (!dumpName)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name with brackets!", __func__);
-                    breaks += 2;
-                    goto out;
-                }
-            }
-            
-            // Check if this title has already been dumped
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
-            
-            free(dumpName);
-            dumpName = NULL;
-            
-            if (skipDumpedTitles && checkIfFileExists(strbuf)) continue;
-            
-            // Save title properties
-            batchEntries[batchEntryIndex].enabled = true;
-            batchEntries[batchEntryIndex].titleType = curNspDumpType;
-            batchEntries[batchEntryIndex].titleIndex = titleIndex;
-            batchEntries[batchEntryIndex].contentSize = (i == 0 ? baseAppEntries[titleIndex].contentSize : (i == 1 ? patchEntries[titleIndex].contentSize : addOnEntries[titleIndex].contentSize));
-            batchEntries[batchEntryIndex].contentSizeStr = (i == 0 ? baseAppEntries[titleIndex].contentSizeStr : (i == 1 ? patchEntries[titleIndex].contentSizeStr : addOnEntries[titleIndex].contentSizeStr));
-            
-            // Fix entry name length
-            truncateBrowserEntryName(batchEntries[batchEntryIndex].truncatedNspFilename);
-            
-            // Increase batch entry index
-            batchEntryIndex++;
-            
-            // Increase total base application count
-            if (i == 0) totalAppCount++;
-            
-            // Increase total patch count
-            if (i == 1) totalPatchCount++;
-            
-            // Increase total addon count
-            if (i == 2) totalAddOnCount++;
+            breaks++;
+            verifyPrintResult(&verifyCtx);
         }
+    } else {
+        breaks -= 2;
     }
     
-    // Calculate total title count
-    totalTitleCount = (totalAppCount + totalPatchCount + totalAddOnCount);
-    if (!totalTitleCount)
+out:
+    perfStop("HFS0 file", dumpName, progressCtx.totalSize, success);
+    
+    sinkClose(&sinkCtx);
+    
+    verifyFree(&verifyCtx);
+    
+    free(dumpName);
+    
+    breaks += 2;
+    
+    changeHomeButtonBlockStatus(false);
+    
+    return success;
+}
+
+bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDumpCfg)
+{
+    if (!exeFsDumpCfg)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "You have already dumped all titles matching the selected settings!");
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ExeFS configuration struct!", __func__);
         breaks += 2;
-        goto out;
+        return false;
     }
     
-    // Sort batch entries by name
-    qsort(batchEntries, totalTitleCount, sizeof(batchEntry), batchEntryCmp);
+    bool isFat32 = exeFsDumpCfg->isFat32;
+    bool useLayeredFSDir = exeFsDumpCfg->useLayeredFSDir;
     
-    if (totalTitleCount < maxEntryCount)
-    {
-        tmpBatchEntries = realloc(batchEntries, totalTitleCount * sizeof(batchEntry));
-        if (!tmpBatchEntries)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%s: failed to reallocate batch entries!", __func__);
-            breaks += 2;
-            goto out;
-        }
-        
-        batchEntries = tmpBatchEntries;
-        tmpBatchEntries = NULL;
-    }
+    u32 i;
+    u64 n = 0, offset = 0;
+    FILE *outFile = NULL;
+    u8 splitIndex = 0;
+    size_t write_res;
+    bool proceed = true, success = false, fat32_error = false;
     
-    // Display summary controls
-    if (totalTitleCount > maxSummaryFileCount)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "[ " NINTENDO_FONT_DPAD " / " NINTENDO_FONT_LSTICK " / " NINTENDO_FONT_RSTICK " ] Move | [ " NINTENDO_FONT_ZL " / " NINTENDO_FONT_ZR " ] Change page | [ " NINTENDO_FONT_A " ] Proceed | [ " NINTENDO_FONT_B " ] Cancel | [ " NINTENDO_FONT_Y " ] Toggle selected entry | [ "  NINTENDO_FONT_L " ] Disable all entries | [ " NINTENDO_FONT_R " ] Enable all entries\n[ " NINTENDO_FONT_PLUS " ] Exit");
-    } else {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "[ " NINTENDO_FONT_DPAD " / " NINTENDO_FONT_LSTICK " / " NINTENDO_FONT_RSTICK " ] Move | [ " NINTENDO_FONT_A " ] Proceed | [ " NINTENDO_FONT_B " ] Cancel | [ " NINTENDO_FONT_Y " ] Toggle selected entry | [ "  NINTENDO_FONT_L " ] Disable all entries | [ " NINTENDO_FONT_R " ] Enable all entries | [ " NINTENDO_FONT_PLUS " ] Exit");
-    }
+    char tmp_idx[5] = {'\0'};
+    char *dumpName = NULL;
+    char dumpPath[NAME_BUF_LEN] = {'\0'}, curDumpPath[NAME_BUF_LEN * 2] = {'\0'}, manifestPath[NAME_BUF_LEN] = {'\0'};
     
-    breaks += 2;
+    layeredfs_manifest_t prevManifest, manifest;
+    memset(&prevManifest, 0, sizeof(layeredfs_manifest_t));
+    memset(&manifest, 0, sizeof(layeredfs_manifest_t));
     
-    // Display free space
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Free SD card space: %s (%lu bytes).", freeSpaceStr, freeSpace);
-    breaks += 2;
+    layeredfs_source_area area;
+    u8 layout_hash[SHA256_HASH_SIZE];
+    u32 manifestIndex = 0;
+    bool incremental = false;
     
-    // Display summary
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Summary:");
-    breaks += 2;
+    progress_ctx_t progressCtx;
+    memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
-    if (totalAppCount)
+    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    
+    if ((!usePatch && !titleAppCount) || (usePatch && !titlePatchCount))
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "BASE: %u", totalAppCount);
-        strcat(summary_str, strbuf);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title count!", __func__);
+        breaks += 2;
+        return false;
     }
     
-    if (totalPatchCount)
+    if ((!usePatch && titleIndex > (titleAppCount - 1)) || (usePatch && titleIndex > (titlePatchCount - 1)))
     {
-        if (totalAppCount) strcat(summary_str, " | ");
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "UPD: %u", totalPatchCount);
-        strcat(summary_str, strbuf);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title index!", __func__);
+        breaks += 2;
+        return false;
+    }
+    
+    if (!useLayeredFSDir)
+    {
+        dumpName = generateNSPDumpName((!usePatch ? DUMP_APP_NSP : DUMP_PATCH_NSP), titleIndex, false);
+        if (!dumpName)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+            breaks += 2;
+            return false;
+        }
     }
     
-    if (totalAddOnCount)
+    // Retrieve ExeFS from Program NCA
+    if (!readNcaExeFsSection(titleIndex, usePatch))
     {
-        if (totalAppCount || totalPatchCount) strcat(summary_str, " | ");
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "DLC: %u", totalAddOnCount);
-        strcat(summary_str, strbuf);
+        if (dumpName) free(dumpName);
+        breaks += 2;
+        return false;
     }
     
-    strcat(summary_str, " | ");
-    snprintf(strbuf, MAX_CHARACTERS(strbuf), "Total: %u", totalTitleCount);
-    strcat(summary_str, strbuf);
+    // Calculate total dump size
+    if (!calculateExeFsExtractedDataSize(&(progressCtx.totalSize))) goto out;
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, summary_str);
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Extracted ExeFS dump size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    uiRefreshDisplay();
     breaks++;
     
-    while(true)
+    if (progressCtx.totalSize > freeSpace)
     {
-        cur_breaks = breaks;
-        
-        uiFill(0, 8 + (cur_breaks * LINE_HEIGHT), FB_WIDTH, FB_HEIGHT - (8 + (cur_breaks * LINE_HEIGHT)), BG_COLOR_RGB);
-        
-        // Calculate the number of selected titles
-        j = 0;
-        u64 totalOutSize = 0;
-        char totalOutSizeStr[32] = {'\0'};
-        
-        for(i = 0; i < totalTitleCount; i++)
-        {
-            if (batchEntries[i].enabled)
-            {
-                j++;
-                totalOutSize += batchEntries[i].contentSize;
-            }
-        }
-        
-        convertSize(totalOutSize, totalOutSizeStr, MAX_CHARACTERS(totalOutSizeStr));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+        goto out;
+    }
+    
+    // Generate output path
+    if (!useLayeredFSDir)
+    {
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", EXEFS_DUMP_PATH, dumpName);
         
-        if (totalTitleCount > maxSummaryFileCount)
+        if (exeFsContext.idOffset > 0)
         {
-            if (j && totalOutSize)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_RGB, "Current page: %u | Selected titles: %u | Approximate total dump size: %s (%lu bytes)", summaryPage + 1, j, totalOutSizeStr, totalOutSize);
-            } else {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_RGB, "Current page: %u | Selected titles: %u", summaryPage + 1, j);
-            }
-        } else {
-            if (j && totalOutSize)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_RGB, "Selected titles: %u | Approximate total dump size: %s (%lu bytes)", j, totalOutSizeStr, totalOutSize);
-            } else {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(cur_breaks), FONT_COLOR_RGB, "Selected titles: %u", j);
-            }
+            sprintf(strbuf, " (ID offset #%u)", exeFsContext.idOffset);
+            strcat(dumpPath, strbuf);
         }
+    } else {
+        mkdir(cfwDirStr, 0744);
         
-        cur_breaks += 2;
+        // Always use the base application title ID
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, (usePatch ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : baseAppEntries[titleIndex].titleId) + exeFsContext.idOffset);
+        mkdir(dumpPath, 0744);
         
-        j = 0;
-        highlight = false;
+        strcat(dumpPath, "/exefs");
+    }
+    
+    mkdir(dumpPath, 0744);
+    
+    // Check which files changed since the previous extraction to the same LayeredFS directory
+    // Unlike RomFS data, ExeFS data doesn't come from the base application, so this only helps if the Program NCA is still the same
+    if (useLayeredFSDir)
+    {
+        layeredFsManifestGetPath(dumpPath, LAYEREDFS_EXEFS_MANIFEST_NAME, manifestPath, MAX_CHARACTERS(manifestPath));
+        incremental = layeredFsManifestLoad(&prevManifest, manifestPath);
         
-        for(i = (summaryPage * maxSummaryFileCount); i < ((summaryPage + 1) * maxSummaryFileCount); i++, j++)
+        for(i = 0; i < exeFsContext.exefs_header.file_cnt; i++)
         {
-            if (i >= totalTitleCount) break;
+            char *exeFsFilename = (exeFsContext.exefs_str_table + exeFsContext.exefs_entries[i].filename_offset);
             
-            xpos = STRING_X_POS;
-            ypos = (8 + (cur_breaks * LINE_HEIGHT) + (j * (font_height + 12)) + 6);
+            // Reported by the dump loop
+            if (!strlen(exeFsFilename)) break;
             
-            if (i == selectedSummaryEntry)
+            snprintf(curDumpPath, MAX_CHARACTERS(curDumpPath), "%s/%s", dumpPath, exeFsFilename);
+            removeIllegalCharacters(curDumpPath + strlen(dumpPath) + 1);
+            
+            memset(&area, 0, sizeof(layeredfs_source_area));
+            memcpy(&(area.ncaId), &(exeFsContext.ncaId), sizeof(NcmContentId));
+            area.offset = (exeFsContext.exefs_data_offset - exeFsContext.exefs_offset + exeFsContext.exefs_entries[i].file_offset);
+            area.size = exeFsContext.exefs_entries[i].file_size;
+            
+            sha256CalculateHash(layout_hash, &area, sizeof(layeredfs_source_area));
+            
+            // Entries are added in ExeFS order, so the manifest index matches the ExeFS entry index
+            if (!layeredFsManifestAddEntry(&manifest, curDumpPath + strlen(dumpPath) + 1, area.size, layout_hash, &manifestIndex))
             {
-                highlight = true;
-                uiFill(0, ypos - 6, FB_WIDTH, font_height + 12, HIGHLIGHT_BG_COLOR_RGB);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for the LayeredFS manifest!", __func__);
+                goto out;
             }
             
-            uiDrawIcon((highlight ? (batchEntries[i].enabled ? enabledHighlightIconBuf : disabledHighlightIconBuf) : (batchEntries[i].enabled ? enabledNormalIconBuf : disabledNormalIconBuf)), BROWSER_ICON_DIMENSION, BROWSER_ICON_DIMENSION, xpos, ypos);
-            xpos += (BROWSER_ICON_DIMENSION + 8);
+            layeredfs_manifest_entry_t *prevEntry = layeredFsManifestFind(&prevManifest, manifest.entries[manifestIndex].path);
             
-            if (highlight)
+            if (prevEntry && prevEntry->size == area.size && !memcmp(prevEntry->layout_hash, layout_hash, SHA256_HASH_SIZE) && layeredFsManifestCheckOutput(prevEntry, curDumpPath, (area.size > FAT32_FILESIZE_LIMIT && isFat32)))
             {
-                uiDrawString(xpos, ypos, HIGHLIGHT_FONT_COLOR_RGB, batchEntries[i].truncatedNspFilename);
-                
-                if (batchEntries[i].contentSize)
-                {
-                    snprintf(strbuf, MAX_CHARACTERS(strbuf), "(%s)", batchEntries[i].contentSizeStr);
-                    uiDrawString(FB_WIDTH - (8 + uiGetStrWidth(strbuf)), ypos, HIGHLIGHT_FONT_COLOR_RGB, strbuf);
-                }
-            } else {
-                uiDrawString(xpos, ypos, FONT_COLOR_RGB, batchEntries[i].truncatedNspFilename);
-                
-                if (batchEntries[i].contentSize)
-                {
-                    snprintf(strbuf, MAX_CHARACTERS(strbuf), "(%s)", batchEntries[i].contentSizeStr);
-                    uiDrawString(FB_WIDTH - (8 + uiGetStrWidth(strbuf)), ypos, FONT_COLOR_RGB, strbuf);
-                }
+                manifest.entries[manifestIndex].mtime = prevEntry->mtime;
+                manifest.entries[manifestIndex].flags |= LAYEREDFS_MANIFEST_FLAG_UNCHANGED;
+                manifest.unchanged_cnt++;
+                manifest.unchanged_size += area.size;
             }
-            
-            if (i == selectedSummaryEntry) highlight = false;
         }
         
-        while(true)
+        if (manifest.unchanged_size)
         {
-            uiUpdateStatusMsg();
-            uiRefreshDisplay();
-            
-            scanPads();
-            
-            keysDown = getButtonsDown();
-            keysHeld = getButtonsHeld();
-            
-            if (keysDown || keysHeld) break;
+            progressCtx.totalSize -= manifest.unchanged_size;
+            convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
         }
         
-        // Exit
-        if (keysDown & HidNpadButton_Plus)
+        if (incremental)
         {
-            ret = -2;
-            proceed = false;
-            break;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Previous extraction found. Only modified files will be written.");
+            uiRefreshDisplay();
+            breaks++;
         }
+    }
+    
+    // Start dump process
+    breaks++;
+    dumpStartMsg();
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    breaks++;
+    
+    changeHomeButtonBlockStatus(true);
+    
+    progressCtx.line_offset = (breaks + 4);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    
+    progressUiThreadStart(&progressCtx);
+    
+    for(i = 0; i < exeFsContext.exefs_header.file_cnt; i++)
+    {
+        n = DUMP_BUFFER_SIZE;
+        outFile = NULL;
+        splitIndex = 0;
         
-        // Start batch dump process
-        if (keysDown & HidNpadButton_A)
-        {
-            // Check if we have at least a single enabled entry
-            for(i = 0; i < totalTitleCount; i++)
-            {
-                if (batchEntries[i].enabled) break;
-            }
-            
-            if (i < totalTitleCount)
-            {
-                proceed = true;
-                break;
-            } else {
-                uiStatusMsg("Please enable at least one entry from the list.");
-            }
-        }
+        char *exeFsFilename = (exeFsContext.exefs_str_table + exeFsContext.exefs_entries[i].filename_offset);
         
-        // Cancel batch dump process
-        if (keysDown & HidNpadButton_B)
+        // Check if we're dealing with a nameless file
+        if (!strlen(exeFsFilename))
         {
-            proceed = false;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: file entry without name in ExeFS section!", __func__);
             break;
         }
         
-        // Toggle selected entry
-        if (keysDown & HidNpadButton_Y) batchEntries[selectedSummaryEntry].enabled ^= 0x01;
+        layeredfs_manifest_entry_t *manifestEntry = (i < manifest.entry_cnt ? &(manifest.entries[i]) : NULL);
+        if (manifestEntry && (manifestEntry->flags & LAYEREDFS_MANIFEST_FLAG_UNCHANGED)) continue;
         
-        // Disable all entries
-        if (keysDown & HidNpadButton_L)
-        {
-            for(i = 0; i < totalTitleCount; i++) batchEntries[i].enabled = false;
-        }
+        snprintf(curDumpPath, MAX_CHARACTERS(curDumpPath), "%s/%s", dumpPath, exeFsFilename);
+        removeIllegalCharacters(curDumpPath + strlen(dumpPath) + 1);
         
-        // Enable all entries
-        if (keysDown & HidNpadButton_R)
+        if (exeFsContext.exefs_entries[i].file_size > FAT32_FILESIZE_LIMIT && isFat32)
         {
-            for(i = 0; i < totalTitleCount; i++) batchEntries[i].enabled = true;
+            mkdir(curDumpPath, 0744);
+            sprintf(tmp_idx, "/%02u", splitIndex);
+            strcat(curDumpPath, tmp_idx);
         }
         
-        // Change page (left)
-        if ((keysDown & HidNpadButton_ZL) && totalTitleCount > maxSummaryFileCount)
+        outFile = fopen(curDumpPath, "wb");
+        if (!outFile)
         {
-            if (summaryPage > 0)
-            {
-                summaryPage--;
-                selectedSummaryEntry = (summaryPage * maxSummaryFileCount);
-            }
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, curDumpPath);
+            break;
         }
         
-        // Change page (right)
-        if ((keysDown & HidNpadButton_ZR) && totalTitleCount > maxSummaryFileCount)
-        {
-            if (((summaryPage + 1) * maxSummaryFileCount) < totalTitleCount)
-            {
-                summaryPage++;
-                selectedSummaryEntry = (summaryPage * maxSummaryFileCount);
-            }
-        }
+        printProgressStatus(&progressCtx, PROGRESS_STATUS_UPPER, "Copying \"%s\"...", exeFsFilename);
         
-        // Go up
-        if ((keysDown & HidNpadButton_Up) || (keysDown & HidNpadButton_StickLUp) || (keysHeld & HidNpadButton_StickRUp))
+        for(offset = 0; offset < exeFsContext.exefs_entries[i].file_size; offset += n, progressCtx.curOffset += n)
         {
-            if (selectedSummaryEntry > (summaryPage * maxSummaryFileCount))
+            printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "Output file: \"%s\".", strrchr(curDumpPath, '/') + 1);
+            
+            if (n > (exeFsContext.exefs_entries[i].file_size - offset)) n = (exeFsContext.exefs_entries[i].file_size - offset);
+            
+            breaks = (progressCtx.line_offset + 2);
+            proceed = processNcaCtrSectionBlock(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), exeFsContext.exefs_data_offset + exeFsContext.exefs_entries[i].file_offset + offset, dumpBuf, n, false);
+            breaks = (progressCtx.line_offset - 4);
+            
+            if (!proceed) break;
+            
+            if (exeFsContext.exefs_entries[i].file_size > FAT32_FILESIZE_LIMIT && isFat32 && (offset + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
             {
-                selectedSummaryEntry--;
+                u64 new_file_chunk_size = ((offset + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
+                u64 old_file_chunk_size = (n - new_file_chunk_size);
+                
+                if (old_file_chunk_size > 0)
+                {
+                    write_res = dumpFileWrite(dumpBuf, old_file_chunk_size, outFile);
+                    if (write_res != old_file_chunk_size)
+                    {
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, offset, splitIndex, write_res);
+                        proceed = false;
+                        break;
+                    }
+                }
+                
+                fclose(outFile);
+                outFile = NULL;
+                
+                if (new_file_chunk_size > 0 || (offset + n) < exeFsContext.exefs_entries[i].file_size)
+                {
+                    char *tmp = strrchr(curDumpPath, '/');
+                    if (tmp != NULL) *tmp = '\0';
+                    
+                    splitIndex++;
+                    sprintf(tmp_idx, "/%02u", splitIndex);
+                    strcat(curDumpPath, tmp_idx);
+                    
+                    outFile = fopen(curDumpPath, "wb");
+                    if (!outFile)
+                    {
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
+                        proceed = false;
+                        break;
+                    }
+                    
+                    if (new_file_chunk_size > 0)
+                    {
+                        write_res = dumpFileWrite(dumpBuf + old_file_chunk_size, new_file_chunk_size, outFile);
+                        if (write_res != new_file_chunk_size)
+                        {
+                            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, offset + old_file_chunk_size, splitIndex, write_res);
+                            proceed = false;
+                            break;
+                        }
+                    }
+                }
             } else {
-                if ((keysDown & HidNpadButton_Up) || (keysDown & HidNpadButton_StickLUp))
+                write_res = dumpFileWrite(dumpBuf, n, outFile);
+                if (write_res != n)
                 {
-                    if (((summaryPage + 1) * maxSummaryFileCount) < totalTitleCount)
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, offset, write_res);
+                    
+                    if ((offset + n) > FAT32_FILESIZE_LIMIT)
                     {
-                        selectedSummaryEntry = (((summaryPage + 1) * maxSummaryFileCount) - 1);
-                    } else {
-                        selectedSummaryEntry = (totalTitleCount - 1);
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
+                        fat32_error = true;
                     }
+                    
+                    proceed = false;
+                    break;
                 }
             }
+            
+            printProgressBar(&progressCtx, true, n);
+            
+            if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+                proceed = false;
+                break;
+            }
         }
         
-        // Go down
-        if ((keysDown & HidNpadButton_Down) || (keysDown & HidNpadButton_StickLDown) || (keysHeld & HidNpadButton_StickRDown))
+        if (outFile) fclose(outFile);
+        
+        if (!proceed) break;
+        
+        // Support empty files
+        if (!exeFsContext.exefs_entries[i].file_size)
         {
-            if (((((summaryPage + 1) * maxSummaryFileCount) < totalTitleCount) && selectedSummaryEntry < (((summaryPage + 1) * maxSummaryFileCount) - 1)) || ((((summaryPage + 1) * maxSummaryFileCount) >= totalTitleCount) && selectedSummaryEntry < (totalTitleCount - 1)))
-            {
-                selectedSummaryEntry++;
-            } else {
-                if ((keysDown & HidNpadButton_Down) || (keysDown & HidNpadButton_StickLDown))
-                {
-                    selectedSummaryEntry = (summaryPage * maxSummaryFileCount);
-                }
-            }
+            printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "Output file: \"%s\".", strrchr(curDumpPath, '/') + 1);
+            
+            if (progressCtx.totalSize == exeFsContext.exefs_entries[i].file_size) progressCtx.progress = 100;
+            
+            printProgressBar(&progressCtx, false, 0);
         }
-    }
-    
-    uiClearStatusMsg();
-    
-    breaks = initial_breaks;
-    uiFill(0, 8 + (breaks * LINE_HEIGHT), FB_WIDTH, FB_HEIGHT - (8 + (breaks * LINE_HEIGHT)), BG_COLOR_RGB);
-    
-    if (!proceed)
-    {
-        if (ret != -2)
+        
+        // Set archive bit (only for FAT32)
+        if (exeFsContext.exefs_entries[i].file_size > FAT32_FILESIZE_LIMIT && isFat32)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled");
-            breaks += 2;
+            char *tmp = strrchr(curDumpPath, '/');
+            if (tmp != NULL) *tmp = '\0';
+            fsdevSetConcatenationFileAttribute(curDumpPath);
         }
         
-        goto out;
+        if (manifestEntry) layeredFsManifestUpdateEntry(manifestEntry, curDumpPath, strlen(dumpPath), NULL);
     }
     
-    // Calculate the disabled entry count
-    for(i = 0; i < totalTitleCount; i++)
+    if (proceed)
     {
-        if (!batchEntries[i].enabled) disabledEntryCount++;
+        if (progressCtx.curOffset >= progressCtx.totalSize)
+        {
+            success = true;
+        } else {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: underdump error! Wrote %lu bytes, expected %lu bytes.", __func__, progressCtx.curOffset, progressCtx.totalSize);
+        }
     }
     
-    // Start dump process
-    dumpStartMsg();
-    uiRefreshDisplay();
-    breaks++;
-    
-    changeHomeButtonBlockStatus(true);
-    
-    initial_breaks = breaks;
+    progressUiThreadStop(&progressCtx);
     
-    j = 0;
+    breaks = (progressCtx.line_offset + 2);
     
-    for(i = 0; i < totalTitleCount; i++)
+    if (success)
     {
-        if (!batchEntries[i].enabled) continue;
-        
-        breaks = initial_breaks;
-        
-        uiFill(0, 8 + (breaks * LINE_HEIGHT), FB_WIDTH, FB_HEIGHT - (8 + (breaks * LINE_HEIGHT)), BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Title: %.*s [%u / %u].", strlen(batchEntries[i].nspFilename) - 4, batchEntries[i].nspFilename, j + 1, totalTitleCount - disabledEntryCount);
-        breaks++;
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Free SD card space: %s (%lu bytes).", freeSpaceStr, freeSpace);
-        breaks++;
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
         
-        uiRefreshDisplay();
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
         
-        // Dump title
-        int nspRet = dumpNintendoSubmissionPackage(batchEntries[i].titleType, batchEntries[i].titleIndex, &nspDumpCfg, true);
-        if (nspRet >= 0)
+        if (useLayeredFSDir)
         {
-            // Create override file if necessary
-            if (rememberDumpedTitles)
+            layeredFsManifestSort(&manifest);
+            u32 keptCnt = layeredFsManifestDeleteStale(&prevManifest, &manifest, dumpPath, isFat32);
+            layeredFsManifestSave(&manifest, manifestPath);
+            
+            if (manifest.unchanged_cnt)
             {
-                snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s%s", BATCH_OVERRIDES_PATH, batchEntries[i].nspFilename);
-                FILE *overrideFile = fopen(strbuf, "wb");
-                if (overrideFile) fclose(overrideFile);
+                breaks++;
+                convertSize(manifest.unchanged_size, strbuf, MAX_CHARACTERS(strbuf));
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%u unchanged file(s) didn't have to be written again (%s).", manifest.unchanged_cnt, strbuf);
             }
-        } else {
-            // If "Halt dump process on errors" is disabled, just wait a little bit and keep going (unless the process was truly canceled by the user)
-            if (!haltOnErrors && nspRet != -2)
+            
+            if (keptCnt)
             {
-                delay(5);
-            } else {
-                goto out;
+                breaks++;
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%u file(s) no longer part of the ExeFS were kept, since they were modified after the previous extraction.", keptCnt);
             }
         }
+    } else {
+        setProgressBarError(&progressCtx);
+        if (fat32_error) breaks += 2;
         
-        // Update free space
-        updateFreeSpace();
-        
-        j++;
+        // See dumpRomFsSectionData()
+        if (!incremental) removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
     }
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed!");
-    breaks += 2;
+out:
+    layeredFsManifestFree(&prevManifest);
+    layeredFsManifestFree(&manifest);
     
-    ret = 0;
+    freeExeFsContext();
     
-out:
-    if (batchEntries) free(batchEntries);
+    if (dumpName) free(dumpName);
+    
+    breaks += 2;
     
     changeHomeButtonBlockStatus(false);
     
-    return ret;
+    return success;
 }
 
-bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
+bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaFsOptions *exeFsDumpCfg)
 {
-    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].size)
+    if (!exeFsDumpCfg)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to dump raw HFS0 partition!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ExeFS configuration struct!", __func__);
+        breaks += 2;
+        return false;
+    }
+    
+    bool isFat32 = exeFsDumpCfg->isFat32;
+    bool useLayeredFSDir = exeFsDumpCfg->useLayeredFSDir;
+    
+    if (!exeFsContext.exefs_header.file_cnt || fileIndex > (exeFsContext.exefs_header.file_cnt - 1) || !exeFsContext.exefs_entries || !exeFsContext.exefs_str_table || exeFsContext.exefs_data_offset <= exeFsContext.exefs_offset || (!usePatch && titleIndex > (titleAppCount - 1)) || (usePatch && titleIndex > (titlePatchCount - 1)))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse file entry from ExeFS section!", __func__);
         breaks += 2;
         return false;
     }
     
-    Result result;
-    u64 partitionOffset;
-    bool success = false, fat32_error = false;
     u64 n = DUMP_BUFFER_SIZE;
-    char dumpPath[NAME_BUF_LEN] = {'\0'};
     FILE *outFile = NULL;
     u8 splitIndex = 0;
-    openIStoragePartition storageIndex;
+    size_t write_res;
+    bool proceed = true, success = false, fat32_error = false, removeFile = true;
     
-    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    char tmp_idx[5];
+    char *dumpName = NULL;
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
     
     progress_ctx_t progressCtx;
     memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
-    size_t write_res;
+    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
     
-    char *dumpName = generateGameCardDumpName(false);
-    if (!dumpName)
+    char *exeFsFilename = (exeFsContext.exefs_str_table + exeFsContext.exefs_entries[fileIndex].filename_offset);
+    
+    // Check if we're dealing with a nameless file
+    if (!strlen(exeFsFilename))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: file entry without name in ExeFS section!", __func__);
         breaks += 2;
         return false;
     }
     
-    // The IStorage instance returned for partition == 0 contains the gamecard header, the gamecard certificate, the root HFS0 header and:
-    // * The "update" (0) partition and the "normal" (1) partition (for gamecard type 0x01)
-    // * The "update" (0) partition, the "logo" (1) partition and the "normal" (2) partition (for gamecard type 0x02)
-    // The IStorage instance returned for partition == 1 contains the "secure" partition (which can either be 2 or 3 depending on the gamecard type)
-    // This makes sure we just dump the *actual* raw HFS0 partition, without preceding data, padding, etc.
-    // Oddly enough, IFileSystem instances actually point to the specified partition ID filesystem. I don't understand why it doesn't work like that for IStorage, but whatever
-    // NOTE: Using partition == 2 returns error 0x149002, and using higher values probably do so, too
-    partitionOffset = gameCardInfo.hfs0Partitions[partition].offset; // Relative to IStorage instance
-    progressCtx.totalSize = gameCardInfo.hfs0Partitions[partition].size;
-    storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
+    // Generate output path
+    if (!useLayeredFSDir)
+    {
+        dumpName = generateNSPDumpName((!usePatch ? DUMP_APP_NSP : DUMP_PATCH_NSP), titleIndex, false);
+        if (!dumpName)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+            breaks += 2;
+            return false;
+        }
+        
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", EXEFS_DUMP_PATH, dumpName);
+        
+        if (exeFsContext.idOffset > 0)
+        {
+            sprintf(strbuf, " (ID offset #%u)", exeFsContext.idOffset);
+            strcat(dumpPath, strbuf);
+        }
+    } else {
+        mkdir(cfwDirStr, 0744);
+        
+        // Always use the base application title ID
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, (usePatch ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : baseAppEntries[titleIndex].titleId) + + exeFsContext.idOffset);
+        mkdir(dumpPath, 0744);
+        
+        strcat(dumpPath, "/exefs");
+    }
+    
+    mkdir(dumpPath, 0744);
+    
+    strcat(dumpPath, "/");
+    size_t cur_len = strlen(dumpPath);
+    strcat(dumpPath, exeFsFilename);
+    removeIllegalCharacters(dumpPath + cur_len);
     
+    progressCtx.totalSize = exeFsContext.exefs_entries[fileIndex].file_size;
     convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "HFS0 partition size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
-    breaks += 2;
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "File size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    breaks++;
     
     if (progressCtx.totalSize > freeSpace)
     {
@@ -3048,12 +6129,7 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
         goto out;
     }
     
-    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting)
-    {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0.%02u", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition), splitIndex);
-    } else {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition));
-    }
+    breaks++;
     
     // Check if the dump already exists
     if (checkIfFileExists(dumpPath))
@@ -3061,9 +6137,11 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
         // Ask the user if they want to proceed anyway
         int cur_breaks = breaks;
         
-        if (!yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?"))
+        proceed = yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?");
+        if (!proceed)
         {
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            removeFile = false;
             goto out;
         } else {
             // Remove the prompt from the screen
@@ -3072,18 +6150,16 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
         }
     }
     
-    result = openGameCardStoragePartition(storageIndex);
-    if (R_FAILED(result))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #%u! (0x%08X)", __func__, storageIndex - 1, result);
-        goto out;
-    }
-    
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
-        goto out;
+    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+    {
+        // Since we may actually be dealing with an existing directory with the archive bit set or unset, let's try both
+        // Better safe than sorry
+        remove(dumpPath);
+        fsdevDeleteDirectoryRecursively(dumpPath);
+        
+        mkdir(dumpPath, 0744);
+        sprintf(tmp_idx, "/%02u", splitIndex);
+        strcat(dumpPath, tmp_idx);
     }
     
     // Start dump process
@@ -3094,32 +6170,43 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
     
     changeHomeButtonBlockStatus(true);
     
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Copying \"%s\"...", exeFsFilename);
+    breaks += 2;
+    
+    uiRefreshDisplay();
+    
+    outFile = fopen(dumpPath, "wb");
+    if (!outFile)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file!", __func__);
+        goto out;
+    }
+    
     progressCtx.line_offset = (breaks + 2);
     timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
     
-    for (progressCtx.curOffset = 0; progressCtx.curOffset < progressCtx.totalSize; progressCtx.curOffset += n)
+    progressUiThreadStart(&progressCtx);
+    
+    for(progressCtx.curOffset = 0; progressCtx.curOffset < progressCtx.totalSize; progressCtx.curOffset += n)
     {
-        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+        printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "Output file: \"%s\".", strrchr(dumpPath, '/') + 1);
         
         if (n > (progressCtx.totalSize - progressCtx.curOffset)) n = (progressCtx.totalSize - progressCtx.curOffset);
         
-        result = readGameCardStoragePartition(partitionOffset + progressCtx.curOffset, dumpBuf, n);
-        if (R_FAILED(result))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from IStorage partition #%u! (0x%08X)", __func__, n, partitionOffset + progressCtx.curOffset, storageIndex - 1, result);
-            break;
-        }
+        breaks = (progressCtx.line_offset + 2);
+        proceed = processNcaCtrSectionBlock(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), exeFsContext.exefs_data_offset + exeFsContext.exefs_entries[fileIndex].file_offset + progressCtx.curOffset, dumpBuf, n, false);
+        breaks = (progressCtx.line_offset - 2);
         
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting && (progressCtx.curOffset + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
+        if (!proceed) break;
+        
+        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32 && (progressCtx.curOffset + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
         {
             u64 new_file_chunk_size = ((progressCtx.curOffset + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
             u64 old_file_chunk_size = (n - new_file_chunk_size);
             
             if (old_file_chunk_size > 0)
             {
-                write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
+                write_res = dumpFileWrite(dumpBuf, old_file_chunk_size, outFile);
                 if (write_res != old_file_chunk_size)
                 {
                     uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, progressCtx.curOffset, splitIndex, write_res);
@@ -3132,8 +6219,12 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
             
             if (new_file_chunk_size > 0 || (progressCtx.curOffset + n) < progressCtx.totalSize)
             {
+                char *tmp = strrchr(dumpPath, '/');
+                if (tmp != NULL) *tmp = '\0';
+                
                 splitIndex++;
-                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0.%02u", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition), splitIndex);
+                sprintf(tmp_idx, "/%02u", splitIndex);
+                strcat(dumpPath, tmp_idx);
                 
                 outFile = fopen(dumpPath, "wb");
                 if (!outFile)
@@ -3144,7 +6235,7 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
                 
                 if (new_file_chunk_size > 0)
                 {
-                    write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
+                    write_res = dumpFileWrite(dumpBuf + old_file_chunk_size, new_file_chunk_size, outFile);
                     if (write_res != new_file_chunk_size)
                     {
                         uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, progressCtx.curOffset + old_file_chunk_size, splitIndex, write_res);
@@ -3153,7 +6244,7 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
                 }
             }
         } else {
-            write_res = fwrite(dumpBuf, 1, n, outFile);
+            write_res = dumpFileWrite(dumpBuf, n, outFile);
             if (write_res != n)
             {
                 uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
@@ -3182,15 +6273,15 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
     // Support empty files
     if (!progressCtx.totalSize)
     {
-        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+        printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "Output file: \"%s\".", strrchr(dumpPath, '/') + 1);
         
         progressCtx.progress = 100;
         
         printProgressBar(&progressCtx, false, 0);
     }
     
+    progressUiThreadStop(&progressCtx);
+    
     breaks = (progressCtx.line_offset + 2);
     
     if (success)
@@ -3198,117 +6289,451 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
         timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
         progressCtx.now -= progressCtx.start;
         
-        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
-    } else {
-        setProgressBarError(&progressCtx);
-        if (fat32_error) breaks += 2;
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
+    } else {
+        setProgressBarError(&progressCtx);
+        if (fat32_error) breaks += 2;
+    }
+    
+out:
+    if (outFile) fclose(outFile);
+    
+    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+    {
+        char *tmp = strrchr(dumpPath, '/');
+        if (tmp != NULL) *tmp = '\0';
+        
+        if (success)
+        {
+            // Set archive bit (only for FAT32)
+            fsdevSetConcatenationFileAttribute(dumpPath);
+        } else {
+            if (removeFile) fsdevDeleteDirectoryRecursively(dumpPath);
+        }
+    } else {
+        if (!success && removeFile) remove(dumpPath);
+    }
+    
+    if (dumpName) free(dumpName);
+    
+    breaks += 2;
+    
+    changeHomeButtonBlockStatus(false);
+    
+    return success;
+}
+
+static bool addRomFsExtractDir(romFsExtractPlan *plan, const char *romfs_path, const char *output_path, u32 *out_idx)
+{
+    if (plan->dirCount >= plan->dirCapacity)
+    {
+        u32 newCapacity = (plan->dirCapacity ? (plan->dirCapacity * 2) : ROMFS_EXTRACT_INITIAL_ENTRY_CNT);
+        
+        romFsExtractDir *tmpDirs = realloc(plan->dirs, newCapacity * sizeof(romFsExtractDir));
+        if (!tmpDirs) return false;
+        
+        plan->dirs = tmpDirs;
+        plan->dirCapacity = newCapacity;
+    }
+    
+    romFsExtractDir *dir = &(plan->dirs[plan->dirCount]);
+    
+    dir->romfsPath = strdup(romfs_path);
+    dir->outputPath = strdup(output_path);
+    dir->dirLimitCounter = -1;
+    
+    if (!dir->romfsPath || !dir->outputPath)
+    {
+        if (dir->romfsPath) free(dir->romfsPath);
+        if (dir->outputPath) free(dir->outputPath);
+        return false;
+    }
+    
+    *out_idx = plan->dirCount++;
+    
+    return true;
+}
+
+static bool addRomFsExtractFile(romFsExtractPlan *plan, romfs_file *entry, u32 dirIndex)
+{
+    if (plan->fileCount >= plan->fileCapacity)
+    {
+        u32 newCapacity = (plan->fileCapacity ? (plan->fileCapacity * 2) : ROMFS_EXTRACT_INITIAL_ENTRY_CNT);
+        
+        romFsExtractFile *tmpFiles = realloc(plan->files, newCapacity * sizeof(romFsExtractFile));
+        if (!tmpFiles) return false;
+        
+        plan->files = tmpFiles;
+        plan->fileCapacity = newCapacity;
+    }
+    
+    plan->files[plan->fileCount].entry = entry;
+    plan->files[plan->fileCount].dirIndex = dirIndex;
+    plan->files[plan->fileCount].manifestIndex = ROMFS_EXTRACT_NO_MANIFEST_ENTRY;
+    plan->fileCount++;
+    
+    return true;
+}
+
+static void freeRomFsExtractPlan(romFsExtractPlan *plan)
+{
+    u32 i;
+    
+    if (plan->dirs)
+    {
+        for(i = 0; i < plan->dirCount; i++)
+        {
+            free(plan->dirs[i].romfsPath);
+            free(plan->dirs[i].outputPath);
+        }
+        
+        free(plan->dirs);
+    }
+    
+    if (plan->files) free(plan->files);
+    
+    memset(plan, 0, sizeof(romFsExtractPlan));
+}
+
+static int romFsExtractFileSortFunction(const void *a, const void *b)
+{
+    const romfs_file *entry1 = ((const romFsExtractFile*)a)->entry;
+    const romfs_file *entry2 = ((const romFsExtractFile*)b)->entry;
+    
+    if (entry1->dataOff != entry2->dataOff) return (entry1->dataOff < entry2->dataOff ? -1 : 1);
+    if (entry1->dataSize != entry2->dataSize) return (entry1->dataSize < entry2->dataSize ? -1 : 1);
+    
+    // Keep directory order for files sharing the same data
+    return ((const u8*)entry1 < (const u8*)entry2 ? -1 : ((const u8*)entry1 > (const u8*)entry2 ? 1 : 0));
+}
+
+// Walks the RomFS directory tree, creates all output directories and collects every file entry into the extraction plan
+static bool buildRomFsExtractPlan(romFsExtractPlan *plan, u32 dir_offset, char *romfs_path, char *output_path, progress_ctx_t *progressCtx, bool usePatch, bool dumpSiblingDir)
+{
+    if ((!usePatch && (!romFsContext.romfs_dirtable_size || dir_offset > romFsContext.romfs_dirtable_size || !romFsContext.romfs_dir_entries || !romFsContext.romfs_filetable_size || !romFsContext.romfs_file_entries)) || (usePatch && (!bktrContext.romfs_dirtable_size || dir_offset > bktrContext.romfs_dirtable_size || !bktrContext.romfs_dir_entries || !bktrContext.romfs_filetable_size || !bktrContext.romfs_file_entries)) || !romfs_path || !output_path || !progressCtx)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse directory entry from RomFS section!", __func__);
+        return false;
+    }
+    
+    size_t orig_romfs_path_len = strlen(romfs_path);
+    size_t orig_output_path_len = strlen(output_path);
+    
+    bool success = false;
+    u32 dirIndex = 0;
+    
+    romfs_dir *entry = (!usePatch ? (romfs_dir*)((u8*)romFsContext.romfs_dir_entries + dir_offset) : (romfs_dir*)((u8*)bktrContext.romfs_dir_entries + dir_offset));
+    
+    // Check if we're dealing with a nameless directory that's not the root directory
+    if (!entry->nameLen && dir_offset > 0)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: directory entry without name in RomFS section!", __func__);
+        return false;
+    }
+    
+    if ((orig_romfs_path_len + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2) || (orig_output_path_len + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: RomFS section directory path is too long!", __func__);
+        return false;
+    }
+    
+    // Generate current path
+    if (entry->nameLen)
+    {
+        strcat(romfs_path, "/");
+        strncat(romfs_path, (char*)entry->name, entry->nameLen);
+        
+        strcat(output_path, "/");
+        strncat(output_path, (char*)entry->name, entry->nameLen);
+        removeIllegalCharacters(output_path + orig_output_path_len + 1);
+        mkdir(output_path, 0744);
+    }
+    
+    if (entry->childFile != ROMFS_ENTRY_EMPTY)
+    {
+        if (!addRomFsExtractDir(plan, romfs_path, output_path, &dirIndex))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for the RomFS extraction plan!", __func__);
+            goto out;
+        }
+        
+        u32 romfs_file_offset = entry->childFile;
+        
+        while(romfs_file_offset != ROMFS_ENTRY_EMPTY)
+        {
+            romfs_file *file_entry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + romfs_file_offset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + romfs_file_offset));
+            
+            // Check if we're dealing with a nameless file
+            if (!file_entry->nameLen)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: file entry without name in RomFS section!", __func__);
+                goto out;
+            }
+            
+            if ((strlen(romfs_path) + 1 + file_entry->nameLen) >= (NAME_BUF_LEN * 2) || (strlen(output_path) + 1 + file_entry->nameLen) >= (NAME_BUF_LEN * 2))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: RomFS section file path is too long!", __func__);
+                goto out;
+            }
+            
+            if (!addRomFsExtractFile(plan, file_entry, dirIndex))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for the RomFS extraction plan!", __func__);
+                goto out;
+            }
+            
+            romfs_file_offset = file_entry->sibling;
+        }
+    }
+    
+    if (entry->childDir != ROMFS_ENTRY_EMPTY && !buildRomFsExtractPlan(plan, entry->childDir, romfs_path, output_path, progressCtx, usePatch, true)) goto out;
+    
+    romfs_path[orig_romfs_path_len] = '\0';
+    output_path[orig_output_path_len] = '\0';
+    
+    if (dumpSiblingDir && entry->sibling != ROMFS_ENTRY_EMPTY && !buildRomFsExtractPlan(plan, entry->sibling, romfs_path, output_path, progressCtx, usePatch, true)) goto out;
+    
+    success = true;
+    
+out:
+    romfs_path[orig_romfs_path_len] = '\0';
+    output_path[orig_output_path_len] = '\0';
+    
+    return success;
+}
+
+static bool readRomFsFileData(bool usePatch, u64 offset, void *outBuf, u64 bufSize)
+{
+    if (!usePatch) return processNcaCtrSectionBlock(&(romFsContext.ncmStorage), &(romFsContext.ncaId), &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + offset, outBuf, bufSize, false);
+    
+    return readBktrSectionBlock(bktrContext.romfs_filedata_offset + offset, outBuf, bufSize);
+}
+
+static void generateRomFsExtractFilePath(romFsExtractDir *dir, romfs_file *entry, char *output_path)
+{
+    char tmp_idx[16];
+    
+    if (dir->dirLimitCounter >= 0)
+    {
+        sprintf(tmp_idx, "_%d", dir->dirLimitCounter);
+    } else {
+        tmp_idx[0] = '\0';
+    }
+    
+    snprintf(output_path, NAME_BUF_LEN * 2, "%s%s/", dir->outputPath, tmp_idx);
+    
+    size_t name_offset = strlen(output_path);
+    strncat(output_path, (char*)entry->name, entry->nameLen);
+    removeIllegalCharacters(output_path + name_offset);
+}
+
+static layeredfs_manifest_entry_t *getRomFsExtractManifestEntry(romFsExtractPlan *plan, romFsExtractFile *file)
+{
+    if (!plan->manifest || file->manifestIndex == ROMFS_EXTRACT_NO_MANIFEST_ENTRY) return NULL;
+    
+    return &(plan->manifest->entries[file->manifestIndex]);
+}
+
+// Hashes the NCA areas the file data is read from (see layeredfs_manifest.h)
+static bool getRomFsFileLayoutHash(bool usePatch, romfs_file *entry, u8 *outHash)
+{
+    Sha256Context layout_ctx;
+    layeredfs_source_area area;
+    
+    sha256ContextCreate(&layout_ctx);
+    
+    if (entry->dataSize)
+    {
+        if (usePatch)
+        {
+            if (!hashBktrSectionLayout(bktrContext.romfs_filedata_offset + entry->dataOff, entry->dataSize, &layout_ctx)) return false;
+        } else {
+            memset(&area, 0, sizeof(layeredfs_source_area));
+            memcpy(&(area.ncaId), &(romFsContext.ncaId), sizeof(NcmContentId));
+            area.offset = (romFsContext.romfs_filedata_offset - romFsContext.section_offset + entry->dataOff);
+            area.size = entry->dataSize;
+            
+            sha256ContextUpdate(&layout_ctx, &area, sizeof(layeredfs_source_area));
+        }
+    }
+    
+    sha256ContextGetHash(&layout_ctx, outHash);
+    
+    return true;
+}
+
+// Adds every planned file to the new LayeredFS manifest and compares it against the manifest from the previous extraction
+// Files that didn't change are dropped from the plan, so their data isn't even read
+static bool checkRomFsExtractManifest(romFsExtractPlan *plan, progress_ctx_t *progressCtx, bool usePatch, bool isFat32)
+{
+    u32 i, fileCount = 0;
+    char cur_output_path[NAME_BUF_LEN * 2] = {'\0'};
+    u8 layout_hash[SHA256_HASH_SIZE];
+    bool proceed = true;
+    
+    for(i = 0; i < plan->fileCount; i++)
+    {
+        romFsExtractFile *file = &(plan->files[i]);
+        romFsExtractDir *dir = &(plan->dirs[file->dirIndex]);
+        romfs_file *entry = file->entry;
+        
+        // openRomFsExtractFile() takes care of printing an error for these
+        if ((strlen(dir->outputPath) + 12 + entry->nameLen + 3) < (NAME_BUF_LEN * 2))
+        {
+            generateRomFsExtractFilePath(dir, entry, cur_output_path);
+            
+            breaks = (progressCtx->line_offset + 2);
+            proceed = getRomFsFileLayoutHash(usePatch, entry, layout_hash);
+            breaks = (progressCtx->line_offset - 4);
+            
+            if (!proceed) return false;
+            
+            if (!layeredFsManifestAddEntry(plan->manifest, cur_output_path + plan->basePathLen + 1, entry->dataSize, layout_hash, &(file->manifestIndex)))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for the LayeredFS manifest!", __func__);
+                return false;
+            }
+            
+            layeredfs_manifest_entry_t *manifestEntry = getRomFsExtractManifestEntry(plan, file);
+            layeredfs_manifest_entry_t *prevEntry = layeredFsManifestFind(plan->prevManifest, manifestEntry->path);
+            
+            if (prevEntry && prevEntry->size == entry->dataSize && layeredFsManifestCheckOutput(prevEntry, cur_output_path, (entry->dataSize > FAT32_FILESIZE_LIMIT && isFat32)))
+            {
+                manifestEntry->mtime = prevEntry->mtime;
+                memcpy(manifestEntry->data_hash, prevEntry->data_hash, SHA256_HASH_SIZE);
+                
+                if (!memcmp(manifestEntry->layout_hash, prevEntry->layout_hash, SHA256_HASH_SIZE))
+                {
+                    manifestEntry->flags |= LAYEREDFS_MANIFEST_FLAG_UNCHANGED;
+                    plan->manifest->unchanged_cnt++;
+                    plan->manifest->unchanged_size += entry->dataSize;
+                    continue;
+                }
+                
+                // Small files are read as part of a span anyway, so it's cheaper to compare checksums than to write them again
+                if (entry->dataSize < DUMP_BUFFER_SIZE) manifestEntry->flags |= LAYEREDFS_MANIFEST_FLAG_COMPARE;
+            }
+        }
+        
+        if (fileCount != i) memcpy(&(plan->files[fileCount]), file, sizeof(romFsExtractFile));
+        fileCount++;
     }
     
-out:
-    if (outFile) fclose(outFile);
+    plan->fileCount = fileCount;
     
-    if (!success)
+    // Nothing has been published to the progress UI thread yet, so the total size can still be safely updated
+    if (plan->manifest->unchanged_size)
     {
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting)
-        {
-            for(u8 i = 0; i <= splitIndex; i++)
-            {
-                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0.%02u", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition), i);
-                remove(dumpPath);
-            }
-        } else {
-            remove(dumpPath);
-        }
+        progressCtx->totalSize -= plan->manifest->unchanged_size;
+        convertSize(progressCtx->totalSize, progressCtx->totalSizeStr, MAX_CHARACTERS(progressCtx->totalSizeStr));
     }
     
-    closeGameCardStoragePartition();
+    return true;
+}
+
+static FILE *openRomFsExtractFile(romFsExtractPlan *plan, romFsExtractFile *file, char *output_path, bool isFat32, progress_ctx_t *progressCtx)
+{
+    romFsExtractDir *dir = &(plan->dirs[file->dirIndex]);
+    romfs_file *entry = file->entry;
     
-    if (dumpName) free(dumpName);
+    FILE *outFile = NULL;
+    char tmp_idx[16];
     
-    breaks += 2;
+    if ((strlen(dir->outputPath) + 12 + entry->nameLen + 3) >= (NAME_BUF_LEN * 2))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: RomFS section file path is too long!", __func__);
+        return NULL;
+    }
     
-    changeHomeButtonBlockStatus(false);
+    generateRomFsExtractFilePath(dir, entry, output_path);
     
-    return success;
-}
-
-bool copyFileFromHfs0Partition(u32 partition, const char *dest, const char *source, const u64 fileOffset, const u64 fileSize, progress_ctx_t *progressCtx, bool doSplitting)
-{
-    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].header || !gameCardInfo.hfs0Partitions[partition].header_size || !dest || !strlen(dest) || !source || !strlen(source) || !progressCtx)
+    if (entry->dataSize > FAT32_FILESIZE_LIMIT && isFat32)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to copy file from HFS0 partition!", __func__);
-        return false;
+        mkdir(output_path, 0744);
+        strcat(output_path, "/00");
     }
     
-    if (!gameCardInfo.hfs0Partitions[partition].file_cnt)
+    outFile = fopen(output_path, "wb");
+    
+    // Used to overcome issues related to the max entry count per directory in FAT32
+    if (!outFile && (entry->dataSize <= FAT32_FILESIZE_LIMIT || !isFat32))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected HFS0 partition is empty!", __func__);
-        return false;
+        dir->dirLimitCounter++;
+        
+        snprintf(output_path, NAME_BUF_LEN * 2, "%s", dir->outputPath);
+        sprintf(tmp_idx, "_%d", dir->dirLimitCounter);
+        strcat(output_path, tmp_idx);
+        mkdir(output_path, 0744);
+        
+        generateRomFsExtractFilePath(dir, entry, output_path);
+        
+        outFile = fopen(output_path, "wb");
     }
     
-    // IStorage handle must have been retrieved beforehand by the caller function
+    if (!outFile) uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, output_path);
     
-    Result result;
-    bool success = false, fat32_error = false;
-    char splitFilename[NAME_BUF_LEN * 3] = {'\0'};
-    size_t destLen = strlen(dest);
-    FILE *outFile = NULL;
-    u64 off, n = DUMP_BUFFER_SIZE;
-    u8 splitIndex = 0;
-    openIStoragePartition storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
+    return outFile;
+}
+
+static void printRomFsExtractStatus(romFsExtractPlan *plan, romFsExtractFile *file, const char *output_path, progress_ctx_t *progressCtx)
+{
+    romFsExtractDir *dir = &(plan->dirs[file->dirIndex]);
     
-    size_t write_res;
+    printProgressStatus(progressCtx, PROGRESS_STATUS_UPPER, "Copying \"romfs:%s/%.*s\"...", dir->romfsPath, (int)file->entry->nameLen, (char*)file->entry->name);
     
-    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    printProgressStatus(progressCtx, PROGRESS_STATUS_LOWER, "Output file: \"%s\".", strrchr(output_path, '/') + 1);
+}
+
+// Used for files that don't fit in the dump buffer. Their data is read in DUMP_BUFFER_SIZE chunks, with file splitting support
+static bool extractLargeRomFsFile(romFsExtractPlan *plan, romFsExtractFile *file, char *output_path, progress_ctx_t *progressCtx, bool usePatch, bool isFat32, bool *fat32_error)
+{
+    romfs_file *entry = file->entry;
+    layeredfs_manifest_entry_t *manifestEntry = getRomFsExtractManifestEntry(plan, file);
     
-    uiFill(0, ((progressCtx->line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
+    u64 n = DUMP_BUFFER_SIZE;
+    u64 off = 0;
+    u8 splitIndex = 0;
+    bool proceed = true;
+    bool split = (entry->dataSize > FAT32_FILESIZE_LIMIT && isFat32);
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 4), FONT_COLOR_RGB, "Copying \"%s\"...", source);
+    size_t write_res;
+    char tmp_idx[16];
     
-    if ((destLen + 1) >= MAX_CHARACTERS(splitFilename))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: destination path is too long! (%lu bytes)", __func__, destLen);
-        return false;
-    }
+    Sha256Context data_ctx;
+    u8 data_hash[SHA256_HASH_SIZE];
     
-    if (fileSize > FAT32_FILESIZE_LIMIT && doSplitting) snprintf(splitFilename, MAX_CHARACTERS(splitFilename), "%s.%02u", dest, splitIndex);
+    FILE *outFile = openRomFsExtractFile(plan, file, output_path, isFat32, progressCtx);
+    if (!outFile) return false;
     
-    outFile = fopen(((fileSize > FAT32_FILESIZE_LIMIT && doSplitting) ? splitFilename : dest), "wb");
-    if (!outFile)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file!", __func__);
-        goto out;
-    }
+    if (manifestEntry) sha256ContextCreate(&data_ctx);
     
-    for (off = 0; off < fileSize; off += n, progressCtx->curOffset += n)
+    printRomFsExtractStatus(plan, file, output_path, progressCtx);
+    
+    for(off = 0; off < entry->dataSize; off += n, progressCtx->curOffset += n)
     {
-        uiFill(0, ((progressCtx->line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+        if (n > (entry->dataSize - off)) n = (entry->dataSize - off);
         
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", ((fileSize > FAT32_FILESIZE_LIMIT && doSplitting) ? (strrchr(splitFilename, '/') + 1) : (strrchr(dest, '/') + 1)));
-        
-        uiRefreshDisplay();
+        breaks = (progressCtx->line_offset + 2);
+        proceed = readRomFsFileData(usePatch, entry->dataOff + off, dumpBuf, n);
+        breaks = (progressCtx->line_offset - 4);
         
-        if (n > (fileSize - off)) n = (fileSize - off);
+        if (!proceed) break;
         
-        result = readGameCardStoragePartition(fileOffset + off, dumpBuf, n);
-        if (R_FAILED(result))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk at offset 0x%016lX from IStorage partition #%u! (0x%08X)", __func__, n, fileOffset + off, storageIndex - 1, result);
-            break;
-        }
+        if (manifestEntry) sha256ContextUpdate(&data_ctx, dumpBuf, n);
         
-        if (fileSize > FAT32_FILESIZE_LIMIT && doSplitting && (off + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
+        if (split && (off + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
         {
             u64 new_file_chunk_size = ((off + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
             u64 old_file_chunk_size = (n - new_file_chunk_size);
             
             if (old_file_chunk_size > 0)
             {
-                write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
+                write_res = dumpFileWrite(dumpBuf, old_file_chunk_size, outFile);
                 if (write_res != old_file_chunk_size)
                 {
                     uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, off, splitIndex, write_res);
+                    proceed = false;
                     break;
                 }
             }
@@ -3316,30 +6741,38 @@ bool copyFileFromHfs0Partition(u32 partition, const char *dest, const char *sour
             fclose(outFile);
             outFile = NULL;
             
-            if (new_file_chunk_size > 0 || (off + n) < fileSize)
+            if (new_file_chunk_size > 0 || (off + n) < entry->dataSize)
             {
+                char *tmp = strrchr(output_path, '/');
+                if (tmp != NULL) *tmp = '\0';
+                
                 splitIndex++;
-                snprintf(splitFilename, MAX_CHARACTERS(splitFilename), "%s.%02u", dest, splitIndex);
+                sprintf(tmp_idx, "/%02u", splitIndex);
+                strcat(output_path, tmp_idx);
                 
-                outFile = fopen(splitFilename, "wb");
+                outFile = fopen(output_path, "wb");
                 if (!outFile)
                 {
                     uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
+                    proceed = false;
                     break;
                 }
                 
+                printProgressStatus(progressCtx, PROGRESS_STATUS_LOWER, "Output file: \"%s\".", strrchr(output_path, '/') + 1);
+                
                 if (new_file_chunk_size > 0)
                 {
-                    write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
+                    write_res = dumpFileWrite(dumpBuf + old_file_chunk_size, new_file_chunk_size, outFile);
                     if (write_res != new_file_chunk_size)
                     {
                         uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, off + old_file_chunk_size, splitIndex, write_res);
+                        proceed = false;
                         break;
                     }
                 }
             }
         } else {
-            write_res = fwrite(dumpBuf, 1, n, outFile);
+            write_res = dumpFileWrite(dumpBuf, n, outFile);
             if (write_res != n)
             {
                 uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, off, write_res);
@@ -3347,388 +6780,261 @@ bool copyFileFromHfs0Partition(u32 partition, const char *dest, const char *sour
                 if ((off + n) > FAT32_FILESIZE_LIMIT)
                 {
                     uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
-                    fat32_error = true;
+                    *fat32_error = true;
                 }
                 
+                proceed = false;
                 break;
             }
         }
         
         printProgressBar(progressCtx, true, n);
         
-        if (((off + n) < fileSize || (progressCtx->curOffset + n) < progressCtx->totalSize) && cancelProcessCheck(progressCtx))
+        if (((off + n) < entry->dataSize || (progressCtx->curOffset + n) < progressCtx->totalSize) && cancelProcessCheck(progressCtx))
         {
             uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            proceed = false;
             break;
         }
     }
     
-    if (off >= fileSize) success = true;
-    
-    // Support empty files
-    if (!fileSize)
-    {
-        uiFill(0, ((progressCtx->line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dest, '/') + 1);
-        
-        if (progressCtx->totalSize == fileSize) progressCtx->progress = 100;
-        
-        printProgressBar(progressCtx, false, 0);
-    }
-    
-    if (!success)
-    {
-        setProgressBarError(progressCtx);
-        breaks = (progressCtx->line_offset + 2);
-        if (fat32_error) breaks += 2;
-    }
-    
-out:
-    if (outFile) fclose(outFile);
-    
-    if (!success)
-    {
-        if (fileSize > FAT32_FILESIZE_LIMIT && doSplitting)
-        {
-            for(u8 i = 0; i <= splitIndex; i++)
-            {
-                snprintf(splitFilename, MAX_CHARACTERS(splitFilename), "%s.%02u", dest, i);
-                remove(splitFilename);
-            }
-        } else {
-            remove(dest);
-        }
-    }
-    
-    breaks += 2;
-    
-    return success;
-}
-
-bool copyHfs0PartitionContents(u32 partition, progress_ctx_t *progressCtx, const char *dest, bool splitting)
-{
-    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].header || !gameCardInfo.hfs0Partitions[partition].header_size || !progressCtx || !dest || !strlen(dest))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to copy HFS0 partition contents!", __func__);
-        breaks += 2;
-        return false;
-    }
-    
-    if (!gameCardInfo.hfs0Partitions[partition].file_cnt)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected HFS0 partition is empty!", __func__);
-        breaks += 2;
-        return false;
-    }
-    
-    Result result;
-    char dbuf[NAME_BUF_LEN * 2] = {'\0'};
-    hfs0_file_entry entry;
-    size_t dest_len = strlen(dest);
-    openIStoragePartition storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
-    
-    u32 i;
-    bool success = false;
-    
-    if ((dest_len + 1) >= MAX_CHARACTERS(dbuf))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: destination directory name is too long! (%lu bytes)", __func__, dest_len);
-        breaks += 2;
-        return false;
-    }
-    
-    snprintf(dbuf, MAX_CHARACTERS(dbuf), dest);
-    mkdir(dbuf, 0744);
-    
-    dbuf[dest_len] = '/';
-    dest_len++;
-    
-    result = openGameCardStoragePartition(storageIndex);
-    if (R_FAILED(result))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #%u! (0x%08X)", __func__, storageIndex - 1, result);
-        breaks += 2;
-        return false;
-    }
-    
-    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx->start));
-    
-    for(i = 0; i < gameCardInfo.hfs0Partitions[partition].file_cnt; i++)
-    {
-        memcpy(&entry, gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (i * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
-        
-        char *filename = (char*)(gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (gameCardInfo.hfs0Partitions[partition].file_cnt * sizeof(hfs0_file_entry)) + entry.filename_offset);
-        
-        dbuf[dest_len] = '\0';
-        strcat(dbuf, filename);
-        removeIllegalCharacters(dbuf + dest_len);
-        
-        u64 fileOffset = (gameCardInfo.hfs0Partitions[partition].offset + gameCardInfo.hfs0Partitions[partition].header_size + entry.file_offset);
-        
-        success = copyFileFromHfs0Partition(partition, dbuf, filename, fileOffset, entry.file_size, progressCtx, splitting);
-        if (!success) break;
-    }
-    
-    closeGameCardStoragePartition();
-    
-    return success;
-}
-
-bool dumpHfs0PartitionData(u32 partition, bool doSplitting)
-{
-    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].header)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to dump HFS0 partition data!", __func__);
-        breaks += 2;
-        return false;
-    }
-    
-    if (!gameCardInfo.hfs0Partitions[partition].file_cnt)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected HFS0 partition is empty!", __func__);
-        breaks += 2;
-        return false;
-    }
-    
-    u32 i;
-    hfs0_file_entry entry;
-    char dumpPath[NAME_BUF_LEN] = {'\0'};
-    
-    progress_ctx_t progressCtx;
-    memset(&progressCtx, 0, sizeof(progress_ctx_t));
-    
-    bool success = false;
-    
-    char *dumpName = generateGameCardDumpName(false);
-    if (!dumpName)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
-        breaks += 2;
-        return false;
-    }
-    
-    // Calculate total size
-    for(i = 0; i < gameCardInfo.hfs0Partitions[partition].file_cnt; i++)
-    {
-        memcpy(&entry, gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (i * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
-        progressCtx.totalSize += entry.file_size;
-    }
-    
-    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    if (outFile) fclose(outFile);
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Total partition data size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
-    breaks += 2;
+    if (!proceed || off < entry->dataSize) return false;
     
-    if (progressCtx.totalSize > freeSpace)
+    // Set archive bit (only for FAT32)
+    if (split)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-        goto out;
+        char *tmp = strrchr(output_path, '/');
+        if (tmp != NULL) *tmp = '\0';
+        fsdevSetConcatenationFileAttribute(output_path);
     }
     
-    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s)", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition));
+    if (manifestEntry)
+    {
+        sha256ContextGetHash(&data_ctx, data_hash);
+        layeredFsManifestUpdateEntry(manifestEntry, output_path, plan->basePathLen, data_hash);
+    }
     
-    // Start dump process
-    dumpStartMsg();
-    appletModeOperationWarning();
-    uiRefreshDisplay();
-    breaks++;
+    return true;
+}
+
+// Reads a single span of file data covering 'count' consecutive plan entries, then scatters it to the output files
+static bool extractRomFsFileSpan(romFsExtractPlan *plan, u32 startIndex, u32 count, u64 spanOffset, u64 spanSize, char *output_path, progress_ctx_t *progressCtx, bool usePatch, bool isFat32)
+{
+    u32 i;
+    u64 spanDataSize = 0;
+    bool proceed = true;
     
-    changeHomeButtonBlockStatus(true);
+    FILE *outFile = NULL;
+    size_t write_res;
+    u8 data_hash[SHA256_HASH_SIZE];
     
-    progressCtx.line_offset = (breaks + 4);
+    breaks = (progressCtx->line_offset + 2);
+    proceed = readRomFsFileData(usePatch, spanOffset, dumpBuf, spanSize);
+    breaks = (progressCtx->line_offset - 4);
     
-    success = copyHfs0PartitionContents(partition, &progressCtx, dumpPath, doSplitting);
+    if (!proceed) return false;
     
-    if (success)
+    for(i = startIndex; i < (startIndex + count); i++)
     {
-        breaks = (progressCtx.line_offset + 2);
+        romfs_file *entry = plan->files[i].entry;
+        u8 *data = (dumpBuf + (entry->dataOff - spanOffset));
         
-        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
-        progressCtx.now -= progressCtx.start;
+        spanDataSize += entry->dataSize;
         
-        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
-    } else {
-        removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
+        layeredfs_manifest_entry_t *manifestEntry = getRomFsExtractManifestEntry(plan, &(plan->files[i]));
+        if (manifestEntry)
+        {
+            sha256CalculateHash(data_hash, data, entry->dataSize);
+            
+            // Same data from a different NCA area (e.g. the base RomFS data got relocated by an update)
+            if ((manifestEntry->flags & LAYEREDFS_MANIFEST_FLAG_COMPARE) && !memcmp(manifestEntry->data_hash, data_hash, SHA256_HASH_SIZE))
+            {
+                manifestEntry->flags |= LAYEREDFS_MANIFEST_FLAG_UNCHANGED;
+                plan->manifest->unchanged_cnt++;
+                plan->manifest->unchanged_size += entry->dataSize;
+                
+                // Still needed by printRomFsExtractStatus()
+                generateRomFsExtractFilePath(&(plan->dirs[plan->files[i].dirIndex]), entry, output_path);
+                continue;
+            }
+        }
+        
+        outFile = openRomFsExtractFile(plan, &(plan->files[i]), output_path, isFat32, progressCtx);
+        if (!outFile) return false;
+        
+        write_res = dumpFileWrite(data, entry->dataSize, outFile);
+        
+        fclose(outFile);
+        outFile = NULL;
+        
+        if (write_res != entry->dataSize)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes to \"%s\"! (wrote %lu bytes)", __func__, entry->dataSize, output_path, write_res);
+            return false;
+        }
+        
+        if (manifestEntry) layeredFsManifestUpdateEntry(manifestEntry, output_path, plan->basePathLen, data_hash);
     }
     
-out:
-    free(dumpName);
+    // UI updates are only issued once per span - doing it per file would take longer than the actual copy for tiny files
+    printRomFsExtractStatus(plan, &(plan->files[startIndex + count - 1]), output_path, progressCtx);
     
-    breaks += 2;
+    printProgressBar(progressCtx, true, spanDataSize);
     
-    changeHomeButtonBlockStatus(false);
+    progressCtx->curOffset += spanDataSize;
     
-    return success;
+    return true;
 }
 
-bool dumpFileFromHfs0Partition(u32 partition, u32 fileIndex, char *filename, bool doSplitting)
+// RomFS extraction is done in two steps:
+// 1. The directory tree is walked to create all output directories and to collect a flat list of file entries, which is then sorted by data offset.
+// 2. File data is read in large spans (coalescing neighbouring small files, even across directories) and scattered to the output files.
+// This avoids issuing one NCA read per file, which is very slow for titles with lots of tiny files.
+// If a LayeredFS manifest is provided, files that didn't change since the previous extraction are dropped from the plan between both steps.
+bool extractRomFsDir(u32 dir_offset, char *romfs_path, char *output_path, progress_ctx_t *progressCtx, bool usePatch, bool dumpSiblingDir, bool isFat32, layeredfs_manifest_t *prevManifest, layeredfs_manifest_t *manifest)
 {
-    if (!gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !gameCardInfo.hfs0Partitions[partition].header || !gameCardInfo.hfs0Partitions[partition].header_size || !filename || !strlen(filename))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to dump file from HFS0 partition!", __func__);
-        breaks += 2;
-        return false;
-    }
-    
-    if (!gameCardInfo.hfs0Partitions[partition].file_cnt)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected HFS0 partition is empty!", __func__);
-        breaks += 2;
-        return false;
-    }
-    
-    if (fileIndex >= gameCardInfo.hfs0Partitions[partition].file_cnt)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid file index!", __func__);
-        breaks += 2;
-        return false;
-    }
-    
-    Result result;
-    hfs0_file_entry entry;
+    if (!romfs_path || !output_path || !progressCtx) return false;
     
-    progress_ctx_t progressCtx;
-    memset(&progressCtx, 0, sizeof(progress_ctx_t));
-    
-    u64 fileOffset = 0;
-    openIStoragePartition storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
+    romFsExtractPlan plan;
+    memset(&plan, 0, sizeof(romFsExtractPlan));
     
-    char destCopyPath[NAME_BUF_LEN * 2] = {'\0'};
+    plan.prevManifest = prevManifest;
+    plan.manifest = manifest;
+    plan.basePathLen = strlen(output_path);
     
-    bool success = false;
+    char cur_output_path[NAME_BUF_LEN * 2] = {'\0'};
     
-    char *dumpName = generateGameCardDumpName(false);
-    if (!dumpName)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
-        breaks += 2;
-        return false;
-    }
+    u32 i = 0, j;
+    bool success = false, fat32_error = false;
     
-    memcpy(&entry, gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (fileIndex * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
+    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
     
-    fileOffset = (gameCardInfo.hfs0Partitions[partition].offset + gameCardInfo.hfs0Partitions[partition].header_size + entry.file_offset);
+    printProgressStatus(progressCtx, PROGRESS_STATUS_UPPER, "Creating output directories...");
+    printProgressStatus(progressCtx, PROGRESS_STATUS_LOWER, NULL);
+    uiRefreshDisplay();
     
-    progressCtx.totalSize = entry.file_size;
-    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    if (!buildRomFsExtractPlan(&plan, dir_offset, romfs_path, output_path, progressCtx, usePatch, dumpSiblingDir)) goto out;
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "File size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
-    breaks += 2;
+    if (plan.fileCount > 1) qsort(plan.files, plan.fileCount, sizeof(romFsExtractFile), romFsExtractFileSortFunction);
     
-    if (progressCtx.totalSize > freeSpace)
+    if (plan.manifest)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-        goto out;
+        printProgressStatus(progressCtx, PROGRESS_STATUS_UPPER, "Checking LayeredFS manifest...");
+        uiRefreshDisplay();
+        
+        if (!checkRomFsExtractManifest(&plan, progressCtx, usePatch, isFat32)) goto out;
     }
     
-    snprintf(destCopyPath, MAX_CHARACTERS(destCopyPath), "%s%s - Partition %u (%s)", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition));
-    mkdir(destCopyPath, 0744);
-    
-    strcat(destCopyPath, "/");
-    size_t cur_len = strlen(destCopyPath);
-    strcat(destCopyPath, filename);
-    removeIllegalCharacters(destCopyPath + cur_len);
-    
-    // Check if the dump already exists
-    if (checkIfFileExists(destCopyPath))
+    while(i < plan.fileCount)
     {
-        // Ask the user if they want to proceed anyway
-        int cur_breaks = breaks;
+        romfs_file *entry = plan.files[i].entry;
         
-        if (!yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?"))
+        // Support empty files
+        if (!entry->dataSize)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            FILE *outFile = openRomFsExtractFile(&plan, &(plan.files[i]), cur_output_path, isFat32, progressCtx);
+            if (!outFile) goto out;
+            fclose(outFile);
+            
+            layeredfs_manifest_entry_t *manifestEntry = getRomFsExtractManifestEntry(&plan, &(plan.files[i]));
+            if (manifestEntry) layeredFsManifestUpdateEntry(manifestEntry, cur_output_path, plan.basePathLen, NULL);
+            
+            i++;
+            continue;
+        }
+        
+        if (entry->dataSize >= DUMP_BUFFER_SIZE)
+        {
+            if (!extractLargeRomFsFile(&plan, &(plan.files[i]), cur_output_path, progressCtx, usePatch, isFat32, &fat32_error)) goto out;
+            
+            i++;
+            continue;
+        }
+        
+        // Coalesce as many small files as possible into a single read
+        // Files sharing the same data (deduplicated by the RomFS builder) are covered by the same span
+        u64 spanOffset = entry->dataOff;
+        u64 spanEnd = (entry->dataOff + entry->dataSize);
+        
+        for(j = (i + 1); j < plan.fileCount; j++)
+        {
+            romfs_file *next_entry = plan.files[j].entry;
+            u64 next_end = (next_entry->dataOff + next_entry->dataSize);
+            
+            if (!next_entry->dataSize || next_entry->dataSize >= DUMP_BUFFER_SIZE) break;
+            if (next_entry->dataOff > spanEnd && (next_entry->dataOff - spanEnd) > ROMFS_EXTRACT_MAX_GAP) break;
+            if (next_end > spanEnd && (next_end - spanOffset) > DUMP_BUFFER_SIZE) break;
+            
+            if (next_end > spanEnd) spanEnd = next_end;
+        }
+        
+        if (!extractRomFsFileSpan(&plan, i, j - i, spanOffset, spanEnd - spanOffset, cur_output_path, progressCtx, usePatch, isFat32)) goto out;
+        
+        if (progressCtx->curOffset < progressCtx->totalSize && cancelProcessCheck(progressCtx))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
             goto out;
-        } else {
-            // Remove the prompt from the screen
-            breaks = cur_breaks;
-            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
         }
+        
+        i = j;
     }
     
-    result = openGameCardStoragePartition(storageIndex);
-    if (R_FAILED(result))
+    if (progressCtx->totalSize == progressCtx->curOffset)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #%u! (0x%08X)", __func__, storageIndex - 1, result);
-        goto out;
+        progressCtx->progress = 100;
+        printProgressBar(progressCtx, false, 0);
     }
     
-    // Start dump process
-    dumpStartMsg();
-    appletModeOperationWarning();
-    uiRefreshDisplay();
-    breaks++;
-    
-    changeHomeButtonBlockStatus(true);
-    
-    progressCtx.line_offset = (breaks + 4);
-    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
-    
-    success = copyFileFromHfs0Partition(partition, destCopyPath, filename, fileOffset, progressCtx.totalSize, &progressCtx, doSplitting);
+    success = true;
     
-    closeGameCardStoragePartition();
+out:
+    freeRomFsExtractPlan(&plan);
     
-    if (success)
+    if (!success)
     {
-        breaks = (progressCtx.line_offset + 2);
-        
-        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
-        progressCtx.now -= progressCtx.start;
-        
-        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
-    } else {
-        breaks -= 2;
+        breaks = (progressCtx->line_offset + 2);
+        if (fat32_error) breaks += 2;
     }
     
-out:
-    free(dumpName);
-    
-    breaks += 2;
-    
-    changeHomeButtonBlockStatus(false);
-    
     return success;
 }
 
-bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDumpCfg)
+bool dumpRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg)
 {
-    if (!exeFsDumpCfg)
+    if (!romFsDumpCfg)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ExeFS configuration struct!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid RomFS configuration struct!", __func__);
         breaks += 2;
         return false;
     }
     
-    bool isFat32 = exeFsDumpCfg->isFat32;
-    bool useLayeredFSDir = exeFsDumpCfg->useLayeredFSDir;
+    bool isFat32 = romFsDumpCfg->isFat32;
+    bool useLayeredFSDir = romFsDumpCfg->useLayeredFSDir;
     
-    u32 i;
-    u64 n = 0, offset = 0;
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
-    size_t write_res;
-    bool proceed = true, success = false, fat32_error = false;
+    progress_ctx_t progressCtx;
+    memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
-    char tmp_idx[5] = {'\0'};
     char *dumpName = NULL;
-    char dumpPath[NAME_BUF_LEN] = {'\0'}, curDumpPath[NAME_BUF_LEN * 2] = {'\0'};
+    char romFsPath[NAME_BUF_LEN * 2] = {'\0'}, dumpPath[NAME_BUF_LEN * 2] = {'\0'}, manifestPath[NAME_BUF_LEN * 2] = {'\0'};
     
-    progress_ctx_t progressCtx;
-    memset(&progressCtx, 0, sizeof(progress_ctx_t));
+    layeredfs_manifest_t prevManifest, manifest;
+    memset(&prevManifest, 0, sizeof(layeredfs_manifest_t));
+    memset(&manifest, 0, sizeof(layeredfs_manifest_t));
     
-    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    u32 i, keptCnt = 0;
+    u64 reusableSize = 0;
+    bool success = false, incremental = false;
     
-    if ((!usePatch && !titleAppCount) || (usePatch && !titlePatchCount))
+    if ((curRomFsType == ROMFS_TYPE_APP && !titleAppCount) || (curRomFsType == ROMFS_TYPE_PATCH && !titlePatchCount) || (curRomFsType == ROMFS_TYPE_ADDON && !titleAddOnCount))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title count!", __func__);
         breaks += 2;
         return false;
     }
     
-    if ((!usePatch && titleIndex > (titleAppCount - 1)) || (usePatch && titleIndex > (titlePatchCount - 1)))
+    if ((curRomFsType == ROMFS_TYPE_APP && titleIndex > (titleAppCount - 1)) || (curRomFsType == ROMFS_TYPE_PATCH && titleIndex > (titlePatchCount - 1)) || (curRomFsType == ROMFS_TYPE_ADDON && titleIndex > (titleAddOnCount - 1)))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title index!", __func__);
         breaks += 2;
@@ -3737,7 +7043,7 @@ bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDump
     
     if (!useLayeredFSDir)
     {
-        dumpName = generateNSPDumpName((!usePatch ? DUMP_APP_NSP : DUMP_PATCH_NSP), titleIndex, false);
+        dumpName = generateNSPDumpName((curRomFsType == ROMFS_TYPE_APP ? DUMP_APP_NSP : (curRomFsType == ROMFS_TYPE_PATCH ? DUMP_PATCH_NSP : DUMP_ADDON_NSP)), titleIndex, false);
         if (!dumpName)
         {
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
@@ -3746,46 +7052,70 @@ bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDump
         }
     }
     
-    // Retrieve ExeFS from Program NCA
-    if (!readNcaExeFsSection(titleIndex, usePatch))
+    // Retrieve RomFS from Program NCA
+    if (readNcaRomFsSection(titleIndex, curRomFsType, -1) != 0)
     {
-        if (dumpName) free(dumpName);
+        free(dumpName);
         breaks += 2;
         return false;
     }
     
     // Calculate total dump size
-    if (!calculateExeFsExtractedDataSize(&(progressCtx.totalSize))) goto out;
+    if (!calculateRomFsFullExtractedSize((curRomFsType == ROMFS_TYPE_PATCH), &(progressCtx.totalSize))) goto out;
     
     convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Extracted ExeFS dump size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Extracted RomFS dump size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
     uiRefreshDisplay();
     breaks++;
     
-    if (progressCtx.totalSize > freeSpace)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-        goto out;
-    }
-    
     // Generate output path
     if (!useLayeredFSDir)
     {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", EXEFS_DUMP_PATH, dumpName);
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", ROMFS_DUMP_PATH, dumpName);
         
-        if (exeFsContext.idOffset > 0)
+        if ((curRomFsType != ROMFS_TYPE_PATCH && romFsContext.idOffset > 0) || (curRomFsType == ROMFS_TYPE_PATCH && bktrContext.idOffset > 0))
         {
-            sprintf(strbuf, " (ID offset #%u)", exeFsContext.idOffset);
+            sprintf(strbuf, " (ID offset #%u)", (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset));
             strcat(dumpPath, strbuf);
         }
     } else {
+        // Base applications and updates: always use the base application title ID
+        // DLCs: use DLC title ID
+        u64 titleId = (curRomFsType == ROMFS_TYPE_APP ? baseAppEntries[titleIndex].titleId : (curRomFsType == ROMFS_TYPE_PATCH ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : addOnEntries[titleIndex].titleId));
+        titleId += (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset);
+        
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX/romfs", cfwDirStr, titleId);
+        
+        // Refresh a previous extraction to the same LayeredFS directory
+        layeredFsManifestGetPath(dumpPath, LAYEREDFS_ROMFS_MANIFEST_NAME, manifestPath, MAX_CHARACTERS(manifestPath));
+        incremental = layeredFsManifestLoad(&prevManifest, manifestPath);
+        
+        if (incremental)
+        {
+            // Files from the previous extraction are overwritten in place
+            for(i = 0; i < prevManifest.entry_cnt; i++) reusableSize += prevManifest.entries[i].size;
+            
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Previous extraction found. Only modified files will be written.");
+            uiRefreshDisplay();
+            breaks++;
+        }
+    }
+    
+    if (progressCtx.totalSize > (freeSpace + reusableSize))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+        goto out;
+    }
+    
+    // Create output directories
+    if (useLayeredFSDir)
+    {
         mkdir(cfwDirStr, 0744);
         
-        // Always use the base application title ID
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, (usePatch ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : baseAppEntries[titleIndex].titleId) + exeFsContext.idOffset);
+        char *tmp = strrchr(dumpPath, '/');
+        *tmp = '\0';
         mkdir(dumpPath, 0744);
-        
-        strcat(dumpPath, "/exefs");
+        *tmp = '/';
     }
     
     mkdir(dumpPath, 0744);
@@ -3793,6 +7123,7 @@ bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDump
     // Start dump process
     breaks++;
     dumpStartMsg();
+    perfStart();
     appletModeOperationWarning();
     uiRefreshDisplay();
     breaks++;
@@ -3802,184 +7133,58 @@ bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDump
     progressCtx.line_offset = (breaks + 4);
     timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
     
-    for(i = 0; i < exeFsContext.exefs_header.file_cnt; i++)
+    progressUiThreadStart(&progressCtx);
+    
+    success = extractRomFsDir(0, romFsPath, dumpPath, &progressCtx, (curRomFsType == ROMFS_TYPE_PATCH), true, isFat32, (useLayeredFSDir ? &prevManifest : NULL), (useLayeredFSDir ? &manifest : NULL));
+    
+    progressUiThreadStop(&progressCtx);
+    
+    if (success)
     {
-        n = DUMP_BUFFER_SIZE;
-        outFile = NULL;
-        splitIndex = 0;
-        
-        char *exeFsFilename = (exeFsContext.exefs_str_table + exeFsContext.exefs_entries[i].filename_offset);
-        
-        // Check if we're dealing with a nameless file
-        if (!strlen(exeFsFilename))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: file entry without name in ExeFS section!", __func__);
-            break;
-        }
-        
-        snprintf(curDumpPath, MAX_CHARACTERS(curDumpPath), "%s/%s", dumpPath, exeFsFilename);
-        removeIllegalCharacters(curDumpPath + strlen(dumpPath) + 1);
-        
-        if (exeFsContext.exefs_entries[i].file_size > FAT32_FILESIZE_LIMIT && isFat32)
-        {
-            mkdir(curDumpPath, 0744);
-            sprintf(tmp_idx, "/%02u", splitIndex);
-            strcat(curDumpPath, tmp_idx);
-        }
+        breaks = (progressCtx.line_offset + 2);
         
-        outFile = fopen(curDumpPath, "wb");
-        if (!outFile)
+        if (useLayeredFSDir)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, curDumpPath);
-            break;
+            // Files removed by an update would still be picked up by LayeredFS
+            layeredFsManifestSort(&manifest);
+            keptCnt = layeredFsManifestDeleteStale(&prevManifest, &manifest, dumpPath, isFat32);
+            layeredFsManifestSave(&manifest, manifestPath);
         }
         
-        uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
         
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Copying \"%s\"...", exeFsFilename);
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
         
-        for(offset = 0; offset < exeFsContext.exefs_entries[i].file_size; offset += n, progressCtx.curOffset += n)
+        if (manifest.unchanged_cnt)
         {
-            uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-            
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(curDumpPath, '/') + 1);
-            
-            uiRefreshDisplay();
-            
-            if (n > (exeFsContext.exefs_entries[i].file_size - offset)) n = (exeFsContext.exefs_entries[i].file_size - offset);
-            
-            breaks = (progressCtx.line_offset + 2);
-            proceed = processNcaCtrSectionBlock(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), exeFsContext.exefs_data_offset + exeFsContext.exefs_entries[i].file_offset + offset, dumpBuf, n, false);
-            breaks = (progressCtx.line_offset - 4);
-            
-            if (!proceed) break;
-            
-            if (exeFsContext.exefs_entries[i].file_size > FAT32_FILESIZE_LIMIT && isFat32 && (offset + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
-            {
-                u64 new_file_chunk_size = ((offset + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
-                u64 old_file_chunk_size = (n - new_file_chunk_size);
-                
-                if (old_file_chunk_size > 0)
-                {
-                    write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                    if (write_res != old_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, offset, splitIndex, write_res);
-                        proceed = false;
-                        break;
-                    }
-                }
-                
-                fclose(outFile);
-                outFile = NULL;
-                
-                if (new_file_chunk_size > 0 || (offset + n) < exeFsContext.exefs_entries[i].file_size)
-                {
-                    char *tmp = strrchr(curDumpPath, '/');
-                    if (tmp != NULL) *tmp = '\0';
-                    
-                    splitIndex++;
-                    sprintf(tmp_idx, "/%02u", splitIndex);
-                    strcat(curDumpPath, tmp_idx);
-                    
-                    outFile = fopen(curDumpPath, "wb");
-                    if (!outFile)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                        proceed = false;
-                        break;
-                    }
-                    
-                    if (new_file_chunk_size > 0)
-                    {
-                        write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                        if (write_res != new_file_chunk_size)
-                        {
-                            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, offset + old_file_chunk_size, splitIndex, write_res);
-                            proceed = false;
-                            break;
-                        }
-                    }
-                }
-            } else {
-                write_res = fwrite(dumpBuf, 1, n, outFile);
-                if (write_res != n)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, offset, write_res);
-                    
-                    if ((offset + n) > FAT32_FILESIZE_LIMIT)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
-                        fat32_error = true;
-                    }
-                    
-                    proceed = false;
-                    break;
-                }
-            }
-            
-            printProgressBar(&progressCtx, true, n);
-            
-            if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
-                proceed = false;
-                break;
-            }
+            breaks++;
+            convertSize(manifest.unchanged_size, strbuf, MAX_CHARACTERS(strbuf));
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%u unchanged file(s) didn't have to be written again (%s).", manifest.unchanged_cnt, strbuf);
         }
         
-        if (outFile) fclose(outFile);
-        
-        if (!proceed) break;
-        
-        // Support empty files
-        if (!exeFsContext.exefs_entries[i].file_size)
+        if (keptCnt)
         {
-            uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-            
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(curDumpPath, '/') + 1);
-            
-            if (progressCtx.totalSize == exeFsContext.exefs_entries[i].file_size) progressCtx.progress = 100;
-            
-            printProgressBar(&progressCtx, false, 0);
+            breaks++;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%u file(s) no longer part of the RomFS were kept, since they were modified after the previous extraction.", keptCnt);
         }
+    } else {
+        setProgressBarError(&progressCtx);
         
-        // Set archive bit (only for FAT32)
-        if (exeFsContext.exefs_entries[i].file_size > FAT32_FILESIZE_LIMIT && isFat32)
-        {
-            char *tmp = strrchr(curDumpPath, '/');
-            if (tmp != NULL) *tmp = '\0';
-            fsdevSetConcatenationFileAttribute(curDumpPath);
-        }
+        // Every file written so far has a newer timestamp than the one stored in the previous manifest, so keeping it around is safe
+        if (!incremental) removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
     }
     
-    if (proceed)
-    {
-        if (progressCtx.curOffset >= progressCtx.totalSize)
-        {
-            success = true;
-        } else {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: underdump error! Wrote %lu bytes, expected %lu bytes.", __func__, progressCtx.curOffset, progressCtx.totalSize);
-        }
-    }
+out:
+    layeredFsManifestFree(&prevManifest);
+    layeredFsManifestFree(&manifest);
     
-    breaks = (progressCtx.line_offset + 2);
+    perfStop("RomFS", dumpName, progressCtx.totalSize, success);
     
-    if (success)
-    {
-        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
-        progressCtx.now -= progressCtx.start;
-        
-        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
-    } else {
-        setProgressBarError(&progressCtx);
-        if (fat32_error) breaks += 2;
-        removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
-    }
+    if (curRomFsType == ROMFS_TYPE_PATCH) freeBktrContext();
     
-out:
-    freeExeFsContext();
+    freeRomFsContext();
     
     if (dumpName) free(dumpName);
     
@@ -3990,21 +7195,21 @@ out:
     return success;
 }
 
-bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaFsOptions *exeFsDumpCfg)
+bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg)
 {
-    if (!exeFsDumpCfg)
+    if (!romFsDumpCfg)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ExeFS configuration struct!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid RomFS configuration struct!", __func__);
         breaks += 2;
         return false;
     }
     
-    bool isFat32 = exeFsDumpCfg->isFat32;
-    bool useLayeredFSDir = exeFsDumpCfg->useLayeredFSDir;
+    bool isFat32 = romFsDumpCfg->isFat32;
+    bool useLayeredFSDir = romFsDumpCfg->useLayeredFSDir;
     
-    if (!exeFsContext.exefs_header.file_cnt || fileIndex > (exeFsContext.exefs_header.file_cnt - 1) || !exeFsContext.exefs_entries || !exeFsContext.exefs_str_table || exeFsContext.exefs_data_offset <= exeFsContext.exefs_offset || (!usePatch && titleIndex > (titleAppCount - 1)) || (usePatch && titleIndex > (titlePatchCount - 1)))
+    if ((curRomFsType != ROMFS_TYPE_PATCH && (!romFsContext.romfs_filetable_size || file_offset > romFsContext.romfs_filetable_size || !romFsContext.romfs_file_entries)) || (curRomFsType == ROMFS_TYPE_PATCH && (!bktrContext.romfs_filetable_size || file_offset > bktrContext.romfs_filetable_size || !bktrContext.romfs_file_entries)) || (curRomFsType == ROMFS_TYPE_APP && titleIndex > (titleAppCount - 1)) || (curRomFsType == ROMFS_TYPE_PATCH && titleIndex > (titlePatchCount - 1)) || (curRomFsType == ROMFS_TYPE_ADDON && titleIndex > (titleAddOnCount - 1)))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse file entry from ExeFS section!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse file entry from RomFS section!", __func__);
         breaks += 2;
         return false;
     }
@@ -4017,27 +7222,42 @@ bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaF
     
     char tmp_idx[5];
     char *dumpName = NULL;
-    char dumpPath[NAME_BUF_LEN] = {'\0'};
+    char dumpPath[NAME_BUF_LEN * 2] = {'\0'};
     
     progress_ctx_t progressCtx;
     memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
     memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
     
-    char *exeFsFilename = (exeFsContext.exefs_str_table + exeFsContext.exefs_entries[fileIndex].filename_offset);
+    romfs_file *entry = (curRomFsType != ROMFS_TYPE_PATCH ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + file_offset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + file_offset));
     
     // Check if we're dealing with a nameless file
-    if (!strlen(exeFsFilename))
+    if (!entry->nameLen)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: file entry without name in ExeFS section!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: file entry without name in RomFS section!", __func__);
+        breaks += 2;
+        return false;
+    }
+    
+    progressCtx.totalSize = entry->dataSize;
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "File size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    breaks++;
+    
+    if (progressCtx.totalSize > freeSpace)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
         breaks += 2;
         return false;
     }
     
+    breaks++;
+    
     // Generate output path
     if (!useLayeredFSDir)
     {
-        dumpName = generateNSPDumpName((!usePatch ? DUMP_APP_NSP : DUMP_PATCH_NSP), titleIndex, false);
+        dumpName = generateNSPDumpName((curRomFsType == ROMFS_TYPE_APP ? DUMP_APP_NSP : (curRomFsType == ROMFS_TYPE_PATCH ? DUMP_PATCH_NSP : DUMP_ADDON_NSP)), titleIndex, false);
         if (!dumpName)
         {
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
@@ -4045,43 +7265,66 @@ bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaF
             return false;
         }
         
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", EXEFS_DUMP_PATH, dumpName);
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", ROMFS_DUMP_PATH, dumpName);
         
-        if (exeFsContext.idOffset > 0)
+        if ((curRomFsType != ROMFS_TYPE_PATCH && romFsContext.idOffset > 0) || (curRomFsType == ROMFS_TYPE_PATCH && bktrContext.idOffset > 0))
         {
-            sprintf(strbuf, " (ID offset #%u)", exeFsContext.idOffset);
+            sprintf(strbuf, " (ID offset #%u)", (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset));
             strcat(dumpPath, strbuf);
         }
     } else {
         mkdir(cfwDirStr, 0744);
         
-        // Always use the base application title ID
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, (usePatch ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : baseAppEntries[titleIndex].titleId) + + exeFsContext.idOffset);
+        // Base applications and updates: always use the base application title ID
+        // DLCs: use DLC title ID
+        u64 titleId = (curRomFsType == ROMFS_TYPE_APP ? baseAppEntries[titleIndex].titleId : (curRomFsType == ROMFS_TYPE_PATCH ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : addOnEntries[titleIndex].titleId));
+        titleId += (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset);
+        
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, titleId);
         mkdir(dumpPath, 0744);
         
-        strcat(dumpPath, "/exefs");
+        strcat(dumpPath, "/romfs");
     }
     
     mkdir(dumpPath, 0744);
     
-    strcat(dumpPath, "/");
-    size_t cur_len = strlen(dumpPath);
-    strcat(dumpPath, exeFsFilename);
-    removeIllegalCharacters(dumpPath + cur_len);
-    
-    progressCtx.totalSize = exeFsContext.exefs_entries[fileIndex].file_size;
-    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    // Create subdirectories
+    char *tmp1 = NULL, *tmp2 = NULL;
+    size_t cur_len;
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "File size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
-    breaks++;
+    tmp1 = strchr(curRomFsPath, '/');
     
-    if (progressCtx.totalSize > freeSpace)
+    while(tmp1 != NULL)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-        goto out;
+        tmp1++;
+        
+        if (!strlen(tmp1)) break;
+        
+        strcat(dumpPath, "/");
+        
+        cur_len = strlen(dumpPath);
+        
+        tmp2 = strchr(tmp1, '/');
+        if (tmp2 != NULL)
+        {
+            strncat(dumpPath, tmp1, tmp2 - tmp1);
+            
+            tmp1 = tmp2;
+        } else {
+            strcat(dumpPath, tmp1);
+            
+            tmp1 = NULL;
+        }
+        
+        removeIllegalCharacters(dumpPath + cur_len);
+        
+        mkdir(dumpPath, 0744);
     }
     
-    breaks++;
+    strcat(dumpPath, "/");
+    cur_len = strlen(dumpPath);
+    strncat(dumpPath, (char*)entry->name, entry->nameLen);
+    removeIllegalCharacters(dumpPath + cur_len);
     
     // Check if the dump already exists
     if (checkIfFileExists(dumpPath))
@@ -4116,39 +7359,49 @@ bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaF
     
     // Start dump process
     dumpStartMsg();
+    perfStart();
     appletModeOperationWarning();
     uiRefreshDisplay();
     breaks++;
     
     changeHomeButtonBlockStatus(true);
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Copying \"%s\"...", exeFsFilename);
-    breaks += 2;
+    if (strlen(curRomFsPath) > 1)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Copying \"romfs:%s/%.*s\"...", curRomFsPath, entry->nameLen, entry->name);
+    } else {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Copying \"romfs:/%.*s\"...", entry->nameLen, entry->name);
+    }
     
-    uiRefreshDisplay();
+    breaks += 2;
     
     outFile = fopen(dumpPath, "wb");
     if (!outFile)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
         goto out;
     }
     
     progressCtx.line_offset = (breaks + 2);
     timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
     
+    progressUiThreadStart(&progressCtx);
+    
     for(progressCtx.curOffset = 0; progressCtx.curOffset < progressCtx.totalSize; progressCtx.curOffset += n)
     {
-        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/') + 1);
-        
-        uiRefreshDisplay();
+        printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "Output file: \"%s\".", strrchr(dumpPath, '/') + 1);
         
         if (n > (progressCtx.totalSize - progressCtx.curOffset)) n = (progressCtx.totalSize - progressCtx.curOffset);
         
         breaks = (progressCtx.line_offset + 2);
-        proceed = processNcaCtrSectionBlock(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), exeFsContext.exefs_data_offset + exeFsContext.exefs_entries[fileIndex].file_offset + progressCtx.curOffset, dumpBuf, n, false);
+        
+        if (curRomFsType != ROMFS_TYPE_PATCH)
+        {
+            proceed = processNcaCtrSectionBlock(&(romFsContext.ncmStorage), &(romFsContext.ncaId), &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + entry->dataOff + progressCtx.curOffset, dumpBuf, n, false);
+        } else {
+            proceed = readBktrSectionBlock(bktrContext.romfs_filedata_offset + entry->dataOff + progressCtx.curOffset, dumpBuf, n);
+        }
+        
         breaks = (progressCtx.line_offset - 2);
         
         if (!proceed) break;
@@ -4160,7 +7413,7 @@ bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaF
             
             if (old_file_chunk_size > 0)
             {
-                write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
+                write_res = dumpFileWrite(dumpBuf, old_file_chunk_size, outFile);
                 if (write_res != old_file_chunk_size)
                 {
                     uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, progressCtx.curOffset, splitIndex, write_res);
@@ -4189,413 +7442,98 @@ bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaF
                 
                 if (new_file_chunk_size > 0)
                 {
-                    write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
+                    write_res = dumpFileWrite(dumpBuf + old_file_chunk_size, new_file_chunk_size, outFile);
                     if (write_res != new_file_chunk_size)
                     {
                         uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, progressCtx.curOffset + old_file_chunk_size, splitIndex, write_res);
-                        break;
-                    }
-                }
-            }
-        } else {
-            write_res = fwrite(dumpBuf, 1, n, outFile);
-            if (write_res != n)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
-                
-                if ((progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
-                    fat32_error = true;
-                }
-                
-                break;
-            }
-        }
-        
-        printProgressBar(&progressCtx, true, n);
-        
-        if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
-            break;
-        }
-    }
-    
-    if (progressCtx.curOffset >= progressCtx.totalSize) success = true;
-    
-    // Support empty files
-    if (!progressCtx.totalSize)
-    {
-        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/') + 1);
-        
-        progressCtx.progress = 100;
-        
-        printProgressBar(&progressCtx, false, 0);
-    }
-    
-    breaks = (progressCtx.line_offset + 2);
-    
-    if (success)
-    {
-        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
-        progressCtx.now -= progressCtx.start;
-        
-        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
-    } else {
-        setProgressBarError(&progressCtx);
-        if (fat32_error) breaks += 2;
-    }
-    
-out:
-    if (outFile) fclose(outFile);
-    
-    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
-    {
-        char *tmp = strrchr(dumpPath, '/');
-        if (tmp != NULL) *tmp = '\0';
-        
-        if (success)
-        {
-            // Set archive bit (only for FAT32)
-            fsdevSetConcatenationFileAttribute(dumpPath);
-        } else {
-            if (removeFile) fsdevDeleteDirectoryRecursively(dumpPath);
-        }
-    } else {
-        if (!success && removeFile) remove(dumpPath);
-    }
-    
-    if (dumpName) free(dumpName);
-    
-    breaks += 2;
-    
-    changeHomeButtonBlockStatus(false);
-    
-    return success;
-}
-
-bool recursiveDumpRomFsFile(u32 file_offset, char *romfs_path, char *output_path, progress_ctx_t *progressCtx, bool usePatch, bool isFat32)
-{
-    if ((!usePatch && (!romFsContext.romfs_filetable_size || file_offset > romFsContext.romfs_filetable_size || !romFsContext.romfs_file_entries)) || (usePatch && (!bktrContext.romfs_filetable_size || file_offset > bktrContext.romfs_filetable_size || !bktrContext.romfs_file_entries)) || !romfs_path || !output_path || !progressCtx)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse file entry from RomFS section!", __func__);
-        return false;
-    }
-    
-    size_t orig_romfs_path_len = strlen(romfs_path);
-    size_t orig_output_path_len = strlen(output_path);
-    
-    u64 n = DUMP_BUFFER_SIZE;
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
-    bool proceed = true, success = false, fat32_error = false;
-    
-    // Used to overcome issues related to the max entry count per directory in FAT32
-    int dir_limit_counter = -1;
-    
-    u32 romfs_file_offset = file_offset;
-    romfs_file *entry = NULL;
-    
-    u64 off = 0;
-    
-    size_t write_res;
-    
-    char tmp_idx[16];
-    
-    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
-    
-    while(romfs_file_offset != ROMFS_ENTRY_EMPTY)
-    {
-        romfs_path[orig_romfs_path_len] = '\0';
-        output_path[orig_output_path_len] = '\0';
-        
-        n = DUMP_BUFFER_SIZE;
-        splitIndex = 0;
-        
-        entry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + romfs_file_offset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + romfs_file_offset));
-        
-        // Check if we're dealing with a nameless file
-        if (!entry->nameLen)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: file entry without name in RomFS section!", __func__);
-            break;
-        }
-        
-        if (dir_limit_counter >= 0)
-        {
-            sprintf(tmp_idx, "_%d", dir_limit_counter);
-        } else {
-            tmp_idx[0] = '\0';
-        }
-        
-        if ((orig_romfs_path_len + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2) || (orig_output_path_len + strlen(tmp_idx) + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: RomFS section file path is too long!", __func__);
-            break;
-        }
-        
-        // Generate current path
-        strcat(romfs_path, "/");
-        strncat(romfs_path, (char*)entry->name, entry->nameLen);
-        
-        if (dir_limit_counter >= 0) strcat(output_path, tmp_idx);
-        strcat(output_path, "/");
-        strncat(output_path, (char*)entry->name, entry->nameLen);
-        removeIllegalCharacters(output_path + orig_output_path_len + strlen(tmp_idx) + 1);
-        
-        if (entry->dataSize > FAT32_FILESIZE_LIMIT && isFat32)
-        {
-            mkdir(output_path, 0744);
-            sprintf(tmp_idx, "/%02u", splitIndex);
-            strcat(output_path, tmp_idx);
-        }
-        
-        // Start dump process
-        uiFill(0, ((progressCtx->line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 4), FONT_COLOR_RGB, "Copying \"romfs:%s\"...", romfs_path);
-        
-        outFile = fopen(output_path, "wb");
-        if (!outFile)
-        {
-            if (entry->dataSize <= FAT32_FILESIZE_LIMIT || !isFat32)
-            {
-                output_path[orig_output_path_len] = '\0';
-                
-                dir_limit_counter++;
-                sprintf(tmp_idx, "_%d", dir_limit_counter);
-                strcat(output_path, tmp_idx);
-                mkdir(output_path, 0744);
-                
-                strcat(output_path, "/");
-                strncat(output_path, (char*)entry->name, entry->nameLen);
-                removeIllegalCharacters(output_path + orig_output_path_len + strlen(tmp_idx) + 1);
-                
-                outFile = fopen(output_path, "wb");
-            }
-            
-            if (!outFile)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, output_path);
-                break;
-            }
-        }
-        
-        for(off = 0; off < entry->dataSize; off += n, progressCtx->curOffset += n)
-        {
-            uiFill(0, ((progressCtx->line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-            
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(output_path, '/') + 1);
-            
-            uiRefreshDisplay();
-            
-            if (n > (entry->dataSize - off)) n = (entry->dataSize - off);
-            
-            breaks = (progressCtx->line_offset + 2);
-            
-            if (!usePatch)
-            {
-                proceed = processNcaCtrSectionBlock(&(romFsContext.ncmStorage), &(romFsContext.ncaId), &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + entry->dataOff + off, dumpBuf, n, false);
-            } else {
-                proceed = readBktrSectionBlock(bktrContext.romfs_filedata_offset + entry->dataOff + off, dumpBuf, n);
-            }
-            
-            breaks = (progressCtx->line_offset - 4);
-            
-            if (!proceed) break;
-            
-            if (entry->dataSize > FAT32_FILESIZE_LIMIT && isFat32 && (off + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
-            {
-                u64 new_file_chunk_size = ((off + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
-                u64 old_file_chunk_size = (n - new_file_chunk_size);
-                
-                if (old_file_chunk_size > 0)
-                {
-                    write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                    if (write_res != old_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, off, splitIndex, write_res);
-                        proceed = false;
-                        break;
-                    }
-                }
-                
-                fclose(outFile);
-                outFile = NULL;
-                
-                if (new_file_chunk_size > 0 || (off + n) < entry->dataSize)
-                {
-                    char *tmp = strrchr(output_path, '/');
-                    if (tmp != NULL) *tmp = '\0';
-                    
-                    splitIndex++;
-                    sprintf(tmp_idx, "/%02u", splitIndex);
-                    strcat(output_path, tmp_idx);
-                    
-                    outFile = fopen(output_path, "wb");
-                    if (!outFile)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                        proceed = false;
-                        break;
-                    }
-                    
-                    if (new_file_chunk_size > 0)
-                    {
-                        write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                        if (write_res != new_file_chunk_size)
-                        {
-                            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, off + old_file_chunk_size, splitIndex, write_res);
-                            proceed = false;
-                            break;
-                        }
-                    }
-                }
-            } else {
-                write_res = fwrite(dumpBuf, 1, n, outFile);
-                if (write_res != n)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, off, write_res);
-                    
-                    if ((off + n) > FAT32_FILESIZE_LIMIT)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
-                        fat32_error = true;
-                    }
-                    
-                    proceed = false;
-                    break;
+                        break;
+                    }
                 }
             }
-            
-            printProgressBar(progressCtx, true, n);
-            
-            if (((off + n) < entry->dataSize || (progressCtx->curOffset + n) < progressCtx->totalSize) && cancelProcessCheck(progressCtx))
+        } else {
+            write_res = dumpFileWrite(dumpBuf, n, outFile);
+            if (write_res != n)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
-                proceed = false;
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
+                
+                if ((progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
+                    fat32_error = true;
+                }
+                
                 break;
             }
         }
         
-        if (outFile)
-        {
-            fclose(outFile);
-            outFile = NULL;
-        }
-        
-        if (!proceed || off < entry->dataSize) break;
-        
-        // Support empty files
-        if (!entry->dataSize)
-        {
-            uiFill(0, ((progressCtx->line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-            
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(output_path, '/') + 1);
-            
-            if (progressCtx->totalSize == entry->dataSize) progressCtx->progress = 100;
-            
-            printProgressBar(progressCtx, false, 0);
-        }
+        printProgressBar(&progressCtx, true, n);
         
-        // Set archive bit (only for FAT32)
-        if (entry->dataSize > FAT32_FILESIZE_LIMIT && isFat32)
+        if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
         {
-            char *tmp = strrchr(output_path, '/');
-            if (tmp != NULL) *tmp = '\0';
-            fsdevSetConcatenationFileAttribute(output_path);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            break;
         }
-        
-        romfs_file_offset = entry->sibling;
-        if (romfs_file_offset == ROMFS_ENTRY_EMPTY) success = true;
-    }
-    
-    if (!success)
-    {
-        breaks = (progressCtx->line_offset + 2);
-        if (fat32_error) breaks += 2;
     }
     
-    romfs_path[orig_romfs_path_len] = '\0';
-    output_path[orig_output_path_len] = '\0';
+    if (progressCtx.curOffset >= progressCtx.totalSize) success = true;
     
-    return success;
-}
-
-bool recursiveDumpRomFsDir(u32 dir_offset, char *romfs_path, char *output_path, progress_ctx_t *progressCtx, bool usePatch, bool dumpSiblingDir, bool isFat32)
-{
-    if ((!usePatch && (!romFsContext.romfs_dirtable_size || dir_offset > romFsContext.romfs_dirtable_size || !romFsContext.romfs_dir_entries || !romFsContext.romfs_filetable_size || !romFsContext.romfs_file_entries)) || (usePatch && (!bktrContext.romfs_dirtable_size || dir_offset > bktrContext.romfs_dirtable_size || !bktrContext.romfs_dir_entries || !bktrContext.romfs_filetable_size || !bktrContext.romfs_file_entries)) || !romfs_path || !output_path || !progressCtx)
+    // Support empty files
+    if (!progressCtx.totalSize)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse directory entry from RomFS section!", __func__);
-        return false;
+        printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "Output file: \"%s\".", strrchr(dumpPath, '/') + 1);
+        
+        progressCtx.progress = 100;
+        
+        printProgressBar(&progressCtx, false, 0);
     }
     
-    size_t orig_romfs_path_len = strlen(romfs_path);
-    size_t orig_output_path_len = strlen(output_path);
+    progressUiThreadStop(&progressCtx);
     
-    romfs_dir *entry = (!usePatch ? (romfs_dir*)((u8*)romFsContext.romfs_dir_entries + dir_offset) : (romfs_dir*)((u8*)bktrContext.romfs_dir_entries + dir_offset));
+    breaks = (progressCtx.line_offset + 2);
     
-    // Check if we're dealing with a nameless directory that's not the root directory
-    if (!entry->nameLen && dir_offset > 0)
+    if (success)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: directory entry without name in RomFS section!", __func__);
-        return false;
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
+        
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
+    } else {
+        setProgressBarError(&progressCtx);
+        if (fat32_error) breaks += 2;
     }
     
-    if ((orig_romfs_path_len + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2) || (orig_output_path_len + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: RomFS section directory path is too long!", __func__);
-        return false;
-    }
+out:
+    perfStop("RomFS file", dumpName, progressCtx.totalSize, success);
     
-    // Generate current path
-    if (entry->nameLen)
-    {
-        strcat(romfs_path, "/");
-        strncat(romfs_path, (char*)entry->name, entry->nameLen);
-        
-        strcat(output_path, "/");
-        strncat(output_path, (char*)entry->name, entry->nameLen);
-        removeIllegalCharacters(output_path + orig_output_path_len + 1);
-        mkdir(output_path, 0744);
-    }
+    if (outFile) fclose(outFile);
     
-    if (entry->childFile != ROMFS_ENTRY_EMPTY)
+    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
     {
-        if (!recursiveDumpRomFsFile(entry->childFile, romfs_path, output_path, progressCtx, usePatch, isFat32))
+        char *tmp = strrchr(dumpPath, '/');
+        if (tmp != NULL) *tmp = '\0';
+        
+        if (success)
         {
-            romfs_path[orig_romfs_path_len] = '\0';
-            output_path[orig_output_path_len] = '\0';
-            return false;
+            // Set archive bit (only for FAT32)
+            fsdevSetConcatenationFileAttribute(dumpPath);
+        } else {
+            if (removeFile) fsdevDeleteDirectoryRecursively(dumpPath);
         }
+    } else {
+        if (!success && removeFile) remove(dumpPath);
     }
     
-    if (entry->childDir != ROMFS_ENTRY_EMPTY)
-    {
-        if (!recursiveDumpRomFsDir(entry->childDir, romfs_path, output_path, progressCtx, usePatch, true, isFat32))
-        {
-            romfs_path[orig_romfs_path_len] = '\0';
-            output_path[orig_output_path_len] = '\0';
-            return false;
-        }
-    }
+    if (dumpName) free(dumpName);
     
-    romfs_path[orig_romfs_path_len] = '\0';
-    output_path[orig_output_path_len] = '\0';
+    breaks += 2;
     
-    if (dumpSiblingDir && entry->sibling != ROMFS_ENTRY_EMPTY)
-    {
-        if (!recursiveDumpRomFsDir(entry->sibling, romfs_path, output_path, progressCtx, usePatch, true, isFat32)) return false;
-    }
+    changeHomeButtonBlockStatus(false);
     
-    return true;
+    return success;
 }
 
-bool dumpRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg)
+bool dumpCurrentDirFromRomFsSection(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg)
 {
     if (!romFsDumpCfg)
     {
@@ -4640,166 +7578,32 @@ bool dumpRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsO
         }
     }
     
-    // Retrieve RomFS from Program NCA
-    if (readNcaRomFsSection(titleIndex, curRomFsType, -1) != 0)
-    {
-        free(dumpName);
-        breaks += 2;
-        return false;
-    }
-    
     // Calculate total dump size
-    if (!calculateRomFsFullExtractedSize((curRomFsType == ROMFS_TYPE_PATCH), &(progressCtx.totalSize))) goto out;
-    
-    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Extracted RomFS dump size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
-    uiRefreshDisplay();
-    breaks++;
-    
-    if (progressCtx.totalSize > freeSpace)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-        goto out;
-    }
-    
-    // Generate output path
-    if (!useLayeredFSDir)
-    {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", ROMFS_DUMP_PATH, dumpName);
-        
-        if ((curRomFsType != ROMFS_TYPE_PATCH && romFsContext.idOffset > 0) || (curRomFsType == ROMFS_TYPE_PATCH && bktrContext.idOffset > 0))
-        {
-            sprintf(strbuf, " (ID offset #%u)", (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset));
-            strcat(dumpPath, strbuf);
-        }
-    } else {
-        mkdir(cfwDirStr, 0744);
-        
-        // Base applications and updates: always use the base application title ID
-        // DLCs: use DLC title ID
-        u64 titleId = (curRomFsType == ROMFS_TYPE_APP ? baseAppEntries[titleIndex].titleId : (curRomFsType == ROMFS_TYPE_PATCH ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : addOnEntries[titleIndex].titleId));
-        titleId += (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset);
-        
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, titleId);
-        mkdir(dumpPath, 0744);
-        
-        strcat(dumpPath, "/romfs");
-    }
-    
-    mkdir(dumpPath, 0744);
-    
-    // Start dump process
-    breaks++;
-    dumpStartMsg();
-    appletModeOperationWarning();
-    uiRefreshDisplay();
-    breaks++;
-    
-    changeHomeButtonBlockStatus(true);
-    
-    progressCtx.line_offset = (breaks + 4);
-    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
-    
-    success = recursiveDumpRomFsDir(0, romFsPath, dumpPath, &progressCtx, (curRomFsType == ROMFS_TYPE_PATCH), true, isFat32);
-    
-    if (success)
-    {
-        breaks = (progressCtx.line_offset + 2);
-        
-        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
-        progressCtx.now -= progressCtx.start;
-        
-        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
-    } else {
-        setProgressBarError(&progressCtx);
-        removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
-    }
-    
-out:
-    if (curRomFsType == ROMFS_TYPE_PATCH) freeBktrContext();
-    
-    freeRomFsContext();
-    
-    if (dumpName) free(dumpName);
-    
-    breaks += 2;
-    
-    changeHomeButtonBlockStatus(false);
-    
-    return success;
-}
-
-bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg)
-{
-    if (!romFsDumpCfg)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid RomFS configuration struct!", __func__);
-        breaks += 2;
-        return false;
-    }
-    
-    bool isFat32 = romFsDumpCfg->isFat32;
-    bool useLayeredFSDir = romFsDumpCfg->useLayeredFSDir;
-    
-    if ((curRomFsType != ROMFS_TYPE_PATCH && (!romFsContext.romfs_filetable_size || file_offset > romFsContext.romfs_filetable_size || !romFsContext.romfs_file_entries)) || (curRomFsType == ROMFS_TYPE_PATCH && (!bktrContext.romfs_filetable_size || file_offset > bktrContext.romfs_filetable_size || !bktrContext.romfs_file_entries)) || (curRomFsType == ROMFS_TYPE_APP && titleIndex > (titleAppCount - 1)) || (curRomFsType == ROMFS_TYPE_PATCH && titleIndex > (titlePatchCount - 1)) || (curRomFsType == ROMFS_TYPE_ADDON && titleIndex > (titleAddOnCount - 1)))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse file entry from RomFS section!", __func__);
-        breaks += 2;
-        return false;
-    }
-    
-    u64 n = DUMP_BUFFER_SIZE;
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
-    size_t write_res;
-    bool proceed = true, success = false, fat32_error = false, removeFile = true;
-    
-    char tmp_idx[5];
-    char *dumpName = NULL;
-    char dumpPath[NAME_BUF_LEN * 2] = {'\0'};
-    
-    progress_ctx_t progressCtx;
-    memset(&progressCtx, 0, sizeof(progress_ctx_t));
-    
-    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
-    
-    romfs_file *entry = (curRomFsType != ROMFS_TYPE_PATCH ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + file_offset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + file_offset));
-    
-    // Check if we're dealing with a nameless file
-    if (!entry->nameLen)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: file entry without name in RomFS section!", __func__);
-        breaks += 2;
-        return false;
-    }
+    if (!calculateRomFsExtractedDirSize(curRomFsDirOffset, (curRomFsType == ROMFS_TYPE_PATCH), &(progressCtx.totalSize))) goto out;
     
-    progressCtx.totalSize = entry->dataSize;
     convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
-    
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "File size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Extracted RomFS directory size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
+    uiRefreshDisplay();
     breaks++;
     
     if (progressCtx.totalSize > freeSpace)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-        breaks += 2;
-        return false;
+        goto out;
     }
     
-    breaks++;
+    if (strlen(curRomFsPath) > 1)
+    {
+        // Copy the whole current path and remove the last element (current directory) from it
+        // It will be re-added later
+        snprintf(romFsPath, MAX_CHARACTERS(romFsPath), curRomFsPath);
+        char *slash = strrchr(romFsPath, '/');
+        if (slash) *slash = '\0';
+    }
     
     // Generate output path
     if (!useLayeredFSDir)
     {
-        dumpName = generateNSPDumpName((curRomFsType == ROMFS_TYPE_APP ? DUMP_APP_NSP : (curRomFsType == ROMFS_TYPE_PATCH ? DUMP_PATCH_NSP : DUMP_ADDON_NSP)), titleIndex, false);
-        if (!dumpName)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
-            breaks += 2;
-            return false;
-        }
-        
         snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", ROMFS_DUMP_PATH, dumpName);
         
         if ((curRomFsType != ROMFS_TYPE_PATCH && romFsContext.idOffset > 0) || (curRomFsType == ROMFS_TYPE_PATCH && bktrContext.idOffset > 0))
@@ -4835,743 +7639,947 @@ bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType
         
         if (!strlen(tmp1)) break;
         
-        strcat(dumpPath, "/");
-        
-        cur_len = strlen(dumpPath);
-        
         tmp2 = strchr(tmp1, '/');
         if (tmp2 != NULL)
         {
+            strcat(dumpPath, "/");
+            
+            cur_len = strlen(dumpPath);
+            
             strncat(dumpPath, tmp1, tmp2 - tmp1);
             
+            removeIllegalCharacters(dumpPath + cur_len);
+            
+            mkdir(dumpPath, 0744);
+            
             tmp1 = tmp2;
         } else {
-            strcat(dumpPath, tmp1);
-            
+            // Skip last entry
             tmp1 = NULL;
         }
-        
-        removeIllegalCharacters(dumpPath + cur_len);
-        
-        mkdir(dumpPath, 0744);
     }
     
-    strcat(dumpPath, "/");
-    cur_len = strlen(dumpPath);
-    strncat(dumpPath, (char*)entry->name, entry->nameLen);
-    removeIllegalCharacters(dumpPath + cur_len);
+    // Start dump process
+    breaks++;
+    dumpStartMsg();
+    perfStart();
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    breaks++;
     
-    // Check if the dump already exists
-    if (checkIfFileExists(dumpPath))
+    changeHomeButtonBlockStatus(true);
+    
+    progressCtx.line_offset = (breaks + 4);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    
+    progressUiThreadStart(&progressCtx);
+    
+    success = extractRomFsDir(curRomFsDirOffset, romFsPath, dumpPath, &progressCtx, (curRomFsType == ROMFS_TYPE_PATCH), false, isFat32, NULL, NULL);
+    
+    progressUiThreadStop(&progressCtx);
+    
+    if (success)
     {
-        // Ask the user if they want to proceed anyway
-        int cur_breaks = breaks;
+        breaks = (progressCtx.line_offset + 2);
         
-        proceed = yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?");
-        if (!proceed)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
-            removeFile = false;
-            goto out;
-        } else {
-            // Remove the prompt from the screen
-            breaks = cur_breaks;
-            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
-        }
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
+        
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
+    } else {
+        setProgressBarError(&progressCtx);
+        removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
     }
     
-    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+out:
+    perfStop("RomFS directory", dumpName, progressCtx.totalSize, success);
+    
+    if (dumpName) free(dumpName);
+    
+    breaks += 2;
+    
+    changeHomeButtonBlockStatus(false);
+    
+    return success;
+}
+
+bool dumpGameCardCertificate()
+{
+    u32 crc = 0;
+    Result result;
+    bool success = false;
+    FILE *outFile = NULL;
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
+    size_t write_res;
+    
+    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    
+    char *dumpName = generateGameCardDumpName(false);
+    if (!dumpName)
     {
-        // Since we may actually be dealing with an existing directory with the archive bit set or unset, let's try both
-        // Better safe than sorry
-        remove(dumpPath);
-        fsdevDeleteDirectoryRecursively(dumpPath);
-        
-        mkdir(dumpPath, 0744);
-        sprintf(tmp_idx, "/%02u", splitIndex);
-        strcat(dumpPath, tmp_idx);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+        breaks += 2;
+        return false;
     }
     
-    // Start dump process
-    dumpStartMsg();
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Dumping gamecard certificate. Please wait.");
+    breaks++;
+    
     appletModeOperationWarning();
-    uiRefreshDisplay();
     breaks++;
     
-    changeHomeButtonBlockStatus(true);
+    uiRefreshDisplay();
     
-    if (strlen(curRomFsPath) > 1)
+    result = openGameCardStoragePartition(ISTORAGE_PARTITION_NORMAL);
+    if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Copying \"romfs:%s/%.*s\"...", curRomFsPath, entry->nameLen, entry->name);
-    } else {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Copying \"romfs:/%.*s\"...", entry->nameLen, entry->name);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #0! (0x%08X)", __func__, result);
+        goto out;
     }
     
-    breaks += 2;
+    if (CERT_SIZE > freeSpace)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+        goto out;
+    }
     
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
+    result = readGameCardStoragePartition(CERT_OFFSET, dumpBuf, CERT_SIZE);
+    if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %u bytes long certificate at offset 0x%016lX from IStorage partition #0! (0x%08X)", __func__, CERT_SIZE, CERT_OFFSET, result);
         goto out;
     }
     
-    progressCtx.line_offset = (breaks + 2);
-    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    // Calculate CRC32
+    crc32(dumpBuf, CERT_SIZE, &crc);
     
-    for(progressCtx.curOffset = 0; progressCtx.curOffset < progressCtx.totalSize; progressCtx.curOffset += n)
+    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Certificate (%08X).bin", CERT_DUMP_PATH, dumpName, crc);
+    
+    // Check if the dump already exists
+    if (checkIfFileExists(dumpPath))
     {
-        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/') + 1);
-        
-        uiRefreshDisplay();
-        
-        if (n > (progressCtx.totalSize - progressCtx.curOffset)) n = (progressCtx.totalSize - progressCtx.curOffset);
-        
-        breaks = (progressCtx.line_offset + 2);
-        
-        if (curRomFsType != ROMFS_TYPE_PATCH)
-        {
-            proceed = processNcaCtrSectionBlock(&(romFsContext.ncmStorage), &(romFsContext.ncaId), &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + entry->dataOff + progressCtx.curOffset, dumpBuf, n, false);
-        } else {
-            proceed = readBktrSectionBlock(bktrContext.romfs_filedata_offset + entry->dataOff + progressCtx.curOffset, dumpBuf, n);
-        }
-        
-        breaks = (progressCtx.line_offset - 2);
-        
-        if (!proceed) break;
+        // Ask the user if they want to proceed anyway
+        int cur_breaks = breaks;
         
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32 && (progressCtx.curOffset + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
+        if (!yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?"))
         {
-            u64 new_file_chunk_size = ((progressCtx.curOffset + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
-            u64 old_file_chunk_size = (n - new_file_chunk_size);
-            
-            if (old_file_chunk_size > 0)
-            {
-                write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                if (write_res != old_file_chunk_size)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, progressCtx.curOffset, splitIndex, write_res);
-                    break;
-                }
-            }
-            
-            fclose(outFile);
-            outFile = NULL;
-            
-            if (new_file_chunk_size > 0 || (progressCtx.curOffset + n) < progressCtx.totalSize)
-            {
-                char *tmp = strrchr(dumpPath, '/');
-                if (tmp != NULL) *tmp = '\0';
-                
-                splitIndex++;
-                sprintf(tmp_idx, "/%02u", splitIndex);
-                strcat(dumpPath, tmp_idx);
-                
-                outFile = fopen(dumpPath, "wb");
-                if (!outFile)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                    break;
-                }
-                
-                if (new_file_chunk_size > 0)
-                {
-                    write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                    if (write_res != new_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, progressCtx.curOffset + old_file_chunk_size, splitIndex, write_res);
-                        break;
-                    }
-                }
-            }
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            goto out;
         } else {
-            write_res = fwrite(dumpBuf, 1, n, outFile);
-            if (write_res != n)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
-                
-                if ((progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
-                    fat32_error = true;
-                }
-                
-                break;
-            }
-        }
-        
-        printProgressBar(&progressCtx, true, n);
-        
-        if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
-            break;
+            // Remove the prompt from the screen
+            breaks = cur_breaks;
+            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
         }
     }
     
-    if (progressCtx.curOffset >= progressCtx.totalSize) success = true;
-    
-    // Support empty files
-    if (!progressCtx.totalSize)
-    {
-        uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/') + 1);
-        
-        progressCtx.progress = 100;
-        
-        printProgressBar(&progressCtx, false, 0);
-    }
-    
-    breaks = (progressCtx.line_offset + 2);
+    outFile = fopen(dumpPath, "wb");
+    if (!outFile)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
+        goto out;
+    }
     
-    if (success)
+    write_res = dumpFileWrite(dumpBuf, CERT_SIZE, outFile);
+    if (write_res != CERT_SIZE)
     {
-        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
-        progressCtx.now -= progressCtx.start;
-        
-        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
-    } else {
-        setProgressBarError(&progressCtx);
-        if (fat32_error) breaks += 2;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %u bytes certificate data! (wrote %lu bytes)", __func__, CERT_SIZE, write_res);
+        goto out;
     }
     
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed!");
+    breaks++;
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Certificate dumped to: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+    
+    success = true;
+    
 out:
     if (outFile) fclose(outFile);
     
-    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
-    {
-        char *tmp = strrchr(dumpPath, '/');
-        if (tmp != NULL) *tmp = '\0';
-        
-        if (success)
-        {
-            // Set archive bit (only for FAT32)
-            fsdevSetConcatenationFileAttribute(dumpPath);
-        } else {
-            if (removeFile) fsdevDeleteDirectoryRecursively(dumpPath);
-        }
-    } else {
-        if (!success && removeFile) remove(dumpPath);
-    }
+    if (!success && strlen(dumpPath)) remove(dumpPath);
     
-    if (dumpName) free(dumpName);
+    closeGameCardStoragePartition();
     
-    breaks += 2;
+    free(dumpName);
     
-    changeHomeButtonBlockStatus(false);
+    breaks += 2;
     
     return success;
 }
 
-bool dumpCurrentDirFromRomFsSection(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg)
+bool dumpTicketFromTitle(u32 titleIndex, selectedTicketType curTikType, ticketOptions *tikDumpCfg)
 {
-    if (!romFsDumpCfg)
+    if (!tikDumpCfg)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid RomFS configuration struct!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ticket dump configuration struct!", __func__);
         breaks += 2;
         return false;
     }
     
-    bool isFat32 = romFsDumpCfg->isFat32;
-    bool useLayeredFSDir = romFsDumpCfg->useLayeredFSDir;
+    bool removeConsoleData = tikDumpCfg->removeConsoleData;
     
-    progress_ctx_t progressCtx;
-    memset(&progressCtx, 0, sizeof(progress_ctx_t));
+    u32 i = 0;
+    Result result;
+    
+    NcmStorageId curStorageId;
+    NcmContentMetaType metaType;
+    u32 titleCount = 0, ncmTitleIndex = 0;
     
     char *dumpName = NULL;
-    char romFsPath[NAME_BUF_LEN * 2] = {'\0'}, dumpPath[NAME_BUF_LEN * 2] = {'\0'};
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
     
-    bool success = false;
+    NcmContentInfo *titleContentInfos = NULL;
+    u32 titleContentInfoCnt = 0;
     
-    if ((curRomFsType == ROMFS_TYPE_APP && !titleAppCount) || (curRomFsType == ROMFS_TYPE_PATCH && !titlePatchCount) || (curRomFsType == ROMFS_TYPE_ADDON && !titleAddOnCount))
+    NcmContentId ncaId;
+    char ncaIdStr[SHA256_HASH_SIZE + 1] = {'\0'};
+    
+    NcmContentStorage ncmStorage;
+    memset(&ncmStorage, 0, sizeof(NcmContentStorage));
+    
+    u8 ncaHeader[NCA_FULL_HEADER_LENGTH] = {0};
+    nca_header_t dec_nca_header;
+    
+    u8 decrypted_nca_keys[NCA_KEY_AREA_SIZE];
+    
+    title_rights_ctx rights_info;
+    memset(&rights_info, 0, sizeof(title_rights_ctx));
+    
+    char encTitleKeyStr[0x21] = {'\0'};
+    char decTitleKeyStr[0x21] = {'\0'};
+    
+    FILE *outFile = NULL;
+    
+    bool success = false, proceed = true, foundRightsIdAndTik = false, removeFile = false;
+    
+    if (curTikType != TICKET_TYPE_APP && curTikType != TICKET_TYPE_PATCH && curTikType != TICKET_TYPE_ADDON)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title count!", __func__);
-        breaks += 2;
-        return false;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ticket title type!", __func__);
+        goto out;
     }
     
-    if ((curRomFsType == ROMFS_TYPE_APP && titleIndex > (titleAppCount - 1)) || (curRomFsType == ROMFS_TYPE_PATCH && titleIndex > (titlePatchCount - 1)) || (curRomFsType == ROMFS_TYPE_ADDON && titleIndex > (titleAddOnCount - 1)))
+    if ((curTikType == TICKET_TYPE_APP && !baseAppEntries) || (curTikType == TICKET_TYPE_PATCH && !patchEntries) || (curTikType == TICKET_TYPE_ADDON && !addOnEntries))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title index!", __func__);
-        breaks += 2;
-        return false;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: title storage ID unavailable!", __func__);
+        goto out;
     }
     
-    if (!useLayeredFSDir)
+    if ((curTikType == TICKET_TYPE_APP && titleIndex >= titleAppCount) || (curTikType == TICKET_TYPE_PATCH && titleIndex >= titlePatchCount) || (curTikType == TICKET_TYPE_ADDON && titleIndex >= titleAddOnCount))
     {
-        dumpName = generateNSPDumpName((curRomFsType == ROMFS_TYPE_APP ? DUMP_APP_NSP : (curRomFsType == ROMFS_TYPE_PATCH ? DUMP_PATCH_NSP : DUMP_ADDON_NSP)), titleIndex, false);
-        if (!dumpName)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
-            breaks += 2;
-            return false;
-        }
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title index!", __func__);
+        goto out;
     }
     
-    // Calculate total dump size
-    if (!calculateRomFsExtractedDirSize(curRomFsDirOffset, (curRomFsType == ROMFS_TYPE_PATCH), &(progressCtx.totalSize))) goto out;
+    curStorageId = (curTikType == TICKET_TYPE_APP ? baseAppEntries[titleIndex].storageId : (curTikType == TICKET_TYPE_PATCH ? patchEntries[titleIndex].storageId : addOnEntries[titleIndex].storageId));
     
-    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Extracted RomFS directory size: %s (%lu bytes).", progressCtx.totalSizeStr, progressCtx.totalSize);
-    uiRefreshDisplay();
-    breaks++;
+    ncmTitleIndex = (curTikType == TICKET_TYPE_APP ? baseAppEntries[titleIndex].ncmIndex : (curTikType == TICKET_TYPE_PATCH ? patchEntries[titleIndex].ncmIndex : addOnEntries[titleIndex].ncmIndex));
     
-    if (progressCtx.totalSize > freeSpace)
+    metaType = (curTikType == TICKET_TYPE_APP ? NcmContentMetaType_Application : (curTikType == TICKET_TYPE_PATCH ? NcmContentMetaType_Patch : NcmContentMetaType_AddOnContent));
+    
+    if (curStorageId == NcmStorageId_GameCard)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title storage ID!", __func__);
+        goto out;
+    }
+    
+    if (sizeof(rsa2048_sha256_ticket) > freeSpace)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
         goto out;
     }
     
-    if (strlen(curRomFsPath) > 1)
+    switch(curStorageId)
     {
-        // Copy the whole current path and remove the last element (current directory) from it
-        // It will be re-added later
-        snprintf(romFsPath, MAX_CHARACTERS(romFsPath), curRomFsPath);
-        char *slash = strrchr(romFsPath, '/');
-        if (slash) *slash = '\0';
+        case NcmStorageId_SdCard:
+            titleCount = (curTikType == TICKET_TYPE_APP ? sdCardTitleAppCount : (curTikType == TICKET_TYPE_PATCH ? sdCardTitlePatchCount : sdCardTitleAddOnCount));
+            break;
+        case NcmStorageId_BuiltInUser:
+            titleCount = (curTikType == TICKET_TYPE_APP ? emmcTitleAppCount : (curTikType == TICKET_TYPE_PATCH ? emmcTitlePatchCount : emmcTitleAddOnCount));
+            break;
+        default:
+            break;
     }
     
-    // Generate output path
-    if (!useLayeredFSDir)
+    dumpName = generateNSPDumpName((nspDumpType)curTikType, titleIndex, false);
+    if (!dumpName)
     {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", ROMFS_DUMP_PATH, dumpName);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+        goto out;
+    }
+    
+    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.tik", TICKET_PATH, dumpName);
+    
+    // Check if the dump already exists
+    if (checkIfFileExists(dumpPath))
+    {
+        // Ask the user if they want to proceed anyway
+        int cur_breaks = breaks;
         
-        if ((curRomFsType != ROMFS_TYPE_PATCH && romFsContext.idOffset > 0) || (curRomFsType == ROMFS_TYPE_PATCH && bktrContext.idOffset > 0))
+        proceed = yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?");
+        if (!proceed)
         {
-            sprintf(strbuf, " (ID offset #%u)", (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset));
-            strcat(dumpPath, strbuf);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            goto out;
+        } else {
+            // Remove the prompt from the screen
+            breaks = cur_breaks;
+            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
         }
-    } else {
-        mkdir(cfwDirStr, 0744);
-        
-        // Base applications and updates: always use the base application title ID
-        // DLCs: use DLC title ID
-        u64 titleId = (curRomFsType == ROMFS_TYPE_APP ? baseAppEntries[titleIndex].titleId : (curRomFsType == ROMFS_TYPE_PATCH ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : addOnEntries[titleIndex].titleId));
-        titleId += (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset);
-        
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, titleId);
-        mkdir(dumpPath, 0744);
-        
-        strcat(dumpPath, "/romfs");
     }
     
-    mkdir(dumpPath, 0744);
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Retrieving Rights ID and Ticket for the selected %s...", (curTikType == TICKET_TYPE_APP ? "base application" : (curTikType == TICKET_TYPE_PATCH ? "update" : "DLC")));
+    breaks++;
     
-    // Create subdirectories
-    char *tmp1 = NULL, *tmp2 = NULL;
-    size_t cur_len;
+    appletModeOperationWarning();
+    breaks++;
     
-    tmp1 = strchr(curRomFsPath, '/');
+    uiRefreshDisplay();
     
-    while(tmp1 != NULL)
+    if (!retrieveContentInfosFromTitle(curStorageId, metaType, titleCount, ncmTitleIndex, &titleContentInfos, &titleContentInfoCnt))
     {
-        tmp1++;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+        goto out;
+    }
+    
+    result = ncmOpenContentStorage(&ncmStorage, curStorageId);
+    if (R_FAILED(result))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: ncmOpenContentStorage failed! (0x%08X)", __func__, result);
+        goto out;
+    }
+    
+    for(i = 0; i < titleContentInfoCnt; i++)
+    {
+        memcpy(&ncaId, &(titleContentInfos[i].content_id), sizeof(NcmContentId));
+        convertDataToHexString(titleContentInfos[i].content_id.c, SHA256_HASH_SIZE / 2, ncaIdStr, SHA256_HASH_SIZE + 1);
         
-        if (!strlen(tmp1)) break;
+        if (!readNcaDataByContentId(&ncmStorage, &ncaId, 0, ncaHeader, NCA_FULL_HEADER_LENGTH))
+        {
+            breaks++;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read header from NCA \"%s\"!", __func__, ncaIdStr);
+            proceed = false;
+            break;
+        }
         
-        tmp2 = strchr(tmp1, '/');
-        if (tmp2 != NULL)
+        // Decrypt the NCA header
+        proceed = decryptNcaHeader(ncaHeader, NCA_FULL_HEADER_LENGTH, &ncaId, &dec_nca_header, &rights_info, decrypted_nca_keys, true);
+        if (!proceed) break;
+        
+        // Check if we hit the right spot
+        if (rights_info.has_rights_id && rights_info.retrieved_tik)
         {
-            strcat(dumpPath, "/");
-            
-            cur_len = strlen(dumpPath);
-            
-            strncat(dumpPath, tmp1, tmp2 - tmp1);
-            
-            removeIllegalCharacters(dumpPath + cur_len);
-            
-            mkdir(dumpPath, 0744);
-            
-            tmp1 = tmp2;
-        } else {
-            // Skip last entry
-            tmp1 = NULL;
+            convertDataToHexString(rights_info.enc_titlekey, 0x10, encTitleKeyStr, 0x21);
+            convertDataToHexString(rights_info.dec_titlekey, 0x10, decTitleKeyStr, 0x21);
+            foundRightsIdAndTik = true;
+            break;
+        }
+    }
+    
+    if (!proceed) goto out;
+    
+    if (!foundRightsIdAndTik)
+    {
+        if (!rights_info.has_rights_id)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected %s doesn't use titlekey crypto! Rights ID field is empty in all the NCAs!", __func__, (curTikType == TICKET_TYPE_APP ? "base application" : (curTikType == TICKET_TYPE_PATCH ? "update" : "DLC")));
+            goto out;
+        }
+        
+        if (rights_info.missing_tik)
+        {
+            breaks++;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected %s uses titlekey crypto, but no ticket for it is available! This is probably a pre-install.", __func__, (curTikType == TICKET_TYPE_APP ? "base application" : (curTikType == TICKET_TYPE_PATCH ? "update" : "DLC")));
+            goto out;
         }
     }
     
-    // Start dump process
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Rights ID: \"%s\".", rights_info.rights_id_str);
     breaks++;
-    dumpStartMsg();
-    appletModeOperationWarning();
-    uiRefreshDisplay();
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Ticket type: %s (0x%02X).", (rights_info.tik_data.titlekey_type == ETICKET_TITLEKEY_COMMON ? "common" : (rights_info.tik_data.titlekey_type == ETICKET_TITLEKEY_PERSONALIZED ? "personalized" : "unknown")), rights_info.tik_data.titlekey_type);
     breaks++;
     
-    changeHomeButtonBlockStatus(true);
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Encrypted title key: \"%s\".", encTitleKeyStr);
+    breaks++;
     
-    progressCtx.line_offset = (breaks + 4);
-    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Decrypted title key: \"%s\".", decTitleKeyStr);
+    breaks += 2;
     
-    success = recursiveDumpRomFsDir(curRomFsDirOffset, romFsPath, dumpPath, &progressCtx, (curRomFsType == ROMFS_TYPE_PATCH), false, isFat32);
+    uiRefreshDisplay();
     
-    if (success)
+    // Only mess with the ticket data if removeConsoleData is true and if we're dealing with a personalized ticket (checked in removeConsoleDataFromTicket())
+    if (removeConsoleData) removeConsoleDataFromTicket(&rights_info);
+    
+    outFile = fopen(dumpPath, "wb");
+    if (!outFile)
     {
-        breaks = (progressCtx.line_offset + 2);
-        
-        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
-        progressCtx.now -= progressCtx.start;
-        
-        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
-    } else {
-        setProgressBarError(&progressCtx);
-        removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
+        goto out;
     }
     
-out:
-    if (dumpName) free(dumpName);
+    size_t wr = fwrite(&(rights_info.tik_data), 1, sizeof(rsa2048_sha256_ticket), outFile);
+    if (wr != sizeof(rsa2048_sha256_ticket))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %u bytes long ticket data to \"%s\"! Wrote %lu bytes.", __func__, sizeof(rsa2048_sha256_ticket), dumpPath, wr);
+        removeFile = true;
+        goto out;
+    }
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully finished!");
+    breaks++;
     
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Ticket saved to \"%s\".", dumpPath);
+    
+    success = true;
+    
+out:
     breaks += 2;
     
-    changeHomeButtonBlockStatus(false);
+    if (outFile) fclose(outFile);
+    
+    if (!success && removeFile) remove(dumpPath);
+    
+    ncmContentStorageClose(&ncmStorage);
+    
+    if (titleContentInfos) free(titleContentInfos);
+    
+    if (dumpName) free(dumpName);
     
     return success;
 }
 
-bool dumpGameCardCertificate()
+static bool splitOutputOpenPart(split_output_t *ctx, u32 partIndex)
 {
-    u32 crc = 0;
-    Result result;
-    bool success = false;
-    FILE *outFile = NULL;
-    char dumpPath[NAME_BUF_LEN] = {'\0'};
-    size_t write_res;
-    
-    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    char partPath[NAME_BUF_LEN] = {'\0'};
     
-    char *dumpName = generateGameCardDumpName(false);
-    if (!dumpName)
+    if (ctx->split)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
-        breaks += 2;
-        return false;
+        snprintf(partPath, MAX_CHARACTERS(partPath), "%s/%02u", ctx->path, partIndex);
+    } else {
+        snprintf(partPath, MAX_CHARACTERS(partPath), "%s", ctx->path);
     }
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Dumping gamecard certificate. Please wait.");
-    breaks++;
+    ctx->partIndex = partIndex;
     
-    appletModeOperationWarning();
-    breaks++;
+    return outFileCreate(&(ctx->out), partPath, getOutputFileAllocSize(ctx->size, SPLIT_FILE_NSP_PART_SIZE, partIndex, ctx->split));
+}
+
+static bool splitOutputCreate(split_output_t *ctx, const char *path, u64 size, bool isFat32)
+{
+    memset(ctx, 0, sizeof(split_output_t));
     
-    uiRefreshDisplay();
+    snprintf(ctx->path, MAX_CHARACTERS(ctx->path), "%s", path);
+    ctx->size = size;
+    ctx->split = (isFat32 && size > FAT32_FILESIZE_LIMIT);
     
-    result = openGameCardStoragePartition(ISTORAGE_PARTITION_NORMAL);
-    if (R_FAILED(result))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open IStorage partition #0! (0x%08X)", __func__, result);
-        goto out;
-    }
+    if (ctx->split) mkdir(ctx->path, 0744);
     
-    if (CERT_SIZE > freeSpace)
+    return splitOutputOpenPart(ctx, 0);
+}
+
+static bool splitOutputWrite(split_output_t *ctx, const void *buf, u64 size)
+{
+    const u8 *data = (const u8*)buf;
+    u64 chunk, partEnd;
+    
+    while(size)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-        goto out;
+        chunk = size;
+        
+        if (ctx->split)
+        {
+            partEnd = ((u64)(ctx->partIndex + 1) * SPLIT_FILE_NSP_PART_SIZE);
+            
+            if (ctx->offset == partEnd)
+            {
+                if (!outFileClose(&(ctx->out)) || !splitOutputOpenPart(ctx, ctx->partIndex + 1)) return false;
+                partEnd += SPLIT_FILE_NSP_PART_SIZE;
+            }
+            
+            if (chunk > (partEnd - ctx->offset)) chunk = (partEnd - ctx->offset);
+        }
+        
+        if (outFileWrite(&(ctx->out), data, chunk) != chunk) return false;
+        
+        ctx->offset += chunk;
+        data += chunk;
+        size -= chunk;
     }
     
-    result = readGameCardStoragePartition(CERT_OFFSET, dumpBuf, CERT_SIZE);
-    if (R_FAILED(result))
+    return true;
+}
+
+// Closes the output file, setting the archive bit on a split output directory. The output is removed if it's incomplete
+static bool splitOutputClose(split_output_t *ctx, bool success)
+{
+    if (ctx->out.open && !outFileClose(&(ctx->out))) success = false;
+    
+    if (success && ctx->offset != ctx->size) success = false;
+    
+    if (success && ctx->split && R_FAILED(fsdevSetConcatenationFileAttribute(ctx->path))) success = false;
+    
+    if (!success)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %u bytes long certificate at offset 0x%016lX from IStorage partition #0! (0x%08X)", __func__, CERT_SIZE, CERT_OFFSET, result);
-        goto out;
+        if (ctx->split)
+        {
+            fsdevDeleteDirectoryRecursively(ctx->path);
+        } else {
+            remove(ctx->path);
+        }
     }
     
-    // Calculate CRC32
-    crc32(dumpBuf, CERT_SIZE, &crc);
+    return success;
+}
+
+bool restoreCompressedDumps(bool isFat32)
+{
+    static const char *restoreDirs[] = { XCI_DUMP_PATH, NSP_DUMP_PATH };
     
-    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Certificate (%08X).bin", CERT_DUMP_PATH, dumpName, crc);
+    u32 i, j;
+    u32 restoreCnt = 0, restoredCnt = 0;
+    u64 n, off;
+    bool success = false, proceed = true;
+    size_t nameLen, extLen = strlen(CMP_FILE_EXTENSION);
+    char srcPath[NAME_BUF_LEN] = {'\0'}, dstPath[NAME_BUF_LEN] = {'\0'};
     
-    // Check if the dump already exists
-    if (checkIfFileExists(dumpPath))
+    dir_name_list_t lists[MAX_ELEMENTS(restoreDirs)];
+    memset(lists, 0, sizeof(lists));
+    
+    cmp_file_reader_t reader;
+    memset(&reader, 0, sizeof(cmp_file_reader_t));
+    
+    split_output_t output;
+    memset(&output, 0, sizeof(split_output_t));
+    
+    progress_ctx_t progressCtx;
+    memset(&progressCtx, 0, sizeof(progress_ctx_t));
+    
+    // Only keep the compressed files that haven't been restored yet
+    for(i = 0; i < MAX_ELEMENTS(restoreDirs); i++)
     {
-        // Ask the user if they want to proceed anyway
-        int cur_breaks = breaks;
+        loadDirNameList(restoreDirs[i], &(lists[i]));
         
-        if (!yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?"))
+        for(j = 0; j < lists[i].nameCnt; j++)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
-            goto out;
-        } else {
-            // Remove the prompt from the screen
-            breaks = cur_breaks;
-            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
+            nameLen = strlen(lists[i].names[j]);
+            
+            if (nameLen > extLen && !strcasecmp(lists[i].names[j] + nameLen - extLen, CMP_FILE_EXTENSION))
+            {
+                snprintf(srcPath, MAX_CHARACTERS(srcPath), "%s%s", restoreDirs[i], lists[i].names[j]);
+                snprintf(dstPath, MAX_CHARACTERS(dstPath), "%.*s", (int)(strlen(srcPath) - extLen), srcPath);
+                
+                if (!checkIfFileExists(dstPath) && cmpFileOpenReader(&reader, srcPath))
+                {
+                    progressCtx.totalSize += reader.header.data_size;
+                    restoreCnt++;
+                    cmpFileCloseReader(&reader);
+                    continue;
+                }
+                
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Skipping \"%s\" (%s).", lists[i].names[j], (checkIfFileExists(dstPath) ? "already restored" : "invalid compressed file"));
+                breaks++;
+            }
+            
+            free(lists[i].names[j]);
+            lists[i].names[j] = NULL;
         }
     }
     
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
+    if (!restoreCnt)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: no compressed dumps to restore!", __func__);
         goto out;
     }
     
-    write_res = fwrite(dumpBuf, 1, CERT_SIZE, outFile);
-    if (write_res != CERT_SIZE)
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Compressed dumps: %u | Restored size: %s (%lu bytes).", restoreCnt, progressCtx.totalSizeStr, progressCtx.totalSize);
+    breaks += 2;
+    
+    if (progressCtx.totalSize > freeSpace)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %u bytes certificate data! (wrote %lu bytes)", __func__, CERT_SIZE, write_res);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
         goto out;
     }
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed!");
+    dumpStartMsg();
+    appletModeOperationWarning();
+    uiRefreshDisplay();
     breaks++;
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Certificate dumped to: \"%s\".", strrchr(dumpPath, '/' ) + 1);
-    
-    success = true;
+    changeHomeButtonBlockStatus(true);
     
-out:
-    if (outFile) fclose(outFile);
+    progressCtx.line_offset = (breaks + 4);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
     
-    if (!success && strlen(dumpPath)) remove(dumpPath);
+    progressUiThreadStart(&progressCtx);
     
-    closeGameCardStoragePartition();
+    for(i = 0; i < MAX_ELEMENTS(restoreDirs) && proceed; i++)
+    {
+        for(j = 0; j < lists[i].nameCnt && proceed; j++)
+        {
+            if (!lists[i].names[j]) continue;
+            
+            snprintf(srcPath, MAX_CHARACTERS(srcPath), "%s%s", restoreDirs[i], lists[i].names[j]);
+            snprintf(dstPath, MAX_CHARACTERS(dstPath), "%.*s", (int)(strlen(srcPath) - extLen), srcPath);
+            
+            printProgressStatus(&progressCtx, PROGRESS_STATUS_UPPER, "Restoring \"%s\"...", lists[i].names[j]);
+            printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "Output file: \"%s\".", strrchr(dstPath, '/') + 1);
+            
+            if (!cmpFileOpenReader(&reader, srcPath))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open compressed file \"%s\"!", __func__, srcPath);
+                proceed = false;
+                break;
+            }
+            
+            if (!splitOutputCreate(&output, dstPath, reader.header.data_size, isFat32))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"! (0x%08X)", __func__, dstPath, output.out.lastResult);
+                splitOutputClose(&output, false);
+                proceed = false;
+                break;
+            }
+            
+            for(off = 0, n = DUMP_BUFFER_SIZE; off < reader.header.data_size; off += n)
+            {
+                if (n > (reader.header.data_size - off)) n = (reader.header.data_size - off);
+                
+                if (!cmpFileRead(&reader, off, dumpBuf, n))
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk from offset 0x%016lX of \"%s\"! The compressed file may be corrupted.", __func__, n, off, lists[i].names[j]);
+                    proceed = false;
+                    break;
+                }
+                
+                if (!splitOutputWrite(&output, dumpBuf, n))
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (0x%08X)", __func__, n, off, output.out.lastResult);
+                    proceed = false;
+                    break;
+                }
+                
+                printProgressBar(&progressCtx, true, n);
+                progressCtx.curOffset += n;
+                
+                if (progressCtx.curOffset < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+                    proceed = false;
+                    break;
+                }
+            }
+            
+            cmpFileCloseReader(&reader);
+            
+            if (!splitOutputClose(&output, proceed))
+            {
+                if (proceed) uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to finish output file \"%s\"!", __func__, dstPath);
+                proceed = false;
+                break;
+            }
+            
+            restoredCnt++;
+        }
+    }
     
-    free(dumpName);
+    progressUiThreadStop(&progressCtx);
     
-    breaks += 2;
+    breaks = (progressCtx.line_offset + 2);
     
-    return success;
-}
-
-bool dumpTicketFromTitle(u32 titleIndex, selectedTicketType curTikType, ticketOptions *tikDumpCfg)
-{
-    if (!tikDumpCfg)
+    if (proceed)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ticket dump configuration struct!", __func__);
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
+        
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s! Restored %u compressed dump(s).", progressCtx.etaInfo, restoredCnt);
+        
+        success = true;
+    } else {
+        setProgressBarError(&progressCtx);
         breaks += 2;
-        return false;
-    }
-    
-    bool removeConsoleData = tikDumpCfg->removeConsoleData;
-    
-    u32 i = 0;
-    Result result;
+        
+        // The compressed files are never removed, so nothing is lost - just run this again
+        if (restoredCnt) uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%u compressed dump(s) restored before the error. These will be skipped next time.", restoredCnt);
+    }
     
-    NcmStorageId curStorageId;
-    NcmContentMetaType metaType;
-    u32 titleCount = 0, ncmTitleIndex = 0;
+    changeHomeButtonBlockStatus(false);
     
-    char *dumpName = NULL;
-    char dumpPath[NAME_BUF_LEN] = {'\0'};
+out:
+    breaks += 2;
     
-    NcmContentInfo *titleContentInfos = NULL;
-    u32 titleContentInfoCnt = 0;
+    cmpFileCloseReader(&reader);
     
-    NcmContentId ncaId;
-    char ncaIdStr[SHA256_HASH_SIZE + 1] = {'\0'};
+    for(i = 0; i < MAX_ELEMENTS(restoreDirs); i++) freeDirNameList(&(lists[i]));
     
-    NcmContentStorage ncmStorage;
-    memset(&ncmStorage, 0, sizeof(NcmContentStorage));
+    return success;
+}
+
+// Opens a NSP manifest and checks its header. The PFS0 header and every entry must add up to the rebuilt NSP size
+static FILE *openNspManifest(const char *path, nsp_manifest_header *header, nsp_manifest_entry **entries)
+{
+    u32 i;
+    u64 nspSize;
+    FILE *manifest = fopen(path, "rb");
+    if (!manifest) return NULL;
     
-    u8 ncaHeader[NCA_FULL_HEADER_LENGTH] = {0};
-    nca_header_t dec_nca_header;
+    if (entries) *entries = NULL;
     
-    u8 decrypted_nca_keys[NCA_KEY_AREA_SIZE];
+    if (fread(header, 1, sizeof(nsp_manifest_header), manifest) != sizeof(nsp_manifest_header) || header->magic != NSP_MANIFEST_MAGIC || header->version != NSP_MANIFEST_VERSION || !header->entry_cnt || header->pfs0_header_size < sizeof(pfs0_header)) goto fail;
     
-    title_rights_ctx rights_info;
-    memset(&rights_info, 0, sizeof(title_rights_ctx));
+    if (!entries) return manifest;
     
-    char encTitleKeyStr[0x21] = {'\0'};
-    char decTitleKeyStr[0x21] = {'\0'};
+    *entries = calloc(header->entry_cnt, sizeof(nsp_manifest_entry));
+    if (!*entries || fseek(manifest, (long)header->table_offset, SEEK_SET) != 0 || fread(*entries, sizeof(nsp_manifest_entry), header->entry_cnt, manifest) != header->entry_cnt) goto fail;
     
-    FILE *outFile = NULL;
+    for(i = 0, nspSize = header->pfs0_header_size; i < header->entry_cnt; i++) nspSize += (*entries)[i].size;
     
-    bool success = false, proceed = true, foundRightsIdAndTik = false, removeFile = false;
+    if (nspSize == header->nsp_size) return manifest;
     
-    if (curTikType != TICKET_TYPE_APP && curTikType != TICKET_TYPE_PATCH && curTikType != TICKET_TYPE_ADDON)
+fail:
+    if (entries && *entries)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid ticket title type!", __func__);
-        goto out;
+        free(*entries);
+        *entries = NULL;
     }
     
-    if ((curTikType == TICKET_TYPE_APP && !baseAppEntries) || (curTikType == TICKET_TYPE_PATCH && !patchEntries) || (curTikType == TICKET_TYPE_ADDON && !addOnEntries))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: title storage ID unavailable!", __func__);
-        goto out;
-    }
+    fclose(manifest);
     
-    if ((curTikType == TICKET_TYPE_APP && titleIndex >= titleAppCount) || (curTikType == TICKET_TYPE_PATCH && titleIndex >= titlePatchCount) || (curTikType == TICKET_TYPE_ADDON && titleIndex >= titleAddOnCount))
+    return NULL;
+}
+
+// Copies data from a manifest or a store object to the rebuilt NSP, hashing it along the way if hashCtx isn't NULL
+static bool copyNspManifestData(FILE *src, u64 offset, u64 size, split_output_t *output, progress_ctx_t *progressCtx, Sha256Context *hashCtx)
+{
+    u64 off, n = DUMP_BUFFER_SIZE;
+    
+    if (fseek(src, (long)offset, SEEK_SET) != 0) return false;
+    
+    for(off = 0; off < size; off += n)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title index!", __func__);
-        goto out;
+        if (n > (size - off)) n = (size - off);
+        
+        if (fread(dumpBuf, 1, n, src) != n)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk from offset 0x%016lX!", __func__, n, offset + off);
+            return false;
+        }
+        
+        if (hashCtx) sha256ContextUpdate(hashCtx, dumpBuf, n);
+        
+        if (!splitOutputWrite(output, dumpBuf, n))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk to the output NSP! (0x%08X)", __func__, n, output->out.lastResult);
+            return false;
+        }
+        
+        printProgressBar(progressCtx, true, n);
+        progressCtx->curOffset += n;
+        
+        if (progressCtx->curOffset < progressCtx->totalSize && cancelProcessCheck(progressCtx))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            return false;
+        }
     }
     
-    curStorageId = (curTikType == TICKET_TYPE_APP ? baseAppEntries[titleIndex].storageId : (curTikType == TICKET_TYPE_PATCH ? patchEntries[titleIndex].storageId : addOnEntries[titleIndex].storageId));
+    return true;
+}
+
+bool rebuildNspFromManifests(bool isFat32)
+{
+    u32 i, j;
+    u32 rebuildCnt = 0, rebuiltCnt = 0;
+    bool success = false, proceed = true;
+    size_t nameLen, extLen = strlen(NSP_MANIFEST_EXTENSION);
+    char srcPath[NAME_BUF_LEN] = {'\0'}, dstPath[NAME_BUF_LEN] = {'\0'}, objectPath[NAME_BUF_LEN] = {'\0'};
+    u8 zeroHash[SHA256_HASH_SIZE] = {0}, objectHash[SHA256_HASH_SIZE];
     
-    ncmTitleIndex = (curTikType == TICKET_TYPE_APP ? baseAppEntries[titleIndex].ncmIndex : (curTikType == TICKET_TYPE_PATCH ? patchEntries[titleIndex].ncmIndex : addOnEntries[titleIndex].ncmIndex));
+    FILE *manifest = NULL, *object = NULL;
+    nsp_manifest_header header;
+    nsp_manifest_entry *entries = NULL;
+    Sha256Context hashCtx;
     
-    metaType = (curTikType == TICKET_TYPE_APP ? NcmContentMetaType_Application : (curTikType == TICKET_TYPE_PATCH ? NcmContentMetaType_Patch : NcmContentMetaType_AddOnContent));
+    dir_name_list_t list;
+    memset(&list, 0, sizeof(dir_name_list_t));
     
-    if (curStorageId == NcmStorageId_GameCard)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title storage ID!", __func__);
-        goto out;
-    }
+    split_output_t output;
+    memset(&output, 0, sizeof(split_output_t));
     
-    if (sizeof(rsa2048_sha256_ticket) > freeSpace)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
-        goto out;
-    }
+    progress_ctx_t progressCtx;
+    memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
-    switch(curStorageId)
+    // Only keep the manifests that haven't been rebuilt yet
+    loadDirNameList(NSP_DUMP_PATH, &list);
+    
+    for(i = 0; i < list.nameCnt; i++)
     {
-        case NcmStorageId_SdCard:
-            titleCount = (curTikType == TICKET_TYPE_APP ? sdCardTitleAppCount : (curTikType == TICKET_TYPE_PATCH ? sdCardTitlePatchCount : sdCardTitleAddOnCount));
-            break;
-        case NcmStorageId_BuiltInUser:
-            titleCount = (curTikType == TICKET_TYPE_APP ? emmcTitleAppCount : (curTikType == TICKET_TYPE_PATCH ? emmcTitlePatchCount : emmcTitleAddOnCount));
-            break;
-        default:
-            break;
+        nameLen = strlen(list.names[i]);
+        
+        if (nameLen > extLen && !strcasecmp(list.names[i] + nameLen - extLen, NSP_MANIFEST_EXTENSION))
+        {
+            snprintf(srcPath, MAX_CHARACTERS(srcPath), "%s%s", NSP_DUMP_PATH, list.names[i]);
+            snprintf(dstPath, MAX_CHARACTERS(dstPath), "%.*s.nsp", (int)(strlen(srcPath) - extLen), srcPath);
+            
+            if (!checkIfFileExists(dstPath) && (manifest = openNspManifest(srcPath, &header, NULL)) != NULL)
+            {
+                progressCtx.totalSize += header.nsp_size;
+                rebuildCnt++;
+                fclose(manifest);
+                manifest = NULL;
+                continue;
+            }
+            
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Skipping \"%s\" (%s).", list.names[i], (checkIfFileExists(dstPath) ? "already rebuilt" : "invalid manifest"));
+            breaks++;
+        }
+        
+        free(list.names[i]);
+        list.names[i] = NULL;
     }
     
-    dumpName = generateNSPDumpName((nspDumpType)curTikType, titleIndex, false);
-    if (!dumpName)
+    if (!rebuildCnt)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: no NSP manifests to rebuild!", __func__);
         goto out;
     }
     
-    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.tik", TICKET_PATH, dumpName);
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "NSP manifests: %u | Rebuilt size: %s (%lu bytes).", rebuildCnt, progressCtx.totalSizeStr, progressCtx.totalSize);
+    breaks += 2;
     
-    // Check if the dump already exists
-    if (checkIfFileExists(dumpPath))
+    if (progressCtx.totalSize > freeSpace)
     {
-        // Ask the user if they want to proceed anyway
-        int cur_breaks = breaks;
-        
-        proceed = yesNoPrompt("You have already dumped this content. Do you wish to proceed anyway?");
-        if (!proceed)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
-            goto out;
-        } else {
-            // Remove the prompt from the screen
-            breaks = cur_breaks;
-            uiFill(0, STRING_Y_POS(breaks), FB_WIDTH, FB_HEIGHT - STRING_Y_POS(breaks), BG_COLOR_RGB);
-        }
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+        goto out;
     }
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Retrieving Rights ID and Ticket for the selected %s...", (curTikType == TICKET_TYPE_APP ? "base application" : (curTikType == TICKET_TYPE_PATCH ? "update" : "DLC")));
-    breaks++;
-    
+    dumpStartMsg();
     appletModeOperationWarning();
+    uiRefreshDisplay();
     breaks++;
     
-    uiRefreshDisplay();
+    changeHomeButtonBlockStatus(true);
     
-    if (!retrieveContentInfosFromTitle(curStorageId, metaType, titleCount, ncmTitleIndex, &titleContentInfos, &titleContentInfoCnt))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
-        goto out;
-    }
+    progressCtx.line_offset = (breaks + 4);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
     
-    result = ncmOpenContentStorage(&ncmStorage, curStorageId);
-    if (R_FAILED(result))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: ncmOpenContentStorage failed! (0x%08X)", __func__, result);
-        goto out;
-    }
+    progressUiThreadStart(&progressCtx);
     
-    for(i = 0; i < titleContentInfoCnt; i++)
+    for(i = 0; i < list.nameCnt && proceed; i++)
     {
-        memcpy(&ncaId, &(titleContentInfos[i].content_id), sizeof(NcmContentId));
-        convertDataToHexString(titleContentInfos[i].content_id.c, SHA256_HASH_SIZE / 2, ncaIdStr, SHA256_HASH_SIZE + 1);
+        if (!list.names[i]) continue;
         
-        if (!readNcaDataByContentId(&ncmStorage, &ncaId, 0, ncaHeader, NCA_FULL_HEADER_LENGTH))
+        snprintf(srcPath, MAX_CHARACTERS(srcPath), "%s%s", NSP_DUMP_PATH, list.names[i]);
+        snprintf(dstPath, MAX_CHARACTERS(dstPath), "%.*s.nsp", (int)(strlen(srcPath) - extLen), srcPath);
+        
+        printProgressStatus(&progressCtx, PROGRESS_STATUS_UPPER, "Rebuilding \"%s\"...", list.names[i]);
+        printProgressStatus(&progressCtx, PROGRESS_STATUS_LOWER, "Output file: \"%s\".", strrchr(dstPath, '/') + 1);
+        
+        manifest = openNspManifest(srcPath, &header, &entries);
+        if (!manifest)
         {
-            breaks++;
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read header from NCA \"%s\"!", __func__, ncaIdStr);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to load NSP manifest \"%s\"!", __func__, srcPath);
             proceed = false;
             break;
         }
         
-        // Decrypt the NCA header
-        proceed = decryptNcaHeader(ncaHeader, NCA_FULL_HEADER_LENGTH, &dec_nca_header, &rights_info, decrypted_nca_keys, true);
-        if (!proceed) break;
-        
-        // Check if we hit the right spot
-        if (rights_info.has_rights_id && rights_info.retrieved_tik)
+        if (!splitOutputCreate(&output, dstPath, header.nsp_size, isFat32))
         {
-            convertDataToHexString(rights_info.enc_titlekey, 0x10, encTitleKeyStr, 0x21);
-            convertDataToHexString(rights_info.dec_titlekey, 0x10, decTitleKeyStr, 0x21);
-            foundRightsIdAndTik = true;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"! (0x%08X)", __func__, dstPath, output.out.lastResult);
+            splitOutputClose(&output, false);
+            proceed = false;
             break;
         }
-    }
-    
-    if (!proceed) goto out;
-    
-    if (!foundRightsIdAndTik)
-    {
-        if (!rights_info.has_rights_id)
+        
+        // The PFS0 header comes right after the manifest header
+        proceed = copyNspManifestData(manifest, sizeof(nsp_manifest_header), header.pfs0_header_size, &output, &progressCtx, NULL);
+        
+        for(j = 0; j < header.entry_cnt && proceed; j++)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected %s doesn't use titlekey crypto! Rights ID field is empty in all the NCAs!", __func__, (curTikType == TICKET_TYPE_APP ? "base application" : (curTikType == TICKET_TYPE_PATCH ? "update" : "DLC")));
-            goto out;
+            if (!memcmp(entries[j].hash, zeroHash, SHA256_HASH_SIZE))
+            {
+                proceed = copyNspManifestData(manifest, entries[j].offset, entries[j].size, &output, &progressCtx, NULL);
+                continue;
+            }
+            
+            ncaStoreGetObjectPath(entries[j].hash, objectPath, MAX_CHARACTERS(objectPath));
+            
+            object = fopen(objectPath, "rb");
+            if (!object)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: NCA store object \"%s\" is missing!", __func__, strrchr(objectPath, '/') + 1);
+                proceed = false;
+                break;
+            }
+            
+            // Store objects are named after their checksum, so a damaged one is caught right away
+            sha256ContextCreate(&hashCtx);
+            
+            proceed = copyNspManifestData(object, 0, entries[j].size, &output, &progressCtx, &hashCtx);
+            
+            fclose(object);
+            object = NULL;
+            
+            if (!proceed) break;
+            
+            sha256ContextGetHash(&hashCtx, objectHash);
+            
+            if (memcmp(objectHash, entries[j].hash, SHA256_HASH_SIZE) != 0)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: NCA store object \"%s\" checksum mismatch!", __func__, strrchr(objectPath, '/') + 1);
+                proceed = false;
+            }
         }
         
-        if (rights_info.missing_tik)
+        fclose(manifest);
+        manifest = NULL;
+        
+        free(entries);
+        entries = NULL;
+        
+        if (!splitOutputClose(&output, proceed))
         {
-            breaks++;
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: the selected %s uses titlekey crypto, but no ticket for it is available! This is probably a pre-install.", __func__, (curTikType == TICKET_TYPE_APP ? "base application" : (curTikType == TICKET_TYPE_PATCH ? "update" : "DLC")));
-            goto out;
+            if (proceed) uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to finish output file \"%s\"!", __func__, dstPath);
+            proceed = false;
+            break;
         }
+        
+        rebuiltCnt++;
     }
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Rights ID: \"%s\".", rights_info.rights_id_str);
-    breaks++;
-    
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Ticket type: %s (0x%02X).", (rights_info.tik_data.titlekey_type == ETICKET_TITLEKEY_COMMON ? "common" : (rights_info.tik_data.titlekey_type == ETICKET_TITLEKEY_PERSONALIZED ? "personalized" : "unknown")), rights_info.tik_data.titlekey_type);
-    breaks++;
-    
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Encrypted title key: \"%s\".", encTitleKeyStr);
-    breaks++;
-    
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Decrypted title key: \"%s\".", decTitleKeyStr);
-    breaks += 2;
-    
-    uiRefreshDisplay();
-    
-    // Only mess with the ticket data if removeConsoleData is true and if we're dealing with a personalized ticket (checked in removeConsoleDataFromTicket())
-    if (removeConsoleData) removeConsoleDataFromTicket(&rights_info);
+    progressUiThreadStop(&progressCtx);
     
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
-        goto out;
-    }
+    breaks = (progressCtx.line_offset + 2);
     
-    size_t wr = fwrite(&(rights_info.tik_data), 1, sizeof(rsa2048_sha256_ticket), outFile);
-    if (wr != sizeof(rsa2048_sha256_ticket))
+    if (proceed)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %u bytes long ticket data to \"%s\"! Wrote %lu bytes.", __func__, sizeof(rsa2048_sha256_ticket), dumpPath, wr);
-        removeFile = true;
-        goto out;
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
+        
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s! Rebuilt %u NSP(s).", progressCtx.etaInfo, rebuiltCnt);
+        
+        success = true;
+    } else {
+        setProgressBarError(&progressCtx);
+        breaks += 2;
+        
+        // Manifests and store objects are never removed, so nothing is lost - just run this again
+        if (rebuiltCnt) uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%u NSP(s) rebuilt before the error. These will be skipped next time.", rebuiltCnt);
     }
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully finished!");
-    breaks++;
-    
-    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Ticket saved to \"%s\".", dumpPath);
-    
-    success = true;
+    changeHomeButtonBlockStatus(false);
     
 out:
     breaks += 2;
     
-    if (outFile) fclose(outFile);
-    
-    if (!success && removeFile) remove(dumpPath);
-    
-    ncmContentStorageClose(&ncmStorage);
-    
-    if (titleContentInfos) free(titleContentInfos);
+    if (object) fclose(object);
+    if (manifest) fclose(manifest);
+    if (entries) free(entries);
     
-    if (dumpName) free(dumpName);
+    freeDirNameList(&list);
     
     return success;
 }
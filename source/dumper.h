@@ -5,6 +5,12 @@
 
 #include <switch.h>
 #include "util.h"
+#include "pipeline.h"
+#include "out_file.h"
+#include "cmp_file.h"
+#include "verify.h"
+#include "sink.h"
+#include "layeredfs_manifest.h"
 
 #define FAT32_FILESIZE_LIMIT            (u64)0xFFFFFFFF             // 4 GiB - 1 (4294967295 bytes)
 
@@ -16,6 +22,26 @@
 #define CERT_OFFSET                     0x7000
 #define CERT_SIZE                       0x200
 
+#define ROMFS_EXTRACT_MAX_GAP           (u64)0x10000                // 64 KiB (65536 bytes). Unused data is read between RomFS files closer than this, instead of issuing another read
+#define ROMFS_EXTRACT_INITIAL_ENTRY_CNT 256
+#define ROMFS_EXTRACT_NO_MANIFEST_ENTRY UINT32_MAX
+
+#define DUMPED_TITLES_MAGIC             (u32)0x54444E58             // "XNDT"
+
+#define DUMPED_TITLE_FLAG_OVERRIDE      0x01                        // Added by batch mode if "Remember dumped titles" is enabled. These titles are always excluded from the batch list
+
+#define DUMPED_TITLE_OUTPUT_FILE        0                           // Output is stored at NSP_DUMP_PATH + outputName, and it's checked before skipping the title
+#define DUMPED_TITLE_OUTPUT_EXTERNAL    1                           // Output doesn't stay on the SD card (sequential dump sessions), so it can't be checked
+
+#define DUMPED_TITLE_OUTPUT_NAME_LEN    0x100
+
+#define DUMPED_TITLE_OPT_REMOVE_CONSOLE_DATA    0x01
+#define DUMPED_TITLE_OPT_TIKLESS_DUMP           0x02
+#define DUMPED_TITLE_OPT_NPDM_ACID_RSA_PATCH    0x04
+#define DUMPED_TITLE_OPT_DELTA_FRAGMENTS        0x08
+
+#define NSP_BATCH_PREFETCH_SECTION_SIZE (u64)0x10000                // 64 KiB (65536 bytes). Prefetched from the start of each PFS0 / RomFS section parsed during the NSP setup
+
 typedef struct {
     bool keepCert;                                  // Original value for the "Keep certificate" option. Overrides the selected setting in the current session
     bool trimDump;                                  // Original value for the "Trim output dump" option. Overrides the selected setting in the current session
@@ -27,6 +53,64 @@ typedef struct {
     u32 certlessCrc;                                // CRC32 checksum accumulator (certless XCI). Only used if calcCrc == true
 } PACKED sequentialXciCtx;
 
+// Shared state for the XCI dump pipeline (gamecard reader thread -> CRC32 / hash verification thread -> SD card writer)
+typedef struct {
+    pipeline_ctx_t pipeCtx;
+    u64 *partitionSizes;                            // IStorage partition sizes (trimmed, if needed)
+    u32 startPartitionIndex;                        // IStorage partition index to start reading from
+    u64 startPartitionOffset;                       // IStorage partition offset to start reading from
+    u64 startOffset;                                // XCI offset to start reading from
+    u64 totalSize;                                  // Output dump size
+    u64 partSize;                                   // Part size. Only used if seqDumpMode == true
+    u64 blockSize;                                  // Pipeline buffer size
+    bool seqDumpMode;
+    bool keepCert;
+    bool trimDump;
+    bool calcCrc;
+    verify_ctx_t *verifyCtx;                        // HFS0 / NCA header hash verification context. NULL if disabled
+    bool seqDumpFinish;                             // Set by the reader thread if the current sequential dump session must be finished
+    bool openError;                                 // Set by the reader thread if an IStorage partition couldn't be opened
+    Result readResult;                              // Last IStorage result. Only valid if an error slot was produced
+    u32 certCrc;
+    u32 certlessCrc;
+    bool journal;                                   // Set if dump journal checkpoints are enabled
+    u32 journalCertCrc;                             // CRC32 checksum accumulators right after the last chunk that crossed a checkpoint boundary
+    u32 journalCertlessCrc;
+} xciPipelineCtx;
+
+// Shared state for the NSP dump pipeline (NCA reader + patcher on the main thread -> SHA-256 thread -> writer thread)
+typedef struct {
+    pipeline_ctx_t pipeCtx;
+    Sha256Context *hashCtx;                         // Current NCA SHA-256 checksum context
+    u32 hashEntryCnt;                               // Only PFS0 entries below this index are hashed (all NCAs except the CNMT NCA)
+    out_file_t *outFile;                            // Current output file. Owned by the writer thread while the pipeline is running
+    cmp_file_t *cmpFile;                            // Block-compressed output file. Used instead of outFile if not NULL
+    out_file_t *storeFile;                          // Current NCA store file. If not NULL, NCAs are written here and outFile holds the NSP manifest. Only used by the writer thread while the pipeline isn't idle
+    sink_ctx_t *sink;                               // USB / TCP host receiver. Used instead of outFile if not NULL
+    const char *dumpName;
+    char partPath[NAME_BUF_LEN];                    // Only used by the writer thread to create new part files
+    u8 splitIndex;                                  // Current part index. Updated by the writer thread with the pipeline mutex held
+    u64 partSize;
+    u64 totalSize;
+    bool seqDumpMode;
+    bool isFat32;
+    bool fat32Error;                                // Set by the writer thread if a write failed past FAT32_FILESIZE_LIMIT
+    char errorMsg[NAME_BUF_LEN];                    // Set by the writer thread before aborting the pipeline
+} nspPipelineCtx;
+
+// Used to load the NCA metadata from the next batch entry into the NCA cache while the current title is being written
+// It covers the NCA headers, the whole CNMT NCA and the PFS0 / RomFS headers from the Program, Control and LegalInformation NCAs
+// Decrypted NCA headers and key areas are also stored in the NCA metadata cache. Ticket lookup, CNMT parsing, XML generation and the PFS0 header still run on the main thread
+typedef struct {
+    pipeline_ctx_t pipeCtx;                         // Only used to manage the prefetch thread
+    NcmStorageId storageId;
+    NcmContentMetaType metaType;
+    u32 titleCount;
+    u32 ncmTitleIndex;
+    bool dumpDeltaFragments;
+    bool started;                                   // Set by dumpNintendoSubmissionPackage() once the prefetch thread is running
+} nspBatchPrefetchCtx;
+
 // This struct is followed by 'ncaCount' SHA-256 checksums in the output file and 'programNcaModCount' modified + reencrypted Program NCA headers
 // The modified NCA headers are only needed if their NPDM signature is replaced (it uses cryptographically secure random numbers). The RSA public key used in the ACID section from the main.npdm file is constant, so we don't need to keep track of that
 typedef struct {
@@ -44,6 +128,72 @@ typedef struct {
     Sha256Context hashCtx;                          // Current NCA SHA-256 checksum context. Only used when dealing with the same NCA between different parts
 } PACKED sequentialNspCtx;
 
+typedef struct {
+    char *romfsPath;                                // Directory path within the RomFS section
+    char *outputPath;                               // Output directory path
+    int dirLimitCounter;                            // Used to overcome issues related to the max entry count per directory in FAT32
+} romFsExtractDir;
+
+typedef struct {
+    romfs_file *entry;
+    u32 dirIndex;                                   // Parent directory index within the extraction plan
+    u32 manifestIndex;                              // Entry index within the LayeredFS manifest, or ROMFS_EXTRACT_NO_MANIFEST_ENTRY
+} romFsExtractFile;
+
+// Flat list of RomFS file entries to extract, sorted by data offset before reading anything
+typedef struct {
+    romFsExtractDir *dirs;
+    u32 dirCount;
+    u32 dirCapacity;
+    romFsExtractFile *files;
+    u32 fileCount;
+    u32 fileCapacity;
+    layeredfs_manifest_t *prevManifest;             // Manifest from the previous extraction. May be empty
+    layeredfs_manifest_t *manifest;                 // Manifest for the current extraction. NULL if we're not extracting to a LayeredFS directory
+    size_t basePathLen;                             // Extraction directory path length. Manifest paths are relative to it
+} romFsExtractPlan;
+
+// Records are appended to DUMPED_TITLES_PATH right after this header, every time a NSP dump is completed
+typedef struct {
+    u32 magic;                                      // DUMPED_TITLES_MAGIC
+    u32 recordSize;                                 // sizeof(dumped_title_record_t)
+} PACKED dumped_title_index_header_t;
+
+typedef struct {
+    u64 titleId;
+    u32 version;
+    u8 type;                                        // nspDumpType
+    u8 flags;                                       // DUMPED_TITLE_FLAG_*
+    u8 options;                                     // DUMPED_TITLE_OPT_* - dump options that change the output data
+    u8 outputType;                                  // DUMPED_TITLE_OUTPUT_*
+    u64 size;                                       // NSP size
+    u8 cnmtHash[SHA256_HASH_SIZE];                  // SHA-256 checksum of the CNMT NCA from the NSP, which holds the hashes from all the other NCAs
+    u64 outputSize;                                 // Size of the output file(s) on the SD card (compressed dump, NSP manifest, split parts...)
+    char outputName[DUMPED_TITLE_OUTPUT_NAME_LEN];  // Output filename, relative to NSP_DUMP_PATH. Not NULL terminated if it takes up the whole field
+} PACKED dumped_title_record_t;
+
+typedef struct {
+    dumped_title_record_t *records;                 // Sorted by dumpedTitleRecordCmp()
+    u32 recordCnt;
+} dumped_title_index_t;
+
+// Entry names from a single directory listing, sorted in case-insensitive order
+// Used to look for dumps and batch override files created before the dumped title index existed
+typedef struct {
+    char **names;
+    u32 nameCnt;
+} dir_name_list_t;
+
+// SD card output file for the restore / rebuild actions. If it doesn't fit in a FAT32 partition, it's stored as a directory with the archive bit set
+typedef struct {
+    out_file_t out;
+    char path[NAME_BUF_LEN];                                                    // Output file / split output directory
+    bool split;
+    u32 partIndex;
+    u64 offset;
+    u64 size;
+} split_output_t;
+
 typedef struct {
     bool enabled;
     nspDumpType titleType;
@@ -57,9 +207,9 @@ typedef struct {
 bool dumpNXCardImage(xciOptions *xciDumpCfg);
 int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleIndex, nspOptions *nspDumpCfg, bool batch);
 int dumpNintendoSubmissionPackageBatch(batchOptions *batchDumpCfg);
-bool dumpRawHfs0Partition(u32 partition, bool doSplitting);
-bool dumpHfs0PartitionData(u32 partition, bool doSplitting);
-bool dumpFileFromHfs0Partition(u32 partition, u32 fileIndex, char *filename, bool doSplitting);
+bool dumpRawHfs0Partition(u32 partition, bool doSplitting, bool verifyHashes, dumpOutputTarget outputTarget);
+bool dumpHfs0PartitionData(u32 partition, bool doSplitting, bool verifyHashes, dumpOutputTarget outputTarget);
+bool dumpFileFromHfs0Partition(u32 partition, u32 fileIndex, char *filename, bool doSplitting, bool verifyHashes, dumpOutputTarget outputTarget);
 bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDumpCfg);
 bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaFsOptions *exeFsDumpCfg);
 bool dumpRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg);
@@ -67,5 +217,7 @@ bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType
 bool dumpCurrentDirFromRomFsSection(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg);
 bool dumpGameCardCertificate();
 bool dumpTicketFromTitle(u32 titleIndex, selectedTicketType curTikType, ticketOptions *tikDumpCfg);
+bool restoreCompressedDumps(bool isFat32);
+bool rebuildNspFromManifests(bool isFat32);
 
 #endif
@@ -10,10 +10,74 @@
 #include "ff.h"			/* Obtains integer types */
 #include "diskio.h"		/* Declarations of disk functions */
 
+#include <string.h>
 #include <switch.h>
 
 extern FsStorage fatFsStorage;
 
+/* Read-ahead cache */
+/* FatFs issues lots of single sector reads while walking FAT chains and parsing savefiles, each one of them being a full fsStorageRead() IPC call */
+/* Sectors are read in aligned windows instead, and the most recently used windows are kept around */
+/* The BIS System partition is mounted in read-only mode, so cached data never goes stale while it's mounted */
+/* The windows are shared by every thread that ends up in disk_read(), so they're guarded by diskCacheMutex */
+
+#define DISK_CACHE_WINDOW_SECTORS   128                                         /* 64 KiB per window (512-byte sectors) */
+#define DISK_CACHE_WINDOW_CNT       4
+
+typedef struct {
+    DWORD sector;                                                               /* First sector in this window */
+    u64 last_use;                                                               /* LRU stamp - 0 means unused */
+    BYTE data[DISK_CACHE_WINDOW_SECTORS * FF_MAX_SS];
+} disk_cache_window_t;
+
+static disk_cache_window_t diskCacheWindows[DISK_CACHE_WINDOW_CNT];
+static u64 diskCacheTick = 0;
+static Mutex diskCacheMutex = 0;
+
+void disk_cache_invalidate (void)
+{
+    mutexLock(&diskCacheMutex);
+    memset(diskCacheWindows, 0, sizeof(diskCacheWindows));
+    diskCacheTick = 0;
+    mutexUnlock(&diskCacheMutex);
+}
+
+/* Must be called with diskCacheMutex locked */
+
+static disk_cache_window_t *disk_cache_get_window (
+    DWORD sector
+)
+{
+    UINT i;
+    DWORD window_sector = (sector - (sector % DISK_CACHE_WINDOW_SECTORS));
+    disk_cache_window_t *lru = &(diskCacheWindows[0]), *win = NULL;
+    Result rc = 0;
+    
+    for(i = 0; i < DISK_CACHE_WINDOW_CNT; i++)
+    {
+        win = &(diskCacheWindows[i]);
+        
+        if (win->last_use && win->sector == window_sector)
+        {
+            win->last_use = ++diskCacheTick;
+            return win;
+        }
+        
+        if (win->last_use < lru->last_use) lru = win;
+    }
+    
+    win = lru;
+    win->last_use = 0;
+    
+    rc = fsStorageRead(&fatFsStorage, (s64)FF_MAX_SS * window_sector, win->data, FF_MAX_SS * DISK_CACHE_WINDOW_SECTORS);
+    if (R_FAILED(rc)) return NULL;
+    
+    win->sector = window_sector;
+    win->last_use = ++diskCacheTick;
+    
+    return win;
+}
+
 /*-----------------------------------------------------------------------*/
 /* Get Drive Status                                                      */
 /*-----------------------------------------------------------------------*/
@@ -56,11 +120,44 @@ DRESULT disk_read (
 )
 {
     (void)pdrv;
-    (void)buff;
-    (void)sector;
-    (void)count;
     
-    Result rc = fsStorageRead(&fatFsStorage, FF_MAX_SS * sector, buff, FF_MAX_SS * count);
+    Result rc = 0;
+    disk_cache_window_t *win = NULL;
+    DWORD win_offset, win_count;
+    
+    /* Big reads (e.g. contiguous cluster runs) go straight to the storage */
+    if (count >= DISK_CACHE_WINDOW_SECTORS) goto direct;
+    
+    /* Windows are copied with the lock held, so they can't be evicted by another thread halfway through */
+    mutexLock(&diskCacheMutex);
+    
+    while(count > 0)
+    {
+        win = disk_cache_get_window(sector);
+        if (!win)
+        {
+            /* Window read failed (e.g. past the end of the partition) - let the storage handle the exact request */
+            mutexUnlock(&diskCacheMutex);
+            goto direct;
+        }
+        
+        win_offset = (sector - win->sector);
+        win_count = (DISK_CACHE_WINDOW_SECTORS - win_offset);
+        if (win_count > count) win_count = count;
+        
+        memcpy(buff, win->data + (win_offset * FF_MAX_SS), win_count * FF_MAX_SS);
+        
+        buff += (win_count * FF_MAX_SS);
+        sector += win_count;
+        count -= win_count;
+    }
+    
+    mutexUnlock(&diskCacheMutex);
+    
+    return RES_OK;
+    
+direct:
+    rc = fsStorageRead(&fatFsStorage, (s64)FF_MAX_SS * sector, buff, FF_MAX_SS * count);
     if (R_FAILED(rc)) return RES_ERROR;
     
     return RES_OK;
@@ -32,6 +32,9 @@ DRESULT disk_read (BYTE pdrv, BYTE* buff, DWORD sector, UINT count);
 DRESULT disk_write (BYTE pdrv, const BYTE* buff, DWORD sector, UINT count);
 DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void* buff);
 
+/* Drops all sectors cached by disk_read() */
+void disk_cache_invalidate (void);
+
 
 /* Disk Status Bits (DSTATUS) */
 
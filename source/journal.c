@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "journal.h"
+#include "crc32_fast.h"
+
+static void dumpJournalGetTmpPath(const char *path, char *outPath, size_t outPathSize)
+{
+    snprintf(outPath, outPathSize, "%s%s", path, DUMP_JOURNAL_TMP_EXTENSION);
+}
+
+void dumpJournalSetTail(dump_journal_header *header, const u8 *chunk, u64 chunkSize)
+{
+    if (!header) return;
+    
+    u64 tailSize = DUMP_JOURNAL_TAIL_SIZE;
+    if (tailSize > chunkSize) tailSize = chunkSize;
+    if (tailSize > header->partOffset) tailSize = header->partOffset;
+    
+    u32 tailCrc = 0;
+    if (chunk && tailSize) crc32(chunk + (chunkSize - tailSize), tailSize, &tailCrc);
+    
+    header->tailSize = (u32)tailSize;
+    header->tailCrc = tailCrc;
+}
+
+bool dumpJournalSave(const char *path, dump_journal_header *header, const void *payload, u32 payloadSize)
+{
+    if (!path || !header || (payloadSize && !payload)) return false;
+    
+    char tmpPath[NAME_BUF_LEN] = {'\0'};
+    size_t write_res;
+    u32 payloadCrc = 0;
+    bool success = false;
+    
+    if (payloadSize) crc32(payload, payloadSize, &payloadCrc);
+    
+    header->magic = DUMP_JOURNAL_MAGIC;
+    header->version = DUMP_JOURNAL_VERSION;
+    header->payloadSize = payloadSize;
+    header->payloadCrc = payloadCrc;
+    
+    dumpJournalGetTmpPath(path, tmpPath, MAX_CHARACTERS(tmpPath));
+    
+    FILE *journalFile = fopen(tmpPath, "wb");
+    if (!journalFile) return false;
+    
+    write_res = fwrite(header, 1, sizeof(dump_journal_header), journalFile);
+    if (write_res == sizeof(dump_journal_header))
+    {
+        write_res = (payloadSize ? fwrite(payload, 1, payloadSize, journalFile) : 0);
+        success = (write_res == payloadSize);
+    }
+    
+    if (fclose(journalFile) != 0) success = false;
+    
+    if (!success)
+    {
+        remove(tmpPath);
+        return false;
+    }
+    
+    // The previous checkpoint is only replaced once the new one has been completely written
+    // If we crash right after removing it, dumpJournalLoad() picks up the temporary file
+    remove(path);
+    
+    return (rename(tmpPath, path) == 0);
+}
+
+void *dumpJournalLoad(const char *path, u8 type, dump_journal_header *outHeader)
+{
+    if (!path || !outHeader) return NULL;
+    
+    char tmpPath[NAME_BUF_LEN] = {'\0'};
+    dump_journal_header header;
+    u8 *payload = NULL;
+    size_t read_res;
+    u32 payloadCrc = 0;
+    
+    dumpJournalGetTmpPath(path, tmpPath, MAX_CHARACTERS(tmpPath));
+    
+    if (!checkIfFileExists(path))
+    {
+        if (!checkIfFileExists(tmpPath) || rename(tmpPath, path) != 0) return NULL;
+    } else {
+        // The previous checkpoint is still there, so the temporary file may be incomplete
+        remove(tmpPath);
+    }
+    
+    FILE *journalFile = fopen(path, "rb");
+    if (!journalFile) return NULL;
+    
+    read_res = fread(&header, 1, sizeof(dump_journal_header), journalFile);
+    if (read_res != sizeof(dump_journal_header) || header.magic != DUMP_JOURNAL_MAGIC || header.version != DUMP_JOURNAL_VERSION || header.type != type || !header.payloadSize || header.offset >= header.totalSize)
+    {
+        fclose(journalFile);
+        return NULL;
+    }
+    
+    payload = malloc(header.payloadSize);
+    if (!payload)
+    {
+        fclose(journalFile);
+        return NULL;
+    }
+    
+    read_res = fread(payload, 1, header.payloadSize, journalFile);
+    
+    fclose(journalFile);
+    
+    if (read_res == header.payloadSize) crc32(payload, header.payloadSize, &payloadCrc);
+    
+    if (read_res != header.payloadSize || payloadCrc != header.payloadCrc)
+    {
+        free(payload);
+        return NULL;
+    }
+    
+    memcpy(outHeader, &header, sizeof(dump_journal_header));
+    
+    return payload;
+}
+
+bool dumpJournalCheckTail(const dump_journal_header *header, const char *partPath)
+{
+    if (!header || !partPath || header->tailSize > header->partOffset) return false;
+    
+    u8 *tailBuf = NULL;
+    size_t read_res;
+    u64 partFileSize;
+    u32 tailCrc = 0;
+    bool success = false;
+    
+    FILE *partFile = fopen(partPath, "rb");
+    if (!partFile) return false;
+    
+    fseek(partFile, 0, SEEK_END);
+    partFileSize = (u64)ftell(partFile);
+    
+    if (partFileSize < header->partOffset)
+    {
+        fclose(partFile);
+        return false;
+    }
+    
+    if (!header->tailSize)
+    {
+        fclose(partFile);
+        return true;
+    }
+    
+    tailBuf = malloc(header->tailSize);
+    if (!tailBuf)
+    {
+        fclose(partFile);
+        return false;
+    }
+    
+    fseek(partFile, (long)(header->partOffset - header->tailSize), SEEK_SET);
+    read_res = fread(tailBuf, 1, header->tailSize, partFile);
+    
+    fclose(partFile);
+    
+    if (read_res == header->tailSize)
+    {
+        crc32(tailBuf, header->tailSize, &tailCrc);
+        success = (tailCrc == header->tailCrc);
+    }
+    
+    free(tailBuf);
+    
+    return success;
+}
+
+void dumpJournalRemove(const char *path)
+{
+    if (!path) return;
+    
+    char tmpPath[NAME_BUF_LEN] = {'\0'};
+    dumpJournalGetTmpPath(path, tmpPath, MAX_CHARACTERS(tmpPath));
+    
+    remove(path);
+    remove(tmpPath);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#ifndef __JOURNAL_H__
+#define __JOURNAL_H__
+
+#include <switch.h>
+
+#include "util.h"
+
+#define DUMP_JOURNAL_MAGIC          (u32)0x4C4E4A58     // "XJNL"
+#define DUMP_JOURNAL_VERSION        1
+#define DUMP_JOURNAL_EXTENSION      ".jnl"
+#define DUMP_JOURNAL_TMP_EXTENSION  ".tmp"
+
+#define DUMP_JOURNAL_INTERVAL       (u64)0x10000000     // 256 MiB. A checkpoint is saved every time the dump offset crosses a multiple of this value
+#define DUMP_JOURNAL_TAIL_SIZE      (u64)0x10000        // 64 KiB. Output data right before the checkpoint, read back to verify it before resuming
+
+#define DUMP_JOURNAL_FLAG_FAT32         BIT(0)          // Split output dump
+#define DUMP_JOURNAL_FLAG_ARCHIVE_BIT   BIT(1)          // Split output parts are stored in a directory with the archive bit set (XCI only)
+
+/*
+ * Dump journal layout ("<dump>.xci.jnl" / "<dump>.nsp.jnl"):
+ *
+ * 0x00: dump_journal_header
+ * 0x40: payload (payloadSize bytes)
+ *     - XCI: sequentialXciCtx (partNumber holds the current part number, not the next one).
+ *     - NSP: same layout as a sequential dump reference file (sequentialNspCtx, NCA SHA-256 checksums and modified Program NCA headers).
+ *
+ * The output data is flushed before each checkpoint is saved. Journals are written to a temporary file first, which then replaces the previous journal.
+ */
+
+typedef enum {
+    DUMP_JOURNAL_TYPE_XCI = 0,
+    DUMP_JOURNAL_TYPE_NSP
+} dumpJournalType;
+
+typedef struct {
+    u32 magic;                                                                  // DUMP_JOURNAL_MAGIC
+    u32 version;                                                                // DUMP_JOURNAL_VERSION
+    u8 type;                                                                    // dumpJournalType
+    u8 flags;                                                                   // DUMP_JOURNAL_FLAG_*
+    u8 partIndex;                                                               // Current output part. Always zero if the output dump isn't split
+    u8 reserved1;
+    u32 payloadSize;
+    u64 totalSize;                                                              // Output dump size
+    u64 offset;                                                                 // Dump offset to resume from. Everything before it has already been written to the SD card
+    u64 partOffset;                                                             // Offset within the current output part
+    u32 tailSize;
+    u32 tailCrc;                                                                // CRC32 checksum of the last tailSize bytes before partOffset
+    u32 payloadCrc;
+    u8 reserved2[0xC];
+} PACKED dump_journal_header;
+
+/* Returns true if a chunk crosses a checkpoint boundary. */
+static inline bool dumpJournalCheckpointCrossed(u64 offset, u64 size)
+{
+    return (size > 0 && ((offset + size) / DUMP_JOURNAL_INTERVAL) > (offset / DUMP_JOURNAL_INTERVAL));
+}
+
+/* Calculates the tail checksum from the last chunk written to the current output part. header->partOffset must already be set. */
+void dumpJournalSetTail(dump_journal_header *header, const u8 *chunk, u64 chunkSize);
+
+/* Saves a checkpoint. The magic word, version, payload size and payload checksum are filled in by this function. */
+bool dumpJournalSave(const char *path, dump_journal_header *header, const void *payload, u32 payloadSize);
+
+/* Loads a journal of the provided type, falling back to a leftover temporary file if needed. Returns a heap allocated payload, or NULL if there's no valid journal. */
+void *dumpJournalLoad(const char *path, u8 type, dump_journal_header *outHeader);
+
+/* Reads back the tail data from the current output part and checks it against the saved checksum. */
+bool dumpJournalCheckTail(const dump_journal_header *header, const char *partPath);
+
+/* Removes the journal and its temporary file. */
+void dumpJournalRemove(const char *path);
+
+#endif
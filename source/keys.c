@@ -5,10 +5,12 @@
 
 #include "fatfs/ff.h"
 #include "keys.h"
+#include "nca_meta.h"
 #include "util.h"
 #include "ui.h"
 #include "es.h"
 #include "save.h"
+#include "pipeline.h"
 
 /* Extern variables */
 
@@ -26,6 +28,8 @@ nca_keyset_t nca_keyset;
 static SetCalRsa2048DeviceKey eticket_data;
 static bool setcal_eticket_retrieved = false;
 
+static eticket_save_index_t eticket_save_index[2]; // 0 = Common, 1 = Personalized
+
 static keyLocation FSRodata = {
     FS_TID,
     SEG_RODATA,
@@ -191,26 +195,54 @@ bool retrieveProcessMemory(keyLocation *location)
         return success;
     }
     
-    addr = last_text_addr;
-
-    for(segment = 1; segment < BIT(3);)
+    // Walk the selected segments twice: the first pass only measures their total size, so the key location data buffer is allocated just once
+    u8 pass;
+    u64 dataSize = 0;
+    
+    for(pass = 0; pass < 2 && success; pass++)
     {
-        result = svcQueryDebugProcessMemory(&mem_info, &page_info, debug_handle, addr);
-        if (R_FAILED(result))
+        addr = last_text_addr;
+        
+        for(segment = 1; segment < BIT(3);)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: svcQueryDebugProcessMemory failed! (0x%08X)", __func__, result);
-            success = false;
-            break;
+            result = svcQueryDebugProcessMemory(&mem_info, &page_info, debug_handle, addr);
+            if (R_FAILED(result))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: svcQueryDebugProcessMemory failed! (0x%08X)", __func__, result);
+                success = false;
+                break;
+            }
+            
+            // Weird code to allow for bitmasking segments
+            if ((mem_info.perm & Perm_R) && ((mem_info.type & 0xFF) >= MemType_CodeStatic) && ((mem_info.type & 0xFF) < MemType_Heap) && ((segment <<= 1) >> 1 & location->mask) > 0)
+            {
+                if (!pass)
+                {
+                    dataSize += mem_info.size;
+                } else {
+                    result = svcReadDebugProcessMemory(location->data + location->dataSize, debug_handle, mem_info.addr, mem_info.size);
+                    if (R_FAILED(result))
+                    {
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: svcReadDebugProcessMemory failed! (0x%08X)", __func__, result);
+                        success = false;
+                        break;
+                    }
+                    
+                    location->dataSize += mem_info.size;
+                }
+            }
+            
+            addr = (mem_info.addr + mem_info.size);
+            if (addr == 0) break;
         }
         
-        // Weird code to allow for bitmasking segments
-        if ((mem_info.perm & Perm_R) && ((mem_info.type & 0xFF) >= MemType_CodeStatic) && ((mem_info.type & 0xFF) < MemType_Heap) && ((segment <<= 1) >> 1 & location->mask) > 0)
+        if (!pass && success && dataSize)
         {
             // If location->data == NULL, realloc will essentially act as a malloc
-            dataTmp = realloc(location->data, location->dataSize + mem_info.size);
+            dataTmp = realloc(location->data, location->dataSize + dataSize);
             if (!dataTmp)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to resize key location data buffer to %lu bytes.", __func__, location->dataSize + mem_info.size);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to resize key location data buffer to %lu bytes.", __func__, location->dataSize + dataSize);
                 success = false;
                 break;
             }
@@ -218,21 +250,8 @@ bool retrieveProcessMemory(keyLocation *location)
             location->data = dataTmp;
             dataTmp = NULL;
             
-            memset(location->data + location->dataSize, 0, mem_info.size);
-            
-            result = svcReadDebugProcessMemory(location->data + location->dataSize, debug_handle, mem_info.addr, mem_info.size);
-            if (R_FAILED(result))
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: svcReadDebugProcessMemory failed! (0x%08X)", __func__, result);
-                success = false;
-                break;
-            }
-            
-            location->dataSize += mem_info.size;
+            memset(location->data + location->dataSize, 0, dataSize);
         }
-        
-        addr = (mem_info.addr + mem_info.size);
-        if (addr == 0) break;
     }
     
     svcCloseHandle(debug_handle);
@@ -245,79 +264,245 @@ bool retrieveProcessMemory(keyLocation *location)
     return success;
 }
 
-bool findKeyInProcessMemory(const keyLocation *location, const keyInfo *findKey, u8 *out)
+static void keyScanWorker(void *arg)
 {
-    if (!location || !location->data || !location->dataSize || !findKey || !strlen(findKey->name) || !findKey->size)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to locate key in process memory.", __func__);
-        return false;
-    }
+    keyScanJob *job = (keyScanJob*)arg;
+    if (!job) return;
     
     u64 i;
+    u32 j, mask;
+    u32 allMask = (u32)(BIT(job->keyCnt) - 1);
+    u64 hashedSize;
     u8 temp_hash[SHA256_HASH_SIZE];
-    bool found = false;
     
-    // Hash every key-length-sized byte chunk in data until it matches a key hash
-    for(i = 0; i < location->dataSize; i++)
+    // Hash every key-length-sized byte chunk in our range until all keys have been found (by us or by another job)
+    for(i = job->start; i < job->end; i++)
     {
-        if (!found && (location->dataSize - i) < findKey->size) break;
+        mask = __atomic_load_n(job->foundMask, __ATOMIC_ACQUIRE);
+        if (mask == allMask) break;
         
-        sha256CalculateHash(temp_hash, location->data + i, findKey->size);
+        hashedSize = 0;
         
-        if (!memcmp(temp_hash, findKey->hash, SHA256_HASH_SIZE))
+        for(j = 0; j < job->keyCnt; j++)
         {
-            // Jackpot
-            memcpy(out, location->data + i, findKey->size);
-            found = true;
-            break;
+            if ((mask & BIT(j)) || (job->location->dataSize - i) < job->keys[j]->size) continue;
+            
+            // Keys with the same size can share the same hash
+            if (hashedSize != job->keys[j]->size)
+            {
+                sha256CalculateHash(temp_hash, job->location->data + i, job->keys[j]->size);
+                hashedSize = job->keys[j]->size;
+            }
+            
+            if (!memcmp(temp_hash, job->keys[j]->hash, SHA256_HASH_SIZE))
+            {
+                // Jackpot
+                if (!(__atomic_fetch_or(job->foundMask, BIT(j), __ATOMIC_ACQ_REL) & BIT(j))) job->offsets[j] = i;
+            }
         }
     }
-    
-    if (!found) uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to locate key \"%s\" in process memory!", __func__, findKey->name);
-    
-    return found;
 }
 
-bool findFSRodataKeys(keyLocation *location)
+bool findKeysInProcessMemory(const keyLocation *location, const keyInfo **keys, u32 keyCnt, u64 *offsets)
 {
-    if (!location || location->titleID != FS_TID || location->mask != SEG_RODATA || !location->data || !location->dataSize)
+    if (!location || !location->data || !location->dataSize || !keys || !keyCnt || keyCnt > KEY_LOCATION_MAX_KEYS || !offsets)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to locate keys in FS .rodata segment.", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to locate keys in process memory.", __func__);
         return false;
     }
     
-    if (!findKeyInProcessMemory(location, &header_kek_source, nca_keyset.header_kek_source)) return false;
-    nca_keyset.memory_key_cnt++;
+    u32 i;
+    u32 pendingMask = 0;
+    volatile u32 foundMask = 0;
     
-    if (!findKeyInProcessMemory(location, &key_area_key_application_source, nca_keyset.key_area_key_application_source)) return false;
-    nca_keyset.memory_key_cnt++;
+    pipeline_ctx_t threadCtx;
+    keyScanJob jobs[KEY_SCAN_WORKER_CNT + 1];
+    u64 chunkSize = ((location->dataSize + KEY_SCAN_WORKER_CNT) / (KEY_SCAN_WORKER_CNT + 1));
     
-    if (!findKeyInProcessMemory(location, &key_area_key_ocean_source, nca_keyset.key_area_key_ocean_source)) return false;
-    nca_keyset.memory_key_cnt++;
+    for(i = 0; i < keyCnt; i++)
+    {
+        if (!keys[i] || !strlen(keys[i]->name) || !keys[i]->size)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to locate keys in process memory.", __func__);
+            return false;
+        }
+        
+        // Keys that were already found (e.g. through the key offset cache) are skipped
+        if (offsets[i] == KEY_OFFSET_INVALID)
+        {
+            pendingMask |= BIT(i);
+        } else {
+            foundMask |= BIT(i);
+        }
+    }
     
-    if (!findKeyInProcessMemory(location, &key_area_key_system_source, nca_keyset.key_area_key_system_source)) return false;
-    nca_keyset.memory_key_cnt++;
+    if (!pendingMask) return true;
+    
+    // We only borrow the worker thread management from the pipeline code - no slots are used here
+    memset(&threadCtx, 0, sizeof(pipeline_ctx_t));
+    
+    for(i = 0; i <= KEY_SCAN_WORKER_CNT; i++)
+    {
+        jobs[i].location = location;
+        jobs[i].keys = keys;
+        jobs[i].keyCnt = keyCnt;
+        jobs[i].start = (chunkSize * i);
+        jobs[i].end = (i < KEY_SCAN_WORKER_CNT ? (chunkSize * (i + 1)) : location->dataSize);
+        if (jobs[i].start > location->dataSize) jobs[i].start = location->dataSize;
+        if (jobs[i].end > location->dataSize) jobs[i].end = location->dataSize;
+        jobs[i].offsets = offsets;
+        jobs[i].foundMask = &foundMask;
+    }
+    
+    for(i = 1; i <= KEY_SCAN_WORKER_CNT; i++)
+    {
+        // Scan the chunk ourselves if the worker thread couldn't be started
+        if (!pipelineStartWorker(&threadCtx, keyScanWorker, &(jobs[i]))) keyScanWorker(&(jobs[i]));
+    }
+    
+    keyScanWorker(&(jobs[0]));
+    
+    pipelineJoinWorkers(&threadCtx);
+    
+    for(i = 0; i < keyCnt; i++)
+    {
+        if (!(foundMask & BIT(i)))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to locate key \"%s\" in process memory!", __func__, keys[i]->name);
+            return false;
+        }
+    }
     
     return true;
 }
 
+static bool checkCachedKeyOffset(const keyLocation *location, const keyInfo *findKey, u64 offset)
+{
+    if (offset == KEY_OFFSET_INVALID || offset >= location->dataSize || (location->dataSize - offset) < findKey->size) return false;
+    
+    u8 temp_hash[SHA256_HASH_SIZE];
+    
+    sha256CalculateHash(temp_hash, location->data + offset, findKey->size);
+    
+    return (memcmp(temp_hash, findKey->hash, SHA256_HASH_SIZE) == 0);
+}
+
+/* Checks the cached key offsets with a single hash per key, and only scans the segment data for keys whose cached offset didn't match. */
+/* Returns false if any key couldn't be found. Offsets are updated in place, and *updated is set if the cache needs to be written back. */
+static bool findKeysWithOffsetCache(const keyLocation *location, const keyInfo **keys, u32 keyCnt, keyLocationOffsets *cache, bool *updated)
+{
+    u32 i;
+    
+    if (cache->dataSize != location->dataSize)
+    {
+        cache->dataSize = location->dataSize;
+        for(i = 0; i < KEY_LOCATION_MAX_KEYS; i++) cache->offsets[i] = KEY_OFFSET_INVALID;
+        *updated = true;
+    }
+    
+    for(i = 0; i < keyCnt; i++)
+    {
+        if (checkCachedKeyOffset(location, keys[i], cache->offsets[i])) continue;
+        
+        cache->offsets[i] = KEY_OFFSET_INVALID;
+        *updated = true;
+    }
+    
+    return findKeysInProcessMemory(location, keys, keyCnt, cache->offsets);
+}
+
+static void loadKeyOffsetCache(keyOffsetCache *cache)
+{
+    u32 i;
+    
+    memset(cache, 0, sizeof(keyOffsetCache));
+    
+    for(i = 0; i < KEY_LOCATION_MAX_KEYS; i++)
+    {
+        cache->rodata.offsets[i] = KEY_OFFSET_INVALID;
+        cache->data.offsets[i] = KEY_OFFSET_INVALID;
+    }
+    
+    FILE *cacheFile = fopen(KEY_OFFSETS_PATH, "rb");
+    if (!cacheFile) return;
+    
+    keyOffsetCache tmpCache;
+    size_t read_res = fread(&tmpCache, 1, sizeof(keyOffsetCache), cacheFile);
+    fclose(cacheFile);
+    
+    // Discard the cache if it was generated under a different firmware version
+    if (read_res != sizeof(keyOffsetCache) || tmpCache.magic != KEY_OFFSET_CACHE_MAGIC || tmpCache.hosVersion != hosversionGet())
+    {
+        remove(KEY_OFFSETS_PATH);
+        return;
+    }
+    
+    memcpy(cache, &tmpCache, sizeof(keyOffsetCache));
+}
+
+static void saveKeyOffsetCache(keyOffsetCache *cache)
+{
+    cache->magic = KEY_OFFSET_CACHE_MAGIC;
+    cache->hosVersion = hosversionGet();
+    
+    FILE *cacheFile = fopen(KEY_OFFSETS_PATH, "wb");
+    if (!cacheFile) return;
+    
+    size_t write_res = fwrite(cache, 1, sizeof(keyOffsetCache), cacheFile);
+    fclose(cacheFile);
+    
+    if (write_res != sizeof(keyOffsetCache)) remove(KEY_OFFSETS_PATH);
+}
+
 bool loadMemoryKeys()
 {
     if (nca_keyset.memory_key_cnt > 0) return true;
     
     Result result;
-    bool proceed;
+    bool proceed, updated = false;
+    u32 i;
+    
+    keyOffsetCache cache;
+    
+    const keyInfo *rodataKeys[] = { &header_kek_source, &key_area_key_application_source, &key_area_key_ocean_source, &key_area_key_system_source };
+    u8 *rodataOut[] = { nca_keyset.header_kek_source, nca_keyset.key_area_key_application_source, nca_keyset.key_area_key_ocean_source, nca_keyset.key_area_key_system_source };
+    
+    const keyInfo *dataKeys[] = { &header_key_source };
+    u8 *dataOut[] = { nca_keyset.header_key_source };
+    
+    loadKeyOffsetCache(&cache);
     
     if (!retrieveProcessMemory(&FSRodata)) return false;
-    proceed = findFSRodataKeys(&FSRodata);
+    
+    proceed = findKeysWithOffsetCache(&FSRodata, rodataKeys, MAX_ELEMENTS(rodataKeys), &(cache.rodata), &updated);
+    if (proceed)
+    {
+        for(i = 0; i < MAX_ELEMENTS(rodataKeys); i++)
+        {
+            memcpy(rodataOut[i], FSRodata.data + cache.rodata.offsets[i], rodataKeys[i]->size);
+            nca_keyset.memory_key_cnt++;
+        }
+    }
+    
     freeProcessMemory(&FSRodata);
     if (!proceed) return false;
     
     if (!retrieveProcessMemory(&FSData)) return false;
-    proceed = findKeyInProcessMemory(&FSData, &header_key_source, nca_keyset.header_key_source);
+    
+    proceed = findKeysWithOffsetCache(&FSData, dataKeys, MAX_ELEMENTS(dataKeys), &(cache.data), &updated);
+    if (proceed)
+    {
+        for(i = 0; i < MAX_ELEMENTS(dataKeys); i++)
+        {
+            memcpy(dataOut[i], FSData.data + cache.data.offsets[i], dataKeys[i]->size);
+            nca_keyset.memory_key_cnt++;
+        }
+    }
+    
     freeProcessMemory(&FSData);
     if (!proceed) return false;
-    nca_keyset.memory_key_cnt++;
+    
+    if (updated) saveKeyOffsetCache(&cache);
     
     // Derive NCA header key
     result = splCryptoInitialize();
@@ -362,11 +547,11 @@ bool loadMemoryKeys()
     return true;
 }
 
-bool decryptNcaKeyArea(nca_header_t *dec_nca_header, u8 *out)
+bool decryptNcaKeyAreaEx(nca_header_t *dec_nca_header, u8 *out, char *errorBuf, size_t errorBufSize)
 {
-    if (!dec_nca_header || dec_nca_header->kaek_ind > 2 || !out)
+    if (!dec_nca_header || dec_nca_header->kaek_ind > 2 || !out || !errorBuf || !errorBufSize)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to decrypt NCA key area.", __func__);
+        if (errorBuf && errorBufSize) snprintf(errorBuf, errorBufSize, "%s: invalid parameters to decrypt NCA key area.", __func__);
         return false;
     }
     
@@ -378,7 +563,7 @@ bool decryptNcaKeyArea(nca_header_t *dec_nca_header, u8 *out)
     u8 crypto_type = (dec_nca_header->crypto_type2 > dec_nca_header->crypto_type ? dec_nca_header->crypto_type2 : dec_nca_header->crypto_type);
     if (crypto_type > 0x20)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NCA keyblob index!", __func__);
+        snprintf(errorBuf, errorBufSize, "%s: invalid NCA keyblob index!", __func__);
         return false;
     }
     
@@ -387,14 +572,14 @@ bool decryptNcaKeyArea(nca_header_t *dec_nca_header, u8 *out)
     result = splCryptoInitialize();
     if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to initialize the spl:crypto service! (0x%08X)", __func__, result);
+        snprintf(errorBuf, errorBufSize, "%s: failed to initialize the spl:crypto service! (0x%08X)", __func__, result);
         return false;
     }
     
     result = splCryptoGenerateAesKek(kek_source, crypto_type, 0, tmp_kek);
     if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: splCryptoGenerateAesKek(kek_source) failed! (0x%08X)", __func__, result);
+        snprintf(errorBuf, errorBufSize, "%s: splCryptoGenerateAesKek(kek_source) failed! (0x%08X)", __func__, result);
         splCryptoExit();
         return false;
     }
@@ -407,7 +592,7 @@ bool decryptNcaKeyArea(nca_header_t *dec_nca_header, u8 *out)
         result = splCryptoGenerateAesKey(tmp_kek, dec_nca_header->nca_keys[i], decrypted_nca_keys[i]);
         if (R_FAILED(result))
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: splCryptoGenerateAesKey(nca_kaek_%02u) failed! (0x%08X)", __func__, i, result);
+            snprintf(errorBuf, errorBufSize, "%s: splCryptoGenerateAesKey(nca_kaek_%02u) failed! (0x%08X)", __func__, i, result);
             success = false;
             break;
         }
@@ -420,6 +605,16 @@ bool decryptNcaKeyArea(nca_header_t *dec_nca_header, u8 *out)
     return success;
 }
 
+bool decryptNcaKeyArea(nca_header_t *dec_nca_header, u8 *out)
+{
+    char errorMsg[NAME_BUF_LEN] = {'\0'};
+    
+    bool success = decryptNcaKeyAreaEx(dec_nca_header, out, errorMsg, MAX_CHARACTERS(errorMsg));
+    if (!success) uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s", errorMsg);
+    
+    return success;
+}
+
 /**
  * Reads a line from file f and parses out the key and value from it.
  * The format of a line must match /^ *[A-Za-z0-9_] *[,=] *.+$/.
@@ -763,56 +958,89 @@ void mgf1(const u8 *data, size_t data_length, u8 *mask, size_t mask_length)
     free(data_counter);
 }
 
-int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_enc_key, u8 *out_dec_key)
+static int eticketSaveIndexEntryCmp(const void *a, const void *b)
 {
-    int ret = -1;
+    return memcmp((const u8*)a + ETICKET_RIGHTSID_OFFSET, (const u8*)b + ETICKET_RIGHTSID_OFFSET, 0x10);
+}
+
+static int eticketSaveIndexKeyCmp(const void *key, const void *elem)
+{
+    return memcmp(key, (const u8*)elem + ETICKET_RIGHTSID_OFFSET, 0x10);
+}
+
+static int rightsIdCmp(const void *a, const void *b)
+{
+    return memcmp(((const FsRightsId*)a)->c, ((const FsRightsId*)b)->c, 0x10);
+}
+
+static void freeEticketSaveIndexEntry(eticket_save_index_t *index)
+{
+    if (index->tickets) free(index->tickets);
+    memset(index, 0, sizeof(eticket_save_index_t));
+}
+
+void freeEticketSaveIndex()
+{
+    freeEticketSaveIndexEntry(&(eticket_save_index[0]));
+    freeEticketSaveIndexEntry(&(eticket_save_index[1]));
+}
+
+static bool retrieveEsRightsIds(bool personalized, FsRightsId **out_rights_ids, u32 *out_count)
+{
+    Result result;
+    u32 count = 0, ids_written = 0;
+    FsRightsId *rights_ids = NULL;
     
-    if (!dec_nca_header || dec_nca_header->kaek_ind > 2 || (!out_tik && !out_dec_key && !out_enc_key))
+    *out_rights_ids = NULL;
+    *out_count = 0;
+    
+    result = (!personalized ? esCountCommonTicket(&count) : esCountPersonalizedTicket(&count));
+    if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to retrieve NCA ticket and/or titlekey.", __func__);
-        return ret;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: esCount%sTicket failed! (0x%08X)", __func__, (!personalized ? "Common" : "Personalized"), result);
+        return false;
     }
     
-    u32 i, j;
-    bool has_rights_id = false;
+    if (!count) return true;
     
-    for(i = 0; i < 0x10; i++)
+    rights_ids = calloc(count, sizeof(FsRightsId));
+    if (!rights_ids)
     {
-        if (dec_nca_header->rights_id[i] != 0)
-        {
-            has_rights_id = true;
-            break;
-        }
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for %s tickets' rights IDs!", __func__, (!personalized ? "common" : "personalized"));
+        return false;
     }
     
-    if (!has_rights_id)
+    result = (!personalized ? esListCommonTicket(&ids_written, rights_ids, count * sizeof(FsRightsId)) : esListPersonalizedTicket(&ids_written, rights_ids, count * sizeof(FsRightsId)));
+    if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: NCA doesn't use titlekey crypto.", __func__);
-        return ret;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: esList%sTicket failed! (0x%08X)", __func__, (!personalized ? "Common" : "Personalized"), result);
+        free(rights_ids);
+        return false;
     }
     
-    u8 crypto_type = (dec_nca_header->crypto_type2 > dec_nca_header->crypto_type ? dec_nca_header->crypto_type2 : dec_nca_header->crypto_type);
-    if (crypto_type) crypto_type--;
+    if (ids_written < count) count = ids_written;
     
-    if (crypto_type >= 0x20)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NCA keyblob index.", __func__);
-        return ret;
-    }
+    qsort(rights_ids, count, sizeof(FsRightsId), rightsIdCmp);
     
-    Result result;
-    u32 common_count, personalized_count, ids_written;
-    FsRightsId *common_rights_ids = NULL, *personalized_rights_ids = NULL;
+    *out_rights_ids = rights_ids;
+    *out_count = count;
     
-    bool foundRightsId = false;
-    u8 rightsIdType = 0; // 1 = Common, 2 = Personalized
-    
-    Aes128CtrContext eticket_aes_ctx;
-    unsigned char ctr[0x10];
+    return true;
+}
+
+// Parses all the eTickets from an ES savefile (0 = Common, 1 = Personalized) that are also listed by the ES service
+// The index is kept around until the savefile gets modified, so we don't have to process the savefile again for every single title (e.g. batch mode)
+static bool loadEticketSaveIndex(u8 idx)
+{
+    if (idx > 1) return false;
     
-    u8 *D = NULL, *N = NULL, *E = NULL;
+    const char *save_name = (idx == 0 ? BIS_COMMON_TIK_SAVE_NAME : BIS_PERSONALIZED_TIK_SAVE_NAME);
+    const char *save_type = (idx == 0 ? "common" : "personalized");
+    eticket_save_index_t *index = &(eticket_save_index[idx]);
     
+    Result result;
     FRESULT fr = FR_OK;
+    FILINFO save_info;
     FIL *eTicketSave = NULL;
     
     save_ctx_t *save_ctx = NULL;
@@ -820,114 +1048,245 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     save_fs_list_entry_t entry;
     const char ticket_bin_path[SAVE_FS_LIST_MAX_NAME_LENGTH] = "/ticket.bin";
     
+    u32 i;
     u32 buf_size = (ETICKET_ENTRY_SIZE * 0x10);
     u32 br = buf_size;
     u64 total_br = 0;
     
+    u32 rights_id_cnt = 0, ticket_alloc_cnt = 0;
+    FsRightsId *rights_ids = NULL;
+    u8 *tmp_tickets = NULL;
+    
     char tmp[NAME_BUF_LEN / 2] = {'\0'};
     
-    bool foundEticket = false, proceed = true;
+    bool success = false, openSave = false, initSaveCtx = false;
     
-    u8 titlekey[0x10];
-    Aes128Context titlekey_aes_ctx;
+    fr = f_stat(save_name, &save_info);
+    if (fr)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to retrieve ES %s eTicket save status! (%u)", __func__, save_type, fr);
+        return false;
+    }
+    
+    // Nothing to do if the savefile hasn't been modified since the index was built
+    if (index->loaded && index->save_size == (u64)save_info.fsize && index->save_date == save_info.fdate && index->save_time == save_info.ftime) return true;
+    
+    freeEticketSaveIndexEntry(index);
+    
+    // Cached titlekeys may come from tickets that were just removed or replaced
+    ncaMetaCacheFlushTitleKeys();
     
     result = esInitialize();
     if (R_FAILED(result))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to initialize the ES service! (0x%08X)", __func__, result);
-        return ret;
+        return false;
     }
     
-    result = esCountCommonTicket(&common_count);
-    if (R_FAILED(result))
+    bool listed = retrieveEsRightsIds((idx == 1), &rights_ids, &rights_id_cnt);
+    
+    esExit();
+    
+    if (!listed) return false;
+    
+    // Nothing to parse
+    if (!rights_id_cnt)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: esCountCommonTicket failed! (0x%08X)", __func__, result);
-        esExit();
-        return ret;
+        success = true;
+        goto out;
     }
     
-    result = esCountPersonalizedTicket(&personalized_count);
-    if (R_FAILED(result))
+    eTicketSave = calloc(1, sizeof(save_file_t));
+    if (!eTicketSave)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: esCountPersonalizedTicket failed! (0x%08X)", __func__, result);
-        esExit();
-        return ret;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for FatFs file descriptor!", __func__);
+        goto out;
     }
     
-    if (!common_count && !personalized_count)
+    // FatFs is used to mount the BIS System partition and read the ES savedata files to avoid 0xE02 (file already in use) errors
+    fr = f_open(eTicketSave, save_name, FA_READ | FA_OPEN_EXISTING);
+    if (fr)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: no tickets available!", __func__);
-        esExit();
-        return ret;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open ES %s eTicket save! (%u)", __func__, save_type, fr);
+        goto out;
     }
     
-    if (common_count)
+    openSave = true;
+    
+    save_enable_fast_seek(eTicketSave);
+    
+    save_ctx = calloc(1, sizeof(save_ctx_t));
+    if (!save_ctx)
     {
-        common_rights_ids = calloc(common_count, sizeof(FsRightsId));
-        if (!common_rights_ids)
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for ticket savefile context!", __func__);
+        goto out;
+    }
+    
+    save_ctx->file = eTicketSave;
+    save_ctx->tool_ctx.action = 0;
+    
+    initSaveCtx = save_process(save_ctx);
+    if (!initSaveCtx)
+    {
+        snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to process ticket savefile!", __func__);
+        strcat(strbuf, tmp);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+        goto out;
+    }
+    
+    if (!save_hierarchical_file_table_get_file_entry_by_path(&save_ctx->save_filesystem_core.file_table, ticket_bin_path, &entry))
+    {
+        snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to get file entry for \"%s\" in ticket savefile!", __func__, ticket_bin_path);
+        strcat(strbuf, tmp);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+        goto out;
+    }
+    
+    if (!save_open_fat_storage(&save_ctx->save_filesystem_core, &fat_storage, entry.value.save_file_info.start_block))
+    {
+        snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to open FAT storage at block 0x%X for \"%s\" in ticket savefile!", __func__, entry.value.save_file_info.start_block, ticket_bin_path);
+        strcat(strbuf, tmp);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+        goto out;
+    }
+    
+    while(br == buf_size && total_br < entry.value.save_file_info.length)
+    {
+        br = save_allocation_table_storage_read(&fat_storage, dumpBuf, total_br, buf_size);
+        if (br != buf_size)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for common tickets' rights IDs!", __func__);
-            esExit();
-            return ret;
+            snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read %u bytes chunk at offset 0x%lX from \"%s\" in ticket savefile!", __func__, buf_size, total_br, ticket_bin_path);
+            strcat(strbuf, tmp);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+            goto out;
         }
         
-        result = esListCommonTicket(&ids_written, common_rights_ids, common_count * sizeof(FsRightsId));
-        if (R_FAILED(result))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: esListCommonTicket failed! (0x%08X)", __func__, result);
-            free(common_rights_ids);
-            esExit();
-            return ret;
-        }
+        if (dumpBuf[0] == 0) break;
         
-        for(i = 0; i < common_count; i++)
+        total_br += br;
+        
+        for(i = 0; i < buf_size; i += ETICKET_ENTRY_SIZE)
         {
-            if (!memcmp(common_rights_ids[i].c, dec_nca_header->rights_id, 0x10))
+            // Only keep eTicket entries with RSA-2048 SHA-256 signature method whose rights IDs are known by the ES service
+            if (*((u32*)(dumpBuf + i)) != SIGTYPE_RSA2048_SHA256 || !bsearch(dumpBuf + i + ETICKET_RIGHTSID_OFFSET, rights_ids, rights_id_cnt, sizeof(FsRightsId), rightsIdCmp)) continue;
+            
+            if (index->ticket_cnt == ticket_alloc_cnt)
             {
-                foundRightsId = true;
-                rightsIdType = 1; // Common
-                break;
+                ticket_alloc_cnt = (ticket_alloc_cnt ? (ticket_alloc_cnt * 2) : 0x40);
+                
+                tmp_tickets = realloc(index->tickets, (u64)ticket_alloc_cnt * ETICKET_TIK_FILE_SIZE);
+                if (!tmp_tickets)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to reallocate memory for the %s eTicket index!", __func__, save_type);
+                    goto out;
+                }
+                
+                index->tickets = tmp_tickets;
+                tmp_tickets = NULL;
             }
+            
+            memcpy(index->tickets + ((u64)index->ticket_cnt * ETICKET_TIK_FILE_SIZE), dumpBuf + i, ETICKET_TIK_FILE_SIZE);
+            index->ticket_cnt++;
         }
-        
-        free(common_rights_ids);
     }
     
-    if (!foundRightsId && personalized_count)
+    if (index->ticket_cnt) qsort(index->tickets, index->ticket_cnt, ETICKET_TIK_FILE_SIZE, eticketSaveIndexEntryCmp);
+    
+    success = true;
+    
+out:
+    if (save_ctx)
+    {
+        if (initSaveCtx) save_free_contexts(save_ctx);
+        free(save_ctx);
+    }
+    
+    if (eTicketSave)
+    {
+        if (openSave) f_close(eTicketSave);
+        free(eTicketSave);
+    }
+    
+    if (rights_ids) free(rights_ids);
+    
+    if (success)
     {
-        personalized_rights_ids = calloc(personalized_count, sizeof(FsRightsId));
-        if (!personalized_rights_ids)
+        index->save_size = (u64)save_info.fsize;
+        index->save_date = save_info.fdate;
+        index->save_time = save_info.ftime;
+        index->loaded = true;
+    } else {
+        freeEticketSaveIndexEntry(index);
+    }
+    
+    return success;
+}
+
+int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_enc_key, u8 *out_dec_key)
+{
+    int ret = -1;
+    
+    if (!dec_nca_header || dec_nca_header->kaek_ind > 2 || (!out_tik && !out_dec_key && !out_enc_key))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to retrieve NCA ticket and/or titlekey.", __func__);
+        return ret;
+    }
+    
+    u32 i, j;
+    bool has_rights_id = false;
+    
+    for(i = 0; i < 0x10; i++)
+    {
+        if (dec_nca_header->rights_id[i] != 0)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for personalized tickets' rights IDs!", __func__);
-            esExit();
-            return ret;
+            has_rights_id = true;
+            break;
         }
+    }
+    
+    if (!has_rights_id)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: NCA doesn't use titlekey crypto.", __func__);
+        return ret;
+    }
+    
+    u8 crypto_type = (dec_nca_header->crypto_type2 > dec_nca_header->crypto_type ? dec_nca_header->crypto_type2 : dec_nca_header->crypto_type);
+    if (crypto_type) crypto_type--;
+    
+    if (crypto_type >= 0x20)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NCA keyblob index.", __func__);
+        return ret;
+    }
+    
+    Result result;
+    
+    const u8 *eticket = NULL;
+    u8 rightsIdType = 0; // 1 = Common, 2 = Personalized
+    
+    Aes128CtrContext eticket_aes_ctx;
+    unsigned char ctr[0x10];
+    
+    u8 *D = NULL, *N = NULL, *E = NULL;
+    
+    u8 titlekey[0x10];
+    Aes128Context titlekey_aes_ctx;
+    
+    // Common tickets are looked up first, just like the ES service does
+    for(i = 0; i < 2; i++)
+    {
+        if (!loadEticketSaveIndex(i)) return ret;
         
-        result = esListPersonalizedTicket(&ids_written, personalized_rights_ids, personalized_count * sizeof(FsRightsId));
-        if (R_FAILED(result))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: esListPersonalizedTicket failed! (0x%08X)", __func__, result);
-            free(personalized_rights_ids);
-            esExit();
-            return ret;
-        }
+        if (eticket_save_index[i].ticket_cnt) eticket = (const u8*)bsearch(dec_nca_header->rights_id, eticket_save_index[i].tickets, eticket_save_index[i].ticket_cnt, ETICKET_TIK_FILE_SIZE, eticketSaveIndexKeyCmp);
         
-        for(i = 0; i < personalized_count; i++)
+        if (eticket)
         {
-            if (!memcmp(personalized_rights_ids[i].c, dec_nca_header->rights_id, 0x10))
-            {
-                foundRightsId = true;
-                rightsIdType = 2; // Personalized
-                break;
-            }
+            rightsIdType = (i + 1);
+            break;
         }
-        
-        free(personalized_rights_ids);
     }
     
-    esExit();
-    
-    if (!foundRightsId || (rightsIdType != 1 && rightsIdType != 2))
+    if (!eticket)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: NCA rights ID unavailable in this console!", __func__);
         breaks++;
@@ -935,6 +1294,23 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
         return ret;
     }
     
+    // The ES index is always checked first, since it's rebuilt whenever the ES savedata changes (which also flushes the titlekey cache)
+    // A cache hit only lets us skip the titlekey decryption (RSA-OAEP for personalized tickets)
+    if (ncaMetaCacheGetTitleKey(dec_nca_header->rights_id, NULL, titlekey))
+    {
+        if (out_tik != NULL) memcpy(out_tik, eticket, ETICKET_TIK_FILE_SIZE);
+        
+        if (out_enc_key != NULL) memcpy(out_enc_key, titlekey, 0x10);
+        
+        if (out_dec_key != NULL)
+        {
+            aes128ContextCreate(&titlekey_aes_ctx, nca_keyset.titlekeks[crypto_type], false);
+            aes128DecryptBlock(&titlekey_aes_ctx, out_dec_key, titlekey);
+        }
+        
+        return 0;
+    }
+    
     // Load external keys
     if (!loadExternalKeys()) return ret;
     
@@ -987,154 +1363,46 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
         }
     }
     
-    eTicketSave = calloc(1, sizeof(FIL));
-    if (!eTicketSave)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for FatFs file descriptor!", __func__);
-        return ret;
-    }
-    
-    // FatFs is used to mount the BIS System partition and read the ES savedata files to avoid 0xE02 (file already in use) errors
-    fr = f_open(eTicketSave, (rightsIdType == 1 ? BIS_COMMON_TIK_SAVE_NAME : BIS_PERSONALIZED_TIK_SAVE_NAME), FA_READ | FA_OPEN_EXISTING);
-    if (fr)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open ES %s eTicket save! (%u)", __func__, (rightsIdType == 1 ? "common" : "personalized"), fr);
-        free(eTicketSave);
-        return ret;
-    }
-    
-    save_ctx = calloc(1, sizeof(save_ctx_t));
-    if (!save_ctx)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for ticket savefile context!");
-        f_close(eTicketSave);
-        free(eTicketSave);
-        return ret;
-    }
-    
-    save_ctx->file = eTicketSave;
-    save_ctx->tool_ctx.action = 0;
-    
-    if (!save_process(save_ctx))
-    {
-        snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to process ticket savefile!", __func__);
-        strcat(strbuf, tmp);
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
-        free(save_ctx);
-        f_close(eTicketSave);
-        free(eTicketSave);
-        return ret;
-    }
-    
-    if (!save_hierarchical_file_table_get_file_entry_by_path(&save_ctx->save_filesystem_core.file_table, ticket_bin_path, &entry))
-    {
-        snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to get file entry for \"%s\" in ticket savefile!", __func__, ticket_bin_path);
-        strcat(strbuf, tmp);
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
-        save_free_contexts(save_ctx);
-        free(save_ctx);
-        f_close(eTicketSave);
-        free(eTicketSave);
-        return ret;
-    }
-    
-    if (!save_open_fat_storage(&save_ctx->save_filesystem_core, &fat_storage, entry.value.save_file_info.start_block))
+    if (rightsIdType == 1)
     {
-        snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to open FAT storage at block 0x%X for \"%s\" in ticket savefile!", __func__, entry.value.save_file_info.start_block, ticket_bin_path);
-        strcat(strbuf, tmp);
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
-        save_free_contexts(save_ctx);
-        free(save_ctx);
-        f_close(eTicketSave);
-        free(eTicketSave);
-        return ret;
-    }
-    
-    while(br == buf_size && total_br < entry.value.save_file_info.length)
-    {
-        br = save_allocation_table_storage_read(&fat_storage, dumpBuf, total_br, buf_size);
-        if (br != buf_size)
+        // Common
+        memcpy(titlekey, eticket + ETICKET_TITLEKEY_OFFSET, 0x10);
+    } else {
+        // Personalized
+        u8 M[0x100], salt[0x20], db[0xDF];
+        
+        const u8 *titleKeyBlock = (eticket + ETICKET_TITLEKEY_OFFSET);
+        
+        result = splUserExpMod(titleKeyBlock, N, D, 0x100, M);
+        if (R_FAILED(result))
         {
-            snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read %u bytes chunk at offset 0x%lX from \"%s\" in ticket savefile!", __func__, buf_size, total_br, ticket_bin_path);
-            strcat(strbuf, tmp);
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
-            proceed = false;
-            break;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: splUserExpMod failed! (titleKeyBlock) (0x%08X)", __func__, result);
+            return ret;
         }
         
-        if (dumpBuf[0] == 0) break;
+        // Decrypt the titlekey
+        mgf1(M + 0x21, 0xDF, salt, 0x20);
+        for(j = 0; j < 0x20; j++) salt[j] ^= M[j + 1];
         
-        total_br += br;
+        mgf1(salt, 0x20, db, 0xDF);
+        for(j = 0; j < 0xDF; j++) db[j] ^= M[j + 0x21];
         
-        for(i = 0; i < buf_size; i += ETICKET_ENTRY_SIZE)
+        // Verify if it starts with a null string hash
+        if (memcmp(db, null_hash, 0x20) != 0)
         {
-            // Only read eTicket entries with RSA-2048 SHA-256 signature method
-            // Also check if our current eTicket entry matches our rights ID
-            if (*((u32*)(dumpBuf + i)) != SIGTYPE_RSA2048_SHA256 || memcmp(dumpBuf + i + ETICKET_RIGHTSID_OFFSET, dec_nca_header->rights_id, 0x10) != 0) continue;
-            
-            foundEticket = true;
-            
-            if (rightsIdType == 1)
-            {
-                // Common
-                memcpy(titlekey, dumpBuf + i + ETICKET_TITLEKEY_OFFSET, 0x10);
-            } else {
-                // Personalized
-                u8 M[0x100], salt[0x20], db[0xDF];
-                
-                u8 *titleKeyBlock = (dumpBuf + i + ETICKET_TITLEKEY_OFFSET);
-                
-                result = splUserExpMod(titleKeyBlock, N, D, 0x100, M);
-                if (R_FAILED(result))
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: splUserExpMod failed! (titleKeyBlock) (0x%08X)", __func__, result);
-                    proceed = false;
-                    break;
-                }
-                
-                // Decrypt the titlekey
-                mgf1(M + 0x21, 0xDF, salt, 0x20);
-                for(j = 0; j < 0x20; j++) salt[j] ^= M[j + 1];
-                
-                mgf1(salt, 0x20, db, 0xDF);
-                for(j = 0; j < 0xDF; j++) db[j] ^= M[j + 0x21];
-                
-                // Verify if it starts with a null string hash
-                if (memcmp(db, null_hash, 0x20) != 0)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: titlekey decryption failed! Wrong keys?\nTry running Lockpick_RCM to generate the keys file from scratch.", __func__);
-                    proceed = false;
-                    break;
-                }
-                
-                memcpy(titlekey, db + 0xCF, 0x10);
-            }
-            
-            break;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: titlekey decryption failed! Wrong keys?\nTry running Lockpick_RCM to generate the keys file from scratch.", __func__);
+            return ret;
         }
         
-        if (foundEticket) break;
-    }
-    
-    save_free_contexts(save_ctx);
-    free(save_ctx);
-    f_close(eTicketSave);
-    free(eTicketSave);
-    
-    if (!proceed) return ret;
-    
-    if (!foundEticket)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to find a matching eTicket entry for NCA rights ID!", __func__);
-        breaks++;
-        ret = -2;
-        return ret;
+        memcpy(titlekey, db + 0xCF, 0x10);
     }
     
     ret = 0;
     
+    ncaMetaCacheStoreTitleKey(dec_nca_header->rights_id, eticket, titlekey);
+    
     // Copy ticket data to output pointer
-    if (out_tik != NULL) memcpy(out_tik, dumpBuf + i, ETICKET_TIK_FILE_SIZE);
+    if (out_tik != NULL) memcpy(out_tik, eticket, ETICKET_TIK_FILE_SIZE);
     
     // Copy encrypted titlekey to output pointer
     // It is used in personalized -> common ticket conversion
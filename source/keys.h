@@ -19,6 +19,12 @@
 #define SIGTYPE_RSA2048_SHA1            (u32)0x10001
 #define SIGTYPE_RSA2048_SHA256          (u32)0x10004
 
+#define KEY_OFFSET_CACHE_MAGIC          (u32)0x4B4F4E58     // "XNOK"
+#define KEY_LOCATION_MAX_KEYS           4
+#define KEY_OFFSET_INVALID              (u64)0xFFFFFFFFFFFFFFFF
+
+#define KEY_SCAN_WORKER_CNT             2                   // Extra threads used to scan process memory (the main thread takes care of the first chunk)
+
 typedef struct {
     u64 titleID;
     u8 mask;
@@ -32,6 +38,29 @@ typedef struct {
     u64 size;
 } keyInfo;
 
+typedef struct {
+    u64 dataSize;                                   // Key offsets are only reused if the retrieved segment data size matches this value
+    u64 offsets[KEY_LOCATION_MAX_KEYS];
+} keyLocationOffsets;
+
+// Stored at KEY_OFFSETS_PATH. Only valid for the firmware version it was generated under
+typedef struct {
+    u32 magic;
+    u32 hosVersion;
+    keyLocationOffsets rodata;
+    keyLocationOffsets data;
+} keyOffsetCache;
+
+typedef struct {
+    const keyLocation *location;
+    const keyInfo **keys;
+    u32 keyCnt;
+    u64 start;                                      // First window offset checked by this job
+    u64 end;                                        // Window offset at which this job stops
+    u64 *offsets;                                   // Shared by all jobs
+    volatile u32 *foundMask;                        // Shared by all jobs
+} keyScanJob;
+
 typedef struct {
     u16 memory_key_cnt;                         /* Key counter for keys retrieved from memory. */
     u16 ext_key_cnt;                            /* Key counter for keys retrieved from keysfile. */
@@ -56,10 +85,24 @@ typedef struct {
     u8 key_area_keys[0x20][3][0x10];            /* Key area encryption keys. */
 } nca_keyset_t;
 
+typedef struct {
+    u8 *tickets;                                /* eTicket entries (ETICKET_TIK_FILE_SIZE bytes each), sorted by rights ID. */
+    u32 ticket_cnt;
+    u64 save_size;                              /* ES savefile status when the index was built. */
+    u16 save_date;
+    u16 save_time;
+    bool loaded;
+} eticket_save_index_t;
+
 bool loadMemoryKeys();
 bool decryptNcaKeyArea(nca_header_t *dec_nca_header, u8 *out);
+
+/* Same as decryptNcaKeyArea(), but errors are written to errorBuf instead of being drawn on screen, so it can be used from worker threads. */
+bool decryptNcaKeyAreaEx(nca_header_t *dec_nca_header, u8 *out, char *errorBuf, size_t errorBufSize);
+
 bool loadExternalKeys();
 int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_enc_key, u8 *out_dec_key);
 bool generateEncryptedNcaKeyAreaWithTitlekey(nca_header_t *dec_nca_header, u8 *decrypted_nca_keys);
+void freeEticketSaveIndex();
 
 #endif
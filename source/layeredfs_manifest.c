@@ -0,0 +1,336 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "layeredfs_manifest.h"
+#include "dumper.h"
+
+static int layeredFsManifestEntryCmp(const void *a, const void *b)
+{
+    const layeredfs_manifest_entry_t *entry1 = (const layeredfs_manifest_entry_t*)a;
+    const layeredfs_manifest_entry_t *entry2 = (const layeredfs_manifest_entry_t*)b;
+    
+    return strcmp(entry1->path, entry2->path);
+}
+
+static bool layeredFsManifestReserve(layeredfs_manifest_t *manifest, u32 count)
+{
+    if (count <= manifest->entry_capacity) return true;
+    
+    u32 newCapacity = (manifest->entry_capacity ? manifest->entry_capacity : 256);
+    while(newCapacity < count) newCapacity *= 2;
+    
+    layeredfs_manifest_entry_t *tmpEntries = realloc(manifest->entries, newCapacity * sizeof(layeredfs_manifest_entry_t));
+    if (!tmpEntries) return false;
+    
+    manifest->entries = tmpEntries;
+    manifest->entry_capacity = newCapacity;
+    
+    return true;
+}
+
+bool layeredFsManifestLoad(layeredfs_manifest_t *manifest, const char *path)
+{
+    if (!manifest || !path) return false;
+    
+    memset(manifest, 0, sizeof(layeredfs_manifest_t));
+    
+    FILE *manifestFile = fopen(path, "rb");
+    if (!manifestFile) return false;
+    
+    layeredfs_manifest_header header;
+    layeredfs_manifest_file_entry *fileEntries = NULL;
+    char *pathTable = NULL;
+    size_t read_res;
+    u32 i;
+    bool success = false;
+    
+    read_res = fread(&header, 1, sizeof(layeredfs_manifest_header), manifestFile);
+    if (read_res != sizeof(layeredfs_manifest_header) || header.magic != LAYEREDFS_MANIFEST_MAGIC || header.version != LAYEREDFS_MANIFEST_VERSION || !header.entry_cnt || !header.path_table_size) goto out;
+    
+    fileEntries = calloc(header.entry_cnt, sizeof(layeredfs_manifest_file_entry));
+    pathTable = malloc(header.path_table_size);
+    if (!fileEntries || !pathTable || !layeredFsManifestReserve(manifest, header.entry_cnt)) goto out;
+    
+    read_res = fread(fileEntries, 1, header.entry_cnt * sizeof(layeredfs_manifest_file_entry), manifestFile);
+    if (read_res != (header.entry_cnt * sizeof(layeredfs_manifest_file_entry))) goto out;
+    
+    read_res = fread(pathTable, 1, header.path_table_size, manifestFile);
+    if (read_res != header.path_table_size) goto out;
+    
+    for(i = 0; i < header.entry_cnt; i++)
+    {
+        layeredfs_manifest_file_entry *fileEntry = &(fileEntries[i]);
+        layeredfs_manifest_entry_t *entry = &(manifest->entries[i]);
+        
+        if (!fileEntry->path_len || fileEntry->path_offset > header.path_table_size || fileEntry->path_len > (header.path_table_size - fileEntry->path_offset)) goto out;
+        
+        memset(entry, 0, sizeof(layeredfs_manifest_entry_t));
+        
+        entry->path = strndup(pathTable + fileEntry->path_offset, fileEntry->path_len);
+        if (!entry->path) goto out;
+        
+        entry->size = fileEntry->size;
+        entry->mtime = fileEntry->mtime;
+        memcpy(entry->layout_hash, fileEntry->layout_hash, SHA256_HASH_SIZE);
+        memcpy(entry->data_hash, fileEntry->data_hash, SHA256_HASH_SIZE);
+        
+        manifest->entry_cnt++;
+    }
+    
+    layeredFsManifestSort(manifest);
+    
+    success = true;
+    
+out:
+    fclose(manifestFile);
+    
+    if (pathTable) free(pathTable);
+    if (fileEntries) free(fileEntries);
+    
+    if (!success) layeredFsManifestFree(manifest);
+    
+    return success;
+}
+
+bool layeredFsManifestSave(layeredfs_manifest_t *manifest, const char *path)
+{
+    if (!manifest || !path) return false;
+    
+    char tmpPath[NAME_BUF_LEN * 2] = {'\0'};
+    layeredfs_manifest_header header;
+    layeredfs_manifest_file_entry fileEntry;
+    size_t write_res;
+    u32 i;
+    u64 pathTableSize = 0;
+    bool success = true;
+    
+    for(i = 0; i < manifest->entry_cnt; i++) pathTableSize += (u64)strlen(manifest->entries[i].path);
+    
+    // Nothing worth keeping (e.g. an empty RomFS)
+    if (!manifest->entry_cnt || !pathTableSize || pathTableSize > UINT32_MAX)
+    {
+        remove(path);
+        return false;
+    }
+    
+    snprintf(tmpPath, MAX_CHARACTERS(tmpPath), "%s%s", path, LAYEREDFS_MANIFEST_TMP_EXTENSION);
+    
+    FILE *manifestFile = fopen(tmpPath, "wb");
+    if (!manifestFile) return false;
+    
+    memset(&header, 0, sizeof(layeredfs_manifest_header));
+    
+    header.magic = LAYEREDFS_MANIFEST_MAGIC;
+    header.version = LAYEREDFS_MANIFEST_VERSION;
+    header.entry_cnt = manifest->entry_cnt;
+    header.path_table_size = (u32)pathTableSize;
+    
+    write_res = fwrite(&header, 1, sizeof(layeredfs_manifest_header), manifestFile);
+    if (write_res != sizeof(layeredfs_manifest_header)) success = false;
+    
+    for(i = 0, pathTableSize = 0; success && i < manifest->entry_cnt; i++)
+    {
+        layeredfs_manifest_entry_t *entry = &(manifest->entries[i]);
+        
+        memset(&fileEntry, 0, sizeof(layeredfs_manifest_file_entry));
+        
+        fileEntry.path_offset = (u32)pathTableSize;
+        fileEntry.path_len = (u32)strlen(entry->path);
+        fileEntry.size = entry->size;
+        fileEntry.mtime = entry->mtime;
+        memcpy(fileEntry.layout_hash, entry->layout_hash, SHA256_HASH_SIZE);
+        memcpy(fileEntry.data_hash, entry->data_hash, SHA256_HASH_SIZE);
+        
+        write_res = fwrite(&fileEntry, 1, sizeof(layeredfs_manifest_file_entry), manifestFile);
+        if (write_res != sizeof(layeredfs_manifest_file_entry)) success = false;
+        
+        pathTableSize += fileEntry.path_len;
+    }
+    
+    for(i = 0; success && i < manifest->entry_cnt; i++)
+    {
+        size_t path_len = strlen(manifest->entries[i].path);
+        
+        write_res = fwrite(manifest->entries[i].path, 1, path_len, manifestFile);
+        if (write_res != path_len) success = false;
+    }
+    
+    if (fclose(manifestFile) != 0) success = false;
+    
+    if (!success)
+    {
+        remove(tmpPath);
+        return false;
+    }
+    
+    remove(path);
+    
+    return (rename(tmpPath, path) == 0);
+}
+
+bool layeredFsManifestAddEntry(layeredfs_manifest_t *manifest, const char *path, u64 size, const u8 *layout_hash, u32 *out_idx)
+{
+    if (!manifest || !path || !*path || !layout_hash || !out_idx || manifest->entry_cnt == UINT32_MAX || !layeredFsManifestReserve(manifest, manifest->entry_cnt + 1)) return false;
+    
+    layeredfs_manifest_entry_t *entry = &(manifest->entries[manifest->entry_cnt]);
+    
+    memset(entry, 0, sizeof(layeredfs_manifest_entry_t));
+    
+    entry->path = strdup(path);
+    if (!entry->path) return false;
+    
+    entry->size = size;
+    memcpy(entry->layout_hash, layout_hash, SHA256_HASH_SIZE);
+    
+    *out_idx = manifest->entry_cnt++;
+    
+    return true;
+}
+
+void layeredFsManifestSort(layeredfs_manifest_t *manifest)
+{
+    if (!manifest || manifest->entry_cnt < 2) return;
+    
+    qsort(manifest->entries, manifest->entry_cnt, sizeof(layeredfs_manifest_entry_t), layeredFsManifestEntryCmp);
+}
+
+layeredfs_manifest_entry_t *layeredFsManifestFind(layeredfs_manifest_t *manifest, const char *path)
+{
+    if (!manifest || !manifest->entries || !manifest->entry_cnt || !path) return NULL;
+    
+    layeredfs_manifest_entry_t key;
+    memset(&key, 0, sizeof(layeredfs_manifest_entry_t));
+    
+    key.path = (char*)path;
+    
+    return (layeredfs_manifest_entry_t*)bsearch(&key, manifest->entries, manifest->entry_cnt, sizeof(layeredfs_manifest_entry_t), layeredFsManifestEntryCmp);
+}
+
+bool layeredFsManifestCheckOutput(const layeredfs_manifest_entry_t *entry, const char *outputPath, bool split)
+{
+    if (!entry || !outputPath) return false;
+    
+    struct stat st;
+    
+    // A file dumped with a different file splitting setting has to be written again
+    if (stat(outputPath, &st) != 0 || (u64)st.st_mtime != entry->mtime || (S_ISDIR(st.st_mode) != 0) != split) return false;
+    
+    return (split || (u64)st.st_size == entry->size);
+}
+
+void layeredFsManifestUpdateEntry(layeredfs_manifest_entry_t *entry, const char *outputPath, size_t basePathLen, const u8 *data_hash)
+{
+    if (!entry || !outputPath) return;
+    
+    struct stat st;
+    const char *relPath = (strlen(outputPath) > (basePathLen + 1) ? (outputPath + basePathLen + 1) : NULL);
+    
+    // A zero timestamp never matches, so the file gets checked again next time
+    entry->mtime = (stat(outputPath, &st) == 0 ? (u64)st.st_mtime : 0);
+    if (data_hash) memcpy(entry->data_hash, data_hash, SHA256_HASH_SIZE);
+    
+    // Files may end up in a different directory because of the FAT32 directory entry limit
+    if (relPath && strcmp(entry->path, relPath) != 0)
+    {
+        char *tmpPath = strdup(relPath);
+        if (tmpPath)
+        {
+            free(entry->path);
+            entry->path = tmpPath;
+        }
+    }
+}
+
+static void layeredFsManifestRemoveEmptyParents(char *outputPath, size_t basePathLen)
+{
+    char *tmp = NULL;
+    
+    // rmdir() fails on directories that still hold anything, so user files and directories are never touched
+    while((tmp = strrchr(outputPath, '/')) != NULL && (size_t)(tmp - outputPath) > basePathLen)
+    {
+        *tmp = '\0';
+        if (rmdir(outputPath) != 0) break;
+    }
+}
+
+u32 layeredFsManifestDeleteStale(layeredfs_manifest_t *oldManifest, layeredfs_manifest_t *newManifest, const char *basePath, bool isFat32)
+{
+    if (!oldManifest || !oldManifest->entries || !newManifest || !basePath) return 0;
+    
+    u32 i, j;
+    u32 keptCnt = 0;
+    bool split;
+    struct stat st;
+    size_t basePathLen = strlen(basePath);
+    char outputPath[NAME_BUF_LEN * 2] = {'\0'};
+    char partPath[NAME_BUF_LEN * 2] = {'\0'};
+    
+    for(i = 0; i < oldManifest->entry_cnt; i++)
+    {
+        if (layeredFsManifestFind(newManifest, oldManifest->entries[i].path)) continue;
+        
+        snprintf(outputPath, MAX_CHARACTERS(outputPath), "%s/%s", basePath, oldManifest->entries[i].path);
+        if (stat(outputPath, &st) != 0) continue;
+        
+        split = (oldManifest->entries[i].size > FAT32_FILESIZE_LIMIT && isFat32);
+        
+        // Files that were edited or replaced after the previous extraction belong to the user now
+        if (!layeredFsManifestCheckOutput(&(oldManifest->entries[i]), outputPath, split))
+        {
+            keptCnt++;
+            continue;
+        }
+        
+        if (split)
+        {
+            // Only the part files written by the dump are removed
+            for(j = 0; j <= (u32)(oldManifest->entries[i].size / SPLIT_FILE_GENERIC_PART_SIZE); j++)
+            {
+                snprintf(partPath, MAX_CHARACTERS(partPath), "%s/%02u", outputPath, j);
+                remove(partPath);
+            }
+            
+            if (rmdir(outputPath) != 0)
+            {
+                keptCnt++;
+                continue;
+            }
+        } else {
+            if (remove(outputPath) != 0) continue;
+        }
+        
+        layeredFsManifestRemoveEmptyParents(outputPath, basePathLen);
+    }
+    
+    return keptCnt;
+}
+
+void layeredFsManifestFree(layeredfs_manifest_t *manifest)
+{
+    if (!manifest) return;
+    
+    u32 i;
+    
+    if (manifest->entries)
+    {
+        for(i = 0; i < manifest->entry_cnt; i++) free(manifest->entries[i].path);
+        free(manifest->entries);
+    }
+    
+    memset(manifest, 0, sizeof(layeredfs_manifest_t));
+}
+
+void layeredFsManifestGetPath(const char *dumpPath, const char *name, char *outPath, size_t outPathSize)
+{
+    if (!dumpPath || !name || !outPath || !outPathSize) return;
+    
+    snprintf(outPath, outPathSize, "%s", dumpPath);
+    
+    char *tmp = strrchr(outPath, '/');
+    if (tmp) *(tmp + 1) = '\0';
+    
+    strncat(outPath, name, outPathSize - strlen(outPath) - 1);
+}
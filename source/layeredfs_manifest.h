@@ -0,0 +1,101 @@
+#pragma once
+
+#ifndef __LAYEREDFS_MANIFEST_H__
+#define __LAYEREDFS_MANIFEST_H__
+
+#include <switch.h>
+
+#include "util.h"
+
+#define LAYEREDFS_MANIFEST_MAGIC            (u32)0x4D464C58     // "XLFM"
+#define LAYEREDFS_MANIFEST_VERSION          1
+#define LAYEREDFS_EXEFS_MANIFEST_NAME       "exefs_manifest.bin"
+#define LAYEREDFS_ROMFS_MANIFEST_NAME       "romfs_manifest.bin"
+#define LAYEREDFS_MANIFEST_TMP_EXTENSION    ".tmp"
+
+#define LAYEREDFS_MANIFEST_FLAG_UNCHANGED   BIT(0)              // Output file matches the manifest from the previous extraction and doesn't have to be read
+#define LAYEREDFS_MANIFEST_FLAG_COMPARE     BIT(1)              // Source layout changed, but the output file may still hold the right data: data_hash is compared before writing it
+
+/*
+ * LayeredFS manifest layout ("<title ID>/exefs_manifest.bin" / "<title ID>/romfs_manifest.bin", next to the extracted "exefs" / "romfs" directory):
+ *
+ * 0x00: layeredfs_manifest_header
+ * 0x10: entry_cnt layeredfs_manifest_file_entry elements
+ * ....: path table (paths aren't NULL terminated)
+ *
+ * The layout hash is calculated from the NCA areas that make up the file data (content ID, section offset and size of each area), so it can be checked without reading anything.
+ * With updates, the BKTR relocation table tells the areas that come from the base application RomFS apart from the ones that come from the patch.
+ * Files whose layout hash, size and output timestamp match the manifest are skipped. RomFS files with the same size but a different layout are read again, and only written if their SHA-256 checksum changed.
+ */
+
+typedef struct {
+    u32 magic;                                                                  // LAYEREDFS_MANIFEST_MAGIC
+    u32 version;                                                                // LAYEREDFS_MANIFEST_VERSION
+    u32 entry_cnt;
+    u32 path_table_size;
+} PACKED layeredfs_manifest_header;
+
+typedef struct {
+    u32 path_offset;                                                            // Relative to path table start
+    u32 path_len;
+    u64 size;
+    u64 mtime;                                                                  // Output file (or split file directory) modification time
+    u8 layout_hash[SHA256_HASH_SIZE];
+    u8 data_hash[SHA256_HASH_SIZE];
+} PACKED layeredfs_manifest_file_entry;
+
+// Fed to the layout hash for every area of the file data
+typedef struct {
+    NcmContentId ncaId;
+    u64 offset;                                                                 // Relative to section start
+    u64 size;
+} PACKED layeredfs_source_area;
+
+typedef struct {
+    char *path;                                                                 // Output path, relative to the extraction directory
+    u64 size;
+    u64 mtime;
+    u8 layout_hash[SHA256_HASH_SIZE];
+    u8 data_hash[SHA256_HASH_SIZE];
+    u8 flags;                                                                   // LAYEREDFS_MANIFEST_FLAG_* (not stored)
+} layeredfs_manifest_entry_t;
+
+typedef struct {
+    layeredfs_manifest_entry_t *entries;                                        // Sorted by path once loaded
+    u32 entry_cnt;
+    u32 entry_capacity;
+    u32 unchanged_cnt;                                                          // Files that didn't have to be written again
+    u64 unchanged_size;
+} layeredfs_manifest_t;
+
+/* Loads a manifest. Returns false if it's missing or corrupted, in which case the manifest is left empty. */
+bool layeredFsManifestLoad(layeredfs_manifest_t *manifest, const char *path);
+
+/* Writes a manifest to a temporary file first, which then replaces the previous one. */
+bool layeredFsManifestSave(layeredfs_manifest_t *manifest, const char *path);
+
+/* Appends a new entry. Its index is returned through out_idx, since pointers to entries are invalidated by this call. */
+bool layeredFsManifestAddEntry(layeredfs_manifest_t *manifest, const char *path, u64 size, const u8 *layout_hash, u32 *out_idx);
+
+/* Sorts the manifest entries by path, so they can be looked up with layeredFsManifestFind(). */
+void layeredFsManifestSort(layeredfs_manifest_t *manifest);
+
+layeredfs_manifest_entry_t *layeredFsManifestFind(layeredfs_manifest_t *manifest, const char *path);
+
+/* Checks if the output file still has the size and modification time stored in the manifest entry. Split files are stored as directories, so only their timestamp is checked. */
+bool layeredFsManifestCheckOutput(const layeredfs_manifest_entry_t *entry, const char *outputPath, bool split);
+
+/* Updates the data checksum (if data_hash isn't NULL) and output timestamp after writing a file. The entry path is also updated if the file had to be written somewhere else. */
+void layeredFsManifestUpdateEntry(layeredfs_manifest_entry_t *entry, const char *outputPath, size_t basePathLen, const u8 *data_hash);
+
+/* Deletes output files listed in the previous manifest that aren't part of the new one (e.g. files removed by an update). newManifest must be sorted.
+ * Files whose size or modification time changed since the previous extraction were edited by the user and are left alone. Directories are only removed once they're empty.
+ * Returns the number of stale files that were kept. */
+u32 layeredFsManifestDeleteStale(layeredfs_manifest_t *oldManifest, layeredfs_manifest_t *newManifest, const char *basePath, bool isFat32);
+
+void layeredFsManifestFree(layeredfs_manifest_t *manifest);
+
+/* Generates the manifest path for an extraction directory (e.g. "sdmc:/atmosphere/contents/0100000000010000/romfs" -> "sdmc:/atmosphere/contents/0100000000010000/romfs_manifest.bin"). */
+void layeredFsManifestGetPath(const char *dumpPath, const char *name, char *outPath, size_t outPathSize);
+
+#endif
@@ -159,6 +159,18 @@ int main(int argc, char *argv[])
             case resultUpdateApplication:
                 uiSetState(stateUpdateApplication);
                 break;
+            case resultBenchmarkDumpBlockSizes:
+                uiSetState(stateBenchmarkDumpBlockSizes);
+                break;
+            case resultBenchmarkCorePaths:
+                uiSetState(stateBenchmarkCorePaths);
+                break;
+            case resultRestoreCompressedDumps:
+                uiSetState(stateRestoreCompressedDumps);
+                break;
+            case resultRebuildNspFromManifests:
+                uiSetState(stateRebuildNspFromManifests);
+                break;
             case resultExit:
                 exitMainLoop = true;
                 break;
@@ -167,6 +179,9 @@ int main(int argc, char *argv[])
         }
         
         if (exitMainLoop) break;
+        
+        /* Settings changed during a dump are only saved once it's over */
+        saveConfigIfDirty();
     }
     
 out:
@@ -8,6 +8,10 @@
 #include "ui.h"
 #include "rsa.h"
 #include "nso.h"
+#include "nca_cache.h"
+#include "nca_meta.h"
+#include "perf.h"
+#include "layeredfs_manifest.h"
 
 /* Extern variables */
 
@@ -20,7 +24,21 @@ extern bktr_ctx_t bktrContext;
 
 extern nca_keyset_t nca_keyset;
 
-extern u8 *ncaCtrBuf;
+extern gamecard_ctx_t gameCardInfo;
+
+/* Secure HFS0 file handles for gamecard NCAs, resolved by readNcaDataByContentIdUncached() */
+
+#define NCA_GC_HANDLE_CNT   4                               // BKTR reads keep switching between the patch and base NCAs
+
+typedef struct {
+    NcmContentId ncaId;
+    hfs0_file_handle handle;
+    bool valid;
+} nca_gc_handle_entry_t;
+
+static Mutex ncaGcHandleMutex = 0;
+static nca_gc_handle_entry_t ncaGcHandles[NCA_GC_HANDLE_CNT];
+static u32 ncaGcHandleIndex = 0;
 
 char *getTitleType(u8 type)
 {
@@ -295,7 +313,60 @@ static void nca_update_bktr_ctr(unsigned char *ctr, u32 ctr_val, u64 ofs)
     }
 }
 
-bool readNcaDataByContentId(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 offset, void *outBuf, size_t bufSize)
+void resetNcaGameCardHandles()
+{
+    mutexLock(&ncaGcHandleMutex);
+    
+    memset(ncaGcHandles, 0, sizeof(ncaGcHandles));
+    ncaGcHandleIndex = 0;
+    
+    mutexUnlock(&ncaGcHandleMutex);
+}
+
+// The Secure HFS0 partition entry for a gamecard NCA is only looked up once, instead of once per read
+static bool getNcaGameCardHandle(const NcmContentId *ncaId, const char *nca_filename, hfs0_file_handle *out)
+{
+    u32 i;
+    bool found = false;
+    
+    mutexLock(&ncaGcHandleMutex);
+    
+    for(i = 0; i < NCA_GC_HANDLE_CNT; i++)
+    {
+        nca_gc_handle_entry_t *cur = &(ncaGcHandles[i]);
+        if (!cur->valid || memcmp(&(cur->ncaId), ncaId, sizeof(NcmContentId)) != 0) continue;
+        
+        memcpy(out, &(cur->handle), sizeof(hfs0_file_handle));
+        found = true;
+        break;
+    }
+    
+    mutexUnlock(&ncaGcHandleMutex);
+    
+    if (found) return true;
+    
+    if (!gameCardInfo.hfs0PartitionCnt || !getHfs0FileHandleByName(gameCardInfo.hfs0PartitionCnt - 1, nca_filename, out))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to find file \"%s\" in Secure HFS0 partition!", __func__, nca_filename);
+        return false;
+    }
+    
+    mutexLock(&ncaGcHandleMutex);
+    
+    nca_gc_handle_entry_t *entry = &(ncaGcHandles[ncaGcHandleIndex]);
+    
+    memcpy(&(entry->ncaId), ncaId, sizeof(NcmContentId));
+    memcpy(&(entry->handle), out, sizeof(hfs0_file_handle));
+    entry->valid = true;
+    
+    ncaGcHandleIndex = ((ncaGcHandleIndex + 1) % NCA_GC_HANDLE_CNT);
+    
+    mutexUnlock(&ncaGcHandleMutex);
+    
+    return true;
+}
+
+bool readNcaDataByContentIdUncached(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 offset, void *outBuf, size_t bufSize)
 {
     if (!ncmStorage || !ncaId || !outBuf || !bufSize)
     {
@@ -305,6 +376,7 @@ bool readNcaDataByContentId(NcmContentStorage *ncmStorage, const NcmContentId *n
     
     Result result = 0;
     bool success = false;
+    hfs0_file_handle handle;
     
     char nca_id[SHA256_HASH_SIZE + 1] = {'\0'}, nca_path[0x301] = {'\0'};
     convertDataToHexString(ncaId->c, SHA256_HASH_SIZE / 2, nca_id, SHA256_HASH_SIZE + 1);
@@ -321,12 +393,15 @@ bool readNcaDataByContentId(NcmContentStorage *ncmStorage, const NcmContentId *n
     {
         // Retrieve NCA data using raw IStorage reads
         // Fixes NCA access problems with gamecards under low HOS versions when using ncmContentStorageReadContentIdFile()
-        success = readFileFromSecureHfs0PartitionByName(strrchr(nca_path, '/') + 1, offset, outBuf, bufSize);
+        success = (getNcaGameCardHandle(ncaId, strrchr(nca_path, '/') + 1, &handle) && readHfs0FileByHandle(&handle, offset, outBuf, bufSize));
         if (!success) breaks++;
     } else {
         // Retrieve NCA data normally
         // This strips NAX0 encryption from SD card NCAs (not used with eMMC NCAs)
+        u64 startTick = perfTick();
         result = ncmContentStorageReadContentIdFile(ncmStorage, outBuf, bufSize, ncaId, offset);
+        perfAdd(PERF_STAGE_READ, startTick, bufSize);
+        
         success = R_SUCCEEDED(result);
     }
     
@@ -335,58 +410,106 @@ bool readNcaDataByContentId(NcmContentStorage *ncmStorage, const NcmContentId *n
     return success;
 }
 
-bool processNcaCtrSectionBlock(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *ctx, u64 offset, void *outBuf, size_t bufSize, bool encrypt)
+bool readNcaDataByContentId(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 offset, void *outBuf, size_t bufSize)
 {
-    if (!ncmStorage || !ncaId || !outBuf || !bufSize || !ctx)
+    return ncaCacheRead(ncmStorage, ncaId, offset, outBuf, bufSize);
+}
+
+/* Resets the AES-CTR context using the CTR for a 0x10-aligned offset. */
+static void nca_reset_ctr(Aes128CtrContext *ctx, bool bktr, u32 ctr_val, u64 ofs)
+{
+    unsigned char ctr[0x10];
+    
+    memcpy(ctr, ctx->ctr, 0x10);
+    
+    if (bktr)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to process %s NCA section block!", __func__, (encrypt ? "decrypted" : "encrypted"));
-        return false;
+        nca_update_bktr_ctr(ctr, ctr_val, ofs);
+    } else {
+        nca_update_ctr(ctr, ofs);
     }
     
-    if (!loadNcaKeyset()) return false;
-    
-    unsigned char ctr[0x10];
+    aes128CtrContextResetCtr(ctx, ctr);
+}
+
+/* Applies the AES-CTR keystream in place to a buffer holding data from an arbitrary NCA offset. */
+/* Only the unaligned head and tail go through a 0x10 bytes block, everything else is processed directly within the provided buffer. */
+static void nca_ctr_crypt_in_place(Aes128CtrContext *ctx, bool bktr, u32 ctr_val, u64 offset, u8 *buf, u64 size)
+{
+    u8 block[0x10];
+    u64 block_data_offset, chunk_size;
+    u64 startTick = perfTick(), totalSize = size;
     
-    char nca_id[SHA256_HASH_SIZE + 1] = {'\0'};
-    convertDataToHexString(ncaId->c, SHA256_HASH_SIZE / 2, nca_id, SHA256_HASH_SIZE + 1);
+    // Unaligned head
+    block_data_offset = (offset % 0x10);
+    if (size && block_data_offset)
+    {
+        chunk_size = (0x10 - block_data_offset);
+        if (chunk_size > size) chunk_size = size;
+        
+        memset(block, 0, 0x10);
+        memcpy(block + block_data_offset, buf, chunk_size);
+        
+        nca_reset_ctr(ctx, bktr, ctr_val, offset - block_data_offset);
+        aes128CtrCrypt(ctx, block, block, 0x10);
+        
+        memcpy(buf, block + block_data_offset, chunk_size);
+        
+        buf += chunk_size;
+        offset += chunk_size;
+        size -= chunk_size;
+    }
     
-    u64 block_start_offset = (offset - (offset % 0x10));
-    u64 block_end_offset = (u64)round_up(offset + bufSize, 0x10);
-    u64 block_size = (block_end_offset - block_start_offset);
+    // Aligned body
+    chunk_size = (size - (size % 0x10));
+    if (chunk_size)
+    {
+        nca_reset_ctr(ctx, bktr, ctr_val, offset);
+        aes128CtrCrypt(ctx, buf, buf, chunk_size);
+        
+        buf += chunk_size;
+        offset += chunk_size;
+        size -= chunk_size;
+    }
     
-    u64 block_size_used = (block_size > NCA_CTR_BUFFER_SIZE ? NCA_CTR_BUFFER_SIZE : block_size);
-    u64 output_block_size = (block_size > NCA_CTR_BUFFER_SIZE ? (NCA_CTR_BUFFER_SIZE - (offset - block_start_offset)) : bufSize);
+    // Unaligned tail
+    if (size)
+    {
+        memset(block, 0, 0x10);
+        memcpy(block, buf, size);
+        
+        nca_reset_ctr(ctx, bktr, ctr_val, offset);
+        aes128CtrCrypt(ctx, block, block, 0x10);
+        
+        memcpy(buf, block, size);
+    }
     
-    if (!readNcaDataByContentId(ncmStorage, ncaId, block_start_offset, ncaCtrBuf, block_size_used))
+    perfAdd(PERF_STAGE_CRYPT, startTick, totalSize);
+}
+
+bool processNcaCtrSectionBlock(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *ctx, u64 offset, void *outBuf, size_t bufSize, bool encrypt)
+{
+    if (!ncmStorage || !ncaId || !outBuf || !bufSize || !ctx)
     {
-        breaks++;
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read encrypted data block from NCA \"%s\"!", __func__, nca_id);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to process %s NCA section block!", __func__, (encrypt ? "decrypted" : "encrypted"));
         return false;
     }
     
-    // Update CTR
-    memcpy(ctr, ctx->ctr, 0x10);
-    nca_update_ctr(ctr, block_start_offset);
-    aes128CtrContextResetCtr(ctx, ctr);
-    
-    // Decrypt CTR block
-    aes128CtrCrypt(ctx, ncaCtrBuf, ncaCtrBuf, block_size_used);
+    if (!loadNcaKeyset()) return false;
     
-    if (encrypt)
+    // Data is read straight into the output buffer and decrypted in place, regardless of its size
+    // No NCA read is needed at all for encryption: CTR mode just applies the same keystream to the plaintext
+    if (!encrypt && !readNcaDataByContentId(ncmStorage, ncaId, offset, outBuf, bufSize))
     {
-        // Copy data to be encrypted
-        memcpy(ncaCtrBuf + (offset - block_start_offset), outBuf, output_block_size);
-        
-        // Reset CTR
-        aes128CtrContextResetCtr(ctx, ctr);
+        char nca_id[SHA256_HASH_SIZE + 1] = {'\0'};
+        convertDataToHexString(ncaId->c, SHA256_HASH_SIZE / 2, nca_id, SHA256_HASH_SIZE + 1);
         
-        // Encrypt CTR block
-        aes128CtrCrypt(ctx, ncaCtrBuf, ncaCtrBuf, block_size_used);
+        breaks++;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read encrypted data block from NCA \"%s\"!", __func__, nca_id);
+        return false;
     }
     
-    memcpy(outBuf, ncaCtrBuf + (offset - block_start_offset), output_block_size);
-    
-    if (block_size > NCA_CTR_BUFFER_SIZE) return processNcaCtrSectionBlock(ncmStorage, ncaId, ctx, offset + output_block_size, outBuf + output_block_size, bufSize - output_block_size, encrypt);
+    nca_ctr_crypt_in_place(ctx, false, 0, offset, (u8*)outBuf, bufSize);
     
     return true;
 }
@@ -397,7 +520,8 @@ bktr_relocation_bucket_t *bktr_get_relocation_bucket(bktr_relocation_block_t *bl
 }
 
 // Get a relocation entry from offset and relocation block
-bktr_relocation_entry_t *bktr_get_relocation(bktr_relocation_block_t *block, u64 offset)
+// The cursor remembers the last bucket/entry pair that was looked up, so sequential lookups don't need to search the whole table
+bktr_relocation_entry_t *bktr_get_relocation(bktr_relocation_block_t *block, u64 offset, bktr_cursor_t *cursor)
 {
     // Weak check for invalid offset
     if (offset > block->total_size)
@@ -406,20 +530,69 @@ bktr_relocation_entry_t *bktr_get_relocation(bktr_relocation_block_t *block, u64
         return NULL;
     }
     
-    u32 i, bucket_num = 0;
+    u32 i;
+    bktr_relocation_bucket_t *bucket = NULL;
+    bktr_relocation_entry_t *entry = NULL;
     
-    for(i = 1; i < block->num_buckets; i++)
+    // Check the cached entry and the one right after it
+    if (cursor && cursor->bucket < block->num_buckets)
     {
-        if (block->bucket_virtual_offsets[i] <= offset) bucket_num++;
+        for(i = 0; i < 2; i++)
+        {
+            bucket = bktr_get_relocation_bucket(block, cursor->bucket);
+            if (cursor->entry >= bucket->num_entries) break;
+            
+            entry = &(bucket->entries[cursor->entry]);
+            if (offset < entry->virt_offset) break;
+            if (offset < (entry + 1)->virt_offset) return entry;
+            
+            if ((cursor->entry + 1) < bucket->num_entries)
+            {
+                cursor->entry++;
+            } else
+            if ((cursor->bucket + 1) < block->num_buckets)
+            {
+                cursor->bucket++;
+                cursor->entry = 0;
+            } else {
+                break;
+            }
+        }
     }
     
-    bktr_relocation_bucket_t *bucket = bktr_get_relocation_bucket(block, bucket_num);
+    // Binary search (bucket)
+    u32 bucket_num = 0, low = 1, high = block->num_buckets;
+    
+    while(low < high)
+    {
+        u32 mid = ((low + high) / 2);
+        
+        if (block->bucket_virtual_offsets[mid] <= offset)
+        {
+            bucket_num = mid;
+            low = (mid + 1);
+        } else {
+            high = mid;
+        }
+    }
+    
+    bucket = bktr_get_relocation_bucket(block, bucket_num);
     
     // Check for edge case, short circuit
-    if (bucket->num_entries == 1) return &(bucket->entries[0]);
+    if (bucket->num_entries == 1)
+    {
+        if (cursor)
+        {
+            cursor->bucket = bucket_num;
+            cursor->entry = 0;
+        }
+        
+        return &(bucket->entries[0]);
+    }
     
-    // Binary search
-    u32 low = 0, high = (bucket->num_entries - 1);
+    // Binary search (entry)
+    low = 0;
+    high = (bucket->num_entries - 1);
     
     while(low <= high)
     {
@@ -433,7 +606,16 @@ bktr_relocation_entry_t *bktr_get_relocation(bktr_relocation_block_t *block, u64
             // block->entries[mid].offset <= offset
             
             // Check for success
-            if (mid == (bucket->num_entries - 1) || bucket->entries[mid + 1].virt_offset > offset) return &(bucket->entries[mid]);
+            if (mid == (bucket->num_entries - 1) || bucket->entries[mid + 1].virt_offset > offset)
+            {
+                if (cursor)
+                {
+                    cursor->bucket = bucket_num;
+                    cursor->entry = mid;
+                }
+                
+                return &(bucket->entries[mid]);
+            }
             
             low = (mid + 1);
         }
@@ -449,28 +631,78 @@ bktr_subsection_bucket_t *bktr_get_subsection_bucket(bktr_subsection_block_t *bl
 }
 
 // Get a subsection entry from offset and subsection block
-bktr_subsection_entry_t *bktr_get_subsection(bktr_subsection_block_t *block, u64 offset)
+// Uses the same cursor logic as bktr_get_relocation()
+bktr_subsection_entry_t *bktr_get_subsection(bktr_subsection_block_t *block, u64 offset, bktr_cursor_t *cursor)
 {
     // If offset is past the virtual, we're reading from the BKTR_HEADER subsection
     bktr_subsection_bucket_t *last_bucket = bktr_get_subsection_bucket(block, block->num_buckets - 1);
     if (offset >= last_bucket->entries[last_bucket->num_entries].offset) return &(last_bucket->entries[last_bucket->num_entries]);
     
-    u32 i, bucket_num = 0;
+    u32 i;
+    bktr_subsection_bucket_t *bucket = NULL;
+    bktr_subsection_entry_t *entry = NULL;
     
-    for(i = 1; i < block->num_buckets; i++)
+    // Check the cached entry and the one right after it
+    if (cursor && cursor->bucket < block->num_buckets)
     {
-        if (block->bucket_physical_offsets[i] <= offset) bucket_num++;
+        for(i = 0; i < 2; i++)
+        {
+            bucket = bktr_get_subsection_bucket(block, cursor->bucket);
+            if (cursor->entry >= bucket->num_entries) break;
+            
+            entry = &(bucket->entries[cursor->entry]);
+            if (offset < entry->offset) break;
+            if (offset < (entry + 1)->offset) return entry;
+            
+            if ((cursor->entry + 1) < bucket->num_entries)
+            {
+                cursor->entry++;
+            } else
+            if ((cursor->bucket + 1) < block->num_buckets)
+            {
+                cursor->bucket++;
+                cursor->entry = 0;
+            } else {
+                break;
+            }
+        }
+    }
+    
+    // Binary search (bucket)
+    u32 bucket_num = 0, low = 1, high = block->num_buckets;
+    
+    while(low < high)
+    {
+        u32 mid = ((low + high) / 2);
+        
+        if (block->bucket_physical_offsets[mid] <= offset)
+        {
+            bucket_num = mid;
+            low = (mid + 1);
+        } else {
+            high = mid;
+        }
     }
     
-    bktr_subsection_bucket_t *bucket = bktr_get_subsection_bucket(block, bucket_num);
+    bucket = bktr_get_subsection_bucket(block, bucket_num);
     
     // Check for edge case, short circuit
-    if (bucket->num_entries == 1) return &(bucket->entries[0]);
+    if (bucket->num_entries == 1)
+    {
+        if (cursor)
+        {
+            cursor->bucket = bucket_num;
+            cursor->entry = 0;
+        }
+        
+        return &(bucket->entries[0]);
+    }
     
-    // Binary search
-    u32 low = 0, high = (bucket->num_entries - 1);
+    // Binary search (entry)
+    low = 0;
+    high = (bucket->num_entries - 1);
     
-    while (low <= high)
+    while(low <= high)
     {
         u32 mid = ((low + high) / 2);
         
@@ -482,7 +714,16 @@ bktr_subsection_entry_t *bktr_get_subsection(bktr_subsection_block_t *block, u64
             // block->entries[mid].offset <= offset
             
             // Check for success
-            if (mid == (bucket->num_entries - 1) || bucket->entries[mid + 1].offset > offset) return &(bucket->entries[mid]);
+            if (mid == (bucket->num_entries - 1) || bucket->entries[mid + 1].offset > offset)
+            {
+                if (cursor)
+                {
+                    cursor->bucket = bucket_num;
+                    cursor->entry = mid;
+                }
+                
+                return &(bucket->entries[mid]);
+            }
             
             low = (mid + 1);
         }
@@ -492,16 +733,16 @@ bktr_subsection_entry_t *bktr_get_subsection(bktr_subsection_block_t *block, u64
     return NULL;
 }
 
-bool bktrSectionSeek(u64 offset)
+bktr_relocation_entry_t *bktrSectionSeek(u64 offset)
 {
     if (!bktrContext.section_offset || !bktrContext.section_size || !bktrContext.relocation_block || !bktrContext.subsection_block)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to seek within NCA BKTR section!", __func__);
-        return false;
+        return NULL;
     }
     
-    bktr_relocation_entry_t *reloc = bktr_get_relocation(bktrContext.relocation_block, offset);
-    if (!reloc) return false;
+    bktr_relocation_entry_t *reloc = bktr_get_relocation(bktrContext.relocation_block, offset, &(bktrContext.relocation_cursor));
+    if (!reloc) return NULL;
     
     // No better way to do this than to make all BKTR seeking virtual
     bktrContext.virtual_seek = offset;
@@ -519,7 +760,7 @@ bool bktrSectionSeek(u64 offset)
         bktrContext.base_seek = section_ofs;
     }
     
-    return true;
+    return reloc;
 }
 
 bool bktrSectionPhysicalRead(void *outBuf, size_t bufSize)
@@ -530,65 +771,42 @@ bool bktrSectionPhysicalRead(void *outBuf, size_t bufSize)
         return false;
     }
     
-    unsigned char ctr[0x10];
-    
-    bktr_subsection_entry_t *subsec = bktr_get_subsection(bktrContext.subsection_block, bktrContext.bktr_seek);
-    if (!subsec) return false;
-    
-    bktr_subsection_entry_t *next_subsec = (subsec + 1);
+    u8 *out = (u8*)outBuf;
+    u64 phys_seek = bktrContext.bktr_seek;
+    u64 rest_size = bufSize;
     
-    u64 base_offset = (bktrContext.section_offset + bktrContext.bktr_seek);
-    
-    u64 virt_seek = bktrContext.virtual_seek;
-    
-    if ((bktrContext.bktr_seek + bufSize) <= next_subsec->offset)
+    // Reads spanning multiple subsections are split into per-subsection chunks
+    while(rest_size > 0)
     {
-        // Easy path, reading *only* within the subsection
-        u64 block_start_offset = (base_offset - (base_offset % 0x10));
-        u64 block_end_offset = (u64)round_up(base_offset + bufSize, 0x10);
-        u64 block_size = (block_end_offset - block_start_offset);
+        bktr_subsection_entry_t *subsec = bktr_get_subsection(bktrContext.subsection_block, phys_seek, &(bktrContext.subsection_cursor));
+        if (!subsec) return false;
         
-        u64 output_offset = 0;
-        u64 ctr_buf_offset = (base_offset - block_start_offset);
-        u64 output_block_size = (block_size > NCA_CTR_BUFFER_SIZE ? (NCA_CTR_BUFFER_SIZE - (base_offset - block_start_offset)) : bufSize);
+        bktr_subsection_entry_t *next_subsec = (subsec + 1);
         
-        while(block_size > 0)
+        if (next_subsec->offset <= phys_seek)
         {
-            u64 block_size_used = (block_size > NCA_CTR_BUFFER_SIZE ? NCA_CTR_BUFFER_SIZE : block_size);
-            
-            if (!readNcaDataByContentId(&(bktrContext.ncmStorage), &(bktrContext.ncaId), block_start_offset, ncaCtrBuf, block_size_used))
-            {
-                breaks++;
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read encrypted %lu bytes block at offset 0x%016lX!", __func__, block_size_used, block_start_offset);
-                return false;
-            }
-            
-            // Update BKTR CTR
-            memcpy(ctr, bktrContext.aes_ctx.ctr, 0x10);
-            nca_update_bktr_ctr(ctr, subsec->ctr_val, block_start_offset);
-            aes128CtrContextResetCtr(&(bktrContext.aes_ctx), ctr);
-            
-            // Decrypt CTR block
-            aes128CtrCrypt(&(bktrContext.aes_ctx), ncaCtrBuf, ncaCtrBuf, block_size_used);
-            memcpy(outBuf + output_offset, ncaCtrBuf + ctr_buf_offset, output_block_size);
-            
-            block_start_offset += block_size_used;
-            block_size -= block_size_used;
-            
-            if (block_size)
-            {
-                output_offset += output_block_size;
-                ctr_buf_offset = 0;
-                output_block_size = (block_size > NCA_CTR_BUFFER_SIZE ? NCA_CTR_BUFFER_SIZE : ((base_offset + bufSize) - block_start_offset));
-            }
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid BKTR subsection boundary at physical offset 0x%016lX!", __func__, phys_seek);
+            return false;
         }
-    } else {
-        // Sad path
-        u64 within_subsection = (next_subsec->offset - bktrContext.bktr_seek);
         
-        if (!readBktrSectionBlock(virt_seek, outBuf, within_subsection)) return false;
+        u64 chunk_size = (next_subsec->offset - phys_seek);
+        if (chunk_size > rest_size) chunk_size = rest_size;
         
-        if (!readBktrSectionBlock(virt_seek + within_subsection, (u8*)outBuf + within_subsection, bufSize - within_subsection)) return false;
+        u64 base_offset = (bktrContext.section_offset + phys_seek);
+        
+        if (!readNcaDataByContentId(&(bktrContext.ncmStorage), &(bktrContext.ncaId), base_offset, out, chunk_size))
+        {
+            breaks++;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read encrypted %lu bytes block at offset 0x%016lX!", __func__, chunk_size, base_offset);
+            return false;
+        }
+        
+        // Decrypt data in place using the BKTR CTR
+        nca_ctr_crypt_in_place(&(bktrContext.aes_ctx), true, subsec->ctr_val, base_offset, out, chunk_size);
+        
+        out += chunk_size;
+        phys_seek += chunk_size;
+        rest_size -= chunk_size;
     }
     
     return true;
@@ -604,23 +822,30 @@ bool readBktrSectionBlock(u64 offset, void *outBuf, size_t bufSize)
     
     if (!loadNcaKeyset()) return false;
     
-    if (!bktrSectionSeek(offset)) return false;
+    u8 *out = (u8*)outBuf;
+    u64 virt_seek = offset;
+    u64 rest_size = bufSize;
     
-    bktr_relocation_entry_t *reloc = bktr_get_relocation(bktrContext.relocation_block, bktrContext.virtual_seek);
-    if (!reloc) return false;
-    
-    bktr_relocation_entry_t *next_reloc = (reloc + 1);
-    
-    u64 virt_seek = bktrContext.virtual_seek;
-    
-    // Perform read operation
-    if ((bktrContext.virtual_seek + bufSize) <= next_reloc->virt_offset)
+    // Reads spanning multiple relocations are split into per-relocation chunks
+    while(rest_size > 0)
     {
-        // Easy path: We're reading *only* within the current relocation
+        bktr_relocation_entry_t *reloc = bktrSectionSeek(virt_seek);
+        if (!reloc) return false;
+        
+        bktr_relocation_entry_t *next_reloc = (reloc + 1);
+        
+        if (next_reloc->virt_offset <= virt_seek)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid BKTR relocation boundary at virtual offset 0x%016lX!", __func__, virt_seek);
+            return false;
+        }
+        
+        u64 chunk_size = (next_reloc->virt_offset - virt_seek);
+        if (chunk_size > rest_size) chunk_size = rest_size;
         
         if (reloc->is_patch)
         {
-            if (!bktrSectionPhysicalRead(outBuf, bufSize)) return false;
+            if (!bktrSectionPhysicalRead(out, chunk_size)) return false;
         } else {
             if (!bktrContext.use_base_romfs)
             {
@@ -630,16 +855,68 @@ bool readBktrSectionBlock(u64 offset, void *outBuf, size_t bufSize)
             }
             
             // Nice and easy read from the base RomFS
-            if (!processNcaCtrSectionBlock(&(romFsContext.ncmStorage), &(romFsContext.ncaId), &(romFsContext.aes_ctx), romFsContext.section_offset + bktrContext.base_seek, outBuf, bufSize, false)) return false;
+            if (!processNcaCtrSectionBlock(&(romFsContext.ncmStorage), &(romFsContext.ncaId), &(romFsContext.aes_ctx), romFsContext.section_offset + bktrContext.base_seek, out, chunk_size, false)) return false;
         }
-    } else {
-        u64 within_relocation = (next_reloc->virt_offset - bktrContext.virtual_seek);
         
-        if (!readBktrSectionBlock(virt_seek, outBuf, within_relocation)) return false;
+        out += chunk_size;
+        virt_seek += chunk_size;
+        rest_size -= chunk_size;
+    }
+    
+    return true;
+}
+
+bool hashBktrSectionLayout(u64 offset, u64 size, Sha256Context *ctx)
+{
+    if (!bktrContext.section_offset || !bktrContext.section_size || !bktrContext.relocation_block || !ctx)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to hash NCA BKTR section layout!", __func__);
+        return false;
+    }
+    
+    u64 virt_seek = offset;
+    u64 rest_size = size;
+    layeredfs_source_area area;
+    
+    memset(&area, 0, sizeof(layeredfs_source_area));
+    
+    while(rest_size > 0)
+    {
+        // Don't use bktrSectionSeek() here: we're not going to read anything
+        bktr_relocation_entry_t *reloc = bktr_get_relocation(bktrContext.relocation_block, virt_seek, &(bktrContext.relocation_cursor));
+        if (!reloc) return false;
+        
+        bktr_relocation_entry_t *next_reloc = (reloc + 1);
+        
+        if (next_reloc->virt_offset <= virt_seek)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid BKTR relocation boundary at virtual offset 0x%016lX!", __func__, virt_seek);
+            return false;
+        }
+        
+        u64 chunk_size = (next_reloc->virt_offset - virt_seek);
+        if (chunk_size > rest_size) chunk_size = rest_size;
+        
+        const NcmContentId *ncaId = (reloc->is_patch ? &(bktrContext.ncaId) : &(romFsContext.ncaId));
+        u64 section_ofs = (virt_seek - reloc->virt_offset + reloc->phys_offset);
         
-        if (!readBktrSectionBlock(virt_seek + within_relocation, (u8*)outBuf + within_relocation, bufSize - within_relocation)) return false;
+        if (area.size && !memcmp(&(area.ncaId), ncaId, sizeof(NcmContentId)) && (area.offset + area.size) == section_ofs)
+        {
+            area.size += chunk_size;
+        } else {
+            if (area.size) sha256ContextUpdate(ctx, &area, sizeof(layeredfs_source_area));
+            
+            memcpy(&(area.ncaId), ncaId, sizeof(NcmContentId));
+            area.offset = section_ofs;
+            area.size = chunk_size;
+        }
+        
+        virt_seek += chunk_size;
+        rest_size -= chunk_size;
     }
     
+    if (area.size) sha256ContextUpdate(ctx, &area, sizeof(layeredfs_source_area));
+    
     return true;
 }
 
@@ -700,18 +977,8 @@ bool encryptNcaHeader(nca_header_t *input, u8 *outBuf, u64 outBufSize)
     return true;
 }
 
-bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title_rights_ctx *rights_info, u8 *decrypted_nca_keys, bool retrieveTitleKeyData)
+static bool decryptNcaHeaderData(const u8 *ncaBuf, nca_header_t *out)
 {
-    if (!ncaBuf || !ncaBufSize || ncaBufSize < NCA_FULL_HEADER_LENGTH || !out || !decrypted_nca_keys)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NCA header decryption parameters!", __func__);
-        return false;
-    }
-    
-    if (!loadNcaKeyset()) return false;
-    
-    int ret;
-    
     u32 i;
     size_t crypt_res;
     Aes128XtsContext hdr_aes_ctx;
@@ -719,8 +986,6 @@ bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title
     u8 header_key_0[16];
     u8 header_key_1[16];
     
-    bool has_rights_id = false;
-    
     memcpy(header_key_0, nca_keyset.header_key, 16);
     memcpy(header_key_1, nca_keyset.header_key + 16, 16);
     
@@ -763,6 +1028,31 @@ bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title
         return false;
     }
     
+    return true;
+}
+
+bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, const NcmContentId *ncaId, nca_header_t *out, title_rights_ctx *rights_info, u8 *decrypted_nca_keys, bool retrieveTitleKeyData)
+{
+    if (!ncaBuf || !ncaBufSize || ncaBufSize < NCA_FULL_HEADER_LENGTH || !out || !decrypted_nca_keys)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NCA header decryption parameters!", __func__);
+        return false;
+    }
+    
+    if (!loadNcaKeyset()) return false;
+    
+    int ret;
+    
+    u32 i;
+    
+    bool has_rights_id = false;
+    bool cachedHeader = false, cachedKeyArea = false;
+    
+    // Skip the AES-XTS pass (and the key area decryption) if we have already dealt with this NCA
+    if (ncaId) cachedHeader = ncaMetaCacheGetHeader(ncaId, out, decrypted_nca_keys, &cachedKeyArea);
+    
+    if (!cachedHeader && !decryptNcaHeaderData(ncaBuf, out)) return false;
+    
     for(i = 0; i < 0x10; i++)
     {
         if (out->rights_id[i] != 0)
@@ -829,9 +1119,11 @@ bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title
             }
         }
     } else {
-        if (!decryptNcaKeyArea(out, decrypted_nca_keys)) return false;
+        if (!cachedKeyArea && !decryptNcaKeyArea(out, decrypted_nca_keys)) return false;
     }
     
+    if (ncaId) ncaMetaCacheStoreHeader(ncaId, out, (has_rights_id ? NULL : decrypted_nca_keys));
+    
     return true;
 }
 
@@ -1261,9 +1553,12 @@ bool retrieveCnmtNcaData(NcmStorageId curStorageId, u8 *ncaBuf, cnmt_xml_program
     char cnmtFileName[50] = {'\0'};
     snprintf(cnmtFileName, MAX_CHARACTERS(cnmtFileName), "%s_%016lx.cnmt", getTitleType(xml_program_info->type), xml_program_info->title_id);
     
+    NcmContentId cnmtNcaId;
+    memcpy(cnmtNcaId.c, xml_content_info[cnmtNcaIndex].nca_id, sizeof(cnmtNcaId.c));
+    
     // Decrypt the NCA header
     // Don't retrieve the ticket and/or titlekey if we're dealing with a Patch with titlekey crypto bundled with the inserted gamecard
-    if (!decryptNcaHeader(ncaBuf, xml_content_info[cnmtNcaIndex].size, &dec_header, rights_info, xml_content_info[cnmtNcaIndex].decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard))) return false;
+    if (!decryptNcaHeader(ncaBuf, xml_content_info[cnmtNcaIndex].size, &cnmtNcaId, &dec_header, rights_info, xml_content_info[cnmtNcaIndex].decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard))) return false;
     
     if (dec_header.fs_headers[0].partition_type != NCA_FS_HEADER_PARTITION_PFS0 || dec_header.fs_headers[0].fs_type != NCA_FS_HEADER_FSTYPE_PFS0)
     {
@@ -2035,6 +2330,10 @@ bool parseBktrEntryFromNca(NcmContentStorage *ncmStorage, const NcmContentId *nc
     last_subsec_bucket->entries[last_subsec_bucket->num_entries + 1].offset = bktrContext.section_size;
     last_subsec_bucket->entries[last_subsec_bucket->num_entries + 1].ctr_val = 0;
     
+    // Reset lookup cursors
+    memset(&(bktrContext.relocation_cursor), 0, sizeof(bktr_cursor_t));
+    memset(&(bktrContext.subsection_cursor), 0, sizeof(bktr_cursor_t));
+    
     // Parse RomFS section
     bktrContext.romfs_offset = dec_nca_header->fs_headers[bktr_index].bktr_superblock.ivfc_header.level_headers[IVFC_MAX_LEVEL - 1].logical_offset;
     bktrContext.romfs_size = dec_nca_header->fs_headers[bktr_index].bktr_superblock.ivfc_header.level_headers[IVFC_MAX_LEVEL - 1].hash_data_size;
@@ -2143,14 +2442,17 @@ out:
     return success;
 }
 
-bool generateProgramInfoXml(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, bool useCustomAcidRsaPubKey, char **outBuf, u64 *outBufSize)
+bool generateProgramInfoXml(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, bool useCustomAcidRsaPubKey, mem_arena_t *arena, char **outBuf, u64 *outBufSize)
 {
-    if (!ncmStorage || !ncaId || !dec_nca_header || !decrypted_nca_keys || !outBuf || !outBufSize)
+    if (!ncmStorage || !ncaId || !dec_nca_header || !decrypted_nca_keys || !arena || !outBuf || !outBufSize)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to generate \"programinfo.xml\"!", __func__);
         return false;
     }
     
+    // The XML only depends on the NCA contents and the ACID public key patch, so there's no need to parse the ExeFS section and the main NSO all over again
+    if (ncaMetaCacheGetProgramInfoXml(ncaId, useCustomAcidRsaPubKey, arena, outBuf, outBufSize)) return true;
+    
     if (dec_nca_header->fs_headers[0].partition_type != NCA_FS_HEADER_PARTITION_PFS0 || dec_nca_header->fs_headers[0].fs_type != NCA_FS_HEADER_FSTYPE_PFS0)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: Program NCA section #0 doesn't hold a PFS0 partition!", __func__);
@@ -2186,6 +2488,7 @@ bool generateProgramInfoXml(NcmContentStorage *ncmStorage, const NcmContentId *n
     Aes128CtrContext aes_ctx;
     
     char *programInfoXml = NULL;
+    u64 xmlSize = 0;
     char tmp[NAME_BUF_LEN] = {'\0'};
     
     u32 npdmEntry = 0;
@@ -2272,8 +2575,9 @@ bool generateProgramInfoXml(NcmContentStorage *ncmStorage, const NcmContentId *n
     
     nca_pfs0_data_offset = (nca_pfs0_str_table_offset + (u64)nca_pfs0_header.str_table_size);
     
-    // Allocate memory for the programinfo.xml contents, making sure there's enough space
-    programInfoXml = calloc(NSP_XML_BUFFER_SIZE, sizeof(char));
+    // Build the programinfo.xml contents in the arena scratch buffer, making sure there's enough space
+    // Only the actual XML length is kept once we're done
+    programInfoXml = arenaScratch(arena, NSP_XML_BUFFER_SIZE);
     if (!programInfoXml)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the \"programinfo.xml\" contents!", __func__);
@@ -2453,8 +2757,18 @@ bool generateProgramInfoXml(NcmContentStorage *ncmStorage, const NcmContentId *n
     
     strcat(programInfoXml, "</ProgramInfo>");
     
-    *outBuf = programInfoXml;
-    *outBufSize = strlen(programInfoXml);
+    xmlSize = strlen(programInfoXml);
+    
+    *outBuf = arenaMemdup(arena, programInfoXml, xmlSize + 1);
+    if (!*outBuf)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the \"programinfo.xml\" contents!", __func__);
+        goto out;
+    }
+    
+    *outBufSize = xmlSize;
+    
+    ncaMetaCacheStoreProgramInfoXml(ncaId, useCustomAcidRsaPubKey, programInfoXml, xmlSize);
     
     success = true;
     
@@ -2463,8 +2777,6 @@ out:
     
     if (npdm_acid_section) free(npdm_acid_section);
     
-    if (!success && programInfoXml) free(programInfoXml);
-    
     if (nca_pfs0_str_table) free(nca_pfs0_str_table);
     
     if (nca_pfs0_entries) free(nca_pfs0_entries);
@@ -2913,9 +3225,9 @@ char *getNacpJitConfigurationFlag(u64 val)
     return out;
 }
 
-bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, char **out_nacp_xml, u64 *out_nacp_xml_size, nacp_icons_ctx **out_nacp_icons_ctx, u8 *out_nacp_icons_ctx_cnt)
+bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, mem_arena_t *arena, char **out_nacp_xml, u64 *out_nacp_xml_size, nacp_icons_ctx **out_nacp_icons_ctx, u8 *out_nacp_icons_ctx_cnt)
 {
-    if (!ncmStorage || !ncaId || !dec_nca_header || !decrypted_nca_keys || !out_nacp_xml || !out_nacp_xml_size || !out_nacp_icons_ctx || !out_nacp_icons_ctx_cnt)
+    if (!ncmStorage || !ncaId || !dec_nca_header || !decrypted_nca_keys || !arena || !out_nacp_xml || !out_nacp_xml_size || !out_nacp_icons_ctx || !out_nacp_icons_ctx_cnt)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to generate NACP XML!", __func__);
         return false;
@@ -2979,7 +3291,8 @@ bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *
     }
     
     // Make sure that the output buffer for our NACP XML is big enough
-    nacpXml = calloc(NSP_XML_BUFFER_SIZE, sizeof(char));
+    // The XML is built in the arena scratch buffer, and only its actual length is kept once we're done
+    nacpXml = arenaScratch(arena, NSP_XML_BUFFER_SIZE);
     if (!nacpXml)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the NACP XML!", __func__);
@@ -3122,7 +3435,7 @@ bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *
     
     if (nacpIconCnt)
     {
-        nacpIcons = calloc(nacpIconCnt, sizeof(nacp_icons_ctx));
+        nacpIcons = arenaAlloc(arena, nacpIconCnt * sizeof(nacp_icons_ctx));
         if (!nacpIcons)
         {
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the NACP icons!", __func__);
@@ -3171,6 +3484,14 @@ bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *
             sprintf(nacpIcons[j].filename, "%s.nx.%s.jpg", ncaIdStr, getNacpLangName(i)); // Temporary, the NCA ID is subject to change
             nacpIcons[j].icon_size = entry->dataSize;
             
+            // Each icon only takes as much memory as it needs
+            nacpIcons[j].icon_data = arenaAlloc(arena, nacpIcons[j].icon_size);
+            if (!nacpIcons[j].icon_data)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for \"%s\"!", __func__, tmp);
+                goto out;
+            }
+            
             if (!processNcaCtrSectionBlock(ncmStorage, ncaId, &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + entry->dataOff, nacpIcons[j].icon_data, nacpIcons[j].icon_size, false))
             {
                 breaks++;
@@ -3376,9 +3697,15 @@ bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *
     
     strcat(nacpXml, "</Application>");
     
-    *out_nacp_xml = nacpXml;
     *out_nacp_xml_size = strlen(nacpXml);
     
+    *out_nacp_xml = arenaMemdup(arena, nacpXml, *out_nacp_xml_size + 1);
+    if (!*out_nacp_xml)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the NACP XML!", __func__);
+        goto out;
+    }
+    
     if (nacpIconCnt)
     {
         *out_nacp_icons_ctx = nacpIcons;
@@ -3388,13 +3715,6 @@ bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *
     success = true;
     
 out:
-    if (!success)
-    {
-        if (nacpIcons != NULL) free(nacpIcons);
-        
-        if (nacpXml != NULL) free(nacpXml);
-    }
-    
     // Manually free these pointers
     // Calling freeRomFsContext() would also close the ncmStorage handle
     free(romFsContext.romfs_dir_entries);
@@ -3406,9 +3726,9 @@ out:
     return success;
 }
 
-bool retrieveLegalInfoXmlFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, char **outBuf, u64 *outBufSize)
+bool retrieveLegalInfoXmlFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, mem_arena_t *arena, char **outBuf, u64 *outBufSize)
 {
-    if (!ncmStorage || !ncaId || !dec_nca_header || !decrypted_nca_keys || !outBuf)
+    if (!ncmStorage || !ncaId || !dec_nca_header || !decrypted_nca_keys || !arena || !outBuf)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to retrieve \"legalinfo.xml\"!", __func__);
         return false;
@@ -3445,7 +3765,7 @@ bool retrieveLegalInfoXmlFromNca(NcmContentStorage *ncmStorage, const NcmContent
     
     // Allocate memory for the legalinfo.xml contents
     legalInfoXmlSize = entry->dataSize;
-    legalInfoXml = calloc(legalInfoXmlSize, sizeof(char));
+    legalInfoXml = arenaAlloc(arena, legalInfoXmlSize);
     if (!legalInfoXml)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the \"legalinfo.xml\" contents!", __func__);
@@ -3465,8 +3785,6 @@ bool retrieveLegalInfoXmlFromNca(NcmContentStorage *ncmStorage, const NcmContent
     success = true;
     
 out:
-    if (!success && legalInfoXml != NULL) free(legalInfoXml);
-    
     // Manually free these pointers
     // Calling freeRomFsContext() would also close the ncmStorage handle
     free(romFsContext.romfs_dir_entries);
@@ -5,6 +5,8 @@
 
 #include <switch.h>
 
+#include "arena.h"
+
 #define NCA3_MAGIC                      (u32)0x4E434133     // "NCA3"
 #define NCA2_MAGIC                      (u32)0x4E434132     // "NCA2"
 
@@ -292,7 +294,7 @@ typedef struct {
 typedef struct {
     char filename[100];
     u64 icon_size;
-    u8 icon_data[0x20000];
+    u8 *icon_data; // Allocated from the dump arena, icon_size bytes long
 } nacp_icons_ctx;
 
 typedef struct {
@@ -363,6 +365,23 @@ typedef struct {
     u64 exefs_data_offset; // Relative to NCA start
 } exefs_ctx_t;
 
+// RomFS directory index entry. Child entry offsets are stored in table order (directories first, then files)
+typedef struct {
+    u32 offset; // Relative to directory table
+    u32 child_start; // Index within the child offset list
+    u32 child_dir_cnt;
+    u32 child_file_cnt;
+    u64 subtree_size; // Extracted size of this directory and all of its subdirectories
+} romfs_index_dir_entry;
+
+// Built once per RomFS session, the first time a directory listing or size is requested
+typedef struct {
+    romfs_index_dir_entry *dirs; // Sorted by directory offset
+    u32 dir_cnt;
+    u32 *child_offsets;
+    u32 child_cnt;
+} romfs_index_t;
+
 typedef struct {
     NcmStorageId storageId;
     NcmContentStorage ncmStorage;
@@ -380,6 +399,7 @@ typedef struct {
     u64 romfs_filetable_size;
     romfs_file *romfs_file_entries;
     u64 romfs_filedata_offset; // Relative to NCA start
+    romfs_index_t romfs_index;
 } romfs_ctx_t;
 
 typedef struct {
@@ -425,6 +445,12 @@ typedef struct {
     bktr_subsection_bucket_t buckets[];
 } PACKED bktr_subsection_block_t;
 
+// Last bucket/entry pair found in a BKTR relocation/subsection table lookup
+typedef struct {
+    u32 bucket;
+    u32 entry;
+} bktr_cursor_t;
+
 typedef struct {
     NcmStorageId storageId;
     NcmContentStorage ncmStorage;
@@ -436,6 +462,8 @@ typedef struct {
     bktr_superblock_t superblock;
     bktr_relocation_block_t *relocation_block;
     bktr_subsection_block_t *subsection_block;
+    bktr_cursor_t relocation_cursor;
+    bktr_cursor_t subsection_cursor;
     u64 virtual_seek; // Relative to section start
     u64 bktr_seek; // Relative to section start (patch BKTR section)
     u64 base_seek; // Relative to section start (base application RomFS section)
@@ -448,6 +476,7 @@ typedef struct {
     u64 romfs_filetable_size;
     romfs_file *romfs_file_entries;
     u64 romfs_filedata_offset; // Relative to section start
+    romfs_index_t romfs_index;
     bool use_base_romfs;
 } bktr_ctx_t;
 
@@ -729,15 +758,28 @@ void convertNcaSizeToU64(const u8 size[0x6], u64 *out);
 
 void convertU64ToNcaSize(const u64 size, u8 out[0x6]);
 
+/* Forgets the Secure HFS0 file handles resolved for gamecard NCAs (e.g. after a gamecard change). */
+void resetNcaGameCardHandles();
+
+/* Reads NCA data straight from storage. Gamecard NCAs are read through a Secure HFS0 file handle that's only resolved once per NCA. */
+bool readNcaDataByContentIdUncached(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 offset, void *outBuf, size_t bufSize);
+
+/* Goes through the NCA block cache (see nca_cache.h). */
 bool readNcaDataByContentId(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 offset, void *outBuf, size_t bufSize);
 
 bool processNcaCtrSectionBlock(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *ctx, u64 offset, void *outBuf, size_t bufSize, bool encrypt);
 
 bool readBktrSectionBlock(u64 offset, void *outBuf, size_t bufSize);
 
+/* Feeds the NCA areas that make up a virtual BKTR section span to a SHA-256 context (see layeredfs_manifest.h), without reading any data. Contiguous areas from the same NCA are merged. */
+bool hashBktrSectionLayout(u64 offset, u64 size, Sha256Context *ctx);
+
+/* AES-128-XTS with the big endian sector tweak used by NCA headers. */
+size_t aes128XtsNintendoCrypt(Aes128XtsContext *ctx, void *dst, const void *src, size_t size, u32 sector, bool encrypt);
+
 bool encryptNcaHeader(nca_header_t *input, u8 *outBuf, u64 outBufSize);
 
-bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title_rights_ctx *rights_info, u8 *decrypted_nca_keys, bool retrieveTitleKeyData);
+bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, const NcmContentId *ncaId, nca_header_t *out, title_rights_ctx *rights_info, u8 *decrypted_nca_keys, bool retrieveTitleKeyData);
 
 bool retrieveTitleKeyFromGameCardTicket(title_rights_ctx *rights_info, u8 *decrypted_nca_keys);
 
@@ -753,10 +795,10 @@ int parseRomFsEntryFromNca(NcmContentStorage *ncmStorage, const NcmContentId *nc
 
 bool parseBktrEntryFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, bool use_base_romfs);
 
-bool generateProgramInfoXml(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, bool useCustomAcidRsaPubKey, char **outBuf, u64 *outBufSize);
+bool generateProgramInfoXml(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, bool useCustomAcidRsaPubKey, mem_arena_t *arena, char **outBuf, u64 *outBufSize);
 
-bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, char **out_nacp_xml, u64 *out_nacp_xml_size, nacp_icons_ctx **out_nacp_icons_ctx, u8 *out_nacp_icons_ctx_cnt);
+bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, mem_arena_t *arena, char **out_nacp_xml, u64 *out_nacp_xml_size, nacp_icons_ctx **out_nacp_icons_ctx, u8 *out_nacp_icons_ctx_cnt);
 
-bool retrieveLegalInfoXmlFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, char **outBuf, u64 *outBufSize);
+bool retrieveLegalInfoXmlFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, mem_arena_t *arena, char **outBuf, u64 *outBufSize);
 
 #endif
@@ -0,0 +1,379 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "nca_cache.h"
+#include "nca.h"
+#include "perf.h"
+
+/* Small reads issued while parsing NCAs (headers, section superblocks, RomFS tables, NSO headers, NPDM/NACP data, etc.) tend to overlap each other */
+/* Each one of them used to be a full IPC round trip, so we keep the most recently used NCA blocks around */
+
+static Mutex ncaCacheMutex = 0;
+
+static nca_cache_block_t *ncaCacheBlocks = NULL;
+static u32 ncaCacheMaxBlockCnt = (u32)(NCA_CACHE_DEFAULT_BUDGET / NCA_CACHE_BLOCK_SIZE);
+static u64 ncaCacheTick = 0;
+
+static nca_cache_size_entry_t ncaCacheSizes[NCA_CACHE_SIZE_ENTRY_CNT];
+static u32 ncaCacheSizeIndex = 0;
+
+static nca_cache_stats_t ncaCacheStats = {0};
+
+static bool nca_cache_id_match(const NcmContentId *a, const NcmContentId *b)
+{
+    return !memcmp(a->c, b->c, sizeof(a->c));
+}
+
+static void nca_cache_release_blocks()
+{
+    u32 i;
+    
+    if (ncaCacheBlocks)
+    {
+        for(i = 0; i < ncaCacheStats.max_block_cnt; i++)
+        {
+            if (ncaCacheBlocks[i].data) free(ncaCacheBlocks[i].data);
+        }
+        
+        free(ncaCacheBlocks);
+        ncaCacheBlocks = NULL;
+    }
+    
+    memset(ncaCacheSizes, 0, sizeof(ncaCacheSizes));
+    ncaCacheSizeIndex = 0;
+    
+    ncaCacheTick = 0;
+    
+    memset(&ncaCacheStats, 0, sizeof(nca_cache_stats_t));
+}
+
+static bool nca_cache_find_content_size(const NcmContentId *ncaId, u64 *out)
+{
+    u32 i;
+    
+    for(i = 0; i < NCA_CACHE_SIZE_ENTRY_CNT; i++)
+    {
+        if (ncaCacheSizes[i].valid && nca_cache_id_match(&(ncaCacheSizes[i].ncaId), ncaId))
+        {
+            if (out) *out = ncaCacheSizes[i].size;
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+static void nca_cache_add_content_size(const NcmContentId *ncaId, u64 size)
+{
+    nca_cache_size_entry_t *entry = &(ncaCacheSizes[ncaCacheSizeIndex]);
+    memcpy(&(entry->ncaId), ncaId, sizeof(NcmContentId));
+    entry->size = size;
+    entry->valid = true;
+    
+    ncaCacheSizeIndex = ((ncaCacheSizeIndex + 1) % NCA_CACHE_SIZE_ENTRY_CNT);
+}
+
+static nca_cache_block_t *nca_cache_find_block(const NcmContentId *ncaId, u64 block_offset)
+{
+    u32 i;
+    
+    for(i = 0; i < ncaCacheStats.max_block_cnt; i++)
+    {
+        nca_cache_block_t *cur = &(ncaCacheBlocks[i]);
+        if (cur->last_use && cur->offset == block_offset && nca_cache_id_match(&(cur->ncaId), ncaId)) return cur;
+    }
+    
+    return NULL;
+}
+
+// Returns an unused block (allocating its buffer if needed) or recycles the least recently used one
+static nca_cache_block_t *nca_cache_alloc_block()
+{
+    u32 i;
+    nca_cache_block_t *block = NULL, *lru = NULL, *unused = NULL;
+    
+    for(i = 0; i < ncaCacheStats.max_block_cnt; i++)
+    {
+        nca_cache_block_t *cur = &(ncaCacheBlocks[i]);
+        
+        if (!cur->last_use)
+        {
+            if (!unused) unused = cur;
+            continue;
+        }
+        
+        if (!lru || cur->last_use < lru->last_use) lru = cur;
+    }
+    
+    if (unused)
+    {
+        block = unused;
+        
+        if (!block->data)
+        {
+            block->data = malloc(NCA_CACHE_BLOCK_SIZE);
+            if (block->data)
+            {
+                ncaCacheStats.block_cnt++;
+            } else {
+                // Out of memory - recycle the least recently used block, if available
+                if (!lru) return NULL;
+                block = lru;
+                ncaCacheStats.evictions++;
+            }
+        }
+    } else {
+        if (!lru) return NULL;
+        block = lru;
+        ncaCacheStats.evictions++;
+    }
+    
+    block->last_use = 0;
+    
+    return block;
+}
+
+static void nca_cache_store_block(nca_cache_block_t *block, const NcmContentId *ncaId, u64 block_offset, u64 block_size)
+{
+    memcpy(&(block->ncaId), ncaId, sizeof(NcmContentId));
+    block->offset = block_offset;
+    block->size = block_size;
+    block->last_use = ++ncaCacheTick;
+}
+
+static bool nca_cache_setup()
+{
+    if (ncaCacheBlocks) return true;
+    
+    ncaCacheBlocks = calloc(ncaCacheMaxBlockCnt, sizeof(nca_cache_block_t));
+    if (!ncaCacheBlocks) return false;
+    
+    ncaCacheStats.max_block_cnt = ncaCacheMaxBlockCnt;
+    
+    return true;
+}
+
+void ncaCacheSetBudget(u64 budget)
+{
+    mutexLock(&ncaCacheMutex);
+    
+    nca_cache_release_blocks();
+    ncaCacheMaxBlockCnt = (u32)(budget / NCA_CACHE_BLOCK_SIZE);
+    
+    mutexUnlock(&ncaCacheMutex);
+}
+
+void ncaCacheInvalidate()
+{
+    mutexLock(&ncaCacheMutex);
+    nca_cache_release_blocks();
+    mutexUnlock(&ncaCacheMutex);
+}
+
+void ncaCacheFree()
+{
+    ncaCacheInvalidate();
+}
+
+void ncaCacheGetStats(nca_cache_stats_t *out)
+{
+    if (!out) return;
+    
+    mutexLock(&ncaCacheMutex);
+    
+    memcpy(out, &ncaCacheStats, sizeof(nca_cache_stats_t));
+    out->max_block_cnt = ncaCacheMaxBlockCnt;
+    
+    mutexUnlock(&ncaCacheMutex);
+}
+
+bool ncaCacheRead(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 offset, void *outBuf, size_t bufSize)
+{
+    if (!ncmStorage || !ncaId || !outBuf || !bufSize) return readNcaDataByContentIdUncached(ncmStorage, ncaId, offset, outBuf, bufSize);
+    
+    bool success = true, known_size = false;
+    u64 content_size = 0;
+    u8 *out = (u8*)outBuf, *blockBuf = NULL;
+    
+    mutexLock(&ncaCacheMutex);
+    
+    bool enabled = (ncaCacheMaxBlockCnt > 0 && bufSize <= NCA_CACHE_MAX_CACHED_READ);
+    if (enabled) known_size = nca_cache_find_content_size(ncaId, &content_size);
+    
+    mutexUnlock(&ncaCacheMutex);
+    
+    if (enabled && !known_size)
+    {
+        s64 size = 0;
+        Result result = ncmContentStorageGetSizeFromContentId(ncmStorage, &size, ncaId);
+        
+        if (R_SUCCEEDED(result) && size > 0)
+        {
+            content_size = (u64)size;
+            known_size = true;
+            
+            mutexLock(&ncaCacheMutex);
+            if (!nca_cache_find_content_size(ncaId, NULL)) nca_cache_add_content_size(ncaId, content_size);
+            mutexUnlock(&ncaCacheMutex);
+        }
+    }
+    
+    // Big reads would just evict everything else
+    // Reads we can't bound (unknown content size or past the end of the NCA) are handed over as-is, so the usual error reporting is preserved
+    if (!enabled || !known_size || offset >= content_size || bufSize > (content_size - offset))
+    {
+        mutexLock(&ncaCacheMutex);
+        ncaCacheStats.bypasses++;
+        mutexUnlock(&ncaCacheMutex);
+        return readNcaDataByContentIdUncached(ncmStorage, ncaId, offset, outBuf, bufSize);
+    }
+    
+    while(bufSize > 0)
+    {
+        u64 block_offset = (offset - (offset % NCA_CACHE_BLOCK_SIZE));
+        u64 block_data_offset = (offset - block_offset);
+        
+        u64 block_size = (content_size - block_offset);
+        if (block_size > NCA_CACHE_BLOCK_SIZE) block_size = NCA_CACHE_BLOCK_SIZE;
+        
+        u64 chunk_size = (block_size - block_data_offset);
+        if (chunk_size > bufSize) chunk_size = bufSize;
+        
+        mutexLock(&ncaCacheMutex);
+        
+        nca_cache_block_t *block = (nca_cache_setup() ? nca_cache_find_block(ncaId, block_offset) : NULL);
+        if (block)
+        {
+            ncaCacheStats.hits++;
+            block->last_use = ++ncaCacheTick;
+            memcpy(out, block->data + block_data_offset, chunk_size);
+        } else {
+            ncaCacheStats.misses++;
+        }
+        
+        mutexUnlock(&ncaCacheMutex);
+        
+        if (!block)
+        {
+            if (!blockBuf) blockBuf = malloc(NCA_CACHE_BLOCK_SIZE);
+            
+            // The cache lock isn't held during the actual read, so the prefetch and pipeline threads can keep using the cache in the meantime
+            // Failed reads fall back to a direct read for the rest of the data (this also takes care of error reporting)
+            if (!blockBuf || !readNcaDataByContentIdUncached(ncmStorage, ncaId, block_offset, blockBuf, block_size))
+            {
+                success = readNcaDataByContentIdUncached(ncmStorage, ncaId, offset, out, bufSize);
+                break;
+            }
+            
+            memcpy(out, blockBuf + block_data_offset, chunk_size);
+            
+            mutexLock(&ncaCacheMutex);
+            
+            // Another thread may have loaded this block while we were reading it
+            if (ncaCacheBlocks && !nca_cache_find_block(ncaId, block_offset))
+            {
+                block = nca_cache_alloc_block();
+                if (block)
+                {
+                    memcpy(block->data, blockBuf, block_size);
+                    nca_cache_store_block(block, ncaId, block_offset, block_size);
+                }
+            }
+            
+            mutexUnlock(&ncaCacheMutex);
+        }
+        
+        out += chunk_size;
+        offset += chunk_size;
+        bufSize -= chunk_size;
+    }
+    
+    if (blockBuf) free(blockBuf);
+    
+    return success;
+}
+
+bool ncaCachePrefetch(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 contentSize, u64 offset, void *outBuf, size_t bufSize)
+{
+    if (!ncmStorage || !ncaId || !contentSize || !bufSize || offset >= contentSize || bufSize > (contentSize - offset)) return false;
+    
+    Result result;
+    bool success = true;
+    
+    u8 *blockBuf = NULL, *out = (u8*)outBuf;
+    u64 block_offset = (offset - (offset % NCA_CACHE_BLOCK_SIZE));
+    u64 end_offset = (offset + bufSize);
+    
+    blockBuf = malloc(NCA_CACHE_BLOCK_SIZE);
+    if (!blockBuf) return false;
+    
+    mutexLock(&ncaCacheMutex);
+    
+    if (!ncaCacheMaxBlockCnt || !nca_cache_setup())
+    {
+        mutexUnlock(&ncaCacheMutex);
+        free(blockBuf);
+        return false;
+    }
+    
+    // Spare the main thread the content size lookup as well
+    if (!nca_cache_find_content_size(ncaId, NULL)) nca_cache_add_content_size(ncaId, contentSize);
+    
+    mutexUnlock(&ncaCacheMutex);
+    
+    for(; block_offset < end_offset; block_offset += NCA_CACHE_BLOCK_SIZE)
+    {
+        u64 block_size = (contentSize - block_offset);
+        if (block_size > NCA_CACHE_BLOCK_SIZE) block_size = NCA_CACHE_BLOCK_SIZE;
+        
+        mutexLock(&ncaCacheMutex);
+        
+        nca_cache_block_t *block = nca_cache_find_block(ncaId, block_offset);
+        if (block && out) memcpy(blockBuf, block->data, block_size);
+        
+        mutexUnlock(&ncaCacheMutex);
+        
+        if (!block)
+        {
+            // The cache lock isn't held during the actual read, so other threads can keep using the cache in the meantime
+            u64 startTick = perfTick();
+            result = ncmContentStorageReadContentIdFile(ncmStorage, blockBuf, block_size, ncaId, block_offset);
+            perfAdd(PERF_STAGE_READ, startTick, block_size);
+            
+            if (R_FAILED(result))
+            {
+                success = false;
+                break;
+            }
+            
+            mutexLock(&ncaCacheMutex);
+            
+            // Another thread may have loaded this block while we were reading it
+            if (ncaCacheBlocks && !nca_cache_find_block(ncaId, block_offset))
+            {
+                block = nca_cache_alloc_block();
+                if (block)
+                {
+                    memcpy(block->data, blockBuf, block_size);
+                    nca_cache_store_block(block, ncaId, block_offset, block_size);
+                    ncaCacheStats.prefetches++;
+                }
+            }
+            
+            mutexUnlock(&ncaCacheMutex);
+        }
+        
+        if (out)
+        {
+            u64 data_start = (offset > block_offset ? offset : block_offset);
+            u64 data_end = ((block_offset + block_size) < end_offset ? (block_offset + block_size) : end_offset);
+            
+            memcpy(out, blockBuf + (data_start - block_offset), data_end - data_start);
+            out += (data_end - data_start);
+        }
+    }
+    
+    free(blockBuf);
+    
+    return success;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#ifndef __NCA_CACHE_H__
+#define __NCA_CACHE_H__
+
+#include <switch.h>
+
+#define NCA_CACHE_BLOCK_SIZE            (u64)0x8000                             // 32 KiB (32768 bytes)
+#define NCA_CACHE_DEFAULT_BUDGET        (u64)0x400000                           // 4 MiB (4194304 bytes)
+#define NCA_CACHE_MAX_BUDGET            (u64)0x2000000                          // 32 MiB (33554432 bytes) - selectable budgets are powers of two up to this value
+#define NCA_CACHE_MAX_CACHED_READ       (NCA_CACHE_BLOCK_SIZE * 4)              // Bigger reads bypass the cache (e.g. dump chunks)
+#define NCA_CACHE_SIZE_ENTRY_CNT        8                                       // Content size lookups kept around
+
+typedef struct {
+    NcmContentId ncaId;
+    u64 offset;                                                                 // Aligned to NCA_CACHE_BLOCK_SIZE
+    u64 size;                                                                   // Valid data size (only smaller than NCA_CACHE_BLOCK_SIZE for the last NCA block)
+    u64 last_use;                                                               // LRU stamp - 0 means unused
+    u8 *data;
+} nca_cache_block_t;
+
+typedef struct {
+    NcmContentId ncaId;
+    u64 size;
+    bool valid;
+} nca_cache_size_entry_t;
+
+typedef struct {
+    u64 hits;
+    u64 misses;
+    u64 bypasses;
+    u64 evictions;
+    u64 prefetches;                                                             // Blocks loaded by ncaCachePrefetch()
+    u32 block_cnt;                                                              // Currently allocated blocks
+    u32 max_block_cnt;                                                          // Blocks allowed by the memory budget
+} nca_cache_stats_t;
+
+/* Sets the cache memory budget (in bytes). A zero budget disables the cache. Cached blocks are released whenever the budget changes. */
+void ncaCacheSetBudget(u64 budget);
+
+/* Drops all cached blocks and content sizes (e.g. after a gamecard change) and resets the counters. */
+void ncaCacheInvalidate();
+
+/* Releases all memory used by the cache. */
+void ncaCacheFree();
+
+void ncaCacheGetStats(nca_cache_stats_t *out);
+
+/* Read-through entry point used by readNcaDataByContentId(). Small reads are served from (and fill) the block cache, big reads go straight to storage. */
+bool ncaCacheRead(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 offset, void *outBuf, size_t bufSize);
+
+/* Loads the blocks covering the provided NCA area ahead of time. The requested data is also copied to outBuf, unless it's NULL. */
+/* Nothing is drawn on screen, so this is safe to call from a worker thread. Gamecard NCAs aren't supported (their data is read through the global IStorage handle). */
+bool ncaCachePrefetch(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 contentSize, u64 offset, void *outBuf, size_t bufSize);
+
+#endif
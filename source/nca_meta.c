@@ -0,0 +1,421 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nca_meta.h"
+
+/* Decrypting a NCA header means an AES-XTS pass (plus a SPL IPC round trip for the key area, or an ES savedata scan for the titlekey) */
+/* The same NCAs get parsed over and over again (title info, NSP dumps, ExeFS/RomFS browsing, batch dumps, etc.), so we keep the results around */
+
+static Mutex ncaMetaCacheMutex = 0;
+
+static nca_meta_cache_entry_t *ncaMetaCacheEntries = NULL;
+static u64 ncaMetaCacheTick = 0;
+static bool ncaMetaCacheDirty = false;
+
+static nca_meta_cache_tik_entry_t ncaMetaCacheTiks[NCA_META_CACHE_TIK_ENTRY_CNT];
+static u32 ncaMetaCacheTikIndex = 0;
+
+static bool nca_meta_cache_setup()
+{
+    if (ncaMetaCacheEntries) return true;
+    
+    ncaMetaCacheEntries = calloc(NCA_META_CACHE_ENTRY_CNT, sizeof(nca_meta_cache_entry_t));
+    
+    return (ncaMetaCacheEntries != NULL);
+}
+
+static void nca_meta_cache_clear_entry(nca_meta_cache_entry_t *entry)
+{
+    u32 i;
+    
+    for(i = 0; i < NCA_META_CACHE_XML_CNT; i++)
+    {
+        if (entry->xml[i]) free(entry->xml[i]);
+    }
+    
+    memset(entry, 0, sizeof(nca_meta_cache_entry_t));
+}
+
+static nca_meta_cache_entry_t *nca_meta_cache_find_entry(const NcmContentId *ncaId)
+{
+    u32 i;
+    
+    if (!ncaMetaCacheEntries) return NULL;
+    
+    for(i = 0; i < NCA_META_CACHE_ENTRY_CNT; i++)
+    {
+        nca_meta_cache_entry_t *cur = &(ncaMetaCacheEntries[i]);
+        if (cur->last_use && !memcmp(cur->ncaId.c, ncaId->c, sizeof(ncaId->c))) return cur;
+    }
+    
+    return NULL;
+}
+
+// Returns an unused entry or recycles the least recently used one
+static nca_meta_cache_entry_t *nca_meta_cache_alloc_entry(const NcmContentId *ncaId)
+{
+    u32 i;
+    nca_meta_cache_entry_t *lru = NULL;
+    
+    if (!nca_meta_cache_setup()) return NULL;
+    
+    for(i = 0; i < NCA_META_CACHE_ENTRY_CNT; i++)
+    {
+        nca_meta_cache_entry_t *cur = &(ncaMetaCacheEntries[i]);
+        
+        if (!cur->last_use)
+        {
+            lru = cur;
+            break;
+        }
+        
+        if (!lru || cur->last_use < lru->last_use) lru = cur;
+    }
+    
+    nca_meta_cache_clear_entry(lru);
+    
+    memcpy(&(lru->ncaId), ncaId, sizeof(NcmContentId));
+    lru->last_use = ++ncaMetaCacheTick;
+    
+    return lru;
+}
+
+void ncaMetaCacheLoad()
+{
+    FILE *cacheFile = fopen(NCA_META_CACHE_PATH, "rb");
+    if (!cacheFile) return;
+    
+    nca_meta_cache_file_header header;
+    nca_meta_cache_file_entry fileEntry;
+    size_t read_res;
+    u32 i, j;
+    bool success = true;
+    
+    read_res = fread(&header, 1, sizeof(nca_meta_cache_file_header), cacheFile);
+    if (read_res != sizeof(nca_meta_cache_file_header) || header.magic != NCA_META_CACHE_MAGIC || header.version != NCA_META_CACHE_VERSION || header.entry_cnt > NCA_META_CACHE_ENTRY_CNT)
+    {
+        fclose(cacheFile);
+        remove(NCA_META_CACHE_PATH);
+        return;
+    }
+    
+    mutexLock(&ncaMetaCacheMutex);
+    
+    if (!nca_meta_cache_setup())
+    {
+        mutexUnlock(&ncaMetaCacheMutex);
+        fclose(cacheFile);
+        return;
+    }
+    
+    for(i = 0; i < header.entry_cnt && success; i++)
+    {
+        read_res = fread(&fileEntry, 1, sizeof(nca_meta_cache_file_entry), cacheFile);
+        if (read_res != sizeof(nca_meta_cache_file_entry))
+        {
+            success = false;
+            break;
+        }
+        
+        nca_meta_cache_entry_t *entry = &(ncaMetaCacheEntries[i]);
+        nca_meta_cache_clear_entry(entry);
+        
+        memcpy(&(entry->ncaId), &(fileEntry.ncaId), sizeof(NcmContentId));
+        entry->flags = (fileEntry.flags & ~NCA_META_FLAG_KEY_AREA);
+        
+        if (fread(entry->header, 1, NCA_FULL_HEADER_LENGTH, cacheFile) != NCA_FULL_HEADER_LENGTH)
+        {
+            success = false;
+            break;
+        }
+        
+        for(j = 0; j < NCA_META_CACHE_XML_CNT; j++)
+        {
+            if (!fileEntry.xml_size[j]) continue;
+            
+            // Make sure the XML can be used as a NULL terminated string
+            entry->xml[j] = calloc(fileEntry.xml_size[j] + 1, sizeof(char));
+            if (!entry->xml[j] || fread(entry->xml[j], 1, fileEntry.xml_size[j], cacheFile) != fileEntry.xml_size[j])
+            {
+                success = false;
+                break;
+            }
+            
+            entry->xml_size[j] = fileEntry.xml_size[j];
+        }
+        
+        // Entries from the file are older than anything cached during this session
+        if (success) entry->last_use = ++ncaMetaCacheTick;
+    }
+    
+    if (!success)
+    {
+        for(i = 0; i < NCA_META_CACHE_ENTRY_CNT; i++) nca_meta_cache_clear_entry(&(ncaMetaCacheEntries[i]));
+        ncaMetaCacheTick = 0;
+    }
+    
+    ncaMetaCacheDirty = false;
+    
+    mutexUnlock(&ncaMetaCacheMutex);
+    
+    fclose(cacheFile);
+    
+    if (!success) remove(NCA_META_CACHE_PATH);
+}
+
+void ncaMetaCacheSave()
+{
+    mutexLock(&ncaMetaCacheMutex);
+    
+    if (!ncaMetaCacheEntries || !ncaMetaCacheDirty)
+    {
+        mutexUnlock(&ncaMetaCacheMutex);
+        return;
+    }
+    
+    nca_meta_cache_file_header header;
+    nca_meta_cache_file_entry fileEntry;
+    u32 i, j;
+    bool success = true;
+    
+    FILE *cacheFile = fopen(NCA_META_CACHE_PATH, "wb");
+    if (!cacheFile)
+    {
+        mutexUnlock(&ncaMetaCacheMutex);
+        return;
+    }
+    
+    memset(&header, 0, sizeof(nca_meta_cache_file_header));
+    header.magic = NCA_META_CACHE_MAGIC;
+    header.version = NCA_META_CACHE_VERSION;
+    
+    for(i = 0; i < NCA_META_CACHE_ENTRY_CNT; i++)
+    {
+        if (ncaMetaCacheEntries[i].last_use) header.entry_cnt++;
+    }
+    
+    if (fwrite(&header, 1, sizeof(nca_meta_cache_file_header), cacheFile) != sizeof(nca_meta_cache_file_header)) success = false;
+    
+    for(i = 0; i < NCA_META_CACHE_ENTRY_CNT && success; i++)
+    {
+        nca_meta_cache_entry_t *entry = &(ncaMetaCacheEntries[i]);
+        if (!entry->last_use) continue;
+        
+        memset(&fileEntry, 0, sizeof(nca_meta_cache_file_entry));
+        memcpy(&(fileEntry.ncaId), &(entry->ncaId), sizeof(NcmContentId));
+        fileEntry.flags = (entry->flags & ~NCA_META_FLAG_KEY_AREA);
+        
+        for(j = 0; j < NCA_META_CACHE_XML_CNT; j++) fileEntry.xml_size[j] = (entry->xml[j] ? entry->xml_size[j] : 0);
+        
+        if (fwrite(&fileEntry, 1, sizeof(nca_meta_cache_file_entry), cacheFile) != sizeof(nca_meta_cache_file_entry) || fwrite(entry->header, 1, NCA_FULL_HEADER_LENGTH, cacheFile) != NCA_FULL_HEADER_LENGTH)
+        {
+            success = false;
+            break;
+        }
+        
+        for(j = 0; j < NCA_META_CACHE_XML_CNT; j++)
+        {
+            if (fileEntry.xml_size[j] && fwrite(entry->xml[j], 1, fileEntry.xml_size[j], cacheFile) != fileEntry.xml_size[j])
+            {
+                success = false;
+                break;
+            }
+        }
+    }
+    
+    if (fclose(cacheFile) != 0) success = false;
+    
+    if (success)
+    {
+        ncaMetaCacheDirty = false;
+    } else {
+        remove(NCA_META_CACHE_PATH);
+    }
+    
+    mutexUnlock(&ncaMetaCacheMutex);
+}
+
+void ncaMetaCacheFree()
+{
+    u32 i;
+    
+    mutexLock(&ncaMetaCacheMutex);
+    
+    if (ncaMetaCacheEntries)
+    {
+        for(i = 0; i < NCA_META_CACHE_ENTRY_CNT; i++) nca_meta_cache_clear_entry(&(ncaMetaCacheEntries[i]));
+        
+        free(ncaMetaCacheEntries);
+        ncaMetaCacheEntries = NULL;
+    }
+    
+    ncaMetaCacheTick = 0;
+    ncaMetaCacheDirty = false;
+    
+    memset(ncaMetaCacheTiks, 0, sizeof(ncaMetaCacheTiks));
+    ncaMetaCacheTikIndex = 0;
+    
+    mutexUnlock(&ncaMetaCacheMutex);
+}
+
+bool ncaMetaCacheGetHeader(const NcmContentId *ncaId, nca_header_t *out, u8 *key_area, bool *outHasKeyArea)
+{
+    if (!ncaId || !out) return false;
+    
+    mutexLock(&ncaMetaCacheMutex);
+    
+    nca_meta_cache_entry_t *entry = nca_meta_cache_find_entry(ncaId);
+    if (entry)
+    {
+        entry->last_use = ++ncaMetaCacheTick;
+        
+        memcpy(out, entry->header, NCA_FULL_HEADER_LENGTH);
+        
+        bool hasKeyArea = ((entry->flags & NCA_META_FLAG_KEY_AREA) != 0);
+        if (hasKeyArea && key_area) memcpy(key_area, entry->key_area, NCA_KEY_AREA_SIZE);
+        if (outHasKeyArea) *outHasKeyArea = hasKeyArea;
+    }
+    
+    mutexUnlock(&ncaMetaCacheMutex);
+    
+    return (entry != NULL);
+}
+
+void ncaMetaCacheStoreHeader(const NcmContentId *ncaId, const nca_header_t *header, const u8 *key_area)
+{
+    if (!ncaId || !header) return;
+    
+    mutexLock(&ncaMetaCacheMutex);
+    
+    nca_meta_cache_entry_t *entry = nca_meta_cache_find_entry(ncaId);
+    
+    // Nothing to do if we already have everything
+    if (!entry || (key_area && !(entry->flags & NCA_META_FLAG_KEY_AREA)))
+    {
+        // Key areas aren't saved to the SD card, so adding one to an existing entry doesn't make the cache dirty
+        if (!entry)
+        {
+            entry = nca_meta_cache_alloc_entry(ncaId);
+            if (entry) ncaMetaCacheDirty = true;
+        }
+        
+        if (entry)
+        {
+            memcpy(entry->header, header, NCA_FULL_HEADER_LENGTH);
+            
+            if (key_area)
+            {
+                memcpy(entry->key_area, key_area, NCA_KEY_AREA_SIZE);
+                entry->flags |= NCA_META_FLAG_KEY_AREA;
+            }
+        }
+    }
+    
+    mutexUnlock(&ncaMetaCacheMutex);
+}
+
+bool ncaMetaCacheGetProgramInfoXml(const NcmContentId *ncaId, bool useCustomAcidRsaPubKey, mem_arena_t *arena, char **outBuf, u64 *outBufSize)
+{
+    if (!ncaId || !arena || !outBuf || !outBufSize) return false;
+    
+    u32 idx = (useCustomAcidRsaPubKey ? 1 : 0);
+    char *xml = NULL;
+    
+    mutexLock(&ncaMetaCacheMutex);
+    
+    nca_meta_cache_entry_t *entry = nca_meta_cache_find_entry(ncaId);
+    if (entry && entry->xml[idx])
+    {
+        // Cache entries may be evicted at any time, so the caller gets its own copy
+        xml = arenaMemdup(arena, entry->xml[idx], entry->xml_size[idx] + 1);
+        if (xml)
+        {
+            *outBuf = xml;
+            *outBufSize = entry->xml_size[idx];
+            
+            entry->last_use = ++ncaMetaCacheTick;
+        }
+    }
+    
+    mutexUnlock(&ncaMetaCacheMutex);
+    
+    return (xml != NULL);
+}
+
+void ncaMetaCacheStoreProgramInfoXml(const NcmContentId *ncaId, bool useCustomAcidRsaPubKey, const char *xml, u64 xmlSize)
+{
+    if (!ncaId || !xml || !xmlSize) return;
+    
+    u32 idx = (useCustomAcidRsaPubKey ? 1 : 0);
+    
+    mutexLock(&ncaMetaCacheMutex);
+    
+    nca_meta_cache_entry_t *entry = nca_meta_cache_find_entry(ncaId);
+    if (entry && !entry->xml[idx])
+    {
+        entry->xml[idx] = calloc(xmlSize + 1, sizeof(char));
+        if (entry->xml[idx])
+        {
+            memcpy(entry->xml[idx], xml, xmlSize);
+            entry->xml_size[idx] = xmlSize;
+            ncaMetaCacheDirty = true;
+        }
+    }
+    
+    mutexUnlock(&ncaMetaCacheMutex);
+}
+
+bool ncaMetaCacheGetTitleKey(const u8 *rights_id, u8 *out_tik, u8 *out_enc_key)
+{
+    if (!rights_id) return false;
+    
+    u32 i;
+    bool found = false;
+    
+    mutexLock(&ncaMetaCacheMutex);
+    
+    for(i = 0; i < NCA_META_CACHE_TIK_ENTRY_CNT; i++)
+    {
+        nca_meta_cache_tik_entry_t *cur = &(ncaMetaCacheTiks[i]);
+        if (!cur->valid || memcmp(cur->rights_id, rights_id, 0x10) != 0) continue;
+        
+        if (out_tik) memcpy(out_tik, cur->tik_data, ETICKET_TIK_FILE_SIZE);
+        if (out_enc_key) memcpy(out_enc_key, cur->enc_titlekey, 0x10);
+        
+        found = true;
+        break;
+    }
+    
+    mutexUnlock(&ncaMetaCacheMutex);
+    
+    return found;
+}
+
+void ncaMetaCacheStoreTitleKey(const u8 *rights_id, const u8 *tik_data, const u8 *enc_titlekey)
+{
+    if (!rights_id || !tik_data || !enc_titlekey) return;
+    
+    mutexLock(&ncaMetaCacheMutex);
+    
+    nca_meta_cache_tik_entry_t *entry = &(ncaMetaCacheTiks[ncaMetaCacheTikIndex]);
+    
+    memcpy(entry->rights_id, rights_id, 0x10);
+    memcpy(entry->tik_data, tik_data, ETICKET_TIK_FILE_SIZE);
+    memcpy(entry->enc_titlekey, enc_titlekey, 0x10);
+    entry->valid = true;
+    
+    ncaMetaCacheTikIndex = ((ncaMetaCacheTikIndex + 1) % NCA_META_CACHE_TIK_ENTRY_CNT);
+    
+    mutexUnlock(&ncaMetaCacheMutex);
+}
+
+void ncaMetaCacheFlushTitleKeys()
+{
+    mutexLock(&ncaMetaCacheMutex);
+    
+    memset(ncaMetaCacheTiks, 0, sizeof(ncaMetaCacheTiks));
+    ncaMetaCacheTikIndex = 0;
+    
+    mutexUnlock(&ncaMetaCacheMutex);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#ifndef __NCA_META_H__
+#define __NCA_META_H__
+
+#include <switch.h>
+
+#include "arena.h"
+#include "nca.h"
+#include "util.h"
+
+#define NCA_META_CACHE_MAGIC            (u32)0x4D434E58                         // "XNCM"
+#define NCA_META_CACHE_VERSION          2
+#define NCA_META_CACHE_ENTRY_CNT        64                                      // Decrypted NCA headers kept around (~200 KiB, plus XML data)
+#define NCA_META_CACHE_TIK_ENTRY_CNT    16                                      // Titlekeys kept around
+#define NCA_META_CACHE_XML_CNT          2                                       // One "programinfo.xml" per useCustomAcidRsaPubKey value
+
+#define NCA_META_FLAG_KEY_AREA          BIT(0)                                  // Decrypted key area is available (NCAs without a rights ID). Never set in the cache file
+
+/*
+ * Persistent cache layout (NCA_META_CACHE_PATH):
+ *
+ * 0x00: nca_meta_cache_file_header
+ * 0x10: entry_cnt times:
+ *     - nca_meta_cache_file_entry
+ *     - decrypted NCA header (NCA_FULL_HEADER_LENGTH bytes)
+ *     - "programinfo.xml" data (xml_size[0] + xml_size[1] bytes)
+ *
+ * Decrypted key areas, titlekeys and ticket data are content keys / console specific data, so they're only cached for the current session and never written to the SD card.
+ * The key area of an NCA loaded from the cache file is decrypted again the first time it's needed.
+ */
+
+typedef struct {
+    u32 magic;                                                                  // NCA_META_CACHE_MAGIC
+    u32 version;                                                                // NCA_META_CACHE_VERSION
+    u32 entry_cnt;
+    u32 reserved;
+} PACKED nca_meta_cache_file_header;
+
+typedef struct {
+    NcmContentId ncaId;
+    u8 flags;                                                                   // NCA_META_FLAG_*
+    u8 reserved[7];
+    u64 xml_size[NCA_META_CACHE_XML_CNT];                                       // Zero if the XML hasn't been generated
+} PACKED nca_meta_cache_file_entry;
+
+typedef struct {
+    NcmContentId ncaId;
+    u8 flags;
+    u8 header[NCA_FULL_HEADER_LENGTH];
+    u8 key_area[NCA_KEY_AREA_SIZE];
+    char *xml[NCA_META_CACHE_XML_CNT];
+    u64 xml_size[NCA_META_CACHE_XML_CNT];
+    u64 last_use;                                                               // LRU stamp - 0 means unused
+} nca_meta_cache_entry_t;
+
+typedef struct {
+    u8 rights_id[0x10];
+    u8 tik_data[ETICKET_TIK_FILE_SIZE];
+    u8 enc_titlekey[0x10];                                                      // Titlekey as stored in the eTicket (already decrypted with the eTicket RSA key if the ticket is personalized)
+    bool valid;
+} nca_meta_cache_tik_entry_t;
+
+/* Loads the cache file from the SD card. Entries from a missing or corrupted file are just ignored. */
+void ncaMetaCacheLoad();
+
+/* Writes the cache to the SD card, only if it was modified since it was loaded. */
+void ncaMetaCacheSave();
+
+/* Releases all memory used by the cache. */
+void ncaMetaCacheFree();
+
+/* Copies a cached decrypted NCA header. The decrypted key area is also copied if it's available and key_area isn't NULL. */
+bool ncaMetaCacheGetHeader(const NcmContentId *ncaId, nca_header_t *out, u8 *key_area, bool *outHasKeyArea);
+
+/* Stores a decrypted NCA header. key_area may be NULL (e.g. NCAs with a rights ID). */
+void ncaMetaCacheStoreHeader(const NcmContentId *ncaId, const nca_header_t *header, const u8 *key_area);
+
+/* Returns a copy of a cached "programinfo.xml", allocated from the provided arena. */
+bool ncaMetaCacheGetProgramInfoXml(const NcmContentId *ncaId, bool useCustomAcidRsaPubKey, mem_arena_t *arena, char **outBuf, u64 *outBufSize);
+
+/* Stores a copy of a generated "programinfo.xml". Nothing is stored if the NCA header isn't cached. */
+void ncaMetaCacheStoreProgramInfoXml(const NcmContentId *ncaId, bool useCustomAcidRsaPubKey, const char *xml, u64 xmlSize);
+
+/* Session only titlekey cache used by retrieveNcaTikTitleKey(). out_tik and out_enc_key may be NULL. */
+bool ncaMetaCacheGetTitleKey(const u8 *rights_id, u8 *out_tik, u8 *out_enc_key);
+
+void ncaMetaCacheStoreTitleKey(const u8 *rights_id, const u8 *tik_data, const u8 *enc_titlekey);
+
+/* Drops all cached titlekeys. Called whenever an ES eTicket savefile index gets rebuilt. */
+void ncaMetaCacheFlushTitleKeys();
+
+#endif
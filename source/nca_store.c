@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "nca_store.h"
+
+static int ncaStoreRecordCmp(const void *a, const void *b)
+{
+    const nca_store_record *record1 = (const nca_store_record*)a;
+    const nca_store_record *record2 = (const nca_store_record*)b;
+    
+    int ret = memcmp(record1->contentId, record2->contentId, sizeof(record1->contentId));
+    if (ret != 0) return ret;
+    
+    if (record1->options != record2->options) return (record1->options < record2->options ? -1 : 1);
+    
+    return 0;
+}
+
+void ncaStoreLoad(nca_store_t *store)
+{
+    if (!store) return;
+    
+    memset(store, 0, sizeof(nca_store_t));
+    
+    mkdir(NSP_DUMP_PATH, 0744);
+    mkdir(NCA_STORE_PATH, 0744);
+    
+    FILE *indexFile = fopen(NCA_STORE_INDEX_PATH, "rb");
+    if (!indexFile) return;
+    
+    nca_store_index_header header;
+    size_t read_res;
+    u64 indexFileSize;
+    u32 recordCnt;
+    
+    fseek(indexFile, 0, SEEK_END);
+    indexFileSize = (u64)ftell(indexFile);
+    rewind(indexFile);
+    
+    read_res = fread(&header, 1, sizeof(nca_store_index_header), indexFile);
+    if (read_res != sizeof(nca_store_index_header) || header.magic != NCA_STORE_INDEX_MAGIC || header.recordSize != sizeof(nca_store_record))
+    {
+        // The store objects are still referenced by their checksums, so they can be kept
+        fclose(indexFile);
+        remove(NCA_STORE_INDEX_PATH);
+        return;
+    }
+    
+    // A partially written record at the end of the file is just ignored
+    recordCnt = (u32)((indexFileSize - sizeof(nca_store_index_header)) / sizeof(nca_store_record));
+    if (!recordCnt)
+    {
+        fclose(indexFile);
+        return;
+    }
+    
+    store->records = calloc(recordCnt, sizeof(nca_store_record));
+    if (!store->records)
+    {
+        fclose(indexFile);
+        return;
+    }
+    
+    read_res = fread(store->records, 1, recordCnt * sizeof(nca_store_record), indexFile);
+    
+    fclose(indexFile);
+    
+    if (read_res != (recordCnt * sizeof(nca_store_record)))
+    {
+        ncaStoreFree(store);
+        return;
+    }
+    
+    store->recordCnt = recordCnt;
+    
+    qsort(store->records, store->recordCnt, sizeof(nca_store_record), ncaStoreRecordCmp);
+}
+
+const nca_store_record *ncaStoreFind(nca_store_t *store, const u8 *contentId, u8 options)
+{
+    if (!store || !store->records || !store->recordCnt || !contentId) return NULL;
+    
+    nca_store_record key;
+    memset(&key, 0, sizeof(nca_store_record));
+    
+    memcpy(key.contentId, contentId, sizeof(key.contentId));
+    key.options = options;
+    
+    const nca_store_record *record = (const nca_store_record*)bsearch(&key, store->records, store->recordCnt, sizeof(nca_store_record), ncaStoreRecordCmp);
+    if (!record) return NULL;
+    
+    // Store objects may have been removed by hand
+    char objectPath[NAME_BUF_LEN] = {'\0'};
+    struct stat st;
+    
+    ncaStoreGetObjectPath(record->hash, objectPath, MAX_CHARACTERS(objectPath));
+    
+    if (stat(objectPath, &st) != 0 || (u64)st.st_size != record->size) return NULL;
+    
+    return record;
+}
+
+bool ncaStoreAddRecord(nca_store_t *store, const nca_store_record *record)
+{
+    if (!store || !record) return false;
+    
+    nca_store_index_header header;
+    nca_store_record *tmpRecords = NULL;
+    size_t read_res, write_res;
+    u64 indexFileSize, validSize;
+    
+    FILE *indexFile = fopen(NCA_STORE_INDEX_PATH, "ab+");
+    if (!indexFile) return false;
+    
+    fseek(indexFile, 0, SEEK_END);
+    indexFileSize = (u64)ftell(indexFile);
+    
+    if (indexFileSize)
+    {
+        rewind(indexFile);
+        read_res = fread(&header, 1, sizeof(nca_store_index_header), indexFile);
+        
+        if (read_res != sizeof(nca_store_index_header) || header.magic != NCA_STORE_INDEX_MAGIC || header.recordSize != sizeof(nca_store_record))
+        {
+            // Start over if the index is corrupted
+            fclose(indexFile);
+            
+            indexFile = fopen(NCA_STORE_INDEX_PATH, "wb");
+            if (!indexFile) return false;
+            
+            indexFileSize = 0;
+        } else {
+            // Get rid of a partially written record, so the new one stays aligned with the rest
+            validSize = (sizeof(nca_store_index_header) + (((indexFileSize - sizeof(nca_store_index_header)) / sizeof(nca_store_record)) * sizeof(nca_store_record)));
+            if (validSize != indexFileSize)
+            {
+                fflush(indexFile);
+                if (ftruncate(fileno(indexFile), (off_t)validSize) != 0)
+                {
+                    fclose(indexFile);
+                    remove(NCA_STORE_INDEX_PATH);
+                    return false;
+                }
+            }
+        }
+    }
+    
+    if (!indexFileSize)
+    {
+        header.magic = NCA_STORE_INDEX_MAGIC;
+        header.recordSize = sizeof(nca_store_record);
+        
+        write_res = fwrite(&header, 1, sizeof(nca_store_index_header), indexFile);
+        if (write_res != sizeof(nca_store_index_header))
+        {
+            fclose(indexFile);
+            remove(NCA_STORE_INDEX_PATH);
+            return false;
+        }
+    }
+    
+    write_res = fwrite(record, 1, sizeof(nca_store_record), indexFile);
+    
+    fclose(indexFile);
+    
+    if (write_res != sizeof(nca_store_record)) return false;
+    
+    // Keep the loaded records sorted, so the next titles from a batch dump can use this one right away
+    tmpRecords = realloc(store->records, (store->recordCnt + 1) * sizeof(nca_store_record));
+    if (!tmpRecords) return true;
+    
+    store->records = tmpRecords;
+    tmpRecords = NULL;
+    
+    memcpy(&(store->records[store->recordCnt]), record, sizeof(nca_store_record));
+    store->recordCnt++;
+    
+    qsort(store->records, store->recordCnt, sizeof(nca_store_record), ncaStoreRecordCmp);
+    
+    return true;
+}
+
+void ncaStoreGetObjectPath(const u8 *hash, char *outPath, size_t outPathSize)
+{
+    if (!hash || !outPath || !outPathSize) return;
+    
+    char hashStr[(SHA256_HASH_SIZE * 2) + 1] = {'\0'};
+    convertDataToHexString(hash, SHA256_HASH_SIZE, hashStr, sizeof(hashStr));
+    
+    snprintf(outPath, outPathSize, "%s%s%s", NCA_STORE_PATH, hashStr, NCA_STORE_OBJECT_EXTENSION);
+}
+
+void ncaStoreGetTmpPath(const u8 *contentId, char *outPath, size_t outPathSize)
+{
+    if (!contentId || !outPath || !outPathSize) return;
+    
+    char contentIdStr[SHA256_HASH_SIZE + 1] = {'\0'};
+    convertDataToHexString(contentId, SHA256_HASH_SIZE / 2, contentIdStr, sizeof(contentIdStr));
+    
+    snprintf(outPath, outPathSize, "%s%s%s", NCA_STORE_PATH, contentIdStr, NCA_STORE_TMP_EXTENSION);
+}
+
+bool ncaStoreCommitObject(const char *tmpPath, const u8 *hash)
+{
+    if (!tmpPath || !hash) return false;
+    
+    char objectPath[NAME_BUF_LEN] = {'\0'};
+    ncaStoreGetObjectPath(hash, objectPath, MAX_CHARACTERS(objectPath));
+    
+    if (checkIfFileExists(objectPath))
+    {
+        remove(tmpPath);
+        return true;
+    }
+    
+    return (rename(tmpPath, objectPath) == 0);
+}
+
+void ncaStoreFree(nca_store_t *store)
+{
+    if (!store) return;
+    
+    if (store->records) free(store->records);
+    
+    memset(store, 0, sizeof(nca_store_t));
+}
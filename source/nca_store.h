@@ -0,0 +1,93 @@
+#pragma once
+
+#ifndef __NCA_STORE_H__
+#define __NCA_STORE_H__
+
+#include <switch.h>
+
+#include "util.h"
+
+#define NCA_STORE_INDEX_MAGIC       (u32)0x53434E58     // "XNCS"
+#define NCA_STORE_INDEX_PATH        NCA_STORE_PATH "index.bin"
+#define NCA_STORE_OBJECT_EXTENSION  ".nca"
+#define NCA_STORE_TMP_EXTENSION     ".tmp"
+
+#define NSP_MANIFEST_MAGIC          (u32)0x4D534E58     // "XNSM"
+#define NSP_MANIFEST_VERSION        1
+#define NSP_MANIFEST_EXTENSION      ".nspm"
+
+/*
+ * NCA store layout (NCA_STORE_PATH):
+ *
+ * "<SHA-256 checksum>.nca": dumped NCA, named after the checksum of its data (e.g. "0123...cdef.nca"). Each NCA is only written once, no matter how many NSP dumps use it.
+ * "index.bin": nca_store_index_header followed by nca_store_record elements. Maps source content IDs to store objects, so NCAs that are already in the store don't even have to be read again.
+ *
+ * NSP manifest layout ("<dump>.nspm", written to NSP_DUMP_PATH instead of the NSP):
+ *
+ * 0x00: nsp_manifest_header
+ * 0x40: full PFS0 header (pfs0_header_size bytes)
+ * ....: entry table (entry_cnt nsp_manifest_entry elements, in PFS0 entry order)
+ * ....: inline data (every PFS0 entry whose data isn't in the store: the CNMT NCA, XML files, icons, ticket and certificate)
+ *
+ * The NSP is rebuilt by writing the PFS0 header, followed by the data from each entry (store object or inline data), in order.
+ * rebuildNspFromManifests() does just that for every manifest in NSP_DUMP_PATH.
+ */
+
+typedef struct {
+    u32 magic;                                                                  // NCA_STORE_INDEX_MAGIC
+    u32 recordSize;                                                             // sizeof(nca_store_record)
+} PACKED nca_store_index_header;
+
+typedef struct {
+    u8 contentId[SHA256_HASH_SIZE / 2];                                         // NCA content ID from the source storage
+    u8 options;                                                                 // Dump options that change the NCA data (set by the caller)
+    u8 reserved[7];
+    u64 size;
+    u8 hash[SHA256_HASH_SIZE];                                                  // SHA-256 checksum of the stored NCA, used as the object name
+} PACKED nca_store_record;
+
+typedef struct {
+    nca_store_record *records;                                                  // Sorted by content ID and options
+    u32 recordCnt;
+    u64 reusedSize;                                                             // NCA data that didn't have to be dumped again since the store was loaded
+} nca_store_t;
+
+typedef struct {
+    u32 magic;                                                                  // NSP_MANIFEST_MAGIC
+    u32 version;                                                                // NSP_MANIFEST_VERSION
+    u32 entry_cnt;                                                              // PFS0 entry count
+    u32 reserved1;
+    u64 nsp_size;                                                               // Rebuilt NSP size
+    u64 pfs0_header_size;
+    u64 table_offset;
+    u64 data_offset;                                                            // Inline data offset
+    u8 reserved2[0x10];
+} PACKED nsp_manifest_header;
+
+typedef struct {
+    u8 hash[SHA256_HASH_SIZE];                                                  // Store object SHA-256 checksum. All zeroes if the entry data is stored inline
+    u64 size;
+    u64 offset;                                                                 // Inline data offset, relative to the start of the manifest. Zero if the data is in the store
+} PACKED nsp_manifest_entry;
+
+/* Creates the store directory if needed and loads the store index. A missing or corrupted index just results in an empty store. */
+void ncaStoreLoad(nca_store_t *store);
+
+/* Looks up a NCA by its source content ID and dump options. NULL is returned if there's no record, or if the store object is missing or truncated. */
+const nca_store_record *ncaStoreFind(nca_store_t *store, const u8 *contentId, u8 options);
+
+/* Appends a record to the store index and to the loaded records. */
+bool ncaStoreAddRecord(nca_store_t *store, const nca_store_record *record);
+
+/* Generates the path to the store object with the provided SHA-256 checksum. */
+void ncaStoreGetObjectPath(const u8 *hash, char *outPath, size_t outPathSize);
+
+/* Generates the path to the temporary file used while the NCA with the provided content ID is being written. */
+void ncaStoreGetTmpPath(const u8 *contentId, char *outPath, size_t outPathSize);
+
+/* Moves a finished temporary file to its store object path. If the object already exists (same data from a different source), the temporary file is just removed. */
+bool ncaStoreCommitObject(const char *tmpPath, const u8 *hash);
+
+void ncaStoreFree(nca_store_t *store);
+
+#endif
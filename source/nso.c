@@ -57,22 +57,13 @@ bool loadNsoBinaryData(NcmContentStorage *ncmStorage, const NcmContentId *ncaId,
     
     u8 i;
     
-    u8 *nsoTextSection = NULL;
-    u64 nsoTextSectionSize = 0;
+    u64 sectionCompressedSize[3] = { (u64)nsoHeader->text_compressed_size, (u64)nsoHeader->rodata_compressed_size, (u64)nsoHeader->data_compressed_size };
+    u64 sectionFileOffset[3] = { (u64)nsoHeader->text_segment_header.file_offset, (u64)nsoHeader->rodata_segment_header.file_offset, (u64)nsoHeader->data_segment_header.file_offset };
+    u64 sectionMemoryOffset[3] = { 0, (u64)nsoHeader->rodata_segment_header.memory_offset, (u64)nsoHeader->data_segment_header.memory_offset };
+    u64 sectionSize[3];
     
-    u8 *nsoRodataSection = NULL;
-    u64 nsoRodataSectionSize = 0;
-    
-    u8 *nsoDataSection = NULL;
-    u64 nsoDataSectionSize = 0;
-    
-    u8 *curCompressedSection;
-    u64 curCompressedSectionSize;
-    u64 curCompressedSectionOffset;
-    u8 curSectionFlag;
-    
-    u8 *curDecompressedSection;
-    u64 curDecompressedSectionSize;
+    u8 *compressedBuf = NULL;
+    u64 compressedBufSize = 0;
     
     bool success = true;
     
@@ -80,195 +71,218 @@ bool loadNsoBinaryData(NcmContentStorage *ncmStorage, const NcmContentId *ncaId,
     
     for(i = 0; i < 3; i++)
     {
-        curCompressedSection = NULL;
-        curCompressedSectionSize = (i == 0 ? (u64)nsoHeader->text_compressed_size : (i == 1 ? (u64)nsoHeader->rodata_compressed_size : (u64)nsoHeader->data_compressed_size));
-        curCompressedSectionOffset = (nso_base_offset + (i == 0 ? (u64)nsoHeader->text_segment_header.file_offset : (i == 1 ? (u64)nsoHeader->rodata_segment_header.file_offset : (u64)nsoHeader->data_segment_header.file_offset)));
-        curSectionFlag = (1 << i);
-        
-        curDecompressedSection = NULL;
-        curDecompressedSectionSize = (i == 0 ? (u64)nsoHeader->text_segment_header.decompressed_size : (i == 1 ? (u64)nsoHeader->rodata_segment_header.decompressed_size : (u64)nsoHeader->data_segment_header.decompressed_size));
-        
-        // Load section
-        curCompressedSection = malloc(curCompressedSectionSize);
-        if (!curCompressedSection)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the compressed %s section from NSO in Program NCA!", __func__, (i == 0 ? ".text" : (i == 1 ? ".rodata" : ".data")));
-            success = false;
-            break;
-        }
-        
-        if (!processNcaCtrSectionBlock(ncmStorage, ncaId, aes_ctx, curCompressedSectionOffset, curCompressedSection, curCompressedSectionSize, false))
-        {
-            breaks++;
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read 0x%016lX bytes %s section from NSO in Program NCA!", __func__, curCompressedSectionSize, (i == 0 ? ".text" : (i == 1 ? ".rodata" : ".data")));
-            free(curCompressedSection);
-            success = false;
-            break;
-        }
+        u64 decompressedSize = (i == 0 ? (u64)nsoHeader->text_segment_header.decompressed_size : (i == 1 ? (u64)nsoHeader->rodata_segment_header.decompressed_size : (u64)nsoHeader->data_segment_header.decompressed_size));
         
-        if (nsoHeader->flags & curSectionFlag)
+        if (nsoHeader->flags & (1 << i))
         {
-            if (curDecompressedSectionSize <= curCompressedSectionSize)
+            if (decompressedSize <= sectionCompressedSize[i])
             {
                 uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid decompressed size for %s section from NSO in Program NCA!", __func__, (i == 0 ? ".text" : (i == 1 ? ".rodata" : ".data")));
-                free(curCompressedSection);
-                success = false;
-                break;
+                return false;
             }
             
-            // Uncompress section
-            curDecompressedSection = malloc(curDecompressedSectionSize);
-            if (!curDecompressedSection)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the decompressed %s section from NSO in Program NCA!", __func__, (i == 0 ? ".text" : (i == 1 ? ".rodata" : ".data")));
-                free(curCompressedSection);
-                success = false;
-                break;
-            }
-            
-            if (LZ4_decompress_safe((const char*)curCompressedSection, (char*)curDecompressedSection, (int)curCompressedSectionSize, (int)curDecompressedSectionSize) != (int)curDecompressedSectionSize)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to decompress %s section from NSO in Program NCA!", __func__, (i == 0 ? ".text" : (i == 1 ? ".rodata" : ".data")));
-                free(curDecompressedSection);
-                free(curCompressedSection);
-                success = false;
-                break;
-            }
-            
-            free(curCompressedSection);
-            
-            switch(i)
-            {
-                case 0:
-                    nsoTextSection = curDecompressedSection;
-                    nsoTextSectionSize = curDecompressedSectionSize;
-                    break;
-                case 1:
-                    nsoRodataSection = curDecompressedSection;
-                    nsoRodataSectionSize = curDecompressedSectionSize;
-                    break;
-                case 2:
-                    nsoDataSection = curDecompressedSection;
-                    nsoDataSectionSize = curDecompressedSectionSize;
-                    break;
-                default:
-                    break;
-            }
+            sectionSize[i] = decompressedSize;
+            if (sectionCompressedSize[i] > compressedBufSize) compressedBufSize = sectionCompressedSize[i];
         } else {
-            switch(i)
-            {
-                case 0:
-                    nsoTextSection = curCompressedSection;
-                    nsoTextSectionSize = curCompressedSectionSize;
-                    break;
-                case 1:
-                    nsoRodataSection = curCompressedSection;
-                    nsoRodataSectionSize = curCompressedSectionSize;
-                    break;
-                case 2:
-                    nsoDataSection = curCompressedSection;
-                    nsoDataSectionSize = curCompressedSectionSize;
-                    break;
-                default:
-                    break;
-            }
+            sectionSize[i] = sectionCompressedSize[i];
         }
     }
     
-    curCompressedSection = curDecompressedSection = NULL;
+    // Calculate full binary size
+    // Overlapping sections get truncated by the next one, just like the loader does
+    u64 finalTextSectionSize = sectionSize[0];
+    u64 finalRodataSectionSize = sectionSize[1];
+    
+    nsoBinaryDataSize = sectionSize[0];
     
-    if (success)
+    if (sectionMemoryOffset[1] > nsoBinaryDataSize)
     {
-        // Calculate full binary size
-        u64 finalTextSectionSize = nsoTextSectionSize;
-        u64 finalRodataSectionSize = nsoRodataSectionSize;
-        
-        nsoBinaryDataSize = nsoTextSectionSize;
-        
-        if ((u64)nsoHeader->rodata_segment_header.memory_offset > nsoBinaryDataSize)
+        nsoBinaryDataSize += (sectionMemoryOffset[1] - nsoBinaryDataSize);
+    } else
+    if (sectionMemoryOffset[1] < nsoBinaryDataSize)
+    {
+        finalTextSectionSize -= (nsoBinaryDataSize - sectionMemoryOffset[1]);
+        nsoBinaryDataSize -= (nsoBinaryDataSize - sectionMemoryOffset[1]);
+    }
+    
+    nsoBinaryDataSize += sectionSize[1];
+    
+    if (sectionMemoryOffset[2] > nsoBinaryDataSize)
+    {
+        nsoBinaryDataSize += (sectionMemoryOffset[2] - nsoBinaryDataSize);
+    } else
+    if (sectionMemoryOffset[2] < nsoBinaryDataSize)
+    {
+        finalRodataSectionSize -= (nsoBinaryDataSize - sectionMemoryOffset[2]);
+        nsoBinaryDataSize -= (nsoBinaryDataSize - sectionMemoryOffset[2]);
+    }
+    
+    nsoBinaryDataSize += sectionSize[2];
+    
+    // Sections are decompressed in order straight into the full binary, so every one of them must fit
+    for(i = 0; i < 3; i++)
+    {
+        if ((sectionMemoryOffset[i] + sectionSize[i]) > nsoBinaryDataSize)
         {
-            nsoBinaryDataSize += ((u64)nsoHeader->rodata_segment_header.memory_offset - nsoBinaryDataSize);
-        } else
-        if ((u64)nsoHeader->rodata_segment_header.memory_offset < nsoBinaryDataSize)
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid memory layout for %s section from NSO in Program NCA!", __func__, (i == 0 ? ".text" : (i == 1 ? ".rodata" : ".data")));
+            nsoBinaryDataSize = 0;
+            return false;
+        }
+    }
+    
+    nsoBinaryData = calloc(nsoBinaryDataSize, sizeof(u8));
+    if (!nsoBinaryData)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate %lu bytes for full decompressed NSO in Program NCA!", __func__, nsoBinaryDataSize);
+        nsoBinaryDataSize = 0;
+        return false;
+    }
+    
+    if (compressedBufSize)
+    {
+        compressedBuf = malloc(compressedBufSize);
+        if (!compressedBuf)
         {
-            finalTextSectionSize -= (nsoBinaryDataSize - (u64)nsoHeader->rodata_segment_header.memory_offset);
-            nsoBinaryDataSize -= (nsoBinaryDataSize - (u64)nsoHeader->rodata_segment_header.memory_offset);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the compressed sections from NSO in Program NCA!", __func__);
+            freeNsoBinaryData();
+            return false;
         }
+    }
+    
+    for(i = 0; i < 3; i++)
+    {
+        bool compressed = ((nsoHeader->flags & (1 << i)) != 0);
+        u8 *sectionData = (nsoBinaryData + sectionMemoryOffset[i]);
         
-        nsoBinaryDataSize += nsoRodataSectionSize;
-        
-        if ((u64)nsoHeader->data_segment_header.memory_offset > nsoBinaryDataSize)
-        {
-            nsoBinaryDataSize += ((u64)nsoHeader->data_segment_header.memory_offset - nsoBinaryDataSize);
-        } else
-        if ((u64)nsoHeader->data_segment_header.memory_offset < nsoBinaryDataSize)
+        // Load section
+        if (!processNcaCtrSectionBlock(ncmStorage, ncaId, aes_ctx, nso_base_offset + sectionFileOffset[i], (compressed ? compressedBuf : sectionData), sectionCompressedSize[i], false))
         {
-            finalRodataSectionSize -= (nsoBinaryDataSize - (u64)nsoHeader->data_segment_header.memory_offset);
-            nsoBinaryDataSize -= (nsoBinaryDataSize - (u64)nsoHeader->data_segment_header.memory_offset);
+            breaks++;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read 0x%016lX bytes %s section from NSO in Program NCA!", __func__, sectionCompressedSize[i], (i == 0 ? ".text" : (i == 1 ? ".rodata" : ".data")));
+            success = false;
+            break;
         }
         
-        nsoBinaryDataSize += nsoDataSectionSize;
-        
-        nsoBinaryData = calloc(nsoBinaryDataSize, sizeof(u8));
-        if (nsoBinaryData)
+        // Uncompress section
+        if (compressed && LZ4_decompress_safe((const char*)compressedBuf, (char*)sectionData, (int)sectionCompressedSize[i], (int)sectionSize[i]) != (int)sectionSize[i])
         {
-            memcpy(nsoBinaryData, nsoTextSection, finalTextSectionSize);
-            memcpy(nsoBinaryData + (u64)nsoHeader->rodata_segment_header.memory_offset, nsoRodataSection, finalRodataSectionSize);
-            memcpy(nsoBinaryData + (u64)nsoHeader->data_segment_header.memory_offset, nsoDataSection, nsoDataSectionSize);
-            
-            nsoBinaryTextSectionOffset = 0;
-            nsoBinaryTextSectionSize = finalTextSectionSize;
-            
-            nsoBinaryRodataSectionOffset = (u64)nsoHeader->rodata_segment_header.memory_offset;
-            nsoBinaryRodataSectionSize = finalRodataSectionSize;
-            
-            nsoBinaryDataSectionOffset = (u64)nsoHeader->data_segment_header.memory_offset;
-            nsoBinaryDataSectionSize = nsoDataSectionSize;
-        } else {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate %lu bytes for full decompressed NSO in Program NCA!", __func__, nsoBinaryDataSize);
-            nsoBinaryDataSize = 0;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to decompress %s section from NSO in Program NCA!", __func__, (i == 0 ? ".text" : (i == 1 ? ".rodata" : ".data")));
             success = false;
+            break;
         }
     }
     
-    if (nsoTextSection) free(nsoTextSection);
-    if (nsoRodataSection) free(nsoRodataSection);
-    if (nsoDataSection) free(nsoDataSection);
+    if (compressedBuf) free(compressedBuf);
     
-    return success;
+    if (!success)
+    {
+        freeNsoBinaryData();
+        return false;
+    }
+    
+    nsoBinaryTextSectionOffset = 0;
+    nsoBinaryTextSectionSize = finalTextSectionSize;
+    
+    nsoBinaryRodataSectionOffset = sectionMemoryOffset[1];
+    nsoBinaryRodataSectionSize = finalRodataSectionSize;
+    
+    nsoBinaryDataSectionOffset = sectionMemoryOffset[2];
+    nsoBinaryDataSectionSize = sectionSize[2];
+    
+    return true;
 }
 
-bool retrieveMiddlewareListFromNso(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, const char *nso_filename, u64 nso_base_offset, nso_header_t *nsoHeader, char *programInfoXml)
+static bool nsoStreamRefill(nso_stream_ctx_t *ctx)
 {
-    if (!ncmStorage || !ncaId || !aes_ctx || !nso_filename || !strlen(nso_filename) || !nso_base_offset || !nsoHeader || !programInfoXml)
+    if (ctx->in_pos < ctx->in_size) return true;
+    if (!ctx->in_remaining) return false;
+    
+    u64 readSize = (ctx->in_remaining > NSO_STREAM_READ_SIZE ? NSO_STREAM_READ_SIZE : ctx->in_remaining);
+    
+    if (!processNcaCtrSectionBlock(ctx->ncmStorage, ctx->ncaId, ctx->aes_ctx, ctx->in_offset, ctx->in_buf, readSize, false))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to retrieve middleware list from NSO in Program NCA!", __func__);
+        breaks++;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read 0x%016lX bytes from .rodata section in NSO from Program NCA!", __func__, readSize);
+        ctx->in_remaining = 0;
         return false;
     }
     
-    u64 i;
+    ctx->in_offset += readSize;
+    ctx->in_remaining -= readSize;
+    ctx->in_size = readSize;
+    ctx->in_pos = 0;
+    
+    return true;
+}
+
+static bool nsoStreamGetByte(nso_stream_ctx_t *ctx, u8 *out)
+{
+    if (!nsoStreamRefill(ctx)) return false;
+    
+    *out = ctx->in_buf[ctx->in_pos++];
     
+    return true;
+}
+
+// Looks for "SDK MW+<vendor>+<name>" strings in the decompressed data that hasn't been scanned yet
+// Matches that may continue past the current end of the window are picked up again on the next call, unless this is the last one
+static void nsoStreamScanMiddleware(nso_stream_ctx_t *ctx, bool last)
+{
     char tmp[NAME_BUF_LEN] = {'\0'};
     
-    if (!loadNsoBinaryData(ncmStorage, ncaId, aes_ctx, nso_base_offset, nsoHeader)) return false;
+    char *data = (char*)ctx->out_buf;
+    u64 end = ctx->out_pos;
+    u64 pos = ctx->scan_pos;
     
-    for(i = 0; i < nsoBinaryRodataSectionSize; i++)
+    while(pos < end)
     {
-        char *curStr = ((char*)nsoBinaryData + nsoBinaryRodataSectionOffset + i);
+        // memchr() is vectorized by newlib, so let it skip over the data that can't match
+        char *curStr = memchr(data + pos, NSO_MIDDLEWARE_MAGIC[0], end - pos);
+        if (!curStr)
+        {
+            pos = end;
+            break;
+        }
         
-        if (strncmp(curStr, "SDK MW+", 7) != 0) continue;
+        pos = (u64)(curStr - data);
         
-        // Found a match
-        char *mwDev = (curStr + 7);
-        char *mwName = (strchr(mwDev, '+') + 1);
+        if ((end - pos) < NSO_MIDDLEWARE_MAGIC_LEN)
+        {
+            if (!last) break;
+            pos = end;
+            break;
+        }
         
-        // Filter nnSdk entries
-        if (!strncasecmp(mwName, "NintendoSdk_nnSdk", 17))
+        if (memcmp(curStr, NSO_MIDDLEWARE_MAGIC, NSO_MIDDLEWARE_MAGIC_LEN) != 0)
         {
-            i += strlen(curStr);
+            pos++;
+            continue;
+        }
+        
+        // Found a match
+        u64 maxStrLen = ((end - pos) > NSO_MIDDLEWARE_MAX_STR_LEN ? NSO_MIDDLEWARE_MAX_STR_LEN : (end - pos));
+        char *strEnd = memchr(curStr, '\0', maxStrLen);
+        if (!strEnd)
+        {
+            // Wait for the rest of the string
+            if (!last && maxStrLen < NSO_MIDDLEWARE_MAX_STR_LEN) break;
+            
+            pos += NSO_MIDDLEWARE_MAGIC_LEN;
             continue;
         }
         
+        char *mwDev = (curStr + NSO_MIDDLEWARE_MAGIC_LEN);
+        char *mwName = memchr(mwDev, '+', (size_t)(strEnd - mwDev));
+        
+        // Update counter
+        pos = ((u64)(strEnd - data) + 1);
+        
+        if (!mwName) continue;
+        mwName++;
+        
+        // Filter nnSdk entries
+        if (!strncasecmp(mwName, "NintendoSdk_nnSdk", 17)) continue;
+        
         sprintf(tmp, "    <Middleware>\n" \
                      "      <ModuleName>%s</ModuleName>\n" \
                      "      <VenderName>%.*s</VenderName>\n" \
@@ -276,19 +290,191 @@ bool retrieveMiddlewareListFromNso(NcmContentStorage *ncmStorage, const NcmConte
                      "    </Middleware>\n", \
                      mwName, \
                      (int)(mwName - mwDev - 1), mwDev, \
-                     nso_filename);
+                     ctx->nso_filename);
+        
+        strcat(ctx->programInfoXml, tmp);
+    }
+    
+    ctx->scan_pos = pos;
+}
+
+// Scans the window and only keeps the last NSO_STREAM_HISTORY_SIZE bytes around, which is all LZ4 matches can reference
+static void nsoStreamFlush(nso_stream_ctx_t *ctx, bool last)
+{
+    nsoStreamScanMiddleware(ctx, last);
+    
+    if (last || ctx->out_pos <= NSO_STREAM_HISTORY_SIZE) return;
+    
+    u64 shift = (ctx->out_pos - NSO_STREAM_HISTORY_SIZE);
+    
+    memmove(ctx->out_buf, ctx->out_buf + shift, NSO_STREAM_HISTORY_SIZE);
+    
+    ctx->out_pos = NSO_STREAM_HISTORY_SIZE;
+    ctx->scan_pos = (ctx->scan_pos > shift ? (ctx->scan_pos - shift) : 0);
+}
+
+// Copies data straight from the input (LZ4 literals or uncompressed segments)
+static bool nsoStreamCopyInput(nso_stream_ctx_t *ctx, u64 size)
+{
+    if (size > (ctx->out_size - ctx->out_total)) return false;
+    
+    while(size)
+    {
+        if (!nsoStreamRefill(ctx)) return false;
         
-        strcat(programInfoXml, tmp);
+        u64 copySize = (ctx->in_size - ctx->in_pos);
+        if (copySize > size) copySize = size;
+        if (copySize > (NSO_STREAM_HISTORY_SIZE + NSO_STREAM_WINDOW_SIZE - ctx->out_pos)) copySize = (NSO_STREAM_HISTORY_SIZE + NSO_STREAM_WINDOW_SIZE - ctx->out_pos);
         
-        // Update counter
-        i += strlen(curStr);
+        memcpy(ctx->out_buf + ctx->out_pos, ctx->in_buf + ctx->in_pos, copySize);
+        
+        ctx->in_pos += copySize;
+        ctx->out_pos += copySize;
+        ctx->out_total += copySize;
+        size -= copySize;
+        
+        if (ctx->out_pos == (NSO_STREAM_HISTORY_SIZE + NSO_STREAM_WINDOW_SIZE)) nsoStreamFlush(ctx, false);
     }
     
-    freeNsoBinaryData();
+    return true;
+}
+
+// Copies previously decompressed data (LZ4 match)
+static bool nsoStreamCopyMatch(nso_stream_ctx_t *ctx, u64 offset, u64 size)
+{
+    if (!offset || offset > ctx->out_pos || size > (ctx->out_size - ctx->out_total)) return false;
+    
+    while(size)
+    {
+        u64 copySize = (NSO_STREAM_HISTORY_SIZE + NSO_STREAM_WINDOW_SIZE - ctx->out_pos);
+        if (copySize > size) copySize = size;
+        
+        u8 *dst = (ctx->out_buf + ctx->out_pos);
+        u8 *src = (dst - offset);
+        
+        if (offset >= copySize)
+        {
+            memcpy(dst, src, copySize);
+        } else {
+            // Overlapping match - the pattern repeats itself
+            u64 j;
+            for(j = 0; j < copySize; j++) dst[j] = src[j];
+        }
+        
+        ctx->out_pos += copySize;
+        ctx->out_total += copySize;
+        size -= copySize;
+        
+        if (ctx->out_pos == (NSO_STREAM_HISTORY_SIZE + NSO_STREAM_WINDOW_SIZE)) nsoStreamFlush(ctx, false);
+    }
+    
+    return true;
+}
+
+static bool nsoStreamReadLength(nso_stream_ctx_t *ctx, u64 *length)
+{
+    u8 val;
+    
+    do {
+        if (!nsoStreamGetByte(ctx, &val)) return false;
+        *length += val;
+    } while(val == 0xFF);
     
     return true;
 }
 
+// NSO segments are stored as a single raw LZ4 block, so they're decoded sequence by sequence instead of relying on LZ4's own streaming API
+static bool nsoStreamDecompress(nso_stream_ctx_t *ctx)
+{
+    u8 token, offsetBytes[2];
+    u64 literalLength, matchLength, matchOffset;
+    
+    while(ctx->out_total < ctx->out_size)
+    {
+        if (!nsoStreamGetByte(ctx, &token)) return false;
+        
+        literalLength = (u64)(token >> 4);
+        if (literalLength == 0x0F && !nsoStreamReadLength(ctx, &literalLength)) return false;
+        
+        if (!nsoStreamCopyInput(ctx, literalLength)) return false;
+        
+        // The last sequence only holds literals
+        if (ctx->out_total == ctx->out_size) break;
+        
+        if (!nsoStreamGetByte(ctx, &(offsetBytes[0])) || !nsoStreamGetByte(ctx, &(offsetBytes[1]))) return false;
+        matchOffset = ((u64)offsetBytes[0] | ((u64)offsetBytes[1] << 8));
+        
+        matchLength = (u64)(token & 0x0F);
+        if (matchLength == 0x0F && !nsoStreamReadLength(ctx, &matchLength)) return false;
+        matchLength += 4;
+        
+        if (!nsoStreamCopyMatch(ctx, matchOffset, matchLength)) return false;
+    }
+    
+    return true;
+}
+
+bool retrieveMiddlewareListFromNso(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, const char *nso_filename, u64 nso_base_offset, nso_header_t *nsoHeader, char *programInfoXml)
+{
+    if (!ncmStorage || !ncaId || !aes_ctx || !nso_filename || !strlen(nso_filename) || !nso_base_offset || !nsoHeader || !programInfoXml)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to retrieve middleware list from NSO in Program NCA!", __func__);
+        return false;
+    }
+    
+    bool success = false;
+    bool compressed = ((nsoHeader->flags & 0x02) != 0);
+    
+    nso_stream_ctx_t streamCtx;
+    memset(&streamCtx, 0, sizeof(nso_stream_ctx_t));
+    
+    streamCtx.ncmStorage = ncmStorage;
+    streamCtx.ncaId = ncaId;
+    streamCtx.aes_ctx = aes_ctx;
+    streamCtx.in_offset = (nso_base_offset + (u64)nsoHeader->rodata_segment_header.file_offset);
+    streamCtx.in_remaining = (u64)nsoHeader->rodata_compressed_size;
+    streamCtx.out_size = (compressed ? (u64)nsoHeader->rodata_segment_header.decompressed_size : (u64)nsoHeader->rodata_compressed_size);
+    streamCtx.nso_filename = nso_filename;
+    streamCtx.programInfoXml = programInfoXml;
+    
+    if (compressed && streamCtx.out_size <= streamCtx.in_remaining)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid decompressed size for .rodata section from NSO in Program NCA!", __func__);
+        return false;
+    }
+    
+    // Only .rodata is needed here - it's decompressed and scanned one window at a time
+    streamCtx.in_buf = malloc(NSO_STREAM_READ_SIZE);
+    streamCtx.out_buf = malloc(NSO_STREAM_HISTORY_SIZE + NSO_STREAM_WINDOW_SIZE);
+    
+    if (!streamCtx.in_buf || !streamCtx.out_buf)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the .rodata section stream from NSO in Program NCA!", __func__);
+        goto out;
+    }
+    
+    if (compressed)
+    {
+        success = nsoStreamDecompress(&streamCtx);
+    } else {
+        success = nsoStreamCopyInput(&streamCtx, streamCtx.out_size);
+    }
+    
+    if (!success)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to decompress .rodata section from NSO in Program NCA!", __func__);
+        goto out;
+    }
+    
+    nsoStreamFlush(&streamCtx, true);
+    
+out:
+    if (streamCtx.out_buf) free(streamCtx.out_buf);
+    if (streamCtx.in_buf) free(streamCtx.in_buf);
+    
+    return success;
+}
+
 bool retrieveSymbolsListFromNso(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, const char *nso_filename, u64 nso_base_offset, nso_header_t *nsoHeader, char *programInfoXml)
 {
     if (!ncmStorage || !ncaId || !aes_ctx || !nso_filename || !strlen(nso_filename) || !nso_base_offset || !nsoHeader || !programInfoXml)
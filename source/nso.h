@@ -14,6 +14,14 @@
 
 #define ST_OBJECT       0x01
 
+#define NSO_STREAM_READ_SIZE        (u64)0x20000                                    // 128 KiB (131072 bytes) - compressed data read from the NCA at once
+#define NSO_STREAM_HISTORY_SIZE     (u64)0x10000                                    // 64 KiB (65536 bytes) - maximum LZ4 match distance
+#define NSO_STREAM_WINDOW_SIZE      (u64)0x40000                                    // 256 KiB (262144 bytes) - decompressed data scanned at once
+
+#define NSO_MIDDLEWARE_MAGIC        "SDK MW+"
+#define NSO_MIDDLEWARE_MAGIC_LEN    7
+#define NSO_MIDDLEWARE_MAX_STR_LEN  0x200                                           // Longer middleware strings are skipped
+
 typedef struct {
     u32 file_offset;
     u32 memory_offset;
@@ -49,6 +57,25 @@ typedef struct {
     u8 data_decompressed_hash[0x20];
 } PACKED nso_header_t;
 
+// Used to decompress a single NSO segment through a sliding window, without keeping the whole segment in memory
+typedef struct {
+    NcmContentStorage *ncmStorage;
+    const NcmContentId *ncaId;
+    Aes128CtrContext *aes_ctx;
+    u8 *in_buf;                                                                     // NSO_STREAM_READ_SIZE
+    u64 in_offset;                                                                  // NCA offset for the next read
+    u64 in_remaining;                                                               // Segment data not read from the NCA yet
+    u64 in_size;                                                                    // Valid data in in_buf
+    u64 in_pos;
+    u8 *out_buf;                                                                    // NSO_STREAM_HISTORY_SIZE + NSO_STREAM_WINDOW_SIZE
+    u64 out_pos;
+    u64 out_total;                                                                  // Decompressed data produced so far
+    u64 out_size;                                                                   // Decompressed segment size
+    u64 scan_pos;                                                                   // out_buf position the middleware scan resumes from
+    const char *nso_filename;
+    char *programInfoXml;
+} nso_stream_ctx_t;
+
 // Retrieves the middleware list from a NSO stored in a partition from a NCA file
 bool retrieveMiddlewareListFromNso(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, const char *nso_filename, u64 nso_base_offset, nso_header_t *nsoHeader, char *programInfoXml);
 
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "out_file.h"
+#include "perf.h"
+#include "util.h"
+
+static FsFileSystem *outFileGetSdCardFileSystem(const char *path, char *outFsPath)
+{
+    if (!path || strncmp(path, OUT_FILE_SDMC_PREFIX "/", OUT_FILE_SDMC_PREFIX_LEN + 1) != 0 || strlen(path + OUT_FILE_SDMC_PREFIX_LEN) >= FS_MAX_PATH) return NULL;
+    
+    // IFileSystem paths are relative to the root of the device
+    snprintf(outFsPath, FS_MAX_PATH, "%s", path + OUT_FILE_SDMC_PREFIX_LEN);
+    
+    return fsdevGetDeviceFileSystem(OUT_FILE_SDMC_PREFIX);
+}
+
+bool outFileCreate(out_file_t *out, const char *path, u64 prealloc_size)
+{
+    if (!out) return false;
+    
+    char fsPath[FS_MAX_PATH] = {'\0'};
+    FsFileSystem *sdfs = NULL;
+    
+    memset(out, 0, sizeof(out_file_t));
+    
+    sdfs = outFileGetSdCardFileSystem(path, fsPath);
+    if (!sdfs)
+    {
+        out->lastResult = MAKERESULT(Module_Libnx, LibnxError_NotFound);
+        return false;
+    }
+    
+    // Just like fopen(path, "wb")
+    fsFsDeleteFile(sdfs, fsPath);
+    
+    out->lastResult = fsFsCreateFile(sdfs, fsPath, (s64)prealloc_size, 0);
+    if (R_SUCCEEDED(out->lastResult))
+    {
+        out->allocSize = prealloc_size;
+        out->preallocated = true;
+    } else {
+        // Let the write fail at the right offset, like stdio would
+        out->lastResult = fsFsCreateFile(sdfs, fsPath, 0, 0);
+        if (R_FAILED(out->lastResult)) return false;
+    }
+    
+    out->lastResult = fsFsOpenFile(sdfs, fsPath, FsOpenMode_Write | FsOpenMode_Append, &(out->file));
+    if (R_FAILED(out->lastResult))
+    {
+        fsFsDeleteFile(sdfs, fsPath);
+        return false;
+    }
+    
+    out->open = true;
+    
+    return true;
+}
+
+bool outFileOpen(out_file_t *out, const char *path)
+{
+    if (!out) return false;
+    
+    char fsPath[FS_MAX_PATH] = {'\0'};
+    FsFileSystem *sdfs = NULL;
+    s64 fileSize = 0;
+    
+    memset(out, 0, sizeof(out_file_t));
+    
+    sdfs = outFileGetSdCardFileSystem(path, fsPath);
+    if (!sdfs)
+    {
+        out->lastResult = MAKERESULT(Module_Libnx, LibnxError_NotFound);
+        return false;
+    }
+    
+    out->lastResult = fsFsOpenFile(sdfs, fsPath, FsOpenMode_Write | FsOpenMode_Append, &(out->file));
+    if (R_FAILED(out->lastResult)) return false;
+    
+    out->lastResult = fsFileGetSize(&(out->file), &fileSize);
+    if (R_FAILED(out->lastResult))
+    {
+        fsFileClose(&(out->file));
+        return false;
+    }
+    
+    out->dataSize = out->allocSize = (u64)fileSize;
+    out->open = true;
+    
+    return true;
+}
+
+void outFileSeek(out_file_t *out, u64 offset)
+{
+    if (out) out->offset = offset;
+}
+
+size_t outFileWrite(out_file_t *out, const void *buf, u64 size)
+{
+    if (!out || !out->open || !buf || !size) return 0;
+    
+    u64 startTick = perfTick();
+    
+    // FsOpenMode_Append takes care of growing the file past the preallocated size
+    out->lastResult = fsFileWrite(&(out->file), (s64)out->offset, buf, size, FsWriteOption_None);
+    perfAdd(PERF_STAGE_WRITE, startTick, size);
+    
+    if (R_FAILED(out->lastResult)) return 0;
+    
+    out->offset += size;
+    if (out->offset > out->dataSize) out->dataSize = out->offset;
+    if (out->dataSize > out->allocSize) out->allocSize = out->dataSize;
+    
+    return (size_t)size;
+}
+
+bool outFileFlush(out_file_t *out)
+{
+    if (!out || !out->open) return false;
+    
+    out->lastResult = fsFileFlush(&(out->file));
+    
+    return R_SUCCEEDED(out->lastResult);
+}
+
+bool outFileClose(out_file_t *out)
+{
+    if (!out || !out->open) return false;
+    
+    bool success = true;
+    
+    // Get rid of the preallocated space we didn't use (e.g. canceled dumps or finished sequential dump sessions)
+    if (out->preallocated && out->dataSize < out->allocSize)
+    {
+        out->lastResult = fsFileSetSize(&(out->file), (s64)out->dataSize);
+        if (R_FAILED(out->lastResult)) success = false;
+    }
+    
+    Result result = fsFileFlush(&(out->file));
+    if (R_FAILED(result))
+    {
+        out->lastResult = result;
+        success = false;
+    }
+    
+    fsFileClose(&(out->file));
+    out->open = false;
+    
+    return success;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#ifndef __OUT_FILE_H__
+#define __OUT_FILE_H__
+
+#include <switch.h>
+
+#define OUT_FILE_SDMC_PREFIX        "sdmc:"
+#define OUT_FILE_SDMC_PREFIX_LEN    5
+
+// Output file written through the native SD card IFileSystem, bypassing newlib buffering
+typedef struct {
+    FsFile file;
+    bool open;
+    u64 offset;                                                                 // Next write offset
+    u64 dataSize;                                                               // End of the written data
+    u64 allocSize;                                                              // Current file size (preallocated size until outFileClose())
+    bool preallocated;                                                          // Set by outFileCreate(). Files opened by outFileOpen() are never trimmed
+    Result lastResult;                                                          // Last FS result. Only valid after a failed call
+} out_file_t;
+
+/* Creates (or replaces) a "sdmc:/" output file and preallocates it to prealloc_size bytes, so the FS doesn't have to grow it one cluster at a time. */
+/* If the preallocation fails (e.g. a file bigger than 4 GiB on a FAT32 partition), an empty file is created instead and writes behave just like with stdio. */
+bool outFileCreate(out_file_t *out, const char *path, u64 prealloc_size);
+
+/* Opens an existing "sdmc:/" file for writing at offset 0, without truncating it (used to rewrite headers). */
+bool outFileOpen(out_file_t *out, const char *path);
+
+/* Changes the offset for the next write (e.g. to rewrite a placeholder header). */
+void outFileSeek(out_file_t *out, u64 offset);
+
+/* Writes data at the current offset, straight from the provided buffer. Returns the number of bytes written, just like fwrite(). */
+size_t outFileWrite(out_file_t *out, const void *buf, u64 size);
+
+/* Flushes the written data to the SD card without closing the file (e.g. before saving a dump journal checkpoint). */
+bool outFileFlush(out_file_t *out);
+
+/* Trims any unused preallocated space, flushes and closes the file. */
+bool outFileClose(out_file_t *out);
+
+#endif
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "perf.h"
+#include "nca_cache.h"
+#include "ui.h"
+#include "util.h"
+
+/* Extern variables */
+
+extern int font_height;
+
+static const char *perfStageNames[PERF_STAGE_CNT] = { "read", "crypt", "hash", "write", "ui" };
+static const char *perfStageLabels[PERF_STAGE_CNT] = { "Read", "Crypt", "Hash", "Write", "UI" };
+
+static perf_stats_t perfStats;
+static u64 perfStartTick = 0;
+static volatile bool perfActive = false;
+
+static double perfTicksToMs(u64 ticks)
+{
+    return ((double)armTicksToNs(ticks) / 1000000.0);
+}
+
+static void perfGetNcaCacheDelta(u64 *hits, u64 *misses, u64 *bypasses)
+{
+    nca_cache_stats_t cacheStats;
+    ncaCacheGetStats(&cacheStats);
+    
+    // The counters are reset if the cache is invalidated (e.g. gamecard change) or resized in the meantime
+    *hits = (cacheStats.hits >= perfStats.nca_cache_hits ? (cacheStats.hits - perfStats.nca_cache_hits) : cacheStats.hits);
+    *misses = (cacheStats.misses >= perfStats.nca_cache_misses ? (cacheStats.misses - perfStats.nca_cache_misses) : cacheStats.misses);
+    *bypasses = (cacheStats.bypasses >= perfStats.nca_cache_bypasses ? (cacheStats.bypasses - perfStats.nca_cache_bypasses) : cacheStats.bypasses);
+}
+
+void perfStart()
+{
+    nca_cache_stats_t cacheStats;
+    ncaCacheGetStats(&cacheStats);
+    
+    memset(&perfStats, 0, sizeof(perf_stats_t));
+    perfStats.nca_cache_hits = cacheStats.hits;
+    perfStats.nca_cache_misses = cacheStats.misses;
+    perfStats.nca_cache_bypasses = cacheStats.bypasses;
+    perfStartTick = perfTick();
+    perfActive = true;
+}
+
+void perfAdd(perfStage stage, u64 startTick, u64 bytes)
+{
+    if (!perfActive || stage >= PERF_STAGE_CNT) return;
+    
+    u64 ticks = (perfTick() - startTick);
+    
+    // Pipeline worker threads update their own stages, but batch prefetch reads can overlap with the main thread
+    __atomic_fetch_add(&(perfStats.ticks[stage]), ticks, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&(perfStats.bytes[stage]), bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&(perfStats.calls[stage]), 1, __ATOMIC_RELAXED);
+}
+
+void perfSetMemoryPeak(u64 bytes)
+{
+    if (!perfActive) return;
+    
+    perfStats.mem_peak = bytes;
+}
+
+void perfStop(const char *dumpType, const char *name, u64 dumpSize, bool success)
+{
+    if (!perfActive) return;
+    
+    perfActive = false;
+    
+    u32 i;
+    u64 elapsedTicks = (perfTick() - perfStartTick), now = 0;
+    u64 cacheHits = 0, cacheMisses = 0, cacheBypasses = 0;
+    struct tm ts;
+    char timestamp[32] = {'\0'};
+    const char *ptr = NULL;
+    
+    FILE *logFile = fopen(PERF_LOG_PATH, "a");
+    if (!logFile) return;
+    
+    // Write the CSV header if we just created the file
+    fseek(logFile, 0, SEEK_END);
+    if (!ftell(logFile))
+    {
+        fprintf(logFile, PERF_LOG_HEADER);
+        for(i = 0; i < PERF_STAGE_CNT; i++) fprintf(logFile, ",%s_ms,%s_bytes,%s_calls", perfStageNames[i], perfStageNames[i], perfStageNames[i]);
+        fprintf(logFile, ",mem_peak_bytes,nca_cache_hits,nca_cache_misses,nca_cache_bypasses\n");
+    }
+    
+    timeGetCurrentTime(TimeType_LocalSystemClock, &now);
+    
+    time_t nowTime = (time_t)now;
+    gmtime_r(&nowTime, &ts);
+    strftime(timestamp, MAX_ELEMENTS(timestamp), "%Y-%m-%d %H:%M:%S", &ts);
+    
+    fprintf(logFile, "%s,%s,\"", timestamp, (dumpType ? dumpType : ""));
+    
+    // Escape double quotes in the dump name
+    for(ptr = (name ? name : ""); *ptr; ptr++)
+    {
+        if (*ptr == '"') fputc('"', logFile);
+        fputc(*ptr, logFile);
+    }
+    
+    fprintf(logFile, "\",%lu,%.3lf,%u", dumpSize, perfTicksToMs(elapsedTicks), (success ? 1 : 0));
+    
+    for(i = 0; i < PERF_STAGE_CNT; i++) fprintf(logFile, ",%.3lf,%lu,%lu", perfTicksToMs(perfStats.ticks[i]), perfStats.bytes[i], perfStats.calls[i]);
+    
+    perfGetNcaCacheDelta(&cacheHits, &cacheMisses, &cacheBypasses);
+    
+    fprintf(logFile, ",%lu,%lu,%lu,%lu\n", perfStats.mem_peak, cacheHits, cacheMisses, cacheBypasses);
+    fclose(logFile);
+}
+
+void perfDrawStages(int line)
+{
+    if (!perfActive) return;
+    
+    u32 i;
+    u64 elapsedTicks = (perfTick() - perfStartTick);
+    u64 cacheHits = 0, cacheMisses = 0, cacheBypasses = 0;
+    char stageStr[NAME_BUF_LEN] = {'\0'}, tmp[64] = {'\0'};
+    
+    if (!elapsedTicks) return;
+    
+    for(i = 0; i < PERF_STAGE_CNT; i++)
+    {
+        u64 ticks = __atomic_load_n(&(perfStats.ticks[i]), __ATOMIC_RELAXED);
+        u64 bytes = __atomic_load_n(&(perfStats.bytes[i]), __ATOMIC_RELAXED);
+        if (!ticks) continue;
+        
+        // Pipeline stages run in parallel, so the busiest stage (the one closer to 100%) is the bottleneck
+        u32 busy = (u32)((ticks * 100) / elapsedTicks);
+        
+        if (bytes && i != PERF_STAGE_UI)
+        {
+            snprintf(tmp, MAX_ELEMENTS(tmp), "%s%s: %u%% (%.2lf MiB/s)", (strlen(stageStr) ? " | " : ""), perfStageLabels[i], busy, ((double)bytes / MiB) / (perfTicksToMs(ticks) / 1000.0));
+        } else {
+            snprintf(tmp, MAX_ELEMENTS(tmp), "%s%s: %u%%", (strlen(stageStr) ? " | " : ""), perfStageLabels[i], busy);
+        }
+        
+        strcat(stageStr, tmp);
+    }
+    
+    perfGetNcaCacheDelta(&cacheHits, &cacheMisses, &cacheBypasses);
+    
+    if (cacheHits || cacheMisses)
+    {
+        snprintf(tmp, MAX_ELEMENTS(tmp), "%sCache: %u%% hits", (strlen(stageStr) ? " | " : ""), (u32)((cacheHits * 100) / (cacheHits + cacheMisses)));
+        strcat(stageStr, tmp);
+    }
+    
+    uiFill(0, (line * LINE_HEIGHT) + 10, FB_WIDTH, LINE_HEIGHT, BG_COLOR_RGB);
+    if (strlen(stageStr)) uiDrawString(font_height * 2, STRING_Y_POS(line), FONT_COLOR_RGB, "%s", stageStr);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#ifndef __PERF_H__
+#define __PERF_H__
+
+#include <switch.h>
+
+#define PERF_LOG_HEADER             "timestamp,dump_type,name,size,elapsed_ms,success"
+#define perfTick()                  armGetSystemTick()
+
+typedef enum {
+    PERF_STAGE_READ = 0,                                                        // Gamecard IStorage reads and ncm IPC
+    PERF_STAGE_CRYPT,                                                           // NCA section AES-CTR
+    PERF_STAGE_HASH,                                                            // CRC32 / SHA-256
+    PERF_STAGE_WRITE,                                                           // Output file / sink writes
+    PERF_STAGE_UI,                                                              // Progress bar drawing
+    PERF_STAGE_CNT
+} perfStage;
+
+typedef struct {
+    u64 ticks[PERF_STAGE_CNT];                                                  // Accumulated system ticks
+    u64 bytes[PERF_STAGE_CNT];
+    u64 calls[PERF_STAGE_CNT];
+    u64 mem_peak;                                                               // Dump arena high-water mark. Zero for dump types that don't use an arena
+    u64 nca_cache_hits;                                                         // NCA block cache counters at perfStart(), so only the current dump is reported
+    u64 nca_cache_misses;
+    u64 nca_cache_bypasses;
+} perf_stats_t;
+
+/* Resets the stage counters and starts collecting data for a new dump. Only one dump can be measured at a time. */
+void perfStart();
+
+/* Adds the time elapsed since startTick (retrieved with perfTick()) to a stage. Does nothing unless perfStart() was called. */
+/* Stages can be updated from any thread. */
+void perfAdd(perfStage stage, u64 startTick, u64 bytes);
+
+/* Sets the peak memory usage reported for the current dump. Does nothing unless perfStart() was called. */
+void perfSetMemoryPeak(u64 bytes);
+
+/* Stops collecting data and appends the per-stage breakdown for the current dump to PERF_LOG_PATH. */
+void perfStop(const char *dumpType, const char *name, u64 dumpSize, bool success);
+
+/* Draws a one-line per-stage breakdown (plus the NCA block cache hit rate) at the provided line. Used by printProgressBar() when the stage timings view is enabled. */
+void perfDrawStages(int line);
+
+#endif
@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipeline.h"
+#include "util.h"
+
+// The main thread runs on core #0 - worker threads are spread over the remaining application cores
+static const int pipelineWorkerCores[] = { 1, 2 };
+
+bool pipelineInit(pipeline_ctx_t *ctx, u8 stage_cnt, u64 buf_size)
+{
+    if (!ctx || stage_cnt < 2 || stage_cnt > PIPELINE_MAX_STAGES || !buf_size) return false;
+    
+    u32 i;
+    
+    memset(ctx, 0, sizeof(pipeline_ctx_t));
+    
+    mutexInit(&(ctx->mutex));
+    condvarInit(&(ctx->cond));
+    
+    ctx->stage_cnt = stage_cnt;
+    
+    for(i = 0; i < PIPELINE_SLOT_COUNT; i++)
+    {
+        ctx->slots[i].data = malloc(buf_size);
+        if (!ctx->slots[i].data)
+        {
+            pipelineFree(ctx);
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+void pipelineFree(pipeline_ctx_t *ctx)
+{
+    if (!ctx) return;
+    
+    u32 i;
+    
+    for(i = 0; i < PIPELINE_SLOT_COUNT; i++)
+    {
+        if (ctx->slots[i].data)
+        {
+            free(ctx->slots[i].data);
+            ctx->slots[i].data = NULL;
+        }
+    }
+}
+
+bool pipelineStartWorker(pipeline_ctx_t *ctx, ThreadFunc func, void *arg)
+{
+    if (!ctx || !func || ctx->worker_cnt >= PIPELINE_MAX_WORKERS) return false;
+    
+    Result result;
+    s32 prio = 0x2C;
+    int cpuid = (ctx->worker_cnt < MAX_ELEMENTS(pipelineWorkerCores) ? pipelineWorkerCores[ctx->worker_cnt] : -2);
+    Thread *thread = &(ctx->workers[ctx->worker_cnt]);
+    
+    svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+    
+    result = threadCreate(thread, func, arg, NULL, PIPELINE_WORKER_STACK_SIZE, prio, cpuid);
+    
+    // Fallback to the default core if the desired one isn't available to us (e.g. applet mode)
+    if (R_FAILED(result) && cpuid != -2) result = threadCreate(thread, func, arg, NULL, PIPELINE_WORKER_STACK_SIZE, prio, -2);
+    if (R_FAILED(result)) return false;
+    
+    result = threadStart(thread);
+    if (R_FAILED(result))
+    {
+        threadClose(thread);
+        return false;
+    }
+    
+    ctx->worker_cnt++;
+    
+    return true;
+}
+
+void pipelineJoinWorkers(pipeline_ctx_t *ctx)
+{
+    if (!ctx) return;
+    
+    u8 i;
+    
+    for(i = 0; i < ctx->worker_cnt; i++)
+    {
+        threadWaitForExit(&(ctx->workers[i]));
+        threadClose(&(ctx->workers[i]));
+    }
+    
+    ctx->worker_cnt = 0;
+}
+
+pipeline_slot_t *pipelineAcquire(pipeline_ctx_t *ctx, u8 stage)
+{
+    if (!ctx || stage >= ctx->stage_cnt) return NULL;
+    
+    pipeline_slot_t *slot = NULL;
+    
+    mutexLock(&(ctx->mutex));
+    
+    slot = &(ctx->slots[ctx->cursors[stage] % PIPELINE_SLOT_COUNT]);
+    
+    // Wait until the previous stage is done with this slot
+    while(!ctx->abort && slot->stage != stage) condvarWait(&(ctx->cond), &(ctx->mutex));
+    
+    if (ctx->abort) slot = NULL;
+    
+    mutexUnlock(&(ctx->mutex));
+    
+    // Slot flags are reset by the producer stage
+    if (slot && stage == 0)
+    {
+        slot->size = 0;
+        slot->last = false;
+        slot->error = false;
+    }
+    
+    return slot;
+}
+
+void pipelineRelease(pipeline_ctx_t *ctx, pipeline_slot_t *slot)
+{
+    if (!ctx || !slot) return;
+    
+    mutexLock(&(ctx->mutex));
+    
+    ctx->cursors[slot->stage]++;
+    slot->stage = ((slot->stage + 1) % ctx->stage_cnt);
+    
+    condvarWakeAll(&(ctx->cond));
+    
+    mutexUnlock(&(ctx->mutex));
+}
+
+// Blocks until every slot released by the producer stage has gone through all the remaining stages
+// Returns false if the pipeline was aborted in the meantime
+bool pipelineWaitIdle(pipeline_ctx_t *ctx)
+{
+    if (!ctx) return false;
+    
+    bool ret;
+    
+    mutexLock(&(ctx->mutex));
+    
+    while(!ctx->abort && ctx->cursors[ctx->stage_cnt - 1] != ctx->cursors[0]) condvarWait(&(ctx->cond), &(ctx->mutex));
+    
+    ret = !ctx->abort;
+    
+    mutexUnlock(&(ctx->mutex));
+    
+    return ret;
+}
+
+void pipelineAbort(pipeline_ctx_t *ctx)
+{
+    if (!ctx) return;
+    
+    mutexLock(&(ctx->mutex));
+    
+    ctx->abort = true;
+    condvarWakeAll(&(ctx->cond));
+    
+    mutexUnlock(&(ctx->mutex));
+}
+
+bool pipelineAborted(pipeline_ctx_t *ctx)
+{
+    if (!ctx) return true;
+    
+    bool ret;
+    
+    mutexLock(&(ctx->mutex));
+    ret = ctx->abort;
+    mutexUnlock(&(ctx->mutex));
+    
+    return ret;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <switch.h>
+
+#define PIPELINE_SLOT_COUNT         4       // Number of dump block buffers in flight
+#define PIPELINE_MAX_STAGES         4
+#define PIPELINE_MAX_WORKERS        (PIPELINE_MAX_STAGES - 1)
+#define PIPELINE_WORKER_STACK_SIZE  0x10000
+
+// Every slot travels through all stages in order (stage 0 -> stage 1 -> ... -> stage 0 again)
+// Each stage processes slots in the same order they were produced, so data ordering is always preserved
+typedef struct {
+    u8 *data;
+    u64 size;                                       // Valid data size
+    u64 offset;                                     // Output offset for the data held by this slot
+    u64 entry_offset;                               // Offset within the current source entry (IStorage partition, NCA, etc.)
+    u32 entry_idx;                                  // Source entry index
+    bool last;                                      // Set by the producer stage on the last slot
+    bool error;                                     // Set by any stage if it failed to process this slot
+    u8 stage;                                       // Next stage allowed to process this slot
+} pipeline_slot_t;
+
+typedef struct {
+    Mutex mutex;
+    CondVar cond;
+    pipeline_slot_t slots[PIPELINE_SLOT_COUNT];
+    u32 cursors[PIPELINE_MAX_STAGES];
+    u8 stage_cnt;
+    bool abort;
+    Thread workers[PIPELINE_MAX_WORKERS];
+    u8 worker_cnt;
+} pipeline_ctx_t;
+
+bool pipelineInit(pipeline_ctx_t *ctx, u8 stage_cnt, u64 buf_size);
+void pipelineFree(pipeline_ctx_t *ctx);
+
+bool pipelineStartWorker(pipeline_ctx_t *ctx, ThreadFunc func, void *arg);
+void pipelineJoinWorkers(pipeline_ctx_t *ctx);
+
+pipeline_slot_t *pipelineAcquire(pipeline_ctx_t *ctx, u8 stage);
+void pipelineRelease(pipeline_ctx_t *ctx, pipeline_slot_t *slot);
+
+bool pipelineWaitIdle(pipeline_ctx_t *ctx);
+
+void pipelineAbort(pipeline_ctx_t *ctx);
+bool pipelineAborted(pipeline_ctx_t *ctx);
+
+#endif
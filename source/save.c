@@ -18,6 +18,7 @@ extern char strbuf[NAME_BUF_LEN];
 /* Statically allocated variables */
 
 static bool loadedCerts = false, personalizedCertAvailable = false;
+static FILINFO certSaveInfo;
 
 static const char *cert_CA00000003_path = "/certificate/CA00000003";
 static const char *cert_XS00000020_path = "/certificate/XS00000020";
@@ -254,9 +255,41 @@ remap_entry_ctx_t *save_remap_get_map_entry(remap_storage_ctx_t *ctx, u64 offset
     
     if (segment_idx < ctx->header->map_segment_count)
     {
-        for(unsigned int i = 0; i < ctx->segments[segment_idx].entry_count; i++)
+        remap_segment_ctx_t *seg = &(ctx->segments[segment_idx]);
+        remap_entry_ctx_t *entry = ctx->cur_entry;
+        
+        // Reads are mostly sequential: check the last entry we found and the one right after it
+        if (entry && entry->segment == seg)
+        {
+            if (offset >= entry->virtual_offset && offset < entry->virtual_offset_end) return entry;
+            
+            entry = entry->next;
+            if (entry && offset >= entry->virtual_offset && offset < entry->virtual_offset_end)
+            {
+                ctx->cur_entry = entry;
+                return entry;
+            }
+        }
+        
+        // Segment entries are contiguous and sorted by virtual offset, so we can look for the first one that ends past our offset
+        u64 low = 0, high = seg->entry_count;
+        
+        while(low < high)
+        {
+            u64 mid = (low + ((high - low) / 2));
+            
+            if (seg->entries[mid]->virtual_offset_end > offset)
+            {
+                high = mid;
+            } else {
+                low = (mid + 1);
+            }
+        }
+        
+        if (low < seg->entry_count)
         {
-            if (ctx->segments[segment_idx].entries[i]->virtual_offset_end > offset) return ctx->segments[segment_idx].entries[i];
+            ctx->cur_entry = seg->entries[low];
+            return ctx->cur_entry;
         }
     }
     
@@ -332,6 +365,9 @@ u32 save_remap_read(remap_storage_ctx_t *ctx, void *buffer, u64 offset, size_t c
         if (in_pos >= entry->virtual_offset_end) entry = entry->next;
     }
     
+    // The next read will most likely pick up where this one left off
+    if (entry) ctx->cur_entry = entry;
+    
     return out_pos;
 }
 
@@ -546,6 +582,49 @@ size_t save_ivfc_level_fread(ivfc_level_save_ctx_t *ctx, void *buffer, u64 offse
     return count;
 }
 
+/* Hash levels are read 0x20 bytes at a time, and every hash read has to go through all the upper levels. */
+/* Whole blocks are kept around instead, so reading consecutive blocks from the lower level only hits the upper levels once per hash block. */
+static bool save_ivfc_read_cached_hash(integrity_verification_storage_ctx_t *ctx, u8 *hash_buffer, u64 hash_pos, u32 verify)
+{
+    u64 block_index = (hash_pos / ctx->sector_size);
+    u64 block_offset = (block_index * ctx->sector_size);
+    
+    char tmp[NAME_BUF_LEN / 2] = {'\0'};
+    
+    // Don't trust cached blocks that haven't been verified if verification is requested
+    if (!ctx->cached_block_valid || ctx->cached_block_index != block_index || (verify && ctx->block_validities[block_index] != VALIDITY_VALID))
+    {
+        if (!ctx->cached_block)
+        {
+            ctx->cached_block = malloc(ctx->sector_size);
+            if (!ctx->cached_block)
+            {
+                snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for IVFC hash block!", __func__);
+                return false;
+            }
+        }
+        
+        u64 to_read = ((ctx->_length - block_offset) < ctx->sector_size ? (ctx->_length - block_offset) : ctx->sector_size);
+        
+        ctx->cached_block_valid = false;
+        memset(ctx->cached_block, 0, ctx->sector_size);
+        
+        if (!save_ivfc_storage_read(ctx, ctx->cached_block, block_offset, to_read, verify))
+        {
+            snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read IVFC hash block!", __func__);
+            strcat(strbuf, tmp);
+            return false;
+        }
+        
+        ctx->cached_block_index = block_index;
+        ctx->cached_block_valid = true;
+    }
+    
+    memcpy(hash_buffer, ctx->cached_block + (hash_pos - block_offset), 0x20);
+    
+    return true;
+}
+
 bool save_ivfc_storage_read(integrity_verification_storage_ctx_t *ctx, void *buffer, u64 offset, size_t count, u32 verify)
 {
     if (!ctx || !ctx->sector_size || (!ctx->next_level && !ctx->hash_storage && !ctx->base_storage) || !buffer || !count)
@@ -576,7 +655,7 @@ bool save_ivfc_storage_read(integrity_verification_storage_ctx_t *ctx, void *buf
     
     if (ctx->next_level)
     {
-        if (!save_ivfc_storage_read(ctx->next_level, hash_buffer, hash_pos, 0x20, verify))
+        if (!save_ivfc_read_cached_hash(ctx->next_level, hash_buffer, hash_pos, verify))
         {
             snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read hash from next IVFC level!", __func__);
             strcat(strbuf, tmp);
@@ -1718,6 +1797,7 @@ void save_free_contexts(save_ctx_t *ctx)
         
         free(ctx->data_remap_storage.segments);
         ctx->data_remap_storage.segments = NULL;
+        ctx->data_remap_storage.cur_entry = NULL;
     }
     
     if (ctx->data_remap_storage.map_entries)
@@ -1738,6 +1818,7 @@ void save_free_contexts(save_ctx_t *ctx)
         
         free(ctx->meta_remap_storage.segments);
         ctx->meta_remap_storage.segments = NULL;
+        ctx->meta_remap_storage.cur_entry = NULL;
     }
     
     if (ctx->meta_remap_storage.map_entries)
@@ -1798,6 +1879,13 @@ void save_free_contexts(save_ctx_t *ctx)
             free(ctx->core_data_ivfc_storage.integrity_storages[i].block_validities);
             ctx->core_data_ivfc_storage.integrity_storages[i].block_validities = NULL;
         }
+        
+        if (ctx->core_data_ivfc_storage.integrity_storages[i].cached_block)
+        {
+            free(ctx->core_data_ivfc_storage.integrity_storages[i].cached_block);
+            ctx->core_data_ivfc_storage.integrity_storages[i].cached_block = NULL;
+            ctx->core_data_ivfc_storage.integrity_storages[i].cached_block_valid = false;
+        }
     }
     
     if (ctx->core_data_ivfc_storage.level_validities)
@@ -1815,6 +1903,13 @@ void save_free_contexts(save_ctx_t *ctx)
                 free(ctx->fat_ivfc_storage.integrity_storages[i].block_validities);
                 ctx->fat_ivfc_storage.integrity_storages[i].block_validities = NULL;
             }
+            
+            if (ctx->fat_ivfc_storage.integrity_storages[i].cached_block)
+            {
+                free(ctx->fat_ivfc_storage.integrity_storages[i].cached_block);
+                ctx->fat_ivfc_storage.integrity_storages[i].cached_block = NULL;
+                ctx->fat_ivfc_storage.integrity_storages[i].cached_block_valid = false;
+            }
         }
     }
     
@@ -1831,11 +1926,29 @@ void save_free_contexts(save_ctx_t *ctx)
     }
 }
 
-bool readCertsFromSystemSave()
+void save_enable_fast_seek(FIL *file)
 {
-    if (loadedCerts) return true;
+    if (!file) return;
+    
+    save_file_t *save_file = (save_file_t*)file;
     
+    save_file->clmt[0] = SAVE_FILE_CLMT_ENTRY_CNT;
+    file->cltbl = save_file->clmt;
+    
+    if (f_lseek(file, CREATE_LINKMAP) != FR_OK) file->cltbl = NULL;
+}
+
+bool readCertsFromSystemSave()
+{
     FRESULT fr = FR_OK;
+    FILINFO curCertSaveInfo;
+    
+    // Only read the certificates again if the savefile has been modified since we last loaded them
+    bool statSave = (f_stat(BIS_CERT_SAVE_NAME, &curCertSaveInfo) == FR_OK);
+    if (loadedCerts && (!statSave || (curCertSaveInfo.fsize == certSaveInfo.fsize && curCertSaveInfo.fdate == certSaveInfo.fdate && curCertSaveInfo.ftime == certSaveInfo.ftime))) return true;
+    
+    loadedCerts = personalizedCertAvailable = false;
+    
     FIL *certSave = NULL;
     
     save_ctx_t *save_ctx = NULL;
@@ -1852,7 +1965,7 @@ bool readCertsFromSystemSave()
     
     bool success = false, openSave = false, initSaveCtx = false;
     
-    certSave = calloc(1, sizeof(FIL));
+    certSave = calloc(1, sizeof(save_file_t));
     if (!certSave)
     {
         snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: unable to allocate memory for FatFs file descriptor!", __func__);
@@ -1868,6 +1981,8 @@ bool readCertsFromSystemSave()
     
     openSave = true;
     
+    save_enable_fast_seek(certSave);
+    
     save_ctx = calloc(1, sizeof(save_ctx_t));
     if (!save_ctx)
     {
@@ -1977,6 +2092,8 @@ bool readCertsFromSystemSave()
     success = loadedCerts = personalizedCertAvailable = true;
     
 out:
+    if (success && statSave) memcpy(&certSaveInfo, &curCertSaveInfo, sizeof(FILINFO));
+    
     if (save_ctx)
     {
         if (initSaveCtx) save_free_contexts(save_ctx);
@@ -194,6 +194,7 @@ typedef struct {
     u64 base_storage_offset;
     duplex_storage_ctx_t *duplex;
     FIL *file;
+    remap_entry_ctx_t *cur_entry;  // Last map entry found by save_remap_get_map_entry()
 } remap_storage_ctx_t;
 
 typedef struct {
@@ -307,6 +308,9 @@ struct integrity_verification_storage_ctx_t {
     u32 sector_count;
     u64 _length;
     integrity_verification_storage_ctx_t *next_level;
+    u8 *cached_block;  // Last block read from this level while retrieving hashes for the previous one
+    u64 cached_block_index;
+    bool cached_block_valid;
 };
 
 typedef struct {
@@ -473,6 +477,19 @@ static inline u32 save_allocation_table_get_free_list_block_index(allocation_tab
     return allocation_table_entry_index_to_block(save_allocation_table_get_free_list_entry_index(ctx));
 }
 
+#define SAVE_FILE_CLMT_ENTRY_CNT        256                         // Enough for 127 cluster fragments
+
+// FatFs file object with room for its own cluster link map table, used to enable fast seek on BIS savefiles
+// 'fp' must remain the first member: these objects are handled as regular FIL pointers and released with a single free() call
+typedef struct {
+    FIL fp;
+    DWORD clmt[SAVE_FILE_CLMT_ENTRY_CNT];
+} save_file_t;
+
+/* Builds the cluster link map for a savefile opened through a save_file_t object, so f_lseek() no longer has to follow the FAT chain. */
+/* Regular seeking is kept if the file is too fragmented to fit in the table. */
+void save_enable_fast_seek(FIL *file);
+
 bool save_process(save_ctx_t *ctx);
 bool save_process_header(save_ctx_t *ctx);
 void save_free_contexts(save_ctx_t *ctx);
@@ -0,0 +1,317 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "sink.h"
+#include "perf.h"
+#include "ui.h"
+
+/* Extern variables */
+
+extern int breaks;
+extern int font_height;
+
+static bool sinkSendRaw(sink_ctx_t *ctx, const void *buf, u64 size)
+{
+    const u8 *data = (const u8*)buf;
+    
+    if (ctx->target == DUMP_OUTPUT_USB) return (usbCommsWrite(data, size) == size);
+    
+    while(size)
+    {
+        ssize_t sent = send(ctx->connSock, data, size, 0);
+        if (sent <= 0) return false;
+        
+        data += sent;
+        size -= (u64)sent;
+    }
+    
+    return true;
+}
+
+static bool sinkRecvRaw(sink_ctx_t *ctx, void *buf, u64 size)
+{
+    u8 *data = (u8*)buf;
+    
+    if (ctx->target == DUMP_OUTPUT_USB) return (usbCommsRead(data, size) == size);
+    
+    while(size)
+    {
+        ssize_t received = recv(ctx->connSock, data, size, 0);
+        if (received <= 0) return false;
+        
+        data += received;
+        size -= (u64)received;
+    }
+    
+    return true;
+}
+
+static bool sinkSendCommand(sink_ctx_t *ctx, u8 cmd, u8 flags, u64 offset, u64 size, const char *name)
+{
+    sink_cmd_header_t header;
+    memset(&header, 0, sizeof(sink_cmd_header_t));
+    
+    header.magic = SINK_MAGIC;
+    header.version = SINK_PROTOCOL_VERSION;
+    header.cmd = cmd;
+    header.flags = flags;
+    header.name_len = (name ? (u32)strlen(name) : 0);
+    header.offset = offset;
+    header.size = size;
+    
+    if (!sinkSendRaw(ctx, &header, sizeof(sink_cmd_header_t))) return false;
+    if (header.name_len && !sinkSendRaw(ctx, name, header.name_len)) return false;
+    
+    return true;
+}
+
+static bool sinkRecvReply(sink_ctx_t *ctx, sink_cmd_reply_t *reply)
+{
+    if (!sinkRecvRaw(ctx, reply, sizeof(sink_cmd_reply_t))) return false;
+    
+    return (reply->magic == SINK_MAGIC && reply->status == SINK_STATUS_OK);
+}
+
+// Returns true if the user pressed B while we were waiting for the host
+static bool sinkWaitCanceled()
+{
+    scanPads();
+    return ((getButtonsDown() & HidNpadButton_B) != 0);
+}
+
+static bool sinkOpenUsb(sink_ctx_t *ctx)
+{
+    Result result;
+    u64 i;
+    
+    result = usbCommsInitialize();
+    if (R_FAILED(result))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to initialize USB comms interface! (0x%08X)", __func__, result);
+        return false;
+    }
+    
+    ctx->usbInit = true;
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Waiting for the USB host receiver. Press " NINTENDO_FONT_B " to cancel.");
+    uiRefreshDisplay();
+    breaks++;
+    
+    // Check for user input every 100 ms
+    for(i = 0; i < (SINK_CONNECT_TIMEOUT * 10); i++)
+    {
+        result = usbDsWaitReady(100000000ULL);
+        if (R_SUCCEEDED(result)) return true;
+        
+        if (sinkWaitCanceled())
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            return false;
+        }
+    }
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: timed out waiting for the USB host receiver!", __func__);
+    
+    return false;
+}
+
+static bool sinkOpenTcp(sink_ctx_t *ctx)
+{
+    Result result;
+    u64 i;
+    int opt = 1, bufSize = (int)SINK_TCP_SOCKET_BUF_SIZE;
+    struct sockaddr_in addr;
+    struct in_addr hostAddr;
+    struct pollfd pfd;
+    
+    // Dump chunks are way bigger than the default TCP buffers
+    SocketInitConfig cfg = *(socketGetDefaultInitConfig());
+    cfg.tcp_tx_buf_size = SINK_TCP_SOCKET_BUF_SIZE;
+    cfg.tcp_tx_buf_max_size = (SINK_TCP_SOCKET_BUF_SIZE * 4);
+    
+    result = socketInitialize(&cfg);
+    if (R_FAILED(result))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to initialize socket interface! (0x%08X)", __func__, result);
+        return false;
+    }
+    
+    ctx->netInit = true;
+    
+    ctx->listenSock = socket(AF_INET, SOCK_STREAM, 0);
+    if (ctx->listenSock < 0)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to create listening socket!", __func__);
+        return false;
+    }
+    
+    setsockopt(ctx->listenSock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    
+    memset(&addr, 0, sizeof(struct sockaddr_in));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(SINK_TCP_PORT);
+    
+    if (bind(ctx->listenSock, (struct sockaddr*)&addr, sizeof(struct sockaddr_in)) < 0 || listen(ctx->listenSock, 1) < 0)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to listen on TCP port %u!", __func__, SINK_TCP_PORT);
+        return false;
+    }
+    
+    hostAddr.s_addr = (in_addr_t)gethostid();
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Waiting for the host receiver to connect to %s:%u. Press " NINTENDO_FONT_B " to cancel.", inet_ntoa(hostAddr), SINK_TCP_PORT);
+    uiRefreshDisplay();
+    breaks++;
+    
+    pfd.fd = ctx->listenSock;
+    pfd.events = POLLIN;
+    
+    // Check for user input every 100 ms
+    for(i = 0; i < (SINK_CONNECT_TIMEOUT * 10); i++)
+    {
+        pfd.revents = 0;
+        
+        if (poll(&pfd, 1, 100) > 0 && (pfd.revents & POLLIN))
+        {
+            ctx->connSock = accept(ctx->listenSock, NULL, NULL);
+            if (ctx->connSock < 0)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to accept host connection!", __func__);
+                return false;
+            }
+            
+            setsockopt(ctx->connSock, SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof(bufSize));
+            
+            return true;
+        }
+        
+        if (sinkWaitCanceled())
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            return false;
+        }
+    }
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: timed out waiting for the host receiver to connect!", __func__);
+    
+    return false;
+}
+
+bool sinkOpen(sink_ctx_t *ctx, dumpOutputTarget target)
+{
+    if (!ctx || (target != DUMP_OUTPUT_USB && target != DUMP_OUTPUT_TCP))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to open dump output sink!", __func__);
+        return false;
+    }
+    
+    bool success;
+    
+    memset(ctx, 0, sizeof(sink_ctx_t));
+    
+    ctx->target = target;
+    ctx->listenSock = ctx->connSock = -1;
+    
+    success = (target == DUMP_OUTPUT_USB ? sinkOpenUsb(ctx) : sinkOpenTcp(ctx));
+    if (!success) sinkClose(ctx);
+    
+    return success;
+}
+
+bool sinkBeginFile(sink_ctx_t *ctx, const char *filename, u64 fileSize, bool allowResume, u64 *outResumeOffset)
+{
+    if (!ctx || (!ctx->usbInit && ctx->connSock < 0) || ctx->fileOpen || !filename || !strlen(filename) || strlen(filename) > SINK_MAX_FILENAME_LEN || !outResumeOffset)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to start output file transfer!", __func__);
+        return false;
+    }
+    
+    sink_cmd_reply_t reply;
+    memset(&reply, 0, sizeof(sink_cmd_reply_t));
+    
+    if (!sinkSendCommand(ctx, SINK_CMD_FILE_BEGIN, (allowResume ? SINK_FLAG_ALLOW_RESUME : 0), 0, fileSize, filename) || !sinkRecvReply(ctx, &reply))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: host receiver rejected output file \"%s\"! (status %u)", __func__, filename, reply.status);
+        return false;
+    }
+    
+    // A complete (or bigger) file on the host side gets dumped again from scratch
+    *outResumeOffset = ((allowResume && reply.resume_offset < fileSize) ? reply.resume_offset : 0);
+    
+    ctx->fileOpen = true;
+    ctx->fileSize = fileSize;
+    ctx->fileOffset = *outResumeOffset;
+    ctx->fileSent = 0;
+    
+    return true;
+}
+
+size_t sinkWrite(sink_ctx_t *ctx, const void *buf, u64 size)
+{
+    if (!ctx || !ctx->fileOpen || !buf || !size || (ctx->fileOffset + size) > ctx->fileSize) return 0;
+    
+    u64 startTick = perfTick();
+    bool success = (sinkSendCommand(ctx, SINK_CMD_FILE_DATA, 0, ctx->fileOffset, size, NULL) && sinkSendRaw(ctx, buf, size));
+    
+    perfAdd(PERF_STAGE_WRITE, startTick, size);
+    
+    if (!success) return 0;
+    
+    ctx->fileOffset += size;
+    ctx->fileSent += size;
+    
+    return (size_t)size;
+}
+
+size_t sinkWriteAt(sink_ctx_t *ctx, u64 offset, const void *buf, u64 size)
+{
+    if (!ctx || !ctx->fileOpen || !buf || !size || (offset + size) > ctx->fileSize) return 0;
+    
+    u64 startTick = perfTick();
+    bool success = (sinkSendCommand(ctx, SINK_CMD_FILE_DATA, 0, offset, size, NULL) && sinkSendRaw(ctx, buf, size));
+    
+    perfAdd(PERF_STAGE_WRITE, startTick, size);
+    
+    if (!success) return 0;
+    
+    ctx->fileSent += size;
+    
+    return (size_t)size;
+}
+
+bool sinkEndFile(sink_ctx_t *ctx)
+{
+    if (!ctx || !ctx->fileOpen) return false;
+    
+    sink_cmd_reply_t reply;
+    memset(&reply, 0, sizeof(sink_cmd_reply_t));
+    
+    ctx->fileOpen = false;
+    
+    return (sinkSendCommand(ctx, SINK_CMD_FILE_END, 0, ctx->fileOffset, ctx->fileSent, NULL) && sinkRecvReply(ctx, &reply));
+}
+
+void sinkClose(sink_ctx_t *ctx)
+{
+    if (!ctx) return;
+    
+    if (ctx->netInit)
+    {
+        if (ctx->connSock >= 0) close(ctx->connSock);
+        if (ctx->listenSock >= 0) close(ctx->listenSock);
+        
+        socketExit();
+    }
+    
+    if (ctx->usbInit) usbCommsExit();
+    
+    memset(ctx, 0, sizeof(sink_ctx_t));
+    ctx->listenSock = ctx->connSock = -1;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#ifndef __SINK_H__
+#define __SINK_H__
+
+#include <switch.h>
+#include "util.h"
+
+#define SINK_MAGIC                  (u32)0x5444584E                             // "NXDT"
+#define SINK_PROTOCOL_VERSION       1
+
+#define SINK_CMD_FILE_BEGIN         0x01                                        // Header + filename. The host replies with a sink_cmd_reply_t
+#define SINK_CMD_FILE_DATA          0x02                                        // Header + payload. No reply
+#define SINK_CMD_FILE_END           0x03                                        // Header only. The host replies with a sink_cmd_reply_t once all data has been stored
+
+#define SINK_FLAG_ALLOW_RESUME      0x01                                        // FILE_BEGIN: the host may reply with a non-zero resume offset
+
+#define SINK_STATUS_OK              0
+
+#define SINK_MAX_FILENAME_LEN       0x300
+#define SINK_TCP_PORT               27020
+#define SINK_TCP_SOCKET_BUF_SIZE    (u32)0x100000                               // 1 MiB (1048576 bytes)
+#define SINK_CONNECT_TIMEOUT        (u64)60                                     // Seconds to wait for the host
+
+typedef struct {
+    u32 magic;
+    u8 version;
+    u8 cmd;
+    u8 flags;
+    u8 reserved1;
+    u32 name_len;                                                               // FILE_BEGIN: length of the UTF-8 filename that follows the header (no NULL terminator)
+    u32 reserved2;
+    u64 offset;                                                                 // FILE_DATA: output file offset of the payload
+    u64 size;                                                                   // FILE_BEGIN: full output file size / FILE_DATA: payload size / FILE_END: bytes sent for this file
+} PACKED sink_cmd_header_t;
+
+typedef struct {
+    u32 magic;
+    u32 status;                                                                 // SINK_STATUS_OK on success
+    u64 resume_offset;                                                          // FILE_BEGIN: data already stored by the host. Ignored unless SINK_FLAG_ALLOW_RESUME was set
+} PACKED sink_cmd_reply_t;
+
+typedef struct {
+    dumpOutputTarget target;
+    bool usbInit;
+    bool netInit;
+    int listenSock;
+    int connSock;
+    bool fileOpen;
+    u64 fileSize;
+    u64 fileOffset;                                                             // Output file offset for the next FILE_DATA packet
+    u64 fileSent;                                                               // Payload bytes sent in this session
+} sink_ctx_t;
+
+/* Streams dump data to a host receiver over USB (usbComms) or TCP, instead of writing it to the SD card. */
+/* The TCP backend listens on SINK_TCP_PORT and waits for the host to connect. Errors are drawn on screen. */
+bool sinkOpen(sink_ctx_t *ctx, dumpOutputTarget target);
+
+/* Starts a new output file. If allowResume is true, outResumeOffset receives the amount of data the host already has (0 otherwise). */
+bool sinkBeginFile(sink_ctx_t *ctx, const char *filename, u64 fileSize, bool allowResume, u64 *outResumeOffset);
+
+/* Sends the next chunk of the current output file. Returns the number of bytes sent, just like fwrite(). */
+size_t sinkWrite(sink_ctx_t *ctx, const void *buf, u64 size);
+
+/* Sends a chunk of the current output file at an explicit offset, without moving the sequential write position. */
+/* Used to overwrite data that was already sent (e.g. the final PFS0 header of an NSP dump). Returns the number of bytes sent. */
+size_t sinkWriteAt(sink_ctx_t *ctx, u64 offset, const void *buf, u64 size);
+
+/* Finishes the current output file and waits for the host to acknowledge it. */
+bool sinkEndFile(sink_ctx_t *ctx);
+
+void sinkClose(sink_ctx_t *ctx);
+
+#endif
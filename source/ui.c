@@ -18,6 +18,9 @@
 #include "ui.h"
 #include "util.h"
 #include "keys.h"
+#include "benchmark.h"
+#include "nca_store.h"
+#include "nca_cache.h"
 
 /* Extern variables */
 
@@ -61,6 +64,18 @@ static u32 framebuf_width = 0;
 static const u8 bgColors[3] = { BG_COLOR_RGB };
 static const u8 hlBgColors[3] = { HIGHLIGHT_BG_COLOR_RGB };
 
+static ui_glyph_t glyphCache[UI_GLYPH_CACHE_CNT];
+static ui_glyph_atlas_page_t *glyphAtlas = NULL;
+
+static ui_text_run_t textRunCache[UI_TEXT_RUN_CACHE_CNT];
+static u32 textRunCacheSize = 0;
+static u64 textRunCacheTick = 0;
+
+static u32 textRunRecent[UI_TEXT_RUN_RECENT_CNT];
+static u32 textRunRecentIdx = 0;
+
+static RMutex uiFramebufferMutex;
+
 int cursor = 0;
 int scroll = 0;
 int breaks = 0;
@@ -140,12 +155,12 @@ static const char *appControlsRomFs = "[ " NINTENDO_FONT_DPAD " / " NINTENDO_FON
 
 static const char *mainMenuItems[] = { "Dump gamecard content", "Dump installed SD card / eMMC content", "Update options" };
 static const char *gameCardMenuItems[] = { "NX Card Image (XCI) dump", "Nintendo Submission Package (NSP) dump", "HFS0 options", "ExeFS options", "RomFS options", "Dump gamecard certificate" };
-static const char *xciDumpMenuItems[] = { "Start XCI dump process", "Split output dump (FAT32 support): ", "Create directory with archive bit set: ", "Keep certificate: ", "Trim output dump: ", "CRC32 checksum calculation + dump verification: ", "Dump verification method: ", "Output naming scheme: " };
+static const char *xciDumpMenuItems[] = { "Start XCI dump process", "Split output dump (FAT32 support): ", "Create directory with archive bit set: ", "Keep certificate: ", "Trim output dump: ", "CRC32 checksum calculation + dump verification: ", "Dump verification method: ", "Output naming scheme: ", "Output target: ", "Verify HFS0 / NCA header hashes: ", "Compress output dump (LZ4 blocks): " };
 static const char *nspDumpGameCardMenuItems[] = { "Dump base application NSP", "Dump bundled update NSP", "Dump bundled DLC NSP" };
 static const char *nspDumpSdCardEmmcMenuItems[] = { "Dump base application NSP", "Dump installed update NSP", "Dump installed DLC NSP" };
-static const char *nspAppDumpMenuItems[] = { "Start NSP dump process", "Split output dump (FAT32 support): ", "Verify dump using No-Intro database: ", "Remove console specific data: ", "Generate ticket-less dump: ", "Change NPDM RSA key/sig in Program NCA: ", "Base application to dump: ", "Output naming scheme: " };
-static const char *nspPatchDumpMenuItems[] = { "Start NSP dump process", "Split output dump (FAT32 support): ", "Verify dump using No-Intro database: ", "Remove console specific data: ", "Generate ticket-less dump: ", "Change NPDM RSA key/sig in Program NCA: ", "Dump delta fragments: ", "Update to dump: ", "Output naming scheme: " };
-static const char *nspAddOnDumpMenuItems[] = { "Start NSP dump process", "Split output dump (FAT32 support): ", "Verify dump using No-Intro database: ", "Remove console specific data: ", "Generate ticket-less dump: ", "DLC to dump: ", "Output naming scheme: " };
+static const char *nspAppDumpMenuItems[] = { "Start NSP dump process", "Split output dump (FAT32 support): ", "Verify dump using No-Intro database: ", "Remove console specific data: ", "Generate ticket-less dump: ", "Change NPDM RSA key/sig in Program NCA: ", "Base application to dump: ", "Output naming scheme: ", "Compress output dump (LZ4 blocks): ", "Output target: " };
+static const char *nspPatchDumpMenuItems[] = { "Start NSP dump process", "Split output dump (FAT32 support): ", "Verify dump using No-Intro database: ", "Remove console specific data: ", "Generate ticket-less dump: ", "Change NPDM RSA key/sig in Program NCA: ", "Dump delta fragments: ", "Update to dump: ", "Output naming scheme: ", "Compress output dump (LZ4 blocks): ", "Output target: " };
+static const char *nspAddOnDumpMenuItems[] = { "Start NSP dump process", "Split output dump (FAT32 support): ", "Verify dump using No-Intro database: ", "Remove console specific data: ", "Generate ticket-less dump: ", "DLC to dump: ", "Output naming scheme: ", "Compress output dump (LZ4 blocks): ", "Output target: " };
 static const char *hfs0MenuItems[] = { "Raw HFS0 partition dump", "HFS0 partition data dump", "Browse HFS0 partitions" };
 static const char *hfs0PartitionDumpType1MenuItems[] = { "Dump HFS0 partition 0 (Update)", "Dump HFS0 partition 1 (Normal)", "Dump HFS0 partition 2 (Secure)" };
 static const char *hfs0PartitionDumpType2MenuItems[] = { "Dump HFS0 partition 0 (Update)", "Dump HFS0 partition 1 (Logo)", "Dump HFS0 partition 2 (Normal)", "Dump HFS0 partition 3 (Secure)" };
@@ -158,15 +173,17 @@ static const char *romFsMenuItems[] = { "RomFS section data dump", "Browse RomFS
 static const char *romFsSectionDumpMenuItems[] = { "Start RomFS data dump process", "Base application to dump: ", "Use update/DLC: " };
 static const char *romFsSectionBrowserMenuItems[] = { "Browse RomFS section", "Base application to browse: ", "Use update/DLC: " };
 static const char *sdCardEmmcMenuItems[] = { "Nintendo Submission Package (NSP) dump", "ExeFS options", "RomFS options", "Ticket options" };
-static const char *batchModeMenuItems[] = { "Start batch dump process", "Dump base applications: ", "Dump updates: ", "Dump DLCs: ", "Split output dumps (FAT32 support): ", "Remove console specific data: ", "Generate ticket-less dumps: ", "Change NPDM RSA key/sig in Program NCA: ", "Dump delta fragments from updates: ", "Skip already dumped titles: ", "Remember dumped titles: ", "Halt dump process on errors: ", "Output naming scheme: ", "Source storage: " };
+static const char *batchModeMenuItems[] = { "Start batch dump process", "Dump base applications: ", "Dump updates: ", "Dump DLCs: ", "Split output dumps (FAT32 support): ", "Remove console specific data: ", "Generate ticket-less dumps: ", "Change NPDM RSA key/sig in Program NCA: ", "Dump delta fragments from updates: ", "Skip already dumped titles: ", "Remember dumped titles: ", "Halt dump process on errors: ", "Output naming scheme: ", "Source storage: ", "Deduplicate NCAs (NCA store + NSP manifests): " };
 static const char *ticketMenuItems[] = { "Start ticket dump", "Remove console specific data: ", "Use ticket from title: " };
-static const char *updateMenuItems[] = { "Update NSWDB.COM XML database", "Update application" };
+static const char *updateMenuItems[] = { "Update NSWDB.COM XML database", "Update application", "Benchmark dump block sizes", "Keep NCA metadata cache on the SD card: ", "Benchmark parsers and crypto", "Restore compressed dumps (" CMP_FILE_EXTENSION ")", "Rebuild NSPs from manifests (" NSP_MANIFEST_EXTENSION ")", "NCA block cache size: " };
 
 static const char *xciChecksumLookupMethods[] = { "NSWDB.COM XML database (offline)", "No-Intro database lookup (online)" };
 
 static const char *xciNamingSchemes[] = { "TitleName v[TitleVersion] ([TitleID])", "TitleName [[TitleID]][v[TitleVersion]]" };
 static const char *nspNamingSchemes[] = { "TitleName v[TitleVersion] ([TitleID]) ([TitleType])", "TitleName [[TitleID]][v[TitleVersion]][[TitleType]]" };
 
+static const char *dumpOutputTargets[] = { "SD card", "USB host receiver", "Network host receiver (TCP)" };
+
 void uiFill(int x, int y, int width, int height, u8 r, u8 g, u8 b)
 {
     /* Perform validity checks */
@@ -188,6 +205,8 @@ void uiFill(int x, int y, int width, int height, u8 r, u8 g, u8 b)
     
 	if ((y + height) >= FB_HEIGHT) height = (FB_HEIGHT - y);
     
+    uiLockFramebuffer();
+    
     if (framebuf == NULL)
     {
         /* Begin new frame */
@@ -197,18 +216,15 @@ void uiFill(int x, int y, int width, int height, u8 r, u8 g, u8 b)
     }
     
     int lx, ly;
-    u32 framex, framey;
+    u32 color = RGBA8_MAXALPHA(r, g, b);
+    u32 *firstRow = &(framebuf[((u32)y * framebuf_width) + (u32)x]);
     
-    for (ly = 0; ly < height; ly++)
-    {
-        for (lx = 0; lx < width; lx++)
-        {
-            framex = (u32)(x + lx);
-            framey = (u32)(y + ly);
-            
-            framebuf[(framey * framebuf_width) + framex] = RGBA8_MAXALPHA(r, g, b);
-        }
-    }
+    /* Fill the first row and copy it to the rest */
+    for(lx = 0; lx < width; lx++) firstRow[lx] = color;
+    
+    for(ly = 1; ly < height; ly++) memcpy(firstRow + ((u32)ly * framebuf_width), firstRow, (u32)width * sizeof(u32));
+    
+    uiUnlockFramebuffer();
 }
 
 void uiDrawIcon(const u8 *icon, int width, int height, int x, int y)
@@ -232,6 +248,8 @@ void uiDrawIcon(const u8 *icon, int width, int height, int x, int y)
     
 	if ((y + height) >= FB_HEIGHT) height = (FB_HEIGHT - y);
     
+    uiLockFramebuffer();
+    
     if (framebuf == NULL)
     {
         /* Begin new frame */
@@ -255,13 +273,15 @@ void uiDrawIcon(const u8 *icon, int width, int height, int x, int y)
             framebuf[(framey * framebuf_width) + framex] = RGBA8_MAXALPHA(icon[pos], icon[pos + 1], icon[pos + 2]);
         }
     }
+    
+    uiUnlockFramebuffer();
 }
 
-bool uiLoadJpgFromMem(u8 *rawJpg, size_t rawJpgSize, int expectedWidth, int expectedHeight, int desiredWidth, int desiredHeight, u8 **outBuf)
+bool uiLoadJpgFromMemEx(u8 *rawJpg, size_t rawJpgSize, int expectedWidth, int expectedHeight, int desiredWidth, int desiredHeight, u8 **outBuf, char *errorBuf, size_t errorBufSize)
 {
     if (!rawJpg || !rawJpgSize || !expectedWidth || !expectedHeight || !desiredWidth || !desiredHeight || !outBuf)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to process JPG image buffer!", __func__);
+        snprintf(errorBuf, errorBufSize, "%s: invalid parameters to process JPG image buffer!", __func__);
         return false;
     }
     
@@ -278,27 +298,27 @@ bool uiLoadJpgFromMem(u8 *rawJpg, size_t rawJpgSize, int expectedWidth, int expe
     _jpegDecompressor = tjInitDecompress();
     if (!_jpegDecompressor)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: tjInitDecompress failed!", __func__);
+        snprintf(errorBuf, errorBufSize, "%s: tjInitDecompress failed!", __func__);
         return success;
     }
     
     ret = tjDecompressHeader2(_jpegDecompressor, rawJpg, rawJpgSize, &w, &h, &samp);
     if (ret == -1)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: tjDecompressHeader2 failed! (%d)", __func__, ret);
+        snprintf(errorBuf, errorBufSize, "%s: tjDecompressHeader2 failed! (%d)", __func__, ret);
         goto out;
     }
     
     if (w != expectedWidth || h != expectedHeight)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid image width/height!", __func__);
+        snprintf(errorBuf, errorBufSize, "%s: invalid image width/height!", __func__);
         goto out;
     }
     
     scalingFactors = tjGetScalingFactors(&numScalingFactors);
     if (!scalingFactors)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: unable to retrieve scaling factors!", __func__);
+        snprintf(errorBuf, errorBufSize, "%s: unable to retrieve scaling factors!", __func__);
         goto out;
     }
     
@@ -313,7 +333,7 @@ bool uiLoadJpgFromMem(u8 *rawJpg, size_t rawJpgSize, int expectedWidth, int expe
     
     if (!foundScalingFactor)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: unable to find a valid scaling factor!", __func__);
+        snprintf(errorBuf, errorBufSize, "%s: unable to find a valid scaling factor!", __func__);
         goto out;
     }
     
@@ -322,7 +342,7 @@ bool uiLoadJpgFromMem(u8 *rawJpg, size_t rawJpgSize, int expectedWidth, int expe
     jpgScaledBuf = malloc(pitch * desiredHeight);
     if (!jpgScaledBuf)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: unable to allocate memory for the scaled RGB image output!", __func__);
+        snprintf(errorBuf, errorBufSize, "%s: unable to allocate memory for the scaled RGB image output!", __func__);
         goto out;
     }
     
@@ -330,7 +350,7 @@ bool uiLoadJpgFromMem(u8 *rawJpg, size_t rawJpgSize, int expectedWidth, int expe
     if (ret == -1)
     {
         free(jpgScaledBuf);
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: tjDecompress2 failed! (%d)", __func__, ret);
+        snprintf(errorBuf, errorBufSize, "%s: tjDecompress2 failed! (%d)", __func__, ret);
         goto out;
     }
     
@@ -343,6 +363,11 @@ out:
     return success;
 }
 
+bool uiLoadJpgFromMem(u8 *rawJpg, size_t rawJpgSize, int expectedWidth, int expectedHeight, int desiredWidth, int desiredHeight, u8 **outBuf)
+{
+    return uiLoadJpgFromMemEx(rawJpg, rawJpgSize, expectedWidth, expectedHeight, desiredWidth, desiredHeight, outBuf, strbuf, MAX_CHARACTERS(strbuf));
+}
+
 bool uiLoadJpgFromFile(const char *filename, int expectedWidth, int expectedHeight, int desiredWidth, int desiredHeight, u8 **outBuf)
 {
     if (!filename || !desiredWidth || !desiredHeight || !outBuf)
@@ -398,51 +423,415 @@ bool uiLoadJpgFromFile(const char *filename, int expectedWidth, int expectedHeig
     return ret;
 }
 
-void uiDrawChar(FT_Bitmap *bitmap, int x, int y, u8 r, u8 g, u8 b)
+static u8 *uiGlyphAtlasAlloc(u32 size)
 {
-    if (framebuf == NULL) return;
+    if (!size || size > UI_GLYPH_ATLAS_PAGE_SIZE) return NULL;
     
-    u32 framex, framey, framebuf_offset;
-    u32 tmpx, tmpy;
-    u8 *imageptr = bitmap->buffer;
+    if (!glyphAtlas || (glyphAtlas->used + size) > UI_GLYPH_ATLAS_PAGE_SIZE)
+    {
+        ui_glyph_atlas_page_t *page = malloc(sizeof(ui_glyph_atlas_page_t) + UI_GLYPH_ATLAS_PAGE_SIZE);
+        if (!page) return NULL;
+        
+        page->next = glyphAtlas;
+        page->used = 0;
+        glyphAtlas = page;
+    }
     
-    u8 src_val;
-    float opacity;
+    u8 *ptr = (glyphAtlas->data + glyphAtlas->used);
+    glyphAtlas->used += size;
     
-    u8 fontR, fontG, fontB;
+    return ptr;
+}
+
+/* Returns the cached glyph for the provided codepoint, loading and rendering it with FreeType if needed */
+/* If it can't be cached, the glyph is stored in scratch (with valid set to false), and its bitmap is only valid until the next FreeType call */
+static const ui_glyph_t *uiGetGlyph(u32 codepoint, ui_glyph_t *scratch)
+{
+    u32 i, j, idx = ((codepoint * 2654435761U) & (UI_GLYPH_CACHE_CNT - 1));
+    ui_glyph_t *entry = NULL;
     
-    if (bitmap->pixel_mode != FT_PIXEL_MODE_GRAY) return;
+    FT_Error ret = 0;
+    FT_UInt glyph_index = 0;
+    FT_GlyphSlot slot = NULL;
     
-    for(tmpy = 0; tmpy < bitmap->rows; tmpy++)
+    for(i = 0; i < UI_GLYPH_CACHE_CNT; i++)
     {
-        for (tmpx = 0; tmpx < bitmap->width; tmpx++)
+        ui_glyph_t *cur = &(glyphCache[(idx + i) & (UI_GLYPH_CACHE_CNT - 1)]);
+        
+        if (!cur->valid)
         {
-            framex = (x + tmpx);
-            framey = (y + tmpy);
-            
-            if (framex >= FB_WIDTH || framey >= FB_HEIGHT) continue;
+            entry = cur;
+            break;
+        }
+        
+        if (cur->codepoint == codepoint) return cur;
+    }
+    
+    for(j = 0; j < PlSharedFontType_Total; j++)
+    {
+        glyph_index = FT_Get_Char_Index(sharedFontsFaces[j], codepoint);
+        if (glyph_index) break;
+    }
+    
+    if (!glyph_index && j == PlSharedFontType_Total) j = 0;
+    
+    ret = FT_Load_Glyph(sharedFontsFaces[j], glyph_index, FT_LOAD_DEFAULT);
+    if (ret == 0) ret = FT_Render_Glyph(sharedFontsFaces[j]->glyph, FT_RENDER_MODE_NORMAL);
+    
+    if (ret) return NULL;
+    
+    slot = sharedFontsFaces[j]->glyph;
+    
+    bool gray = (slot->bitmap.pixel_mode == FT_PIXEL_MODE_GRAY);
+    u32 width = (gray ? slot->bitmap.width : 0);
+    u32 rows = (gray ? slot->bitmap.rows : 0);
+    u8 *bitmap = NULL;
+    
+    if (entry && width && rows)
+    {
+        bitmap = uiGlyphAtlasAlloc(width * rows);
+        if (!bitmap) entry = NULL;
+    }
+    
+    if (!entry) entry = scratch;
+    
+    entry->codepoint = codepoint;
+    entry->face = (u8)j;
+    entry->valid = (entry != scratch);
+    entry->left = (s16)slot->bitmap_left;
+    entry->top = (s16)slot->bitmap_top;
+    entry->width = (u16)width;
+    entry->rows = (u16)rows;
+    entry->advance_x = (s16)(slot->advance.x >> 6);
+    entry->advance_y = (s16)(slot->advance.y >> 6);
+    
+    if (bitmap)
+    {
+        /* Store the bitmap without its row padding */
+        for(i = 0; i < rows; i++) memcpy(bitmap + (i * width), slot->bitmap.buffer + (i * slot->bitmap.pitch), width);
+        
+        entry->pitch = (u16)width;
+        entry->bitmap = bitmap;
+    } else {
+        entry->pitch = (u16)(gray ? slot->bitmap.pitch : 0);
+        entry->bitmap = (entry == scratch ? slot->bitmap.buffer : NULL);
+    }
+    
+    return entry;
+}
+
+/* Draws a glyph into dst, which covers a (dstWidth x dstHeight) area starting at (originX, originY) */
+/* Zero alpha pixels are filled with the background color, just like the rest of the glyph cell. Covered pixels are flagged in mask, if provided */
+static void uiDrawGlyph(const ui_glyph_t *glyph, int x, int y, u8 r, u8 g, u8 b, u32 *dst, u32 dstStride, u8 *mask, int originX, int originY, int dstWidth, int dstHeight)
+{
+    if (!glyph || !glyph->bitmap || !dst) return;
+    
+    int fx, fy;
+    u32 tmpx, tmpy, dst_offset;
+    const u8 *imageptr = glyph->bitmap;
+    
+    const u8 *bg = (highlight ? hlBgColors : bgColors);
+    const u32 bgPixel = RGBA8_MAXALPHA(bg[0], bg[1], bg[2]);
+    
+    u32 alpha;
+    u8 fontR, fontG, fontB;
+    
+    for(tmpy = 0; tmpy < glyph->rows; tmpy++, imageptr += glyph->pitch)
+    {
+        fy = (y + (int)tmpy - originY);
+        if (fy < 0 || fy >= dstHeight) continue;
+        
+        for(tmpx = 0; tmpx < glyph->width; tmpx++)
+        {
+            fx = (x + (int)tmpx - originX);
+            if (fx < 0 || fx >= dstWidth) continue;
             
-            framebuf_offset = ((framey * framebuf_width) + framex);
+            dst_offset = (((u32)fy * dstStride) + (u32)fx);
             
-            src_val = imageptr[tmpx];
-            if (!src_val)
+            alpha = imageptr[tmpx];
+            if (!alpha)
             {
                 /* Render background color */
-                framebuf[framebuf_offset] = (highlight ? RGBA8_MAXALPHA(hlBgColors[0], hlBgColors[1], hlBgColors[2]) : RGBA8_MAXALPHA(bgColors[0], bgColors[1], bgColors[2]));
+                dst[dst_offset] = bgPixel;
             } else {
-                /* Calculate alpha (opacity) */
-                opacity = (src_val / 255.0);
-                
-                fontR = (r * opacity + (1 - opacity) * (highlight ? hlBgColors[0] : bgColors[0]));
-                fontG = (g * opacity + (1 - opacity) * (highlight ? hlBgColors[1] : bgColors[1]));
-                fontB = (b * opacity + (1 - opacity) * (highlight ? hlBgColors[2] : bgColors[2]));
+                fontR = (u8)(((r * alpha) + (bg[0] * (255 - alpha))) / 255);
+                fontG = (u8)(((g * alpha) + (bg[1] * (255 - alpha))) / 255);
+                fontB = (u8)(((b * alpha) + (bg[2] * (255 - alpha))) / 255);
                 
-                framebuf[framebuf_offset] = RGBA8_MAXALPHA(fontR, fontG, fontB);
+                dst[dst_offset] = RGBA8_MAXALPHA(fontR, fontG, fontB);
+            }
+            
+            if (mask) mask[dst_offset] = 1;
+        }
+    }
+}
+
+static u32 uiTextRunHash(const char *string, int x, int y, u8 r, u8 g, u8 b)
+{
+    /* FNV-1a */
+    u32 hash = 2166136261U;
+    const u8 *ptr = (const u8*)string;
+    
+    while(*ptr)
+    {
+        hash ^= *ptr++;
+        hash *= 16777619U;
+    }
+    
+    u32 params[3] = { (u32)x, (u32)y, (((u32)r << 24) | ((u32)g << 16) | ((u32)b << 8) | (highlight ? 1 : 0)) };
+    
+    for(u32 i = 0; i < 3; i++)
+    {
+        hash ^= params[i];
+        hash *= 16777619U;
+    }
+    
+    return hash;
+}
+
+static ui_text_run_t *uiFindTextRun(const char *string, u32 hash, int x, int y, u8 r, u8 g, u8 b)
+{
+    for(u32 i = 0; i < UI_TEXT_RUN_CACHE_CNT; i++)
+    {
+        ui_text_run_t *run = &(textRunCache[i]);
+        
+        if (!run->spans || run->hash != hash || run->x != x || run->y != y || run->highlight != highlight) continue;
+        if (run->rgb[0] != r || run->rgb[1] != g || run->rgb[2] != b || strcmp(run->string, string) != 0) continue;
+        
+        return run;
+    }
+    
+    return NULL;
+}
+
+/* Progress strings change on every redraw, so we only spend memory on strings that were drawn more than once */
+static bool uiTextRunSeenRecently(u32 hash)
+{
+    for(u32 i = 0; i < UI_TEXT_RUN_RECENT_CNT; i++)
+    {
+        if (textRunRecent[i] == hash) return true;
+    }
+    
+    textRunRecent[textRunRecentIdx] = hash;
+    textRunRecentIdx = ((textRunRecentIdx + 1) % UI_TEXT_RUN_RECENT_CNT);
+    
+    return false;
+}
+
+static void uiFreeTextRun(ui_text_run_t *run)
+{
+    if (!run || !run->spans) return;
+    
+    textRunCacheSize -= run->size;
+    free(run->spans);
+    memset(run, 0, sizeof(ui_text_run_t));
+}
+
+/* Precomposites a single line string into a set of framebuffer pixel spans */
+/* Returns NULL if the string can't be cached (line breaks, wrapping or glyphs that didn't fit in the glyph cache) */
+static ui_text_run_t *uiBuildTextRun(const char *string, u32 hash, int x, int y, u8 r, u8 g, u8 b)
+{
+    u32 i, pass, tmpchar, str_size = strlen(string);
+    int tmpx, tmpy;
+    ssize_t unitcount = 0;
+    
+    int minX = FB_WIDTH, minY = FB_HEIGHT, maxX = 0, maxY = 0;
+    int boxWidth = 0, boxHeight = 0;
+    
+    u32 *pixels = NULL;
+    u8 *mask = NULL;
+    
+    u32 spanCnt = 0, pixelCnt = 0, size = 0;
+    ui_text_run_t *run = NULL;
+    
+    ui_glyph_t scratch;
+    const ui_glyph_t *glyph = NULL;
+    
+    /* First pass: bounding box. Second pass: render into the temporary buffer */
+    for(pass = 0; pass < 2; pass++)
+    {
+        tmpx = (x < 8 ? 8 : x);
+        tmpy = (font_height + (y < 8 ? 8 : y));
+        
+        for(i = 0; i < str_size;)
+        {
+            unitcount = decode_utf8(&tmpchar, (const u8*)&string[i]);
+            if (unitcount <= 0) break;
+            i += unitcount;
+            
+            if (tmpchar == '\n') goto out;
+            
+            if (tmpchar == '\t')
+            {
+                tmpx += (font_height * TAB_WIDTH);
+                continue;
+            } else
+            if (tmpchar == '\r')
+            {
+                continue;
+            }
+            
+            glyph = uiGetGlyph(tmpchar, &scratch);
+            if (!glyph || !glyph->valid) goto out;
+            
+            if ((tmpx + glyph->advance_x) > (FB_WIDTH - 8)) goto out;
+            
+            int gx = (tmpx + glyph->left), gy = (tmpy - glyph->top);
+            
+            if (!pass)
+            {
+                if (glyph->width && glyph->rows)
+                {
+                    if (gx < minX) minX = gx;
+                    if (gy < minY) minY = gy;
+                    if ((gx + glyph->width) > maxX) maxX = (gx + glyph->width);
+                    if ((gy + glyph->rows) > maxY) maxY = (gy + glyph->rows);
+                }
+            } else {
+                uiDrawGlyph(glyph, gx, gy, r, g, b, pixels, (u32)boxWidth, mask, minX, minY, boxWidth, boxHeight);
+            }
+            
+            tmpx += glyph->advance_x;
+            tmpy += glyph->advance_y;
+        }
+        
+        if (!pass)
+        {
+            /* Clip the bounding box against the framebuffer */
+            if (minX < 0) minX = 0;
+            if (minY < 0) minY = 0;
+            if (maxX > FB_WIDTH) maxX = FB_WIDTH;
+            if (maxY > FB_HEIGHT) maxY = FB_HEIGHT;
+            
+            boxWidth = (maxX > minX ? (maxX - minX) : 0);
+            boxHeight = (maxY > minY ? (maxY - minY) : 0);
+            
+            if (!boxWidth || !boxHeight) break;
+            
+            if (((u64)boxWidth * (u64)boxHeight * sizeof(u32)) > (UI_TEXT_RUN_CACHE_BUDGET / 16)) goto out;
+            
+            pixels = malloc((u32)(boxWidth * boxHeight) * sizeof(u32));
+            mask = calloc((u32)(boxWidth * boxHeight), sizeof(u8));
+            if (!pixels || !mask) goto out;
+        }
+    }
+    
+    /* Collect the covered pixel spans, row by row */
+    for(int ly = 0; ly < boxHeight; ly++)
+    {
+        for(int lx = 0; lx < boxWidth; lx++)
+        {
+            if (!mask[(ly * boxWidth) + lx]) continue;
+            if (!lx || !mask[(ly * boxWidth) + lx - 1]) spanCnt++;
+            pixelCnt++;
+        }
+    }
+    
+    size = ((spanCnt * sizeof(ui_text_span_t)) + (pixelCnt * sizeof(u32)) + str_size + 1);
+    
+    /* Evict the least recently used runs until the new one fits */
+    while(true)
+    {
+        ui_text_run_t *lru = NULL;
+        run = NULL;
+        
+        for(i = 0; i < UI_TEXT_RUN_CACHE_CNT; i++)
+        {
+            if (!textRunCache[i].spans)
+            {
+                if (!run) run = &(textRunCache[i]);
+                continue;
             }
+            
+            if (!lru || textRunCache[i].lastUse < lru->lastUse) lru = &(textRunCache[i]);
         }
         
-        imageptr += bitmap->pitch;
+        if (run && (textRunCacheSize + size) <= UI_TEXT_RUN_CACHE_BUDGET) break;
+        
+        if (!lru)
+        {
+            run = NULL;
+            goto out;
+        }
+        
+        uiFreeTextRun(lru);
     }
+    
+    run->spans = malloc(size);
+    if (!run->spans)
+    {
+        run = NULL;
+        goto out;
+    }
+    
+    run->pixels = (u32*)((u8*)run->spans + (spanCnt * sizeof(ui_text_span_t)));
+    run->string = ((char*)run->pixels + (pixelCnt * sizeof(u32)));
+    memcpy((char*)run->string, string, str_size + 1);
+    
+    run->hash = hash;
+    run->x = x;
+    run->y = y;
+    run->rgb[0] = r;
+    run->rgb[1] = g;
+    run->rgb[2] = b;
+    run->highlight = highlight;
+    run->spanCnt = spanCnt;
+    run->size = size;
+    
+    textRunCacheSize += size;
+    
+    spanCnt = pixelCnt = 0;
+    
+    for(int ly = 0; ly < boxHeight; ly++)
+    {
+        for(int lx = 0; lx < boxWidth; lx++)
+        {
+            u32 offset = (u32)((ly * boxWidth) + lx);
+            if (!mask[offset]) continue;
+            
+            if (!lx || !mask[offset - 1])
+            {
+                run->spans[spanCnt].x = (u16)(minX + lx);
+                run->spans[spanCnt].y = (u16)(minY + ly);
+                run->spans[spanCnt].len = 0;
+                run->spans[spanCnt].offset = pixelCnt;
+                spanCnt++;
+            }
+            
+            run->spans[spanCnt - 1].len++;
+            run->pixels[pixelCnt++] = pixels[offset];
+        }
+    }
+    
+out:
+    if (mask) free(mask);
+    if (pixels) free(pixels);
+    
+    return run;
+}
+
+static void uiBlitTextRun(const ui_text_run_t *run)
+{
+    for(u32 i = 0; i < run->spanCnt; i++)
+    {
+        const ui_text_span_t *span = &(run->spans[i]);
+        memcpy(&(framebuf[(span->y * framebuf_width) + span->x]), &(run->pixels[span->offset]), span->len * sizeof(u32));
+    }
+}
+
+static void uiFreeTextCaches()
+{
+    for(u32 i = 0; i < UI_TEXT_RUN_CACHE_CNT; i++) uiFreeTextRun(&(textRunCache[i]));
+    
+    while(glyphAtlas)
+    {
+        ui_glyph_atlas_page_t *next = glyphAtlas->next;
+        free(glyphAtlas);
+        glyphAtlas = next;
+    }
+    
+    memset(glyphCache, 0, sizeof(glyphCache));
+    memset(textRunRecent, 0, sizeof(textRunRecent));
 }
 
 void uiDrawString(int x, int y, u8 r, u8 g, u8 b, const char *fmt, ...)
@@ -456,17 +845,20 @@ void uiDrawString(int x, int y, u8 r, u8 g, u8 b, const char *fmt, ...)
     vsnprintf(string, MAX_CHARACTERS(string), fmt, args);
     va_end(args);
     
-    u32 tmpx = (x < 8 ? 8 : x);
-    u32 tmpy = (font_height + (y < 8 ? 8 : y));
-    
-    FT_Error ret = 0;
-    FT_UInt glyph_index = 0;
+    int tmpx = (x < 8 ? 8 : x);
+    int tmpy = (font_height + (y < 8 ? 8 : y));
     
-    u32 i, j;
+    u32 i;
     u32 str_size = strlen(string);
     u32 tmpchar;
     ssize_t unitcount = 0;
     
+    ui_glyph_t scratch;
+    const ui_glyph_t *glyph = NULL;
+    ui_text_run_t *run = NULL;
+    
+    uiLockFramebuffer();
+    
     if (framebuf == NULL)
     {
         /* Begin new frame */
@@ -475,6 +867,23 @@ void uiDrawString(int x, int y, u8 r, u8 g, u8 b, const char *fmt, ...)
         framebuf_width = (stride / sizeof(u32));
     }
     
+    /* Unchanged single line strings are blitted from the text run cache */
+    if (!strchr(string, '\n'))
+    {
+        u32 hash = uiTextRunHash(string, x, y, r, g, b);
+        
+        run = uiFindTextRun(string, hash, x, y, r, g, b);
+        if (!run && uiTextRunSeenRecently(hash)) run = uiBuildTextRun(string, hash, x, y, r, g, b);
+        
+        if (run)
+        {
+            run->lastUse = ++textRunCacheTick;
+            uiBlitTextRun(run);
+            uiUnlockFramebuffer();
+            return;
+        }
+    }
+    
     for(i = 0; i < str_size;)
     {
         unitcount = decode_utf8(&tmpchar, (const u8*)&string[i]);
@@ -498,31 +907,23 @@ void uiDrawString(int x, int y, u8 r, u8 g, u8 b, const char *fmt, ...)
             continue;
         }
         
-        for(j = 0; j < PlSharedFontType_Total; j++)
-        {
-            glyph_index = FT_Get_Char_Index(sharedFontsFaces[j], tmpchar);
-            if (glyph_index) break;
-        }
-        
-        if (!glyph_index && j == PlSharedFontType_Total) j = 0;
-        
-        ret = FT_Load_Glyph(sharedFontsFaces[j], glyph_index, FT_LOAD_DEFAULT);
-        if (ret == 0) ret = FT_Render_Glyph(sharedFontsFaces[j]->glyph, FT_RENDER_MODE_NORMAL);
+        glyph = uiGetGlyph(tmpchar, &scratch);
+        if (!glyph) break;
         
-        if (ret) break;
-        
-        if ((tmpx + (sharedFontsFaces[j]->glyph->advance.x >> 6)) > (FB_WIDTH - 8))
+        if ((tmpx + glyph->advance_x) > (FB_WIDTH - 8))
         {
             tmpx = 8;
             tmpy += LINE_HEIGHT;
             breaks++;
         }
         
-        uiDrawChar(&(sharedFontsFaces[j]->glyph->bitmap), tmpx + sharedFontsFaces[j]->glyph->bitmap_left, tmpy - sharedFontsFaces[j]->glyph->bitmap_top, r, g, b);
+        uiDrawGlyph(glyph, tmpx + glyph->left, tmpy - glyph->top, r, g, b, framebuf, framebuf_width, NULL, 0, 0, FB_WIDTH, FB_HEIGHT);
         
-        tmpx += (sharedFontsFaces[j]->glyph->advance.x >> 6);
-        tmpy += (sharedFontsFaces[j]->glyph->advance.y >> 6);
+        tmpx += glyph->advance_x;
+        tmpy += glyph->advance_y;
     }
+    
+    uiUnlockFramebuffer();
 }
 
 u32 uiGetStrWidth(const char *fmt, ...)
@@ -536,15 +937,18 @@ u32 uiGetStrWidth(const char *fmt, ...)
     vsnprintf(string, MAX_CHARACTERS(string), fmt, args);
     va_end(args);
     
-    FT_Error ret = 0;
-    FT_UInt glyph_index = 0;
-    
-    u32 i, j;
+    u32 i;
     u32 str_size = strlen(string);
     u32 tmpchar;
     ssize_t unitcount = 0;
     u32 width = 0;
     
+    ui_glyph_t scratch;
+    const ui_glyph_t *glyph = NULL;
+    
+    // The glyph cache is shared with uiDrawString()
+    uiLockFramebuffer();
+    
     for(i = 0; i < str_size;)
     {
         unitcount = decode_utf8(&tmpchar, (const u8*)&string[i]);
@@ -561,33 +965,39 @@ u32 uiGetStrWidth(const char *fmt, ...)
             continue;
         }
         
-        for(j = 0; j < PlSharedFontType_Total; j++)
-        {
-            glyph_index = FT_Get_Char_Index(sharedFontsFaces[j], tmpchar);
-            if (glyph_index) break;
-        }
-        
-        if (!glyph_index && j == PlSharedFontType_Total) j = 0;
-        
-        ret = FT_Load_Glyph(sharedFontsFaces[j], glyph_index, FT_LOAD_DEFAULT);
-        if (ret == 0) ret = FT_Render_Glyph(sharedFontsFaces[j]->glyph, FT_RENDER_MODE_NORMAL);
-        
-        if (ret) break;
+        glyph = uiGetGlyph(tmpchar, &scratch);
+        if (!glyph) break;
         
-        width += (sharedFontsFaces[j]->glyph->advance.x >> 6);
+        width += glyph->advance_x;
     }
     
+    uiUnlockFramebuffer();
+    
     return width;
 }
 
+void uiLockFramebuffer()
+{
+    rmutexLock(&uiFramebufferMutex);
+}
+
+void uiUnlockFramebuffer()
+{
+    rmutexUnlock(&uiFramebufferMutex);
+}
+
 void uiRefreshDisplay()
 {
+    uiLockFramebuffer();
+    
     if (framebuf != NULL)
     {
         framebufferEnd(&fb);
         framebuf = NULL;
         framebuf_width = 0;
     }
+    
+    uiUnlockFramebuffer();
 }
 
 void uiStatusMsg(const char *fmt, ...)
@@ -882,6 +1292,9 @@ void uiDeinit()
     /* Unmount Application's RomFS */
     if (romfs_init) romfsExit();
     
+    /* Free glyph and text run caches */
+    uiFreeTextCaches();
+    
     /* Free FreeType resources */
     for(u32 i = 0; i < PlSharedFontType_Total; i++)
     {
@@ -1206,9 +1619,17 @@ UIResult uiProcess()
             startYPos = ypos;
             
             /* Draw icon */
-            if (baseAppEntries[selectedAppInfoIndex].icon != NULL)
+            requestTitleIcons(selectedAppInfoIndex, 1);
+            
+            if (baseAppEntries[selectedAppInfoIndex].icon != NULL || baseAppEntries[selectedAppInfoIndex].iconState != TITLE_ICON_STATE_FAILED)
             {
-                uiDrawIcon(baseAppEntries[selectedAppInfoIndex].icon, NACP_ICON_DOWNSCALED, NACP_ICON_DOWNSCALED, xpos, ypos);
+                if (baseAppEntries[selectedAppInfoIndex].icon != NULL)
+                {
+                    uiDrawIcon(baseAppEntries[selectedAppInfoIndex].icon, NACP_ICON_DOWNSCALED, NACP_ICON_DOWNSCALED, xpos, ypos);
+                } else {
+                    uiFill(xpos, ypos, NACP_ICON_DOWNSCALED, NACP_ICON_DOWNSCALED, ICON_PLACEHOLDER_COLOR_RGB);
+                }
+                
                 xpos += (NACP_ICON_DOWNSCALED + 8);
                 ypos += 8;
             }
@@ -1272,6 +1693,9 @@ UIResult uiProcess()
             
             breaks += (int)round((double)(ypos - startYPos) / (double)LINE_HEIGHT);
             
+            // Content sizes are calculated on demand
+            loadTitleContentSize(NcmContentMetaType_Application, selectedAppInfoIndex);
+            
             if (menuType == MENUTYPE_GAMECARD)
             {
                 uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Capacity: %s | Used space: %s", gameCardInfo.sizeStr, gameCardInfo.trimmedSizeStr);
@@ -1500,6 +1924,13 @@ UIResult uiProcess()
                 breaks++;
             }
             
+            if (orphanEntries[orphanListCursor].type == ORPHAN_ENTRY_TYPE_PATCH)
+            {
+                loadTitleContentSize(NcmContentMetaType_Patch, selectedPatchIndex);
+            } else {
+                loadTitleContentSize(NcmContentMetaType_AddOnContent, selectedAddOnIndex);
+            }
+            
             patch_addon_ctx_t *ptr = (orphanEntries[orphanListCursor].type == ORPHAN_ENTRY_TYPE_PATCH ? &(patchEntries[selectedPatchIndex]) : &(addOnEntries[selectedAddOnIndex]));
             
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Title ID: %016lX", ptr->titleId);
@@ -1842,6 +2273,8 @@ UIResult uiProcess()
             j = 0;
             highlight = false;
             
+            if (uiState == stateSdCardEmmcMenu) requestTitleIcons(scroll, maxElements);
+            
             for(i = scroll; i < menuItemsCount; i++, j++)
             {
                 if (j >= maxElements) break;
@@ -1979,6 +2412,13 @@ UIResult uiProcess()
                     {
                         uiDrawIcon(baseAppEntries[i].icon, NACP_ICON_DOWNSCALED, NACP_ICON_DOWNSCALED, xpos, ypos);
                         
+                        xpos += (NACP_ICON_DOWNSCALED + 8);
+                    } else
+                    if (baseAppEntries[i].iconState != TITLE_ICON_STATE_FAILED)
+                    {
+                        // Still being decoded
+                        uiFill(xpos, ypos, NACP_ICON_DOWNSCALED, NACP_ICON_DOWNSCALED, ICON_PLACEHOLDER_COLOR_RGB);
+                        
                         xpos += (NACP_ICON_DOWNSCALED + 8);
                     }
                     
@@ -2055,6 +2495,18 @@ UIResult uiProcess()
                         case 7: // Output naming scheme
                             uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, dumpCfg.xciDumpCfg.useBrackets, !dumpCfg.xciDumpCfg.useBrackets, FONT_COLOR_RGB, (dumpCfg.xciDumpCfg.useBrackets ? xciNamingSchemes[1] : xciNamingSchemes[0]));
                             break;
+                        case 8: // Output target
+                            leftArrowCondition = (dumpCfg.xciDumpCfg.outputTarget != DUMP_OUTPUT_SDCARD);
+                            rightArrowCondition = (dumpCfg.xciDumpCfg.outputTarget != (DUMP_OUTPUT_CNT - 1));
+                            
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, leftArrowCondition, rightArrowCondition, FONT_COLOR_RGB, dumpOutputTargets[dumpCfg.xciDumpCfg.outputTarget]);
+                            break;
+                        case 9: // Verify HFS0 / NCA header hashes
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.xciDumpCfg.verifyHashes, !dumpCfg.xciDumpCfg.verifyHashes, (dumpCfg.xciDumpCfg.verifyHashes ? 0 : 255), (dumpCfg.xciDumpCfg.verifyHashes ? 255 : 0), 0, (dumpCfg.xciDumpCfg.verifyHashes ? "Yes" : "No"));
+                            break;
+                        case 10: // Compress output dump
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.xciDumpCfg.compressOutput, !dumpCfg.xciDumpCfg.compressOutput, (dumpCfg.xciDumpCfg.compressOutput ? 0 : 255), (dumpCfg.xciDumpCfg.compressOutput ? 255 : 0), 0, (dumpCfg.xciDumpCfg.compressOutput ? "Yes" : "No"));
+                            break;
                         default:
                             break;
                     }
@@ -2090,6 +2542,8 @@ UIResult uiProcess()
                                     // Otherwise, just print the Title ID
                                     retrieveDescriptionForPatchOrAddOn(selectedAddOnIndex, true, (menuType == MENUTYPE_GAMECARD), NULL, titleSelectorStr, MAX_CHARACTERS(titleSelectorStr));
                                     
+                                    loadTitleContentSize(NcmContentMetaType_AddOnContent, selectedAddOnIndex);
+                                    
                                     if (addOnEntries[selectedAddOnIndex].contentSize)
                                     {
                                         strcat(titleSelectorStr, " (");
@@ -2114,6 +2568,8 @@ UIResult uiProcess()
                                     // Print application name
                                     snprintf(titleSelectorStr, MAX_CHARACTERS(titleSelectorStr), "%s v%s", baseAppEntries[selectedAppIndex].name, baseAppEntries[selectedAppIndex].versionStr);
                                     
+                                    loadTitleContentSize(NcmContentMetaType_Application, selectedAppIndex);
+                                    
                                     if (baseAppEntries[selectedAppIndex].contentSize)
                                     {
                                         strcat(titleSelectorStr, " (");
@@ -2140,7 +2596,7 @@ UIResult uiProcess()
                             if (uiState != stateNspPatchDumpMenu) uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, leftArrowCondition, rightArrowCondition, FONT_COLOR_RGB, (uiState == stateNspAddOnDumpMenu ? (dumpCfg.nspDumpCfg.useBrackets ? nspNamingSchemes[1] : nspNamingSchemes[0]) : titleSelectorStr));
                             
                             break;
-                        case 7: // Output naming scheme (base application) || Update to dump
+                        case 7: // Output naming scheme (base application) || Update to dump || Compress output dump (DLC)
                             if (uiState == stateNspAppDumpMenu)
                             {
                                 uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, dumpCfg.nspDumpCfg.useBrackets, !dumpCfg.nspDumpCfg.useBrackets, FONT_COLOR_RGB, (dumpCfg.nspDumpCfg.useBrackets ? nspNamingSchemes[1] : nspNamingSchemes[0]));
@@ -2153,6 +2609,8 @@ UIResult uiProcess()
                                     // Otherwise, just print the Title ID
                                     retrieveDescriptionForPatchOrAddOn(selectedPatchIndex, false, (menuType == MENUTYPE_GAMECARD), NULL, titleSelectorStr, MAX_CHARACTERS(titleSelectorStr));
                                     
+                                    loadTitleContentSize(NcmContentMetaType_Patch, selectedPatchIndex);
+                                    
                                     if (patchEntries[selectedPatchIndex].contentSize)
                                     {
                                         strcat(titleSelectorStr, " (");
@@ -2167,11 +2625,35 @@ UIResult uiProcess()
                                 rightArrowCondition = ((menuType == MENUTYPE_GAMECARD && titlePatchCount > 0 && selectedPatchIndex < (titlePatchCount - 1)) || (menuType == MENUTYPE_SDCARD_EMMC && !orphanMode && retrieveNextPatchOrAddOnIndexFromBaseApplication(selectedPatchIndex, selectedAppInfoIndex, false) != selectedPatchIndex));
                                 
                                 uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, leftArrowCondition, rightArrowCondition, FONT_COLOR_RGB, titleSelectorStr);
+                            } else
+                            if (uiState == stateNspAddOnDumpMenu)
+                            {
+                                uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.nspDumpCfg.compressOutput, !dumpCfg.nspDumpCfg.compressOutput, (dumpCfg.nspDumpCfg.compressOutput ? 0 : 255), (dumpCfg.nspDumpCfg.compressOutput ? 255 : 0), 0, (dumpCfg.nspDumpCfg.compressOutput ? "Yes" : "No"));
                             }
                             
                             break;
-                        case 8: // Output naming scheme (update)
-                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, dumpCfg.nspDumpCfg.useBrackets, !dumpCfg.nspDumpCfg.useBrackets, FONT_COLOR_RGB, (dumpCfg.nspDumpCfg.useBrackets ? nspNamingSchemes[1] : nspNamingSchemes[0]));
+                        case 8: // Output naming scheme (update) || Compress output dump (base application) || Output target (DLC)
+                            if (uiState == stateNspPatchDumpMenu)
+                            {
+                                uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, dumpCfg.nspDumpCfg.useBrackets, !dumpCfg.nspDumpCfg.useBrackets, FONT_COLOR_RGB, (dumpCfg.nspDumpCfg.useBrackets ? nspNamingSchemes[1] : nspNamingSchemes[0]));
+                            } else
+                            if (uiState == stateNspAppDumpMenu)
+                            {
+                                uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.nspDumpCfg.compressOutput, !dumpCfg.nspDumpCfg.compressOutput, (dumpCfg.nspDumpCfg.compressOutput ? 0 : 255), (dumpCfg.nspDumpCfg.compressOutput ? 255 : 0), 0, (dumpCfg.nspDumpCfg.compressOutput ? "Yes" : "No"));
+                            } else {
+                                uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, (dumpCfg.nspDumpCfg.outputTarget != DUMP_OUTPUT_SDCARD), (dumpCfg.nspDumpCfg.outputTarget != (DUMP_OUTPUT_CNT - 1)), FONT_COLOR_RGB, dumpOutputTargets[dumpCfg.nspDumpCfg.outputTarget]);
+                            }
+                            break;
+                        case 9: // Compress output dump (update) || Output target (base application)
+                            if (uiState == stateNspPatchDumpMenu)
+                            {
+                                uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.nspDumpCfg.compressOutput, !dumpCfg.nspDumpCfg.compressOutput, (dumpCfg.nspDumpCfg.compressOutput ? 0 : 255), (dumpCfg.nspDumpCfg.compressOutput ? 255 : 0), 0, (dumpCfg.nspDumpCfg.compressOutput ? "Yes" : "No"));
+                            } else {
+                                uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, (dumpCfg.nspDumpCfg.outputTarget != DUMP_OUTPUT_SDCARD), (dumpCfg.nspDumpCfg.outputTarget != (DUMP_OUTPUT_CNT - 1)), FONT_COLOR_RGB, dumpOutputTargets[dumpCfg.nspDumpCfg.outputTarget]);
+                            }
+                            break;
+                        case 10: // Output target (update)
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, (dumpCfg.nspDumpCfg.outputTarget != DUMP_OUTPUT_SDCARD), (dumpCfg.nspDumpCfg.outputTarget != (DUMP_OUTPUT_CNT - 1)), FONT_COLOR_RGB, dumpOutputTargets[dumpCfg.nspDumpCfg.outputTarget]);
                             break;
                         default:
                             break;
@@ -2240,6 +2722,9 @@ UIResult uiProcess()
                             
                             uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, leftArrowCondition, rightArrowCondition, FONT_COLOR_RGB, (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL ? "All (SD card + eMMC)" : (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD ? "SD card" : "eMMC")));
                             
+                            break;
+                        case 14: // Deduplicate NCAs
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.batchDumpCfg.ncaDedup, !dumpCfg.batchDumpCfg.ncaDedup, (dumpCfg.batchDumpCfg.ncaDedup ? 0 : 255), (dumpCfg.batchDumpCfg.ncaDedup ? 255 : 0), 0, (dumpCfg.batchDumpCfg.ncaDedup ? "Yes" : "No"));
                             break;
                         default:
                             break;
@@ -2464,6 +2949,19 @@ UIResult uiProcess()
                     }
                 }
                 
+                // Print settings values for the Update menu
+                if (uiState == stateUpdateMenu && i == 3) uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.ncaMetaCacheCfg.keepOnSdCard, !dumpCfg.ncaMetaCacheCfg.keepOnSdCard, (dumpCfg.ncaMetaCacheCfg.keepOnSdCard ? 0 : 255), (dumpCfg.ncaMetaCacheCfg.keepOnSdCard ? 255 : 0), 0, (dumpCfg.ncaMetaCacheCfg.keepOnSdCard ? "Yes" : "No"));
+                
+                if (uiState == stateUpdateMenu && i == 7)
+                {
+                    if (dumpCfg.ncaCacheCfg.budgetMiB)
+                    {
+                        uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, true, (dumpCfg.ncaCacheCfg.budgetMiB < (u32)(NCA_CACHE_MAX_BUDGET / MiB)), FONT_COLOR_RGB, "%u MiB", dumpCfg.ncaCacheCfg.budgetMiB);
+                    } else {
+                        uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, false, true, FONT_COLOR_ERROR_RGB, "Disabled");
+                    }
+                }
+                
                 // Print settings values for the Ticket menu
                 if (uiState == stateTicketMenu && i > 0)
                 {
@@ -2621,6 +3119,9 @@ UIResult uiProcess()
             keysHeld = getButtonsHeld();
             
             if (keysDown || keysHeld || (menuType == MENUTYPE_GAMECARD && gameCardInfo.isInserted != curGcStatus)) break;
+            
+            // Redraw the menu if any of the displayed title icons finished loading
+            if (titleIconsUpdated()) break;
         }
         
         // Exit
@@ -2685,6 +3186,15 @@ UIResult uiProcess()
                         case 7: // Output naming scheme
                             dumpCfg.xciDumpCfg.useBrackets = false;
                             break;
+                        case 8: // Output target
+                            if (dumpCfg.xciDumpCfg.outputTarget != DUMP_OUTPUT_SDCARD) dumpCfg.xciDumpCfg.outputTarget--;
+                            break;
+                        case 9: // Verify HFS0 / NCA header hashes
+                            dumpCfg.xciDumpCfg.verifyHashes = false;
+                            break;
+                        case 10: // Compress output dump
+                            dumpCfg.xciDumpCfg.compressOutput = false;
+                            break;
                         default:
                             break;
                     }
@@ -2719,6 +3229,15 @@ UIResult uiProcess()
                         case 7: // Output naming scheme
                             dumpCfg.xciDumpCfg.useBrackets = true;
                             break;
+                        case 8: // Output target
+                            if (dumpCfg.xciDumpCfg.outputTarget != (DUMP_OUTPUT_CNT - 1)) dumpCfg.xciDumpCfg.outputTarget++;
+                            break;
+                        case 9: // Verify HFS0 / NCA header hashes
+                            dumpCfg.xciDumpCfg.verifyHashes = true;
+                            break;
+                        case 10: // Compress output dump
+                            dumpCfg.xciDumpCfg.compressOutput = true;
+                            break;
                         default:
                             break;
                     }
@@ -2845,7 +3364,7 @@ UIResult uiProcess()
                                 dumpCfg.nspDumpCfg.useBrackets = false;
                             }
                             break;
-                        case 7: // Output naming scheme (base application) || Update to dump
+                        case 7: // Output naming scheme (base application) || Update to dump || Compress output dump (DLC)
                             if (uiState == stateNspAppDumpMenu)
                             {
                                 dumpCfg.nspDumpCfg.useBrackets = false;
@@ -2872,10 +3391,34 @@ UIResult uiProcess()
                                         }
                                     }
                                 }
+                            } else
+                            if (uiState == stateNspAddOnDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.compressOutput = false;
+                            }
+                            break;
+                        case 8: // Output naming scheme (update) || Compress output dump (base application) || Output target (DLC)
+                            if (uiState == stateNspPatchDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.useBrackets = false;
+                            } else
+                            if (uiState == stateNspAppDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.compressOutput = false;
+                            } else {
+                                if (dumpCfg.nspDumpCfg.outputTarget != DUMP_OUTPUT_SDCARD) dumpCfg.nspDumpCfg.outputTarget--;
                             }
                             break;
-                        case 8: // Output naming scheme (update)
-                            dumpCfg.nspDumpCfg.useBrackets = false;
+                        case 9: // Compress output dump (update) || Output target (base application)
+                            if (uiState == stateNspPatchDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.compressOutput = false;
+                            } else {
+                                if (dumpCfg.nspDumpCfg.outputTarget != DUMP_OUTPUT_SDCARD) dumpCfg.nspDumpCfg.outputTarget--;
+                            }
+                            break;
+                        case 10: // Output target (update)
+                            if (dumpCfg.nspDumpCfg.outputTarget != DUMP_OUTPUT_SDCARD) dumpCfg.nspDumpCfg.outputTarget--;
                             break;
                         default:
                             break;
@@ -2950,7 +3493,7 @@ UIResult uiProcess()
                                 dumpCfg.nspDumpCfg.useBrackets = true;
                             }
                             break;
-                        case 7: // Output naming scheme (base application) || Update to dump
+                        case 7: // Output naming scheme (base application) || Update to dump || Compress output dump (DLC)
                             if (uiState == stateNspAppDumpMenu)
                             {
                                 dumpCfg.nspDumpCfg.useBrackets = true;
@@ -2977,10 +3520,34 @@ UIResult uiProcess()
                                         }
                                     }
                                 }
+                            } else
+                            if (uiState == stateNspAddOnDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.compressOutput = true;
+                            }
+                            break;
+                        case 8: // Output naming scheme (update) || Compress output dump (base application) || Output target (DLC)
+                            if (uiState == stateNspPatchDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.useBrackets = true;
+                            } else
+                            if (uiState == stateNspAppDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.compressOutput = true;
+                            } else {
+                                if (dumpCfg.nspDumpCfg.outputTarget != (DUMP_OUTPUT_CNT - 1)) dumpCfg.nspDumpCfg.outputTarget++;
+                            }
+                            break;
+                        case 9: // Compress output dump (update) || Output target (base application)
+                            if (uiState == stateNspPatchDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.compressOutput = true;
+                            } else {
+                                if (dumpCfg.nspDumpCfg.outputTarget != (DUMP_OUTPUT_CNT - 1)) dumpCfg.nspDumpCfg.outputTarget++;
                             }
                             break;
-                        case 8: // Output naming scheme (update)
-                            dumpCfg.nspDumpCfg.useBrackets = true;
+                        case 10: // Output target (update)
+                            if (dumpCfg.nspDumpCfg.outputTarget != (DUMP_OUTPUT_CNT - 1)) dumpCfg.nspDumpCfg.outputTarget++;
                             break;
                         default:
                             break;
@@ -3078,6 +3645,9 @@ UIResult uiProcess()
                                 }
                             }
                             break;
+                        case 14: // Deduplicate NCAs
+                            dumpCfg.batchDumpCfg.ncaDedup = false;
+                            break;
                         default:
                             break;
                     }
@@ -3152,6 +3722,9 @@ UIResult uiProcess()
                                 }
                             }
                             break;
+                        case 14: // Deduplicate NCAs
+                            dumpCfg.batchDumpCfg.ncaDedup = true;
+                            break;
                         default:
                             break;
                     }
@@ -4101,12 +4674,61 @@ UIResult uiProcess()
                                     uiStatusMsg("Update already performed. Please restart the application.");
                                 }
                                 break;
+                            case 2:
+                                res = resultBenchmarkDumpBlockSizes;
+                                break;
+                            case 4:
+                                res = resultBenchmarkCorePaths;
+                                break;
+                            case 5:
+                                res = resultRestoreCompressedDumps;
+                                break;
+                            case 6:
+                                res = resultRebuildNspFromManifests;
+                                break;
                             default:
                                 break;
                         }
                     }
                 }
                 
+                if (uiState == stateUpdateMenu && cursor == 3)
+                {
+                    // Keep NCA metadata cache on the SD card
+                    if ((keysDown & HidNpadButton_AnyLeft) && dumpCfg.ncaMetaCacheCfg.keepOnSdCard)
+                    {
+                        dumpCfg.ncaMetaCacheCfg.keepOnSdCard = false;
+                        saveConfig();
+                        
+                        // Don't leave a stale copy behind
+                        remove(NCA_META_CACHE_PATH);
+                    }
+                    
+                    if ((keysDown & HidNpadButton_AnyRight) && !dumpCfg.ncaMetaCacheCfg.keepOnSdCard)
+                    {
+                        dumpCfg.ncaMetaCacheCfg.keepOnSdCard = true;
+                        saveConfig();
+                    }
+                }
+                
+                if (uiState == stateUpdateMenu && cursor == 7)
+                {
+                    // NCA block cache size (disabled, 1 MiB, 2 MiB, ..., NCA_CACHE_MAX_BUDGET)
+                    if ((keysDown & HidNpadButton_AnyLeft) && dumpCfg.ncaCacheCfg.budgetMiB > 0)
+                    {
+                        dumpCfg.ncaCacheCfg.budgetMiB >>= 1;
+                        ncaCacheSetBudget((u64)(dumpCfg.ncaCacheCfg.budgetMiB * MiB));
+                        saveConfig();
+                    }
+                    
+                    if ((keysDown & HidNpadButton_AnyRight) && dumpCfg.ncaCacheCfg.budgetMiB < (u32)(NCA_CACHE_MAX_BUDGET / MiB))
+                    {
+                        dumpCfg.ncaCacheCfg.budgetMiB = (dumpCfg.ncaCacheCfg.budgetMiB ? (dumpCfg.ncaCacheCfg.budgetMiB << 1) : 1);
+                        ncaCacheSetBudget((u64)(dumpCfg.ncaCacheCfg.budgetMiB * MiB));
+                        saveConfig();
+                    }
+                }
+                
                 // Back
                 if (keysDown & HidNpadButton_B)
                 {
@@ -4481,7 +5103,7 @@ UIResult uiProcess()
                 {
                     if (scrollAmount > 0)
                     {
-                        cursor = (scrollWithKeysDown ? 0 : 12);
+                        cursor++;
                     } else
                     if (scrollAmount < 0)
                     {
@@ -4611,6 +5233,12 @@ UIResult uiProcess()
         breaks++;
         
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", xciDumpMenuItems[7], (dumpCfg.xciDumpCfg.useBrackets ? xciNamingSchemes[1] : xciNamingSchemes[0]));
+        breaks++;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", xciDumpMenuItems[9], (dumpCfg.xciDumpCfg.verifyHashes ? "Yes" : "No"));
+        breaks++;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", xciDumpMenuItems[10], (dumpCfg.xciDumpCfg.compressOutput ? "Yes" : "No"));
         breaks += 2;
         
         uiRefreshDisplay();
@@ -4693,6 +5321,12 @@ UIResult uiProcess()
         breaks++;
         
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", (selectedNspDumpType == DUMP_ADDON_NSP ? menu[6] : (selectedNspDumpType == DUMP_APP_NSP ? menu[7] : menu[8])), (dumpCfg.nspDumpCfg.useBrackets ? nspNamingSchemes[1] : nspNamingSchemes[0]));
+        breaks++;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", (selectedNspDumpType == DUMP_ADDON_NSP ? menu[7] : (selectedNspDumpType == DUMP_APP_NSP ? menu[8] : menu[9])), (dumpCfg.nspDumpCfg.compressOutput ? "Yes" : "No"));
+        breaks++;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", (selectedNspDumpType == DUMP_ADDON_NSP ? menu[8] : (selectedNspDumpType == DUMP_APP_NSP ? menu[9] : menu[10])), dumpOutputTargets[dumpCfg.nspDumpCfg.outputTarget]);
         breaks += 2;
         
         uiRefreshDisplay();
@@ -4780,6 +5414,9 @@ UIResult uiProcess()
             breaks++;
         }
         
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", menu[14], (dumpCfg.batchDumpCfg.ncaDedup ? "Yes" : "No"));
+        breaks++;
+        
         breaks++;
         uiRefreshDisplay();
         
@@ -4803,7 +5440,7 @@ UIResult uiProcess()
         
         uiRefreshDisplay();
         
-        dumpRawHfs0Partition(selectedPartitionIndex, true);
+        dumpRawHfs0Partition(selectedPartitionIndex, true, dumpCfg.xciDumpCfg.verifyHashes, dumpCfg.xciDumpCfg.outputTarget);
         
         waitForButtonPress();
         
@@ -4817,7 +5454,7 @@ UIResult uiProcess()
         
         uiRefreshDisplay();
         
-        dumpHfs0PartitionData(selectedPartitionIndex, true);
+        dumpHfs0PartitionData(selectedPartitionIndex, true, dumpCfg.xciDumpCfg.verifyHashes, dumpCfg.xciDumpCfg.outputTarget);
         
         waitForButtonPress();
         
@@ -4847,7 +5484,7 @@ UIResult uiProcess()
         
         uiRefreshDisplay();
         
-        dumpFileFromHfs0Partition(selectedPartitionIndex, selectedFileIndex, filenameBuffer[selectedFileIndex], true);
+        dumpFileFromHfs0Partition(selectedPartitionIndex, selectedFileIndex, filenameBuffer[selectedFileIndex], true, dumpCfg.xciDumpCfg.verifyHashes, dumpCfg.xciDumpCfg.outputTarget);
         
         waitForButtonPress();
         
@@ -5269,6 +5906,56 @@ UIResult uiProcess()
         
         waitForButtonPress();
         
+        updateFreeSpace();
+        res = resultShowUpdateMenu;
+    } else
+    if (uiState == stateBenchmarkDumpBlockSizes)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, updateMenuItems[2]);
+        breaks += 2;
+        
+        benchmarkDumpBlockSizes();
+        
+        waitForButtonPress();
+        
+        updateFreeSpace();
+        res = resultShowUpdateMenu;
+    } else
+    if (uiState == stateBenchmarkCorePaths)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, updateMenuItems[4]);
+        breaks += 2;
+        
+        benchmarkCorePaths();
+        
+        waitForButtonPress();
+        
+        updateFreeSpace();
+        res = resultShowUpdateMenu;
+    } else
+    if (uiState == stateRestoreCompressedDumps)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, updateMenuItems[5]);
+        breaks += 2;
+        
+        // Split outputs are always stored as directories with the archive bit set, just like split compressed dumps
+        restoreCompressedDumps(dumpCfg.xciDumpCfg.isFat32 || dumpCfg.nspDumpCfg.isFat32);
+        
+        waitForButtonPress();
+        
+        updateFreeSpace();
+        res = resultShowUpdateMenu;
+    } else
+    if (uiState == stateRebuildNspFromManifests)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, updateMenuItems[6]);
+        breaks += 2;
+        
+        // NSP manifests are only written by batch mode dumps
+        rebuildNspFromManifests(dumpCfg.batchDumpCfg.isFat32);
+        
+        waitForButtonPress();
+        
         updateFreeSpace();
         res = resultShowUpdateMenu;
     }
@@ -29,6 +29,8 @@
 
 #define EMPTY_BAR_COLOR_RGB         0, 0, 0
 
+#define ICON_PLACEHOLDER_COLOR_RGB  70, 70, 70                  // Drawn while a title icon is being decoded
+
 #define COMMON_MAX_ELEMENTS         9
 #define HFS0_MAX_ELEMENTS           14
 #define ROMFS_MAX_ELEMENTS          12
@@ -44,6 +46,13 @@
 
 #define BROWSER_ICON_DIMENSION      16
 
+#define UI_GLYPH_CACHE_CNT          1024                        // Must be a power of 2
+#define UI_GLYPH_ATLAS_PAGE_SIZE    0x40000                     // 256 KiB
+
+#define UI_TEXT_RUN_CACHE_CNT       128
+#define UI_TEXT_RUN_CACHE_BUDGET    0x400000                    // 4 MiB (precomposited pixels, spans and strings)
+#define UI_TEXT_RUN_RECENT_CNT      32                          // Strings are only cached after being drawn twice
+
 // UTF-8 sequences
 
 #define UPWARDS_ARROW               "\xE2\x86\x91"
@@ -110,6 +119,10 @@ typedef enum {
     resultShowUpdateMenu,
     resultUpdateNSWDBXml,
     resultUpdateApplication,
+    resultBenchmarkDumpBlockSizes,
+    resultBenchmarkCorePaths,
+    resultRestoreCompressedDumps,
+    resultRebuildNspFromManifests,
     resultExit
 } UIResult;
 
@@ -158,7 +171,11 @@ typedef enum {
     stateDumpTicket,
     stateUpdateMenu,
     stateUpdateNSWDBXml,
-    stateUpdateApplication
+    stateUpdateApplication,
+    stateBenchmarkDumpBlockSizes,
+    stateBenchmarkCorePaths,
+    stateRestoreCompressedDumps,
+    stateRebuildNspFromManifests
 } UIState;
 
 typedef enum {
@@ -167,10 +184,54 @@ typedef enum {
     MENUTYPE_SDCARD_EMMC
 } curMenuType;
 
+typedef struct {
+    u32 codepoint;
+    u8 face;                                                    // Shared font index
+    bool valid;
+    s16 left;                                                   // FreeType bitmap_left
+    s16 top;                                                    // FreeType bitmap_top
+    u16 width;
+    u16 rows;
+    u16 pitch;
+    s16 advance_x;
+    s16 advance_y;
+    const u8 *bitmap;                                           // 8-bit alpha, stored in a glyph atlas page
+} ui_glyph_t;
+
+typedef struct ui_glyph_atlas_page {
+    struct ui_glyph_atlas_page *next;
+    u32 used;
+    u8 data[];
+} ui_glyph_atlas_page_t;
+
+typedef struct {
+    u16 x;
+    u16 y;
+    u16 len;
+    u32 offset;                                                 // Relative to the start of the run pixel data
+} ui_text_span_t;
+
+typedef struct {
+    u32 hash;
+    int x;
+    int y;
+    u8 rgb[3];
+    bool highlight;
+    u64 lastUse;
+    u32 spanCnt;
+    u32 size;                                                   // Allocation size for the whole run
+    const char *string;
+    ui_text_span_t *spans;                                      // Single allocation holding the spans, pixels and string
+    u32 *pixels;                                                // Precomposited RGBA8 framebuffer pixels
+} ui_text_run_t;
+
 void uiFill(int x, int y, int width, int height, u8 r, u8 g, u8 b);
 
 void uiDrawIcon(const u8 *icon, int width, int height, int x, int y);
 
+// Error messages are stored in the provided buffer instead of strbuf, which lets worker threads use this function
+bool uiLoadJpgFromMemEx(u8 *rawJpg, size_t rawJpgSize, int expectedWidth, int expectedHeight, int desiredWidth, int desiredHeight, u8 **outBuf, char *errorBuf, size_t errorBufSize);
+
 bool uiLoadJpgFromMem(u8 *rawJpg, size_t rawJpgSize, int expectedWidth, int expectedHeight, int desiredWidth, int desiredHeight, u8 **outBuf);
 
 bool uiLoadJpgFromFile(const char *filename, int expectedWidth, int expectedHeight, int desiredWidth, int desiredHeight, u8 **outBuf);
@@ -179,6 +240,11 @@ void uiDrawString(int x, int y, u8 r, u8 g, u8 b, const char *fmt, ...);
 
 u32 uiGetStrWidth(const char *fmt, ...);
 
+/* The framebuffer can be drawn to from both the main thread and the progress UI thread used by dumps. */
+/* Every ui* drawing function takes this (recursive) lock by itself - only needed to group several calls into a single frame. */
+void uiLockFramebuffer();
+void uiUnlockFramebuffer();
+
 void uiRefreshDisplay();
 
 void uiStatusMsg(const char *fmt, ...);
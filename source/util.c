@@ -20,9 +20,13 @@
 #include "dumper.h"
 #include "fs_ext.h"
 #include "keys.h"
+#include "nca_cache.h"
+#include "nca_meta.h"
+#include "perf.h"
 #include "ui.h"
 #include "util.h"
 #include "fatfs/ff.h"
+#include "fatfs/diskio.h"
 
 /* Extern variables */
 
@@ -47,6 +51,7 @@ static PadState g_padState = {0};
 
 static bool initNcm = false, initNs = false, initCsrng = false, initSpl = false, initPmdmnt = false, initPl = false, initNet = false;
 static bool openFsDevOp = false, openGcEvtNotifier = false, loadGcKernEvt = false, gcThreadInit = false, homeBtnBlocked = false;
+static bool configDirty = false;
 
 dumpOptions dumpCfg;
 
@@ -72,6 +77,21 @@ patch_addon_ctx_t *patchEntries = NULL, *addOnEntries = NULL;
 static volatile bool gameCardInfoLoaded = false;
 static bool sdCardAndEmmcTitleInfoLoaded = false;
 
+static pthread_t titleIconThread;
+static bool titleIconThreadCreated = false, titleIconThreadExit = false, titleIconThreadFailed = false;
+static Mutex titleIconMutex = 0;
+static CondVar titleIconCondVar = 0;
+static u32 titleIconVisibleStart = 0, titleIconVisibleEnd = 0;
+static volatile bool titleIconsReady = false;
+
+static ncm_session_storage_t ncmSession[NCM_SESSION_STORAGE_CNT];
+static Mutex ncmSessionMutex = 0;
+
+// Title cache entries for the current title list, updated with the content sizes calculated on demand
+static title_cache_t titleCache;
+static u64 titleCacheLanguageCode = 0;
+static bool titleCacheDirty = false;
+
 exefs_ctx_t exeFsContext;
 romfs_ctx_t romFsContext;
 bktr_ctx_t bktrContext;
@@ -89,7 +109,9 @@ int filenameCount = 0, filenameIndex = 0;
 
 u8 *dumpBuf = NULL;
 u8 *gcReadBuf = NULL;
-u8 *ncaCtrBuf = NULL;
+
+// Gamecard data currently held by gcReadBuf (only valid while the same IStorage partition stays open)
+static u64 gcReadBufOffset = 0, gcReadBufSize = 0;
 
 orphan_patch_addon_entry *orphanEntries = NULL;
 u32 orphanEntriesCnt = 0;
@@ -132,6 +154,8 @@ void loadConfig()
     
     dumpCfg.romFsDumpCfg.isFat32 = true;
     
+    dumpCfg.ncaCacheCfg.budgetMiB = (u32)(NCA_CACHE_DEFAULT_BUDGET / MiB);
+    
     FILE *configFile = fopen(CONFIG_PATH, "rb");
     if (!configFile) return;
     
@@ -166,6 +190,12 @@ void loadConfig()
     if (dumpCfg.batchDumpCfg.tiklessDump && !dumpCfg.batchDumpCfg.removeConsoleData) dumpCfg.batchDumpCfg.tiklessDump = false;
     
     if (dumpCfg.batchDumpCfg.batchModeSrc >= BATCH_SOURCE_CNT) dumpCfg.batchDumpCfg.batchModeSrc = BATCH_SOURCE_ALL;
+    
+    if (dumpCfg.xciDumpCfg.outputTarget >= DUMP_OUTPUT_CNT) dumpCfg.xciDumpCfg.outputTarget = DUMP_OUTPUT_SDCARD;
+    
+    if (dumpCfg.nspDumpCfg.outputTarget >= DUMP_OUTPUT_CNT) dumpCfg.nspDumpCfg.outputTarget = DUMP_OUTPUT_SDCARD;
+    
+    if (dumpCfg.ncaCacheCfg.budgetMiB > (u32)(NCA_CACHE_MAX_BUDGET / MiB) || (dumpCfg.ncaCacheCfg.budgetMiB & (dumpCfg.ncaCacheCfg.budgetMiB - 1))) dumpCfg.ncaCacheCfg.budgetMiB = (u32)(NCA_CACHE_DEFAULT_BUDGET / MiB);
 }
 
 void saveConfig()
@@ -177,6 +207,13 @@ void saveConfig()
     fclose(configFile);
     
     if (write_res != sizeof(dumpOptions)) remove(CONFIG_PATH);
+    
+    configDirty = false;
+}
+
+void saveConfigIfDirty()
+{
+    if (configDirty) saveConfig();
 }
 
 static bool isGameCardInserted()
@@ -271,6 +308,9 @@ void closeGameCardStoragePartition()
     fsStorageClose(&(gameCardInfo.fsGameCardStorage));
     memset(&(gameCardInfo.fsGameCardStorage), 0, sizeof(FsStorage));
     
+    // Forget the read-ahead window: it belongs to this IStorage partition
+    gcReadBufSize = 0;
+    
     closeGameCardHandle();
     
     gameCardInfo.curIStorageIndex = ISTORAGE_PARTITION_NONE;
@@ -327,11 +367,24 @@ Result readGameCardStoragePartition(u64 off, void *buf, size_t len)
 {
     if (!gameCardInfo.curIStorageIndex || gameCardInfo.curIStorageIndex >= ISTORAGE_PARTITION_INVALID || !buf || !len) return MAKERESULT(Module_Libnx, LibnxError_IoError);
     
-    // Optimization for reads that are already aligned to MEDIA_UNIT_SIZE bytes
-    if (!(off % MEDIA_UNIT_SIZE) && !(len % MEDIA_UNIT_SIZE)) return fsStorageRead(&(gameCardInfo.fsGameCardStorage), off, buf, len);
-    
     Result result;
     u8 *outBuf = (u8*)buf;
+    u64 startTick = perfTick();
+    
+    // Small reads close to each other (e.g. HFS0 / NCA / RomFS headers and tickets) are served from the read-ahead window
+    if (gcReadBufSize && off >= gcReadBufOffset && (off + len) <= (gcReadBufOffset + gcReadBufSize))
+    {
+        memcpy(outBuf, gcReadBuf + (off - gcReadBufOffset), len);
+        return 0;
+    }
+    
+    // Optimization for reads that are already aligned to MEDIA_UNIT_SIZE bytes
+    if (!(off % MEDIA_UNIT_SIZE) && !(len % MEDIA_UNIT_SIZE))
+    {
+        result = fsStorageRead(&(gameCardInfo.fsGameCardStorage), off, buf, len);
+        perfAdd(PERF_STAGE_READ, startTick, len);
+        return result;
+    }
     
     u64 block_start_offset = (off - (off % MEDIA_UNIT_SIZE));
     u64 block_end_offset = (u64)round_up(off + len, MEDIA_UNIT_SIZE);
@@ -340,9 +393,25 @@ Result readGameCardStoragePartition(u64 off, void *buf, size_t len)
     u64 block_size_used = (block_size > GAMECARD_READ_BUFFER_SIZE ? GAMECARD_READ_BUFFER_SIZE : block_size);
     u64 output_block_size = (block_size > GAMECARD_READ_BUFFER_SIZE ? (GAMECARD_READ_BUFFER_SIZE - (off - block_start_offset)) : len);
     
+    // Read ahead if this is a small read, as long as we know where the IStorage partition ends
+    u64 partitionSize = gameCardInfo.IStoragePartitionSizes[gameCardInfo.curIStorageIndex - 1];
+    if (block_size_used < GAMECARD_READ_AHEAD_SIZE && partitionSize > block_start_offset)
+    {
+        block_size_used = (GAMECARD_READ_AHEAD_SIZE > (partitionSize - block_start_offset) ? (partitionSize - block_start_offset) : GAMECARD_READ_AHEAD_SIZE);
+        block_size_used -= (block_size_used % MEDIA_UNIT_SIZE);
+        if (block_size_used < block_size) block_size_used = block_size;
+    }
+    
+    gcReadBufSize = 0;
+    
     result = fsStorageRead(&(gameCardInfo.fsGameCardStorage), block_start_offset, gcReadBuf, block_size_used);
+    perfAdd(PERF_STAGE_READ, startTick, block_size_used);
+    
     if (R_FAILED(result)) return result;
     
+    gcReadBufOffset = block_start_offset;
+    gcReadBufSize = block_size_used;
+    
     memcpy(outBuf, gcReadBuf + (off - block_start_offset), output_block_size);
     
     if (block_size > GAMECARD_READ_BUFFER_SIZE) return readGameCardStoragePartition(off + output_block_size, outBuf + output_block_size, len - output_block_size);
@@ -369,6 +438,8 @@ bool mountSysEmmcPartition()
         return false;
     }
     
+    disk_cache_invalidate();
+    
     fatFsObj = calloc(1, sizeof(FATFS));
     if (!fatFsObj)
     {
@@ -400,6 +471,8 @@ void unmountSysEmmcPartition()
         fsStorageClose(&fatFsStorage);
         memset(&fatFsStorage, 0, sizeof(FsStorage));
     }
+    
+    disk_cache_invalidate();
 }
 
 static bool getExosphereApiVersion(u32 *out)
@@ -488,6 +561,7 @@ static void createOutputDirectories()
     mkdir(CERT_DUMP_PATH, 0744);
     mkdir(BATCH_OVERRIDES_PATH, 0744);
     mkdir(TICKET_PATH, 0744);
+    mkdir(TITLE_ICON_PATH, 0744);
 }
 
 static bool getSdCardFreeSpace(u64 *out)
@@ -644,6 +718,13 @@ void initRomFsContext()
     memset(&romFsContext, 0, sizeof(romfs_ctx_t));
 }
 
+static void freeRomFsIndex(romfs_index_t *index)
+{
+    if (index->dirs) free(index->dirs);
+    if (index->child_offsets) free(index->child_offsets);
+    memset(index, 0, sizeof(romfs_index_t));
+}
+
 void freeRomFsContext()
 {
     if (romFsContext.storageId == NcmStorageId_GameCard) closeGameCardStoragePartition();
@@ -664,6 +745,8 @@ void freeRomFsContext()
         free(romFsContext.romfs_file_entries);
         romFsContext.romfs_file_entries = NULL;
     }
+    
+    freeRomFsIndex(&(romFsContext.romfs_index));
 }
 
 void initBktrContext()
@@ -704,9 +787,44 @@ void freeBktrContext()
         bktrContext.romfs_file_entries = NULL;
     }
     
+    freeRomFsIndex(&(bktrContext.romfs_index));
+    
     bktrContext.use_base_romfs = false;
 }
 
+static const char *getHfs0EntryName(hfs0_partition_info *partitionInfo, u32 index)
+{
+    hfs0_file_entry entry;
+    memcpy(&entry, partitionInfo->header + sizeof(hfs0_header) + (index * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
+    
+    if (entry.filename_offset >= partitionInfo->str_table_size) return "";
+    
+    return (const char*)(partitionInfo->header + sizeof(hfs0_header) + (partitionInfo->file_cnt * sizeof(hfs0_file_entry)) + entry.filename_offset);
+}
+
+static int hfs0NameIndexCmp(const void *a, const void *b)
+{
+    return strcasecmp(((const hfs0_name_index_entry*)a)->name, ((const hfs0_name_index_entry*)b)->name);
+}
+
+static void buildHfs0NameIndex(hfs0_partition_info *partitionInfo)
+{
+    if (!partitionInfo || !partitionInfo->header || !partitionInfo->file_cnt || !partitionInfo->str_table_size) return;
+    
+    u32 i;
+    
+    partitionInfo->name_index = calloc(partitionInfo->file_cnt, sizeof(hfs0_name_index_entry));
+    if (!partitionInfo->name_index) return;
+    
+    for(i = 0; i < partitionInfo->file_cnt; i++)
+    {
+        partitionInfo->name_index[i].name = getHfs0EntryName(partitionInfo, i);
+        partitionInfo->name_index[i].index = i;
+    }
+    
+    qsort(partitionInfo->name_index, partitionInfo->file_cnt, sizeof(hfs0_name_index_entry), hfs0NameIndexCmp);
+}
+
 static void freeGameCardInfo()
 {
     u32 i;
@@ -724,6 +842,7 @@ static void freeGameCardInfo()
         for(i = 0; i < gameCardInfo.hfs0PartitionCnt; i++)
         {
             if (gameCardInfo.hfs0Partitions[i].header) free(gameCardInfo.hfs0Partitions[i].header);
+            if (gameCardInfo.hfs0Partitions[i].name_index) free(gameCardInfo.hfs0Partitions[i].name_index);
         }
         
         free(gameCardInfo.hfs0Partitions);
@@ -758,10 +877,492 @@ static void freeOrphanPatchOrAddOnList()
     orphanEntriesCnt = 0;
 }
 
+static void generateTitleIconPath(u64 titleId, u32 version, char *outBuf, size_t outBufSize)
+{
+    snprintf(outBuf, outBufSize, "%s%016lX_%u.bin", TITLE_ICON_PATH, titleId, version);
+}
+
+// Runs on the title icon thread - no UI calls are allowed here
+// The icon comes from the latest installed patch (if any), so version must be the base application's nacpVersion
+static bool loadTitleIcon(u64 titleId, u32 version, u8 **outBuf)
+{
+    char iconPath[NAME_BUF_LEN / 4] = {'\0'};
+    generateTitleIconPath(titleId, version, iconPath, MAX_CHARACTERS(iconPath));
+    
+    bool success = false;
+    Result result;
+    size_t outsize = 0, read_res = 0;
+    NsApplicationControlData *buf = NULL;
+    u8 *icon = NULL;
+    char errorMsg[NAME_BUF_LEN / 4] = {'\0'};
+    
+    // Check if we already decoded this icon during a previous session
+    FILE *iconFile = fopen(iconPath, "rb");
+    if (iconFile)
+    {
+        icon = malloc(TITLE_ICON_SIZE);
+        if (icon) read_res = fread(icon, 1, TITLE_ICON_SIZE, iconFile);
+        fclose(iconFile);
+        
+        if (icon && read_res == TITLE_ICON_SIZE)
+        {
+            *outBuf = icon;
+            return true;
+        }
+        
+        if (icon) free(icon);
+        icon = NULL;
+        remove(iconPath);
+    }
+    
+    buf = calloc(1, sizeof(NsApplicationControlData));
+    if (!buf) return false;
+    
+    result = nsGetApplicationControlData(NsApplicationControlSource_Storage, titleId, buf, sizeof(NsApplicationControlData), &outsize);
+    if (R_SUCCEEDED(result) && outsize > sizeof(buf->nacp)) success = uiLoadJpgFromMemEx(buf->icon, sizeof(buf->icon), NACP_ICON_SQUARE_DIMENSION, NACP_ICON_SQUARE_DIMENSION, NACP_ICON_DOWNSCALED, NACP_ICON_DOWNSCALED, &icon, errorMsg, MAX_CHARACTERS(errorMsg));
+    
+    free(buf);
+    
+    if (!success) return false;
+    
+    iconFile = fopen(iconPath, "wb");
+    if (iconFile)
+    {
+        size_t write_res = fwrite(icon, 1, TITLE_ICON_SIZE, iconFile);
+        fclose(iconFile);
+        if (write_res != TITLE_ICON_SIZE) remove(iconPath);
+    }
+    
+    *outBuf = icon;
+    
+    return true;
+}
+
+// Must be called with titleIconMutex locked
+static void getTitleIconPrefetchRange(u32 *outStart, u32 *outEnd)
+{
+    *outStart = (titleIconVisibleStart > TITLE_ICON_PREFETCH_CNT ? (titleIconVisibleStart - TITLE_ICON_PREFETCH_CNT) : 0);
+    *outEnd = ((titleIconVisibleEnd + TITLE_ICON_PREFETCH_CNT) < titleAppCount ? (titleIconVisibleEnd + TITLE_ICON_PREFETCH_CNT) : titleAppCount);
+}
+
+// Must be called with titleIconMutex locked
+static bool getNextPendingTitleIcon(u32 *outIndex)
+{
+    u32 i, start, end;
+    
+    getTitleIconPrefetchRange(&start, &end);
+    
+    // Visible rows go first, then the ones right below them, then the ones right above them
+    for(i = titleIconVisibleStart; i < end; i++)
+    {
+        if (!baseAppEntries[i].icon && baseAppEntries[i].iconState != TITLE_ICON_STATE_FAILED)
+        {
+            *outIndex = i;
+            return true;
+        }
+    }
+    
+    for(i = titleIconVisibleStart; i > start; i--)
+    {
+        if (!baseAppEntries[i - 1].icon && baseAppEntries[i - 1].iconState != TITLE_ICON_STATE_FAILED)
+        {
+            *outIndex = (i - 1);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+static void *titleIconThreadFunc(void *arg)
+{
+    (void)arg;
+    
+    u32 idx, start, end;
+    u64 titleId;
+    u32 version;
+    u8 *icon = NULL;
+    bool success;
+    
+    mutexLock(&titleIconMutex);
+    
+    while(!titleIconThreadExit)
+    {
+        if (!getNextPendingTitleIcon(&idx))
+        {
+            condvarWait(&titleIconCondVar, &titleIconMutex);
+            continue;
+        }
+        
+        titleId = baseAppEntries[idx].titleId;
+        version = baseAppEntries[idx].nacpVersion;
+        
+        // Don't hold the lock while decoding, so the UI thread can keep updating the requested rows
+        mutexUnlock(&titleIconMutex);
+        
+        icon = NULL;
+        success = loadTitleIcon(titleId, version, &icon);
+        
+        mutexLock(&titleIconMutex);
+        
+        getTitleIconPrefetchRange(&start, &end);
+        
+        if (titleIconThreadExit || idx < start || idx >= end)
+        {
+            // Not needed anymore
+            if (icon) free(icon);
+            continue;
+        }
+        
+        if (success)
+        {
+            __atomic_store_n(&(baseAppEntries[idx].icon), icon, __ATOMIC_RELEASE);
+            if (idx >= titleIconVisibleStart && idx < titleIconVisibleEnd) changeAtomicBool(&titleIconsReady, true);
+        } else {
+            // Placeholders are only drawn for pending icons
+            baseAppEntries[idx].iconState = TITLE_ICON_STATE_FAILED;
+            if (idx >= titleIconVisibleStart && idx < titleIconVisibleEnd) changeAtomicBool(&titleIconsReady, true);
+        }
+    }
+    
+    mutexUnlock(&titleIconMutex);
+    
+    return NULL;
+}
+
+static void stopTitleIconThread()
+{
+    if (!titleIconThreadCreated) return;
+    
+    mutexLock(&titleIconMutex);
+    titleIconThreadExit = true;
+    condvarWakeAll(&titleIconCondVar);
+    mutexUnlock(&titleIconMutex);
+    
+    pthread_join(titleIconThread, NULL);
+    
+    titleIconThreadCreated = false;
+    titleIconThreadExit = false;
+    titleIconVisibleStart = titleIconVisibleEnd = 0;
+    changeAtomicBool(&titleIconsReady, false);
+}
+
+/* Called by the UI before drawing rows [index, index + count) from the base application list. */
+/* Pending icons for these rows (and a few rows around them) are decoded in the background, while icons far away from them are freed. */
+void requestTitleIcons(u32 index, u32 count)
+{
+    if (!baseAppEntries || !titleAppCount || index >= titleAppCount || !count) return;
+    
+    u32 i, end = ((titleAppCount - index) < count ? titleAppCount : (index + count));
+    
+    // Don't try to create the thread again on every frame if it already failed once
+    if (!titleIconThreadCreated && !titleIconThreadFailed)
+    {
+        titleIconThreadExit = false;
+        
+        if (pthread_create(&titleIconThread, NULL, titleIconThreadFunc, NULL) == 0)
+        {
+            titleIconThreadCreated = true;
+        } else {
+            titleIconThreadFailed = true;
+        }
+    }
+    
+    if (!titleIconThreadCreated)
+    {
+        // Fallback to decoding the visible icons right away
+        for(i = index; i < end; i++)
+        {
+            if (baseAppEntries[i].icon || baseAppEntries[i].iconState == TITLE_ICON_STATE_FAILED) continue;
+            if (!loadTitleIcon(baseAppEntries[i].titleId, baseAppEntries[i].nacpVersion, &(baseAppEntries[i].icon))) baseAppEntries[i].iconState = TITLE_ICON_STATE_FAILED;
+        }
+        
+        return;
+    }
+    
+    mutexLock(&titleIconMutex);
+    
+    titleIconVisibleStart = index;
+    titleIconVisibleEnd = end;
+    
+    // Icons are only ever freed by the UI thread, so they can't go away while being drawn
+    for(i = 0; i < titleAppCount; i++)
+    {
+        if (!baseAppEntries[i].icon || ((i + TITLE_ICON_EVICT_DISTANCE) >= index && i < (end + TITLE_ICON_EVICT_DISTANCE))) continue;
+        
+        free(baseAppEntries[i].icon);
+        baseAppEntries[i].icon = NULL;
+    }
+    
+    condvarWakeAll(&titleIconCondVar);
+    
+    mutexUnlock(&titleIconMutex);
+}
+
+/* Returns true (once) if an icon for a visible row finished loading since the last call. */
+bool titleIconsUpdated()
+{
+    return __atomic_exchange_n(&titleIconsReady, false, __ATOMIC_SEQ_CST);
+}
+
+static void freeTitleCache(title_cache_t *cache)
+{
+    if (!cache) return;
+    
+    if (cache->entries) free(cache->entries);
+    
+    memset(cache, 0, sizeof(title_cache_t));
+}
+
+static int titleCacheEntryCmp(const void *a, const void *b)
+{
+    const title_cache_entry_t *entry1 = (const title_cache_entry_t*)a;
+    const title_cache_entry_t *entry2 = (const title_cache_entry_t*)b;
+    
+    if (entry1->titleId != entry2->titleId) return (entry1->titleId < entry2->titleId ? -1 : 1);
+    if (entry1->storageId != entry2->storageId) return (entry1->storageId < entry2->storageId ? -1 : 1);
+    if (entry1->metaType != entry2->metaType) return (entry1->metaType < entry2->metaType ? -1 : 1);
+    if (entry1->version != entry2->version) return (entry1->version < entry2->version ? -1 : 1);
+    
+    return 0;
+}
+
+// nsGetApplicationControlData() returns the Control.nacp from the latest installed patch, if there's one
+static u32 getBaseApplicationNacpVersion(u64 titleId)
+{
+    u32 i, version = 0;
+    
+    if (!patchEntries || !titlePatchCount) return 0;
+    
+    for(i = 0; i < titlePatchCount; i++)
+    {
+        if (patchEntries[i].titleId == (titleId | APPLICATION_PATCH_BITMASK) && patchEntries[i].version > version) version = patchEntries[i].version;
+    }
+    
+    return version;
+}
+
+static u64 getTitleCacheLanguageCode()
+{
+    u64 languageCode = 0;
+    
+    if (R_SUCCEEDED(setInitialize()))
+    {
+        setGetSystemLanguage(&languageCode);
+        setExit();
+    }
+    
+    return languageCode;
+}
+
+static bool loadTitleCache(title_cache_t *cache, u64 languageCode)
+{
+    if (!cache) return false;
+    
+    memset(cache, 0, sizeof(title_cache_t));
+    
+    FILE *cacheFile = fopen(TITLE_CACHE_PATH, "rb");
+    if (!cacheFile) return false;
+    
+    bool success = false;
+    title_cache_header_t header;
+    u64 fileSize, entriesSize;
+    
+    fseek(cacheFile, 0, SEEK_END);
+    fileSize = ftell(cacheFile);
+    rewind(cacheFile);
+    
+    if (fileSize < sizeof(title_cache_header_t) || fread(&header, 1, sizeof(title_cache_header_t), cacheFile) != sizeof(title_cache_header_t)) goto out;
+    
+    // Cached names are only valid for the system language they were retrieved under
+    if (header.magic != TITLE_CACHE_MAGIC || header.languageCode != languageCode || !header.entryCnt) goto out;
+    
+    entriesSize = ((u64)header.entryCnt * sizeof(title_cache_entry_t));
+    if ((fileSize - sizeof(title_cache_header_t)) != entriesSize) goto out;
+    
+    cache->entryCnt = header.entryCnt;
+    
+    cache->entries = malloc(entriesSize);
+    if (!cache->entries || fread(cache->entries, 1, entriesSize, cacheFile) != entriesSize) goto out;
+    
+    success = true;
+    
+out:
+    fclose(cacheFile);
+    
+    if (!success)
+    {
+        freeTitleCache(cache);
+        remove(TITLE_CACHE_PATH);
+    }
+    
+    return success;
+}
+
+static void saveTitleCache(title_cache_t *cache, u64 languageCode)
+{
+    if (!cache) return;
+    
+    if (!cache->entryCnt)
+    {
+        remove(TITLE_CACHE_PATH);
+        return;
+    }
+    
+    FILE *cacheFile = fopen(TITLE_CACHE_PATH, "wb");
+    if (!cacheFile) return;
+    
+    bool success = false;
+    title_cache_header_t header;
+    
+    header.magic = TITLE_CACHE_MAGIC;
+    header.entryCnt = cache->entryCnt;
+    header.languageCode = languageCode;
+    
+    qsort(cache->entries, cache->entryCnt, sizeof(title_cache_entry_t), titleCacheEntryCmp);
+    
+    if (fwrite(&header, 1, sizeof(title_cache_header_t), cacheFile) != sizeof(title_cache_header_t)) goto out;
+    if (fwrite(cache->entries, 1, (u64)cache->entryCnt * sizeof(title_cache_entry_t), cacheFile) != ((u64)cache->entryCnt * sizeof(title_cache_entry_t))) goto out;
+    
+    success = true;
+    
+out:
+    fclose(cacheFile);
+    
+    if (!success) remove(TITLE_CACHE_PATH);
+}
+
+static title_cache_entry_t *getTitleCacheEntry(title_cache_t *cache, u64 titleId, u32 version, NcmStorageId storageId, NcmContentMetaType metaType)
+{
+    if (!cache || !cache->entries || !cache->entryCnt) return NULL;
+    
+    title_cache_entry_t key;
+    memset(&key, 0, sizeof(title_cache_entry_t));
+    
+    key.titleId = titleId;
+    key.version = version;
+    key.storageId = (u8)storageId;
+    key.metaType = (u8)metaType;
+    
+    return (title_cache_entry_t*)bsearch(&key, cache->entries, cache->entryCnt, sizeof(title_cache_entry_t), titleCacheEntryCmp);
+}
+
+// The output cache must have room for one entry per title
+static void addTitleCacheEntry(title_cache_t *cache, u64 titleId, u32 version, NcmStorageId storageId, NcmContentMetaType metaType, u64 contentSize, const char *name, const char *author, u32 nacpVersion)
+{
+    if (!cache || !cache->entries) return;
+    
+    title_cache_entry_t *entry = &(cache->entries[cache->entryCnt++]);
+    memset(entry, 0, sizeof(title_cache_entry_t));
+    
+    entry->titleId = titleId;
+    entry->version = version;
+    entry->storageId = (u8)storageId;
+    entry->metaType = (u8)metaType;
+    entry->contentSize = contentSize;
+    entry->nacpVersion = nacpVersion;
+    
+    if (name) snprintf(entry->name, MAX_CHARACTERS(entry->name), "%s", name);
+    if (author) snprintf(entry->author, MAX_CHARACTERS(entry->author), "%s", author);
+}
+
+static int getNcmSessionStorageIndex(NcmStorageId storageId)
+{
+    return (storageId == NcmStorageId_GameCard ? 0 : (storageId == NcmStorageId_SdCard ? 1 : (storageId == NcmStorageId_BuiltInUser ? 2 : -1)));
+}
+
+static int getNcmSessionMetaTypeIndex(NcmContentMetaType metaType)
+{
+    return (metaType == NcmContentMetaType_Application ? 0 : (metaType == NcmContentMetaType_Patch ? 1 : (metaType == NcmContentMetaType_AddOnContent ? 2 : -1)));
+}
+
+// Opens the content meta database from the provided storage if it isn't already open. ncmSessionMutex must be locked
+static NcmContentMetaDatabase *getNcmSessionMetaDatabase(NcmStorageId storageId, Result *outResult)
+{
+    int storageIdx = getNcmSessionStorageIndex(storageId);
+    if (storageIdx < 0) return NULL;
+    
+    ncm_session_storage_t *storage = &(ncmSession[storageIdx]);
+    
+    if (!storage->dbOpen)
+    {
+        Result result = ncmOpenContentMetaDatabase(&(storage->ncmDb), storageId);
+        if (outResult) *outResult = result;
+        if (R_FAILED(result)) return NULL;
+        
+        storage->dbOpen = true;
+    }
+    
+    return &(storage->ncmDb);
+}
+
+// Takes ownership of the provided key list. ncmSessionMutex must be locked
+static void setNcmSessionKeyList(NcmStorageId storageId, NcmContentMetaType metaType, NcmApplicationContentMetaKey *keys, u32 keyCnt)
+{
+    int storageIdx = getNcmSessionStorageIndex(storageId), metaTypeIdx = getNcmSessionMetaTypeIndex(metaType);
+    
+    if (storageIdx < 0 || metaTypeIdx < 0)
+    {
+        if (keys) free(keys);
+        return;
+    }
+    
+    ncm_session_storage_t *storage = &(ncmSession[storageIdx]);
+    
+    if (storage->keys[metaTypeIdx]) free(storage->keys[metaTypeIdx]);
+    
+    storage->keys[metaTypeIdx] = keys;
+    storage->keyCnt[metaTypeIdx] = (keys ? keyCnt : 0);
+}
+
+// ncmSessionMutex must be locked
+static NcmApplicationContentMetaKey *getNcmSessionKeyList(NcmStorageId storageId, NcmContentMetaType metaType, u32 *outKeyCnt)
+{
+    int storageIdx = getNcmSessionStorageIndex(storageId), metaTypeIdx = getNcmSessionMetaTypeIndex(metaType);
+    if (storageIdx < 0 || metaTypeIdx < 0 || !outKeyCnt) return NULL;
+    
+    *outKeyCnt = ncmSession[storageIdx].keyCnt[metaTypeIdx];
+    
+    return ncmSession[storageIdx].keys[metaTypeIdx];
+}
+
+static void closeNcmSession()
+{
+    u32 i, j;
+    
+    mutexLock(&ncmSessionMutex);
+    
+    for(i = 0; i < NCM_SESSION_STORAGE_CNT; i++)
+    {
+        for(j = 0; j < NCM_SESSION_META_TYPE_CNT; j++)
+        {
+            if (ncmSession[i].keys[j]) free(ncmSession[i].keys[j]);
+        }
+        
+        if (ncmSession[i].dbOpen) ncmContentMetaDatabaseClose(&(ncmSession[i].ncmDb));
+    }
+    
+    memset(ncmSession, 0, sizeof(ncmSession));
+    
+    mutexUnlock(&ncmSessionMutex);
+}
+
 static void freeTitleInfo()
 {
     u32 i;
     
+    // The title icon thread must not touch the base application entries from here on
+    stopTitleIconThread();
+    
+    // Content sizes calculated on demand are written to the title cache at this point
+    if (titleCacheDirty) saveTitleCache(&titleCache, titleCacheLanguageCode);
+    
+    freeTitleCache(&titleCache);
+    titleCacheDirty = false;
+    
+    // Title indexes from the cached content meta key lists are only valid for the current title list
+    closeNcmSession();
+    
     if (baseAppEntries && titleAppCount)
     {
         for(i = 0; i < titleAppCount; i++)
@@ -841,6 +1442,10 @@ static void freeGlobalData()
     freeHfs0ExeFsEntriesSizes();
     
     freeFilenameBuffer();
+    
+    /* Cached NCA blocks and gamecard NCA handles may belong to a gamecard that's no longer inserted */
+    ncaCacheInvalidate();
+    resetNcaGameCardHandles();
 }
 
 void scanPads(void)
@@ -1053,14 +1658,6 @@ bool initApplicationResources(int argc, char **argv)
         goto out;
     }
     
-    /* Allocate memory for the NCA AES-CTR operation buffer */
-    ncaCtrBuf = calloc(NCA_CTR_BUFFER_SIZE, sizeof(u8));
-    if (!ncaCtrBuf)
-    {
-        uiDrawString(STRING_DEFAULT_POS, FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for the NCA AES-CTR operation buffer!", __func__);
-        goto out;
-    }
-    
     /* Open device operator */
     result = fsOpenDeviceOperator(&(gameCardInfo.fsOperatorInstance));
     if (R_FAILED(result))
@@ -1102,6 +1699,12 @@ bool initApplicationResources(int argc, char **argv)
     /* Load settings from configuration file */
     loadConfig();
     
+    /* Apply NCA block cache memory budget */
+    ncaCacheSetBudget((u64)(dumpCfg.ncaCacheCfg.budgetMiB * MiB));
+    
+    /* Load NCA metadata cache from the SD card */
+    if (dumpCfg.ncaMetaCacheCfg.keepOnSdCard) ncaMetaCacheLoad();
+    
     /* Update free space */
     updateFreeSpace();
     
@@ -1144,8 +1747,15 @@ void deinitApplicationResources()
     /* Close device operator */
     if (openFsDevOp) fsDeviceOperatorClose(&(gameCardInfo.fsOperatorInstance));
     
-    /* Free NCA AES-CTR operation buffer */
-    if (ncaCtrBuf) free(ncaCtrBuf);
+    /* Free NCA block cache */
+    ncaCacheFree();
+    
+    /* Save and free NCA metadata cache */
+    if (dumpCfg.ncaMetaCacheCfg.keepOnSdCard) ncaMetaCacheSave();
+    ncaMetaCacheFree();
+    
+    /* Free ES savefile ticket index */
+    freeEticketSaveIndex();
     
     /* Free gamecard read buffer */
     if (gcReadBuf) free(gcReadBuf);
@@ -1254,7 +1864,7 @@ static void generateVersionDottedStr(u32 titleVersion, char *outBuf, size_t outB
     snprintf(outBuf, outBufSize, "%u (%u.%u.%u.%u)", titleVersion, major, minor, micro, bugfix);
 }
 
-static bool listTitlesByType(NcmContentMetaDatabase *ncmDb, NcmContentMetaType metaType)
+static bool listTitlesByType(NcmContentMetaDatabase *ncmDb, NcmStorageId storageId, NcmContentMetaType metaType)
 {
     if (!ncmDb || (metaType != NcmContentMetaType_Application && metaType != NcmContentMetaType_Patch && metaType != NcmContentMetaType_AddOnContent))
     {
@@ -1406,7 +2016,16 @@ static bool listTitlesByType(NcmContentMetaDatabase *ncmDb, NcmContentMetaType m
 out:
     if (memError) uiStatusMsg("%s: failed to reallocate entry buffer! (meta type: 0x%02X).", __func__, (u8)metaType);
     
-    if (titleList) free(titleList);
+    if (titleList)
+    {
+        // Keep the full key list around, so content records can be retrieved later without listing every title again
+        if (success && total)
+        {
+            setNcmSessionKeyList(storageId, metaType, titleList, total);
+        } else {
+            free(titleList);
+        }
+    }
     
     return success;
 }
@@ -1424,15 +2043,20 @@ static bool getTitleIDAndVersionList(NcmStorageId storageId, bool loadBaseApps,
     
     bool listApp = false, listPatch = false, listAddOn = false, success = false;
     
-    Result result;
-    NcmContentMetaDatabase ncmDb;
+    Result result = 0;
+    NcmContentMetaDatabase *ncmDb = NULL;
     
     u32 i;
     u32 curAppCount = titleAppCount, curPatchCount = titlePatchCount, curAddOnCount = titleAddOnCount;
     
-    result = ncmOpenContentMetaDatabase(&ncmDb, storageId);
-    if (R_FAILED(result))
+    mutexLock(&ncmSessionMutex);
+    
+    // The content meta database is kept open until the title list is freed
+    ncmDb = getNcmSessionMetaDatabase(storageId, &result);
+    if (!ncmDb)
     {
+        mutexUnlock(&ncmSessionMutex);
+        
         if (storageId == NcmStorageId_SdCard && result == 0x21005)
         {
             // If the SD card is mounted, but is isn't currently used by HOS because of some weird reason, just filter this particular error and continue
@@ -1446,7 +2070,7 @@ static bool getTitleIDAndVersionList(NcmStorageId storageId, bool loadBaseApps,
     
     if (loadBaseApps)
     {
-        listApp = listTitlesByType(&ncmDb, NcmContentMetaType_Application);
+        listApp = listTitlesByType(ncmDb, storageId, NcmContentMetaType_Application);
         if (listApp && titleAppCount > curAppCount)
         {
             for(i = curAppCount; i < titleAppCount; i++) baseAppEntries[i].storageId = storageId;
@@ -1455,7 +2079,7 @@ static bool getTitleIDAndVersionList(NcmStorageId storageId, bool loadBaseApps,
     
     if (loadPatches)
     {
-        listPatch = listTitlesByType(&ncmDb, NcmContentMetaType_Patch);
+        listPatch = listTitlesByType(ncmDb, storageId, NcmContentMetaType_Patch);
         if (listPatch && titlePatchCount > curPatchCount)
         {
             for(i = curPatchCount; i < titlePatchCount; i++) patchEntries[i].storageId = storageId;
@@ -1464,7 +2088,7 @@ static bool getTitleIDAndVersionList(NcmStorageId storageId, bool loadBaseApps,
     
     if (loadAddOns)
     {
-        listAddOn = listTitlesByType(&ncmDb, NcmContentMetaType_AddOnContent);
+        listAddOn = listTitlesByType(ncmDb, storageId, NcmContentMetaType_AddOnContent);
         if (listAddOn && titleAddOnCount > curAddOnCount)
         {
             for(i = curAddOnCount; i < titleAddOnCount; i++) addOnEntries[i].storageId = storageId;
@@ -1473,7 +2097,7 @@ static bool getTitleIDAndVersionList(NcmStorageId storageId, bool loadBaseApps,
     
     success = (listApp || listPatch || listAddOn);
     
-    ncmContentMetaDatabaseClose(&ncmDb);
+    mutexUnlock(&ncmSessionMutex);
     
     return success;
 }
@@ -1867,6 +2491,9 @@ bool retrieveGameCardInfo()
             uiStatusMsg("%s: failed to read %lu bytes long %s HFS0 partition header! (0x%08X)", __func__, gameCardInfo.hfs0Partitions[i].header_size, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, i), result);
             goto out;
         }
+        
+        // Index the partition entries by name. Not fatal: lookups just fall back to a linear search
+        buildHfs0NameIndex(&(gameCardInfo.hfs0Partitions[i]));
     }
     
     // Get bundled FW version update
@@ -1920,6 +2547,85 @@ u64 calculateSizeFromContentRecords(NcmStorageId curStorageId, NcmContentMetaTyp
     return outSize;
 }
 
+static u32 getNcmTitleCount(NcmStorageId storageId, NcmContentMetaType metaType)
+{
+    switch(storageId)
+    {
+        case NcmStorageId_GameCard:
+            return (metaType == NcmContentMetaType_Application ? titleAppCount : (metaType == NcmContentMetaType_Patch ? titlePatchCount : titleAddOnCount));
+        case NcmStorageId_SdCard:
+            return (metaType == NcmContentMetaType_Application ? sdCardTitleAppCount : (metaType == NcmContentMetaType_Patch ? sdCardTitlePatchCount : sdCardTitleAddOnCount));
+        case NcmStorageId_BuiltInUser:
+            return (metaType == NcmContentMetaType_Application ? emmcTitleAppCount : (metaType == NcmContentMetaType_Patch ? emmcTitlePatchCount : emmcTitleAddOnCount));
+        default:
+            break;
+    }
+    
+    return 0;
+}
+
+void loadTitleContentSize(NcmContentMetaType metaType, u32 titleIndex)
+{
+    u64 titleId = 0, *contentSize = NULL;
+    u32 version = 0, ncmIndex = 0;
+    NcmStorageId storageId = NcmStorageId_None;
+    char *contentSizeStr = NULL;
+    size_t contentSizeStrSize = 0;
+    bool *contentSizeLoaded = NULL;
+    
+    if (metaType == NcmContentMetaType_Application)
+    {
+        if (!baseAppEntries || titleIndex >= titleAppCount) return;
+        
+        base_app_ctx_t *entry = &(baseAppEntries[titleIndex]);
+        
+        titleId = entry->titleId;
+        version = entry->version;
+        ncmIndex = entry->ncmIndex;
+        storageId = entry->storageId;
+        contentSize = &(entry->contentSize);
+        contentSizeStr = entry->contentSizeStr;
+        contentSizeStrSize = MAX_CHARACTERS(entry->contentSizeStr);
+        contentSizeLoaded = &(entry->contentSizeLoaded);
+    } else
+    if (metaType == NcmContentMetaType_Patch || metaType == NcmContentMetaType_AddOnContent)
+    {
+        patch_addon_ctx_t *entries = (metaType == NcmContentMetaType_Patch ? patchEntries : addOnEntries);
+        u32 entryCnt = (metaType == NcmContentMetaType_Patch ? titlePatchCount : titleAddOnCount);
+        if (!entries || titleIndex >= entryCnt) return;
+        
+        patch_addon_ctx_t *entry = &(entries[titleIndex]);
+        
+        titleId = entry->titleId;
+        version = entry->version;
+        ncmIndex = entry->ncmIndex;
+        storageId = entry->storageId;
+        contentSize = &(entry->contentSize);
+        contentSizeStr = entry->contentSizeStr;
+        contentSizeStrSize = MAX_CHARACTERS(entry->contentSizeStr);
+        contentSizeLoaded = &(entry->contentSizeLoaded);
+    } else {
+        return;
+    }
+    
+    if (*contentSizeLoaded) return;
+    
+    // Don't try again if this fails - this is called every time the title information is printed
+    *contentSize = calculateSizeFromContentRecords(storageId, metaType, getNcmTitleCount(storageId, metaType), ncmIndex);
+    *contentSizeLoaded = true;
+    
+    if (!*contentSize) return;
+    
+    convertSize(*contentSize, contentSizeStr, contentSizeStrSize);
+    
+    title_cache_entry_t *cacheEntry = getTitleCacheEntry(&titleCache, titleId, version, storageId, metaType);
+    if (cacheEntry && cacheEntry->contentSize != *contentSize)
+    {
+        cacheEntry->contentSize = *contentSize;
+        titleCacheDirty = true;
+    }
+}
+
 int baseAppCmp(const void *a, const void *b)
 {
 	base_app_ctx_t *baseApp1 = (base_app_ctx_t*)a;
@@ -1993,23 +2699,75 @@ void loadTitleInfo()
     
     if (proceed)
     {
-        u32 i, ncmTitleCount;
+        u32 i;
+        
+        // Installed titles are looked up in the title cache first - only titles that were installed, updated or removed since the last launch are refreshed
+        // Content sizes are calculated on demand by loadTitleContentSize(), which stores them in the new title cache
+        bool useTitleCache = (menuType == MENUTYPE_SDCARD_EMMC), titleCacheUpdated = false;
+        title_cache_t oldTitleCache;
+        title_cache_entry_t *cacheEntry = NULL;
+        
+        memset(&oldTitleCache, 0, sizeof(title_cache_t));
+        
+        if (useTitleCache)
+        {
+            titleCacheLanguageCode = getTitleCacheLanguageCode();
+            titleCacheUpdated = !loadTitleCache(&oldTitleCache, titleCacheLanguageCode);
+            
+            titleCache.entries = calloc(titleAppCount + titlePatchCount + titleAddOnCount, sizeof(title_cache_entry_t));
+            
+            // Don't bother with the cache if we're low on memory
+            if (!titleCache.entries)
+            {
+                freeTitleCache(&oldTitleCache);
+                freeTitleCache(&titleCache);
+                useTitleCache = false;
+            }
+        }
         
         for(i = 0; i < titleAppCount; i++)
         {
-            // Retrieve base application name, author and icon
-            if (getCachedBaseApplicationNacpMetadata(baseAppEntries[i].titleId, baseAppEntries[i].name, MAX_CHARACTERS(baseAppEntries[i].name), baseAppEntries[i].author, MAX_CHARACTERS(baseAppEntries[i].author), &(baseAppEntries[i].icon)))
+            bool cacheable = true;
+            
+            baseAppEntries[i].nacpVersion = getBaseApplicationNacpVersion(baseAppEntries[i].titleId);
+            
+            cacheEntry = (useTitleCache ? getTitleCacheEntry(&oldTitleCache, baseAppEntries[i].titleId, baseAppEntries[i].version, baseAppEntries[i].storageId, NcmContentMetaType_Application) : NULL);
+            
+            // The name and author may have changed if an update was installed or removed
+            if (cacheEntry && cacheEntry->nacpVersion != baseAppEntries[i].nacpVersion) cacheEntry = NULL;
+            
+            if (cacheEntry)
             {
-                strtrim(baseAppEntries[i].name);
-                strtrim(baseAppEntries[i].author);
+                // Retrieve base application name, author and content size from the title cache
+                snprintf(baseAppEntries[i].name, MAX_CHARACTERS(baseAppEntries[i].name), "%s", cacheEntry->name);
+                snprintf(baseAppEntries[i].author, MAX_CHARACTERS(baseAppEntries[i].author), "%s", cacheEntry->author);
                 snprintf(baseAppEntries[i].fixedName, MAX_CHARACTERS(baseAppEntries[i].fixedName), baseAppEntries[i].name);
                 removeIllegalCharacters(baseAppEntries[i].fixedName);
+                
+                baseAppEntries[i].contentSize = cacheEntry->contentSize;
+                baseAppEntries[i].contentSizeLoaded = (cacheEntry->contentSize > 0);
+            } else {
+                bool gotMetadata = false;
+                
+                // Retrieve base application name and author (icons are decoded on demand by the title icon thread)
+                if (getCachedBaseApplicationNacpMetadata(baseAppEntries[i].titleId, baseAppEntries[i].name, MAX_CHARACTERS(baseAppEntries[i].name), baseAppEntries[i].author, MAX_CHARACTERS(baseAppEntries[i].author), NULL))
+                {
+                    strtrim(baseAppEntries[i].name);
+                    strtrim(baseAppEntries[i].author);
+                    snprintf(baseAppEntries[i].fixedName, MAX_CHARACTERS(baseAppEntries[i].fixedName), baseAppEntries[i].name);
+                    removeIllegalCharacters(baseAppEntries[i].fixedName);
+                    gotMetadata = true;
+                }
+                
+                titleCacheUpdated = true;
+                
+                // Titles with incomplete metadata will be retrieved again during the next launch
+                cacheable = gotMetadata;
             }
             
-            // Retrieve base application content size
-            ncmTitleCount = (baseAppEntries[i].storageId == NcmStorageId_GameCard ? titleAppCount : (baseAppEntries[i].storageId == NcmStorageId_SdCard ? sdCardTitleAppCount : emmcTitleAppCount));
-            baseAppEntries[i].contentSize = calculateSizeFromContentRecords(baseAppEntries[i].storageId, NcmContentMetaType_Application, ncmTitleCount, baseAppEntries[i].ncmIndex);
-            convertSize(baseAppEntries[i].contentSize, baseAppEntries[i].contentSizeStr, MAX_CHARACTERS(baseAppEntries[i].contentSizeStr));
+            if (baseAppEntries[i].contentSizeLoaded) convertSize(baseAppEntries[i].contentSize, baseAppEntries[i].contentSizeStr, MAX_CHARACTERS(baseAppEntries[i].contentSizeStr));
+            
+            if (useTitleCache && cacheable) addTitleCacheEntry(&titleCache, baseAppEntries[i].titleId, baseAppEntries[i].version, baseAppEntries[i].storageId, NcmContentMetaType_Application, baseAppEntries[i].contentSize, baseAppEntries[i].name, baseAppEntries[i].author, baseAppEntries[i].nacpVersion);
         }
         
         // Sort base applications by name
@@ -2017,18 +2775,48 @@ void loadTitleInfo()
         
         for(i = 0; i < titlePatchCount; i++)
         {
-            // Retrieve patch content size
-            ncmTitleCount = (patchEntries[i].storageId == NcmStorageId_GameCard ? titlePatchCount : (patchEntries[i].storageId == NcmStorageId_SdCard ? sdCardTitlePatchCount : emmcTitlePatchCount));
-            patchEntries[i].contentSize = calculateSizeFromContentRecords(patchEntries[i].storageId, NcmContentMetaType_Patch, ncmTitleCount, patchEntries[i].ncmIndex);
-            convertSize(patchEntries[i].contentSize, patchEntries[i].contentSizeStr, MAX_CHARACTERS(patchEntries[i].contentSizeStr));
+            // Retrieve patch content size from the title cache
+            cacheEntry = (useTitleCache ? getTitleCacheEntry(&oldTitleCache, patchEntries[i].titleId, patchEntries[i].version, patchEntries[i].storageId, NcmContentMetaType_Patch) : NULL);
+            if (cacheEntry)
+            {
+                patchEntries[i].contentSize = cacheEntry->contentSize;
+                patchEntries[i].contentSizeLoaded = (cacheEntry->contentSize > 0);
+                convertSize(patchEntries[i].contentSize, patchEntries[i].contentSizeStr, MAX_CHARACTERS(patchEntries[i].contentSizeStr));
+            } else {
+                titleCacheUpdated = true;
+            }
+            
+            if (useTitleCache) addTitleCacheEntry(&titleCache, patchEntries[i].titleId, patchEntries[i].version, patchEntries[i].storageId, NcmContentMetaType_Patch, patchEntries[i].contentSize, NULL, NULL, 0);
         }
         
         for(i = 0; i < titleAddOnCount; i++)
         {
-            // Retrieve add-on content size
-            ncmTitleCount = (addOnEntries[i].storageId == NcmStorageId_GameCard ? titleAddOnCount : (addOnEntries[i].storageId == NcmStorageId_SdCard ? sdCardTitleAddOnCount : emmcTitleAddOnCount));
-            addOnEntries[i].contentSize = calculateSizeFromContentRecords(addOnEntries[i].storageId, NcmContentMetaType_AddOnContent, ncmTitleCount, addOnEntries[i].ncmIndex);
-            convertSize(addOnEntries[i].contentSize, addOnEntries[i].contentSizeStr, MAX_CHARACTERS(addOnEntries[i].contentSizeStr));
+            // Retrieve add-on content size from the title cache
+            cacheEntry = (useTitleCache ? getTitleCacheEntry(&oldTitleCache, addOnEntries[i].titleId, addOnEntries[i].version, addOnEntries[i].storageId, NcmContentMetaType_AddOnContent) : NULL);
+            if (cacheEntry)
+            {
+                addOnEntries[i].contentSize = cacheEntry->contentSize;
+                addOnEntries[i].contentSizeLoaded = (cacheEntry->contentSize > 0);
+                convertSize(addOnEntries[i].contentSize, addOnEntries[i].contentSizeStr, MAX_CHARACTERS(addOnEntries[i].contentSizeStr));
+            } else {
+                titleCacheUpdated = true;
+            }
+            
+            if (useTitleCache) addTitleCacheEntry(&titleCache, addOnEntries[i].titleId, addOnEntries[i].version, addOnEntries[i].storageId, NcmContentMetaType_AddOnContent, addOnEntries[i].contentSize, NULL, NULL, 0);
+        }
+        
+        if (useTitleCache)
+        {
+            // Also takes care of removed titles
+            // The new title cache is kept sorted for the rest of the session, so loadTitleContentSize() can look up its entries
+            if (titleCacheUpdated || titleCache.entryCnt != oldTitleCache.entryCnt)
+            {
+                saveTitleCache(&titleCache, titleCacheLanguageCode);
+            } else {
+                qsort(titleCache.entries, titleCache.entryCnt, sizeof(title_cache_entry_t), titleCacheEntryCmp);
+            }
+            
+            freeTitleCache(&oldTitleCache);
         }
         
         // Generate orphan content list
@@ -2121,15 +2909,65 @@ bool getHfs0FileList(u32 partition)
             freeHfs0ExeFsEntriesSizes();
             return false;
         }
-        
-        // Save entry size
-        hfs0ExeFsEntriesSizes[i].size = entry.file_size;
-        convertSize(hfs0ExeFsEntriesSizes[i].size, hfs0ExeFsEntriesSizes[i].sizeStr, MAX_CHARACTERS(hfs0ExeFsEntriesSizes[i].sizeStr));
+        
+        // Save entry size
+        hfs0ExeFsEntriesSizes[i].size = entry.file_size;
+        convertSize(hfs0ExeFsEntriesSizes[i].size, hfs0ExeFsEntriesSizes[i].sizeStr, MAX_CHARACTERS(hfs0ExeFsEntriesSizes[i].sizeStr));
+    }
+    
+    return true;
+}
+
+bool getHfs0FileHandleByName(u32 partition, const char *filename, hfs0_file_handle *out)
+{
+    if (partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions || !filename || !strlen(filename) || !out) return false;
+    
+    hfs0_partition_info *partitionInfo = &(gameCardInfo.hfs0Partitions[partition]);
+    if (!partitionInfo->header || !partitionInfo->header_size || !partitionInfo->file_cnt || !partitionInfo->str_table_size) return false;
+    
+    u32 i, index = 0;
+    hfs0_file_entry entry;
+    bool found = false;
+    
+    if (partitionInfo->name_index)
+    {
+        hfs0_name_index_entry key = { filename, 0 };
+        hfs0_name_index_entry *cur = bsearch(&key, partitionInfo->name_index, partitionInfo->file_cnt, sizeof(hfs0_name_index_entry), hfs0NameIndexCmp);
+        if (cur)
+        {
+            index = cur->index;
+            found = true;
+        }
+    } else {
+        for(i = 0; i < partitionInfo->file_cnt; i++)
+        {
+            if (strcasecmp(getHfs0EntryName(partitionInfo, i), filename) != 0) continue;
+            
+            index = i;
+            found = true;
+            break;
+        }
     }
     
+    if (!found) return false;
+    
+    memcpy(&entry, partitionInfo->header + sizeof(hfs0_header) + (index * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
+    
+    out->partition = partition;
+    out->index = index;
+    out->offset = (partitionInfo->offset + partitionInfo->header_size + entry.file_offset);
+    out->size = entry.file_size;
+    
     return true;
 }
 
+bool readHfs0FileByHandle(const hfs0_file_handle *handle, u64 offset, void *outBuf, size_t bufSize)
+{
+    if (!handle || !handle->size || (offset + bufSize) > handle->size || !outBuf || !bufSize) return false;
+    
+    return R_SUCCEEDED(readGameCardStoragePartition(handle->offset + offset, outBuf, bufSize));
+}
+
 // Used to retrieve data from files in the HFS0 Secure partition
 // An IStorage instance must have been opened beforehand
 bool readFileFromSecureHfs0PartitionByName(const char *filename, u64 offset, void *outBuf, size_t bufSize)
@@ -2140,40 +2978,24 @@ bool readFileFromSecureHfs0PartitionByName(const char *filename, u64 offset, voi
         return false;
     }
     
-    u32 i;
     Result result;
-    hfs0_file_entry entry;
-    
-    bool proceed = true, found = false;
+    hfs0_file_handle handle;
     
     u32 partition = (gameCardInfo.hfs0PartitionCnt - 1); // Select the Secure HFS0 partition
     
-    for(i = 0; i < gameCardInfo.hfs0Partitions[partition].file_cnt; i++)
+    if (!getHfs0FileHandleByName(partition, filename, &handle))
     {
-        memcpy(&entry, gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (i * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
-        
-        char *cur_filename = (char*)(gameCardInfo.hfs0Partitions[partition].header + sizeof(hfs0_header) + (gameCardInfo.hfs0Partitions[partition].file_cnt * sizeof(hfs0_file_entry)) + entry.filename_offset);
-        
-        if (strncasecmp(cur_filename, filename, strlen(filename)) != 0) continue;
-        
-        found = true;
-        
-        if (!entry.file_size || (offset + bufSize) > entry.file_size)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid file size for \"%s\"!", __func__, filename);
-            proceed = false;
-        }
-        
-        break;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to find file \"%s\" in Secure HFS0 partition!", __func__, filename);
+        return false;
     }
     
-    if (!proceed || !found)
+    if (!handle.size || (offset + bufSize) > handle.size)
     {
-        if (proceed && !found) uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to find file \"%s\" in Secure HFS0 partition!", __func__, filename);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid file size for \"%s\"!", __func__, filename);
         return false;
     }
     
-    result = readGameCardStoragePartition(gameCardInfo.hfs0Partitions[partition].header_size + entry.file_offset + offset, outBuf, bufSize);
+    result = readGameCardStoragePartition(handle.offset + offset, outBuf, bufSize);
     if (R_FAILED(result))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read file \"%s\"! (0x%08X)", __func__, filename, result);
@@ -2201,6 +3023,206 @@ bool calculateExeFsExtractedDataSize(u64 *out)
     return true;
 }
 
+static romfs_index_dir_entry *getRomFsIndexDirEntry(romfs_index_t *index, u32 dir_offset)
+{
+    u32 low = 0, high = index->dir_cnt;
+    
+    while(low < high)
+    {
+        u32 mid = (low + ((high - low) / 2));
+        
+        if (index->dirs[mid].offset == dir_offset) return &(index->dirs[mid]);
+        
+        if (index->dirs[mid].offset < dir_offset)
+        {
+            low = (mid + 1);
+        } else {
+            high = mid;
+        }
+    }
+    
+    return NULL;
+}
+
+static bool buildRomFsIndex(bool usePatch, romfs_index_t *index)
+{
+    u64 dirTableSize = (!usePatch ? romFsContext.romfs_dirtable_size : bktrContext.romfs_dirtable_size);
+    u64 fileTableSize = (!usePatch ? romFsContext.romfs_filetable_size : bktrContext.romfs_filetable_size);
+    romfs_dir *dirEntries = (!usePatch ? romFsContext.romfs_dir_entries : bktrContext.romfs_dir_entries);
+    romfs_file *fileEntries = (!usePatch ? romFsContext.romfs_file_entries : bktrContext.romfs_file_entries);
+    
+    u64 entryOffset = 0;
+    u32 i, j, dirCnt = 0, childCnt = 0, orderCnt = 1;
+    u32 *fillCounts = NULL, *order = NULL;
+    romfs_index_dir_entry *parent = NULL;
+    bool success = false;
+    
+    memset(index, 0, sizeof(romfs_index_t));
+    
+    // Count the directory entries
+    while(entryOffset < dirTableSize)
+    {
+        romfs_dir *entry = (romfs_dir*)((u8*)dirEntries + entryOffset);
+        
+        if (!entry->nameLen && entryOffset > 0)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: directory entry without name in RomFS section!", __func__);
+            return false;
+        }
+        
+        dirCnt++;
+        entryOffset += round_up(ROMFS_NONAME_DIRENTRY_SIZE + entry->nameLen, 4);
+    }
+    
+    index->dirs = calloc(dirCnt, sizeof(romfs_index_dir_entry));
+    fillCounts = calloc(dirCnt, sizeof(u32));
+    order = calloc(dirCnt, sizeof(u32));
+    
+    if (!index->dirs || !fillCounts || !order)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the RomFS section index!", __func__);
+        goto out;
+    }
+    
+    index->dir_cnt = dirCnt;
+    
+    // Directory table offsets are always increasing, so the resulting array is sorted
+    for(i = 0, entryOffset = 0; i < dirCnt; i++)
+    {
+        romfs_dir *entry = (romfs_dir*)((u8*)dirEntries + entryOffset);
+        index->dirs[i].offset = (u32)entryOffset;
+        entryOffset += round_up(ROMFS_NONAME_DIRENTRY_SIZE + entry->nameLen, 4);
+    }
+    
+    // Count children per directory (the root directory is its own parent, so it's always skipped)
+    for(i = 1; i < dirCnt; i++)
+    {
+        romfs_dir *entry = (romfs_dir*)((u8*)dirEntries + index->dirs[i].offset);
+        
+        parent = getRomFsIndexDirEntry(index, entry->parent);
+        if (!parent)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parent for directory entry at offset 0x%08X in RomFS section!", __func__, index->dirs[i].offset);
+            goto out;
+        }
+        
+        parent->child_dir_cnt++;
+        childCnt++;
+    }
+    
+    entryOffset = 0;
+    
+    while(entryOffset < fileTableSize)
+    {
+        romfs_file *entry = (romfs_file*)((u8*)fileEntries + entryOffset);
+        
+        if (!entry->nameLen)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: file entry without name in RomFS section!", __func__);
+            goto out;
+        }
+        
+        parent = getRomFsIndexDirEntry(index, entry->parent);
+        if (!parent)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parent for file entry at offset 0x%08lX in RomFS section!", __func__, entryOffset);
+            goto out;
+        }
+        
+        parent->child_file_cnt++;
+        parent->subtree_size += entry->dataSize;
+        childCnt++;
+        
+        entryOffset += round_up(ROMFS_NONAME_FILEENTRY_SIZE + entry->nameLen, 4);
+    }
+    
+    if (childCnt)
+    {
+        index->child_offsets = calloc(childCnt, sizeof(u32));
+        if (!index->child_offsets)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the RomFS section index!", __func__);
+            goto out;
+        }
+        
+        index->child_cnt = childCnt;
+    }
+    
+    for(i = 0, childCnt = 0; i < dirCnt; i++)
+    {
+        index->dirs[i].child_start = childCnt;
+        childCnt += (index->dirs[i].child_dir_cnt + index->dirs[i].child_file_cnt);
+    }
+    
+    // Fill child lists, keeping table order
+    for(i = 1; i < dirCnt; i++)
+    {
+        romfs_dir *entry = (romfs_dir*)((u8*)dirEntries + index->dirs[i].offset);
+        
+        parent = getRomFsIndexDirEntry(index, entry->parent);
+        j = (u32)(parent - index->dirs);
+        
+        index->child_offsets[parent->child_start + fillCounts[j]++] = index->dirs[i].offset;
+    }
+    
+    entryOffset = 0;
+    
+    while(entryOffset < fileTableSize)
+    {
+        romfs_file *entry = (romfs_file*)((u8*)fileEntries + entryOffset);
+        
+        parent = getRomFsIndexDirEntry(index, entry->parent);
+        j = (u32)(parent - index->dirs);
+        
+        index->child_offsets[parent->child_start + fillCounts[j]++] = (u32)entryOffset;
+        
+        entryOffset += round_up(ROMFS_NONAME_FILEENTRY_SIZE + entry->nameLen, 4);
+    }
+    
+    // Propagate subtree sizes: walk the tree breadth-first from the root, then accumulate in reverse order
+    order[0] = 0;
+    
+    for(i = 0; i < orderCnt; i++)
+    {
+        romfs_index_dir_entry *dir = &(index->dirs[order[i]]);
+        
+        for(j = 0; j < dir->child_dir_cnt && orderCnt < dirCnt; j++)
+        {
+            romfs_index_dir_entry *child = getRomFsIndexDirEntry(index, index->child_offsets[dir->child_start + j]);
+            order[orderCnt++] = (u32)(child - index->dirs);
+        }
+    }
+    
+    for(i = orderCnt; i > 0; i--)
+    {
+        romfs_index_dir_entry *dir = &(index->dirs[order[i - 1]]);
+        
+        for(j = 0; j < dir->child_dir_cnt; j++)
+        {
+            romfs_index_dir_entry *child = getRomFsIndexDirEntry(index, index->child_offsets[dir->child_start + j]);
+            dir->subtree_size += child->subtree_size;
+        }
+    }
+    
+    success = true;
+    
+out:
+    if (fillCounts) free(fillCounts);
+    if (order) free(order);
+    if (!success) freeRomFsIndex(index);
+    
+    return success;
+}
+
+static romfs_index_t *getRomFsIndex(bool usePatch)
+{
+    romfs_index_t *index = (!usePatch ? &(romFsContext.romfs_index) : &(bktrContext.romfs_index));
+    
+    if (!index->dirs && !buildRomFsIndex(usePatch, index)) return NULL;
+    
+    return index;
+}
+
 bool calculateRomFsFullExtractedSize(bool usePatch, u64 *out)
 {
     if ((!usePatch && (!romFsContext.romfs_filetable_size || !romFsContext.romfs_file_entries)) || (usePatch && (!bktrContext.romfs_filetable_size || !bktrContext.romfs_file_entries)) || !out)
@@ -2237,61 +3259,30 @@ bool calculateRomFsExtractedDirSize(u32 dir_offset, bool usePatch, u64 *out)
         return false;
     }
     
-    u64 totalSize = 0, childDirSize = 0;
-    romfs_file *fileEntry = NULL;
-    romfs_dir *childDirEntry = NULL;
-    romfs_dir *dirEntry = (!usePatch ? (romfs_dir*)((u8*)romFsContext.romfs_dir_entries + dir_offset) : (romfs_dir*)((u8*)bktrContext.romfs_dir_entries + dir_offset));
+    romfs_index_t *index = getRomFsIndex(usePatch);
+    if (!index) return false;
     
-    // Check if we're dealing with a nameless directory that's not the root directory
-    if (!dirEntry->nameLen && dir_offset > 0)
+    romfs_index_dir_entry *dirEntry = getRomFsIndexDirEntry(index, dir_offset);
+    if (!dirEntry)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: directory entry without name in RomFS section!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid RomFS directory entry offset! (0x%08X)", __func__, dir_offset);
         return false;
     }
     
-    if (dirEntry->childFile != ROMFS_ENTRY_EMPTY)
-    {
-        fileEntry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + dirEntry->childFile) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + dirEntry->childFile));
-        
-        totalSize += fileEntry->dataSize;
-        
-        while(fileEntry->sibling != ROMFS_ENTRY_EMPTY)
-        {
-            fileEntry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + fileEntry->sibling) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + fileEntry->sibling));
-            
-            totalSize += fileEntry->dataSize;
-        }
-    }
-    
-    if (dirEntry->childDir != ROMFS_ENTRY_EMPTY)
-    {
-        if (!calculateRomFsExtractedDirSize(dirEntry->childDir, usePatch, &childDirSize)) return false;
-        
-        totalSize += childDirSize;
-        
-        childDirEntry = (!usePatch ? (romfs_dir*)((u8*)romFsContext.romfs_dir_entries + dirEntry->childDir) : (romfs_dir*)((u8*)bktrContext.romfs_dir_entries + dirEntry->childDir));
-        
-        while(childDirEntry->sibling != ROMFS_ENTRY_EMPTY)
-        {
-            if (!calculateRomFsExtractedDirSize(childDirEntry->sibling, usePatch, &childDirSize)) return false;
-            
-            totalSize += childDirSize;
-            
-            childDirEntry = (!usePatch ? (romfs_dir*)((u8*)romFsContext.romfs_dir_entries + childDirEntry->sibling) : (romfs_dir*)((u8*)bktrContext.romfs_dir_entries + childDirEntry->sibling));
-        }
-    }
-    
-    *out = totalSize;
+    *out = dirEntry->subtree_size;
     
     return true;
 }
 
-bool retrieveContentInfosFromTitle(NcmStorageId storageId, NcmContentMetaType metaType, u32 titleCount, u32 titleIndex, NcmContentInfo **outContentInfos, u32 *outContentInfoCnt)
+bool retrieveContentInfosFromTitleEx(NcmStorageId storageId, NcmContentMetaType metaType, u32 titleCount, u32 titleIndex, NcmContentInfo **outContentInfos, u32 *outContentInfoCnt, char *errorBuf, size_t errorBufSize)
 {
-    Result result;
+    Result result = 0;
+    
+    NcmContentMetaDatabase *ncmDb = NULL;
+    bool sessionLocked = false;
     
-    NcmContentMetaDatabase ncmDb;
-    memset(&ncmDb, 0, sizeof(NcmContentMetaDatabase));
+    NcmContentMetaKey titleKey;
+    memset(&titleKey, 0, sizeof(NcmContentMetaKey));
     
     NcmContentMetaHeader cnmtHeader;
     memset(&cnmtHeader, 0, sizeof(NcmContentMetaHeader));
@@ -2305,81 +3296,103 @@ bool retrieveContentInfosFromTitle(NcmStorageId storageId, NcmContentMetaType me
     
     u32 written = 0, total = 0;
     
+    NcmApplicationContentMetaKey *sessionKeys = NULL;
+    u32 sessionKeyCnt = 0;
+    
     bool success = false;
     
     if (storageId != NcmStorageId_GameCard && storageId != NcmStorageId_SdCard && storageId != NcmStorageId_BuiltInUser)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid title storage ID!", __func__);
+        snprintf(errorBuf, errorBufSize, "%s: invalid title storage ID!", __func__);
         goto out;
     }
     
     if (metaType != NcmContentMetaType_Application && metaType != NcmContentMetaType_Patch && metaType != NcmContentMetaType_AddOnContent)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid title meta type!", __func__);
+        snprintf(errorBuf, errorBufSize, "%s: invalid title meta type!", __func__);
         goto out;
     }
     
     if (!titleCount)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid title type count!", __func__);
+        snprintf(errorBuf, errorBufSize, "%s: invalid title type count!", __func__);
         goto out;
     }
     
     if (titleIndex >= titleCount)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid title index!", __func__);
+        snprintf(errorBuf, errorBufSize, "%s: invalid title index!", __func__);
         goto out;
     }
     
     if (!outContentInfos || !outContentInfoCnt)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid output parameters!", __func__);
+        snprintf(errorBuf, errorBufSize, "%s: invalid output parameters!", __func__);
         goto out;
     }
     
-    titleList = calloc(1, titleListSize);
-    if (!titleList)
-    {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: unable to allocate memory for the ApplicationContentMetaKey struct!", __func__);
-        goto out;
-    }
+    // Both the content meta database and the key list are shared with the other callers during the current session (e.g. the batch prefetch thread)
+    mutexLock(&ncmSessionMutex);
+    sessionLocked = true;
     
-    result = ncmOpenContentMetaDatabase(&ncmDb, storageId);
-    if (R_FAILED(result))
+    ncmDb = getNcmSessionMetaDatabase(storageId, &result);
+    if (!ncmDb)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: ncmOpenContentMetaDatabase failed! (0x%08X)", __func__, result);
+        snprintf(errorBuf, errorBufSize, "%s: ncmOpenContentMetaDatabase failed! (0x%08X)", __func__, result);
         goto out;
     }
     
-    result = ncmContentMetaDatabaseListApplication(&ncmDb, (s32*)&total, (s32*)&written, titleList, (s32)titleCount, metaType);
-    if (R_FAILED(result))
+    sessionKeys = getNcmSessionKeyList(storageId, metaType, &sessionKeyCnt);
+    if (!sessionKeys)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: ncmContentMetaDatabaseListApplication failed! (0x%08X)", __func__, result);
-        goto out;
+        // Only list the titles from this storage once
+        titleList = calloc(1, titleListSize);
+        if (!titleList)
+        {
+            snprintf(errorBuf, errorBufSize, "%s: unable to allocate memory for the ApplicationContentMetaKey struct!", __func__);
+            goto out;
+        }
+        
+        result = ncmContentMetaDatabaseListApplication(ncmDb, (s32*)&total, (s32*)&written, titleList, (s32)titleCount, metaType);
+        if (R_FAILED(result))
+        {
+            snprintf(errorBuf, errorBufSize, "%s: ncmContentMetaDatabaseListApplication failed! (0x%08X)", __func__, result);
+            goto out;
+        }
+        
+        if (!written || !total)
+        {
+            snprintf(errorBuf, errorBufSize, "%s: ncmContentMetaDatabaseListApplication wrote no entries to output buffer!", __func__);
+            goto out;
+        }
+        
+        if (written != total)
+        {
+            snprintf(errorBuf, errorBufSize, "%s: title count mismatch in ncmContentMetaDatabaseListApplication! (%u != %u)", __func__, written, total);
+            goto out;
+        }
+        
+        setNcmSessionKeyList(storageId, metaType, titleList, total);
+        titleList = NULL;
+        
+        sessionKeys = getNcmSessionKeyList(storageId, metaType, &sessionKeyCnt);
     }
     
-    if (!written || !total)
+    if (titleIndex >= sessionKeyCnt)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: ncmContentMetaDatabaseListApplication wrote no entries to output buffer!", __func__);
+        snprintf(errorBuf, errorBufSize, "%s: provided title index exceeds title count from ncmContentMetaDatabaseListApplication!", __func__);
         goto out;
     }
     
-    if (written != total)
-    {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: title count mismatch in ncmContentMetaDatabaseListApplication! (%u != %u)", __func__, written, total);
-        goto out;
-    }
+    memcpy(&titleKey, &(sessionKeys[titleIndex].key), sizeof(NcmContentMetaKey));
     
-    if (titleIndex >= total)
-    {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: provided title index exceeds title count from ncmContentMetaDatabaseListApplication!", __func__);
-        goto out;
-    }
+    mutexUnlock(&ncmSessionMutex);
+    sessionLocked = false;
     
-    result = ncmContentMetaDatabaseGet(&ncmDb, &(titleList[titleIndex].key), &cnmtHeaderReadSize, &cnmtHeader, sizeof(NcmContentMetaHeader));
+    result = ncmContentMetaDatabaseGet(ncmDb, &titleKey, &cnmtHeaderReadSize, &cnmtHeader, sizeof(NcmContentMetaHeader));
     if (R_FAILED(result))
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: ncmContentMetaDatabaseGet failed! (0x%08X)", __func__, result);
+        snprintf(errorBuf, errorBufSize, "%s: ncmContentMetaDatabaseGet failed! (0x%08X)", __func__, result);
         goto out;
     }
     
@@ -2388,22 +3401,22 @@ bool retrieveContentInfosFromTitle(NcmStorageId storageId, NcmContentMetaType me
     titleContentInfos = calloc(titleContentInfoCnt, sizeof(NcmContentInfo));
     if (!titleContentInfos)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: unable to allocate memory for the title content information struct!", __func__);
+        snprintf(errorBuf, errorBufSize, "%s: unable to allocate memory for the title content information struct!", __func__);
         goto out;
     }
     
     written = 0;
     
-    result = ncmContentMetaDatabaseListContentInfo(&ncmDb, (s32*)&written, titleContentInfos, (s32)titleContentInfoCnt, &(titleList[titleIndex].key), 0);
+    result = ncmContentMetaDatabaseListContentInfo(ncmDb, (s32*)&written, titleContentInfos, (s32)titleContentInfoCnt, &titleKey, 0);
     if (R_FAILED(result))
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: ncmContentMetaDatabaseListContentInfo failed! (0x%08X)", __func__, result);
+        snprintf(errorBuf, errorBufSize, "%s: ncmContentMetaDatabaseListContentInfo failed! (0x%08X)", __func__, result);
         goto out;
     }
     
     if (written != titleContentInfoCnt)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: title content count mismatch in ncmContentMetaDatabaseListContentInfo! (%u != %u)", __func__, written, titleContentInfoCnt);
+        snprintf(errorBuf, errorBufSize, "%s: title content count mismatch in ncmContentMetaDatabaseListContentInfo! (%u != %u)", __func__, written, titleContentInfoCnt);
         goto out;
     }
     
@@ -2414,15 +3427,20 @@ bool retrieveContentInfosFromTitle(NcmStorageId storageId, NcmContentMetaType me
     *outContentInfoCnt = titleContentInfoCnt;
     
 out:
-    if (!success && titleContentInfos) free(titleContentInfos);
+    if (sessionLocked) mutexUnlock(&ncmSessionMutex);
     
-    ncmContentMetaDatabaseClose(&ncmDb);
+    if (!success && titleContentInfos) free(titleContentInfos);
     
     if (titleList) free(titleList);
     
     return success;
 }
 
+bool retrieveContentInfosFromTitle(NcmStorageId storageId, NcmContentMetaType metaType, u32 titleCount, u32 titleIndex, NcmContentInfo **outContentInfos, u32 *outContentInfoCnt)
+{
+    return retrieveContentInfosFromTitleEx(storageId, metaType, titleCount, titleIndex, outContentInfos, outContentInfoCnt, strbuf, MAX_CHARACTERS(strbuf));
+}
+
 void removeConsoleDataFromTicket(title_rights_ctx *rights_info)
 {
     if (!rights_info || !rights_info->has_rights_id || !rights_info->retrieved_tik || rights_info->missing_tik || rights_info->tik_data.titlekey_type != ETICKET_TITLEKEY_PERSONALIZED) return;
@@ -2723,7 +3741,7 @@ bool readNcaExeFsSection(u32 titleIndex, bool usePatch)
     }
     
     // Decrypt the NCA header
-    if (!decryptNcaHeader(ncaHeader, NCA_FULL_HEADER_LENGTH, &dec_nca_header, &rights_info, decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard || (curStorageId == NcmStorageId_GameCard && usePatch)))) goto out;
+    if (!decryptNcaHeader(ncaHeader, NCA_FULL_HEADER_LENGTH, &ncaId, &dec_nca_header, &rights_info, decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard || (curStorageId == NcmStorageId_GameCard && usePatch)))) goto out;
     
     if (curStorageId == NcmStorageId_GameCard)
     {
@@ -2892,7 +3910,7 @@ int readNcaRomFsSection(u32 titleIndex, selectedRomFsType curRomFsType, int desi
     }
     
     // Decrypt the NCA header
-    if (!decryptNcaHeader(ncaHeader, NCA_FULL_HEADER_LENGTH, &dec_nca_header, &rights_info, decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard || (curStorageId == NcmStorageId_GameCard && curRomFsType == ROMFS_TYPE_PATCH)))) goto out;
+    if (!decryptNcaHeader(ncaHeader, NCA_FULL_HEADER_LENGTH, &ncaId, &dec_nca_header, &rights_info, decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard || (curStorageId == NcmStorageId_GameCard && curRomFsType == ROMFS_TYPE_PATCH)))) goto out;
     
     if (curStorageId == NcmStorageId_GameCard)
     {
@@ -3079,15 +4097,14 @@ bool generateCurrentRomFsPath(u32 dir_offset, bool usePatch)
 
 bool getRomFsFileList(u32 dir_offset, bool usePatch)
 {
-    u64 entryOffset = 0;
     u32 dirEntryCnt = 1; // Always add the parent directory entry ("..")
     u32 fileEntryCnt = 0;
     u32 totalEntryCnt = 0;
-    u32 i = 1;
+    u32 i = 1, j;
     u32 romFsParentDir = 0;
     
-    u64 dirTableSize;
-    u64 fileTableSize;
+    romfs_index_t *index = NULL;
+    romfs_index_dir_entry *dirEntry = NULL;
     
     freeRomFsBrowserEntries();
     
@@ -3103,46 +4120,19 @@ bool getRomFsFileList(u32 dir_offset, bool usePatch)
     
     if (!generateCurrentRomFsPath(dir_offset, usePatch)) return false;
     
-    dirTableSize = (!usePatch ? romFsContext.romfs_dirtable_size : bktrContext.romfs_dirtable_size);
-    fileTableSize = (!usePatch ? romFsContext.romfs_filetable_size : bktrContext.romfs_filetable_size);
-    
-    // First count the directory entries
-    entryOffset = ROMFS_NONAME_DIRENTRY_SIZE; // Always skip the first entry (root directory)
+    // Child entries are retrieved from the RomFS index, so we don't need to walk both tables every time a directory is entered
+    index = getRomFsIndex(usePatch);
+    if (!index) return false;
     
-    while(entryOffset < dirTableSize)
+    dirEntry = getRomFsIndexDirEntry(index, dir_offset);
+    if (!dirEntry)
     {
-        romfs_dir *entry = (!usePatch ? (romfs_dir*)((u8*)romFsContext.romfs_dir_entries + entryOffset) : (romfs_dir*)((u8*)bktrContext.romfs_dir_entries + entryOffset));
-        
-        if (!entry->nameLen)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: directory entry without name in RomFS section!", __func__);
-            return false;
-        }
-        
-        // Only add entries inside the directory we're looking in
-        if (entry->parent == dir_offset) dirEntryCnt++;
-        
-        entryOffset += round_up(ROMFS_NONAME_DIRENTRY_SIZE + entry->nameLen, 4);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid RomFS directory entry offset! (0x%08X)", __func__, dir_offset);
+        return false;
     }
     
-    // Now count the file entries
-    entryOffset = 0;
-    
-    while(entryOffset < fileTableSize)
-    {
-        romfs_file *entry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + entryOffset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + entryOffset));
-        
-        if (!entry->nameLen)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: file entry without name in RomFS section!", __func__);
-            return false;
-        }
-        
-        // Only add entries inside the directory we're looking in
-        if (entry->parent == dir_offset) fileEntryCnt++;
-        
-        entryOffset += round_up(ROMFS_NONAME_FILEENTRY_SIZE + entry->nameLen, 4);
-    }
+    dirEntryCnt += dirEntry->child_dir_cnt;
+    fileEntryCnt = dirEntry->child_file_cnt;
     
     totalEntryCnt = (dirEntryCnt + fileEntryCnt);
     
@@ -3169,81 +4159,46 @@ bool getRomFsFileList(u32 dir_offset, bool usePatch)
     if (!addStringToFilenameBuffer(".."))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for parent dir entry in filename buffer!", __func__);
-        freeRomFsBrowserEntries();
-        return false;
-    }
-    
-    // Add parent directory entry ("..")
-    romFsBrowserEntries[0].type = ROMFS_ENTRY_DIR;
-    romFsBrowserEntries[0].offset = romFsParentDir;
-    
-    // First add the directory entries
-    if ((!romFsParentDir && dirEntryCnt > 1) || (romFsParentDir && dirEntryCnt > 0))
-    {
-        entryOffset = ROMFS_NONAME_DIRENTRY_SIZE; // Always skip the first entry (root directory)
-        
-        while(entryOffset < dirTableSize)
-        {
-            romfs_dir *entry = (!usePatch ? (romfs_dir*)((u8*)romFsContext.romfs_dir_entries + entryOffset) : (romfs_dir*)((u8*)bktrContext.romfs_dir_entries + entryOffset));
-            
-            // Only add entries inside the directory we're looking in
-            if (entry->parent == dir_offset)
-            {
-                romFsBrowserEntries[i].type = ROMFS_ENTRY_DIR;
-                romFsBrowserEntries[i].offset = entryOffset;
-                
-                snprintf(curName, entry->nameLen + 1, (char*)entry->name);
-                
-                // Fix entry name length
-                truncateBrowserEntryName(curName);
-                
-                if (!addStringToFilenameBuffer(curName))
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for filename entry in filename buffer!", __func__);
-                    freeRomFsBrowserEntries();
-                    return false;
-                }
-                
-                i++;
-            }
-            
-            entryOffset += round_up(ROMFS_NONAME_DIRENTRY_SIZE + entry->nameLen, 4);
-        }
+        freeRomFsBrowserEntries();
+        return false;
     }
     
-    // Now add the file entries
-    if (fileEntryCnt > 0)
+    // Add parent directory entry ("..")
+    romFsBrowserEntries[0].type = ROMFS_ENTRY_DIR;
+    romFsBrowserEntries[0].offset = romFsParentDir;
+    
+    // First add the directory entries, then the file entries
+    for(j = 0; j < (dirEntry->child_dir_cnt + dirEntry->child_file_cnt); j++, i++)
     {
-        entryOffset = 0;
+        u32 entryOffset = index->child_offsets[dirEntry->child_start + j];
         
-        while(entryOffset < fileTableSize)
+        if (j < dirEntry->child_dir_cnt)
         {
+            romfs_dir *entry = (!usePatch ? (romfs_dir*)((u8*)romFsContext.romfs_dir_entries + entryOffset) : (romfs_dir*)((u8*)bktrContext.romfs_dir_entries + entryOffset));
+            
+            romFsBrowserEntries[i].type = ROMFS_ENTRY_DIR;
+            romFsBrowserEntries[i].offset = entryOffset;
+            
+            snprintf(curName, entry->nameLen + 1, (char*)entry->name);
+        } else {
             romfs_file *entry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + entryOffset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + entryOffset));
             
-            // Only add entries inside the directory we're looking in
-            if (entry->parent == dir_offset)
-            {
-                romFsBrowserEntries[i].type = ROMFS_ENTRY_FILE;
-                romFsBrowserEntries[i].offset = entryOffset;
-                romFsBrowserEntries[i].sizeInfo.size = entry->dataSize;
-                convertSize(entry->dataSize, romFsBrowserEntries[i].sizeInfo.sizeStr, MAX_CHARACTERS(romFsBrowserEntries[i].sizeInfo.sizeStr));
-                
-                snprintf(curName, entry->nameLen + 1, (char*)entry->name);
-                
-                // Fix entry name length
-                truncateBrowserEntryName(curName);
-                
-                if (!addStringToFilenameBuffer(curName))
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for filename entry in filename buffer!", __func__);
-                    freeRomFsBrowserEntries();
-                    return false;
-                }
-                
-                i++;
-            }
+            romFsBrowserEntries[i].type = ROMFS_ENTRY_FILE;
+            romFsBrowserEntries[i].offset = entryOffset;
+            romFsBrowserEntries[i].sizeInfo.size = entry->dataSize;
+            convertSize(entry->dataSize, romFsBrowserEntries[i].sizeInfo.sizeStr, MAX_CHARACTERS(romFsBrowserEntries[i].sizeInfo.sizeStr));
             
-            entryOffset += round_up(ROMFS_NONAME_FILEENTRY_SIZE + entry->nameLen, 4);
+            snprintf(curName, entry->nameLen + 1, (char*)entry->name);
+        }
+        
+        // Fix entry name length
+        truncateBrowserEntryName(curName);
+        
+        if (!addStringToFilenameBuffer(curName))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for filename entry in filename buffer!", __func__);
+            freeRomFsBrowserEntries();
+            return false;
         }
     }
     
@@ -3720,37 +4675,37 @@ void waitForButtonPress()
     }
 }
 
-void printProgressBar(progress_ctx_t *progressCtx, bool calcData, u64 chunkSize)
+static void drawProgressBar(progress_ctx_t *progressCtx, bool calcData, u64 offset, u64 speedOffset)
 {
-    if (!progressCtx) return;
+    u64 startTick = perfTick();
     
     if (calcData)
     {
         timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx->now));
         
-        // Workaround to properly calculate speed for sequential dumps
-        u64 speedCurOffset = (progressCtx->seqDumpCurOffset ? progressCtx->seqDumpCurOffset : progressCtx->curOffset);
-        
-        progressCtx->lastSpeed = (((double)(speedCurOffset + chunkSize) / (double)MiB) / (double)(progressCtx->now - progressCtx->start));
+        progressCtx->lastSpeed = (((double)speedOffset / (double)MiB) / (double)(progressCtx->now - progressCtx->start));
         progressCtx->averageSpeed = ((SMOOTHING_FACTOR * progressCtx->lastSpeed) + ((1 - SMOOTHING_FACTOR) * progressCtx->averageSpeed));
         if (!isnormal(progressCtx->averageSpeed)) progressCtx->averageSpeed = SMOOTHING_FACTOR; // Very low values
         
-        progressCtx->remainingTime = (u64)(((double)(progressCtx->totalSize - (progressCtx->curOffset + chunkSize)) / (double)MiB) / progressCtx->averageSpeed);
+        progressCtx->remainingTime = (u64)(((double)(progressCtx->totalSize - offset) / (double)MiB) / progressCtx->averageSpeed);
         
-        progressCtx->progress = (u8)(((progressCtx->curOffset + chunkSize) * 100) / progressCtx->totalSize);
+        progressCtx->progress = (u8)((offset * 100) / progressCtx->totalSize);
     }
     
     formatETAString(progressCtx->remainingTime, progressCtx->etaInfo, MAX_CHARACTERS(progressCtx->etaInfo));
     
-    convertSize(progressCtx->curOffset + chunkSize, progressCtx->curOffsetStr, MAX_CHARACTERS(progressCtx->curOffsetStr));
+    convertSize(offset, progressCtx->curOffsetStr, MAX_CHARACTERS(progressCtx->curOffsetStr));
+    
+    // Don't let the main thread flush a half drawn progress bar
+    uiLockFramebuffer();
     
     uiFill(0, (progressCtx->line_offset * LINE_HEIGHT) + 8, FB_WIDTH / 4, LINE_HEIGHT * 2, BG_COLOR_RGB);
     uiDrawString(font_height * 2, STRING_Y_POS(progressCtx->line_offset), FONT_COLOR_RGB, "%.2lf MiB/s [ETA: %s]", progressCtx->averageSpeed, progressCtx->etaInfo);
     
-    if (progressCtx->totalSize && (progressCtx->curOffset + chunkSize) < progressCtx->totalSize)
+    if (progressCtx->totalSize && offset < progressCtx->totalSize)
     {
         uiFill(FB_WIDTH / 4, (progressCtx->line_offset * LINE_HEIGHT) + 10, FB_WIDTH / 2, LINE_HEIGHT, EMPTY_BAR_COLOR_RGB);
-        uiFill(FB_WIDTH / 4, (progressCtx->line_offset * LINE_HEIGHT) + 10, (((progressCtx->curOffset + chunkSize) * (u64)(FB_WIDTH / 2)) / progressCtx->totalSize), LINE_HEIGHT, FONT_COLOR_SUCCESS_RGB);
+        uiFill(FB_WIDTH / 4, (progressCtx->line_offset * LINE_HEIGHT) + 10, ((offset * (u64)(FB_WIDTH / 2)) / progressCtx->totalSize), LINE_HEIGHT, FONT_COLOR_SUCCESS_RGB);
     } else {
         uiFill(FB_WIDTH / 4, (progressCtx->line_offset * LINE_HEIGHT) + 10, FB_WIDTH / 2, LINE_HEIGHT, FONT_COLOR_SUCCESS_RGB);
     }
@@ -3758,28 +4713,30 @@ void printProgressBar(progress_ctx_t *progressCtx, bool calcData, u64 chunkSize)
     uiFill(FB_WIDTH - (FB_WIDTH / 4), (progressCtx->line_offset * LINE_HEIGHT) + 8, FB_WIDTH / 4, LINE_HEIGHT * 2, BG_COLOR_RGB);
     uiDrawString(FB_WIDTH - (FB_WIDTH / 4) + (font_height * 2), STRING_Y_POS(progressCtx->line_offset), FONT_COLOR_RGB, "%u%% [%s / %s]", progressCtx->progress, progressCtx->curOffsetStr, progressCtx->totalSizeStr);
     
+    // Stage timings view (toggled with the Y button)
+    if (dumpCfg.perfCfg.showStageTimes) perfDrawStages(progressCtx->line_offset + 1);
+    
     uiRefreshDisplay();
     uiUpdateStatusMsg();
+    
+    uiUnlockFramebuffer();
+    
+    perfAdd(PERF_STAGE_UI, startTick, 0);
 }
 
-void setProgressBarError(progress_ctx_t *progressCtx)
+static bool checkProgressInput(progress_ctx_t *progressCtx)
 {
-    if (!progressCtx) return;
+    scanPads();
     
-    if (progressCtx->totalSize && progressCtx->curOffset < progressCtx->totalSize)
+    // Toggle the stage timings view
+    if (getButtonsDown() & HidNpadButton_Y)
     {
-        uiFill(FB_WIDTH / 4, (progressCtx->line_offset * LINE_HEIGHT) + 10, FB_WIDTH / 2, LINE_HEIGHT, EMPTY_BAR_COLOR_RGB);
-        uiFill(FB_WIDTH / 4, (progressCtx->line_offset * LINE_HEIGHT) + 10, ((progressCtx->curOffset * (u64)(FB_WIDTH / 2)) / progressCtx->totalSize), LINE_HEIGHT, FONT_COLOR_ERROR_RGB);
-    } else {
-        uiFill(FB_WIDTH / 4, (progressCtx->line_offset * LINE_HEIGHT) + 10, FB_WIDTH / 2, LINE_HEIGHT, FONT_COLOR_ERROR_RGB);
+        dumpCfg.perfCfg.showStageTimes = !dumpCfg.perfCfg.showStageTimes;
+        if (!dumpCfg.perfCfg.showStageTimes) uiFill(0, ((progressCtx->line_offset + 1) * LINE_HEIGHT) + 10, FB_WIDTH, LINE_HEIGHT, BG_COLOR_RGB);
+        
+        // Don't write to the SD card in the middle of a dump
+        configDirty = true;
     }
-}
-
-bool cancelProcessCheck(progress_ctx_t *progressCtx)
-{
-    if (!progressCtx) return false;
-    
-    scanPads();
     
     progressCtx->cancelBtnState = (getButtonsHeld() & HidNpadButton_B);
     
@@ -3804,6 +4761,177 @@ bool cancelProcessCheck(progress_ctx_t *progressCtx)
     return false;
 }
 
+static bool drawPublishedProgress(progress_ctx_t *progressCtx, u32 *lastGen)
+{
+    bool calcData;
+    u64 offset, speedOffset;
+    
+    mutexLock(&(progressCtx->pubMutex));
+    
+    if (progressCtx->pubGen == *lastGen)
+    {
+        mutexUnlock(&(progressCtx->pubMutex));
+        return false;
+    }
+    
+    *lastGen = progressCtx->pubGen;
+    calcData = progressCtx->pubCalcData;
+    offset = progressCtx->pubOffset;
+    speedOffset = progressCtx->pubSpeedOffset;
+    
+    progressCtx->pubCalcData = false;
+    
+    mutexUnlock(&(progressCtx->pubMutex));
+    
+    drawProgressBar(progressCtx, calcData, offset, speedOffset);
+    
+    return true;
+}
+
+static void progressUiThreadFunc(void *arg)
+{
+    progress_ctx_t *progressCtx = (progress_ctx_t*)arg;
+    u32 lastGen = 0;
+    
+    while(!__atomic_load_n(&(progressCtx->uiThreadExit), __ATOMIC_ACQUIRE))
+    {
+        u64 frameStart = armGetSystemTick();
+        
+        // Only redraw if the dump loop published something new since the last frame
+        drawPublishedProgress(progressCtx, &lastGen);
+        
+        if (!__atomic_load_n(&(progressCtx->cancelRequested), __ATOMIC_RELAXED) && checkProgressInput(progressCtx)) __atomic_store_n(&(progressCtx->cancelRequested), true, __ATOMIC_RELEASE);
+        
+        u64 frameTime = armTicksToNs(armGetSystemTick() - frameStart);
+        if (frameTime < PROGRESS_UI_FRAME_TIME) svcSleepThread((s64)(PROGRESS_UI_FRAME_TIME - frameTime));
+    }
+}
+
+void progressUiThreadStart(progress_ctx_t *progressCtx)
+{
+    if (!progressCtx || progressCtx->uiThreadRunning) return;
+    
+    Result result;
+    s32 prio = 0x2C;
+    
+    mutexInit(&(progressCtx->pubMutex));
+    progressCtx->pubGen = 0;
+    progressCtx->uiThreadExit = progressCtx->cancelRequested = false;
+    
+    svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+    
+    // Higher priority than the dump loop on the same core: it only wakes up once per frame, and the dump loop spends most of its time waiting on IPC
+    result = threadCreate(&(progressCtx->uiThread), progressUiThreadFunc, progressCtx, NULL, PROGRESS_UI_THREAD_STACK_SIZE, (prio > 0 ? (prio - 1) : prio), -2);
+    if (R_FAILED(result)) return;
+    
+    result = threadStart(&(progressCtx->uiThread));
+    if (R_FAILED(result))
+    {
+        threadClose(&(progressCtx->uiThread));
+        return;
+    }
+    
+    progressCtx->uiThreadRunning = true;
+}
+
+void progressUiThreadStop(progress_ctx_t *progressCtx)
+{
+    if (!progressCtx || !progressCtx->uiThreadRunning) return;
+    
+    u32 lastGen = 0;
+    
+    __atomic_store_n(&(progressCtx->uiThreadExit), true, __ATOMIC_RELEASE);
+    threadWaitForExit(&(progressCtx->uiThread));
+    threadClose(&(progressCtx->uiThread));
+    
+    progressCtx->uiThreadRunning = false;
+    
+    // Make sure the last published progress (e.g. 100%) makes it to the screen
+    if (progressCtx->pubGen) drawPublishedProgress(progressCtx, &lastGen);
+}
+
+void printProgressBar(progress_ctx_t *progressCtx, bool calcData, u64 chunkSize)
+{
+    if (!progressCtx) return;
+    
+    // Workaround to properly calculate speed for sequential dumps
+    u64 offset = (progressCtx->curOffset + chunkSize);
+    u64 speedOffset = ((progressCtx->seqDumpCurOffset ? progressCtx->seqDumpCurOffset : progressCtx->curOffset) + chunkSize);
+    
+    if (!progressCtx->uiThreadRunning)
+    {
+        drawProgressBar(progressCtx, calcData, offset, speedOffset);
+        return;
+    }
+    
+    // Just publish the new snapshot - the progress UI thread takes care of drawing it
+    mutexLock(&(progressCtx->pubMutex));
+    
+    progressCtx->pubGen++;
+    progressCtx->pubCalcData |= calcData;
+    progressCtx->pubOffset = offset;
+    progressCtx->pubSpeedOffset = speedOffset;
+    
+    mutexUnlock(&(progressCtx->pubMutex));
+}
+
+void printProgressStatus(progress_ctx_t *progressCtx, progressStatusLine line, const char *fmt, ...)
+{
+    if (!progressCtx || line >= PROGRESS_STATUS_CNT) return;
+    
+    int lineOffset = (progressCtx->line_offset - (line == PROGRESS_STATUS_UPPER ? 4 : 2));
+    char status[NAME_BUF_LEN] = {'\0'};
+    u32 hash = 0;
+    
+    if (fmt)
+    {
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(status, MAX_CHARACTERS(status), fmt, args);
+        va_end(args);
+        
+        /* FNV-1a */
+        hash = 2166136261U;
+        for(const char *ptr = status; *ptr; ptr++) hash = ((hash ^ (u8)*ptr) * 16777619U);
+        
+        if (hash == progressCtx->statusHash[line]) return;
+    }
+    
+    progressCtx->statusHash[line] = hash;
+    
+    uiLockFramebuffer();
+    
+    uiFill(0, (lineOffset * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+    if (fmt) uiDrawString(STRING_X_POS, STRING_Y_POS(lineOffset), FONT_COLOR_RGB, "%s", status);
+    
+    uiUnlockFramebuffer();
+}
+
+void setProgressBarError(progress_ctx_t *progressCtx)
+{
+    if (!progressCtx) return;
+    
+    progressUiThreadStop(progressCtx);
+    
+    if (progressCtx->totalSize && progressCtx->curOffset < progressCtx->totalSize)
+    {
+        uiFill(FB_WIDTH / 4, (progressCtx->line_offset * LINE_HEIGHT) + 10, FB_WIDTH / 2, LINE_HEIGHT, EMPTY_BAR_COLOR_RGB);
+        uiFill(FB_WIDTH / 4, (progressCtx->line_offset * LINE_HEIGHT) + 10, ((progressCtx->curOffset * (u64)(FB_WIDTH / 2)) / progressCtx->totalSize), LINE_HEIGHT, FONT_COLOR_ERROR_RGB);
+    } else {
+        uiFill(FB_WIDTH / 4, (progressCtx->line_offset * LINE_HEIGHT) + 10, FB_WIDTH / 2, LINE_HEIGHT, FONT_COLOR_ERROR_RGB);
+    }
+}
+
+bool cancelProcessCheck(progress_ctx_t *progressCtx)
+{
+    if (!progressCtx) return false;
+    
+    // Input is polled by the progress UI thread
+    if (progressCtx->uiThreadRunning) return __atomic_load_n(&(progressCtx->cancelRequested), __ATOMIC_ACQUIRE);
+    
+    return checkProgressInput(progressCtx);
+}
+
 void convertDataToHexString(const u8 *data, const u32 dataSize, char *outBuf, const u32 outBufSize)
 {
     if (!data || !dataSize || !outBuf || !outBufSize || outBufSize < ((dataSize * 2) + 1)) return;
@@ -4053,84 +5181,264 @@ void removeDirectoryWithVerbose(const char *path, const char *msg)
     uiRefreshDisplay();
 }
 
-static bool parseNSWDBRelease(xmlDocPtr doc, xmlNodePtr cur, u32 crc)
+static int nswdbIndexEntryCmp(const void *a, const void *b)
 {
-    if (!doc || !cur) return false;
-    
-    xmlChar *key = NULL;
-    xmlNodePtr node = cur;
+    const nswdb_index_entry_t *entry1 = (const nswdb_index_entry_t*)a;
+    const nswdb_index_entry_t *entry2 = (const nswdb_index_entry_t*)b;
     
-    u32 xmlCrc = 0;
-    char xmlReleaseName[256] = {'\0'};
+    if (entry1->titleId != entry2->titleId) return (entry1->titleId < entry2->titleId ? -1 : 1);
+    if (entry1->imgCrc != entry2->imgCrc) return (entry1->imgCrc < entry2->imgCrc ? -1 : 1);
     
-    bool found = false;
+    return 0;
+}
+
+static bool addNSWDBIndexEntries(const char *titleIdStr, u32 crc, const char *releaseName, nswdb_index_entry_t **entries, u32 *entryCnt, u32 *entryCapacity, char **names, u32 *namesSize, u32 *namesCapacity)
+{
+    u32 i, nameLen = (strlen(releaseName) + 1);
+    bool nameAdded = false;
+    const char *ptr = titleIdStr;
     
-    while(node)
+    // A single release may list more than one Title ID
+    while(*ptr)
     {
-        if ((!xmlStrcmp(node->name, (const xmlChar*)NSWDB_XML_CHILD_IMGCRC)))
+        if (!isxdigit((unsigned char)*ptr))
         {
-            key = xmlNodeListGetString(doc, node->xmlChildrenNode, 1);
-            if (key) xmlCrc = strtoul((const char*)key, NULL, 16);
-        } else
-        if ((!xmlStrcmp(node->name, (const xmlChar*)NSWDB_XML_CHILD_RELEASENAME)))
+            ptr++;
+            continue;
+        }
+        
+        for(i = 0; i < 16 && isxdigit((unsigned char)ptr[i]); i++);
+        
+        if (i != 16 || isxdigit((unsigned char)ptr[i]))
         {
-            key = xmlNodeListGetString(doc, node->xmlChildrenNode, 1);
-            if (key) snprintf(xmlReleaseName, MAX_CHARACTERS(xmlReleaseName), "%s", (const char*)key);
+            while(isxdigit((unsigned char)*ptr)) ptr++;
+            continue;
+        }
+        
+        if (!nameAdded)
+        {
+            if ((*namesSize + nameLen) > *namesCapacity)
+            {
+                u32 newCapacity = (*namesCapacity ? (*namesCapacity * 2) : 0x10000);
+                while(newCapacity < (*namesSize + nameLen)) newCapacity *= 2;
+                
+                char *tmpNames = realloc(*names, newCapacity);
+                if (!tmpNames) return false;
+                
+                *names = tmpNames;
+                *namesCapacity = newCapacity;
+            }
+            
+            memcpy(*names + *namesSize, releaseName, nameLen);
+            nameAdded = true;
         }
         
-        if (key)
+        if (*entryCnt >= *entryCapacity)
         {
-            xmlFree(key);
-            key = NULL;
+            u32 newCapacity = (*entryCapacity ? (*entryCapacity * 2) : 0x800);
+            
+            nswdb_index_entry_t *tmpEntries = realloc(*entries, newCapacity * sizeof(nswdb_index_entry_t));
+            if (!tmpEntries) return false;
+            
+            *entries = tmpEntries;
+            *entryCapacity = newCapacity;
         }
         
-        node = node->next;
+        (*entries)[*entryCnt].titleId = strtoull(ptr, NULL, 16);
+        (*entries)[*entryCnt].imgCrc = crc;
+        (*entries)[*entryCnt].nameOffset = *namesSize;
+        (*entryCnt)++;
+        
+        ptr += 16;
     }
     
-    if (strlen(xmlReleaseName) && xmlCrc == crc)
+    if (nameAdded) *namesSize += nameLen;
+    
+    return true;
+}
+
+/* Converts the NSWDB.COM XML database into a sorted binary index, so dump checks don't need to parse the whole XML file. */
+static bool buildNSWDBIndex()
+{
+    struct stat xmlStat;
+    if (stat(NSWDB_XML_PATH, &xmlStat) != 0) return false;
+    
+    xmlDocPtr doc = NULL;
+    xmlNodePtr release = NULL, node = NULL;
+    xmlChar *key = NULL;
+    
+    nswdb_index_header_t header;
+    nswdb_index_entry_t *entries = NULL;
+    u32 entryCnt = 0, entryCapacity = 0;
+    
+    char *names = NULL;
+    u32 namesSize = 0, namesCapacity = 0;
+    
+    char titleIdStr[NAME_BUF_LEN / 4] = {'\0'};
+    char releaseName[NSWDB_RELEASE_NAME_LEN] = {'\0'};
+    u32 crc;
+    
+    FILE *indexFile = NULL;
+    bool success = false;
+    
+    doc = xmlParseFile(NSWDB_XML_PATH);
+    if (!doc) return false;
+    
+    release = xmlDocGetRootElement(doc);
+    if (!release || xmlStrcmp(release->name, (const xmlChar*)NSWDB_XML_ROOT) != 0) goto out;
+    
+    for(release = release->xmlChildrenNode; release; release = release->next)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Found matching Scene release: \"%s\" (CRC32: %08X). This is likely a good dump!", xmlReleaseName, xmlCrc);
-        found = true;
+        if (xmlStrcmp(release->name, (const xmlChar*)NSWDB_XML_CHILD) != 0) continue;
+        
+        titleIdStr[0] = '\0';
+        releaseName[0] = '\0';
+        crc = 0;
+        
+        for(node = release->xmlChildrenNode; node; node = node->next)
+        {
+            if ((!xmlStrcmp(node->name, (const xmlChar*)NSWDB_XML_CHILD_TITLEID)))
+            {
+                key = xmlNodeListGetString(doc, node->xmlChildrenNode, 1);
+                if (key) snprintf(titleIdStr, MAX_CHARACTERS(titleIdStr), "%s", (const char*)key);
+            } else
+            if ((!xmlStrcmp(node->name, (const xmlChar*)NSWDB_XML_CHILD_IMGCRC)))
+            {
+                key = xmlNodeListGetString(doc, node->xmlChildrenNode, 1);
+                if (key) crc = strtoul((const char*)key, NULL, 16);
+            } else
+            if ((!xmlStrcmp(node->name, (const xmlChar*)NSWDB_XML_CHILD_RELEASENAME)))
+            {
+                key = xmlNodeListGetString(doc, node->xmlChildrenNode, 1);
+                if (key) snprintf(releaseName, MAX_CHARACTERS(releaseName), "%s", (const char*)key);
+            }
+            
+            if (key)
+            {
+                xmlFree(key);
+                key = NULL;
+            }
+        }
+        
+        if (!strlen(titleIdStr) || !strlen(releaseName)) continue;
+        
+        if (!addNSWDBIndexEntries(titleIdStr, crc, releaseName, &entries, &entryCnt, &entryCapacity, &names, &namesSize, &namesCapacity)) goto out;
     }
     
-    return found;
+    if (!entryCnt) goto out;
+    
+    qsort(entries, entryCnt, sizeof(nswdb_index_entry_t), nswdbIndexEntryCmp);
+    
+    memset(&header, 0, sizeof(nswdb_index_header_t));
+    header.magic = NSWDB_INDEX_MAGIC;
+    header.entryCnt = entryCnt;
+    header.nameTableSize = namesSize;
+    header.xmlSize = (u64)xmlStat.st_size;
+    header.xmlModTime = (u64)xmlStat.st_mtime;
+    
+    indexFile = fopen(NSWDB_INDEX_PATH, "wb");
+    if (!indexFile) goto out;
+    
+    success = (fwrite(&header, 1, sizeof(nswdb_index_header_t), indexFile) == sizeof(nswdb_index_header_t));
+    if (success) success = (fwrite(entries, 1, (u64)entryCnt * sizeof(nswdb_index_entry_t), indexFile) == ((u64)entryCnt * sizeof(nswdb_index_entry_t)));
+    if (success) success = (fwrite(names, 1, namesSize, indexFile) == namesSize);
+    
+    fclose(indexFile);
+    
+    if (!success) remove(NSWDB_INDEX_PATH);
+    
+out:
+    if (names) free(names);
+    if (entries) free(entries);
+    
+    xmlFreeDoc(doc);
+    
+    return success;
 }
 
-static xmlXPathObjectPtr getXPathNodeSet(xmlDocPtr doc, char *xpathExpr)
+static bool openNSWDBIndex(FILE **outFile, nswdb_index_header_t *outHeader)
 {
-    if (!doc || !xpathExpr || !strlen(xpathExpr)) return NULL;
+    struct stat xmlStat;
+    bool xmlAvailable = (stat(NSWDB_XML_PATH, &xmlStat) == 0);
+    
+    FILE *indexFile = fopen(NSWDB_INDEX_PATH, "rb");
+    if (indexFile)
+    {
+        // Only rebuild the index if the XML database was replaced (the XML file may also be deleted once the index has been built)
+        if (fread(outHeader, 1, sizeof(nswdb_index_header_t), indexFile) == sizeof(nswdb_index_header_t) && outHeader->magic == NSWDB_INDEX_MAGIC && outHeader->entryCnt && (!xmlAvailable || (outHeader->xmlSize == (u64)xmlStat.st_size && outHeader->xmlModTime == (u64)xmlStat.st_mtime)))
+        {
+            *outFile = indexFile;
+            return true;
+        }
+        
+        fclose(indexFile);
+    }
     
-    xmlXPathContextPtr context = NULL;
-    xmlXPathObjectPtr result = NULL;
+    if (!xmlAvailable || !buildNSWDBIndex()) return false;
     
-    context = xmlXPathNewContext(doc);
-    if (!context) return NULL;
+    indexFile = fopen(NSWDB_INDEX_PATH, "rb");
+    if (!indexFile) return false;
+    
+    if (fread(outHeader, 1, sizeof(nswdb_index_header_t), indexFile) != sizeof(nswdb_index_header_t) || outHeader->magic != NSWDB_INDEX_MAGIC || !outHeader->entryCnt)
+    {
+        fclose(indexFile);
+        return false;
+    }
     
-    result = xmlXPathEvalExpression((xmlChar*)xpathExpr, context);
+    *outFile = indexFile;
     
-    xmlXPathFreeContext(context);
+    return true;
+}
+
+static bool lookupNSWDBIndex(FILE *indexFile, const nswdb_index_header_t *header, u64 titleId, u32 crc, char *outName, size_t outNameSize)
+{
+    u32 low = 0, high = header->entryCnt, mid;
+    nswdb_index_entry_t key, entry;
+    size_t read_res;
     
-    if (!result) return NULL;
+    key.titleId = titleId;
+    key.imgCrc = crc;
     
-    if (xmlXPathNodeSetIsEmpty(result->nodesetval))
+    // Binary search straight from the file - only a few entries are ever read
+    while(low < high)
     {
-        xmlXPathFreeObject(result);
-        return NULL;
+        mid = (low + ((high - low) / 2));
+        
+        fseek(indexFile, sizeof(nswdb_index_header_t) + ((u64)mid * sizeof(nswdb_index_entry_t)), SEEK_SET);
+        if (fread(&entry, 1, sizeof(nswdb_index_entry_t), indexFile) != sizeof(nswdb_index_entry_t)) return false;
+        
+        int cmp = nswdbIndexEntryCmp(&key, &entry);
+        if (!cmp) break;
+        
+        if (cmp < 0)
+        {
+            high = mid;
+        } else {
+            low = (mid + 1);
+        }
     }
     
-    return result;
+    if (low >= high || entry.nameOffset >= header->nameTableSize) return false;
+    
+    fseek(indexFile, sizeof(nswdb_index_header_t) + ((u64)header->entryCnt * sizeof(nswdb_index_entry_t)) + entry.nameOffset, SEEK_SET);
+    
+    read_res = fread(outName, 1, outNameSize - 1, indexFile);
+    outName[read_res] = '\0';
+    
+    return (strlen(outName) > 0);
 }
 
 void gameCardDumpNSWDBCheck(u32 crc)
 {
     if (menuType != MENUTYPE_GAMECARD || !titleAppCount || !baseAppEntries || !gameCardInfo.hfs0PartitionCnt) return;
     
-    u32 i, j;
-    xmlDocPtr doc = NULL;
+    u32 i;
+    FILE *indexFile = NULL;
+    nswdb_index_header_t header;
+    char releaseName[NSWDB_RELEASE_NAME_LEN] = {'\0'};
     bool found = false;
     
-    doc = xmlParseFile(NSWDB_XML_PATH);
-    if (!doc)
+    if (!openNSWDBIndex(&indexFile, &header))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open and/or parse \"%s\"!", __func__, NSWDB_XML_PATH);
         return;
@@ -4138,26 +5446,18 @@ void gameCardDumpNSWDBCheck(u32 crc)
     
     for(i = 0; i < titleAppCount; i++)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "//%s/%s[.//%s[contains(.,'%016lX')]]", NSWDB_XML_ROOT, NSWDB_XML_CHILD, NSWDB_XML_CHILD_TITLEID, baseAppEntries[i].titleId);
-        
-        xmlXPathObjectPtr nodeSet = getXPathNodeSet(doc, strbuf);
-        if (!nodeSet) continue;
-        
-        for(j = 0; j < (u32)nodeSet->nodesetval->nodeNr; j++)
-        {
-            xmlNodePtr node = nodeSet->nodesetval->nodeTab[j]->xmlChildrenNode;
-            found = parseNSWDBRelease(doc, node, crc);
-            if (found) break;
-        }
-        
-        xmlXPathFreeObject(nodeSet);
-        
+        found = lookupNSWDBIndex(indexFile, &header, baseAppEntries[i].titleId, crc, releaseName, MAX_ELEMENTS(releaseName));
         if (found) break;
     }
     
-    xmlFreeDoc(doc);
+    fclose(indexFile);
     
-    if (!found) uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "No match found in NSWDB.COM XML database! This could either be a bad dump or an undumped gamecard.");
+    if (found)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Found matching Scene release: \"%s\" (CRC32: %08X). This is likely a good dump!", releaseName, crc);
+    } else {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "No match found in NSWDB.COM XML database! This could either be a bad dump or an undumped gamecard.");
+    }
 }
 
 static Result networkInit()
@@ -4376,6 +5676,20 @@ out:
     {
         remove(NSWDB_XML_PATH);
         rename(xmlPath, NSWDB_XML_PATH);
+        
+        // Convert the XML database right away, so it doesn't have to be parsed after a dump
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Building XML database index, please wait...");
+        uiRefreshDisplay();
+        breaks++;
+        
+        if (buildNSWDBIndex())
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Successfully built XML database index!");
+        } else {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to build XML database index! It will be built during the next dump check.", __func__);
+        }
+        
+        breaks++;
     } else {
         remove(xmlPath);
     }
@@ -18,9 +18,17 @@
 #define TICKET_PATH                     APP_BASE_PATH "Ticket/"
 
 #define CONFIG_PATH                     APP_BASE_PATH "config.bin"
+#define KEY_OFFSETS_PATH                APP_BASE_PATH "keyoffsets.bin"
+#define TITLE_CACHE_PATH                APP_BASE_PATH "titlecache.bin"
+#define TITLE_ICON_PATH                 APP_BASE_PATH "Icons/"
+#define DUMPED_TITLES_PATH              APP_BASE_PATH "dumpedtitles.bin"
+#define NCA_STORE_PATH                  NSP_DUMP_PATH "Store/"
+#define PERF_LOG_PATH                   APP_BASE_PATH "perflog.csv"
+#define NCA_META_CACHE_PATH             APP_BASE_PATH "ncametacache.bin"
 #define NRO_NAME                        APP_TITLE ".nro"
 #define NRO_PATH                        APP_BASE_PATH NRO_NAME
 #define NSWDB_XML_PATH                  APP_BASE_PATH "NSWreleases.xml"
+#define NSWDB_INDEX_PATH                APP_BASE_PATH "NSWreleases.bin"
 #define KEYS_FILE_PATH                  HBLOADER_BASE_PATH "prod.keys"
 
 #define CFW_PATH_ATMOSPHERE             "sdmc:/atmosphere/contents/"
@@ -44,6 +52,9 @@
 #define NSWDB_XML_CHILD_IMGCRC          "imgcrc"
 #define NSWDB_XML_CHILD_RELEASENAME     "releasename"
 
+#define NSWDB_INDEX_MAGIC               (u32)0x4957534E                         // "NSWI"
+#define NSWDB_RELEASE_NAME_LEN          0x100
+
 #define LOCKPICK_RCM_URL                "https://github.com/shchmue/Lockpick_RCM"
 
 #define KiB                             (1024.0)
@@ -55,8 +66,12 @@
 #define DUMP_BUFFER_SIZE                (u64)0x400000		                    // 4 MiB (4194304 bytes)
 
 #define GAMECARD_READ_BUFFER_SIZE       DUMP_BUFFER_SIZE                        // 4 MiB (4194304 bytes)
+#define GAMECARD_READ_AHEAD_SIZE        (u64)0x10000                            // 64 KiB (65536 bytes). Unaligned gamecard reads smaller than this are served from a read-ahead window
 
-#define NCA_CTR_BUFFER_SIZE             DUMP_BUFFER_SIZE                        // 4 MiB (4194304 bytes)
+#define DUMP_BLOCK_SIZE_MIN             (u64)0x100000                           // 1 MiB (1048576 bytes)
+#define DUMP_BLOCK_SIZE_CNT             4                                       // 1, 2, 4 and 8 MiB blocks
+#define DUMP_BLOCK_SIZE(idx)            (DUMP_BLOCK_SIZE_MIN << (idx))
+#define DUMP_BLOCK_SIZE_APPLET_CNT      3                                       // Up to DUMP_BUFFER_SIZE blocks in applet mode
 
 #define NSP_XML_BUFFER_SIZE             (u64)0xA00000                           // 10 MiB (10485760 bytes)
 
@@ -101,6 +116,18 @@
 #define NACP_ICON_SQUARE_DIMENSION      256
 #define NACP_ICON_DOWNSCALED            96
 
+#define TITLE_CACHE_MAGIC               (u32)0x43544E58                         // "XNTC"
+
+#define TITLE_ICON_SIZE                 (NACP_ICON_DOWNSCALED * NACP_ICON_DOWNSCALED * 3)   // RGB888 image, as generated by uiLoadJpgFromMem()
+#define TITLE_ICON_PREFETCH_CNT         3                                       // Rows decoded ahead of the visible ones, in both directions
+#define TITLE_ICON_EVICT_DISTANCE       12                                      // Decoded icons this many rows away from the visible ones are freed
+
+#define TITLE_ICON_STATE_NONE           0
+#define TITLE_ICON_STATE_FAILED         1
+
+#define NCM_SESSION_STORAGE_CNT         3                                       // Gamecard, SD card and eMMC (user)
+#define NCM_SESSION_META_TYPE_CNT       3                                       // Base applications, patches and add-on contents
+
 #define round_up(x, y)                  ((x) + (((y) - ((x) % (y))) % (y)))			// Aligns 'x' bytes to a 'y' bytes boundary
 
 #define ORPHAN_ENTRY_TYPE_PATCH         1
@@ -118,6 +145,9 @@
 
 #define CANCEL_BTN_SEC_HOLD             2                           // The cancel button must be held for at least CANCEL_BTN_SEC_HOLD seconds to cancel an ongoing operation
 
+#define PROGRESS_UI_FRAME_TIME          (u64)33333333               // 30 FPS (in nanoseconds)
+#define PROGRESS_UI_THREAD_STACK_SIZE   0x10000
+
 typedef struct {
     u8 signature[0x100];
     u32 magic;
@@ -141,6 +171,11 @@ typedef struct {
     u8 encryptedInfoBlock[0x70];
 } PACKED gamecard_header_t;
 
+typedef struct {
+    const char *name;                                                           // Points to the HFS0 partition header string table
+    u32 index;                                                                  // HFS0 file entry index
+} hfs0_name_index_entry;
+
 typedef struct {
     u64 offset;
     u64 size;
@@ -148,6 +183,7 @@ typedef struct {
     u64 header_size;
     u32 file_cnt;
     u32 str_table_size;
+    hfs0_name_index_entry *name_index;                                          // file_cnt entries sorted by name. May be NULL, in which case lookups fall back to a linear search
 } PACKED hfs0_partition_info;
 
 typedef enum {
@@ -188,9 +224,12 @@ typedef struct {
     char fixedName[NACP_APPNAME_LEN];
     char author[NACP_AUTHOR_LEN];
     char versionStr[VERSION_STR_LEN];
-    u8 *icon;
+    u8 *icon;                                       // Decoded on demand by the title icon thread - NULL until then
+    u8 iconState;
+    u32 nacpVersion;                                // Installed patch version the Control.nacp data (and icon) comes from - 0 if there's no patch
     u64 contentSize;
     char contentSizeStr[32];
+    bool contentSizeLoaded;                         // Content sizes are calculated on demand by loadTitleContentSize()
 } base_app_ctx_t;
 
 typedef struct {
@@ -201,8 +240,63 @@ typedef struct {
     char versionStr[VERSION_STR_LEN];
     u64 contentSize;
     char contentSizeStr[32];
+    bool contentSizeLoaded;                         // Content sizes are calculated on demand by loadTitleContentSize()
 } patch_addon_ctx_t;
 
+// Built from NSWDB_XML_PATH. Followed by the entry table (sorted by Title ID and CRC32) and the NULL-terminated release name table
+typedef struct {
+    u32 magic;
+    u32 entryCnt;
+    u32 nameTableSize;
+    u32 reserved;
+    u64 xmlSize;                                    // Used to detect XML database changes
+    u64 xmlModTime;
+} nswdb_index_header_t;
+
+typedef struct {
+    u64 titleId;
+    u32 imgCrc;
+    u32 nameOffset;                                 // Relative to the start of the release name table
+} nswdb_index_entry_t;
+
+typedef struct {
+    u32 magic;
+    u32 entryCnt;
+    u64 languageCode;                               // System language used to retrieve the cached names
+} title_cache_header_t;
+
+// Entries are sorted by Title ID, storage ID, content meta type and version
+// Base application entries are only stored if their Control.nacp name and author were successfully retrieved
+// Control.nacp data comes from the installed patch (if available), so base application entries also store the patch version it was retrieved under
+// A zero content size means it wasn't calculated before the cache was saved - it'll be calculated on demand
+// Decoded icons are stored separately at TITLE_ICON_PATH, so they can be loaded on demand
+typedef struct {
+    u64 titleId;
+    u32 version;
+    u8 storageId;
+    u8 metaType;
+    u8 reserved[2];
+    u64 contentSize;
+    char name[NACP_APPNAME_LEN];
+    char author[NACP_AUTHOR_LEN];
+    u32 nacpVersion;                                // Installed patch version when the name and author were retrieved - 0 if there was no patch
+    u8 reserved2[4];
+} title_cache_entry_t;
+
+typedef struct {
+    title_cache_entry_t *entries;
+    u32 entryCnt;
+} title_cache_t;
+
+// Content meta database kept open until the title list is freed, along with the application content meta keys listed from it
+// This way, looking up the content records from a title doesn't involve reopening the database and listing every title again
+typedef struct {
+    bool dbOpen;
+    NcmContentMetaDatabase ncmDb;
+    NcmApplicationContentMetaKey *keys[NCM_SESSION_META_TYPE_CNT];
+    u32 keyCnt[NCM_SESSION_META_TYPE_CNT];
+} ncm_session_storage_t;
+
 typedef struct {
     u32 index;
     u8 type; // 1 = Patch, 2 = AddOn
@@ -227,6 +321,19 @@ typedef struct {
     u8 hashed_region_sha256[0x20];
 } PACKED hfs0_file_entry;
 
+typedef struct {
+    u32 partition;
+    u32 index;
+    u64 offset;                                                                 // Relative to the start of the IStorage partition holding the HFS0 partition (header size already included)
+    u64 size;
+} hfs0_file_handle;
+
+typedef enum {
+    PROGRESS_STATUS_UPPER = 0,                                      // Drawn at (line_offset - 4)
+    PROGRESS_STATUS_LOWER,                                          // Drawn at (line_offset - 2)
+    PROGRESS_STATUS_CNT
+} progressStatusLine;
+
 typedef struct {
     int line_offset;
     u64 totalSize;
@@ -245,6 +352,16 @@ typedef struct {
     u32 cancelBtnStatePrev;
     u64 cancelStartTmr;
     u64 cancelEndTmr;
+    Thread uiThread;                                                // Draws the progress bar and handles input while a dump is running
+    bool uiThreadRunning;
+    bool uiThreadExit;
+    Mutex pubMutex;                                                 // Protects the published progress snapshot below
+    u32 pubGen;                                                     // Incremented on every publish
+    bool pubCalcData;
+    u64 pubOffset;                                                  // Current offset + chunk size
+    u64 pubSpeedOffset;
+    bool cancelRequested;
+    u32 statusHash[PROGRESS_STATUS_CNT];                            // Used by printProgressStatus() to skip redrawing unchanged status lines
 } progress_ctx_t;
 
 typedef enum {
@@ -259,6 +376,13 @@ typedef enum {
     TICKET_TYPE_ADDON
 } selectedTicketType;
 
+typedef enum {
+    DUMP_OUTPUT_SDCARD = 0,
+    DUMP_OUTPUT_USB,
+    DUMP_OUTPUT_TCP,
+    DUMP_OUTPUT_CNT
+} dumpOutputTarget;
+
 typedef struct {
     bool isFat32;
     bool setXciArchiveBit;
@@ -267,6 +391,9 @@ typedef struct {
     bool calcCrc;
     bool useNoIntroLookup;
     bool useBrackets;
+    dumpOutputTarget outputTarget;
+    bool verifyHashes;
+    bool compressOutput;
 } PACKED xciOptions;
 
 typedef struct {
@@ -277,6 +404,8 @@ typedef struct {
     bool npdmAcidRsaPatch;
     bool dumpDeltaFragments;
     bool useBrackets;
+    bool compressOutput;
+    dumpOutputTarget outputTarget;
 } PACKED nspOptions;
 
 typedef enum {
@@ -300,6 +429,7 @@ typedef struct {
     bool haltOnErrors;
     bool useBrackets;
     batchModeSourceStorage batchModeSrc;
+    bool ncaDedup;
 } PACKED batchOptions;
 
 typedef struct {
@@ -311,6 +441,33 @@ typedef struct {
     bool useLayeredFSDir;
 } PACKED ncaFsOptions;
 
+typedef enum {
+    DUMP_BLOCK_SOURCE_GAMECARD = 0,
+    DUMP_BLOCK_SOURCE_SDCARD,
+    DUMP_BLOCK_SOURCE_EMMC,
+    DUMP_BLOCK_SOURCE_CNT
+} dumpBlockSource;
+
+// Throughput measured by the dump block size benchmark, in KiB/s. Zero if it wasn't measured
+typedef struct {
+    u32 readSpeed[DUMP_BLOCK_SOURCE_CNT][DUMP_BLOCK_SIZE_CNT];
+    u32 crc32Speed[DUMP_BLOCK_SIZE_CNT];
+    u32 sha256Speed[DUMP_BLOCK_SIZE_CNT];
+    u32 sdCardWriteSpeed[DUMP_BLOCK_SIZE_CNT];
+} PACKED blockSizeOptions;
+
+typedef struct {
+    bool showStageTimes;
+} PACKED perfOptions;
+
+typedef struct {
+    bool keepOnSdCard;                                                          // Save the NCA metadata cache to NCA_META_CACHE_PATH on exit and load it on startup
+} PACKED ncaMetaCacheOptions;
+
+typedef struct {
+    u32 budgetMiB;                                                              // NCA block cache memory budget. Zero disables the cache
+} PACKED ncaCacheOptions;
+
 typedef struct {
     xciOptions xciDumpCfg;
     nspOptions nspDumpCfg;
@@ -318,11 +475,18 @@ typedef struct {
     ticketOptions tikDumpCfg;
     ncaFsOptions exeFsDumpCfg;
     ncaFsOptions romFsDumpCfg;
+    blockSizeOptions blockSizeCfg;
+    perfOptions perfCfg;
+    ncaMetaCacheOptions ncaMetaCacheCfg;
+    ncaCacheOptions ncaCacheCfg;
 } PACKED dumpOptions;
 
 void loadConfig();
 void saveConfig();
 
+/* Saves the configuration file if a setting was changed while dumping (e.g. the stage timings view toggle). */
+void saveConfigIfDirty();
+
 void closeGameCardStoragePartition();
 Result openGameCardStoragePartition(openIStoragePartition partitionIndex);
 Result readGameCardStoragePartition(u64 off, void *buf, size_t len);
@@ -371,10 +535,22 @@ void strtrim(char *str);
 
 void loadTitleInfo();
 
+/* Calculates the content size from a title, if it hasn't been calculated yet. Called right before a title size is displayed or needed by a batch dump. */
+void loadTitleContentSize(NcmContentMetaType metaType, u32 titleIndex);
+
+void requestTitleIcons(u32 index, u32 count);
+bool titleIconsUpdated();
+
 void truncateBrowserEntryName(char *str);
 
 bool getHfs0FileList(u32 partition);
 
+/* Resolves a file from a HFS0 partition using the name index built when the gamecard was inserted. Callers that read the same file more than once can keep the handle. */
+bool getHfs0FileHandleByName(u32 partition, const char *filename, hfs0_file_handle *out);
+
+/* Reads data from a resolved HFS0 file. The IStorage partition holding the HFS0 partition must have been opened beforehand. */
+bool readHfs0FileByHandle(const hfs0_file_handle *handle, u64 offset, void *outBuf, size_t bufSize);
+
 bool readFileFromSecureHfs0PartitionByName(const char *filename, u64 offset, void *outBuf, size_t bufSize);
 
 bool calculateExeFsExtractedDataSize(u64 *out);
@@ -383,6 +559,9 @@ bool calculateRomFsFullExtractedSize(bool usePatch, u64 *out);
 
 bool calculateRomFsExtractedDirSize(u32 dir_offset, bool usePatch, u64 *out);
 
+// Error messages are stored in the provided buffer instead of strbuf, which lets worker threads use this function
+bool retrieveContentInfosFromTitleEx(NcmStorageId storageId, NcmContentMetaType metaType, u32 titleCount, u32 titleIndex, NcmContentInfo **outContentInfos, u32 *outContentInfoCnt, char *errorBuf, size_t errorBufSize);
+
 bool retrieveContentInfosFromTitle(NcmStorageId storageId, NcmContentMetaType metaType, u32 titleCount, u32 titleIndex, NcmContentInfo **outContentInfos, u32 *outContentInfoCnt);
 
 void removeConsoleDataFromTicket(title_rights_ctx *rights_info);
@@ -419,8 +598,21 @@ u32 retrieveLastPatchOrAddOnIndexFromBaseApplication(u32 appIndex, bool addOn);
 
 void waitForButtonPress();
 
+/* Starts a thread that redraws the progress bar and polls the cancel / stage timings buttons at a fixed frame rate. */
+/* Once it's running, printProgressBar() and cancelProcessCheck() only publish / read a progress snapshot, keeping framebuffer flushes out of the dump loops. */
+/* If the thread can't be started, both functions keep working synchronously. */
+void progressUiThreadStart(progress_ctx_t *progressCtx);
+
+/* Stops the progress UI thread (if running) and synchronously draws the last published progress. Must be called before progressCtx goes out of scope. */
+void progressUiThreadStop(progress_ctx_t *progressCtx);
+
 void printProgressBar(progress_ctx_t *progressCtx, bool calcData, u64 chunkSize);
 
+/* Draws one of the status lines above the progress bar (output file, current entry, etc.), but only if its contents changed since the last call. */
+/* A NULL fmt clears the line. */
+void printProgressStatus(progress_ctx_t *progressCtx, progressStatusLine line, const char *fmt, ...);
+
+/* Also stops the progress UI thread. */
 void setProgressBarError(progress_ctx_t *progressCtx);
 
 bool cancelProcessCheck(progress_ctx_t *progressCtx);
@@ -0,0 +1,339 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "verify.h"
+#include "keys.h"
+#include "ui.h"
+#include "util.h"
+
+/* Extern variables */
+
+extern nca_keyset_t nca_keyset;
+
+extern int breaks;
+
+extern gamecard_ctx_t gameCardInfo;
+
+/* The HFS0 hashed regions only cover the partition headers and the start of each file (usually 0x200 bytes), so checking them while the data is being dumped is cheap */
+/* This is a lot better than reading the whole gamecard a second time to validate it */
+
+static int verifyRegionCompare(const void *a, const void *b)
+{
+    const verify_region_t *regionA = (const verify_region_t*)a;
+    const verify_region_t *regionB = (const verify_region_t*)b;
+    
+    if (regionA->offset != regionB->offset) return (regionA->offset < regionB->offset ? -1 : 1);
+    
+    return ((int)regionA->type - (int)regionB->type);
+}
+
+static bool verifyAllocRegions(verify_ctx_t *ctx, u32 maxRegionCnt)
+{
+    if (!ctx || !maxRegionCnt || !gameCardInfo.rootHfs0Header || !gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions) return false;
+    
+    memset(ctx, 0, sizeof(verify_ctx_t));
+    ctx->firstMismatch = -1;
+    
+    ctx->regions = calloc(maxRegionCnt, sizeof(verify_region_t));
+    
+    return (ctx->regions != NULL);
+}
+
+static void verifyAddRegion(verify_ctx_t *ctx, verifyRegionType type, u32 partition, const char *name, u64 offset, u64 size, const u8 *hash)
+{
+    if (!size) return;
+    
+    verify_region_t *region = &(ctx->regions[ctx->regionCnt]);
+    memset(region, 0, sizeof(verify_region_t));
+    
+    if (type == VERIFY_REGION_NCA_HEADER)
+    {
+        region->ncaHeader = malloc(NCA_FULL_HEADER_LENGTH);
+        if (!region->ncaHeader) return;
+    } else {
+        memcpy(region->hash, hash, SHA256_HASH_SIZE);
+        sha256ContextCreate(&(region->hashCtx));
+    }
+    
+    region->offset = offset;
+    region->size = size;
+    region->name = name;
+    region->partition = partition;
+    region->type = (u8)type;
+    region->status = VERIFY_STATUS_PENDING;
+    
+    ctx->regionCnt++;
+}
+
+static void verifyAddFileRegions(verify_ctx_t *ctx, u32 partition, u32 fileIndex, u64 partitionOffset)
+{
+    hfs0_partition_info *partitionInfo = &(gameCardInfo.hfs0Partitions[partition]);
+    hfs0_file_entry entry;
+    
+    memcpy(&entry, partitionInfo->header + sizeof(hfs0_header) + (fileIndex * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
+    
+    const char *name = (const char*)(partitionInfo->header + sizeof(hfs0_header) + (partitionInfo->file_cnt * sizeof(hfs0_file_entry)) + entry.filename_offset);
+    size_t nameLen = strlen(name);
+    
+    u64 fileOffset = (partitionOffset + partitionInfo->header_size + entry.file_offset);
+    
+    verifyAddRegion(ctx, VERIFY_REGION_FILE, partition, name, fileOffset, entry.hashed_region_size, entry.hashed_region_sha256);
+    
+    // The NCA header key is needed to check the FS section header hashes
+    if (nca_keyset.total_key_cnt > 0 && entry.file_size >= NCA_FULL_HEADER_LENGTH && nameLen > 4 && !strcasecmp(name + nameLen - 4, ".nca"))
+    {
+        verifyAddRegion(ctx, VERIFY_REGION_NCA_HEADER, partition, name, fileOffset, NCA_FULL_HEADER_LENGTH, NULL);
+    }
+}
+
+static void verifyAddPartitionRegions(verify_ctx_t *ctx, u32 partition, u64 partitionOffset)
+{
+    hfs0_file_entry rootEntry;
+    u32 i;
+    
+    memcpy(&rootEntry, gameCardInfo.rootHfs0Header + sizeof(hfs0_header) + (partition * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
+    
+    verifyAddRegion(ctx, VERIFY_REGION_PARTITION_HEADER, partition, NULL, partitionOffset, rootEntry.hashed_region_size, rootEntry.hashed_region_sha256);
+    
+    for(i = 0; i < gameCardInfo.hfs0Partitions[partition].file_cnt; i++) verifyAddFileRegions(ctx, partition, i, partitionOffset);
+}
+
+static bool verifyNcaHeader(const u8 *ncaHeader)
+{
+    Aes128XtsContext hdr_aes_ctx;
+    nca_header_t dec_header;
+    u8 hash[SHA256_HASH_SIZE];
+    u32 i, magic;
+    
+    aes128XtsContextCreate(&hdr_aes_ctx, nca_keyset.header_key, nca_keyset.header_key + 0x10, false);
+    
+    if (aes128XtsNintendoCrypt(&hdr_aes_ctx, &dec_header, ncaHeader, NCA_HEADER_LENGTH, 0, false) != NCA_HEADER_LENGTH) return false;
+    
+    magic = __builtin_bswap32(dec_header.magic);
+    
+    if (magic == NCA3_MAGIC)
+    {
+        if (aes128XtsNintendoCrypt(&hdr_aes_ctx, &dec_header, ncaHeader, NCA_FULL_HEADER_LENGTH, 0, false) != NCA_FULL_HEADER_LENGTH) return false;
+    } else
+    if (magic == NCA2_MAGIC)
+    {
+        // NCA2 FS section headers are encrypted on their own, each one of them using sector zero
+        for(i = 0; i < NCA_SECTION_HEADER_CNT; i++)
+        {
+            if (aes128XtsNintendoCrypt(&hdr_aes_ctx, &(dec_header.fs_headers[i]), ncaHeader + NCA_HEADER_LENGTH + (i * NCA_SECTION_HEADER_LENGTH), NCA_SECTION_HEADER_LENGTH, 0, false) != NCA_SECTION_HEADER_LENGTH) return false;
+        }
+    } else {
+        return false;
+    }
+    
+    for(i = 0; i < NCA_SECTION_HEADER_CNT; i++)
+    {
+        if (dec_header.section_entries[i].media_end_offset <= dec_header.section_entries[i].media_start_offset) continue;
+        
+        sha256CalculateHash(hash, &(dec_header.fs_headers[i]), NCA_SECTION_HEADER_LENGTH);
+        if (memcmp(hash, dec_header.section_hashes[i], SHA256_HASH_SIZE) != 0) return false;
+    }
+    
+    return true;
+}
+
+static void verifyFinishRegion(verify_ctx_t *ctx, u32 idx)
+{
+    verify_region_t *region = &(ctx->regions[idx]);
+    bool match = false;
+    
+    if (region->type == VERIFY_REGION_NCA_HEADER)
+    {
+        match = verifyNcaHeader(region->ncaHeader);
+        
+        free(region->ncaHeader);
+        region->ncaHeader = NULL;
+    } else {
+        u8 hash[SHA256_HASH_SIZE];
+        sha256ContextGetHash(&(region->hashCtx), hash);
+        match = !memcmp(hash, region->hash, SHA256_HASH_SIZE);
+    }
+    
+    if (match)
+    {
+        region->status = VERIFY_STATUS_MATCH;
+        ctx->matchCnt++;
+    } else {
+        region->status = VERIFY_STATUS_MISMATCH;
+        ctx->mismatchCnt++;
+        if (ctx->firstMismatch < 0) ctx->firstMismatch = (s32)idx;
+    }
+}
+
+static void verifySortRegions(verify_ctx_t *ctx)
+{
+    if (ctx->regionCnt > 1) qsort(ctx->regions, ctx->regionCnt, sizeof(verify_region_t), verifyRegionCompare);
+}
+
+bool verifyInitXci(verify_ctx_t *ctx)
+{
+    u32 i, maxRegionCnt = (1 + gameCardInfo.hfs0PartitionCnt);
+    hfs0_file_entry rootEntry;
+    
+    if (gameCardInfo.hfs0Partitions)
+    {
+        for(i = 0; i < gameCardInfo.hfs0PartitionCnt; i++)
+        {
+            if (!gameCardInfo.hfs0Partitions[i].header) return false;
+            maxRegionCnt += (gameCardInfo.hfs0Partitions[i].file_cnt * 2);
+        }
+    }
+    
+    if (!verifyAllocRegions(ctx, maxRegionCnt)) return false;
+    
+    verifyAddRegion(ctx, VERIFY_REGION_ROOT_HEADER, 0, NULL, gameCardInfo.header.rootHfs0HeaderOffset, gameCardInfo.header.rootHfs0HeaderSize, gameCardInfo.header.rootHfs0HeaderHash);
+    
+    for(i = 0; i < gameCardInfo.hfs0PartitionCnt; i++)
+    {
+        // Use the XCI offset for every partition, including the secure one (its stored offset is relative to the secure IStorage partition)
+        memcpy(&rootEntry, gameCardInfo.rootHfs0Header + sizeof(hfs0_header) + (i * sizeof(hfs0_file_entry)), sizeof(hfs0_file_entry));
+        verifyAddPartitionRegions(ctx, i, gameCardInfo.header.rootHfs0HeaderOffset + gameCardInfo.header.rootHfs0HeaderSize + rootEntry.file_offset);
+    }
+    
+    verifySortRegions(ctx);
+    
+    return true;
+}
+
+bool verifyInitHfs0Partition(verify_ctx_t *ctx, u32 partition)
+{
+    if (!gameCardInfo.hfs0Partitions || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions[partition].header) return false;
+    
+    if (!verifyAllocRegions(ctx, 1 + (gameCardInfo.hfs0Partitions[partition].file_cnt * 2))) return false;
+    
+    verifyAddPartitionRegions(ctx, partition, 0);
+    
+    verifySortRegions(ctx);
+    
+    return true;
+}
+
+bool verifyInitHfs0File(verify_ctx_t *ctx, u32 partition, u32 fileIndex)
+{
+    if (!gameCardInfo.hfs0Partitions || partition >= gameCardInfo.hfs0PartitionCnt || !gameCardInfo.hfs0Partitions[partition].header || fileIndex >= gameCardInfo.hfs0Partitions[partition].file_cnt) return false;
+    
+    if (!verifyAllocRegions(ctx, 2)) return false;
+    
+    verifyAddFileRegions(ctx, partition, fileIndex, 0);
+    
+    verifySortRegions(ctx);
+    
+    return true;
+}
+
+void verifyUpdate(verify_ctx_t *ctx, u64 offset, const void *data, u64 size)
+{
+    if (!ctx || !ctx->regions || !data || !size) return;
+    
+    u32 i;
+    u64 end = (offset + size);
+    
+    for(i = ctx->curRegion; i < ctx->regionCnt; i++)
+    {
+        verify_region_t *region = &(ctx->regions[i]);
+        if (region->offset >= end) break;
+        if (region->status != VERIFY_STATUS_PENDING) continue;
+        
+        u64 regionEnd = (region->offset + region->size);
+        u64 start = (offset > region->offset ? offset : region->offset);
+        
+        // The stream must cover the region from its first byte, without gaps
+        if (start >= regionEnd || start != (region->offset + region->processed))
+        {
+            region->status = VERIFY_STATUS_SKIPPED;
+            continue;
+        }
+        
+        u64 chunkSize = ((end < regionEnd ? end : regionEnd) - start);
+        const u8 *chunk = ((const u8*)data + (start - offset));
+        
+        if (region->type == VERIFY_REGION_NCA_HEADER)
+        {
+            memcpy(region->ncaHeader + region->processed, chunk, chunkSize);
+        } else {
+            sha256ContextUpdate(&(region->hashCtx), chunk, chunkSize);
+        }
+        
+        region->processed += chunkSize;
+        
+        if (region->processed >= region->size) verifyFinishRegion(ctx, i);
+    }
+    
+    while(ctx->curRegion < ctx->regionCnt && ctx->regions[ctx->curRegion].status != VERIFY_STATUS_PENDING) ctx->curRegion++;
+}
+
+static void verifyGetRegionName(const verify_region_t *region, char *out, size_t outSize)
+{
+    const char *partitionName = GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, region->partition);
+    
+    switch(region->type)
+    {
+        case VERIFY_REGION_ROOT_HEADER:
+            snprintf(out, outSize, "root HFS0 header");
+            break;
+        case VERIFY_REGION_PARTITION_HEADER:
+            snprintf(out, outSize, "%s HFS0 partition header", partitionName);
+            break;
+        case VERIFY_REGION_FILE:
+            snprintf(out, outSize, "\"%s\" (%s partition)", region->name, partitionName);
+            break;
+        case VERIFY_REGION_NCA_HEADER:
+            snprintf(out, outSize, "\"%s\" NCA header (%s partition)", region->name, partitionName);
+            break;
+        default:
+            snprintf(out, outSize, "unknown region");
+            break;
+    }
+}
+
+void verifyPrintResult(verify_ctx_t *ctx)
+{
+    if (!ctx || !ctx->regions) return;
+    
+    char regionName[NAME_BUF_LEN] = {'\0'};
+    u32 skippedCnt = (ctx->regionCnt - ctx->matchCnt - ctx->mismatchCnt);
+    
+    if (ctx->mismatchCnt)
+    {
+        verifyGetRegionName(&(ctx->regions[ctx->firstMismatch]), regionName, MAX_ELEMENTS(regionName));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Hash verification failed for %u out of %u HFS0 / NCA header regions! First mismatch: %s.", ctx->mismatchCnt, ctx->matchCnt + ctx->mismatchCnt, regionName);
+    } else
+    if (ctx->matchCnt)
+    {
+        if (skippedCnt)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Hash verification passed (%u HFS0 / NCA header regions, %u not fully dumped in this session).", ctx->matchCnt, skippedCnt);
+        } else {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Hash verification passed (%u HFS0 / NCA header regions).", ctx->matchCnt);
+        }
+    } else {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Hash verification skipped (no HFS0 / NCA header region was fully dumped in this session).");
+    }
+}
+
+void verifyFree(verify_ctx_t *ctx)
+{
+    if (!ctx) return;
+    
+    u32 i;
+    
+    if (ctx->regions)
+    {
+        for(i = 0; i < ctx->regionCnt; i++)
+        {
+            if (ctx->regions[i].ncaHeader) free(ctx->regions[i].ncaHeader);
+        }
+        
+        free(ctx->regions);
+    }
+    
+    memset(ctx, 0, sizeof(verify_ctx_t));
+    ctx->firstMismatch = -1;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#ifndef __VERIFY_H__
+#define __VERIFY_H__
+
+#include <switch.h>
+
+typedef enum {
+    VERIFY_REGION_ROOT_HEADER = 0,                                              // Root HFS0 header (gamecard header hash)
+    VERIFY_REGION_PARTITION_HEADER,                                             // HFS0 partition header (root HFS0 entry hash)
+    VERIFY_REGION_FILE,                                                         // HFS0 file entry hashed region
+    VERIFY_REGION_NCA_HEADER                                                    // NCA FS section header hashes
+} verifyRegionType;
+
+typedef enum {
+    VERIFY_STATUS_PENDING = 0,
+    VERIFY_STATUS_MATCH,
+    VERIFY_STATUS_MISMATCH,
+    VERIFY_STATUS_SKIPPED                                                       // Part of the region wasn't streamed (resumed dumps, sequential dump sessions)
+} verifyRegionStatus;
+
+typedef struct {
+    u64 offset;                                                                 // Relative to the start of the dumped stream
+    u64 size;
+    u64 processed;                                                              // Bytes received so far
+    u8 hash[SHA256_HASH_SIZE];                                                  // Expected SHA-256 checksum. Not used by VERIFY_REGION_NCA_HEADER
+    Sha256Context hashCtx;
+    u8 *ncaHeader;                                                              // NCA_FULL_HEADER_LENGTH bytes long encrypted NCA header. Only used by VERIFY_REGION_NCA_HEADER
+    const char *name;                                                           // HFS0 file entry name (points to the partition header string table)
+    u32 partition;                                                              // HFS0 partition index
+    u8 type;                                                                    // verifyRegionType
+    u8 status;                                                                  // verifyRegionStatus
+} verify_region_t;
+
+typedef struct {
+    verify_region_t *regions;                                                   // Sorted by offset
+    u32 regionCnt;
+    u32 curRegion;                                                              // Regions below this index are done
+    u32 matchCnt;
+    u32 mismatchCnt;
+    s32 firstMismatch;                                                          // Region index, or -1 if everything matched so far
+} verify_ctx_t;
+
+/* Sets up the hashed regions from a whole XCI dump: the root HFS0 header, every HFS0 partition header, every HFS0 file entry hashed region and every NCA header. */
+/* NCA headers are only checked if the NCA keyset has already been loaded. */
+bool verifyInitXci(verify_ctx_t *ctx);
+
+/* Same as verifyInitXci(), but for a single HFS0 partition. Offsets are relative to the start of the partition. */
+bool verifyInitHfs0Partition(verify_ctx_t *ctx, u32 partition);
+
+/* Same as verifyInitHfs0Partition(), but the regions from the partition header and the rest of the files are left out. */
+bool verifyInitHfs0File(verify_ctx_t *ctx, u32 partition, u32 fileIndex);
+
+/* Feeds a chunk of the dumped stream. Chunks must be provided in order, but they don't need to start at offset zero: regions that can't be fully covered are skipped. */
+/* Nothing is drawn on screen, so this is safe to call from a worker thread. */
+void verifyUpdate(verify_ctx_t *ctx, u64 offset, const void *data, u64 size);
+
+/* Draws a one-line verification summary at the current breaks position. */
+void verifyPrintResult(verify_ctx_t *ctx);
+
+void verifyFree(verify_ctx_t *ctx);
+
+#endif
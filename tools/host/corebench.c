@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "crc32_fast.h"
+#include "lz4.h"
+
+/* Host counterpart of benchmarkCorePaths() for the core sources that don't depend on any Horizon service. */
+/* The NCA, BKTR, NSO and savefile parsers need ncm / spl / fs and the FatFs BIS mount, so they're only measured on the console. */
+
+#define COREBENCH_DATA_SIZE     (u64)0x10000000                                 // 256 MiB (268435456 bytes) processed per path
+#define COREBENCH_CRC_BLOCK     (u64)0x800000                                   // 8 MiB (8388608 bytes), same as the biggest dump block size
+#define COREBENCH_LZ4_BLOCK     (u64)0x100000                                   // 1 MiB (1048576 bytes), same as the compressed output block size
+
+#define COREBENCH_LOG_HEADER    "path,calls,bytes,elapsed_ms,mib_per_s,us_per_call"
+
+#define MiB                     (1024.0 * 1024.0)
+
+typedef struct {
+    u64 calls;
+    u64 bytes;
+    u64 ns;
+} corebench_result_t;
+
+static u64 corebenchNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (((u64)ts.tv_sec * 1000000000ULL) + (u64)ts.tv_nsec);
+}
+
+static void corebenchPrint(const char *path, const corebench_result_t *res)
+{
+    double ms = ((double)res->ns / 1000000.0);
+    
+    printf("%s,%lu,%lu,%.3lf,%.2lf,%.3lf\n", path, (unsigned long)res->calls, (unsigned long)res->bytes, ms, (ms > 0.0 ? (((double)res->bytes / MiB) / (ms / 1000.0)) : 0.0), (res->calls ? ((ms * 1000.0) / (double)res->calls) : 0.0));
+}
+
+// Roughly as compressible as NCA data with padding: random runs mixed with zeroed areas
+static void corebenchFillData(u8 *buf, u64 size)
+{
+    u64 i;
+    u32 state = 0x12345678;
+    
+    for(i = 0; i < size; i++)
+    {
+        state = ((state * 1103515245) + 12345);
+        buf[i] = (((i >> 12) & 3) == 0 ? 0 : (u8)(state >> 16));
+    }
+}
+
+static bool corebenchCheckCrc32(const u8 *buf, u64 size)
+{
+    u32 crc = 0, crc1 = 0, crc2 = 0;
+    u64 splits[] = { 1, 7, 0x1000, (size / 2), (size - 3) };
+    u64 i;
+    
+    // Standard check value
+    crc32("123456789", 9, &crc);
+    if (crc != 0xCBF43926)
+    {
+        fprintf(stderr, "crc32: check value mismatch (0x%08X != 0xCBF43926)\n", crc);
+        return false;
+    }
+    
+    crc = 0;
+    crc32(buf, size, &crc);
+    
+    // Chunk checksums merged with crc32CombineFast() must match the checksum of the whole buffer
+    for(i = 0; i < (sizeof(splits) / sizeof(splits[0])); i++)
+    {
+        crc1 = crc2 = 0;
+        crc32(buf, splits[i], &crc1);
+        crc32(buf + splits[i], size - splits[i], &crc2);
+        
+        if (crc32CombineFast(crc1, crc2, size - splits[i]) != crc)
+        {
+            fprintf(stderr, "crc32CombineFast: mismatch with a split at offset 0x%lX\n", (unsigned long)splits[i]);
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+static bool corebenchCrc32(const u8 *buf, u64 bufSize, corebench_result_t *res)
+{
+    u64 offset, start;
+    u32 crc = 0;
+    
+    memset(res, 0, sizeof(corebench_result_t));
+    
+    start = corebenchNow();
+    
+    for(offset = 0; offset < COREBENCH_DATA_SIZE; offset += COREBENCH_CRC_BLOCK)
+    {
+        crc32(buf + (offset % bufSize), COREBENCH_CRC_BLOCK, &crc);
+        res->calls++;
+        res->bytes += COREBENCH_CRC_BLOCK;
+    }
+    
+    res->ns = (corebenchNow() - start);
+    
+    // Keep the compiler from dropping the loop
+    return (crc != 0);
+}
+
+static bool corebenchLz4(const u8 *buf, u64 bufSize, corebench_result_t *compRes, corebench_result_t *decompRes)
+{
+    u64 offset, start;
+    int compSize, decompSize;
+    bool success = true;
+    
+    int bound = LZ4_compressBound((int)COREBENCH_LZ4_BLOCK);
+    char *compBuf = malloc((size_t)bound);
+    char *decompBuf = malloc(COREBENCH_LZ4_BLOCK);
+    
+    memset(compRes, 0, sizeof(corebench_result_t));
+    memset(decompRes, 0, sizeof(corebench_result_t));
+    
+    if (!compBuf || !decompBuf)
+    {
+        fprintf(stderr, "lz4: failed to allocate memory for the benchmark buffers\n");
+        success = false;
+        goto out;
+    }
+    
+    for(offset = 0; offset < COREBENCH_DATA_SIZE && success; offset += COREBENCH_LZ4_BLOCK)
+    {
+        const char *block = (const char*)(buf + (offset % bufSize));
+        
+        start = corebenchNow();
+        compSize = LZ4_compress_default(block, compBuf, (int)COREBENCH_LZ4_BLOCK, bound);
+        compRes->ns += (corebenchNow() - start);
+        compRes->calls++;
+        compRes->bytes += COREBENCH_LZ4_BLOCK;
+        
+        if (compSize <= 0)
+        {
+            fprintf(stderr, "lz4: failed to compress block at offset 0x%lX\n", (unsigned long)offset);
+            success = false;
+            break;
+        }
+        
+        start = corebenchNow();
+        decompSize = LZ4_decompress_safe(compBuf, decompBuf, compSize, (int)COREBENCH_LZ4_BLOCK);
+        decompRes->ns += (corebenchNow() - start);
+        decompRes->calls++;
+        decompRes->bytes += COREBENCH_LZ4_BLOCK;
+        
+        if (decompSize != (int)COREBENCH_LZ4_BLOCK || memcmp(decompBuf, block, COREBENCH_LZ4_BLOCK) != 0)
+        {
+            fprintf(stderr, "lz4: round trip mismatch for block at offset 0x%lX\n", (unsigned long)offset);
+            success = false;
+        }
+    }
+    
+out:
+    if (decompBuf) free(decompBuf);
+    if (compBuf) free(compBuf);
+    
+    return success;
+}
+
+int main()
+{
+    int ret = EXIT_FAILURE;
+    u64 bufSize = (COREBENCH_CRC_BLOCK * 4);
+    corebench_result_t crcRes, compRes, decompRes;
+    
+    u8 *buf = malloc(bufSize);
+    if (!buf)
+    {
+        fprintf(stderr, "failed to allocate memory for the benchmark data\n");
+        return ret;
+    }
+    
+    corebenchFillData(buf, bufSize);
+    
+    if (!corebenchCheckCrc32(buf, COREBENCH_CRC_BLOCK)) goto out;
+    
+    printf(COREBENCH_LOG_HEADER "\n");
+    
+    if (!corebenchCrc32(buf, bufSize, &crcRes)) goto out;
+    corebenchPrint("crc32", &crcRes);
+    
+    if (!corebenchLz4(buf, bufSize, &compRes, &decompRes)) goto out;
+    corebenchPrint("lz4_compress", &compRes);
+    corebenchPrint("lz4_decompress", &decompRes);
+    
+    ret = EXIT_SUCCESS;
+    
+out:
+    free(buf);
+    
+    return ret;
+}
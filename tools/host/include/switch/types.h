@@ -0,0 +1,27 @@
+#pragma once
+
+#ifndef __HOST_SWITCH_TYPES_H__
+#define __HOST_SWITCH_TYPES_H__
+
+/* Minimal stand-in for libnx's <switch/types.h>, used to build the service-free core sources (crc32_fast.c, lz4.c) on the host. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef u32 Result;
+
+#define BIT(n)      (1U << (n))
+#define PACKED      __attribute__((packed))
+
+#endif
@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+
+# Host receiver for nxdumptool USB / TCP dumps.
+# Implements the transfer protocol described in source/sink.h.
+#
+# TCP:  python3 nxdt_receiver.py tcp <console IP address> [-o output_dir]
+# USB:  python3 nxdt_receiver.py usb [-o output_dir]   (requires pyusb + libusb)
+
+import argparse
+import os
+import socket
+import struct
+import sys
+
+SINK_MAGIC = 0x5444584E                         # "NXDT"
+SINK_PROTOCOL_VERSION = 1
+
+SINK_CMD_FILE_BEGIN = 0x01
+SINK_CMD_FILE_DATA = 0x02
+SINK_CMD_FILE_END = 0x03
+
+SINK_FLAG_ALLOW_RESUME = 0x01
+
+SINK_STATUS_OK = 0
+SINK_STATUS_ERROR = 1
+
+SINK_MAX_FILENAME_LEN = 0x300
+SINK_TCP_PORT = 27020
+
+# sink_cmd_header_t / sink_cmd_reply_t
+CMD_HEADER = struct.Struct('<IBBBBIIQQ')
+CMD_REPLY = struct.Struct('<IIQ')
+
+# libnx usbComms defaults
+USB_VID = 0x057E
+USB_PID = 0x3000
+
+CHUNK_SIZE = 0x100000                           # 1 MiB
+
+class TcpTransport:
+    def __init__(self, host, port):
+        self.sock = socket.create_connection((host, port))
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, CHUNK_SIZE * 4)
+
+    def read(self, size):
+        data = bytearray()
+        while len(data) < size:
+            chunk = self.sock.recv(min(size - len(data), CHUNK_SIZE))
+            if not chunk:
+                raise EOFError('connection closed by the console')
+            data += chunk
+        return bytes(data)
+
+    def write(self, data):
+        self.sock.sendall(data)
+
+    def close(self):
+        self.sock.close()
+
+class UsbTransport:
+    def __init__(self):
+        try:
+            import usb.core
+            import usb.util
+        except ImportError:
+            sys.exit('USB mode requires pyusb (pip install pyusb) and a libusb backend.')
+
+        dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+        if dev is None:
+            sys.exit('Console not found. Start the dump with the USB output target selected first.')
+
+        dev.set_configuration()
+        intf = dev.get_active_configuration()[(0, 0)]
+
+        self.ep_in = usb.util.find_descriptor(intf, custom_match=lambda e: usb.util.endpoint_direction(e.bEndpointAddress) == usb.util.ENDPOINT_IN)
+        self.ep_out = usb.util.find_descriptor(intf, custom_match=lambda e: usb.util.endpoint_direction(e.bEndpointAddress) == usb.util.ENDPOINT_OUT)
+        if self.ep_in is None or self.ep_out is None:
+            sys.exit('Failed to find the USB bulk endpoints.')
+
+    def read(self, size):
+        data = bytearray()
+        while len(data) < size:
+            data += self.ep_in.read(min(size - len(data), CHUNK_SIZE), timeout=0)
+        return bytes(data)
+
+    def write(self, data):
+        self.ep_out.write(data, timeout=0)
+
+    def close(self):
+        pass
+
+def send_reply(transport, status, resume_offset=0):
+    transport.write(CMD_REPLY.pack(SINK_MAGIC, status, resume_offset))
+
+def get_output_path(output_dir, name):
+    # Never write outside of the output directory
+    parts = [p for p in name.replace('\\', '/').split('/') if p not in ('', '.', '..')]
+    if not parts:
+        raise ValueError('invalid filename "%s"' % name)
+    return os.path.join(output_dir, *parts)
+
+def receive(transport, output_dir):
+    out_file = None
+    out_path = None
+    file_size = 0
+
+    try:
+        while True:
+            try:
+                raw = transport.read(CMD_HEADER.size)
+            except EOFError:
+                break
+
+            magic, version, cmd, flags, _, name_len, _, offset, size = CMD_HEADER.unpack(raw)
+            if magic != SINK_MAGIC or version != SINK_PROTOCOL_VERSION:
+                sys.exit('Invalid command header received (magic 0x%08X, version %u).' % (magic, version))
+
+            if cmd == SINK_CMD_FILE_BEGIN:
+                if name_len == 0 or name_len > SINK_MAX_FILENAME_LEN:
+                    sys.exit('Invalid filename length: %u.' % name_len)
+
+                name = transport.read(name_len).decode('utf-8')
+
+                try:
+                    out_path = get_output_path(output_dir, name)
+                    os.makedirs(os.path.dirname(out_path), exist_ok=True)
+
+                    # Keep partial data around if the console can resume the dump
+                    resume_offset = 0
+                    if (flags & SINK_FLAG_ALLOW_RESUME) and os.path.isfile(out_path):
+                        resume_offset = os.path.getsize(out_path)
+                        if resume_offset >= size:
+                            resume_offset = 0
+
+                    out_file = open(out_path, 'r+b' if resume_offset else 'wb')
+                    file_size = size
+                except (OSError, ValueError) as e:
+                    print('Failed to open "%s": %s' % (name, e))
+                    send_reply(transport, SINK_STATUS_ERROR)
+                    continue
+
+                if resume_offset:
+                    print('Receiving "%s" (%u bytes, resuming at offset 0x%X)...' % (name, size, resume_offset))
+                else:
+                    print('Receiving "%s" (%u bytes)...' % (name, size))
+
+                send_reply(transport, SINK_STATUS_OK, resume_offset)
+            elif cmd == SINK_CMD_FILE_DATA:
+                data = transport.read(size)
+                if out_file is None:
+                    sys.exit('Received file data without an open output file.')
+
+                out_file.seek(offset)
+                out_file.write(data)
+
+                if file_size:
+                    print('\r%6.2f%%' % (min(offset + size, file_size) * 100.0 / file_size), end='', flush=True)
+            elif cmd == SINK_CMD_FILE_END:
+                if out_file is None:
+                    send_reply(transport, SINK_STATUS_ERROR)
+                    continue
+
+                out_file.truncate(file_size)
+                out_file.close()
+                out_file = None
+
+                print('\rSaved "%s".' % out_path)
+                send_reply(transport, SINK_STATUS_OK)
+            else:
+                sys.exit('Unknown command 0x%02X received.' % cmd)
+    finally:
+        if out_file is not None:
+            out_file.close()
+            print('\nTransfer interrupted. Partial data was kept in "%s".' % out_path)
+
+        transport.close()
+
+def main():
+    parser = argparse.ArgumentParser(description='Receives XCI / NSP / HFS0 dumps streamed by nxdumptool over USB or TCP.')
+    parser.add_argument('mode', choices=('usb', 'tcp'), help='transfer mode (must match the output target selected on the console)')
+    parser.add_argument('host', nargs='?', help='console IP address (TCP mode only, displayed on the console)')
+    parser.add_argument('-p', '--port', type=int, default=SINK_TCP_PORT, help='TCP port (default: %(default)s)')
+    parser.add_argument('-o', '--output', default='.', help='output directory (default: current directory)')
+    args = parser.parse_args()
+
+    if args.mode == 'tcp':
+        if not args.host:
+            parser.error('the console IP address is required in TCP mode')
+        transport = TcpTransport(args.host, args.port)
+    else:
+        transport = UsbTransport()
+
+    os.makedirs(args.output, exist_ok=True)
+    receive(transport, args.output)
+
+if __name__ == '__main__':
+    main()